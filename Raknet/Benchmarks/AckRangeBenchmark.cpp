@@ -0,0 +1,118 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file AckRangeBenchmark.cpp
+/// \brief Cost per received datagram of building ACK and NAK lists, as loss rises.
+/// \details Simulates the receiving side of ReliabilityLayer: datagrams arrive in order with some dropped at random,
+/// each one received is acked and each gap is nakked, and the lists are serialized every few datagrams the way an update tick would.
+/// Both DataStructures::RangeList and DataStructures::RangeBitmap are timed, and the serialized bytes of the two are compared.<BR>
+/// Build by compiling this file together with the RakNet sources, for example:<BR>
+/// g++ -O2 -I.. AckRangeBenchmark.cpp ../*.cpp -lpthread -o AckRangeBenchmark<BR>
+/// For the same measurement over real connections, run LoopbackBenchmark built with -D_DEBUG at several --loss settings.
+
+#include "DS_RangeList.h"
+#include "DS_RangeBitmap.h"
+#include "BitStream.h"
+#include "GetTime.h"
+#include "Rand.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace RakNet;
+
+typedef uint24_t DatagramNumber;
+
+static const int NUM_DATAGRAMS=2000000;
+// Maximum bits in one ACK datagram, as returned by GetMaxDatagramSizeExcludingMessageHeaderBits() for a typical MTU
+static const BitSize_t MAX_ACK_BITS=BYTES_TO_BITS(1400);
+
+// RangeBitmap has IsEmpty() rather than Size(), and can insert a gap in one call. Adapt it to the loop below
+class BitmapAdapter : public DataStructures::RangeBitmap<DatagramNumber, 24>
+{
+public:
+	unsigned Size(void) const {return IsEmpty() ? 0 : 1;}
+};
+
+static void InsertGap(DataStructures::RangeList<DatagramNumber> &naks, uint32_t datagramNumber, uint32_t skipped)
+{
+	for (uint32_t j=skipped; j > 0; j--)
+		naks.Insert(DatagramNumber(datagramNumber-j));
+}
+
+static void InsertGap(BitmapAdapter &naks, uint32_t datagramNumber, uint32_t skipped)
+{
+	naks.InsertRange(DatagramNumber(datagramNumber-skipped), DatagramNumber(datagramNumber-1));
+}
+
+template <class AckList>
+static RakNet::TimeUS Run(float loss, int datagramsPerTick, unsigned int seed, AckList &acks, AckList &naks, BitSize_t *bitsOut)
+{
+	seedMT(seed);
+	BitStream bs;
+	BitSize_t bits=0;
+	RakNet::TimeUS start = RakNet::GetTimeUS();
+	uint32_t expected=0xFFF000; // Start near the wrap so it is crossed
+	for (int i=0; i < NUM_DATAGRAMS; i++)
+	{
+		uint32_t datagramNumber = (0xFFF000 + (uint32_t) i) & 0xFFFFFF;
+		if (frandomMT() < loss)
+			continue;
+
+		// Same as the receive path in ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer
+		uint32_t skipped = (datagramNumber-expected) & 0xFFFFFF;
+		if (skipped > 0)
+			InsertGap(naks, datagramNumber, skipped);
+		expected=datagramNumber+1;
+		acks.Insert(DatagramNumber(datagramNumber));
+
+		if ((i % datagramsPerTick)==0)
+		{
+			while (acks.Size())
+			{
+				bs.Reset();
+				acks.Serialize(&bs, MAX_ACK_BITS, true);
+				bits+=bs.GetNumberOfBitsUsed();
+			}
+			while (naks.Size())
+			{
+				bs.Reset();
+				naks.Serialize(&bs, MAX_ACK_BITS, true);
+				bits+=bs.GetNumberOfBitsUsed();
+			}
+		}
+	}
+	*bitsOut=bits;
+	return RakNet::GetTimeUS()-start;
+}
+
+int main(int argc, char **argv)
+{
+	int datagramsPerTick=64;
+	if (argc > 1)
+		datagramsPerTick=atoi(argv[1]);
+
+	static const float lossRates[] = {0.0f, 0.01f, 0.05f, 0.1f, 0.2f, 0.4f};
+	printf("datagrams per serialize=%i\n", datagramsPerTick);
+	printf(" loss  rangelist_ns/dg  bitmap_ns/dg  same_output\n");
+	for (unsigned i=0; i < sizeof(lossRates)/sizeof(lossRates[0]); i++)
+	{
+		DataStructures::RangeList<DatagramNumber> listAcks, listNaks;
+		BitmapAdapter bitmapAcks, bitmapNaks;
+		BitSize_t listBits, bitmapBits;
+		RakNet::TimeUS listTime = Run(lossRates[i], datagramsPerTick, 1234+i, listAcks, listNaks, &listBits);
+		RakNet::TimeUS bitmapTime = Run(lossRates[i], datagramsPerTick, 1234+i, bitmapAcks, bitmapNaks, &bitmapBits);
+		printf("%5.2f  %15.1f  %12.1f  %s\n", lossRates[i],
+			(double) listTime * 1000.0 / NUM_DATAGRAMS,
+			(double) bitmapTime * 1000.0 / NUM_DATAGRAMS,
+			listBits==bitmapBits ? "yes" : "no");
+	}
+	return 0;
+}
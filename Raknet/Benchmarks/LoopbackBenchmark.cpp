@@ -0,0 +1,1016 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file LoopbackBenchmark.cpp
+/// \brief Headless load generator and soak test for RakPeer over loopback.
+/// \details Starts one server RakPeer and N client peers, either all in this process or spread over forked worker processes.
+/// Each client drives a configurable mix of reliability types, sizes and ordering channels at the server, which echoes every message back.
+/// The round trip time of each echo is recorded into a histogram. ReplicaManager3 objects owned by the server and RPC4 signals sent by
+/// the clients can be layered on top of the raw traffic.<BR>
+/// Build by compiling this file together with the RakNet sources, for example:<BR>
+/// g++ -O2 -I.. LoopbackBenchmark.cpp ../*.cpp -lpthread -o LoopbackBenchmark<BR>
+/// RakPeer::ApplyNetworkSimulator() only has an effect when RakNet is compiled with _DEBUG, so add -D_DEBUG when using --loss.
+
+#include "RakPeerInterface.h"
+#include "MessageIdentifiers.h"
+#include "BitStream.h"
+#include "RakNetTypes.h"
+#include "GetTime.h"
+#include "RakSleep.h"
+#include "Rand.h"
+#include "RPC4Plugin.h"
+#include "ReplicaManager3.h"
+#include "NetworkIDManager.h"
+#include "DS_List.h"
+#include "RakNetStatistics.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include "WindowsIncludes.h"
+#else
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#define LOOPBACK_BENCHMARK_FORK 1
+#endif
+
+using namespace RakNet;
+
+enum
+{
+	ID_BENCH_DATA = ID_USER_PACKET_ENUM,
+	ID_BENCH_ECHO,
+};
+
+static const unsigned short SERVER_PORT_DEFAULT=61234;
+static const int HEADER_SIZE=sizeof(MessageID)+sizeof(unsigned char)+sizeof(RakNet::TimeUS);
+static const int MAX_MESSAGE_CLASSES=16;
+
+/// One entry of the --mix option
+struct MessageClass
+{
+	PacketReliability reliability;
+	PacketPriority priority;
+	int size;
+	char orderingChannel;
+	int weight;
+};
+
+/// Network simulator settings applied with RakPeerInterface::ApplyNetworkSimulator()
+struct LossProfile
+{
+	const char *name;
+	float packetloss;
+	unsigned short minExtraPing;
+	unsigned short extraPingVariance;
+};
+
+static const LossProfile lossProfiles[] =
+{
+	{"none", 0.0f, 0, 0},
+	{"lan", 0.001f, 1, 1},
+	{"wifi", 0.01f, 10, 20},
+	{"mobile", 0.03f, 50, 100},
+	{"hostile", 0.1f, 100, 200},
+};
+
+struct Options
+{
+	unsigned short serverPort;
+	int numClients;
+	int numProcesses;
+	int messagesPerSecond;
+	int warmupSeconds;
+	int durationSeconds;
+	int reportIntervalSeconds;
+	int numReplicas;
+	int replicaSize;
+	int rpcsPerSecond;
+	int queuedMessages;
+	MessageClass messageClasses[MAX_MESSAGE_CLASSES];
+	int numMessageClasses;
+	LossProfile loss;
+};
+
+/// Latency histogram with linear buckets below 64us and 32 sub-buckets per power of two above it.
+/// Fixed size so that worker processes can ship it to the parent through a pipe as plain bytes.
+struct LatencyHistogram
+{
+	enum {LINEAR_BUCKETS=64, SUB_BUCKETS=32, MAX_EXPONENT=40, NUM_BUCKETS=LINEAR_BUCKETS+(MAX_EXPONENT-6)*SUB_BUCKETS};
+	uint64_t counts[NUM_BUCKETS];
+	uint64_t total;
+	uint64_t maxValue;
+
+	void Clear(void) {memset(this, 0, sizeof(*this));}
+	static int BucketIndex(uint64_t us)
+	{
+		if (us < LINEAR_BUCKETS)
+			return (int) us;
+		int msb=6;
+		while (msb < MAX_EXPONENT-1 && (us >> (msb+1))!=0)
+			msb++;
+		int index = LINEAR_BUCKETS + (msb-6)*SUB_BUCKETS + (int)((us >> (msb-5)) & (SUB_BUCKETS-1));
+		return index < NUM_BUCKETS ? index : NUM_BUCKETS-1;
+	}
+	static uint64_t BucketValue(int index)
+	{
+		if (index < LINEAR_BUCKETS)
+			return (uint64_t) index;
+		int msb = 6 + (index-LINEAR_BUCKETS)/SUB_BUCKETS;
+		uint64_t sub = (uint64_t) ((index-LINEAR_BUCKETS)%SUB_BUCKETS);
+		return ((uint64_t)1 << msb) | (sub << (msb-5));
+	}
+	void Add(uint64_t us)
+	{
+		counts[BucketIndex(us)]++;
+		total++;
+		if (us > maxValue)
+			maxValue=us;
+	}
+	void Merge(const LatencyHistogram &other)
+	{
+		for (int i=0; i < NUM_BUCKETS; i++)
+			counts[i]+=other.counts[i];
+		total+=other.total;
+		if (other.maxValue > maxValue)
+			maxValue=other.maxValue;
+	}
+	uint64_t Percentile(double p) const
+	{
+		if (total==0)
+			return 0;
+		uint64_t target = (uint64_t) (p * (double) total);
+		if (target >= total)
+			target = total-1;
+		uint64_t running=0;
+		for (int i=0; i < NUM_BUCKETS; i++)
+		{
+			running+=counts[i];
+			if (running > target)
+				return BucketValue(i);
+		}
+		return maxValue;
+	}
+};
+
+/// Totals produced by one process. Plain data so it can be written to a pipe.
+struct BenchmarkResults
+{
+	uint64_t messagesSent;
+	uint64_t echoesReceived;
+	uint64_t serverMessagesReceived;
+	uint64_t rpcsSent;
+	uint64_t rpcsReceived;
+	uint64_t replicaDeserializations;
+	double cpuSeconds;
+	uint64_t rssStart;
+	uint64_t rssEnd;
+	LatencyHistogram latency;
+
+	void Clear(void) {memset(this, 0, sizeof(*this));}
+	void Merge(const BenchmarkResults &other)
+	{
+		messagesSent+=other.messagesSent;
+		echoesReceived+=other.echoesReceived;
+		serverMessagesReceived+=other.serverMessagesReceived;
+		rpcsSent+=other.rpcsSent;
+		rpcsReceived+=other.rpcsReceived;
+		replicaDeserializations+=other.replicaDeserializations;
+		cpuSeconds+=other.cpuSeconds;
+		rssStart+=other.rssStart;
+		rssEnd+=other.rssEnd;
+		latency.Merge(other.latency);
+	}
+};
+
+// RPC4 slots and Replica3::Deserialize() have no user pointer, so the counters they update are process wide
+static uint64_t rpcsReceived=0;
+static uint64_t replicaDeserializations=0;
+
+static double GetProcessCPUSeconds(void)
+{
+#if defined(_WIN32)
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)==0)
+		return 0.0;
+	ULARGE_INTEGER k, u;
+	k.LowPart=kernelTime.dwLowDateTime; k.HighPart=kernelTime.dwHighDateTime;
+	u.LowPart=userTime.dwLowDateTime; u.HighPart=userTime.dwHighDateTime;
+	return (double) (k.QuadPart+u.QuadPart) / 10000000.0;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage)!=0)
+		return 0.0;
+	return (double) usage.ru_utime.tv_sec + (double) usage.ru_utime.tv_usec / 1000000.0 +
+		(double) usage.ru_stime.tv_sec + (double) usage.ru_stime.tv_usec / 1000000.0;
+#endif
+}
+
+/// Resident set size in bytes, or 0 where it can't be read
+static uint64_t GetResidentBytes(void)
+{
+#if defined(__linux__)
+	FILE *fp = fopen("/proc/self/statm", "r");
+	if (fp==0)
+		return 0;
+	unsigned long pages=0, resident=0;
+	int read = fscanf(fp, "%lu %lu", &pages, &resident);
+	fclose(fp);
+	if (read!=2)
+		return 0;
+	return (uint64_t) resident * (uint64_t) sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+static void BenchRPCSlot(RakNet::BitStream *userData, Packet *packet)
+{
+	(void) userData;
+	(void) packet;
+	rpcsReceived++;
+}
+
+class BenchReplica : public Replica3
+{
+public:
+	BenchReplica(int _payloadSize, bool _isServer) : payloadSize(_payloadSize), counter(0), isServer(_isServer) {}
+	virtual void WriteAllocationID(RakNet::Connection_RM3 *destinationConnection, RakNet::BitStream *allocationIdBitstream) const
+	{
+		(void) destinationConnection;
+		allocationIdBitstream->Write(RakString("BenchReplica"));
+	}
+	virtual RM3ConstructionState QueryConstruction(RakNet::Connection_RM3 *destinationConnection, ReplicaManager3 *replicaManager3)
+	{
+		(void) replicaManager3;
+		return QueryConstruction_ServerConstruction(destinationConnection, isServer);
+	}
+	virtual bool QueryRemoteConstruction(RakNet::Connection_RM3 *sourceConnection)
+	{
+		return QueryRemoteConstruction_ServerConstruction(sourceConnection, isServer);
+	}
+	virtual void SerializeConstruction(RakNet::BitStream *constructionBitstream, RakNet::Connection_RM3 *destinationConnection)
+	{
+		(void) destinationConnection;
+		constructionBitstream->Write(payloadSize);
+	}
+	virtual bool DeserializeConstruction(RakNet::BitStream *constructionBitstream, RakNet::Connection_RM3 *sourceConnection)
+	{
+		(void) sourceConnection;
+		return constructionBitstream->Read(payloadSize);
+	}
+	virtual void SerializeDestruction(RakNet::BitStream *destructionBitstream, RakNet::Connection_RM3 *destinationConnection)
+	{
+		(void) destructionBitstream;
+		(void) destinationConnection;
+	}
+	virtual bool DeserializeDestruction(RakNet::BitStream *destructionBitstream, RakNet::Connection_RM3 *sourceConnection)
+	{
+		(void) destructionBitstream;
+		(void) sourceConnection;
+		return true;
+	}
+	virtual RakNet::RM3ActionOnPopConnection QueryActionOnPopConnection(RakNet::Connection_RM3 *droppedConnection) const
+	{
+		return QueryActionOnPopConnection_Server(droppedConnection);
+	}
+	virtual void DeallocReplica(RakNet::Connection_RM3 *sourceConnection)
+	{
+		(void) sourceConnection;
+		delete this;
+	}
+	virtual RakNet::RM3QuerySerializationResult QuerySerialization(RakNet::Connection_RM3 *destinationConnection)
+	{
+		return QuerySerialization_ServerSerializable(destinationConnection, isServer);
+	}
+	virtual RM3SerializationResult Serialize(RakNet::SerializeParameters *serializeParameters)
+	{
+		// Changes every tick, so RM3_SERIALIZATION_RESULT_CHANGED forces a send per auto serialize interval
+		serializeParameters->outputBitstream[0].Write(counter);
+		for (int i=(int) sizeof(counter); i < payloadSize; i++)
+			serializeParameters->outputBitstream[0].Write((unsigned char) i);
+		return RM3SR_BROADCAST_IDENTICALLY;
+	}
+	virtual void Deserialize(RakNet::DeserializeParameters *deserializeParameters)
+	{
+		if (deserializeParameters->bitstreamWrittenTo[0])
+		{
+			deserializeParameters->serializationBitstream[0].Read(counter);
+			replicaDeserializations++;
+		}
+	}
+
+	int payloadSize;
+	uint32_t counter;
+	bool isServer;
+};
+
+class BenchConnection : public Connection_RM3
+{
+public:
+	BenchConnection(const SystemAddress &_systemAddress, RakNetGUID _guid) : Connection_RM3(_systemAddress, _guid) {}
+	virtual Replica3 *AllocReplica(RakNet::BitStream *allocationId, ReplicaManager3 *replicaManager3)
+	{
+		(void) replicaManager3;
+		RakString typeName;
+		allocationId->Read(typeName);
+		if (typeName=="BenchReplica")
+			return new BenchReplica(0, false);
+		return 0;
+	}
+};
+
+class BenchReplicaManager : public ReplicaManager3
+{
+	virtual Connection_RM3* AllocConnection(const SystemAddress &systemAddress, RakNetGUID rakNetGUID) const
+	{
+		return new BenchConnection(systemAddress, rakNetGUID);
+	}
+	virtual void DeallocConnection(Connection_RM3 *connection) const
+	{
+		delete connection;
+	}
+};
+
+/// A RakPeer plus the plugins the benchmark attaches to it
+struct BenchPeer
+{
+	RakPeerInterface *peer;
+	RPC4 *rpc;
+	BenchReplicaManager *replicaManager;
+	NetworkIDManager *networkIDManager;
+	RakNetGUID serverGuid;
+	bool connected;
+	double messageCredit;
+	double rpcCredit;
+};
+
+static void PrintUsage(void)
+{
+	printf("LoopbackBenchmark - load generation and soak test for RakPeer\n");
+	printf("  --clients N          Number of client peers (default 8)\n");
+	printf("  --processes N        Spread clients over N forked processes (default 0, all in-process)\n");
+	printf("  --rate N             Messages per second sent by each client (default 1000)\n");
+	printf("  --mix LIST           Comma separated reliability:size:channel:weight[:priority] entries\n");
+	printf("                       reliability is one of UNRELIABLE, UNRELIABLE_SEQUENCED, RELIABLE, RELIABLE_ORDERED, RELIABLE_SEQUENCED\n");
+	printf("                       priority is one of IMMEDIATE, HIGH, MEDIUM, LOW (default HIGH)\n");
+	printf("  --queue N            Queue N messages per client in one burst before the run instead of pacing by --rate\n");
+	printf("  --replicas N         ReplicaManager3 objects owned by the server (default 0)\n");
+	printf("  --replica-size N     Bytes serialized per replica per update (default 64)\n");
+	printf("  --rpc N              RPC4 signals per second sent by each client (default 0)\n");
+	printf("  --loss PROFILE       none, lan, wifi, mobile, hostile or loss:minPing:pingVariance (requires _DEBUG)\n");
+	printf("  --warmup S           Seconds to run before measuring (default 2)\n");
+	printf("  --duration S         Seconds to measure (default 10)\n");
+	printf("  --report S           Print a soak line every S seconds (default 0, off)\n");
+	printf("  --port N             Server port (default %i)\n", SERVER_PORT_DEFAULT);
+}
+
+static bool ParseReliability(const char *str, PacketReliability *reliability)
+{
+	static const struct {const char *name; PacketReliability value;} names[] =
+	{
+		{"UNRELIABLE", UNRELIABLE},
+		{"UNRELIABLE_SEQUENCED", UNRELIABLE_SEQUENCED},
+		{"RELIABLE", RELIABLE},
+		{"RELIABLE_ORDERED", RELIABLE_ORDERED},
+		{"RELIABLE_SEQUENCED", RELIABLE_SEQUENCED},
+	};
+	for (unsigned i=0; i < sizeof(names)/sizeof(names[0]); i++)
+	{
+		if (strcmp(str, names[i].name)==0)
+		{
+			*reliability=names[i].value;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool ParsePriority(const char *str, PacketPriority *priority)
+{
+	static const struct {const char *name; PacketPriority value;} names[] =
+	{
+		{"IMMEDIATE", IMMEDIATE_PRIORITY},
+		{"HIGH", HIGH_PRIORITY},
+		{"MEDIUM", MEDIUM_PRIORITY},
+		{"LOW", LOW_PRIORITY},
+	};
+	for (unsigned i=0; i < sizeof(names)/sizeof(names[0]); i++)
+	{
+		if (strcmp(str, names[i].name)==0)
+		{
+			*priority=names[i].value;
+			return true;
+		}
+	}
+	return false;
+}
+
+static bool ParseMix(const char *str, Options *options)
+{
+	char buff[1024];
+	strncpy(buff, str, sizeof(buff)-1);
+	buff[sizeof(buff)-1]=0;
+	options->numMessageClasses=0;
+	for (char *entry=strtok(buff, ","); entry; entry=strtok(0, ","))
+	{
+		if (options->numMessageClasses==MAX_MESSAGE_CLASSES)
+			return false;
+		char reliabilityName[64], priorityName[64];
+		int size, channel, weight;
+		priorityName[0]=0;
+		int fields = sscanf(entry, "%63[^:]:%i:%i:%i:%63s", reliabilityName, &size, &channel, &weight, priorityName);
+		if (fields < 4)
+			return false;
+		MessageClass &mc = options->messageClasses[options->numMessageClasses];
+		if (ParseReliability(reliabilityName, &mc.reliability)==false)
+			return false;
+		mc.priority=HIGH_PRIORITY;
+		if (fields==5 && ParsePriority(priorityName, &mc.priority)==false)
+			return false;
+		if (size < HEADER_SIZE)
+			size=HEADER_SIZE;
+		if (channel < 0 || channel >= 32 || weight <= 0)
+			return false;
+		mc.size=size;
+		mc.orderingChannel=(char) channel;
+		mc.weight=weight;
+		options->numMessageClasses++;
+	}
+	return options->numMessageClasses > 0;
+}
+
+static bool ParseLoss(const char *str, LossProfile *loss)
+{
+	for (unsigned i=0; i < sizeof(lossProfiles)/sizeof(lossProfiles[0]); i++)
+	{
+		if (strcmp(str, lossProfiles[i].name)==0)
+		{
+			*loss=lossProfiles[i];
+			return true;
+		}
+	}
+	float packetloss;
+	int minExtraPing, extraPingVariance;
+	if (sscanf(str, "%f:%i:%i", &packetloss, &minExtraPing, &extraPingVariance)!=3)
+		return false;
+	loss->name="custom";
+	loss->packetloss=packetloss;
+	loss->minExtraPing=(unsigned short) minExtraPing;
+	loss->extraPingVariance=(unsigned short) extraPingVariance;
+	return true;
+}
+
+static bool ParseOptions(int argc, char **argv, Options *options)
+{
+	options->serverPort=SERVER_PORT_DEFAULT;
+	options->numClients=8;
+	options->numProcesses=0;
+	options->messagesPerSecond=1000;
+	options->warmupSeconds=2;
+	options->durationSeconds=10;
+	options->reportIntervalSeconds=0;
+	options->numReplicas=0;
+	options->replicaSize=64;
+	options->rpcsPerSecond=0;
+	options->queuedMessages=0;
+	options->loss=lossProfiles[0];
+	ParseMix("UNRELIABLE:32:0:4,UNRELIABLE_SEQUENCED:64:1:2,RELIABLE:128:0:1,RELIABLE_ORDERED:256:2:2,RELIABLE_ORDERED:1200:3:1", options);
+
+	for (int i=1; i < argc; i++)
+	{
+		const char *arg=argv[i];
+		const char *value = i+1 < argc ? argv[i+1] : 0;
+		if (strcmp(arg, "--help")==0 || strcmp(arg, "-h")==0)
+			return false;
+		if (value==0)
+		{
+			printf("Missing value for %s\n", arg);
+			return false;
+		}
+		i++;
+		if (strcmp(arg, "--clients")==0) options->numClients=atoi(value);
+		else if (strcmp(arg, "--processes")==0) options->numProcesses=atoi(value);
+		else if (strcmp(arg, "--rate")==0) options->messagesPerSecond=atoi(value);
+		else if (strcmp(arg, "--queue")==0) options->queuedMessages=atoi(value);
+		else if (strcmp(arg, "--replicas")==0) options->numReplicas=atoi(value);
+		else if (strcmp(arg, "--replica-size")==0) options->replicaSize=atoi(value);
+		else if (strcmp(arg, "--rpc")==0) options->rpcsPerSecond=atoi(value);
+		else if (strcmp(arg, "--warmup")==0) options->warmupSeconds=atoi(value);
+		else if (strcmp(arg, "--duration")==0) options->durationSeconds=atoi(value);
+		else if (strcmp(arg, "--report")==0) options->reportIntervalSeconds=atoi(value);
+		else if (strcmp(arg, "--port")==0) options->serverPort=(unsigned short) atoi(value);
+		else if (strcmp(arg, "--mix")==0)
+		{
+			if (ParseMix(value, options)==false)
+			{
+				printf("Bad --mix %s\n", value);
+				return false;
+			}
+		}
+		else if (strcmp(arg, "--loss")==0)
+		{
+			if (ParseLoss(value, &options->loss)==false)
+			{
+				printf("Bad --loss %s\n", value);
+				return false;
+			}
+		}
+		else
+		{
+			printf("Unknown option %s\n", arg);
+			return false;
+		}
+	}
+	if (options->numClients < 1 || options->durationSeconds < 1 || options->replicaSize < 4)
+		return false;
+	return true;
+}
+
+static void StartupPeer(BenchPeer *bp, const Options &options, bool isServer)
+{
+	*bp=BenchPeer();
+	bp->peer=RakPeerInterface::GetInstance();
+	bp->rpc=RPC4::GetInstance();
+	bp->peer->AttachPlugin(bp->rpc);
+	if (options.numReplicas > 0)
+	{
+		bp->networkIDManager=NetworkIDManager::GetInstance();
+		bp->replicaManager=new BenchReplicaManager;
+		bp->replicaManager->SetNetworkIDManager(bp->networkIDManager);
+		bp->replicaManager->SetAutoSerializeInterval(16);
+		bp->peer->AttachPlugin(bp->replicaManager);
+	}
+	if (isServer)
+	{
+		SocketDescriptor sd(options.serverPort, 0);
+		bp->peer->Startup(options.numClients, &sd, 1);
+		bp->peer->SetMaximumIncomingConnections((unsigned short) options.numClients);
+		bp->rpc->RegisterSlot("BenchRPC", BenchRPCSlot, 0);
+	}
+	else
+	{
+		SocketDescriptor sd;
+		bp->peer->Startup(1, &sd, 1);
+	}
+	// Half the round trip on each side, see RakPeerInterface::ApplyNetworkSimulator()
+	if (options.loss.packetloss > 0.0f || options.loss.minExtraPing > 0 || options.loss.extraPingVariance > 0)
+		bp->peer->ApplyNetworkSimulator(options.loss.packetloss, options.loss.minExtraPing/2, options.loss.extraPingVariance/2);
+}
+
+static void ShutdownPeer(BenchPeer *bp)
+{
+	bp->peer->Shutdown(100);
+	if (bp->replicaManager)
+	{
+		bp->peer->DetachPlugin(bp->replicaManager);
+		delete bp->replicaManager;
+		NetworkIDManager::DestroyInstance(bp->networkIDManager);
+	}
+	bp->peer->DetachPlugin(bp->rpc);
+	RPC4::DestroyInstance(bp->rpc);
+	RakPeerInterface::DestroyInstance(bp->peer);
+}
+
+static int PickMessageClass(const Options &options, int totalWeight)
+{
+	int r = (int) (randomMT() % (unsigned int) totalWeight);
+	for (int i=0; i < options.numMessageClasses; i++)
+	{
+		r-=options.messageClasses[i].weight;
+		if (r < 0)
+			return i;
+	}
+	return options.numMessageClasses-1;
+}
+
+static void SendBenchMessage(BenchPeer *client, const Options &options, int classIndex, char *buff, BenchmarkResults *results)
+{
+	const MessageClass &mc = options.messageClasses[classIndex];
+	RakNet::TimeUS now = RakNet::GetTimeUS();
+	buff[0]=(char) ID_BENCH_DATA;
+	buff[1]=(char) classIndex;
+	memcpy(buff+2, &now, sizeof(now));
+	client->peer->Send(buff, mc.size, mc.priority, mc.reliability, mc.orderingChannel, client->serverGuid, false);
+	results->messagesSent++;
+}
+
+/// Processes everything waiting on the server. Data messages are echoed back using the class they were sent with.
+static void UpdateServer(BenchPeer *server, const Options &options, BenchmarkResults *results, int *connectionCount)
+{
+	Packet *packet;
+	for (packet=server->peer->Receive(); packet; server->peer->DeallocatePacket(packet), packet=server->peer->Receive())
+	{
+		switch (packet->data[0])
+		{
+		case ID_NEW_INCOMING_CONNECTION:
+			(*connectionCount)++;
+			break;
+		case ID_DISCONNECTION_NOTIFICATION:
+		case ID_CONNECTION_LOST:
+			(*connectionCount)--;
+			break;
+		case ID_BENCH_DATA:
+			if (packet->length >= (unsigned int) HEADER_SIZE && packet->data[1] < options.numMessageClasses)
+			{
+				const MessageClass &mc = options.messageClasses[packet->data[1]];
+				packet->data[0]=ID_BENCH_ECHO;
+				server->peer->Send((const char*) packet->data, (int) packet->length, mc.priority, mc.reliability, mc.orderingChannel, packet->guid, false);
+				results->serverMessagesReceived++;
+			}
+			break;
+		}
+	}
+}
+
+static void UpdateClient(BenchPeer *client, BenchmarkResults *results, bool measuring)
+{
+	Packet *packet;
+	for (packet=client->peer->Receive(); packet; client->peer->DeallocatePacket(packet), packet=client->peer->Receive())
+	{
+		switch (packet->data[0])
+		{
+		case ID_CONNECTION_REQUEST_ACCEPTED:
+			client->serverGuid=packet->guid;
+			client->connected=true;
+			break;
+		case ID_CONNECTION_ATTEMPT_FAILED:
+		case ID_DISCONNECTION_NOTIFICATION:
+		case ID_CONNECTION_LOST:
+			client->connected=false;
+			break;
+		case ID_BENCH_ECHO:
+			if (measuring && packet->length >= (unsigned int) HEADER_SIZE)
+			{
+				RakNet::TimeUS sent;
+				memcpy(&sent, packet->data+2, sizeof(sent));
+				RakNet::TimeUS now = RakNet::GetTimeUS();
+				results->echoesReceived++;
+				results->latency.Add(now > sent ? now-sent : 0);
+			}
+			break;
+		}
+	}
+}
+
+/// Sends this tick's share of messages and RPCs from one client, using credit accumulated from elapsed time
+static void DriveClient(BenchPeer *client, const Options &options, double elapsedSeconds, int totalWeight, char *buff, BenchmarkResults *results)
+{
+	if (client->connected==false)
+		return;
+	if (options.queuedMessages==0)
+	{
+		client->messageCredit+=elapsedSeconds*options.messagesPerSecond;
+		while (client->messageCredit >= 1.0)
+		{
+			SendBenchMessage(client, options, PickMessageClass(options, totalWeight), buff, results);
+			client->messageCredit-=1.0;
+		}
+	}
+	if (options.rpcsPerSecond > 0)
+	{
+		client->rpcCredit+=elapsedSeconds*options.rpcsPerSecond;
+		while (client->rpcCredit >= 1.0)
+		{
+			RakNet::BitStream bs;
+			bs.Write(results->rpcsSent);
+			client->rpc->Signal("BenchRPC", &bs, HIGH_PRIORITY, RELIABLE_ORDERED, 0, client->serverGuid, false, false);
+			results->rpcsSent++;
+			client->rpcCredit-=1.0;
+		}
+	}
+}
+
+static bool ConnectClients(BenchPeer *clients, int numClients, const Options &options)
+{
+	for (int i=0; i < numClients; i++)
+		clients[i].peer->Connect("127.0.0.1", options.serverPort, 0, 0);
+	BenchmarkResults unused;
+	RakNet::TimeMS timeout = RakNet::GetTimeMS()+10000;
+	for (;;)
+	{
+		int connected=0;
+		for (int i=0; i < numClients; i++)
+		{
+			UpdateClient(&clients[i], &unused, false);
+			if (clients[i].connected)
+				connected++;
+		}
+		if (connected==numClients)
+			return true;
+		if (RakNet::GetTimeMS() > timeout)
+		{
+			printf("Only %i of %i clients connected\n", connected, numClients);
+			return false;
+		}
+		RakSleep(1);
+	}
+}
+
+/// True once every client has handed all of its queued messages to the socket
+static bool SendBuffersEmpty(BenchPeer *clients, int numClients)
+{
+	RakNetStatistics rns;
+	for (int c=0; c < numClients; c++)
+	{
+		if (clients[c].peer->GetStatistics(clients[c].peer->GetSystemAddressFromGuid(clients[c].serverGuid), &rns)==0)
+			continue;
+		for (int i=0; i < NUMBER_OF_PRIORITIES; i++)
+		{
+			if (rns.messageInSendBuffer[i]!=0)
+				return false;
+		}
+	}
+	return true;
+}
+
+/// Runs \a numClients clients for the warmup and measured periods. If \a server is not 0 it is updated from the same loop.
+/// \return The number of seconds measured
+static double RunLoop(BenchPeer *server, BenchPeer *clients, int numClients, const Options &options, BenchmarkResults *results, bool printSoak)
+{
+	int totalWeight=0;
+	for (int i=0; i < options.numMessageClasses; i++)
+		totalWeight+=options.messageClasses[i].weight;
+	char *buff = new char[65536];
+	memset(buff, 0, 65536);
+	int serverConnections=numClients;
+
+	if (options.queuedMessages > 0)
+	{
+		for (int c=0; c < numClients; c++)
+			for (int i=0; i < options.queuedMessages; i++)
+				SendBenchMessage(&clients[c], options, PickMessageClass(options, totalWeight), buff, results);
+	}
+
+	BenchmarkResults warmupResults;
+	warmupResults.Clear();
+	RakNet::TimeUS start = RakNet::GetTimeUS();
+	RakNet::TimeUS measureStart = start + (RakNet::TimeUS) options.warmupSeconds*1000000;
+	RakNet::TimeUS end = measureStart + (RakNet::TimeUS) options.durationSeconds*1000000;
+	RakNet::TimeUS nextReport = measureStart + (RakNet::TimeUS) options.reportIntervalSeconds*1000000;
+	RakNet::TimeUS last = start;
+	bool measuring=false;
+	bool sendBuffersDrained=false;
+	uint64_t lastReportEchoes=0;
+	double cpuStart=0.0;
+	if (options.queuedMessages > 0)
+	{
+		// A queued burst is measured from the moment it was submitted
+		measuring=true;
+		measureStart=start;
+		end=start + (RakNet::TimeUS) options.durationSeconds*1000000;
+		cpuStart=GetProcessCPUSeconds();
+		results->rssStart=GetResidentBytes();
+	}
+
+	for (;;)
+	{
+		RakNet::TimeUS now = RakNet::GetTimeUS();
+		if (now >= end)
+			break;
+		if (measuring==false && now >= measureStart)
+		{
+			measuring=true;
+			cpuStart=GetProcessCPUSeconds();
+			results->rssStart=GetResidentBytes();
+			rpcsReceived=0;
+			replicaDeserializations=0;
+			results->messagesSent=0;
+			results->rpcsSent=0;
+			results->serverMessagesReceived=0;
+		}
+		double elapsed = (double) (now-last) / 1000000.0;
+		last=now;
+
+		if (server)
+		{
+			UpdateServer(server, options, results, &serverConnections);
+			if (server->replicaManager)
+			{
+				for (unsigned i=0; i < server->replicaManager->GetReplicaCount(); i++)
+					((BenchReplica*) server->replicaManager->GetReplicaAtIndex(i))->counter++;
+			}
+		}
+		for (int c=0; c < numClients; c++)
+		{
+			UpdateClient(&clients[c], measuring ? results : &warmupResults, measuring);
+			DriveClient(&clients[c], options, elapsed, totalWeight, buff, measuring ? results : &warmupResults);
+		}
+		if (options.queuedMessages > 0 && sendBuffersDrained==false && SendBuffersEmpty(clients, numClients))
+		{
+			// Measures how fast ReliabilityLayer packs a deep send queue into datagrams
+			double drainSeconds = (double) (now-start) / 1000000.0;
+			printf("Send queues drained in %.3f s, %.0f msgs/s\n", drainSeconds, (double) results->messagesSent / drainSeconds);
+			sendBuffersDrained=true;
+		}
+		if (options.queuedMessages > 0 && sendBuffersDrained && server && results->echoesReceived >= results->messagesSent)
+			break;
+
+		if (printSoak && measuring && options.reportIntervalSeconds > 0 && now >= nextReport)
+		{
+			uint64_t rss = GetResidentBytes();
+			printf("soak t=%.0fs echoes/s=%.0f rss=%.1fMB growth=%.1fMB\n",
+				(double) (now-measureStart) / 1000000.0,
+				(double) (results->echoesReceived-lastReportEchoes) / options.reportIntervalSeconds,
+				(double) rss / (1024.0*1024.0),
+				((double) rss - (double) results->rssStart) / (1024.0*1024.0));
+			lastReportEchoes=results->echoesReceived;
+			nextReport+=(RakNet::TimeUS) options.reportIntervalSeconds*1000000;
+		}
+		RakSleep(0);
+	}
+	results->cpuSeconds=GetProcessCPUSeconds()-cpuStart;
+	results->rssEnd=GetResidentBytes();
+	results->rpcsReceived=rpcsReceived;
+	results->replicaDeserializations=replicaDeserializations;
+	double measuredSeconds = (double) (RakNet::GetTimeUS()-measureStart) / 1000000.0;
+	if (options.queuedMessages > 0)
+		printf("Burst of %u messages, %u echoed in %.3f s\n", (unsigned int) results->messagesSent, (unsigned int) results->echoesReceived, measuredSeconds);
+	delete [] buff;
+	return measuredSeconds;
+}
+
+static void PrintResults(const BenchmarkResults &results, const Options &options, double seconds)
+{
+	uint64_t handled = results.messagesSent + results.serverMessagesReceived + results.echoesReceived;
+	printf("clients=%i processes=%i loss=%s (%.3f, %i+%ims)\n", options.numClients, options.numProcesses, options.loss.name,
+		options.loss.packetloss, options.loss.minExtraPing, options.loss.extraPingVariance);
+	printf("sent=%llu echoed=%llu delivered=%.2f%%\n", (unsigned long long) results.messagesSent, (unsigned long long) results.echoesReceived,
+		results.messagesSent ? 100.0 * (double) results.echoesReceived / (double) results.messagesSent : 0.0);
+	printf("msgs/s sent=%.0f echoed=%.0f\n", (double) results.messagesSent / seconds, (double) results.echoesReceived / seconds);
+	printf("rtt_us p50=%llu p99=%llu p999=%llu max=%llu\n",
+		(unsigned long long) results.latency.Percentile(0.5),
+		(unsigned long long) results.latency.Percentile(0.99),
+		(unsigned long long) results.latency.Percentile(0.999),
+		(unsigned long long) results.latency.maxValue);
+	printf("cpu_s=%.3f cpu_ns_per_msg=%.0f\n", results.cpuSeconds, handled ? results.cpuSeconds * 1e9 / (double) handled : 0.0);
+	if (options.rpcsPerSecond > 0)
+		printf("rpc sent=%llu received=%llu rpc/s=%.0f\n", (unsigned long long) results.rpcsSent, (unsigned long long) results.rpcsReceived, (double) results.rpcsReceived / seconds);
+	if (options.numReplicas > 0)
+		printf("rm3 deserializations=%llu per_s=%.0f\n", (unsigned long long) results.replicaDeserializations, (double) results.replicaDeserializations / seconds);
+	if (results.rssStart > 0)
+		printf("rss_start_mb=%.1f rss_end_mb=%.1f growth_mb=%.2f\n", (double) results.rssStart / (1024.0*1024.0), (double) results.rssEnd / (1024.0*1024.0),
+			((double) results.rssEnd - (double) results.rssStart) / (1024.0*1024.0));
+}
+
+static int RunClientsOnly(const Options &options, int numClients, BenchmarkResults *results)
+{
+	BenchPeer *clients = new BenchPeer[numClients];
+	for (int i=0; i < numClients; i++)
+		StartupPeer(&clients[i], options, false);
+	int result=1;
+	if (ConnectClients(clients, numClients, options))
+	{
+		RunLoop(0, clients, numClients, options, results, false);
+		result=0;
+	}
+	for (int i=0; i < numClients; i++)
+		ShutdownPeer(&clients[i]);
+	delete [] clients;
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	Options options;
+	if (ParseOptions(argc, argv, &options)==false)
+	{
+		PrintUsage();
+		return 1;
+	}
+	if (options.loss.packetloss > 0.0f || options.loss.minExtraPing > 0)
+	{
+#ifndef _DEBUG
+		printf("Warning: --loss %s has no effect, RakNet was not compiled with _DEBUG\n", options.loss.name);
+#endif
+	}
+
+	BenchmarkResults results;
+	results.Clear();
+	double measuredSeconds=(double) options.durationSeconds;
+	BenchPeer server;
+	StartupPeer(&server, options, true);
+	for (int i=0; i < options.numReplicas; i++)
+		server.replicaManager->Reference(new BenchReplica(options.replicaSize, true));
+
+	if (options.numProcesses > 0)
+	{
+#if defined(LOOPBACK_BENCHMARK_FORK)
+		DataStructures::List<int> pipes;
+		DataStructures::List<pid_t> children;
+		int clientsLeft=options.numClients;
+		for (int p=0; p < options.numProcesses; p++)
+		{
+			int numClients = clientsLeft / (options.numProcesses-p);
+			clientsLeft-=numClients;
+			int fds[2];
+			if (numClients==0 || pipe(fds)!=0)
+				continue;
+			pid_t pid = fork();
+			if (pid==0)
+			{
+				close(fds[0]);
+				BenchmarkResults childResults;
+				childResults.Clear();
+				int childResult = RunClientsOnly(options, numClients, &childResults);
+				ssize_t written = write(fds[1], &childResults, sizeof(childResults));
+				close(fds[1]);
+				_exit(childResult!=0 || written!=(ssize_t) sizeof(childResults));
+			}
+			close(fds[1]);
+			pipes.Push(fds[0], _FILE_AND_LINE_);
+			children.Push(pid, _FILE_AND_LINE_);
+		}
+
+		// Serve until every worker has written its results
+		int serverConnections=0;
+		BenchmarkResults serverResults;
+		serverResults.Clear();
+		double cpuStart = GetProcessCPUSeconds();
+		RakNet::TimeUS measureStart = RakNet::GetTimeUS() + (RakNet::TimeUS) options.warmupSeconds*1000000;
+		bool measuring=false;
+		for (unsigned i=0; i < children.Size(); i++)
+		{
+			for (;;)
+			{
+				if (measuring==false && RakNet::GetTimeUS() >= measureStart)
+				{
+					// Workers reset their own counters at the same point
+					measuring=true;
+					serverResults.Clear();
+					rpcsReceived=0;
+					cpuStart=GetProcessCPUSeconds();
+				}
+				UpdateServer(&server, options, &serverResults, &serverConnections);
+				if (server.replicaManager)
+				{
+					for (unsigned r=0; r < server.replicaManager->GetReplicaCount(); r++)
+						((BenchReplica*) server.replicaManager->GetReplicaAtIndex(r))->counter++;
+				}
+				int status;
+				if (waitpid(children[i], &status, WNOHANG)==children[i])
+					break;
+				RakSleep(0);
+			}
+			BenchmarkResults childResults;
+			if (read(pipes[i], &childResults, sizeof(childResults))==(ssize_t) sizeof(childResults))
+				results.Merge(childResults);
+			close(pipes[i]);
+		}
+		results.serverMessagesReceived=serverResults.serverMessagesReceived;
+		results.cpuSeconds+=GetProcessCPUSeconds()-cpuStart;
+		results.rpcsReceived=rpcsReceived;
+#else
+		printf("--processes is not supported on this platform\n");
+		ShutdownPeer(&server);
+		return 1;
+#endif
+	}
+	else
+	{
+		BenchPeer *clients = new BenchPeer[options.numClients];
+		for (int i=0; i < options.numClients; i++)
+			StartupPeer(&clients[i], options, false);
+		// Connect while pumping the server so the accepts are processed
+		for (int i=0; i < options.numClients; i++)
+			clients[i].peer->Connect("127.0.0.1", options.serverPort, 0, 0);
+		int serverConnections=0;
+		RakNet::TimeMS timeout = RakNet::GetTimeMS()+10000;
+		BenchmarkResults unused;
+		unused.Clear();
+		int connected=0;
+		while (connected < options.numClients && RakNet::GetTimeMS() < timeout)
+		{
+			UpdateServer(&server, options, &unused, &serverConnections);
+			connected=0;
+			for (int i=0; i < options.numClients; i++)
+			{
+				UpdateClient(&clients[i], &unused, false);
+				if (clients[i].connected)
+					connected++;
+			}
+			RakSleep(1);
+		}
+		if (connected < options.numClients)
+			printf("Only %i of %i clients connected\n", connected, options.numClients);
+		else
+			measuredSeconds=RunLoop(&server, clients, options.numClients, options, &results, true);
+		for (int i=0; i < options.numClients; i++)
+			ShutdownPeer(&clients[i]);
+		delete [] clients;
+	}
+
+	PrintResults(results, options, measuredSeconds);
+	ShutdownPeer(&server);
+	return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file NetworkIDBenchmark.cpp
+/// \brief Create, look up and destroy large numbers of NetworkIDObject with one NetworkIDManager.
+/// \details Times each phase separately: creating objects (ID allocation plus tracking), looking every object up by ID in random order,
+/// replacing a fraction of them, and destroying them all. It then looks objects up from several threads while the main thread keeps
+/// creating and destroying others.<BR>
+/// Build by compiling this file together with the RakNet sources, for example:<BR>
+/// g++ -O2 -I.. NetworkIDBenchmark.cpp ../*.cpp -lpthread -o NetworkIDBenchmark<BR>
+/// Arguments: [objects=1000000] [reader threads=4]
+
+#include "NetworkIDManager.h"
+#include "NetworkIDObject.h"
+#include "RakThread.h"
+#include "RakSleep.h"
+#include "GetTime.h"
+#include "LocklessTypes.h"
+#include "Rand.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace RakNet;
+
+class BenchObject : public NetworkIDObject
+{
+public:
+	int value;
+};
+
+static NetworkIDManager *manager;
+static BenchObject *objects;
+static NetworkID *ids;
+static int numObjects=1000000;
+// Readers only look up the first half, which the churn in the threaded phase never touches
+static volatile bool stopReaders;
+static LocklessUint32_t readersFinished;
+
+struct ReaderResult
+{
+	uint64_t lookups;
+	uint64_t misses;
+};
+
+static double Seconds(RakNet::TimeUS start)
+{
+	return (double) (RakNet::GetTimeUS()-start) / 1000000.0;
+}
+
+static void PrintRate(const char *phase, int count, double seconds)
+{
+	printf("%-24s %9.3f s %12.0f /s\n", phase, seconds, (double) count / seconds);
+}
+
+RAK_THREAD_DECLARATION(ReaderThread)
+{
+	ReaderResult *result = (ReaderResult*) arguments;
+	// Own generator rather than RakNetRandom, which prints its seed
+	uint32_t rnr = (uint32_t) (size_t) arguments | 1;
+	uint64_t lookups=0, misses=0;
+	while (stopReaders==false)
+	{
+		for (int i=0; i < 1000; i++)
+		{
+			rnr ^= rnr << 13;
+			rnr ^= rnr >> 17;
+			rnr ^= rnr << 5;
+			int index = rnr % (numObjects/2);
+			if (manager->GET_OBJECT_FROM_ID<BenchObject*>(ids[index])!=&objects[index])
+				misses++;
+		}
+		lookups+=1000;
+	}
+	result->lookups=lookups;
+	result->misses=misses;
+	readersFinished.Increment();
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int numReaders=4;
+	if (argc > 1)
+		numObjects=atoi(argv[1]);
+	if (argc > 2)
+		numReaders=atoi(argv[2]);
+
+	manager = NetworkIDManager::GetInstance();
+	objects = new BenchObject[numObjects];
+	ids = new NetworkID[numObjects];
+	int *order = new int[numObjects];
+	seedMT(1234);
+	for (int i=0; i < numObjects; i++)
+		order[i]=i;
+	for (int i=numObjects-1; i > 0; i--)
+	{
+		int j = randomMT() % (i+1);
+		int temp=order[i];
+		order[i]=order[j];
+		order[j]=temp;
+	}
+
+	printf("objects=%i\n", numObjects);
+
+	RakNet::TimeUS start = RakNet::GetTimeUS();
+	for (int i=0; i < numObjects; i++)
+	{
+		objects[i].SetNetworkIDManager(manager);
+		ids[i]=objects[i].GetNetworkID();
+	}
+	PrintRate("create", numObjects, Seconds(start));
+
+	start = RakNet::GetTimeUS();
+	int misses=0;
+	for (int i=0; i < numObjects; i++)
+	{
+		if (manager->GET_OBJECT_FROM_ID<BenchObject*>(ids[order[i]])!=&objects[order[i]])
+			misses++;
+	}
+	PrintRate("lookup", numObjects, Seconds(start));
+
+	// Replace a quarter of the objects, the way replicas come and go in a running game
+	start = RakNet::GetTimeUS();
+	int churned=0;
+	for (int i=0; i < numObjects; i++)
+	{
+		if ((order[i] & 3)!=0)
+			continue;
+		objects[order[i]].SetNetworkIDManager(0);
+		objects[order[i]].SetNetworkIDManager(manager);
+		ids[order[i]]=objects[order[i]].GetNetworkID();
+		churned++;
+	}
+	PrintRate("churn (destroy+create)", churned, Seconds(start));
+
+	// Look up from several threads while the second half of the objects keeps being replaced
+	ReaderResult *results = new ReaderResult[numReaders];
+	stopReaders=false;
+	for (int i=0; i < numReaders; i++)
+		RakThread::Create(ReaderThread, &results[i]);
+	start = RakNet::GetTimeUS();
+	churned=0;
+	for (int pass=0; pass < 2; pass++)
+	{
+		for (int i=numObjects/2; i < numObjects; i++)
+		{
+			objects[i].SetNetworkIDManager(0);
+			objects[i].SetNetworkIDManager(manager);
+			churned++;
+		}
+	}
+	stopReaders=true;
+	double threadedSeconds = Seconds(start);
+	while (readersFinished.GetValue()!=(uint32_t) numReaders)
+		RakSleep(1);
+	uint64_t lookups=0;
+	for (int i=0; i < numReaders; i++)
+	{
+		lookups+=results[i].lookups;
+		misses+=(int) results[i].misses;
+	}
+	PrintRate("churn with readers", churned, threadedSeconds);
+	printf("%-24s %9.3f s %12.0f /s (%i threads)\n", "concurrent lookup", threadedSeconds, (double) lookups / threadedSeconds, numReaders);
+
+	start = RakNet::GetTimeUS();
+	for (int i=0; i < numObjects; i++)
+		objects[order[i]].SetNetworkIDManager(0);
+	PrintRate("destroy", numObjects, Seconds(start));
+
+	printf("wrong lookups=%i\n", misses);
+
+	delete [] results;
+	delete [] order;
+	delete [] ids;
+	delete [] objects;
+	NetworkIDManager::DestroyInstance(manager);
+	return misses==0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file RakStringBenchmark.cpp
+/// \brief Multi-threaded RakString copy, assign and concatenate throughput.
+/// \details Each thread repeatedly copies strings out of a shared table, which exercises the reference count from several threads at once,
+/// and builds new strings with operator+, which exercises allocation. Short strings fit in RAKSTRING_INLINE_SIZE and never allocate.
+/// Run with 1 thread and then with several to see how well RakString scales.<BR>
+/// Build by compiling this file together with the RakNet sources, for example:<BR>
+/// g++ -O2 -I.. RakStringBenchmark.cpp ../*.cpp -lpthread -o RakStringBenchmark
+
+#include "RakString.h"
+#include "RakThread.h"
+#include "RakSleep.h"
+#include "GetTime.h"
+#include "LocklessTypes.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace RakNet;
+
+static const int NUM_SHARED_STRINGS=64;
+static RakString sharedStrings[NUM_SHARED_STRINGS];
+static LocklessUint32_t threadsFinished;
+static int iterations=1000000;
+
+struct ThreadResult
+{
+	RakNet::TimeUS elapsed;
+	size_t checksum;
+};
+
+RAK_THREAD_DECLARATION(CopyConcatThread)
+{
+	ThreadResult *result = (ThreadResult*) arguments;
+	RakNet::TimeUS start = RakNet::GetTimeUS();
+	size_t checksum=0;
+	RakString local;
+	for (int i=0; i < iterations; i++)
+	{
+		// Copy and assign: reference counting on the long strings, plain copies for the inline ones
+		RakString copy(sharedStrings[i%NUM_SHARED_STRINGS]);
+		local=sharedStrings[(i*7)%NUM_SHARED_STRINGS];
+		// Concatenate: always produces a new string
+		RakString joined = copy + local;
+		checksum+=joined.GetLength();
+		if ((i&15)==0)
+		{
+			RakString s("id%i", i);
+			checksum+=s.GetLength();
+		}
+	}
+	result->checksum=checksum;
+	result->elapsed=RakNet::GetTimeUS()-start;
+	RakString::FreeMemory();
+	threadsFinished.Increment();
+	return 0;
+}
+
+static double RunThreads(int numThreads)
+{
+	ThreadResult *results = new ThreadResult[numThreads];
+	uint32_t target = threadsFinished.GetValue()+numThreads;
+	RakNet::TimeUS start = RakNet::GetTimeUS();
+	for (int i=0; i < numThreads; i++)
+		RakThread::Create(CopyConcatThread, &results[i]);
+	while (threadsFinished.GetValue()!=target)
+		RakSleep(1);
+	RakNet::TimeUS elapsed = RakNet::GetTimeUS()-start;
+	delete [] results;
+	return (double) numThreads * iterations / ((double) elapsed / 1000000.0);
+}
+
+int main(int argc, char **argv)
+{
+	int maxThreads=8;
+	if (argc > 1)
+		maxThreads=atoi(argv[1]);
+	if (argc > 2)
+		iterations=atoi(argv[2]);
+
+	for (int i=0; i < NUM_SHARED_STRINGS; i++)
+	{
+		if (i&1)
+			sharedStrings[i].Set("short %i", i);
+		else
+			sharedStrings[i].Set("a longer string that does not fit inline, number %i", i);
+	}
+
+	printf("threads  iterations/s  per-thread/s\n");
+	for (int numThreads=1; numThreads <= maxThreads; numThreads*=2)
+	{
+		double perSecond = RunThreads(numThreads);
+		printf("%7i  %12.0f  %12.0f\n", numThreads, perSecond, perSecond/numThreads);
+	}
+
+	for (int i=0; i < NUM_SHARED_STRINGS; i++)
+		sharedStrings[i].Clear();
+	RakString::FreeMemory();
+	return 0;
+}
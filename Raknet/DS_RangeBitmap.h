@@ -0,0 +1,313 @@
+/*
+ *  Copyright (c) 2014, Oculus VR, Inc.
+ *  All rights reserved.
+ *
+ *  This source code is licensed under the BSD-style license found in the
+ *  LICENSE file in the root directory of this source tree. An additional grant
+ *  of patent rights can be found in the PATENTS file in the same directory.
+ *
+ */
+
+/// \file DS_RangeBitmap.h
+/// \internal
+/// \brief A sliding bitmap of sequence numbers, serialized as ranges
+///
+
+
+#ifndef __RANGE_BITMAP_H
+#define __RANGE_BITMAP_H
+
+#include "DS_Queue.h"
+#include "DS_RangeList.h"
+#include "BitStream.h"
+#include "RakMemoryOverride.h"
+#include "RakAssert.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/// Maximum number of 32 bit words a RangeBitmap spans before further indices go to its overflow RangeList
+#ifndef RANGE_BITMAP_MAX_WORDS
+#define RANGE_BITMAP_MAX_WORDS 1024
+#endif
+
+namespace DataStructures
+{
+	/// Index of the lowest set bit. \a word must not be 0
+	inline unsigned int RangeBitmapLowestBit(uint32_t word)
+	{
+		RakAssert(word!=0);
+#if defined(__GNUC__)
+		return (unsigned int) __builtin_ctz(word);
+#elif defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, word);
+		return (unsigned int) index;
+#else
+		unsigned int index=0;
+		while ((word & 1)==0)
+		{
+			word>>=1;
+			index++;
+		}
+		return index;
+#endif
+	}
+
+	/// \brief Same interface and serialized format as RangeList, for indices that mostly arrive close together and in order.
+	/// \details Indices are kept as bits in a queue of 32 bit words covering the span from the lowest to the highest index inserted.
+	/// Insert is O(1) when the index is within or after the span, and ranges are found a word at a time by Serialize.
+	/// Indices wrap at 2^indexBits, and range_type must convert to and from uint32_t. Indices so far away that the span would
+	/// exceed RANGE_BITMAP_MAX_WORDS go to a RangeList instead, so memory stays bounded whatever arrives.
+	template <class range_type, unsigned int indexBits>
+	class RAK_DLL_EXPORT RangeBitmap
+	{
+	public:
+		RangeBitmap();
+		~RangeBitmap();
+		void Insert(range_type index);
+		/// Insert every index from \a minIndex to \a maxIndex inclusive
+		void InsertRange(range_type minIndex, range_type maxIndex);
+		void Clear(void);
+		bool IsEmpty(void) const;
+		RakNet::BitSize_t Serialize(RakNet::BitStream *in, RakNet::BitSize_t maxBits, bool clearSerialized);
+
+	protected:
+		static const uint32_t indexMask = (uint32_t) ((((uint64_t) 1) << indexBits) - 1);
+		static const uint32_t wordIndexMask = indexMask >> 5;
+
+		/// Returns the word for \a wordIndex, growing the span to cover it. Returns 0 if the span would get too large
+		uint32_t *GetWord(uint32_t wordIndex);
+		/// Removes empty words from the start of the span
+		void PopEmptyWords(void);
+
+		/// Bit i of words[j] is index ((firstWordIndex+j)*32+i)
+		DataStructures::Queue<uint32_t> words;
+		uint32_t firstWordIndex;
+
+		RangeList<range_type> overflow;
+	};
+
+	template <class range_type, unsigned int indexBits>
+	RangeBitmap<range_type, indexBits>::RangeBitmap()
+	{
+		// Words must never straddle the wrap, so there must be a whole number of them
+		RakAssert(indexBits>=5 && indexBits<32);
+		firstWordIndex=0;
+	}
+
+	template <class range_type, unsigned int indexBits>
+	RangeBitmap<range_type, indexBits>::~RangeBitmap()
+	{
+		Clear();
+	}
+
+	template <class range_type, unsigned int indexBits>
+	uint32_t *RangeBitmap<range_type, indexBits>::GetWord(uint32_t wordIndex)
+	{
+		if (words.IsEmpty())
+		{
+			firstWordIndex=wordIndex;
+			words.Push(0, _FILE_AND_LINE_);
+			return &words[0];
+		}
+
+		uint32_t offset = (wordIndex-firstWordIndex) & wordIndexMask;
+		if (offset < words.Size())
+			return &words[offset];
+
+		if (offset <= (wordIndexMask>>1))
+		{
+			// After the span
+			if (offset >= RANGE_BITMAP_MAX_WORDS)
+				return 0;
+			while (words.Size() <= offset)
+				words.Push(0, _FILE_AND_LINE_);
+			return &words[offset];
+		}
+
+		// Before the span
+		uint32_t wordsBefore = (firstWordIndex-wordIndex) & wordIndexMask;
+		if (wordsBefore + words.Size() > RANGE_BITMAP_MAX_WORDS)
+			return 0;
+		for (uint32_t i=0; i < wordsBefore; i++)
+			words.PushAtHead(0, 0, _FILE_AND_LINE_);
+		firstWordIndex=wordIndex;
+		return &words[0];
+	}
+
+	template <class range_type, unsigned int indexBits>
+	void RangeBitmap<range_type, indexBits>::Insert(range_type index)
+	{
+		uint32_t i = ((uint32_t) index) & indexMask;
+		uint32_t *word = GetWord(i>>5);
+		if (word)
+			*word |= (uint32_t) 1 << (i&31);
+		else
+			overflow.Insert(index);
+	}
+
+	template <class range_type, unsigned int indexBits>
+	void RangeBitmap<range_type, indexBits>::InsertRange(range_type minIndex, range_type maxIndex)
+	{
+		uint32_t i = ((uint32_t) minIndex) & indexMask;
+		uint32_t count = ((((uint32_t) maxIndex) - i) & indexMask) + 1;
+		while (count > 0)
+		{
+			uint32_t bit = i&31;
+			uint32_t bitsInWord = 32-bit < count ? 32-bit : count;
+			uint32_t mask = bitsInWord==32 ? 0xFFFFFFFF : (((uint32_t) 1 << bitsInWord) - 1) << bit;
+			uint32_t *word = GetWord(i>>5);
+			if (word)
+				*word |= mask;
+			else
+			{
+				for (uint32_t j=0; j < bitsInWord; j++)
+					overflow.Insert(range_type((i+j) & indexMask));
+			}
+			i=(i+bitsInWord) & indexMask;
+			count-=bitsInWord;
+		}
+	}
+
+	template <class range_type, unsigned int indexBits>
+	void RangeBitmap<range_type, indexBits>::Clear(void)
+	{
+		words.Clear(_FILE_AND_LINE_);
+		firstWordIndex=0;
+		overflow.Clear();
+	}
+
+	template <class range_type, unsigned int indexBits>
+	bool RangeBitmap<range_type, indexBits>::IsEmpty(void) const
+	{
+		// PopEmptyWords keeps the first word non-zero, so any word means at least one index
+		return words.IsEmpty() && overflow.Size()==0;
+	}
+
+	template <class range_type, unsigned int indexBits>
+	void RangeBitmap<range_type, indexBits>::PopEmptyWords(void)
+	{
+		while (words.Size() && words.Peek()==0)
+		{
+			words.Pop();
+			firstWordIndex=(firstWordIndex+1) & wordIndexMask;
+		}
+	}
+
+	template <class range_type, unsigned int indexBits>
+	RakNet::BitSize_t RangeBitmap<range_type, indexBits>::Serialize(RakNet::BitStream *in, RakNet::BitSize_t maxBits, bool clearSerialized)
+	{
+		RakNet::BitSize_t bitsWritten;
+		unsigned short countWritten;
+		countWritten=0;
+		bitsWritten=0;
+
+		// Ranges are written straight to the output and the count is filled in at the end, instead of going through a temporary BitStream
+		in->AlignWriteToByteBoundary();
+		RakNet::BitSize_t countOffset=in->GetWriteOffset();
+		in->Write(countWritten);
+
+		// Scan for runs of set bits. A run is ended at the wrap so that minIndex<=maxIndex always holds
+		const unsigned int numWords = words.Size();
+		unsigned int wordOffset=0;
+		uint32_t bitOffset=0;
+		bool full=false;
+		while (wordOffset < numWords && countWritten < (unsigned short)-1)
+		{
+			uint32_t remaining = words[wordOffset] & (0xFFFFFFFF << bitOffset);
+			if (remaining==0)
+			{
+				wordOffset++;
+				bitOffset=0;
+				continue;
+			}
+
+			if ((int)sizeof(unsigned short)*8+bitsWritten+(int)sizeof(range_type)*8*2+1>maxBits)
+			{
+				full=true;
+				break;
+			}
+
+			uint32_t runStartBit = RangeBitmapLowestBit(remaining);
+			uint32_t minIndex = ((firstWordIndex+wordOffset) & wordIndexMask)*32+runStartBit;
+
+			// Find the first clear bit at or after the start of the run
+			unsigned int endWordOffset=wordOffset;
+			uint32_t clearBits = ~words[endWordOffset] & (0xFFFFFFFF << runStartBit);
+			while (clearBits==0)
+			{
+				endWordOffset++;
+				if (endWordOffset==numWords || ((firstWordIndex+endWordOffset) & wordIndexMask)==0)
+					break;
+				clearBits = ~words[endWordOffset];
+			}
+			uint32_t runEndBit = clearBits ? RangeBitmapLowestBit(clearBits) : 0;
+			uint32_t maxIndex = (((firstWordIndex+endWordOffset) & wordIndexMask)*32+runEndBit-1) & indexMask;
+
+			unsigned char minEqualsMax = minIndex==maxIndex ? 1 : 0;
+			in->Write(minEqualsMax); // Use one byte, intead of one bit, for speed, as this is done a lot
+			in->Write(range_type(minIndex));
+			bitsWritten+=sizeof(range_type)*8+8;
+			if (minEqualsMax==0)
+			{
+				in->Write(range_type(maxIndex));
+				bitsWritten+=sizeof(range_type)*8;
+			}
+			countWritten++;
+
+			wordOffset=endWordOffset;
+			bitOffset=runEndBit;
+		}
+
+		unsigned int overflowWritten=0;
+		if (full==false)
+		{
+			for (; overflowWritten < overflow.ranges.Size() && countWritten < (unsigned short)-1; overflowWritten++)
+			{
+				if ((int)sizeof(unsigned short)*8+bitsWritten+(int)sizeof(range_type)*8*2+1>maxBits)
+					break;
+				const RangeNode<range_type> &range = overflow.ranges[overflowWritten];
+				unsigned char minEqualsMax = range.minIndex==range.maxIndex ? 1 : 0;
+				in->Write(minEqualsMax);
+				in->Write(range.minIndex);
+				bitsWritten+=sizeof(range_type)*8+8;
+				if (minEqualsMax==0)
+				{
+					in->Write(range.maxIndex);
+					bitsWritten+=sizeof(range_type)*8;
+				}
+				countWritten++;
+			}
+		}
+
+		RakNet::BitSize_t endOffset=in->GetWriteOffset();
+		in->SetWriteOffset(countOffset);
+		in->Write(countWritten);
+		bitsWritten+=in->GetWriteOffset()-countOffset;
+		in->SetWriteOffset(endOffset);
+
+		if (clearSerialized && countWritten)
+		{
+			// Everything before (wordOffset, bitOffset) was written
+			for (unsigned int i=0; i < wordOffset; i++)
+				words[i]=0;
+			if (wordOffset < numWords && bitOffset > 0)
+				words[wordOffset] &= 0xFFFFFFFF << bitOffset;
+			PopEmptyWords();
+
+			if (overflowWritten)
+			{
+				unsigned rangeSize=overflow.ranges.Size();
+				for (unsigned int i=0; i < rangeSize-overflowWritten; i++)
+					overflow.ranges[i]=overflow.ranges[i+overflowWritten];
+				overflow.ranges.RemoveFromEnd(overflowWritten);
+			}
+		}
+
+		return bitsWritten;
+	}
+}
+
+#endif
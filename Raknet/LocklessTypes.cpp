@@ -32,7 +32,7 @@ uint32_t LocklessUint32_t::Increment(void)
 	mutex.Unlock();
 	return v;
 #else
-	return __sync_fetch_and_add (&value, (uint32_t) 1);
+	return __sync_add_and_fetch (&value, (uint32_t) 1);
 #endif
 }
 uint32_t LocklessUint32_t::Decrement(void)
@@ -47,6 +47,42 @@ uint32_t LocklessUint32_t::Decrement(void)
 	mutex.Unlock();
 	return v;
 #else
-	return __sync_fetch_and_add (&value, (uint32_t) -1);
+	return __sync_sub_and_fetch (&value, (uint32_t) 1);
+#endif
+}
+LocklessUint64_t::LocklessUint64_t()
+{
+	value=0;
+}
+LocklessUint64_t::LocklessUint64_t(uint64_t initial)
+{
+	value=initial;
+}
+uint64_t LocklessUint64_t::Increment(void)
+{
+#ifdef _WIN32
+	return (uint64_t) InterlockedIncrement64(&value);
+#elif defined(ANDROID) || defined(__S3E__) || defined(__APPLE__)
+	uint64_t v;
+	mutex.Lock();
+	++value;
+	v=value;
+	mutex.Unlock();
+	return v;
+#else
+	return __sync_add_and_fetch (&value, (uint64_t) 1);
+#endif
+}
+void RakNet::LocklessMemoryBarrier(void)
+{
+#ifdef _WIN32
+	MemoryBarrier();
+#elif defined(ANDROID) || defined(__S3E__) || defined(__APPLE__)
+	// Locking and unlocking a mutex is a full barrier
+	static SimpleMutex barrierMutex;
+	barrierMutex.Lock();
+	barrierMutex.Unlock();
+#else
+	__sync_synchronize();
 #endif
 }
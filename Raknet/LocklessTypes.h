@@ -45,6 +45,29 @@ protected:
 #endif
 };
 
+class RAK_DLL_EXPORT LocklessUint64_t
+{
+public:
+	LocklessUint64_t();
+	explicit LocklessUint64_t(uint64_t initial);
+	// Returns variable value after changing it
+	uint64_t Increment(void);
+
+protected:
+#ifdef _WIN32
+	volatile LONGLONG value;
+#elif defined(ANDROID) || defined(__S3E__) || defined(__APPLE__)
+	// __sync_fetch_and_add not supported apparently
+	SimpleMutex mutex;
+	uint64_t value;
+#else
+	volatile uint64_t value;
+#endif
+};
+
+/// Full memory barrier. Reads and writes before the call complete before any reads and writes after it
+void RAK_DLL_EXPORT LocklessMemoryBarrier(void);
+
 }
 
 #endif
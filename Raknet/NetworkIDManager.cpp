@@ -24,46 +24,131 @@ using namespace RakNet;
 
 STATIC_FACTORY_DEFINITIONS(NetworkIDManager,NetworkIDManager)
 
-NetworkIDManager::NetworkIDManager()
+NetworkIDManager::NetworkIDManager() : nextNetworkId(RakPeerInterface::Get64BitUniqueRandomNumber())
 {
-	startingOffset = RakPeerInterface::Get64BitUniqueRandomNumber();
-	Clear();
+	for (unsigned int i=0; i < NETWORK_ID_MANAGER_SHARD_COUNT; i++)
+	{
+		shards[i].table=AllocateSlotTable(NETWORK_ID_MANAGER_HASH_LENGTH);
+		shards[i].objectCount=0;
+	}
 }
 NetworkIDManager::~NetworkIDManager(void)
 {
-
+	for (unsigned int i=0; i < NETWORK_ID_MANAGER_SHARD_COUNT; i++)
+	{
+		Shard &shard = shards[i];
+		for (unsigned int j=0; j < shard.retiredTables.Size(); j++)
+			FreeSlotTable(shard.retiredTables[j]);
+		FreeSlotTable(shard.table);
+	}
 }
 void NetworkIDManager::Clear(void)
 {
-	memset(networkIdHash,0,sizeof(networkIdHash));
+	for (unsigned int i=0; i < NETWORK_ID_MANAGER_SHARD_COUNT; i++)
+	{
+		Shard &shard = shards[i];
+		shard.mutex.Lock();
+		shard.generation.Increment();
+		for (unsigned int j=0; j < shard.retiredTables.Size(); j++)
+			FreeSlotTable(shard.retiredTables[j]);
+		shard.retiredTables.Clear(false, _FILE_AND_LINE_);
+		FreeSlotTable(shard.table);
+		shard.table=AllocateSlotTable(NETWORK_ID_MANAGER_HASH_LENGTH);
+		shard.objectCount=0;
+		shard.generation.Increment();
+		shard.mutex.Unlock();
+	}
 }
 NetworkIDObject *NetworkIDManager::GET_BASE_OBJECT_FROM_ID(NetworkID x)
 {
-	unsigned int hashIndex=NetworkIDToHashIndex(x);
-	NetworkIDObject *nio=networkIdHash[hashIndex];
-	while (nio)
+	uint64_t hash = HashNetworkID(x);
+	Shard &shard = shards[hash & (NETWORK_ID_MANAGER_SHARD_COUNT-1)];
+	unsigned int homeSlot = (unsigned int) (hash >> 32);
+	for (;;)
 	{
-		if (nio->GetNetworkID()==x)
+		uint32_t generation = shard.generation.GetValue();
+		if (generation & 1)
+			continue;
+		LocklessMemoryBarrier();
+
+		// The table pointer is read once, so the slots and mask always belong together even if the shard grows meanwhile
+		SlotTable *table = shard.table;
+		NetworkIDObject *nio=0;
+		unsigned int slotIndex = homeSlot & table->slotMask;
+		for (unsigned int probes=0; probes <= table->slotMask; probes++)
+		{
+			const Slot &slot = table->slots[slotIndex];
+			if (slot.object==0)
+				break;
+			if (slot.networkId==x)
+			{
+				nio=slot.object;
+				break;
+			}
+			slotIndex=(slotIndex+1) & table->slotMask;
+		}
+
+		LocklessMemoryBarrier();
+		if (shard.generation.GetValue()==generation)
 			return nio;
-		nio=nio->nextInstanceForNetworkIDManager;
 	}
-	return 0;
 }
 NetworkID NetworkIDManager::GetNewNetworkID(void)
 {
-    while (GET_BASE_OBJECT_FROM_ID(++startingOffset))
-        ;
-	if (startingOffset==UNASSIGNED_NETWORK_ID)
+	for (;;)
+	{
+		// IDs set with NetworkIDObject::SetNetworkID may already use this one
+		NetworkID networkId = nextNetworkId.Increment();
+		if (networkId!=UNASSIGNED_NETWORK_ID && GET_BASE_OBJECT_FROM_ID(networkId)==0)
+			return networkId;
+	}
+}
+uint64_t NetworkIDManager::HashNetworkID(NetworkID networkId)
+{
+	// Authorities hand out consecutive IDs, so mix all the bits before using them to pick a shard and slot
+	uint64_t h = networkId;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+NetworkIDManager::SlotTable *NetworkIDManager::AllocateSlotTable(unsigned int numSlots)
+{
+	RakAssert((numSlots & (numSlots-1))==0);
+	SlotTable *table = RakNet::OP_NEW<SlotTable>(_FILE_AND_LINE_);
+	table->slots = RakNet::OP_NEW_ARRAY<Slot>(numSlots, _FILE_AND_LINE_);
+	table->slotMask = numSlots-1;
+	for (unsigned int i=0; i < numSlots; i++)
 	{
-		while (GET_BASE_OBJECT_FROM_ID(++startingOffset))
-			;
+		table->slots[i].networkId=UNASSIGNED_NETWORK_ID;
+		table->slots[i].object=0;
 	}
-    return startingOffset;
+	return table;
 }
-unsigned int NetworkIDManager::NetworkIDToHashIndex(NetworkID networkId)
+void NetworkIDManager::FreeSlotTable(SlotTable *table)
 {
-//	return SuperFastHash((const char*) &networkId.guid.g,sizeof(networkId.guid.g)) % NETWORK_ID_MANAGER_HASH_LENGTH;
-	return (unsigned int) (networkId % NETWORK_ID_MANAGER_HASH_LENGTH);
+	RakNet::OP_DELETE_ARRAY(table->slots, _FILE_AND_LINE_);
+	RakNet::OP_DELETE(table, _FILE_AND_LINE_);
+}
+void NetworkIDManager::GrowShard(Shard &shard)
+{
+	SlotTable *oldTable = shard.table;
+	SlotTable *newTable = AllocateSlotTable((oldTable->slotMask+1)*2);
+	for (unsigned int i=0; i <= oldTable->slotMask; i++)
+	{
+		const Slot &slot = oldTable->slots[i];
+		if (slot.object==0)
+			continue;
+		unsigned int slotIndex = (unsigned int) (HashNetworkID(slot.networkId) >> 32) & newTable->slotMask;
+		while (newTable->slots[slotIndex].object!=0)
+			slotIndex=(slotIndex+1) & newTable->slotMask;
+		newTable->slots[slotIndex]=slot;
+	}
+	LocklessMemoryBarrier();
+	shard.table=newTable;
+	shard.retiredTables.Push(oldTable, _FILE_AND_LINE_);
 }
 void NetworkIDManager::TrackNetworkIDObject(NetworkIDObject *networkIdObject)
 {
@@ -71,32 +156,31 @@ void NetworkIDManager::TrackNetworkIDObject(NetworkIDObject *networkIdObject)
 	NetworkID rawId = networkIdObject->GetNetworkID();
 	RakAssert(rawId!=UNASSIGNED_NETWORK_ID);
 
-	networkIdObject->nextInstanceForNetworkIDManager=0;
+	uint64_t hash = HashNetworkID(rawId);
+	Shard &shard = shards[hash & (NETWORK_ID_MANAGER_SHARD_COUNT-1)];
+	shard.mutex.Lock();
+	shard.generation.Increment();
 
-	unsigned int hashIndex=NetworkIDToHashIndex(rawId);
-//	printf("TrackNetworkIDObject hashIndex=%i guid=%s\n",hashIndex, networkIdObject->GetNetworkID().guid.ToString()); // removeme
-	if (networkIdHash[hashIndex]==0)
-	{
-		networkIdHash[hashIndex]=networkIdObject;
-		return;
-	}
-	NetworkIDObject *nio=networkIdHash[hashIndex];
-	// Duplicate insertion?
-	RakAssert(nio!=networkIdObject);
-	// Random GUID conflict?
-	RakAssert(nio->GetNetworkID()!=rawId);
-
-	while (nio->nextInstanceForNetworkIDManager!=0)
-	{		
-		nio=nio->nextInstanceForNetworkIDManager;
+	// Keep the table at most half full so probe sequences stay short
+	if ((shard.objectCount+1)*2 > shard.table->slotMask+1)
+		GrowShard(shard);
 
+	SlotTable *table = shard.table;
+	unsigned int slotIndex = (unsigned int) (hash >> 32) & table->slotMask;
+	while (table->slots[slotIndex].object!=0)
+	{
 		// Duplicate insertion?
-		RakAssert(nio!=networkIdObject);
+		RakAssert(table->slots[slotIndex].object!=networkIdObject);
 		// Random GUID conflict?
-		RakAssert(nio->GetNetworkID()!=rawId);
+		RakAssert(table->slots[slotIndex].networkId!=rawId);
+		slotIndex=(slotIndex+1) & table->slotMask;
 	}
+	table->slots[slotIndex].networkId=rawId;
+	table->slots[slotIndex].object=networkIdObject;
+	shard.objectCount++;
 
-	nio->nextInstanceForNetworkIDManager=networkIdObject;
+	shard.generation.Increment();
+	shard.mutex.Unlock();
 }
 void NetworkIDManager::StopTrackingNetworkIDObject(NetworkIDObject *networkIdObject)
 {
@@ -104,30 +188,46 @@ void NetworkIDManager::StopTrackingNetworkIDObject(NetworkIDObject *networkIdObj
 	NetworkID rawId = networkIdObject->GetNetworkID();
 	RakAssert(rawId!=UNASSIGNED_NETWORK_ID);
 
-	// RakAssert(networkIdObject->GetNetworkID()!=UNASSIGNED_NETWORK_ID);
-	unsigned int hashIndex=NetworkIDToHashIndex(rawId);
-//	printf("hashIndex=%i\n",hashIndex); // removeme
-	NetworkIDObject *nio=networkIdHash[hashIndex];
-	if (nio==0)
-	{
-		RakAssert("NetworkIDManager::StopTrackingNetworkIDObject didn't find object" && 0);
-		return;
-	}
-	if (nio==networkIdObject)
+	uint64_t hash = HashNetworkID(rawId);
+	Shard &shard = shards[hash & (NETWORK_ID_MANAGER_SHARD_COUNT-1)];
+	shard.mutex.Lock();
+
+	SlotTable *table = shard.table;
+	unsigned int slotIndex = (unsigned int) (hash >> 32) & table->slotMask;
+	while (table->slots[slotIndex].object!=networkIdObject)
 	{
-		networkIdHash[hashIndex]=nio->nextInstanceForNetworkIDManager;
-		return;
+		if (table->slots[slotIndex].object==0)
+		{
+			shard.mutex.Unlock();
+			RakAssert("NetworkIDManager::StopTrackingNetworkIDObject didn't find object" && 0);
+			return;
+		}
+		slotIndex=(slotIndex+1) & table->slotMask;
 	}
 
-	while (nio)
+	shard.generation.Increment();
+
+	// Shift later entries of the probe sequence back into the hole, so lookups never need tombstones
+	unsigned int holeIndex = slotIndex;
+	unsigned int nextIndex = slotIndex;
+	for (;;)
 	{
-		if (nio->nextInstanceForNetworkIDManager==networkIdObject)
+		nextIndex=(nextIndex+1) & table->slotMask;
+		const Slot &next = table->slots[nextIndex];
+		if (next.object==0)
+			break;
+		unsigned int homeIndex = (unsigned int) (HashNetworkID(next.networkId) >> 32) & table->slotMask;
+		// Move next into the hole unless its home slot lies cyclically in (holeIndex, nextIndex]
+		if (((nextIndex - homeIndex) & table->slotMask) >= ((nextIndex - holeIndex) & table->slotMask))
 		{
-			nio->nextInstanceForNetworkIDManager=networkIdObject->nextInstanceForNetworkIDManager;
-			return;
+			table->slots[holeIndex]=next;
+			holeIndex=nextIndex;
 		}
-		nio=nio->nextInstanceForNetworkIDManager;
 	}
+	table->slots[holeIndex].networkId=UNASSIGNED_NETWORK_ID;
+	table->slots[holeIndex].object=0;
+	shard.objectCount--;
 
-	RakAssert("NetworkIDManager::StopTrackingNetworkIDObject didn't find object" && 0);
+	shard.generation.Increment();
+	shard.mutex.Unlock();
 }
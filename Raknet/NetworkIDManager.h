@@ -20,18 +20,32 @@
 #include "RakMemoryOverride.h"
 #include "NetworkIDObject.h"
 #include "Rand.h"
+#include "SimpleMutex.h"
+#include "LocklessTypes.h"
+#include "DS_List.h"
 
 namespace RakNet
 {
 
-/// Increase this value if you plan to have many persistent objects
-/// This value must match on all systems
-#define NETWORK_ID_MANAGER_HASH_LENGTH 1024
+/// Initial number of slots in each shard of the lookup table. Shards double in size when more than half full, so this only needs
+/// increasing to avoid the first few resizes. Must be a power of two
+#ifndef NETWORK_ID_MANAGER_HASH_LENGTH
+#define NETWORK_ID_MANAGER_HASH_LENGTH 64
+#endif
+
+/// Number of independently locked parts of the lookup table. Objects are tracked and untracked under the lock of one shard,
+/// so more shards lets more threads do that at once. Must be a power of two
+#ifndef NETWORK_ID_MANAGER_SHARD_COUNT
+#define NETWORK_ID_MANAGER_SHARD_COUNT 16
+#endif
 
 /// This class is simply used to generate a unique number for a group of instances of NetworkIDObject
 /// An instance of this class is required to use the ObjectID to pointer lookup system
 /// You should have one instance of this class per game instance.
 /// Call SetIsNetworkIDAuthority before using any functions of this class, or of NetworkIDObject
+/// \details Objects are kept in an open addressing hash table split into NETWORK_ID_MANAGER_SHARD_COUNT shards, so lookups are O(1) however many objects there are.
+/// GET_OBJECT_FROM_ID takes no locks and may be called from any number of threads, including while other threads track and untrack objects.
+/// New IDs are allocated with an atomic increment.
 class RAK_DLL_EXPORT NetworkIDManager
 {
 public:
@@ -55,6 +69,7 @@ public:
 	}
 
 	// Stop tracking all NetworkID objects
+	/// \pre No other thread is using this NetworkIDManager
 	void Clear(void);
 
 	/// \internal
@@ -67,9 +82,37 @@ protected:
 
 	friend class NetworkIDObject;
 
-	NetworkIDObject *networkIdHash[NETWORK_ID_MANAGER_HASH_LENGTH];
-	unsigned int NetworkIDToHashIndex(NetworkID networkId);
-	uint64_t startingOffset;
+	struct Slot
+	{
+		NetworkID networkId;
+		// 0 if the slot is empty
+		NetworkIDObject *object;
+	};
+	struct SlotTable
+	{
+		Slot *slots;
+		unsigned int slotMask;
+	};
+	struct Shard
+	{
+		SlotTable * volatile table;
+		unsigned int objectCount;
+		/// Odd while the table is being changed. Readers retry if it was odd, or changed while they were looking
+		LocklessUint32_t generation;
+		/// Held by threads tracking or untracking objects in this shard
+		SimpleMutex mutex;
+		/// Tables replaced by larger ones. A reader may still be looking in one, so they are not freed until Clear() or the destructor
+		DataStructures::List<SlotTable*> retiredTables;
+	};
+
+	static uint64_t HashNetworkID(NetworkID networkId);
+	static SlotTable *AllocateSlotTable(unsigned int numSlots);
+	static void FreeSlotTable(SlotTable *table);
+	/// \pre shard.mutex is held and the generation is odd
+	void GrowShard(Shard &shard);
+
+	Shard shards[NETWORK_ID_MANAGER_SHARD_COUNT];
+	LocklessUint64_t nextNetworkId;
 	/// \internal
 	NetworkID GetNewNetworkID(void);
 
@@ -24,7 +24,6 @@ NetworkIDObject::NetworkIDObject()
 	networkID=UNASSIGNED_NETWORK_ID;
 	parent=0;
 	networkIDManager=0;
-	nextInstanceForNetworkIDManager=0;
 }
 NetworkIDObject::~NetworkIDObject()
 {
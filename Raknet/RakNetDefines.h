@@ -66,6 +66,17 @@
 #define BITSTREAM_STACK_ALLOCATION_SIZE 256
 #endif
 
+/// Strings up to this many bytes, including the terminator, are stored inside RakString itself instead of in a reference counted allocation
+#ifndef RAKSTRING_INLINE_SIZE
+#define RAKSTRING_INLINE_SIZE 24
+#endif
+
+/// Number of released RakString allocations each thread keeps for reuse, the rest go to RakString::freeList, shared by all threads.
+/// A thread that exits leaves at most this many behind. Set to 0 to always use the shared list
+#ifndef RAKSTRING_THREAD_CACHE_SIZE
+#define RAKSTRING_THREAD_CACHE_SIZE 16
+#endif
+
 // Redefine if you want to disable or change the target for debug RAKNET_DEBUG_PRINTF
 #ifndef RAKNET_DEBUG_PRINTF
 #define RAKNET_DEBUG_PRINTF printf
@@ -16,16 +16,25 @@
 #include <string.h>
 #include "LinuxStrings.h"
 #include "StringCompressor.h"
-#include "SimpleMutex.h"
 #include <stdlib.h>
 #include "Itoa.h"
+#include "SimpleMutex.h"
 
 using namespace RakNet;
 
-//DataStructures::MemoryPool<RakString::SharedString> RakString::pool;
-RakString::SharedString RakString::emptyString={0,0,0,(char*) "",(char*) ""};
-//RakString::SharedString *RakString::sharedStringFreeList=0;
-//unsigned int RakString::sharedStringFreeListAllocationCount=0;
+#ifndef RAKSTRING_THREAD_LOCAL
+#if defined(_MSC_VER)
+#define RAKSTRING_THREAD_LOCAL __declspec(thread)
+#else
+#define RAKSTRING_THREAD_LOCAL __thread
+#endif
+#endif
+
+// Released SharedString allocations are cached per thread, linked through SharedString::nextFree
+// Once a cache is full they go to RakString::freeList, so a thread that exits leaves little behind
+static RAKSTRING_THREAD_LOCAL RakString::SharedString *threadFreeList=0;
+static RAKSTRING_THREAD_LOCAL unsigned int threadFreeListSize=0;
+
 DataStructures::List<RakString::SharedString*> RakString::freeList;
 
 class RakStringCleanup
@@ -45,6 +54,15 @@ SimpleMutex& GetPoolMutex(void)
 	return poolMutex;
 }
 
+void RakString::LockMutex(void)
+{
+	GetPoolMutex().Lock();
+}
+void RakString::UnlockMutex(void)
+{
+	GetPoolMutex().Unlock();
+}
+
 int RakNet::RakString::RakStringComp( RakString const &key, RakString const &data )
 {
 	return key.StrCmp(data);
@@ -52,7 +70,8 @@ int RakNet::RakString::RakStringComp( RakString const &key, RakString const &dat
 
 RakString::RakString()
 {
-	sharedString=&emptyString;
+	sharedString=0;
+	inlineString[0]=0;
 }
 RakString::RakString( RakString::SharedString *_sharedString )
 {
@@ -84,23 +103,11 @@ RakString::RakString(const char *format, ...){
 }
 RakString::RakString( const RakString & rhs)
 {
-	if (rhs.sharedString==&emptyString)
-	{
-		sharedString=&emptyString;
-		return;
-	}
-
-	rhs.sharedString->refCountMutex->Lock();
-	if (rhs.sharedString->refCount==0)
-	{
-		sharedString=&emptyString;
-	}
+	sharedString=rhs.sharedString;
+	if (sharedString)
+		sharedString->refCount.Increment();
 	else
-	{
-		rhs.sharedString->refCount++;
-		sharedString=rhs.sharedString;
-	}
-	rhs.sharedString->refCountMutex->Unlock();
+		memcpy(inlineString, rhs.inlineString, sizeof(inlineString));
 }
 RakString::~RakString()
 {
@@ -108,27 +115,24 @@ RakString::~RakString()
 }
 RakString& RakString::operator = ( const RakString& rhs )
 {
-	Free();
-	if (rhs.sharedString==&emptyString)
+	if (&rhs==this)
 		return *this;
-
-	rhs.sharedString->refCountMutex->Lock();
-	if (rhs.sharedString->refCount==0)
-	{
-		sharedString=&emptyString;
-	}
+	Free();
+	sharedString=rhs.sharedString;
+	if (sharedString)
+		sharedString->refCount.Increment();
 	else
-	{
-		sharedString=rhs.sharedString;
-		sharedString->refCount++;
-	}
-	rhs.sharedString->refCountMutex->Unlock();
+		memcpy(inlineString, rhs.inlineString, sizeof(inlineString));
 	return *this;
 }
 RakString& RakString::operator = ( const char *str )
 {
-	Free();
+	// str may point into our own buffer, so release it only after copying
+	SharedString *oldSharedString=sharedString;
+	sharedString=0;
 	Assign(str);
+	if (oldSharedString)
+		ReleaseSharedString(oldSharedString);
 	return *this;
 }
 RakString& RakString::operator = ( char *str )
@@ -150,15 +154,28 @@ RakString& RakString::operator = ( const char c )
 	buff[1]=0;
 	return operator = ((const char*)buff);
 }
-void RakString::Realloc(SharedString *sharedString, size_t bytes)
+void RakString::Realloc(size_t bytes)
 {
+	if (sharedString==0)
+	{
+		if (bytes<=sizeof(inlineString))
+			return;
+
+		// Move out of inline storage
+		char oldInlineString[sizeof(inlineString)];
+		memcpy(oldInlineString, inlineString, sizeof(inlineString));
+		Allocate(bytes);
+		memcpy(sharedString->c_str, oldInlineString, sizeof(oldInlineString));
+		return;
+	}
+
 	if (bytes<=sharedString->bytesUsed)
 		return;
 
 	RakAssert(bytes>0);
 	size_t oldBytes = sharedString->bytesUsed;
 	size_t newBytes;
-	const size_t smallStringSize = 128-sizeof(unsigned int)-sizeof(size_t)-sizeof(char*)*2;
+	const size_t smallStringSize = sizeof(sharedString->smallString);
 	newBytes = GetSizeToAllocate(bytes);
 	if (oldBytes <=(size_t) smallStringSize && newBytes > (size_t) smallStringSize)
 	{
@@ -186,8 +203,8 @@ RakString& RakString::operator +=( const RakString& rhs)
 	{
 		Clone();
 		size_t strLen=rhs.GetLength()+GetLength()+1;
-		Realloc(sharedString, strLen+GetLength());
-		strcat(sharedString->c_str,rhs.C_String());
+		Realloc(strLen);
+		strcat(GetBuffer(),rhs.C_String());
 	}
 	return *this;
 }
@@ -204,8 +221,8 @@ RakString& RakString::operator +=( const char *str )
 	{
 		Clone();
 		size_t strLen=strlen(str)+GetLength()+1;
-		Realloc(sharedString, strLen);
-		strcat(sharedString->c_str,str);
+		Realloc(strLen);
+		strcat(GetBuffer(),str);
 	}
 	return *this;
 }
@@ -231,145 +248,74 @@ RakString& RakString::operator +=( const char c )
 unsigned char RakString::operator[] ( const unsigned int position ) const
 {
 	RakAssert(position<GetLength());
-	return sharedString->c_str[position];
+	return GetBuffer()[position];
 }
 bool RakString::operator==(const RakString &rhs) const
 {
-	return strcmp(sharedString->c_str,rhs.sharedString->c_str)==0;
+	return strcmp(GetBuffer(),rhs.GetBuffer())==0;
 }
 bool RakString::operator==(const char *str) const
 {
-	return strcmp(sharedString->c_str,str)==0;
+	return strcmp(GetBuffer(),str)==0;
 }
 bool RakString::operator==(char *str) const
 {
-	return strcmp(sharedString->c_str,str)==0;
+	return strcmp(GetBuffer(),str)==0;
 }
 bool RakString::operator < ( const RakString& right ) const
 {
-	return strcmp(sharedString->c_str,right.C_String()) < 0;
+	return strcmp(GetBuffer(),right.C_String()) < 0;
 }
 bool RakString::operator <= ( const RakString& right ) const
 {
-	return strcmp(sharedString->c_str,right.C_String()) <= 0;
+	return strcmp(GetBuffer(),right.C_String()) <= 0;
 }
 bool RakString::operator > ( const RakString& right ) const
 {
-	return strcmp(sharedString->c_str,right.C_String()) > 0;
+	return strcmp(GetBuffer(),right.C_String()) > 0;
 }
 bool RakString::operator >= ( const RakString& right ) const
 {
-	return strcmp(sharedString->c_str,right.C_String()) >= 0;
+	return strcmp(GetBuffer(),right.C_String()) >= 0;
 }
 bool RakString::operator!=(const RakString &rhs) const
 {
-	return strcmp(sharedString->c_str,rhs.sharedString->c_str)!=0;
+	return strcmp(GetBuffer(),rhs.GetBuffer())!=0;
 }
 bool RakString::operator!=(const char *str) const
 {
-	return strcmp(sharedString->c_str,str)!=0;
+	return strcmp(GetBuffer(),str)!=0;
 }
 bool RakString::operator!=(char *str) const
 {
-	return strcmp(sharedString->c_str,str)!=0;
+	return strcmp(GetBuffer(),str)!=0;
 }
 const RakNet::RakString operator+(const RakNet::RakString &lhs, const RakNet::RakString &rhs)
 {
-	if (lhs.IsEmpty() && rhs.IsEmpty())
-	{
-		return RakString(&RakString::emptyString);
-	}
-	if (lhs.IsEmpty())
-	{
-		rhs.sharedString->refCountMutex->Lock();
-		if (rhs.sharedString->refCount==0)
-		{
-			rhs.sharedString->refCountMutex->Unlock();
-			lhs.sharedString->refCountMutex->Lock();
-			lhs.sharedString->refCount++;
-			lhs.sharedString->refCountMutex->Unlock();
-			return RakString(lhs.sharedString);
-		}
-		else
-		{
-			rhs.sharedString->refCount++;
-			rhs.sharedString->refCountMutex->Unlock();
-			return RakString(rhs.sharedString);
-		}
-		// rhs.sharedString->refCountMutex->Unlock();
-	}
-	if (rhs.IsEmpty())
-	{
-		lhs.sharedString->refCountMutex->Lock();
-		lhs.sharedString->refCount++;
-		lhs.sharedString->refCountMutex->Unlock();
-		return RakString(lhs.sharedString);
-	}
-
-	size_t len1 = lhs.GetLength();
-	size_t len2 = rhs.GetLength();
-	size_t allocatedBytes = len1 + len2 + 1;
-	allocatedBytes = RakString::GetSizeToAllocate(allocatedBytes);
-	RakString::SharedString *sharedString;
-
-	RakString::LockMutex();
-	// sharedString = RakString::pool.Allocate( _FILE_AND_LINE_ );
-	if (RakString::freeList.Size()==0)
-	{
-		//RakString::sharedStringFreeList=(RakString::SharedString*) rakRealloc_Ex(RakString::sharedStringFreeList,(RakString::sharedStringFreeListAllocationCount+1024)*sizeof(RakString::SharedString), _FILE_AND_LINE_);
-		unsigned i;
-		for (i=0; i < 128; i++)
-		{
-		//	RakString::freeList.Insert(RakString::sharedStringFreeList+i+RakString::sharedStringFreeListAllocationCount);
-			RakString::SharedString *ss;
-			ss = (RakString::SharedString*) rakMalloc_Ex(sizeof(RakString::SharedString), _FILE_AND_LINE_);
-			ss->refCountMutex=RakNet::OP_NEW<SimpleMutex>(_FILE_AND_LINE_);
-			RakString::freeList.Insert(ss, _FILE_AND_LINE_);
-
-		}
-		//RakString::sharedStringFreeListAllocationCount+=1024;
-	}
-	sharedString = RakString::freeList[RakString::freeList.Size()-1];
-	RakString::freeList.RemoveAtIndex(RakString::freeList.Size()-1);
-	RakString::UnlockMutex();
-
-	const int smallStringSize = 128-sizeof(unsigned int)-sizeof(size_t)-sizeof(char*)*2;
-	sharedString->bytesUsed=allocatedBytes;
-	sharedString->refCount=1;
-	if (allocatedBytes <= (size_t) smallStringSize)
-	{
-		sharedString->c_str=sharedString->smallString;
-	}
-	else
-	{
-		sharedString->bigString=(char*)rakMalloc_Ex(sharedString->bytesUsed, _FILE_AND_LINE_);
-		sharedString->c_str=sharedString->bigString;
-	}
-
-	strcpy(sharedString->c_str, lhs);
-	strcat(sharedString->c_str, rhs);
-
-	return RakString(sharedString);
+	// Shares lhs if rhs is empty, otherwise clones it once and appends
+	RakNet::RakString result(lhs);
+	result+=rhs;
+	return result;
 }
 const char * RakString::ToLower(void)
 {
 	Clone();
 
-	size_t strLen = strlen(sharedString->c_str);
+	size_t strLen = strlen(GetBuffer());
 	unsigned i;
 	for (i=0; i < strLen; i++)
-		sharedString->c_str[i]=ToLower(sharedString->c_str[i]);
-	return sharedString->c_str;
+		GetBuffer()[i]=ToLower(GetBuffer()[i]);
+	return GetBuffer();
 }
 const char * RakString::ToUpper(void)
 {
 	Clone();
 
-	size_t strLen = strlen(sharedString->c_str);
+	size_t strLen = strlen(GetBuffer());
 	unsigned i;
 	for (i=0; i < strLen; i++)
-		sharedString->c_str[i]=ToUpper(sharedString->c_str[i]);
-	return sharedString->c_str;
+		GetBuffer()[i]=ToUpper(GetBuffer()[i]);
+	return GetBuffer();
 }
 void RakString::Set(const char *format, ...)
 {
@@ -380,11 +326,11 @@ void RakString::Set(const char *format, ...)
 }
 bool RakString::IsEmpty(void) const
 {
-	return sharedString==&emptyString;
+	return GetBuffer()[0]==0;
 }
 size_t RakString::GetLength(void) const
 {
-	return strlen(sharedString->c_str);
+	return strlen(GetBuffer());
 }
 // http://porg.es/blog/counting-characters-in-utf-8-strings-is-faster
 int porges_strlen2(char *s)
@@ -417,7 +363,7 @@ ascii:  i++;
 }
 size_t RakString::GetLengthUTF8(void) const
 {
-	return porges_strlen2(sharedString->c_str);
+	return porges_strlen2(GetBuffer());
 }
 void RakString::Replace(unsigned index, unsigned count, unsigned char c)
 {
@@ -426,7 +372,7 @@ void RakString::Replace(unsigned index, unsigned count, unsigned char c)
 	unsigned countIndex=0;
 	while (countIndex<count)
 	{
-		sharedString->c_str[index]=c;
+		GetBuffer()[index]=c;
 		index++;
 		countIndex++;
 	}
@@ -436,7 +382,7 @@ void RakString::SetChar( unsigned index, unsigned char c )
 {
 	RakAssert(index < GetLength());
 	Clone();
-	sharedString->c_str[index]=c;
+	GetBuffer()[index]=c;
 }
 void RakString::SetChar( unsigned index, RakNet::RakString s )
 {
@@ -455,7 +401,7 @@ WCHAR * RakString::ToWideChar(void)
 	//
 	// Special case of NULL or empty input string
 	//
-	if ( (sharedString->c_str == NULL) || (*sharedString->c_str == '\0') )
+	if ( (GetBuffer() == NULL) || (*GetBuffer() == '\0') )
 	{
 		// Return empty string
 		return L"";
@@ -467,7 +413,7 @@ WCHAR * RakString::ToWideChar(void)
 	int cchUTF16 = ::MultiByteToWideChar(
 		CP_UTF8,                // convert from UTF-8
 		0,						// Flags
-		sharedString->c_str,            // source UTF-8 string
+		GetBuffer(),            // source UTF-8 string
 		GetLength()+1,                 // total length of source UTF-8 string,
 		// in CHAR's (= bytes), including end-of-string \0
 		NULL,                   // unused - no conversion done in this step
@@ -491,7 +437,7 @@ WCHAR * RakString::ToWideChar(void)
 	int result = ::MultiByteToWideChar(
 		CP_UTF8,                // convert from UTF-8
 		0,						// Buffer
-		sharedString->c_str,            // source UTF-8 string
+		GetBuffer(),            // source UTF-8 string
 		GetLength()+1,                 // total length of source UTF-8 string,
 		// in CHAR's (= bytes), including end-of-string \0
 		pszUTF16,               // destination buffer
@@ -523,7 +469,7 @@ void RakString::FromWideChar(const wchar_t *source)
 
                           source,         // Source Unicode string
                           -1,                    // -1 means string is zero-terminated
-                          sharedString->c_str,          // Destination char string
+                          GetBuffer(),          // Destination char string
                           bufSize,  // Size of buffer
                           NULL,                  // No default character
                           NULL );                // Don't care about this flag
@@ -550,7 +496,7 @@ size_t RakString::Find(const char *stringToFind,size_t pos)
 
 	for (size_t i=pos;i<len;i++)
 	{
-		if (stringToFind[matchPos]==sharedString->c_str[i])
+		if (stringToFind[matchPos]==GetBuffer()[i])
 		{
 			if(matchPos==0)
 			{
@@ -577,20 +523,20 @@ void RakString::TruncateUTF8(unsigned int length)
 	int i = 0;
 	unsigned int count = 0;
 
-	while (sharedString->c_str[i]!=0)
+	while (GetBuffer()[i]!=0)
 	{
 		if (count==length)
 		{
-			sharedString->c_str[i]=0;
+			GetBuffer()[i]=0;
 			return;
 		}
-		else if (sharedString->c_str[i]>0)
+		else if (GetBuffer()[i]>0)
 		{
 			i++;
 		}
 		else
 		{
-			switch (0xF0 & sharedString->c_str[i])
+			switch (0xF0 & GetBuffer()[i])
 			{
 			case 0xE0: i += 3; break;
 			case 0xF0: i += 4; break;
@@ -622,8 +568,8 @@ RakString RakString::SubStr(unsigned int index, unsigned int count) const
 	copy.Allocate(numBytes+1);
 	size_t i;
 	for (i=0; i < numBytes; i++)
-		copy.sharedString->c_str[i]=sharedString->c_str[index+i];
-	copy.sharedString->c_str[i]=0;
+		copy.GetBuffer()[i]=GetBuffer()[index+i];
+	copy.GetBuffer()[i]=0;
 	return copy;
 }
 void RakString::Erase(unsigned int index, unsigned int count)
@@ -635,19 +581,19 @@ void RakString::Erase(unsigned int index, unsigned int count)
 	unsigned i;
 	for (i=index; i < len-count; i++)
 	{
-		sharedString->c_str[i]=sharedString->c_str[i+count];
+		GetBuffer()[i]=GetBuffer()[i+count];
 	}
-	sharedString->c_str[i]=0;
+	GetBuffer()[i]=0;
 }
 void RakString::TerminateAtLastCharacter(char c)
 {
 	int i, len=(int) GetLength();
 	for (i=len-1; i >= 0; i--)
 	{
-		if (sharedString->c_str[i]==c)
+		if (GetBuffer()[i]==c)
 		{
 			Clone();
-			sharedString->c_str[i]=0;
+			GetBuffer()[i]=0;
 			return;
 		}
 	}
@@ -657,7 +603,7 @@ void RakString::StartAfterLastCharacter(char c)
 	int i, len=(int) GetLength();
 	for (i=len-1; i >= 0; i--)
 	{
-		if (sharedString->c_str[i]==c)
+		if (GetBuffer()[i]==c)
 		{
 			++i;
 			if (i < len)
@@ -673,12 +619,12 @@ void RakString::TerminateAtFirstCharacter(char c)
 	unsigned int i, len=(unsigned int) GetLength();
 	for (i=0; i < len; i++)
 	{
-		if (sharedString->c_str[i]==c)
+		if (GetBuffer()[i]==c)
 		{
 			if (i > 0)
 			{
 				Clone();
-				sharedString->c_str[i]=0;
+				GetBuffer()[i]=0;
 			}
 		}
 	}
@@ -688,7 +634,7 @@ void RakString::StartAfterFirstCharacter(char c)
 	unsigned int i, len=(unsigned int) GetLength();
 	for (i=0; i < len; i++)
 	{
-		if (sharedString->c_str[i]==c)
+		if (GetBuffer()[i]==c)
 		{
 			++i;
 			if (i < len)
@@ -705,7 +651,7 @@ int RakString::GetCharacterCount(char c)
 	unsigned int i, len=(unsigned int) GetLength();
 	for (i=0; i < len; i++)
 	{
-		if (sharedString->c_str[i]==c)
+		if (GetBuffer()[i]==c)
 		{
 			++count;
 		}
@@ -718,36 +664,36 @@ void RakString::RemoveCharacter(char c)
 		return;
 
 	unsigned int readIndex, writeIndex=0;
-	for (readIndex=0; sharedString->c_str[readIndex]; readIndex++)
+	for (readIndex=0; GetBuffer()[readIndex]; readIndex++)
 	{
-		if (sharedString->c_str[readIndex]!=c)
-			sharedString->c_str[writeIndex++]=sharedString->c_str[readIndex];
+		if (GetBuffer()[readIndex]!=c)
+			GetBuffer()[writeIndex++]=GetBuffer()[readIndex];
 		else
 			Clone();
 	}
-	sharedString->c_str[writeIndex]=0;
+	GetBuffer()[writeIndex]=0;
 	if (writeIndex==0)
 		Clear();
 }
 int RakString::StrCmp(const RakString &rhs) const
 {
-	return strcmp(sharedString->c_str, rhs.C_String());
+	return strcmp(GetBuffer(), rhs.C_String());
 }
 int RakString::StrNCmp(const RakString &rhs, size_t num) const
 {
-	return strncmp(sharedString->c_str, rhs.C_String(), num);
+	return strncmp(GetBuffer(), rhs.C_String(), num);
 }
 int RakString::StrICmp(const RakString &rhs) const
 {
-	return _stricmp(sharedString->c_str, rhs.C_String());
+	return _stricmp(GetBuffer(), rhs.C_String());
 }
 void RakString::Printf(void)
 {
-	RAKNET_DEBUG_PRINTF("%s", sharedString->c_str);
+	RAKNET_DEBUG_PRINTF("%s", GetBuffer());
 }
 void RakString::FPrintf(FILE *fp)
 {
-	fprintf(fp,"%s", sharedString->c_str);
+	fprintf(fp,"%s", GetBuffer());
 }
 bool RakString::IPAddressMatch(const char *IP)
 {
@@ -763,7 +709,7 @@ bool RakString::IPAddressMatch(const char *IP)
 #endif
 	while ( true )
 	{
-		if (sharedString->c_str[ characterIndex ] == IP[ characterIndex ] )
+		if (GetBuffer()[ characterIndex ] == IP[ characterIndex ] )
 		{
 			// Equal characters
 			if ( IP[ characterIndex ] == 0 )
@@ -778,14 +724,14 @@ bool RakString::IPAddressMatch(const char *IP)
 
 		else
 		{
-			if ( sharedString->c_str[ characterIndex ] == 0 || IP[ characterIndex ] == 0 )
+			if ( GetBuffer()[ characterIndex ] == 0 || IP[ characterIndex ] == 0 )
 			{
 				// End of one of the strings
 				break;
 			}
 
 			// Characters do not match
-			if ( sharedString->c_str[ characterIndex ] == '*' )
+			if ( GetBuffer()[ characterIndex ] == '*' )
 			{
 				// Domain is banned.
 				return true;
@@ -802,11 +748,11 @@ bool RakString::IPAddressMatch(const char *IP)
 }
 bool RakString::ContainsNonprintableExceptSpaces(void) const
 {
-	size_t strLen = strlen(sharedString->c_str);
+	size_t strLen = strlen(GetBuffer());
 	unsigned i;
 	for (i=0; i < strLen; i++)
 	{
-		if (sharedString->c_str[i] < ' ' || sharedString->c_str[i] >126)
+		if (GetBuffer()[i] < ' ' || GetBuffer()[i] >126)
 			return true;
 	}
 	return false;
@@ -815,22 +761,22 @@ bool RakString::IsEmailAddress(void) const
 {
 	if (IsEmpty())
 		return false;
-	size_t strLen = strlen(sharedString->c_str);
+	size_t strLen = strlen(GetBuffer());
 	if (strLen < 6) // a@b.de
 		return false;
-	if (sharedString->c_str[strLen-4]!='.' && sharedString->c_str[strLen-3]!='.') // .com, .net., .org, .de
+	if (GetBuffer()[strLen-4]!='.' && GetBuffer()[strLen-3]!='.') // .com, .net., .org, .de
 		return false;
 	unsigned i;
 	// Has non-printable?
 	for (i=0; i < strLen; i++)
 	{
-		if (sharedString->c_str[i] <= ' ' || sharedString->c_str[i] >126)
+		if (GetBuffer()[i] <= ' ' || GetBuffer()[i] >126)
 			return false;
 	}
 	int atCount=0;
 	for (i=0; i < strLen; i++)
 	{
-		if (sharedString->c_str[i]=='@')
+		if (GetBuffer()[i]=='@')
 		{
 			atCount++;
 		}
@@ -840,7 +786,7 @@ bool RakString::IsEmailAddress(void) const
 	int dotCount=0;
 	for (i=0; i < strLen; i++)
 	{
-		if (sharedString->c_str[i]=='.')
+		if (GetBuffer()[i]=='.')
 		{
 			dotCount++;
 		}
@@ -854,15 +800,15 @@ bool RakString::IsEmailAddress(void) const
 RakNet::RakString& RakString::URLEncode(void)
 {
 	RakString result;
-	size_t strLen = strlen(sharedString->c_str);
+	size_t strLen = strlen(GetBuffer());
 	result.Allocate(strLen*3);
-	char *output=result.sharedString->c_str;
+	char *output=result.GetBuffer();
 	unsigned int outputIndex=0;
 	unsigned i;
 	unsigned char c;
 	for (i=0; i < strLen; i++)
 	{
-		c=sharedString->c_str[i];
+		c=GetBuffer()[i];
 		if (
 			(c<=47) ||
 			(c>=58 && c<=64) ||
@@ -890,9 +836,9 @@ RakNet::RakString& RakString::URLEncode(void)
 RakNet::RakString& RakString::URLDecode(void)
 {
 	RakString result;
-	size_t strLen = strlen(sharedString->c_str);
+	size_t strLen = strlen(GetBuffer());
 	result.Allocate(strLen);
-	char *output=result.sharedString->c_str;
+	char *output=result.GetBuffer();
 	unsigned int outputIndex=0;
 	char c;
 	char hexDigits[2];
@@ -900,11 +846,11 @@ RakNet::RakString& RakString::URLDecode(void)
 	unsigned int i;
 	for (i=0; i < strLen; i++)
 	{
-		c=sharedString->c_str[i];
+		c=GetBuffer()[i];
 		if (c=='%')
 		{
-			hexDigits[0]=sharedString->c_str[++i];
-			hexDigits[1]=sharedString->c_str[++i];
+			hexDigits[0]=GetBuffer()[++i];
+			hexDigits[1]=GetBuffer()[++i];
 			
 			if (hexDigits[0]==' ')
 				hexValues[0]=0;
@@ -942,39 +888,39 @@ void RakString::SplitURI(RakNet::RakString &header, RakNet::RakString &domain, R
 	domain.Clear();
 	path.Clear();
 
-	size_t strLen = strlen(sharedString->c_str);
+	size_t strLen = strlen(GetBuffer());
 
 	char c;
 	unsigned int i=0;
-	if (strncmp(sharedString->c_str, "http://", 7)==0)
+	if (strncmp(GetBuffer(), "http://", 7)==0)
 		i+=(unsigned int) strlen("http://");
-	else if (strncmp(sharedString->c_str, "https://", 8)==0)
+	else if (strncmp(GetBuffer(), "https://", 8)==0)
 		i+=(unsigned int) strlen("https://");
 	
-	if (strncmp(sharedString->c_str, "www.", 4)==0)
+	if (strncmp(GetBuffer(), "www.", 4)==0)
 		i+=(unsigned int) strlen("www.");
 
 	if (i!=0)
 	{
 		header.Allocate(i+1);
-		strncpy(header.sharedString->c_str, sharedString->c_str, i);
-		header.sharedString->c_str[i]=0;
+		strncpy(header.GetBuffer(), GetBuffer(), i);
+		header.GetBuffer()[i]=0;
 	}
 
 
 	domain.Allocate(strLen-i+1);
-	char *domainOutput=domain.sharedString->c_str;
+	char *domainOutput=domain.GetBuffer();
 	unsigned int outputIndex=0;
 	for (; i < strLen; i++)
 	{
-		c=sharedString->c_str[i];
+		c=GetBuffer()[i];
 		if (c=='/')
 		{
 			break;
 		}
 		else
 		{
-			domainOutput[outputIndex++]=sharedString->c_str[i];
+			domainOutput[outputIndex++]=GetBuffer()[i];
 		}
 	}
 
@@ -982,10 +928,10 @@ void RakString::SplitURI(RakNet::RakString &header, RakNet::RakString &domain, R
 
 	path.Allocate(strLen-header.GetLength()-outputIndex+1);
 	outputIndex=0;
-	char *pathOutput=path.sharedString->c_str;
+	char *pathOutput=path.GetBuffer();
 	for (; i < strLen; i++)
 	{
-		pathOutput[outputIndex++]=sharedString->c_str[i];
+		pathOutput[outputIndex++]=GetBuffer()[i];
 	}
 	pathOutput[outputIndex]=0;
 }
@@ -996,31 +942,31 @@ RakNet::RakString& RakString::SQLEscape(void)
 	int index;
 	for (index=0; index < strLen; index++)
 	{
-		if (sharedString->c_str[index]=='\'' ||
-			sharedString->c_str[index]=='"' ||
-			sharedString->c_str[index]=='\\')
+		if (GetBuffer()[index]=='\'' ||
+			GetBuffer()[index]=='"' ||
+			GetBuffer()[index]=='\\')
 			escapedCharacterCount++;
 	}
 	if (escapedCharacterCount==0)
 		return *this;
 
 	Clone();
-	Realloc(sharedString, strLen+escapedCharacterCount);
+	Realloc(strLen+escapedCharacterCount+1);
 	int writeIndex, readIndex;
 	writeIndex = strLen+escapedCharacterCount;
 	readIndex=strLen;
 	while (readIndex>=0)
 	{
-		if (sharedString->c_str[readIndex]=='\'' ||
-			sharedString->c_str[readIndex]=='"' ||
-			sharedString->c_str[readIndex]=='\\')
+		if (GetBuffer()[readIndex]=='\'' ||
+			GetBuffer()[readIndex]=='"' ||
+			GetBuffer()[readIndex]=='\\')
 		{
-			sharedString->c_str[writeIndex--]=sharedString->c_str[readIndex--];
-			sharedString->c_str[writeIndex--]='\\';
+			GetBuffer()[writeIndex--]=GetBuffer()[readIndex--];
+			GetBuffer()[writeIndex--]='\\';
 		}
 		else
 		{
-			sharedString->c_str[writeIndex--]=sharedString->c_str[readIndex--];
+			GetBuffer()[writeIndex--]=GetBuffer()[readIndex--];
 		}
 	}
 	return *this;
@@ -1169,24 +1115,24 @@ RakNet::RakString& RakString::MakeFilePath(void)
 
 	RakNet::RakString fixedString = *this;
 	fixedString.Clone();
-	for (int i=0; fixedString.sharedString->c_str[i]; i++)
+	for (int i=0; fixedString.GetBuffer()[i]; i++)
 	{
 #ifdef _WIN32
-		if (fixedString.sharedString->c_str[i]=='/')
-			fixedString.sharedString->c_str[i]='\\';
+		if (fixedString.GetBuffer()[i]=='/')
+			fixedString.GetBuffer()[i]='\\';
 #else
-		if (fixedString.sharedString->c_str[i]=='\\')
-			fixedString.sharedString->c_str[i]='/';
+		if (fixedString.GetBuffer()[i]=='\\')
+			fixedString.GetBuffer()[i]='/';
 #endif
 	}
 
 #ifdef _WIN32
-	if (fixedString.sharedString->c_str[strlen(fixedString.sharedString->c_str)-1]!='\\')
+	if (fixedString.GetBuffer()[strlen(fixedString.GetBuffer())-1]!='\\')
 	{
 		fixedString+='\\';
 	}
 #else
-	if (fixedString.sharedString->c_str[strlen(fixedString.sharedString->c_str)-1]!='/')
+	if (fixedString.GetBuffer()[strlen(fixedString.GetBuffer())-1]!='/')
 	{
 		fixedString+='/';
 	}
@@ -1204,16 +1150,20 @@ void RakString::FreeMemory(void)
 }
 void RakString::FreeMemoryNoMutex(void)
 {
-	for (unsigned int i=0; i < freeList.Size(); i++)
+	while (threadFreeList)
 	{
-		RakNet::OP_DELETE(freeList[i]->refCountMutex,_FILE_AND_LINE_);
-		rakFree_Ex(freeList[i], _FILE_AND_LINE_ );
+		SharedString *next = threadFreeList->nextFree;
+		RakNet::OP_DELETE(threadFreeList, _FILE_AND_LINE_);
+		threadFreeList=next;
 	}
+	threadFreeListSize=0;
+	for (unsigned int i=0; i < freeList.Size(); i++)
+		RakNet::OP_DELETE(freeList[i], _FILE_AND_LINE_);
 	freeList.Clear(false, _FILE_AND_LINE_);
 }
 void RakString::Serialize(BitStream *bs) const
 {
-	Serialize(sharedString->c_str, bs);
+	Serialize(GetBuffer(), bs);
 }
 void RakString::Serialize(const char *str, BitStream *bs)
 {
@@ -1241,9 +1191,9 @@ bool RakString::Deserialize(BitStream *bs)
 	if (l>0)
 	{
 		Allocate(((unsigned int) l)+1);
-		b=bs->ReadAlignedBytes((unsigned char*) sharedString->c_str, l);
+		b=bs->ReadAlignedBytes((unsigned char*) GetBuffer(), l);
 		if (b)
-			sharedString->c_str[l]=0;
+			GetBuffer()[l]=0;
 		else
 			Clear();
 	}
@@ -1315,32 +1265,59 @@ void RakString::Clear(void)
 {
 	Free();
 }
-void RakString::Allocate(size_t len)
+RakString::SharedString *RakString::AllocateSharedString(void)
 {
-	RakString::LockMutex();
-	// sharedString = RakString::pool.Allocate( _FILE_AND_LINE_ );
-	if (RakString::freeList.Size()==0)
+	SharedString *ss = threadFreeList;
+	if (ss)
+	{
+		threadFreeList=ss->nextFree;
+		threadFreeListSize--;
+	}
+	else
 	{
-		//RakString::sharedStringFreeList=(RakString::SharedString*) rakRealloc_Ex(RakString::sharedStringFreeList,(RakString::sharedStringFreeListAllocationCount+1024)*sizeof(RakString::SharedString), _FILE_AND_LINE_);
-		unsigned i;
-		for (i=0; i < 128; i++)
+		LockMutex();
+		if (freeList.Size())
 		{
-			//	RakString::freeList.Insert(RakString::sharedStringFreeList+i+RakString::sharedStringFreeListAllocationCount);
-	//		RakString::freeList.Insert((RakString::SharedString*)rakMalloc_Ex(sizeof(RakString::SharedString), _FILE_AND_LINE_), _FILE_AND_LINE_);
-
-			RakString::SharedString *ss;
-			ss = (RakString::SharedString*) rakMalloc_Ex(sizeof(RakString::SharedString), _FILE_AND_LINE_);
-			ss->refCountMutex=RakNet::OP_NEW<SimpleMutex>(_FILE_AND_LINE_);
-			RakString::freeList.Insert(ss, _FILE_AND_LINE_);
+			ss=freeList[freeList.Size()-1];
+			freeList.RemoveAtIndex(freeList.Size()-1);
 		}
-		//RakString::sharedStringFreeListAllocationCount+=1024;
+		UnlockMutex();
+		if (ss==0)
+			ss=RakNet::OP_NEW<SharedString>(_FILE_AND_LINE_);
+	}
+	return ss;
+}
+void RakString::ReleaseSharedString(SharedString *ss)
+{
+	if (ss->refCount.Decrement()!=0)
+		return;
+	if (ss->bytesUsed>sizeof(ss->smallString))
+		rakFree_Ex(ss->bigString, _FILE_AND_LINE_ );
+	if (threadFreeListSize < RAKSTRING_THREAD_CACHE_SIZE)
+	{
+		ss->nextFree=threadFreeList;
+		threadFreeList=ss;
+		threadFreeListSize++;
+	}
+	else
+	{
+		LockMutex();
+		freeList.Insert(ss, _FILE_AND_LINE_);
+		UnlockMutex();
+	}
+}
+void RakString::Allocate(size_t len)
+{
+	if (len <= sizeof(inlineString))
+	{
+		sharedString=0;
+		return;
 	}
-	sharedString = RakString::freeList[RakString::freeList.Size()-1];
-	RakString::freeList.RemoveAtIndex(RakString::freeList.Size()-1);
-	RakString::UnlockMutex();
 
-	const size_t smallStringSize = 128-sizeof(unsigned int)-sizeof(size_t)-sizeof(char*)*2;
-	sharedString->refCount=1;
+	sharedString = AllocateSharedString();
+	// Released strings have a count of 0, so this sets it to 1
+	sharedString->refCount.Increment();
+	const size_t smallStringSize = sizeof(sharedString->smallString);
 	if (len <= smallStringSize)
 	{
 		sharedString->bytesUsed=smallStringSize;
@@ -1357,19 +1334,21 @@ void RakString::Assign(const char *str)
 {
 	if (str==0 || str[0]==0)
 	{
-		sharedString=&emptyString;
+		sharedString=0;
+		inlineString[0]=0;
 		return;
 	}
 
 	size_t len = strlen(str)+1;
 	Allocate(len);
-	memcpy(sharedString->c_str, str, len);
+	memmove(GetBuffer(), str, len);
 }
 void RakString::Assign(const char *str, va_list ap)
 {
 	if (str==0 || str[0]==0)
 	{
-		sharedString=&emptyString;
+		sharedString=0;
+		inlineString[0]=0;
 		return;
 	}
 
@@ -1415,16 +1394,13 @@ void RakString::Assign(const char *str, va_list ap)
 }
 RakNet::RakString RakString::Assign(const char *str,size_t pos, size_t n )
 {
-	size_t incomingLen=strlen(str);
-
-	Clone();
-
-	if (str==0 || str[0]==0||pos>=incomingLen)
+	if (str==0 || str[0]==0||pos>=strlen(str))
 	{
-		sharedString=&emptyString;
+		Free();
 		return (*this);
 	}
 
+	size_t incomingLen=strlen(str);
 	if (pos+n>=incomingLen)
 	{
 	n=incomingLen-pos;
@@ -1432,10 +1408,14 @@ RakNet::RakString RakString::Assign(const char *str,size_t pos, size_t n )
 	}
 	const char * tmpStr=&(str[pos]); 
 
+	// str may point into our own buffer, so release it only after copying
+	SharedString *oldSharedString=sharedString;
 	size_t len = n+1;
 	Allocate(len);
-	memcpy(sharedString->c_str, tmpStr, len);
-	sharedString->c_str[n]=0;
+	memmove(GetBuffer(), tmpStr, n);
+	GetBuffer()[n]=0;
+	if (oldSharedString)
+		ReleaseSharedString(oldSharedString);
 
 	return (*this);
 }
@@ -1473,70 +1453,38 @@ void RakString::AppendBytes(const char *bytes, unsigned int count)
 {
 	if (IsEmpty())
 	{
-		Allocate(count);
-		memcpy(sharedString->c_str, bytes, count+1);
-		sharedString->c_str[count]=0;
+		Free();
+		Allocate(count+1);
+		memcpy(GetBuffer(), bytes, count);
+		GetBuffer()[count]=0;
 	}
 	else
 	{
 		Clone();
 		unsigned int length=(unsigned int) GetLength();
-		Realloc(sharedString, count+length+1);
-		memcpy(sharedString->c_str+length, bytes, count);
-		sharedString->c_str[length+count]=0;
+		Realloc(count+length+1);
+		memcpy(GetBuffer()+length, bytes, count);
+		GetBuffer()[length+count]=0;
 	}
 
 	
 }
 void RakString::Clone(void)
 {
-	RakAssert(sharedString!=&emptyString);
-	if (sharedString==&emptyString)
-	{
+	// Inline or solo then no point to cloning
+	if (sharedString==0 || sharedString->refCount.GetValue()==1)
 		return;
-	}
-
-	// Empty or solo then no point to cloning
-	sharedString->refCountMutex->Lock();
-	if (sharedString->refCount==1)
-	{
-		sharedString->refCountMutex->Unlock();
-		return;
-	}
 
-	sharedString->refCount--;
-	sharedString->refCountMutex->Unlock();
-	Assign(sharedString->c_str);
+	SharedString *oldSharedString=sharedString;
+	Assign(oldSharedString->c_str);
+	ReleaseSharedString(oldSharedString);
 }
 void RakString::Free(void)
 {
-	if (sharedString==&emptyString)
-		return;
-	sharedString->refCountMutex->Lock();
-	sharedString->refCount--;
-	if (sharedString->refCount==0)
-	{
-		sharedString->refCountMutex->Unlock();
-		const size_t smallStringSize = 128-sizeof(unsigned int)-sizeof(size_t)-sizeof(char*)*2;
-		if (sharedString->bytesUsed>smallStringSize)
-			rakFree_Ex(sharedString->bigString, _FILE_AND_LINE_ );
-		/*
-		poolMutex->Lock();
-		pool.Release(sharedString);
-		poolMutex->Unlock();
-		*/
-
-		RakString::LockMutex();
-		RakString::freeList.Insert(sharedString, _FILE_AND_LINE_);
-		RakString::UnlockMutex();
-
-		sharedString=&emptyString;
-	}
-	else
-	{
-		sharedString->refCountMutex->Unlock();
-	}
-	sharedString=&emptyString;
+	if (sharedString)
+		ReleaseSharedString(sharedString);
+	sharedString=0;
+	inlineString[0]=0;
 }
 unsigned char RakString::ToLower(unsigned char c)
 {
@@ -1550,14 +1498,6 @@ unsigned char RakString::ToUpper(unsigned char c)
 		return c-'a'+'A';
 	return c;
 }
-void RakString::LockMutex(void)
-{
-	GetPoolMutex().Lock();
-}
-void RakString::UnlockMutex(void)
-{
-	GetPoolMutex().Unlock();
-}
 
 /*
 #include "RakString.h"
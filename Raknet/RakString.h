@@ -14,6 +14,8 @@
 #include "Export.h"
 #include "DS_List.h"
 #include "RakNetTypes.h" // int64_t
+#include "RakNetDefines.h"
+#include "LocklessTypes.h"
 #include <stdio.h>
 #include "stdarg.h"
 
@@ -28,12 +30,12 @@
 namespace RakNet
 {
 /// Forward declarations
-class SimpleMutex;
 class BitStream;
 
 /// \brief String class
 /// \details Has the following improvements over std::string
 /// -Reference counting: Suitable to store in lists
+/// -Short strings are stored inline, without allocation or reference counting
 /// -Variadic assignment operator
 /// -Doesn't cause linker errors
 class RAK_DLL_EXPORT RakString
@@ -49,14 +51,14 @@ public:
 	RakString( const RakString & rhs);
 
 	/// Implicit return of const char*
-	operator const char* () const {return sharedString->c_str;}
+	operator const char* () const {return GetBuffer();}
 
 	/// Same as std::string::c_str
-	const char *C_String(void) const {return sharedString->c_str;}
+	const char *C_String(void) const {return GetBuffer();}
 
 	// Lets you modify the string. Do not make the string longer - however, you can make it shorter, or change the contents.
 	// Pointer is only valid in the scope of RakString itself
-	char *C_StringUnsafe(void) {Clone(); return sharedString->c_str;}
+	char *C_StringUnsafe(void) {Clone(); return GetBuffer();}
 
 	/// Assigment operators
 	RakString& operator = ( const RakString& rhs );
@@ -246,10 +248,11 @@ public:
 	/// Fix to be a file path, ending with /
 	RakNet::RakString& MakeFilePath(void);
 
-	/// RakString uses a freeList of old no-longer used strings
-	/// Call this function to clear this memory on shutdown
+	/// RakString keeps a small per-thread cache of old no-longer used strings, and a freeList shared by all threads for the rest
+	/// Call this function on shutdown to clear this memory, and the cache of the calling thread
 	static void FreeMemory(void);
 	/// \internal
+	/// Same as FreeMemory(), without locking the freeList
 	static void FreeMemoryNoMutex(void);
 
 	/// Serialize to a bitstream, uncompressed (slightly faster)
@@ -293,7 +296,7 @@ public:
 	/// \internal
 	static size_t GetSizeToAllocate(size_t bytes)
 	{
-		const size_t smallStringSize = 128-sizeof(unsigned int)-sizeof(size_t)-sizeof(char*)*2;
+		const size_t smallStringSize = sizeof(((SharedString*)0)->smallString);
 		if (bytes<=smallStringSize)
 			return smallStringSize;
 		else
@@ -303,29 +306,31 @@ public:
 	/// \internal
 	struct SharedString
 	{
-		SimpleMutex *refCountMutex;
-		unsigned int refCount;
+		LocklessUint32_t refCount;
 		size_t bytesUsed;
-		char *bigString;
+		union
+		{
+			char *bigString;
+			/// Next entry while the SharedString is held in a thread's cache
+			SharedString *nextFree;
+		};
 		char *c_str;
-		char smallString[128-sizeof(unsigned int)-sizeof(size_t)-sizeof(char*)*2];		
+		char smallString[128-sizeof(LocklessUint32_t)-sizeof(size_t)-sizeof(char*)*2];
 	};
 
 	/// \internal
 	RakString( SharedString *_sharedString );
 
 	/// \internal
+	/// 0 if the string is held in inlineString
 	SharedString *sharedString;
 
-//	static SimpleMutex poolMutex;
-//	static DataStructures::MemoryPool<SharedString> pool;
 	/// \internal
-	static SharedString emptyString;
+	/// Storage for strings of up to RAKSTRING_INLINE_SIZE bytes, including the terminator
+	char inlineString[RAKSTRING_INLINE_SIZE];
 
-	//static SharedString *sharedStringFreeList;
-	//static unsigned int sharedStringFreeListAllocationCount;
 	/// \internal
-	/// List of free objects to reduce memory reallocations
+	/// List of free objects to reduce memory reallocations, once the cache of a thread is full
 	static DataStructures::List<SharedString*> freeList;
 
 	static int RakStringComp( RakString const &key, RakString const &data );
@@ -335,6 +340,7 @@ public:
 
 protected:
 	static RakNet::RakString FormatForPUTOrPost(const char* type, const char* uri, const char* contentType, const char* body, const char* extraHeaders);
+	char *GetBuffer(void) const {return sharedString ? sharedString->c_str : (char*) inlineString;}
 	void Allocate(size_t len);
 	void Assign(const char *str);
 	void Assign(const char *str, va_list ap);
@@ -343,7 +349,9 @@ protected:
 	void Free(void);
 	unsigned char ToLower(unsigned char c);
 	unsigned char ToUpper(unsigned char c);
-	void Realloc(SharedString *sharedString, size_t bytes);
+	void Realloc(size_t bytes);
+	static SharedString *AllocateSharedString(void);
+	static void ReleaseSharedString(SharedString *sharedString);
 };
 
 }
@@ -444,6 +444,7 @@ void ReliabilityLayer::InitializeVariables( void )
 	datagramHistoryPopCount=0;
 
 	InitHeapWeights();
+	outgoingPacketBufferSize=0;
 	for (int i=0; i < NUMBER_OF_PRIORITIES; i++)
 	{
 		statistics.messageInSendBuffer[i]=0;
@@ -566,14 +567,18 @@ void ReliabilityLayer::FreeThreadSafeMemory( void )
 
 	//	acknowlegements.Clear(_FILE_AND_LINE_);
 
-	for ( j=0 ; j < outgoingPacketBuffer.Size(); j++ )
+	for ( int priorityLevel=0; priorityLevel < NUMBER_OF_PRIORITIES; priorityLevel++ )
 	{
-		if ( outgoingPacketBuffer[ j ]->data)
-			FreeInternalPacketData( outgoingPacketBuffer[ j ], _FILE_AND_LINE_ );
-		ReleaseToInternalPacketPool( outgoingPacketBuffer[ j ] );
+		for ( j=0 ; j < outgoingPacketBuffer[ priorityLevel ].Size(); j++ )
+		{
+			InternalPacket *internalPacket = outgoingPacketBuffer[ priorityLevel ][ j ].internalPacket;
+			if ( internalPacket->data)
+				FreeInternalPacketData( internalPacket, _FILE_AND_LINE_ );
+			ReleaseToInternalPacketPool( internalPacket );
+		}
+		outgoingPacketBuffer[ priorityLevel ].Clear(_FILE_AND_LINE_);
 	}
-
-	outgoingPacketBuffer.Clear(true, _FILE_AND_LINE_);
+	outgoingPacketBufferSize=0;
 
 #ifdef _DEBUG
 	for (unsigned i = 0; i < delayList.Size(); i++ )
@@ -743,32 +748,36 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 					messageHandlerList[messageHandlerIndex]->OnReliabilityLayerNotification("incomingAcks minIndex > maxIndex or maxIndex is max value", BYTES_TO_BITS(length), systemAddress, true);
 				return false;
 			}
-			for (datagramNumber=incomingAcks.ranges[i].minIndex; datagramNumber >= incomingAcks.ranges[i].minIndex && datagramNumber <= incomingAcks.ranges[i].maxIndex; datagramNumber++)
+			if (unreliableWithAckReceiptHistory.Size()>0)
 			{
-				CCTimeType whenSent;
-				
-				if (unreliableWithAckReceiptHistory.Size()>0)
+				// One pass over the receipt history for the whole range, rather than one per datagram
+				unsigned int k=0;
+				while (k < unreliableWithAckReceiptHistory.Size())
 				{
-					unsigned int k=0;
-					while (k < unreliableWithAckReceiptHistory.Size())
+					if (unreliableWithAckReceiptHistory[k].datagramNumber >= incomingAcks.ranges[i].minIndex &&
+						unreliableWithAckReceiptHistory[k].datagramNumber <= incomingAcks.ranges[i].maxIndex)
 					{
-						if (unreliableWithAckReceiptHistory[k].datagramNumber == datagramNumber)
-						{
-							InternalPacket *ackReceipt = AllocateFromInternalPacketPool();
-							AllocInternalPacketData(ackReceipt, 5,  false, _FILE_AND_LINE_ );
-							ackReceipt->dataBitLength=BYTES_TO_BITS(5);
-							ackReceipt->data[0]=(MessageID)ID_SND_RECEIPT_ACKED;
-							memcpy(ackReceipt->data+sizeof(MessageID), &unreliableWithAckReceiptHistory[k].sendReceiptSerial, sizeof(uint32_t));
-							outputQueue.Push(ackReceipt, _FILE_AND_LINE_ );
-
-							// Remove, swap with last
-							unreliableWithAckReceiptHistory.RemoveAtIndex(k);
-						}
-						else
-							k++;
+						InternalPacket *ackReceipt = AllocateFromInternalPacketPool();
+						AllocInternalPacketData(ackReceipt, 5,  false, _FILE_AND_LINE_ );
+						ackReceipt->dataBitLength=BYTES_TO_BITS(5);
+						ackReceipt->data[0]=(MessageID)ID_SND_RECEIPT_ACKED;
+						memcpy(ackReceipt->data+sizeof(MessageID), &unreliableWithAckReceiptHistory[k].sendReceiptSerial, sizeof(uint32_t));
+						outputQueue.Push(ackReceipt, _FILE_AND_LINE_ );
+
+						// Remove, swap with last
+						unreliableWithAckReceiptHistory.RemoveAtIndex(k);
 					}
+					else
+						k++;
 				}
+			}
 
+			// Only datagrams still in datagramHistory have messages to remove
+			datagramNumber=incomingAcks.ranges[i].minIndex;
+			unsigned int datagramCount = ClampToDatagramHistory(datagramNumber, incomingAcks.ranges[i].maxIndex);
+			for (; datagramCount > 0; datagramCount--, datagramNumber++)
+			{
+				CCTimeType whenSent;
 				MessageNumberNode *messageNumberNode = GetMessageNumberNodeByDatagramIndex(datagramNumber, &whenSent);
 				if (messageNumberNode)
 				{
@@ -794,13 +803,6 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 
 					RemoveFromDatagramHistory(datagramNumber);
 				}
-// 				else if (isReliable)
-// 				{
-// 					// Previously used slot, rather than empty unreliable slot
-// 					printf("%p Ack %i is duplicate\n", this, datagramNumber.val);
-// 
-//  					congestionManager.OnDuplicateAck(timeRead, datagramNumber);
-// 				}
 			}
 		}
 	}
@@ -826,9 +828,11 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 
 				return false;
 			}
-			// Sanity check
-			//RakAssert(incomingNAKs.ranges[i].maxIndex.val-incomingNAKs.ranges[i].minIndex.val<1000);
-			for (messageNumber=incomingNAKs.ranges[i].minIndex; messageNumber >= incomingNAKs.ranges[i].minIndex && messageNumber <= incomingNAKs.ranges[i].maxIndex; messageNumber++)
+			// Datagrams no longer in datagramHistory were either acked or are too old to resend, so only the overlap with it is walked.
+			// This also bounds the work a NAK with a huge range can cause
+			messageNumber=incomingNAKs.ranges[i].minIndex;
+			unsigned int datagramCount = ClampToDatagramHistory(messageNumber, incomingNAKs.ranges[i].maxIndex);
+			for (; datagramCount > 0; datagramCount--, messageNumber++)
 			{
 				congestionManager.OnNAK(timeRead, messageNumber);
 
@@ -870,11 +874,8 @@ bool ReliabilityLayer::HandleSocketReceiveFromConnectedPlayer(
 
 		DatagramHeaderFormat dhfNAK;
 		dhfNAK.isNAK=true;
-		uint32_t skippedMessageOffset;
-		for (skippedMessageOffset=skippedMessageCount; skippedMessageOffset > 0; skippedMessageOffset--)
-		{
-			NAKs.Insert(dhf.datagramNumber-skippedMessageOffset);
-		}
+		if (skippedMessageCount > 0)
+			NAKs.InsertRange(dhf.datagramNumber-skippedMessageCount, dhf.datagramNumber-(uint32_t)1);
 		remoteSystemNeedsBAndAS=dhf.needsBAndAs;
 
 		// Ack dhf.datagramNumber
@@ -1673,8 +1674,9 @@ bool ReliabilityLayer::Send( char *data, BitSize_t numberOfBitsToSend, PacketPri
 
 	RakAssert(internalPacket->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
 	RakAssert(internalPacket->messageNumberAssigned==false);
-	outgoingPacketBuffer.Push( GetNextWeight(internalPacket->priority), internalPacket, _FILE_AND_LINE_  );
-	RakAssert(outgoingPacketBuffer.Size()==0 || outgoingPacketBuffer.Peek()->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
+	// Header size only depends on reliability and splitting, so compute it once here rather than each time the datagram builder looks at it
+	internalPacket->headerLength=GetMessageHeaderLengthBits(internalPacket);
+	PushOutgoingPacket( internalPacket );
 	statistics.messageInSendBuffer[(int)internalPacket->priority]++;
 	statistics.bytesInSendBuffer[(int)internalPacket->priority]+=(double) BITS_TO_BYTES(internalPacket->dataBitLength);
 
@@ -1812,7 +1814,7 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 		SendACKs(s, systemAddress, time, rnr, updateBitStream);
 	}
 
-	if (NAKs.Size()>0)
+	if (NAKs.IsEmpty()==false)
 	{
 		updateBitStream.Reset();
 		DatagramHeaderFormat dhfNAK;
@@ -1831,7 +1833,7 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 	// 		sendPacketSet[1].IsEmpty()==false ||
 	// 		sendPacketSet[2].IsEmpty()==false ||
 	// 		sendPacketSet[3].IsEmpty()==false;
-	bandwidthExceededStatistic=outgoingPacketBuffer.Size()>0;
+	bandwidthExceededStatistic=outgoingPacketBufferSize>0;
 
 	const bool hasDataToSendOrResend = IsResendQueueEmpty()==false || bandwidthExceededStatistic;
 	RakAssert(NUMBER_OF_PRIORITIES==4);
@@ -1977,6 +1979,7 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 		{
 			//	printf("S+ ");
 			allDatagramSizesSoFar=0;
+			const BitSize_t maxDatagramSizeExcludingMessageHeaderBits = GetMaxDatagramSizeExcludingMessageHeaderBits();
 
 			// Keep filling datagrams until we exceed transmission bandwidth
 			while (
@@ -1995,29 +1998,31 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 				statistics.isLimitedByOutgoingBandwidthLimit=bitsPerSecondLimit!=0 && BITS_TO_BYTES(bitsPerSecondLimit) < bpsMetrics[USER_MESSAGE_BYTES_SENT].GetBPS1(time);
 
 
-				while (outgoingPacketBuffer.Size() &&
+				while (outgoingPacketBufferSize>0 &&
 					statistics.isLimitedByOutgoingBandwidthLimit==false)
 					//while ( sendPacketSet[ i ].Size() )
 				{
-					internalPacket=outgoingPacketBuffer.Peek();
+					int priorityLevel = GetNextOutgoingPriority();
+					internalPacket=outgoingPacketBuffer[priorityLevel].Peek().internalPacket;
 					RakAssert(internalPacket->messageNumberAssigned==false);
-					RakAssert(outgoingPacketBuffer.Size()==0 || outgoingPacketBuffer.Peek()->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
+					RakAssert(internalPacket->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
 
 					// internalPacket = sendPacketSet[ i ].Peek();
 					if (internalPacket->data==0)
 					{
 						//sendPacketSet[ i ].Pop();
-						outgoingPacketBuffer.Pop(0);
-						RakAssert(outgoingPacketBuffer.Size()==0 || outgoingPacketBuffer.Peek()->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
+						outgoingPacketBuffer[priorityLevel].Pop();
+						outgoingPacketBufferSize--;
 						statistics.messageInSendBuffer[(int)internalPacket->priority]--;
 						statistics.bytesInSendBuffer[(int)internalPacket->priority]-=(double) BITS_TO_BYTES(internalPacket->dataBitLength);
 						ReleaseToInternalPacketPool( internalPacket );
 						continue;
 					}
 
-					internalPacket->headerLength=GetMessageHeaderLengthBits(internalPacket);
+					// headerLength was computed when the message was queued
+					RakAssert(internalPacket->headerLength==GetMessageHeaderLengthBits(internalPacket));
 					nextPacketBitLength = internalPacket->headerLength + internalPacket->dataBitLength;
-					if ( datagramSizeSoFar + nextPacketBitLength > GetMaxDatagramSizeExcludingMessageHeaderBits() )
+					if ( datagramSizeSoFar + nextPacketBitLength > maxDatagramSizeExcludingMessageHeaderBits )
 					{
 						// Hit MTU. May still push packets if smaller ones exist at a lower priority
 						RakAssert(datagramSizeSoFar!=0);
@@ -2038,8 +2043,8 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 						isReliable = false;
 
 					//sendPacketSet[ i ].Pop();
-					outgoingPacketBuffer.Pop(0);
-					RakAssert(outgoingPacketBuffer.Size()==0 || outgoingPacketBuffer.Peek()->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
+					outgoingPacketBuffer[priorityLevel].Pop();
+					outgoingPacketBufferSize--;
 					RakAssert(internalPacket->messageNumberAssigned==false);
 					statistics.messageInSendBuffer[(int)internalPacket->priority]--;
 					statistics.bytesInSendBuffer[(int)internalPacket->priority]-=(double) BITS_TO_BYTES(internalPacket->dataBitLength);
@@ -2212,7 +2217,7 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 
 			SendBitStream( s, systemAddress, &updateBitStream, rnr, time );
 
-			bandwidthExceededStatistic=outgoingPacketBuffer.Size()>0;
+			bandwidthExceededStatistic=outgoingPacketBufferSize>0;
 			// 			bandwidthExceededStatistic=sendPacketSet[0].IsEmpty()==false ||
 			// 				sendPacketSet[1].IsEmpty()==false ||
 			// 				sendPacketSet[2].IsEmpty()==false ||
@@ -2229,7 +2234,7 @@ void ReliabilityLayer::Update( RakNetSocket2 *s, SystemAddress &systemAddress, i
 		ClearPacketsAndDatagrams();
 
 		// Any data waiting to send after attempting to send, then bandwidth is exceeded
-		bandwidthExceededStatistic=outgoingPacketBuffer.Size()>0;
+		bandwidthExceededStatistic=outgoingPacketBufferSize>0;
 		// 		bandwidthExceededStatistic=sendPacketSet[0].IsEmpty()==false ||
 		// 			sendPacketSet[1].IsEmpty()==false ||
 		// 			sendPacketSet[2].IsEmpty()==false ||
@@ -2344,7 +2349,7 @@ void ReliabilityLayer::SendBitStream( RakNetSocket2 *s, SystemAddress &systemAdd
 //-------------------------------------------------------------------------------------------------------
 bool ReliabilityLayer::IsOutgoingDataWaiting(void)
 {
-	if (outgoingPacketBuffer.Size()>0)
+	if (outgoingPacketBufferSize>0)
 		return true;
 
 	// 	unsigned i;
@@ -2361,7 +2366,7 @@ bool ReliabilityLayer::IsOutgoingDataWaiting(void)
 }
 bool ReliabilityLayer::AreAcksWaiting(void)
 {
-	return acknowlegements.Size() > 0;
+	return acknowlegements.IsEmpty()==false;
 }
 //-------------------------------------------------------------------------------------------------------
 void ReliabilityLayer::ApplyNetworkSimulator( double _packetloss, RakNet::TimeMS _minExtraPing, RakNet::TimeMS _extraPingVariance )
@@ -3002,21 +3007,16 @@ void ReliabilityLayer::SplitPacket( InternalPacket *internalPacket )
 
 	//	InternalPacket *workingPacket;
 
-	// Tell the heap we are going to push a list of elements where each element in the list follows the heap order
-	RakAssert(outgoingPacketBuffer.Size()==0 || outgoingPacketBuffer.Peek()->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
-	outgoingPacketBuffer.StartSeries();
-
 	// Copy all the new packets into the split packet list
 	for ( i = 0; i < ( int ) internalPacket->splitPacketCount; i++ )
 	{
-		internalPacketArray[ i ]->headerLength=headerLength;
+		internalPacketArray[ i ]->headerLength=BYTES_TO_BITS(headerLength);
 		RakAssert(internalPacketArray[ i ]->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
 		AddToUnreliableLinkedList(internalPacketArray[ i ]);
 		//		sendPacketSet[ internalPacket->priority ].Push( internalPacketArray[ i ], _FILE_AND_LINE_  );
 		RakAssert(internalPacketArray[ i ]->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
 		RakAssert(internalPacketArray[ i ]->messageNumberAssigned==false);
-		outgoingPacketBuffer.PushSeries(GetNextWeight(internalPacketArray[ i ]->priority), internalPacketArray[ i ], _FILE_AND_LINE_);
-		RakAssert(outgoingPacketBuffer.Size()==0 || outgoingPacketBuffer.Peek()->dataBitLength<BYTES_TO_BITS(MAXIMUM_MTU_SIZE));
+		PushOutgoingPacket(internalPacketArray[ i ]);
 		statistics.messageInSendBuffer[(int)internalPacketArray[ i ]->priority]++;
 		statistics.bytesInSendBuffer[(int)(int)internalPacketArray[ i ]->priority]+=(double) BITS_TO_BYTES(internalPacketArray[ i ]->dataBitLength);
 		//		workingPacket=sendPacketSet[internalPacket->priority].WriteLock();
@@ -3617,7 +3617,7 @@ void ReliabilityLayer::SendACKs(RakNetSocket2 *s, SystemAddress &systemAddress,
 {
 	BitSize_t maxDatagramPayload = GetMaxDatagramSizeExcludingMessageHeaderBits();
 
-	while (acknowlegements.Size()>0)
+	while (acknowlegements.IsEmpty()==false)
 	{
 		// Send acks
 		updateBitStream.Reset();
@@ -3780,6 +3780,28 @@ ReliabilityLayer::MessageNumberNode* ReliabilityLayer::GetMessageNumberNodeByDat
 	return datagramHistory[offsetIntoList].head;
 }
 //-------------------------------------------------------------------------------------------------------
+unsigned int ReliabilityLayer::ClampToDatagramHistory(DatagramSequenceNumberType &minIndex, DatagramSequenceNumberType maxIndex)
+{
+	if (datagramHistory.IsEmpty())
+		return 0;
+
+	DatagramSequenceNumberType lastIndex = datagramHistoryPopCount + (uint32_t) (datagramHistory.Size()-1);
+	if (congestionManager.LessThan(minIndex, datagramHistoryPopCount))
+	{
+		if (congestionManager.LessThan(maxIndex, datagramHistoryPopCount))
+			return 0;
+		minIndex=datagramHistoryPopCount;
+	}
+	if (congestionManager.LessThan(lastIndex, minIndex))
+		return 0;
+	if (congestionManager.LessThan(lastIndex, maxIndex))
+		maxIndex=lastIndex;
+
+	unsigned int count = (uint32_t) (maxIndex-minIndex) + 1;
+	unsigned int available = datagramHistory.Size() - (uint32_t) (minIndex-datagramHistoryPopCount);
+	return count < available ? count : available;
+}
+//-------------------------------------------------------------------------------------------------------
 void ReliabilityLayer::RemoveFromDatagramHistory(DatagramSequenceNumberType index)
 {
 	DatagramSequenceNumberType offsetIntoList = index - datagramHistoryPopCount;
@@ -3932,10 +3954,10 @@ void ReliabilityLayer::InitHeapWeights(void)
 reliabilityHeapWeightType ReliabilityLayer::GetNextWeight(int priorityLevel)
 {
 	uint64_t next = outgoingPacketBufferNextWeights[priorityLevel];
-	if (outgoingPacketBuffer.Size()>0)
+	if (outgoingPacketBufferSize>0)
 	{
-		int peekPL = outgoingPacketBuffer.Peek()->priority;
-		reliabilityHeapWeightType weight = outgoingPacketBuffer.PeekWeight();
+		int peekPL = GetNextOutgoingPriority();
+		reliabilityHeapWeightType weight = outgoingPacketBuffer[peekPL].Peek().weight;
 		reliabilityHeapWeightType min = weight - (1<<peekPL)*peekPL+peekPL;
 		if (next<min)
 			next=min + (1<<priorityLevel)*priorityLevel+priorityLevel;
@@ -3947,6 +3969,28 @@ reliabilityHeapWeightType ReliabilityLayer::GetNextWeight(int priorityLevel)
 	}
 	return next;
 }
+//-------------------------------------------------------------------------------------------------------
+void ReliabilityLayer::PushOutgoingPacket(InternalPacket *internalPacket)
+{
+	OutgoingPacketNode node;
+	node.weight=GetNextWeight(internalPacket->priority);
+	node.internalPacket=internalPacket;
+	outgoingPacketBuffer[internalPacket->priority].Push(node, _FILE_AND_LINE_);
+	outgoingPacketBufferSize++;
+}
+//-------------------------------------------------------------------------------------------------------
+int ReliabilityLayer::GetNextOutgoingPriority(void) const
+{
+	// Ties go to the more important priority, which comes first
+	int best=-1;
+	for (int priorityLevel=0; priorityLevel < NUMBER_OF_PRIORITIES; priorityLevel++)
+	{
+		if (outgoingPacketBuffer[priorityLevel].Size()>0 &&
+			(best==-1 || outgoingPacketBuffer[priorityLevel].Peek().weight < outgoingPacketBuffer[best].Peek().weight))
+			best=priorityLevel;
+	}
+	return best;
+}
 
 //-------------------------------------------------------------------------------------------------------
 // #if defined(RELIABILITY_LAYER_NEW_UNDEF_ALLOCATING_QUEUE)
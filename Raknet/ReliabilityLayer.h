@@ -29,6 +29,7 @@
 #include "DR_SHA1.h"
 #include "DS_OrderedList.h"
 #include "DS_RangeList.h"
+#include "DS_RangeBitmap.h"
 #include "DS_BPlusTree.h"
 #include "DS_MemoryPool.h"
 #include "RakNetDefines.h"
@@ -366,6 +367,8 @@ private:
 
 	void RemoveFromDatagramHistory(DatagramSequenceNumberType index);
 	MessageNumberNode* GetMessageNumberNodeByDatagramIndex(DatagramSequenceNumberType index, CCTimeType *timeSent);
+	/// Narrows [minIndex, maxIndex] to the datagrams still in datagramHistory. Returns the number of datagrams left, 0 for none
+	unsigned int ClampToDatagramHistory(DatagramSequenceNumberType &minIndex, DatagramSequenceNumberType maxIndex);
 	void AddFirstToDatagramHistory(DatagramSequenceNumberType datagramNumber, CCTimeType timeSent);
 	MessageNumberNode* AddFirstToDatagramHistory(DatagramSequenceNumberType datagramNumber, DatagramSequenceNumberType messageNumber, CCTimeType timeSent);
 	MessageNumberNode* AddSubsequentToDatagramHistory(MessageNumberNode *messageNumberNode, DatagramSequenceNumberType messageNumber);
@@ -398,10 +401,21 @@ private:
 //	CCTimeType lastPacketlossTime;
 
 	//DataStructures::Queue<InternalPacket*> sendPacketSet[ NUMBER_OF_PRIORITIES ];
-	DataStructures::Heap<reliabilityHeapWeightType, InternalPacket*, false> outgoingPacketBuffer;
+	struct OutgoingPacketNode
+	{
+		reliabilityHeapWeightType weight;
+		InternalPacket *internalPacket;
+	};
+	// One FIFO per priority. Weights only increase within a priority, so the next message to send is whichever head has the lowest weight.
+	// This gives the same weighted round robin across priorities as a single heap, with O(1) push and pop.
+	DataStructures::Queue<OutgoingPacketNode> outgoingPacketBuffer[NUMBER_OF_PRIORITIES];
+	unsigned int outgoingPacketBufferSize;
 	reliabilityHeapWeightType outgoingPacketBufferNextWeights[NUMBER_OF_PRIORITIES];
 	void InitHeapWeights(void);
 	reliabilityHeapWeightType GetNextWeight(int priorityLevel);
+	void PushOutgoingPacket(InternalPacket *internalPacket);
+	// Returns the priority whose head should be sent next, or -1 if nothing is waiting
+	int GetNextOutgoingPriority(void) const;
 //	unsigned int messageInSendBuffer[NUMBER_OF_PRIORITIES];
 //	double bytesInSendBuffer[NUMBER_OF_PRIORITIES];
 
@@ -562,8 +576,9 @@ private:
 	InternalPacket* AllocateFromInternalPacketPool(void);
 	void ReleaseToInternalPacketPool(InternalPacket *ip);
 
-	DataStructures::RangeList<DatagramSequenceNumberType> acknowlegements;
-	DataStructures::RangeList<DatagramSequenceNumberType> NAKs;
+	// Datagram numbers to ack and nak. Kept as bitmaps so inserting is O(1) however many holes there are
+	DataStructures::RangeBitmap<DatagramSequenceNumberType, 24> acknowlegements;
+	DataStructures::RangeBitmap<DatagramSequenceNumberType, 24> NAKs;
 	bool remoteSystemNeedsBAndAS;
 
 	unsigned int GetMaxDatagramSizeExcludingMessageHeaderBytes(void);
@@ -0,0 +1,155 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_BAKED_COLLISION_FORMAT_H
+#define BT_BAKED_COLLISION_FORMAT_H
+
+#include "LinearMath/btScalar.h"
+
+///The baked collision format stores static collision shapes and objects without pointers.
+///Every reference is an offset in bytes from the start of the file, and every array starts at a multiple of BT_BAKED_ALIGNMENT,
+///so a file can be memory mapped anywhere and used in place: btBakedCollisionLoader creates shapes that refer to the
+///vertices, indices, quantized BVH nodes, heights and points in the file, it copies and fixes up nothing.
+///The structures are stored in the native layout, a file can only be loaded on a platform with the same endianness and btScalar precision.
+
+#define BT_BAKED_MAGIC "BTBAKED"
+#define BT_BAKED_VERSION 1
+#define BT_BAKED_ENDIAN_CHECK 0x01020304
+#define BT_BAKED_ALIGNMENT 16
+
+enum btBakedShapeType
+{
+	BT_BAKED_BOX_SHAPE = 0,
+	BT_BAKED_SPHERE_SHAPE,
+	BT_BAKED_CONVEX_HULL_SHAPE,
+	BT_BAKED_TRIANGLE_MESH_SHAPE,
+	BT_BAKED_HEIGHTFIELD_SHAPE,
+	BT_BAKED_COMPOUND_SHAPE
+};
+
+struct btBakedHeaderData
+{
+	char	m_magic[8];
+	int		m_version;
+	int		m_endianCheck;
+	int		m_scalarSize;
+	int		m_fileSize;
+	int		m_numShapes;
+	int		m_shapesOffset;		// btBakedShapeEntryData[m_numShapes]
+	int		m_numObjects;
+	int		m_objectsOffset;	// btBakedObjectData[m_numObjects]
+	char	m_pad[8];
+};
+
+struct btBakedShapeEntryData
+{
+	int		m_shapeType;		// btBakedShapeType
+	int		m_dataOffset;		// the data of the type, for instance btBakedTriangleMeshData
+};
+
+struct btBakedBoxData
+{
+	btScalar	m_halfExtentsWithMargin[3];
+	btScalar	m_margin;
+};
+
+struct btBakedSphereData
+{
+	btScalar	m_radius;
+};
+
+struct btBakedConvexHullData
+{
+	int			m_numPoints;
+	int			m_pointsOffset;		// btVector3[m_numPoints], unscaled
+	btScalar	m_localScaling[3];
+	btScalar	m_margin;
+};
+
+struct btBakedMeshPartData
+{
+	int		m_numVertices;
+	int		m_verticesOffset;	// btScalar[3*m_numVertices]
+	int		m_numTriangles;
+	int		m_indicesOffset;	// int[3*m_numTriangles]
+};
+
+///the vertices are stored scaled, the mesh has unit scaling
+struct btBakedTriangleMeshData
+{
+	int			m_numParts;
+	int			m_partsOffset;				// btBakedMeshPartData[m_numParts]
+	int			m_numNodes;
+	int			m_nodesOffset;				// btQuantizedBvhNode[m_numNodes]
+	int			m_numSubtreeHeaders;
+	int			m_subtreeHeadersOffset;		// btBvhSubtreeInfo[m_numSubtreeHeaders]
+	btScalar	m_aabbMin[3];
+	btScalar	m_aabbMax[3];
+	btScalar	m_bvhAabbMin[3];
+	btScalar	m_bvhAabbMax[3];
+	btScalar	m_bvhQuantization[3];
+	btScalar	m_margin;
+};
+
+struct btBakedHeightfieldData
+{
+	int			m_heightStickWidth;
+	int			m_heightStickLength;
+	int			m_heightDataType;			// PHY_ScalarType, PHY_FLOAT heights are btScalar
+	int			m_heightsOffset;			// m_heightStickWidth*m_heightStickLength heights
+	int			m_upAxis;
+	int			m_flags;					// btBakedHeightfieldFlags
+	btScalar	m_heightScale;
+	btScalar	m_minHeight;
+	btScalar	m_maxHeight;
+	btScalar	m_localScaling[3];
+	btScalar	m_margin;
+};
+
+enum btBakedHeightfieldFlags
+{
+	BT_BAKED_FLIP_QUAD_EDGES = 1,
+	BT_BAKED_DIAMOND_SUBDIVISION = 2,
+	BT_BAKED_ZIGZAG_SUBDIVISION = 4
+};
+
+struct btBakedCompoundChildData
+{
+	btScalar	m_origin[3];
+	btScalar	m_rotation[4];
+	int			m_childShapeIndex;		// always below the index of the compound shape
+};
+
+///the child transforms and shapes are stored scaled, the compound shape has unit scaling
+struct btBakedCompoundData
+{
+	int			m_numChildren;
+	int			m_childrenOffset;		// btBakedCompoundChildData[m_numChildren]
+	btScalar	m_margin;
+};
+
+struct btBakedObjectData
+{
+	btScalar	m_origin[3];
+	btScalar	m_rotation[4];
+	btScalar	m_friction;
+	btScalar	m_rollingFriction;
+	btScalar	m_restitution;
+	int			m_shapeIndex;
+	int			m_collisionFlags;
+	int			m_userIndex;
+};
+
+#endif //BT_BAKED_COLLISION_FORMAT_H
@@ -0,0 +1,354 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btBakedCollisionLoader.h"
+#include "btBulletCollisionCommon.h"
+#include "BulletCollision/CollisionShapes/btConvexPointCloudShape.h"
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h"
+#include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include <string.h>
+#include <limits.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static btVector3 btBakedLoadVector(const btScalar* v)
+{
+	return btVector3(v[0],v[1],v[2]);
+}
+
+static btTransform btBakedLoadTransform(const btScalar* origin,const btScalar* rotation)
+{
+	return btTransform(btQuaternion(rotation[0],rotation[1],rotation[2],rotation[3]),btBakedLoadVector(origin));
+}
+
+btBakedCollisionLoader::btBakedCollisionLoader()
+:m_data(0),
+m_dataSize(0),
+m_mappedData(0),
+m_mappedSize(0)
+{
+}
+
+btBakedCollisionLoader::~btBakedCollisionLoader()
+{
+	reset();
+}
+
+bool	btBakedCollisionLoader::isValidRange(int offset,int elementSize,int count) const
+{
+	return (offset >= 0) && ((offset % BT_BAKED_ALIGNMENT) == 0) && (count >= 0) &&
+		((long long)offset+(long long)elementSize*count <= m_dataSize);
+}
+
+btCollisionShape*	btBakedCollisionLoader::createShape(const btBakedShapeEntryData& entry)
+{
+	switch (entry.m_shapeType)
+	{
+	case BT_BAKED_BOX_SHAPE:
+		{
+			const btBakedBoxData* data = getData<btBakedBoxData>(entry.m_dataOffset);
+			if (!data)
+				return 0;
+			btBoxShape* box = new btBoxShape(btBakedLoadVector(data->m_halfExtentsWithMargin));
+			box->setMargin(data->m_margin);
+			return box;
+		}
+	case BT_BAKED_SPHERE_SHAPE:
+		{
+			const btBakedSphereData* data = getData<btBakedSphereData>(entry.m_dataOffset);
+			if (!data)
+				return 0;
+			return new btSphereShape(data->m_radius);
+		}
+	case BT_BAKED_CONVEX_HULL_SHAPE:
+		{
+			const btBakedConvexHullData* data = getData<btBakedConvexHullData>(entry.m_dataOffset);
+			const btVector3* points = data ? getData<btVector3>(data->m_pointsOffset,data->m_numPoints) : 0;
+			if (!points)
+				return 0;
+			btConvexPointCloudShape* hull = new btConvexPointCloudShape(const_cast<btVector3*>(points),data->m_numPoints,btBakedLoadVector(data->m_localScaling));
+			hull->setMargin(data->m_margin);
+			return hull;
+		}
+	case BT_BAKED_TRIANGLE_MESH_SHAPE:
+		{
+			const btBakedTriangleMeshData* data = getData<btBakedTriangleMeshData>(entry.m_dataOffset);
+			if (!data)
+				return 0;
+			const btBakedMeshPartData* parts = getData<btBakedMeshPartData>(data->m_partsOffset,data->m_numParts);
+			const btQuantizedBvhNode* nodes = getData<btQuantizedBvhNode>(data->m_nodesOffset,data->m_numNodes);
+			const btBvhSubtreeInfo* subtreeHeaders = getData<btBvhSubtreeInfo>(data->m_subtreeHeadersOffset,data->m_numSubtreeHeaders);
+			if (!parts || !nodes || !subtreeHeaders)
+				return 0;
+			btTriangleIndexVertexArray* meshInterface = new btTriangleIndexVertexArray();
+			m_meshInterfaces.push_back(meshInterface);
+			for (int part=0;part<data->m_numParts;part++)
+			{
+				btIndexedMesh indexedMesh;
+				indexedMesh.m_numTriangles = parts[part].m_numTriangles;
+				indexedMesh.m_triangleIndexBase = (const unsigned char*)getData<int>(parts[part].m_indicesOffset,3*parts[part].m_numTriangles);
+				indexedMesh.m_triangleIndexStride = 3*sizeof(int);
+				indexedMesh.m_numVertices = parts[part].m_numVertices;
+				indexedMesh.m_vertexBase = (const unsigned char*)getData<btScalar>(parts[part].m_verticesOffset,3*parts[part].m_numVertices);
+				indexedMesh.m_vertexStride = 3*sizeof(btScalar);
+				if (!indexedMesh.m_triangleIndexBase || !indexedMesh.m_vertexBase)
+					return 0;
+				meshInterface->addIndexedMesh(indexedMesh,PHY_INTEGER);
+			}
+			//the shape takes the baked aabb instead of going over all triangles
+			meshInterface->setPremadeAabb(btBakedLoadVector(data->m_aabbMin),btBakedLoadVector(data->m_aabbMax));
+
+			btOptimizedBvh* bvh = new btOptimizedBvh();
+			m_bvhs.push_back(bvh);
+			bvh->initializeFromBuffer(btBakedLoadVector(data->m_bvhAabbMin),btBakedLoadVector(data->m_bvhAabbMax),btBakedLoadVector(data->m_bvhQuantization),
+				const_cast<btQuantizedBvhNode*>(nodes),data->m_numNodes,const_cast<btBvhSubtreeInfo*>(subtreeHeaders),data->m_numSubtreeHeaders);
+
+			btBvhTriangleMeshShape* trimesh = new btBvhTriangleMeshShape(meshInterface,true,false);
+			trimesh->setOptimizedBvh(bvh);
+			trimesh->setMargin(data->m_margin);
+			return trimesh;
+		}
+	case BT_BAKED_HEIGHTFIELD_SHAPE:
+		{
+			const btBakedHeightfieldData* data = getData<btBakedHeightfieldData>(entry.m_dataOffset);
+			if (!data)
+				return 0;
+			int heightSize;
+			switch (data->m_heightDataType)
+			{
+			case PHY_FLOAT:
+				heightSize = sizeof(btScalar);
+				break;
+			case PHY_SHORT:
+				heightSize = sizeof(short);
+				break;
+			case PHY_UCHAR:
+				heightSize = sizeof(unsigned char);
+				break;
+			default:
+				return 0;
+			}
+			long long numHeights = (long long)data->m_heightStickWidth*data->m_heightStickLength;
+			if (data->m_heightStickWidth <= 1 || data->m_heightStickLength <= 1 || numHeights > INT_MAX ||
+				!isValidRange(data->m_heightsOffset,heightSize,int(numHeights)) || data->m_upAxis < 0 || data->m_upAxis > 2)
+				return 0;
+			btHeightfieldTerrainShape* heightfield = new btHeightfieldTerrainShape(data->m_heightStickWidth,data->m_heightStickLength,
+				m_data+data->m_heightsOffset,data->m_heightScale,data->m_minHeight,data->m_maxHeight,data->m_upAxis,
+				PHY_ScalarType(data->m_heightDataType),(data->m_flags & BT_BAKED_FLIP_QUAD_EDGES) != 0);
+			heightfield->setUseDiamondSubdivision((data->m_flags & BT_BAKED_DIAMOND_SUBDIVISION) != 0);
+			heightfield->setUseZigzagSubdivision((data->m_flags & BT_BAKED_ZIGZAG_SUBDIVISION) != 0);
+			heightfield->setLocalScaling(btBakedLoadVector(data->m_localScaling));
+			heightfield->setMargin(data->m_margin);
+			return heightfield;
+		}
+	case BT_BAKED_COMPOUND_SHAPE:
+		{
+			const btBakedCompoundData* data = getData<btBakedCompoundData>(entry.m_dataOffset);
+			const btBakedCompoundChildData* children = data ? getData<btBakedCompoundChildData>(data->m_childrenOffset,data->m_numChildren) : 0;
+			if (!children)
+				return 0;
+			btCompoundShape* compound = new btCompoundShape(true,data->m_numChildren);
+			for (int i=0;i<data->m_numChildren;i++)
+			{
+				//the children are created before the compound shape
+				int childIndex = children[i].m_childShapeIndex;
+				if (childIndex < 0 || childIndex >= m_collisionShapes.size())
+				{
+					delete compound;
+					return 0;
+				}
+				compound->addChildShape(btBakedLoadTransform(children[i].m_origin,children[i].m_rotation),m_collisionShapes[childIndex]);
+			}
+			compound->setMargin(data->m_margin);
+			return compound;
+		}
+	default:
+		return 0;
+	}
+}
+
+bool	btBakedCollisionLoader::createShapesAndObjects()
+{
+	const btBakedHeaderData* header = getData<btBakedHeaderData>(0);
+	if (!header || memcmp(header->m_magic,BT_BAKED_MAGIC,sizeof(BT_BAKED_MAGIC)) != 0 ||
+		header->m_version != BT_BAKED_VERSION || header->m_endianCheck != BT_BAKED_ENDIAN_CHECK ||
+		header->m_scalarSize != sizeof(btScalar) || header->m_fileSize > m_dataSize)
+	{
+		return false;
+	}
+	const btBakedShapeEntryData* entries = getData<btBakedShapeEntryData>(header->m_shapesOffset,header->m_numShapes);
+	const btBakedObjectData* objects = getData<btBakedObjectData>(header->m_objectsOffset,header->m_numObjects);
+	if (!entries || !objects)
+	{
+		return false;
+	}
+	m_collisionShapes.reserve(header->m_numShapes);
+	for (int i=0;i<header->m_numShapes;i++)
+	{
+		btCollisionShape* shape = createShape(entries[i]);
+		if (!shape)
+		{
+			return false;
+		}
+		m_collisionShapes.push_back(shape);
+	}
+	m_collisionObjects.reserve(header->m_numObjects);
+	for (int i=0;i<header->m_numObjects;i++)
+	{
+		const btBakedObjectData& data = objects[i];
+		if (data.m_shapeIndex < 0 || data.m_shapeIndex >= m_collisionShapes.size())
+		{
+			return false;
+		}
+		btCollisionObject* colObj = new btCollisionObject();
+		colObj->setWorldTransform(btBakedLoadTransform(data.m_origin,data.m_rotation));
+		colObj->setCollisionShape(m_collisionShapes[data.m_shapeIndex]);
+		colObj->setFriction(data.m_friction);
+		colObj->setRollingFriction(data.m_rollingFriction);
+		colObj->setRestitution(data.m_restitution);
+		colObj->setCollisionFlags(data.m_collisionFlags);
+		colObj->setUserIndex(data.m_userIndex);
+		m_collisionObjects.push_back(colObj);
+	}
+	return true;
+}
+
+bool	btBakedCollisionLoader::loadFromMemory(const void* data,int dataSize)
+{
+	reset();
+	if (((size_t)data) % BT_BAKED_ALIGNMENT)
+	{
+		return false;
+	}
+	m_data = (const char*)data;
+	m_dataSize = dataSize;
+	if (!createShapesAndObjects())
+	{
+		reset();
+		return false;
+	}
+	return true;
+}
+
+bool	btBakedCollisionLoader::loadFile(const char* fileName)
+{
+	reset();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName,GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,0);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file,&fileSize) || fileSize.QuadPart <= 0 || fileSize.QuadPart > INT_MAX)
+	{
+		CloseHandle(file);
+		return false;
+	}
+	HANDLE mapping = CreateFileMappingA(file,0,PAGE_READONLY,0,0,0);
+	void* mappedData = mapping ? MapViewOfFile(mapping,FILE_MAP_READ,0,0,0) : 0;
+	//the view keeps the mapping alive
+	if (mapping)
+	{
+		CloseHandle(mapping);
+	}
+	CloseHandle(file);
+	if (!mappedData)
+	{
+		return false;
+	}
+	m_mappedData = mappedData;
+	m_mappedSize = int(fileSize.QuadPart);
+#else
+	int fd = open(fileName,O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat fileStat;
+	if (fstat(fd,&fileStat) != 0 || fileStat.st_size <= 0 || fileStat.st_size > INT_MAX)
+	{
+		close(fd);
+		return false;
+	}
+	void* mappedData = mmap(0,size_t(fileStat.st_size),PROT_READ,MAP_PRIVATE,fd,0);
+	//the mapping stays valid after the file is closed
+	close(fd);
+	if (mappedData == MAP_FAILED)
+	{
+		return false;
+	}
+	m_mappedData = mappedData;
+	m_mappedSize = int(fileStat.st_size);
+#endif
+	m_data = (const char*)m_mappedData;
+	m_dataSize = m_mappedSize;
+	if (!createShapesAndObjects())
+	{
+		reset();
+		return false;
+	}
+	return true;
+}
+
+void	btBakedCollisionLoader::unmapFile()
+{
+	if (m_mappedData)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_mappedData);
+#else
+		munmap(m_mappedData,size_t(m_mappedSize));
+#endif
+		m_mappedData = 0;
+		m_mappedSize = 0;
+	}
+}
+
+void	btBakedCollisionLoader::reset()
+{
+	for (int i=0;i<m_collisionObjects.size();i++)
+	{
+		delete m_collisionObjects[i];
+	}
+	m_collisionObjects.clear();
+	//compound shapes come after their children, delete them first
+	for (int i=m_collisionShapes.size()-1;i>=0;i--)
+	{
+		delete m_collisionShapes[i];
+	}
+	m_collisionShapes.clear();
+	for (int i=0;i<m_bvhs.size();i++)
+	{
+		delete m_bvhs[i];
+	}
+	m_bvhs.clear();
+	for (int i=0;i<m_meshInterfaces.size();i++)
+	{
+		delete m_meshInterfaces[i];
+	}
+	m_meshInterfaces.clear();
+	unmapFile();
+	m_data = 0;
+	m_dataSize = 0;
+}
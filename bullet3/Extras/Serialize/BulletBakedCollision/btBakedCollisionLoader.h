@@ -0,0 +1,112 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_BAKED_COLLISION_LOADER_H
+#define BT_BAKED_COLLISION_LOADER_H
+
+#include "btBakedCollisionFormat.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+class btCollisionShape;
+class btCollisionObject;
+class btStridingMeshInterface;
+class btOptimizedBvh;
+
+///btBakedCollisionLoader uses the static collision data baked by btBakedCollisionWriter in place.
+///loadFile memory maps the file read-only, loadFromMemory uses data that is already in memory.
+///The loader creates the shapes and collision objects, and the shapes refer to the vertices, indices, quantized BVH nodes,
+///heights and points in the data, so the time to load does not depend on the size of the meshes and heightfields.
+///The loader checks the header and that every array lies within the data, it trusts the contents of the arrays.
+///Nothing may write to the baked data: don't refit or rebuild the BVH of a loaded btBvhTriangleMeshShape, or change its scaling.
+///The shapes and collision objects are owned by the loader, add the collision objects to a world and remove them before the loader is destroyed.
+class btBakedCollisionLoader
+{
+protected:
+
+	const char*	m_data;
+	int			m_dataSize;
+
+	// the memory mapping of loadFile
+	void*		m_mappedData;
+	int			m_mappedSize;
+
+	btAlignedObjectArray<btCollisionShape*>			m_collisionShapes;
+	btAlignedObjectArray<btStridingMeshInterface*>	m_meshInterfaces;
+	btAlignedObjectArray<btOptimizedBvh*>			m_bvhs;
+	btAlignedObjectArray<btCollisionObject*>		m_collisionObjects;
+
+	bool	isValidRange(int offset,int elementSize,int count) const;
+
+	template <typename T>
+	const T*	getData(int offset,int count=1) const
+	{
+		return isValidRange(offset,sizeof(T),count) ? (const T*)(m_data+offset) : 0;
+	}
+
+	btCollisionShape*	createShape(const btBakedShapeEntryData& entry);
+
+	bool	createShapesAndObjects();
+
+	void	unmapFile();
+
+public:
+
+	btBakedCollisionLoader();
+
+	virtual ~btBakedCollisionLoader();
+
+	///maps the file and creates its shapes and collision objects. Returns false when the file can not be mapped,
+	///or was not baked by btBakedCollisionWriter on a platform with the same endianness and btScalar precision
+	bool	loadFile(const char* fileName);
+
+	///uses baked data that is already in memory, 16 byte aligned. The data must stay valid and unchanged until reset
+	bool	loadFromMemory(const void* data,int dataSize);
+
+	///deletes the shapes and collision objects, and unmaps the file
+	void	reset();
+
+	int		getNumCollisionShapes() const
+	{
+		return m_collisionShapes.size();
+	}
+
+	btCollisionShape*	getCollisionShape(int index) const
+	{
+		return m_collisionShapes[index];
+	}
+
+	int		getNumCollisionObjects() const
+	{
+		return m_collisionObjects.size();
+	}
+
+	btCollisionObject*	getCollisionObject(int index) const
+	{
+		return m_collisionObjects[index];
+	}
+
+	///the baked data the shapes refer to
+	const void*	getData() const
+	{
+		return m_data;
+	}
+
+	int		getDataSize() const
+	{
+		return m_dataSize;
+	}
+};
+
+#endif //BT_BAKED_COLLISION_LOADER_H
@@ -0,0 +1,409 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btBakedCollisionWriter.h"
+#include "btBulletCollisionCommon.h"
+#include "BulletCollision/CollisionShapes/btConvexPointCloudShape.h"
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h"
+#include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+
+///appends count elements of elementSize bytes at the next aligned offset, and returns the offset, or -1 when the buffer would exceed INT_MAX bytes
+static int btBakedAppend(btAlignedObjectArray<char>& buffer,const void* data,int elementSize,int count)
+{
+	long long offset = (buffer.size()+BT_BAKED_ALIGNMENT-1)&~(BT_BAKED_ALIGNMENT-1);
+	long long size = (long long)elementSize*count;
+	if (offset+size > INT_MAX)
+	{
+		return -1;
+	}
+	buffer.resize(int(offset+size),0);
+	if (size)
+	{
+		memcpy(&buffer[int(offset)],data,size_t(size));
+	}
+	return int(offset);
+}
+
+static void btBakedStoreVector(btScalar* out,const btVector3& v)
+{
+	out[0] = v.getX();
+	out[1] = v.getY();
+	out[2] = v.getZ();
+}
+
+static void btBakedStoreTransform(btScalar* origin,btScalar* rotation,const btTransform& tr)
+{
+	btBakedStoreVector(origin,tr.getOrigin());
+	btQuaternion q = tr.getRotation();
+	rotation[0] = q.getX();
+	rotation[1] = q.getY();
+	rotation[2] = q.getZ();
+	rotation[3] = q.getW();
+}
+
+btBakedCollisionWriter::btBakedCollisionWriter()
+{
+}
+
+btBakedCollisionWriter::~btBakedCollisionWriter()
+{
+}
+
+int	btBakedCollisionWriter::addCollisionShape(const btCollisionShape* shape)
+{
+	const int* index = m_shapeIndices.find(shape);
+	if (index)
+	{
+		return *index;
+	}
+	switch (shape->getShapeType())
+	{
+	case BOX_SHAPE_PROXYTYPE:
+	case SPHERE_SHAPE_PROXYTYPE:
+	case CONVEX_HULL_SHAPE_PROXYTYPE:
+	case CONVEX_POINT_CLOUD_SHAPE_PROXYTYPE:
+	case TRIANGLE_MESH_SHAPE_PROXYTYPE:
+	case TERRAIN_SHAPE_PROXYTYPE:
+		break;
+	case COMPOUND_SHAPE_PROXYTYPE:
+		{
+			//the children are baked before the compound shape
+			const btCompoundShape* compound = static_cast<const btCompoundShape*>(shape);
+			for (int i=0;i<compound->getNumChildShapes();i++)
+			{
+				if (addCollisionShape(compound->getChildShape(i)) < 0)
+				{
+					return -1;
+				}
+			}
+			break;
+		}
+	default:
+		return -1;
+	}
+	int newIndex = m_shapes.size();
+	m_shapes.push_back(shape);
+	m_shapeIndices.insert(shape,newIndex);
+	return newIndex;
+}
+
+bool	btBakedCollisionWriter::addCollisionObject(const btCollisionObject* colObj)
+{
+	if (addCollisionShape(colObj->getCollisionShape()) < 0)
+	{
+		return false;
+	}
+	m_collisionObjects.push_back(colObj);
+	return true;
+}
+
+bool	btBakedCollisionWriter::bakeShape(const btCollisionShape* shape,btAlignedObjectArray<char>& buffer,btBakedShapeEntryData& entry) const
+{
+	switch (shape->getShapeType())
+	{
+	case BOX_SHAPE_PROXYTYPE:
+		{
+			const btBoxShape* box = static_cast<const btBoxShape*>(shape);
+			btBakedBoxData data;
+			btBakedStoreVector(data.m_halfExtentsWithMargin,box->getHalfExtentsWithMargin());
+			data.m_margin = box->getMargin();
+			entry.m_shapeType = BT_BAKED_BOX_SHAPE;
+			entry.m_dataOffset = btBakedAppend(buffer,&data,sizeof(data),1);
+			break;
+		}
+	case SPHERE_SHAPE_PROXYTYPE:
+		{
+			const btSphereShape* sphere = static_cast<const btSphereShape*>(shape);
+			btBakedSphereData data;
+			data.m_radius = sphere->getRadius();
+			entry.m_shapeType = BT_BAKED_SPHERE_SHAPE;
+			entry.m_dataOffset = btBakedAppend(buffer,&data,sizeof(data),1);
+			break;
+		}
+	case CONVEX_HULL_SHAPE_PROXYTYPE:
+	case CONVEX_POINT_CLOUD_SHAPE_PROXYTYPE:
+		{
+			btBakedConvexHullData data;
+			const btVector3* points;
+			if (shape->getShapeType()==CONVEX_HULL_SHAPE_PROXYTYPE)
+			{
+				const btConvexHullShape* hull = static_cast<const btConvexHullShape*>(shape);
+				points = hull->getUnscaledPoints();
+				data.m_numPoints = hull->getNumPoints();
+			} else
+			{
+				const btConvexPointCloudShape* cloud = static_cast<const btConvexPointCloudShape*>(shape);
+				points = cloud->getUnscaledPoints();
+				data.m_numPoints = cloud->getNumPoints();
+			}
+			data.m_pointsOffset = btBakedAppend(buffer,points,sizeof(btVector3),data.m_numPoints);
+			btBakedStoreVector(data.m_localScaling,shape->getLocalScaling());
+			data.m_margin = shape->getMargin();
+			entry.m_shapeType = BT_BAKED_CONVEX_HULL_SHAPE;
+			entry.m_dataOffset = data.m_pointsOffset < 0 ? -1 : btBakedAppend(buffer,&data,sizeof(data),1);
+			break;
+		}
+	case TRIANGLE_MESH_SHAPE_PROXYTYPE:
+		{
+			//convert the parts to scaled btScalar vertices and int indices
+			const btStridingMeshInterface* meshInterface = static_cast<const btBvhTriangleMeshShape*>(shape)->getMeshInterface();
+			const btVector3& scaling = meshInterface->getScaling();
+			const int numParts = meshInterface->getNumSubParts();
+			btAlignedObjectArray<btScalar> vertices;
+			btAlignedObjectArray<int> indices;
+			btAlignedObjectArray<btBakedMeshPartData> parts;
+			parts.resize(numParts);
+			btVector3 aabbMin(BT_LARGE_FLOAT,BT_LARGE_FLOAT,BT_LARGE_FLOAT);
+			btVector3 aabbMax(-BT_LARGE_FLOAT,-BT_LARGE_FLOAT,-BT_LARGE_FLOAT);
+			int numTriangles = 0;
+			for (int part=0;part<numParts;part++)
+			{
+				const unsigned char* vertexBase;
+				const unsigned char* indexBase;
+				int numVertices,vertexStride,indexStride,numFaces;
+				PHY_ScalarType vertexType,indexType;
+				meshInterface->getLockedReadOnlyVertexIndexBase(&vertexBase,numVertices,vertexType,vertexStride,&indexBase,indexStride,numFaces,indexType,part);
+				parts[part].m_numVertices = numVertices;
+				parts[part].m_verticesOffset = vertices.size();
+				parts[part].m_numTriangles = numFaces;
+				parts[part].m_indicesOffset = indices.size();
+				for (int v=0;v<numVertices;v++)
+				{
+					btVector3 vertex;
+					if (vertexType == PHY_FLOAT)
+					{
+						const float* graphicsbase = (const float*)(vertexBase+v*vertexStride);
+						vertex.setValue(graphicsbase[0],graphicsbase[1],graphicsbase[2]);
+					} else
+					{
+						btAssert(vertexType == PHY_DOUBLE);
+						const double* graphicsbase = (const double*)(vertexBase+v*vertexStride);
+						vertex.setValue(btScalar(graphicsbase[0]),btScalar(graphicsbase[1]),btScalar(graphicsbase[2]));
+					}
+					vertex *= scaling;
+					aabbMin.setMin(vertex);
+					aabbMax.setMax(vertex);
+					vertices.push_back(vertex.getX());
+					vertices.push_back(vertex.getY());
+					vertices.push_back(vertex.getZ());
+				}
+				for (int f=0;f<numFaces;f++)
+				{
+					const unsigned char* faceBase = indexBase+f*indexStride;
+					for (int j=0;j<3;j++)
+					{
+						switch (indexType)
+						{
+						case PHY_INTEGER:
+							indices.push_back(int(((const unsigned int*)faceBase)[j]));
+							break;
+						case PHY_SHORT:
+							indices.push_back(int(((const unsigned short*)faceBase)[j]));
+							break;
+						case PHY_UCHAR:
+							indices.push_back(int(faceBase[j]));
+							break;
+						default:
+							btAssert((indexType == PHY_INTEGER) || (indexType == PHY_SHORT) || (indexType == PHY_UCHAR));
+							indices.push_back(0);
+						}
+					}
+				}
+				meshInterface->unLockReadOnlyVertexBase(part);
+				numTriangles += numFaces;
+			}
+			if (numTriangles == 0)
+			{
+				return false;
+			}
+
+			//build the quantized BVH of the converted mesh, its nodes refer to the parts and triangles as they are baked
+			btTriangleIndexVertexArray convertedMesh;
+			for (int part=0;part<numParts;part++)
+			{
+				btIndexedMesh indexedMesh;
+				indexedMesh.m_numTriangles = parts[part].m_numTriangles;
+				indexedMesh.m_triangleIndexBase = (const unsigned char*)(parts[part].m_numTriangles ? &indices[parts[part].m_indicesOffset] : 0);
+				indexedMesh.m_triangleIndexStride = 3*sizeof(int);
+				indexedMesh.m_numVertices = parts[part].m_numVertices;
+				indexedMesh.m_vertexBase = (const unsigned char*)(parts[part].m_numVertices ? &vertices[parts[part].m_verticesOffset] : 0);
+				indexedMesh.m_vertexStride = 3*sizeof(btScalar);
+				convertedMesh.addIndexedMesh(indexedMesh,PHY_INTEGER);
+			}
+			btOptimizedBvh bvh;
+			bvh.build(&convertedMesh,true,aabbMin,aabbMax);
+
+			btBakedTriangleMeshData data;
+			for (int part=0;part<numParts;part++)
+			{
+				const btScalar* partVertices = parts[part].m_numVertices ? &vertices[parts[part].m_verticesOffset] : 0;
+				const int* partIndices = parts[part].m_numTriangles ? &indices[parts[part].m_indicesOffset] : 0;
+				parts[part].m_verticesOffset = btBakedAppend(buffer,partVertices,3*sizeof(btScalar),parts[part].m_numVertices);
+				parts[part].m_indicesOffset = btBakedAppend(buffer,partIndices,3*sizeof(int),parts[part].m_numTriangles);
+				if (parts[part].m_verticesOffset < 0 || parts[part].m_indicesOffset < 0)
+				{
+					return false;
+				}
+			}
+			data.m_numParts = numParts;
+			data.m_partsOffset = btBakedAppend(buffer,&parts[0],sizeof(btBakedMeshPartData),numParts);
+			//a tree with n leaves has 2n-1 nodes
+			data.m_numNodes = 2*numTriangles-1;
+			data.m_nodesOffset = btBakedAppend(buffer,&bvh.getQuantizedNodeArray()[0],sizeof(btQuantizedBvhNode),data.m_numNodes);
+			data.m_numSubtreeHeaders = bvh.getSubtreeInfoArray().size();
+			data.m_subtreeHeadersOffset = btBakedAppend(buffer,data.m_numSubtreeHeaders ? &bvh.getSubtreeInfoArray()[0] : 0,sizeof(btBvhSubtreeInfo),data.m_numSubtreeHeaders);
+			btBakedStoreVector(data.m_aabbMin,aabbMin);
+			btBakedStoreVector(data.m_aabbMax,aabbMax);
+			btBakedStoreVector(data.m_bvhAabbMin,bvh.getBvhAabbMin());
+			btBakedStoreVector(data.m_bvhAabbMax,bvh.getBvhAabbMax());
+			btBakedStoreVector(data.m_bvhQuantization,bvh.getBvhQuantization());
+			data.m_margin = shape->getMargin();
+			if (data.m_partsOffset < 0 || data.m_nodesOffset < 0 || data.m_subtreeHeadersOffset < 0)
+			{
+				return false;
+			}
+			entry.m_shapeType = BT_BAKED_TRIANGLE_MESH_SHAPE;
+			entry.m_dataOffset = btBakedAppend(buffer,&data,sizeof(data),1);
+			break;
+		}
+	case TERRAIN_SHAPE_PROXYTYPE:
+		{
+			const btHeightfieldTerrainShape* heightfield = static_cast<const btHeightfieldTerrainShape*>(shape);
+			int heightSize;
+			switch (heightfield->getHeightDataType())
+			{
+			case PHY_FLOAT:
+				heightSize = sizeof(btScalar);
+				break;
+			case PHY_SHORT:
+				heightSize = sizeof(short);
+				break;
+			case PHY_UCHAR:
+				heightSize = sizeof(unsigned char);
+				break;
+			default:
+				return false;
+			}
+			btBakedHeightfieldData data;
+			data.m_heightStickWidth = heightfield->getHeightStickWidth();
+			data.m_heightStickLength = heightfield->getHeightStickLength();
+			data.m_heightDataType = heightfield->getHeightDataType();
+			data.m_heightsOffset = btBakedAppend(buffer,heightfield->getHeightfieldRawData(),heightSize,data.m_heightStickWidth*data.m_heightStickLength);
+			data.m_upAxis = heightfield->getUpAxis();
+			data.m_flags = 0;
+			if (heightfield->getFlipQuadEdges())
+				data.m_flags |= BT_BAKED_FLIP_QUAD_EDGES;
+			if (heightfield->getUseDiamondSubdivision())
+				data.m_flags |= BT_BAKED_DIAMOND_SUBDIVISION;
+			if (heightfield->getUseZigzagSubdivision())
+				data.m_flags |= BT_BAKED_ZIGZAG_SUBDIVISION;
+			data.m_heightScale = heightfield->getHeightScale();
+			data.m_minHeight = heightfield->getMinHeight();
+			data.m_maxHeight = heightfield->getMaxHeight();
+			btBakedStoreVector(data.m_localScaling,heightfield->getLocalScaling());
+			data.m_margin = heightfield->getMargin();
+			entry.m_shapeType = BT_BAKED_HEIGHTFIELD_SHAPE;
+			entry.m_dataOffset = data.m_heightsOffset < 0 ? -1 : btBakedAppend(buffer,&data,sizeof(data),1);
+			break;
+		}
+	case COMPOUND_SHAPE_PROXYTYPE:
+		{
+			const btCompoundShape* compound = static_cast<const btCompoundShape*>(shape);
+			btAlignedObjectArray<btBakedCompoundChildData> children;
+			children.resize(compound->getNumChildShapes());
+			for (int i=0;i<children.size();i++)
+			{
+				btBakedStoreTransform(children[i].m_origin,children[i].m_rotation,compound->getChildTransform(i));
+				children[i].m_childShapeIndex = *m_shapeIndices.find(compound->getChildShape(i));
+			}
+			btBakedCompoundData data;
+			data.m_numChildren = children.size();
+			data.m_childrenOffset = btBakedAppend(buffer,children.size() ? &children[0] : 0,sizeof(btBakedCompoundChildData),children.size());
+			data.m_margin = compound->getMargin();
+			entry.m_shapeType = BT_BAKED_COMPOUND_SHAPE;
+			entry.m_dataOffset = data.m_childrenOffset < 0 ? -1 : btBakedAppend(buffer,&data,sizeof(data),1);
+			break;
+		}
+	default:
+		return false;
+	}
+	return entry.m_dataOffset >= 0;
+}
+
+bool	btBakedCollisionWriter::bake(btAlignedObjectArray<char>& buffer) const
+{
+	buffer.resize(0);
+	btBakedHeaderData header;
+	memset(&header,0,sizeof(header));
+	strcpy(header.m_magic,BT_BAKED_MAGIC);
+	header.m_version = BT_BAKED_VERSION;
+	header.m_endianCheck = BT_BAKED_ENDIAN_CHECK;
+	header.m_scalarSize = sizeof(btScalar);
+	//the header is written again when all offsets are known
+	btBakedAppend(buffer,&header,sizeof(header),1);
+
+	btAlignedObjectArray<btBakedShapeEntryData> entries;
+	entries.resize(m_shapes.size());
+	for (int i=0;i<m_shapes.size();i++)
+	{
+		if (!bakeShape(m_shapes[i],buffer,entries[i]))
+		{
+			return false;
+		}
+	}
+	btAlignedObjectArray<btBakedObjectData> objects;
+	objects.resize(m_collisionObjects.size());
+	for (int i=0;i<m_collisionObjects.size();i++)
+	{
+		const btCollisionObject* colObj = m_collisionObjects[i];
+		btBakedStoreTransform(objects[i].m_origin,objects[i].m_rotation,colObj->getWorldTransform());
+		objects[i].m_friction = colObj->getFriction();
+		objects[i].m_rollingFriction = colObj->getRollingFriction();
+		objects[i].m_restitution = colObj->getRestitution();
+		objects[i].m_shapeIndex = *m_shapeIndices.find(colObj->getCollisionShape());
+		objects[i].m_collisionFlags = colObj->getCollisionFlags();
+		objects[i].m_userIndex = colObj->getUserIndex();
+	}
+	header.m_numShapes = entries.size();
+	header.m_shapesOffset = btBakedAppend(buffer,entries.size() ? &entries[0] : 0,sizeof(btBakedShapeEntryData),entries.size());
+	header.m_numObjects = objects.size();
+	header.m_objectsOffset = btBakedAppend(buffer,objects.size() ? &objects[0] : 0,sizeof(btBakedObjectData),objects.size());
+	if (header.m_shapesOffset < 0 || header.m_objectsOffset < 0)
+	{
+		return false;
+	}
+	header.m_fileSize = buffer.size();
+	memcpy(&buffer[0],&header,sizeof(header));
+	return true;
+}
+
+bool	btBakedCollisionWriter::writeFile(const char* fileName) const
+{
+	btAlignedObjectArray<char> buffer;
+	if (!bake(buffer))
+	{
+		return false;
+	}
+	FILE* f = fopen(fileName,"wb");
+	if (!f)
+	{
+		return false;
+	}
+	bool written = fwrite(&buffer[0],buffer.size(),1,f) == 1;
+	return (fclose(f) == 0) && written;
+}
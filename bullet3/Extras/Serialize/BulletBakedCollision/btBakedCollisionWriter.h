@@ -0,0 +1,63 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2012 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_BAKED_COLLISION_WRITER_H
+#define BT_BAKED_COLLISION_WRITER_H
+
+#include "btBakedCollisionFormat.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+
+class btCollisionShape;
+class btCollisionObject;
+
+///btBakedCollisionWriter bakes static collision shapes and objects into the format of btBakedCollisionFormat.h, for btBakedCollisionLoader.
+///Supported are btBoxShape, btSphereShape, btConvexHullShape, btConvexPointCloudShape, btBvhTriangleMeshShape,
+///btHeightfieldTerrainShape and btCompoundShape of those. The quantized BVH of a triangle mesh is built while baking,
+///with the build mode of btQuantizedBvh::setBuildMode.
+class btBakedCollisionWriter
+{
+protected:
+
+	btAlignedObjectArray<const btCollisionShape*>	m_shapes;
+	btHashMap<btHashPtr,int>						m_shapeIndices;
+	btAlignedObjectArray<const btCollisionObject*>	m_collisionObjects;
+
+	bool	bakeShape(const btCollisionShape* shape,btAlignedObjectArray<char>& buffer,btBakedShapeEntryData& entry) const;
+
+public:
+
+	btBakedCollisionWriter();
+
+	virtual ~btBakedCollisionWriter();
+
+	///adds the shape, and the children of a compound shape, once. Returns the index of the shape, or -1 when it is not supported
+	int		addCollisionShape(const btCollisionShape* shape);
+
+	///adds the collision object and its shape. Returns false when the shape is not supported
+	bool	addCollisionObject(const btCollisionObject* colObj);
+
+	int		getNumCollisionShapes() const
+	{
+		return m_shapes.size();
+	}
+
+	///bakes the added shapes and objects into the buffer, which starts 16 byte aligned. Returns false when the data does not fit
+	bool	bake(btAlignedObjectArray<char>& buffer) const;
+
+	bool	writeFile(const char* fileName) const;
+};
+
+#endif //BT_BAKED_COLLISION_WRITER_H
@@ -0,0 +1,16 @@
+	project "BulletBakedCollision"
+		
+	kind "StaticLib"
+	
+	includedirs {
+		"../../../src"
+	}
+
+    if os.is("Linux") then
+        buildoptions{"-fPIC"}
+    end
+    	 
+	files {
+		"**.cpp",
+		"**.h"
+	}
@@ -5,5 +5,6 @@ include "ConvexDecomposition"
 include "InverseDynamics"
 include "Serialize/BulletFileLoader"
 include "Serialize/BulletWorldImporter"
+include "Serialize/BulletBakedCollision"
 include "Serialize/BulletXmlWorldImporter"
 include "obj2sdf"
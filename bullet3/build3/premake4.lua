@@ -393,6 +393,7 @@ end
 		include "../examples/OpenGLWindow"
 		include "../examples/ThirdPartyLibs/Gwen"
 		include "../examples/HelloWorld"
+		include "../examples/Benchmarks"
 		include "../examples/SharedMemory"
 		include "../examples/ThirdPartyLibs/BussIK"
 
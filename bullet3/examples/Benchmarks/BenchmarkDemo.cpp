@@ -27,6 +27,9 @@ subject to the following restrictions:
 #include "TaruData.h"
 #include "landscapeData.h"
 #include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
+#include "LinearMath/btConvexHullComputer.h"
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h"
 
 #include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
 
@@ -58,6 +61,9 @@ class BenchmarkDemo : public CommonRigidBodyMTBase
 	//keep the collision shapes, for deletion/cleanup
 
 	btAlignedObjectArray<class RagDoll*>	m_ragdolls;
+
+	//heights of the terrain of benchmark 10, the shape refers to them
+	btAlignedObjectArray<short>	m_terrainHeights;
 	
 	int	m_benchmark;
 
@@ -76,6 +82,9 @@ class BenchmarkDemo : public CommonRigidBodyMTBase
 	void	createTest5();
 	void	createTest6();
 	void	createTest7();
+	void	createTest8();
+	void	createTest9();
+	void	createTest10();
 
 	void createWall(const btVector3& offsetPosition,int stackSize,const btVector3& boxSize);
 	void createPyramid(const btVector3& offsetPosition,int stackSize,const btVector3& boxSize);
@@ -229,6 +238,27 @@ public:
         }
     }
 
+    void castRaysBatch( btCollisionWorld* cw )
+    {
+        const btCollisionObject* objects[NUMRAYS];
+        btScalar fractions[NUMRAYS];
+        btCollisionWorld::RayBatchResults results;
+        results.m_collisionObjects = objects;
+        results.m_hitFractions = fractions;
+        results.m_hitPointWorld = hit;
+        results.m_hitNormalWorld = normal;
+        cw->rayTestBatch(source, dest, NUMRAYS, results);
+        for ( int i = 0; i < NUMRAYS; ++i )
+        {
+            if (objects[i])
+            {
+                normal[i].normalize ();
+            } else {
+                normal[i] = btVector3(1.0, 0.0, 0.0);
+            }
+        }
+    }
+
     struct CastRaysLoopBody : public btIParallelForBody
     {
         btCollisionWorld* mWorld;
@@ -242,7 +272,7 @@ public:
         }
     };
 
-	void cast (btCollisionWorld* cw, bool multiThreading = false)
+	void cast (btCollisionWorld* cw, bool multiThreading = false, bool batch = false)
 	{
 		BT_PROFILE("cast");
 
@@ -268,6 +298,12 @@ public:
 				normal[i].normalize ();
 		}
 #else
+        if ( batch )
+        {
+            // rayTestBatch parallelizes by itself
+            castRaysBatch(cw);
+        }
+        else
 #if USE_PARALLEL_RAYCASTS
         if ( multiThreading )
         {
@@ -302,7 +338,8 @@ public:
 	void draw ()
 	{
 		
-		if (m_guiHelper)
+		//headless runs have no render interface
+		if (m_guiHelper && m_guiHelper->getRenderInterface())
 		{
 			btAlignedObjectArray<unsigned int> indices;
 			btAlignedObjectArray<btVector3FloatData> points;
@@ -371,7 +408,7 @@ void BenchmarkDemo::stepSimulation(float deltaTime)
 		m_dynamicsWorld->stepSimulation(deltaTime);
 	}
 	
-	if (m_benchmark==7)
+	if (m_benchmark==7 || m_benchmark==8)
 	{
 		castRays();
 
@@ -504,6 +541,21 @@ void	BenchmarkDemo::initPhysics()
 			createTest7();
 			break;
 		}
+		case 8:
+		{
+			createTest8();
+			break;
+		}
+		case 9:
+		{
+			createTest9();
+			break;
+		}
+		case 10:
+		{
+			createTest10();
+			break;
+		}
 
 
 	default:
@@ -1280,7 +1332,7 @@ void BenchmarkDemo::initRays()
 
 void BenchmarkDemo::castRays()
 {
-	raycastBar.cast (m_dynamicsWorld, m_multithreadedWorld);
+	raycastBar.cast (m_dynamicsWorld, m_multithreadedWorld, m_benchmark==8);
 }
 
 void	BenchmarkDemo::createTest7()
@@ -1291,6 +1343,318 @@ void	BenchmarkDemo::createTest7()
 	initRays();
 }
 
+void	BenchmarkDemo::createTest8()
+{
+	createTest7();
+}
+
+struct MeshBvhRayCallback : public btTriangleRaycastCallback
+{
+	MeshBvhRayCallback(const btVector3& from,const btVector3& to)
+		:btTriangleRaycastCallback(from,to)
+	{
+	}
+
+	virtual btScalar reportHit(const btVector3& hitNormalLocal, btScalar hitFraction, int partId, int triangleIndex)
+	{
+		//keep the closest hit
+		return hitFraction;
+	}
+};
+
+struct MeshBvhConvexcastCallback : public btTriangleConvexcastCallback
+{
+	MeshBvhConvexcastCallback(const btConvexShape* convexShape,const btTransform& from,const btTransform& to)
+		:btTriangleConvexcastCallback(convexShape,from,to,btTransform::getIdentity(),btScalar(0.))
+	{
+	}
+
+	virtual btScalar reportHit(const btVector3& hitNormalLocal, const btVector3& hitPointLocal, btScalar hitFraction, int partId, int triangleIndex)
+	{
+		m_hitFraction = hitFraction;
+		return hitFraction;
+	}
+};
+
+///builds the tree of a large btBvhTriangleMeshShape with each btQuantizedBvh::btBuildMode,
+///and measures the throughput of ray and convex casts against the mesh
+void	BenchmarkDemo::createTest9()
+{
+	setCameraDistance(btScalar(250.));
+
+	//tile the landscape and scatter copies of the Taru hull over it
+	const int numTiles = 4;
+	const btScalar tileSize = btScalar(250.);
+	btAlignedObjectArray<btScalar> vertices;
+	btAlignedObjectArray<int> indices;
+	for (int tx=0;tx<numTiles;tx++)
+	{
+		for (int tz=0;tz<numTiles;tz++)
+		{
+			for (int part=0;part<8;part++)
+			{
+				int base = vertices.size()/3;
+				for (int i=0;i<LandscapeVtxCount[part];i++)
+				{
+					vertices.push_back(LandscapeVtx[part][i*3]+tx*tileSize);
+					vertices.push_back(LandscapeVtx[part][i*3+1]);
+					vertices.push_back(LandscapeVtx[part][i*3+2]+tz*tileSize);
+				}
+				for (int i=0;i<LandscapeIdxCount[part];i++)
+				{
+					indices.push_back(base+LandscapeIdx[part][i]);
+				}
+			}
+		}
+	}
+	btConvexHullComputer taruHull;
+	taruHull.compute(TaruVtx,sizeof(float)*3,TaruVtxCount,0.f,0.f);
+	btAlignedObjectArray<int> taruIndices;
+	for (int f=0;f<taruHull.faces.size();f++)
+	{
+		//triangle fan of each face
+		const btConvexHullComputer::Edge* firstEdge = &taruHull.edges[taruHull.faces[f]];
+		const btConvexHullComputer::Edge* edge = firstEdge->getNextEdgeOfFace();
+		int v1 = edge->getSourceVertex();
+		for (edge = edge->getNextEdgeOfFace();edge!=firstEdge;edge = edge->getNextEdgeOfFace())
+		{
+			int v2 = edge->getSourceVertex();
+			taruIndices.push_back(firstEdge->getSourceVertex());
+			taruIndices.push_back(v1);
+			taruIndices.push_back(v2);
+			v1 = v2;
+		}
+	}
+	unsigned int seed = 12345;
+	const int numTarus = 4096;
+	for (int t=0;t<numTarus;t++)
+	{
+		seed = seed*1664525+1013904223;
+		btScalar x = btScalar(seed>>8)/btScalar(1<<24)*numTiles*tileSize;
+		seed = seed*1664525+1013904223;
+		btScalar z = btScalar(seed>>8)/btScalar(1<<24)*numTiles*tileSize;
+		int base = vertices.size()/3;
+		for (int i=0;i<taruHull.vertices.size();i++)
+		{
+			btVector3 vtx = taruHull.vertices[i]*btScalar(2.)+btVector3(x,btScalar(20.),z);
+			vertices.push_back(vtx.getX());
+			vertices.push_back(vtx.getY());
+			vertices.push_back(vtx.getZ());
+		}
+		for (int i=0;i<taruIndices.size();i++)
+		{
+			indices.push_back(base+taruIndices[i]);
+		}
+	}
+	btTriangleIndexVertexArray meshInterface(indices.size()/3,&indices[0],sizeof(int)*3,vertices.size()/3,&vertices[0],sizeof(btScalar)*3);
+
+	//rays and casts of a small sphere from above the mesh, down and sideways
+	const int numRays = 20000;
+	const int numConvexCasts = 2000;
+	btAlignedObjectArray<btVector3> rayFrom;
+	btAlignedObjectArray<btVector3> rayTo;
+	for (int i=0;i<numRays;i++)
+	{
+		seed = seed*1664525+1013904223;
+		btScalar x = btScalar(seed>>8)/btScalar(1<<24)*numTiles*tileSize;
+		seed = seed*1664525+1013904223;
+		btScalar z = btScalar(seed>>8)/btScalar(1<<24)*numTiles*tileSize;
+		seed = seed*1664525+1013904223;
+		btScalar dx = btScalar(int(seed>>24)-128)*btScalar(0.4);
+		rayFrom.push_back(btVector3(x,btScalar(100.),z));
+		rayTo.push_back(btVector3(x+dx,btScalar(-100.),z-dx));
+	}
+	btSphereShape sphere(btScalar(1.));
+	btVector3 sphereMin(-1,-1,-1);
+	btVector3 sphereMax(1,1,1);
+
+	btQuantizedBvh::btBuildMode prevBuildMode = btQuantizedBvh::getBuildMode();
+	const char* buildModeNames[2] = {"mean split","SAH binned"};
+	for (int mode=0;mode<2;mode++)
+	{
+		btQuantizedBvh::setBuildMode(mode==0 ? btQuantizedBvh::BUILD_MEAN_SPLIT : btQuantizedBvh::BUILD_SAH_BINNED);
+		btClock clock;
+		btBvhTriangleMeshShape* trimeshShape = new btBvhTriangleMeshShape(&meshInterface,true);
+		unsigned long long int buildUs = clock.getTimeMicroseconds();
+
+		int rayHits = 0;
+		clock.reset();
+		for (int i=0;i<numRays;i++)
+		{
+			MeshBvhRayCallback cb(rayFrom[i],rayTo[i]);
+			trimeshShape->performRaycast(&cb,rayFrom[i],rayTo[i]);
+			rayHits += cb.m_hitFraction < btScalar(1.) ? 1 : 0;
+		}
+		unsigned long long int rayUs = btMax(clock.getTimeMicroseconds(),(unsigned long long int)1);
+
+		int convexHits = 0;
+		clock.reset();
+		for (int i=0;i<numConvexCasts;i++)
+		{
+			btTransform from(btQuaternion::getIdentity(),rayFrom[i]);
+			btTransform to(btQuaternion::getIdentity(),rayTo[i]);
+			MeshBvhConvexcastCallback cb(&sphere,from,to);
+			trimeshShape->performConvexcast(&cb,rayFrom[i],rayTo[i],sphereMin,sphereMax);
+			convexHits += cb.m_hitFraction < btScalar(1.) ? 1 : 0;
+		}
+		unsigned long long int convexUs = btMax(clock.getTimeMicroseconds(),(unsigned long long int)1);
+
+		printf("%s: %d triangles, build %.1f ms, %.0f rays/s (%d hits), %.0f convex casts/s (%d hits)\n",
+			buildModeNames[mode],indices.size()/3,buildUs*0.001,
+			numRays*1e6/rayUs,rayHits,numConvexCasts*1e6/convexUs,convexHits);
+		delete trimeshShape;
+	}
+	btQuantizedBvh::setBuildMode(prevBuildMode);
+
+	createLargeMeshBody();
+}
+
+struct HeightfieldRayCallback : public btTriangleRaycastCallback
+{
+	int m_numTriangles;
+
+	HeightfieldRayCallback(const btVector3& from,const btVector3& to)
+		:btTriangleRaycastCallback(from,to),
+		m_numTriangles(0)
+	{
+	}
+
+	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+	{
+		m_numTriangles++;
+		btTriangleRaycastCallback::processTriangle(triangle,partId,triangleIndex);
+	}
+
+	virtual btScalar reportHit(const btVector3& hitNormalLocal, btScalar hitFraction, int partId, int triangleIndex)
+	{
+		return hitFraction;
+	}
+};
+
+static short heightfieldBenchmarkHeight(int x,int j)
+{
+	//a few octaves of ridges and valleys, in centimeters
+	btScalar h = btScalar(0.);
+	btScalar amplitude = btScalar(3000.);
+	btScalar frequency = btScalar(0.002);
+	for (int octave=0;octave<6;octave++)
+	{
+		h += amplitude*btSin(x*frequency+octave*btScalar(1.7))*btCos(j*frequency*btScalar(1.3)+octave*btScalar(0.6));
+		amplitude *= btScalar(0.45);
+		frequency *= btScalar(2.1);
+	}
+	return short(h);
+}
+
+///casts long grazing rays and short vertical rays against a 4097x4097 btHeightfieldTerrainShape: over all cells in the
+///aabb of the ray (the former rayTest path), with the cell walk of performRaycast, and with the walk over the min/max pyramid
+void	BenchmarkDemo::createTest10()
+{
+	setCameraDistance(btScalar(150.));
+
+	const int size = 4097;
+	const btScalar heightScale = btScalar(0.01);
+	m_terrainHeights.resize(size*size);
+	for (int j=0;j<size;j++)
+	{
+		for (int x=0;x<size;x++)
+		{
+			m_terrainHeights[j*size+x] = heightfieldBenchmarkHeight(x,j);
+		}
+	}
+	btHeightfieldTerrainShape* terrain = new btHeightfieldTerrainShape(size,size,&m_terrainHeights[0],heightScale,btScalar(-60.),btScalar(60.),1,PHY_SHORT,false);
+
+	unsigned int seed = 12345;
+	const int numLongRays = 2000;
+	const int numShortRays = 20000;
+	btAlignedObjectArray<btVector3> rayFrom;
+	btAlignedObjectArray<btVector3> rayTo;
+	for (int i=0;i<numLongRays+numShortRays;i++)
+	{
+		seed = seed*1664525+1013904223;
+		btScalar x = (btScalar(seed>>8)/btScalar(1<<24)-btScalar(0.5))*(size-1);
+		seed = seed*1664525+1013904223;
+		btScalar z = (btScalar(seed>>8)/btScalar(1<<24)-btScalar(0.5))*(size-1);
+		seed = seed*1664525+1013904223;
+		btScalar angle = btScalar(seed>>8)/btScalar(1<<24)*SIMD_2_PI;
+		if (i<numLongRays)
+		{
+			//from just above the ground, nearly level, across a good part of the terrain
+			btScalar y = btScalar(heightfieldBenchmarkHeight(int(x)+size/2,int(z)+size/2))*heightScale+btScalar(2.);
+			btVector3 dir(btCos(angle),btScalar(-0.002),btSin(angle));
+			rayFrom.push_back(btVector3(x,y,z));
+			rayTo.push_back(btVector3(x,y,z)+dir*btScalar(3000.));
+		} else
+		{
+			rayFrom.push_back(btVector3(x,btScalar(80.),z));
+			rayTo.push_back(btVector3(x+btCos(angle)*btScalar(10.),btScalar(-80.),z+btSin(angle)*btScalar(10.)));
+		}
+	}
+
+	const char* methodNames[3] = {"cells in ray aabb","cell walk","cell walk, min/max pyramid"};
+	for (int method=0;method<3;method++)
+	{
+		btClock clock;
+		if (method==2)
+		{
+			terrain->buildAccelerator();
+			printf("min/max pyramid built in %.1f ms\n",clock.getTimeMicroseconds()*0.001);
+		}
+		for (int type=0;type<2;type++)
+		{
+			int begin = type==0 ? 0 : numLongRays;
+			int end = type==0 ? numLongRays : numLongRays+numShortRays;
+			//visiting all cells in the aabb of a long ray takes a while, only cast a few
+			if (method==0 && type==0)
+				end = 20;
+			long long int numTriangles = 0;
+			int numHits = 0;
+			clock.reset();
+			for (int i=begin;i<end;i++)
+			{
+				HeightfieldRayCallback cb(rayFrom[i],rayTo[i]);
+				if (method==0)
+				{
+					btVector3 aabbMin = rayFrom[i];
+					aabbMin.setMin(rayTo[i]);
+					btVector3 aabbMax = rayFrom[i];
+					aabbMax.setMax(rayTo[i]);
+					terrain->processAllTriangles(&cb,aabbMin,aabbMax);
+				} else
+				{
+					terrain->performRaycast(&cb,rayFrom[i],rayTo[i],&cb.m_hitFraction);
+				}
+				numTriangles += cb.m_numTriangles;
+				numHits += cb.m_hitFraction < btScalar(1.) ? 1 : 0;
+			}
+			unsigned long long int us = btMax(clock.getTimeMicroseconds(),(unsigned long long int)1);
+			printf("%s, %s rays: %.0f rays/s, %.0f triangles per ray, %d/%d hits\n",methodNames[method],
+				type==0 ? "long grazing" : "short vertical",(end-begin)*1e6/us,double(numTriangles)/(end-begin),numHits,end-begin);
+		}
+	}
+	delete terrain;
+
+	//a coarser copy of the terrain to drop boxes on, subsampled in place
+	const int step = 32;
+	const int coarseSize = (size-1)/step+1;
+	for (int j=0;j<coarseSize;j++)
+	{
+		for (int x=0;x<coarseSize;x++)
+		{
+			m_terrainHeights[j*coarseSize+x] = m_terrainHeights[j*step*size+x*step];
+		}
+	}
+	m_terrainHeights.resize(coarseSize*coarseSize);
+	btHeightfieldTerrainShape* coarseTerrain = new btHeightfieldTerrainShape(coarseSize,coarseSize,&m_terrainHeights[0],heightScale*btScalar(0.2),btScalar(-12.),btScalar(12.),1,PHY_SHORT,false);
+	coarseTerrain->setLocalScaling(btVector3(2,1,2));
+	coarseTerrain->buildAccelerator();
+	m_collisionShapes.push_back(coarseTerrain);
+	btTransform trans;
+	trans.setIdentity();
+	createRigidBody(0,trans,coarseTerrain);
+	createPyramid(btVector3(-20.0f,15.0f,0.0f),8,btVector3(1,1,1));
+}
+
 void	BenchmarkDemo::exitPhysics()
 {
 	int i;
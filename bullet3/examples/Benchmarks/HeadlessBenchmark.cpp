@@ -0,0 +1,707 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2015 Google Inc. http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///App_HeadlessBenchmark runs the scenes of BenchmarkDemo without graphics, for a number of steps each,
+///and writes the step rate, the btQuickprof timings of the stages and the memory peak as JSON.
+///The results can be compared against a stored baseline, the exit code is 1 when a scene regressed.
+///
+///usage: App_HeadlessBenchmark [--benchmark=1,3] [--steps=300] [--warmup=10]
+///                             [--scheduler=Sequential|ThreadSupport|OpenMP|IntelTBB|PPL] [--threads=4]
+///                             [--output=benchmark.json] [--baseline=baseline.json] [--tolerance=0.1]
+
+#include "BenchmarkDemo.h"
+#include "../CommonInterfaces/CommonExampleInterface.h"
+#include "../CommonInterfaces/CommonGUIHelperInterface.h"
+#include "../CommonInterfaces/CommonParameterInterface.h"
+#include "Bullet3Common/b3CommandLineArgs.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btAlignedAllocator.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btMinMax.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+static const char* sBenchmarkNames[] =
+{
+	"3000 boxes",
+	"1000 stack",
+	"Ragdolls",
+	"Convex stack",
+	"Prim vs Mesh",
+	"Convex vs Mesh",
+	"Raycast",
+	"Raycast batch",
+	"Mesh BVH",
+	"Heightfield raycast",
+};
+
+static const int sNumBenchmarks = int(sizeof(sBenchmarkNames) / sizeof(sBenchmarkNames[0]));
+
+///the sliders and buttons of CommonRigidBodyMTBase have nowhere to go without a GUI
+struct HeadlessParameterInterface : public CommonParameterInterface
+{
+	virtual void registerSliderFloatParameter(SliderParams& params) {}
+	virtual void registerButtonParameter(ButtonParams& params) {}
+	virtual void registerComboBox(ComboBoxParams& params) {}
+	virtual void syncParameters() {}
+	virtual void removeAllParameters() {}
+	virtual void setSliderValue(int sliderIndex, double sliderValue) {}
+};
+
+struct HeadlessGUIHelper : public DummyGUIHelper
+{
+	HeadlessParameterInterface m_parameterInterface;
+
+	virtual CommonParameterInterface* getParameterInterface()
+	{
+		return &m_parameterInterface;
+	}
+};
+
+
+///all Bullet allocations go through these, the size is kept in front of each block
+///so the number of live bytes, and their peak, are known when a block is freed
+static btSpinMutex sMemoryMutex;
+static size_t sLiveBytes = 0;
+static size_t sPeakBytes = 0;
+static const size_t sSizeHeader = 16;
+
+static void* countingAlloc(size_t size)
+{
+	char* block = (char*)malloc(size + sSizeHeader);
+	if (!block)
+		return 0;
+	*(size_t*)block = size;
+	sMemoryMutex.lock();
+	sLiveBytes += size;
+	if (sLiveBytes > sPeakBytes)
+		sPeakBytes = sLiveBytes;
+	sMemoryMutex.unlock();
+	return block + sSizeHeader;
+}
+
+static void countingFree(void* ptr)
+{
+	if (!ptr)
+		return;
+	char* block = (char*)ptr - sSizeHeader;
+	sMemoryMutex.lock();
+	sLiveBytes -= *(size_t*)block;
+	sMemoryMutex.unlock();
+	free(block);
+}
+
+static void resetPeakBytes()
+{
+	sMemoryMutex.lock();
+	sPeakBytes = sLiveBytes;
+	sMemoryMutex.unlock();
+}
+
+///peak resident set size of the process in bytes, or 0 when it is not known on this platform
+static unsigned long long getProcessPeakBytes()
+{
+#ifndef _WIN32
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+	{
+#ifdef __APPLE__
+		return (unsigned long long)usage.ru_maxrss;
+#else
+		return (unsigned long long)usage.ru_maxrss * 1024;
+#endif
+	}
+#endif
+	return 0;
+}
+
+
+static btITaskScheduler* sCreatedTaskScheduler = 0;
+
+#if BT_THREADSAFE
+///finds the task scheduler by the name it reports, the default one is created on first use.
+///The example constructor may already have made the requested one current, then that one is used.
+static btITaskScheduler* findTaskScheduler(const std::string& name)
+{
+	btITaskScheduler* candidates[6];
+	int numCandidates = 0;
+	candidates[numCandidates++] = btGetTaskScheduler();
+	candidates[numCandidates++] = btGetSequentialTaskScheduler();
+	candidates[numCandidates++] = sCreatedTaskScheduler;
+	candidates[numCandidates++] = btGetOpenMPTaskScheduler();
+	candidates[numCandidates++] = btGetTBBTaskScheduler();
+	candidates[numCandidates++] = btGetPPLTaskScheduler();
+	for (int i = 0; i < numCandidates; i++)
+	{
+		if (candidates[i] && name == candidates[i]->getName())
+			return candidates[i];
+	}
+	if (!sCreatedTaskScheduler && name == "ThreadSupport")
+	{
+		sCreatedTaskScheduler = btCreateDefaultTaskScheduler();
+		return sCreatedTaskScheduler;
+	}
+	return 0;
+}
+#endif //BT_THREADSAFE
+
+
+struct StageResult
+{
+	std::string m_name;
+	int m_calls;
+	double m_totalMs;
+};
+
+struct BenchmarkResult
+{
+	int m_benchmark;
+	int m_steps;
+	int m_threads;
+	double m_initMs;
+	double m_totalMs;
+	unsigned long long m_peakAllocatedBytes;
+	std::vector<StageResult> m_stages;
+};
+
+///adds the btQuickprof tree below the iterator to the stages, the names are the paths from the root.
+///stepSimulation resets the profiler, so the tree only holds the last step and is added after each one
+static void accumulateStages(CProfileIterator* iterator, const std::string& parentPath, std::vector<StageResult>& stages, std::map<std::string, int>& stageIndices)
+{
+	int numChildren = 0;
+	for (iterator->First(); !iterator->Is_Done(); iterator->Next())
+	{
+		numChildren++;
+		//nodes of earlier steps stay in the tree without calls
+		if (iterator->Get_Current_Total_Calls() == 0)
+			continue;
+		std::string name = parentPath + iterator->Get_Current_Name();
+		std::map<std::string, int>::iterator found = stageIndices.find(name);
+		if (found == stageIndices.end())
+		{
+			StageResult stage;
+			stage.m_name = name;
+			stage.m_calls = 0;
+			stage.m_totalMs = 0;
+			found = stageIndices.insert(std::make_pair(name, int(stages.size()))).first;
+			stages.push_back(stage);
+		}
+		stages[found->second].m_calls += iterator->Get_Current_Total_Calls();
+		stages[found->second].m_totalMs += iterator->Get_Current_Total_Time();
+	}
+	for (int i = 0; i < numChildren; i++)
+	{
+		iterator->Enter_Child(i);
+		accumulateStages(iterator, parentPath + iterator->Get_Current_Parent_Name() + "/", stages, stageIndices);
+		iterator->Enter_Parent();
+	}
+}
+
+static bool runBenchmark(int benchmark, int numSteps, int numWarmupSteps, const std::string& schedulerName, int numThreads, BenchmarkResult& result)
+{
+	HeadlessGUIHelper noGfx;
+	CommonExampleOptions options(&noGfx, benchmark);
+	CommonExampleInterface* example = BenchmarkCreateFunc(options);
+
+	result.m_benchmark = benchmark;
+	result.m_steps = numSteps;
+	result.m_threads = 1;
+#if BT_THREADSAFE
+	btITaskScheduler* scheduler = findTaskScheduler(schedulerName);
+	if (!scheduler)
+	{
+		fprintf(stderr, "task scheduler %s is not available\n", schedulerName.c_str());
+		delete example;
+		return false;
+	}
+	btSetTaskScheduler(scheduler);
+	if (numThreads > 0)
+	{
+		scheduler->setNumThreads(btMin(numThreads, scheduler->getMaxNumThreads()));
+	}
+	result.m_threads = scheduler->getNumThreads();
+#else
+	if (schedulerName != "Sequential")
+	{
+		fprintf(stderr, "task scheduler %s needs a build with BULLET2_MULTITHREADING\n", schedulerName.c_str());
+		delete example;
+		return false;
+	}
+#endif //BT_THREADSAFE
+
+	const float timeStep = 1.f / 60.f;
+	btClock clock;
+	resetPeakBytes();
+	example->initPhysics();
+	result.m_initMs = clock.getTimeMicroseconds() * 0.001;
+	for (int i = 0; i < numWarmupSteps; i++)
+	{
+		example->stepSimulation(timeStep);
+	}
+
+	std::map<std::string, int> stageIndices;
+	unsigned long long totalMicroseconds = 0;
+	for (int i = 0; i < numSteps; i++)
+	{
+		clock.reset();
+		example->stepSimulation(timeStep);
+		totalMicroseconds += clock.getTimeMicroseconds();
+
+		CProfileIterator* iterator = CProfileManager::Get_Iterator();
+		if (iterator)
+		{
+			accumulateStages(iterator, "", result.m_stages, stageIndices);
+			CProfileManager::Release_Iterator(iterator);
+		}
+	}
+	result.m_totalMs = totalMicroseconds * 0.001;
+
+	example->exitPhysics();
+	delete example;
+	result.m_peakAllocatedBytes = sPeakBytes;
+	return true;
+}
+
+
+///a small JSON reader for the baseline, it knows objects, arrays, strings, numbers and literals
+struct JsonValue
+{
+	enum Type
+	{
+		JSON_NULL,
+		JSON_BOOL,
+		JSON_NUMBER,
+		JSON_STRING,
+		JSON_ARRAY,
+		JSON_OBJECT
+	};
+	Type m_type;
+	double m_number;
+	std::string m_string;
+	std::vector<JsonValue> m_elements;
+	std::vector<std::string> m_keys;
+
+	JsonValue() : m_type(JSON_NULL), m_number(0) {}
+
+	const JsonValue* find(const char* key) const
+	{
+		for (size_t i = 0; i < m_keys.size(); i++)
+		{
+			if (m_keys[i] == key)
+				return &m_elements[i];
+		}
+		return 0;
+	}
+
+	double getNumber(const char* key, double defaultValue) const
+	{
+		const JsonValue* value = find(key);
+		return (value && value->m_type == JSON_NUMBER) ? value->m_number : defaultValue;
+	}
+};
+
+struct JsonReader
+{
+	const char* m_pos;
+
+	void skipSpace()
+	{
+		while (*m_pos == ' ' || *m_pos == '\t' || *m_pos == '\n' || *m_pos == '\r')
+			m_pos++;
+	}
+
+	bool readString(std::string& str)
+	{
+		if (*m_pos != '"')
+			return false;
+		m_pos++;
+		while (*m_pos && *m_pos != '"')
+		{
+			if (*m_pos == '\\' && m_pos[1])
+			{
+				m_pos++;
+				switch (*m_pos)
+				{
+					case 'n': str += '\n'; break;
+					case 't': str += '\t'; break;
+					case 'r': str += '\r'; break;
+					default: str += *m_pos;
+				}
+			}
+			else
+			{
+				str += *m_pos;
+			}
+			m_pos++;
+		}
+		if (*m_pos != '"')
+			return false;
+		m_pos++;
+		return true;
+	}
+
+	bool readValue(JsonValue& value)
+	{
+		skipSpace();
+		if (*m_pos == '{' || *m_pos == '[')
+		{
+			bool isObject = (*m_pos == '{');
+			char closing = isObject ? '}' : ']';
+			value.m_type = isObject ? JsonValue::JSON_OBJECT : JsonValue::JSON_ARRAY;
+			m_pos++;
+			skipSpace();
+			if (*m_pos == closing)
+			{
+				m_pos++;
+				return true;
+			}
+			while (true)
+			{
+				if (isObject)
+				{
+					skipSpace();
+					std::string key;
+					if (!readString(key))
+						return false;
+					skipSpace();
+					if (*m_pos != ':')
+						return false;
+					m_pos++;
+					value.m_keys.push_back(key);
+				}
+				value.m_elements.push_back(JsonValue());
+				if (!readValue(value.m_elements.back()))
+					return false;
+				skipSpace();
+				if (*m_pos == ',')
+				{
+					m_pos++;
+					continue;
+				}
+				if (*m_pos != closing)
+					return false;
+				m_pos++;
+				return true;
+			}
+		}
+		if (*m_pos == '"')
+		{
+			value.m_type = JsonValue::JSON_STRING;
+			return readString(value.m_string);
+		}
+		if (strncmp(m_pos, "true", 4) == 0 || strncmp(m_pos, "false", 5) == 0)
+		{
+			value.m_type = JsonValue::JSON_BOOL;
+			value.m_number = (*m_pos == 't') ? 1 : 0;
+			m_pos += (*m_pos == 't') ? 4 : 5;
+			return true;
+		}
+		if (strncmp(m_pos, "null", 4) == 0)
+		{
+			m_pos += 4;
+			return true;
+		}
+		char* end = 0;
+		value.m_type = JsonValue::JSON_NUMBER;
+		value.m_number = strtod(m_pos, &end);
+		if (end == m_pos)
+			return false;
+		m_pos = end;
+		return true;
+	}
+};
+
+static bool readJsonFile(const char* fileName, JsonValue& root)
+{
+	FILE* file = fopen(fileName, "rb");
+	if (!file)
+		return false;
+	std::string text;
+	char buffer[4096];
+	size_t numRead;
+	while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		text.append(buffer, numRead);
+	}
+	fclose(file);
+	JsonReader reader;
+	reader.m_pos = text.c_str();
+	return reader.readValue(root) && root.m_type == JsonValue::JSON_OBJECT;
+}
+
+static std::string jsonString(const std::string& str)
+{
+	std::string quoted = "\"";
+	for (size_t i = 0; i < str.size(); i++)
+	{
+		if (str[i] == '"' || str[i] == '\\')
+			quoted += '\\';
+		quoted += str[i];
+	}
+	return quoted + "\"";
+}
+
+
+struct Comparison
+{
+	int m_benchmark;
+	double m_baselineMsPerStep;
+	double m_msPerStep;
+	bool m_regressed;
+	std::string m_mismatch;  //why the scene can't be compared with the baseline, then there is no verdict
+};
+
+///compares the time per step of each scene against the scene in the baseline that has the same number.
+///Times of a different scheduler, build or thread count say nothing about a regression, such scenes only get a mismatch
+static void compareToBaseline(const JsonValue& baseline, const std::string& schedulerName, const std::vector<BenchmarkResult>& results, double tolerance, std::vector<Comparison>& comparisons)
+{
+	const JsonValue* baselineBenchmarks = baseline.find("benchmarks");
+	if (!baselineBenchmarks || baselineBenchmarks->m_type != JsonValue::JSON_ARRAY)
+		return;
+	std::string runMismatch;
+	const JsonValue* baselineScheduler = baseline.find("scheduler");
+	if (!baselineScheduler || baselineScheduler->m_type != JsonValue::JSON_STRING)
+		runMismatch = "the baseline has no scheduler";
+	else if (baselineScheduler->m_string != schedulerName)
+		runMismatch = "the baseline used the " + baselineScheduler->m_string + " scheduler";
+#if BT_THREADSAFE
+	bool threadsafe = true;
+#else
+	bool threadsafe = false;
+#endif //BT_THREADSAFE
+	const JsonValue* baselineThreadsafe = baseline.find("threadsafe");
+	if (!baselineThreadsafe || baselineThreadsafe->m_type != JsonValue::JSON_BOOL)
+		runMismatch = "the baseline doesn't say if it is a threadsafe build";
+	else if ((baselineThreadsafe->m_number != 0) != threadsafe)
+		runMismatch = threadsafe ? "the baseline is not a threadsafe build" : "the baseline is a threadsafe build";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		for (size_t j = 0; j < baselineBenchmarks->m_elements.size(); j++)
+		{
+			const JsonValue& entry = baselineBenchmarks->m_elements[j];
+			if (int(entry.getNumber("benchmark", -1)) != result.m_benchmark)
+				continue;
+			Comparison comparison;
+			comparison.m_benchmark = result.m_benchmark;
+			comparison.m_baselineMsPerStep = entry.getNumber("msPerStep", 0);
+			comparison.m_msPerStep = result.m_totalMs / btMax(result.m_steps, 1);
+			comparison.m_mismatch = runMismatch;
+			int baselineThreads = int(entry.getNumber("threads", -1));
+			if (comparison.m_mismatch.empty() && baselineThreads != result.m_threads)
+			{
+				char buffer[64];
+				sprintf(buffer, "the baseline ran with %d threads", baselineThreads);
+				comparison.m_mismatch = buffer;
+			}
+			comparison.m_regressed = comparison.m_mismatch.empty() && comparison.m_baselineMsPerStep > 0 && comparison.m_msPerStep > comparison.m_baselineMsPerStep * (1.0 + tolerance);
+			comparisons.push_back(comparison);
+			break;
+		}
+	}
+}
+
+static void writeJson(FILE* file, const std::string& schedulerName, int numWarmupSteps, const std::vector<BenchmarkResult>& results,
+	const char* baselineFileName, double tolerance, const std::vector<Comparison>& comparisons)
+{
+	fprintf(file, "{\n");
+	fprintf(file, "  \"bulletVersion\": %d,\n", btGetVersion());
+#if BT_THREADSAFE
+	fprintf(file, "  \"threadsafe\": true,\n");
+#else
+	fprintf(file, "  \"threadsafe\": false,\n");
+#endif //BT_THREADSAFE
+	fprintf(file, "  \"scheduler\": %s,\n", jsonString(schedulerName).c_str());
+	fprintf(file, "  \"warmupSteps\": %d,\n", numWarmupSteps);
+	fprintf(file, "  \"processPeakBytes\": %llu,\n", getProcessPeakBytes());
+	fprintf(file, "  \"benchmarks\": [\n");
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		int steps = btMax(result.m_steps, 1);
+		fprintf(file, "    {\n");
+		fprintf(file, "      \"benchmark\": %d,\n", result.m_benchmark);
+		fprintf(file, "      \"name\": %s,\n", jsonString(sBenchmarkNames[result.m_benchmark - 1]).c_str());
+		fprintf(file, "      \"threads\": %d,\n", result.m_threads);
+		fprintf(file, "      \"steps\": %d,\n", result.m_steps);
+		fprintf(file, "      \"initMs\": %.3f,\n", result.m_initMs);
+		fprintf(file, "      \"totalMs\": %.3f,\n", result.m_totalMs);
+		fprintf(file, "      \"msPerStep\": %.4f,\n", result.m_totalMs / steps);
+		fprintf(file, "      \"stepsPerSecond\": %.2f,\n", result.m_totalMs > 0 ? 1000.0 * result.m_steps / result.m_totalMs : 0.0);
+		fprintf(file, "      \"peakAllocatedBytes\": %llu,\n", result.m_peakAllocatedBytes);
+		fprintf(file, "      \"stages\": [\n");
+		for (size_t s = 0; s < result.m_stages.size(); s++)
+		{
+			const StageResult& stage = result.m_stages[s];
+			fprintf(file, "        { \"name\": %s, \"calls\": %d, \"totalMs\": %.3f, \"msPerStep\": %.4f }%s\n",
+				jsonString(stage.m_name).c_str(), stage.m_calls, stage.m_totalMs, stage.m_totalMs / steps,
+				s + 1 < result.m_stages.size() ? "," : "");
+		}
+		fprintf(file, "      ]\n");
+		fprintf(file, "    }%s\n", i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "  ]");
+	if (baselineFileName)
+	{
+		fprintf(file, ",\n  \"baseline\": %s,\n", jsonString(baselineFileName).c_str());
+		fprintf(file, "  \"tolerance\": %.3f,\n", tolerance);
+		fprintf(file, "  \"comparison\": [\n");
+		for (size_t i = 0; i < comparisons.size(); i++)
+		{
+			const Comparison& comparison = comparisons[i];
+			fprintf(file, "    { \"benchmark\": %d, \"baselineMsPerStep\": %.4f, \"msPerStep\": %.4f, \"ratio\": %.3f, ",
+				comparison.m_benchmark, comparison.m_baselineMsPerStep, comparison.m_msPerStep,
+				comparison.m_baselineMsPerStep > 0 ? comparison.m_msPerStep / comparison.m_baselineMsPerStep : 0.0);
+			if (comparison.m_mismatch.empty())
+				fprintf(file, "\"regressed\": %s }", comparison.m_regressed ? "true" : "false");
+			else
+				fprintf(file, "\"regressed\": null, \"mismatch\": %s }", jsonString(comparison.m_mismatch).c_str());
+			fprintf(file, "%s\n", i + 1 < comparisons.size() ? "," : "");
+		}
+		fprintf(file, "  ]");
+	}
+	fprintf(file, "\n}\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+	btAlignedAllocSetCustom(countingAlloc, countingFree);
+
+	b3CommandLineArgs args(argc, argv);
+	if (args.CheckCmdLineFlag("help"))
+	{
+		printf("usage: %s [--benchmark=1,3] [--steps=300] [--warmup=10]\n", argv[0]);
+		printf("       [--scheduler=Sequential|ThreadSupport|OpenMP|IntelTBB|PPL] [--threads=N]\n");
+		printf("       [--output=benchmark.json] [--baseline=baseline.json] [--tolerance=0.1]\n");
+		printf("benchmarks:\n");
+		for (int i = 0; i < sNumBenchmarks; i++)
+		{
+			printf("  %d: %s\n", i + 1, sBenchmarkNames[i]);
+		}
+		return 0;
+	}
+
+	int numSteps = 300;
+	int numWarmupSteps = 10;
+	int numThreads = 0;
+	double tolerance = 0.1;
+	std::string benchmarkList;
+	std::string outputFileName = "benchmark.json";
+	std::string baselineFileName;
+#if BT_THREADSAFE
+	std::string schedulerName = "ThreadSupport";
+#else
+	std::string schedulerName = "Sequential";
+#endif
+	args.GetCmdLineArgument("steps", numSteps);
+	args.GetCmdLineArgument("warmup", numWarmupSteps);
+	args.GetCmdLineArgument("threads", numThreads);
+	args.GetCmdLineArgument("tolerance", tolerance);
+	args.GetCmdLineArgument("benchmark", benchmarkList);
+	args.GetCmdLineArgument("output", outputFileName);
+	args.GetCmdLineArgument("baseline", baselineFileName);
+	args.GetCmdLineArgument("scheduler", schedulerName);
+
+	std::vector<int> benchmarks;
+	if (benchmarkList.empty())
+	{
+		for (int i = 1; i <= sNumBenchmarks; i++)
+			benchmarks.push_back(i);
+	}
+	else
+	{
+		const char* pos = benchmarkList.c_str();
+		while (*pos)
+		{
+			char* end = 0;
+			long benchmark = strtol(pos, &end, 10);
+			if (end == pos || benchmark < 1 || benchmark > sNumBenchmarks)
+			{
+				fprintf(stderr, "invalid benchmark list %s, use numbers 1 to %d\n", benchmarkList.c_str(), sNumBenchmarks);
+				return 2;
+			}
+			benchmarks.push_back(int(benchmark));
+			pos = (*end == ',') ? end + 1 : end;
+		}
+	}
+
+	JsonValue baseline;
+	if (!baselineFileName.empty() && !readJsonFile(baselineFileName.c_str(), baseline))
+	{
+		fprintf(stderr, "cannot read the baseline %s\n", baselineFileName.c_str());
+		return 2;
+	}
+
+	std::vector<BenchmarkResult> results;
+	for (size_t i = 0; i < benchmarks.size(); i++)
+	{
+		printf("benchmark %d: %s, %d steps\n", benchmarks[i], sBenchmarkNames[benchmarks[i] - 1], numSteps);
+		fflush(stdout);
+		BenchmarkResult result;
+		if (!runBenchmark(benchmarks[i], numSteps, numWarmupSteps, schedulerName, numThreads, result))
+			return 2;
+		printf("benchmark %d: %.3f ms per step, %.2f steps per second\n", result.m_benchmark,
+			result.m_totalMs / btMax(numSteps, 1), result.m_totalMs > 0 ? 1000.0 * numSteps / result.m_totalMs : 0.0);
+		results.push_back(result);
+	}
+
+	std::vector<Comparison> comparisons;
+	int numRegressions = 0;
+	if (!baselineFileName.empty())
+	{
+		compareToBaseline(baseline, schedulerName, results, tolerance, comparisons);
+		for (size_t i = 0; i < comparisons.size(); i++)
+		{
+			const Comparison& comparison = comparisons[i];
+			if (!comparison.m_mismatch.empty())
+			{
+				fprintf(stderr, "benchmark %d: not compared, %s\n", comparison.m_benchmark, comparison.m_mismatch.c_str());
+				continue;
+			}
+			printf("benchmark %d: %.3f ms per step, baseline %.3f ms%s\n", comparison.m_benchmark,
+				comparison.m_msPerStep, comparison.m_baselineMsPerStep, comparison.m_regressed ? ", REGRESSED" : "");
+			numRegressions += comparison.m_regressed ? 1 : 0;
+		}
+	}
+
+	FILE* file = fopen(outputFileName.c_str(), "w");
+	if (!file)
+	{
+		fprintf(stderr, "cannot write %s\n", outputFileName.c_str());
+		return 2;
+	}
+	writeJson(file, schedulerName, numWarmupSteps, results, baselineFileName.empty() ? 0 : baselineFileName.c_str(), tolerance, comparisons);
+	fclose(file);
+	printf("results written to %s\n", outputFileName.c_str());
+
+	if (sCreatedTaskScheduler)
+	{
+		btSetTaskScheduler(btGetSequentialTaskScheduler());
+		delete sCreatedTaskScheduler;
+		sCreatedTaskScheduler = 0;
+	}
+	return numRegressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,20 @@
+
+project "App_HeadlessBenchmark"
+
+kind "ConsoleApp"
+
+includedirs {"../../src"}
+
+links {
+	"BulletDynamics","BulletCollision", "LinearMath"
+}
+
+language "C++"
+
+files {
+	"HeadlessBenchmark.cpp",
+	"BenchmarkDemo.cpp",
+	"BenchmarkDemo.h",
+	"../MultiThreadedDemo/CommonRigidBodyMTBase.cpp",
+	"../MultiThreadedDemo/CommonRigidBodyMTBase.h",
+}
@@ -229,6 +229,9 @@ static ExampleEntry gDefaultExamples[]=
 	ExampleEntry(1,"Prim vs Mesh", "Benchmark the performance and stability of rigid bodies using primitive collision shapes (btSphereShape, btBoxShape), resting on a triangle mesh, btBvhTriangleMeshShape.", BenchmarkCreateFunc, 5),
 	ExampleEntry(1,"Convex vs Mesh", "Benchmark the performance and stability of rigid bodies using convex hull collision shapes (btConvexHullShape), resting on a triangle mesh, btBvhTriangleMeshShape.", BenchmarkCreateFunc, 6),
 	ExampleEntry(1,"Raycast", "Benchmark the performance of the btCollisionWorld::rayTest. Note that currently the rays are not rendered.", BenchmarkCreateFunc, 7),
+	ExampleEntry(1,"Raycast batch", "Benchmark the performance of btCollisionWorld::rayTestBatch, casting the same rays as the Raycast benchmark in one batch.", BenchmarkCreateFunc, 8),
+	ExampleEntry(1,"Mesh BVH", "Benchmark the build of the btQuantizedBvh of a large btBvhTriangleMeshShape with the mean split and SAH binned build modes, and the throughput of ray and convex casts against it. The results are printed.", BenchmarkCreateFunc, 9),
+	ExampleEntry(1,"Heightfield raycast", "Benchmark the throughput of long grazing rays and short vertical rays against a large btHeightfieldTerrainShape, over all cells in the aabb of the ray, with the cell walk, and with the min/max height pyramid. The results are printed.", BenchmarkCreateFunc, 10),
 //#endif
 
 
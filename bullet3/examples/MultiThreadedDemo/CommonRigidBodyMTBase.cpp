@@ -822,6 +822,14 @@ void CommonRigidBodyMTBase::createDefaultParameters()
             button.m_callback = boolPtrButtonCallback;
             m_guiHelper->getParameterInterface()->registerButtonParameter( button );
         }
+        {
+            // create a button to toggle solving contacts in SIMD row groups (only when SIMD mode is on)
+            ButtonParams button( "Solver row groups", 0, true );
+            button.m_initialState = btSequentialImpulseConstraintSolverMt::s_useSimdRowGroups;
+            button.m_userPointer = &btSequentialImpulseConstraintSolverMt::s_useSimdRowGroups;
+            button.m_callback = boolPtrButtonCallback;
+            m_guiHelper->getParameterInterface()->registerButtonParameter( button );
+        }
 #endif // #if BT_THREADSAFE
     }
 }
@@ -878,9 +886,11 @@ void CommonRigidBodyMTBase::drawScreenText()
         }
         {
             int sm = gSolverMode;
-            sprintf( msg, "solver %s mode [%s%s%s%s%s%s]",
+            bool rowGroups = m_solverType == SOLVER_TYPE_SEQUENTIAL_IMPULSE_MT && btSequentialImpulseConstraintSolverMt::s_useSimdRowGroups;
+            sprintf( msg, "solver %s mode [%s%s%s%s%s%s%s]",
                      getSolverTypeName(m_solverType),
                      sm & SOLVER_SIMD ? "SIMD" : "",
+                     ( sm & SOLVER_SIMD ) && rowGroups ? " rowGroups" : "",
                      sm & SOLVER_RANDMIZE_ORDER ? " randomize" : "",
                      sm & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS ? " interleave" : "",
                      sm & SOLVER_USE_2_FRICTION_DIRECTIONS ? " friction2x" : "",
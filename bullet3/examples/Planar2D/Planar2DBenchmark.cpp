@@ -0,0 +1,220 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///Planar2DBenchmark steps the same pyramid of 2D shapes in a btDiscreteDynamicsWorld restricted to the X-Y plane,
+///as in the Planar2D example, and in a btDynamicsWorld2d, and prints the time per step of each.
+///Arguments: [pyramid base=40] [steps=600]
+
+#include "btBulletDynamicsCommon.h"
+#include "BulletCollision/CollisionShapes/btBox2dShape.h"
+#include "BulletCollision/CollisionShapes/btConvex2dShape.h"
+#include "BulletCollision/CollisionDispatch/btBox2dBox2dCollisionAlgorithm.h"
+#include "BulletCollision/CollisionDispatch/btConvex2dConvex2dAlgorithm.h"
+#include "BulletCollision/NarrowPhaseCollision/btMinkowskiPenetrationDepthSolver.h"
+#include "BulletDynamics/Dynamics2d/btDynamicsWorld2d.h"
+#include "LinearMath/btQuickprof.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+struct PyramidShapes
+{
+	btBoxShape*			m_groundShape;
+	btBoxShape*			m_boxChild;
+	btConvexHullShape*	m_triangleChild;
+	btCylinderShapeZ*	m_cylinderChild;
+	btConvex2dShape*	m_box;
+	btConvex2dShape*	m_triangle;
+	btConvex2dShape*	m_cylinder;
+
+	PyramidShapes()
+	{
+		m_groundShape = new btBoxShape(btVector3(btScalar(150.),btScalar(50.),btScalar(150.)));
+		btScalar u = btScalar(1-0.04);
+		btVector3 points[3] = {btVector3(0,u,0),btVector3(-u,-u,0),btVector3(u,-u,0)};
+		m_boxChild = new btBoxShape(btVector3(btScalar(1),btScalar(1),btScalar(0.04)));
+		m_triangleChild = new btConvexHullShape(&points[0].getX(),3);
+		m_cylinderChild = new btCylinderShapeZ(btVector3(btScalar(1),btScalar(1),btScalar(0.04)));
+		m_box = new btConvex2dShape(m_boxChild);
+		m_triangle = new btConvex2dShape(m_triangleChild);
+		m_cylinder = new btConvex2dShape(m_cylinderChild);
+	}
+
+	~PyramidShapes()
+	{
+		delete m_box;
+		delete m_triangle;
+		delete m_cylinder;
+		delete m_boxChild;
+		delete m_triangleChild;
+		delete m_cylinderChild;
+		delete m_groundShape;
+	}
+
+	btCollisionShape* getShape(int j) const
+	{
+		switch (j%3)
+		{
+		case 0: return m_box;
+		case 1: return m_cylinder;
+		default: return m_triangle;
+		}
+	}
+};
+
+///calls addBody(shape,position) for each body of the pyramid, in the layout of the Planar2D example
+template <typename AddBody>
+static void	buildPyramid(const PyramidShapes& shapes,int base,AddBody& addBody)
+{
+	btVector3 x(-btScalar(base), btScalar(8.),btScalar(0.));
+	btVector3 deltaX(btScalar(1.),btScalar(2.),btScalar(0.));
+	btVector3 deltaY(btScalar(2.),btScalar(0.),btScalar(0.));
+	for (int i=0;i<base;++i)
+	{
+		btVector3 y = x;
+		for (int j=i;j<base;++j)
+		{
+			addBody(shapes.getShape(j),y);
+			y += deltaY;
+		}
+		x += deltaX;
+	}
+}
+
+struct AddBody3d
+{
+	btDiscreteDynamicsWorld*	m_world;
+
+	void operator()(btCollisionShape* shape,const btVector3& position)
+	{
+		btScalar mass(1.);
+		btVector3 localInertia(0,0,0);
+		shape->calculateLocalInertia(mass,localInertia);
+		btTransform startTransform;
+		startTransform.setIdentity();
+		startTransform.setOrigin(position);
+		btRigidBody::btRigidBodyConstructionInfo rbInfo(mass,0,shape,localInertia);
+		rbInfo.m_startWorldTransform = startTransform;
+		btRigidBody* body = new btRigidBody(rbInfo);
+		//btDynamicsWorld2d has no sleeping, so both worlds do the same work
+		body->setActivationState(DISABLE_DEACTIVATION);
+		body->setLinearFactor(btVector3(1,1,0));
+		body->setAngularFactor(btVector3(0,0,1));
+		m_world->addRigidBody(body);
+	}
+};
+
+struct AddBody2d
+{
+	btDynamicsWorld2d*	m_world;
+
+	void operator()(btCollisionShape* shape,const btVector3& position)
+	{
+		m_world->addBody(shape,btScalar(1.),btVector2(position.getX(),position.getY()));
+	}
+};
+
+static double	run3d(const PyramidShapes& shapes,int base,int numSteps,btScalar& maxHeight)
+{
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btVoronoiSimplexSolver simplexSolver;
+	btMinkowskiPenetrationDepthSolver pdSolver;
+	btConvex2dConvex2dAlgorithm::CreateFunc convexAlgo2d(&simplexSolver,&pdSolver);
+	btBox2dBox2dCollisionAlgorithm::CreateFunc box2dbox2dAlgo;
+	dispatcher.registerCollisionCreateFunc(CONVEX_2D_SHAPE_PROXYTYPE,CONVEX_2D_SHAPE_PROXYTYPE,&convexAlgo2d);
+	dispatcher.registerCollisionCreateFunc(BOX_2D_SHAPE_PROXYTYPE,CONVEX_2D_SHAPE_PROXYTYPE,&convexAlgo2d);
+	dispatcher.registerCollisionCreateFunc(CONVEX_2D_SHAPE_PROXYTYPE,BOX_2D_SHAPE_PROXYTYPE,&convexAlgo2d);
+	dispatcher.registerCollisionCreateFunc(BOX_2D_SHAPE_PROXYTYPE,BOX_2D_SHAPE_PROXYTYPE,&box2dbox2dAlgo);
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver solver;
+	btDiscreteDynamicsWorld world(&dispatcher,&broadphase,&solver,&collisionConfiguration);
+	world.setGravity(btVector3(0,-10,0));
+
+	btTransform groundTransform;
+	groundTransform.setIdentity();
+	groundTransform.setOrigin(btVector3(0,-43,0));
+	btRigidBody ground(btRigidBody::btRigidBodyConstructionInfo(0,0,shapes.m_groundShape));
+	ground.setWorldTransform(groundTransform);
+	world.addRigidBody(&ground);
+
+	AddBody3d addBody;
+	addBody.m_world = &world;
+	buildPyramid(shapes,base,addBody);
+
+	btClock clock;
+	for (int i=0;i<numSteps;i++)
+	{
+		world.stepSimulation(btScalar(1.)/btScalar(60.),0);
+	}
+	double ms = double(clock.getTimeMicroseconds())/1000.;
+
+	maxHeight = -BT_LARGE_FLOAT;
+	for (int i=world.getNumCollisionObjects()-1;i>=0;i--)
+	{
+		btCollisionObject* obj = world.getCollisionObjectArray()[i];
+		world.removeCollisionObject(obj);
+		if (obj != &ground)
+		{
+			btSetMax(maxHeight,obj->getWorldTransform().getOrigin().getY());
+			delete obj;
+		}
+	}
+	return ms;
+}
+
+static double	run2d(const PyramidShapes& shapes,int base,int numSteps,btScalar& maxHeight)
+{
+	btDynamicsWorld2d world;
+	world.setGravity(btVector2(0,-10));
+	world.addBody(shapes.m_groundShape,btScalar(0.),btVector2(0,-43));
+
+	AddBody2d addBody;
+	addBody.m_world = &world;
+	buildPyramid(shapes,base,addBody);
+
+	btClock clock;
+	for (int i=0;i<numSteps;i++)
+	{
+		world.stepSimulation(btScalar(1.)/btScalar(60.),0);
+	}
+	double ms = double(clock.getTimeMicroseconds())/1000.;
+
+	maxHeight = -BT_LARGE_FLOAT;
+	for (int i=1;i<world.getNumBodies();i++)
+	{
+		btSetMax(maxHeight,world.getPositionsY()[i]);
+	}
+	return ms;
+}
+
+int main(int argc, char** argv)
+{
+	int base = 40;
+	int numSteps = 600;
+	if (argc > 1)
+		base = atoi(argv[1]);
+	if (argc > 2)
+		numSteps = atoi(argv[2]);
+
+	PyramidShapes shapes;
+	printf("bodies=%d steps=%d\n",base*(base+1)/2,numSteps);
+
+	btScalar maxHeight3d,maxHeight2d;
+	double ms3d = run3d(shapes,base,numSteps,maxHeight3d);
+	double ms2d = run2d(shapes,base,numSteps,maxHeight2d);
+	printf("btDiscreteDynamicsWorld (planar)  %8.3f ms/step  top of pile %6.2f\n",ms3d/numSteps,maxHeight3d);
+	printf("btDynamicsWorld2d                 %8.3f ms/step  top of pile %6.2f\n",ms2d/numSteps,maxHeight2d);
+	return 0;
+}
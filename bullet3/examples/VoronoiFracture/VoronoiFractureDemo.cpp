@@ -43,6 +43,7 @@ static bool useGenericConstraint = false;
 
 #include "LinearMath/btAlignedObjectArray.h"
 #include "LinearMath/btConvexHullComputer.h"
+#include "LinearMath/btConvexHullBatch.h"
 #include "LinearMath/btQuaternion.h"
 #include <set>
 #include <time.h>
@@ -95,6 +96,7 @@ class VoronoiFractureDemo : public CommonRigidBodyBase
 	void getVerticesInsidePlanes(const btAlignedObjectArray<btVector3>& planes, btAlignedObjectArray<btVector3>& verticesOut, std::set<int>& planeIndicesOut);
 	void voronoiBBShatter(const btAlignedObjectArray<btVector3>& points, const btVector3& bbmin, const btVector3& bbmax, const btQuaternion& bbq, const btVector3& bbt, btScalar matDensity);
 	void voronoiConvexHullShatter(const btAlignedObjectArray<btVector3>& points, const btAlignedObjectArray<btVector3>& verts, const btQuaternion& bbq, const btVector3& bbt, btScalar matDensity);
+	void createVoronoiShard(const btConvexHullComputer* convexHC, const btVector3& voronoiPoint, btScalar matDensity);
 
 	//virtual void clientMoveAndDisplay();
 
@@ -284,6 +286,66 @@ struct pointCmp
 	}
 };
 
+void VoronoiFractureDemo::createVoronoiShard(const btConvexHullComputer* convexHC, const btVector3& voronoiPoint, btScalar matDensity) {
+	// convexHC = the mesh of one voronoi shard, voronoiPoint = the voronoi point of its cell
+	int v0, v1, v2; // Triangle vertices
+	int j;
+
+	// At this point we have a complete 3D voronoi shard mesh contained in convexHC
+
+	// Calculate volume and center of mass (Stan Melax volume integration)
+	int numFaces = convexHC->faces.size();
+	btScalar volume = btScalar(0.);
+	btVector3 com(0., 0., 0.);
+	for (j=0; j < numFaces; j++) {
+		const btConvexHullComputer::Edge* edge = &convexHC->edges[convexHC->faces[j]];
+		v0 = edge->getSourceVertex();
+		v1 = edge->getTargetVertex();
+		edge = edge->getNextEdgeOfFace();
+		v2 = edge->getTargetVertex();
+		while (v2 != v0) {
+			// Counter-clockwise triangulated voronoi shard mesh faces (v0-v1-v2) and edges here...
+			btScalar vol = convexHC->vertices[v0].triple(convexHC->vertices[v1], convexHC->vertices[v2]);
+			volume += vol;
+			com += vol * (convexHC->vertices[v0] + convexHC->vertices[v1] + convexHC->vertices[v2]);
+			edge = edge->getNextEdgeOfFace();
+			v1 = v2;
+			v2 = edge->getTargetVertex();
+		}
+	}
+	com /= volume * btScalar(4.);
+	volume /= btScalar(6.);
+
+	// Shift all vertices relative to center of mass
+	btAlignedObjectArray<btVector3> shardVertices;
+	shardVertices.copyFromArray(convexHC->vertices);
+	int numVerts = shardVertices.size();
+	for (j=0; j < numVerts; j++)
+	{
+		shardVertices[j] -= com;
+	}
+
+	// Note:
+	// At this point convex hulls contained in convexHC should be accurate (line up flush with other pieces, no cracks),
+	// ...however Bullet Physics rigid bodies demo visualizations appear to produce some visible cracks.
+	// Use the mesh in convexHC for visual display or to perform boolean operations with.
+
+	// Create Bullet Physics rigid body shards
+	btCollisionShape* shardShape = new btConvexHullShape(&(shardVertices[0].getX()), shardVertices.size());
+	shardShape->setMargin(CONVEX_MARGIN); // for this demo; note convexHC has optional margin parameter for this
+	m_collisionShapes.push_back(shardShape);
+	btTransform shardTransform;
+	shardTransform.setIdentity();
+	shardTransform.setOrigin(voronoiPoint + com); // Shard's adjusted location
+	btDefaultMotionState* shardMotionState = new btDefaultMotionState(shardTransform);
+	btScalar shardMass(volume * matDensity);
+	btVector3 shardInertia(0.,0.,0.);
+	shardShape->calculateLocalInertia(shardMass, shardInertia);
+	btRigidBody::btRigidBodyConstructionInfo shardRBInfo(shardMass, shardMotionState, shardShape, shardInertia);
+	btRigidBody* shardBody = new btRigidBody(shardRBInfo);
+	m_dynamicsWorld->addRigidBody(shardBody);
+}
+
 void VoronoiFractureDemo::voronoiBBShatter(const btAlignedObjectArray<btVector3>& points, const btVector3& bbmin, const btVector3& bbmax, const btQuaternion& bbq, const btVector3& bbt, btScalar matDensity) {
 	// points define voronoi cells in world space (avoid duplicates)
 	// bbmin & bbmax = bounding box min and max in local space
@@ -293,8 +355,8 @@ void VoronoiFractureDemo::voronoiBBShatter(const btAlignedObjectArray<btVector3>
 	btVector3 bbvy = quatRotate(bbq, btVector3(0.0, 1.0, 0.0));
 	btVector3 bbvz = quatRotate(bbq, btVector3(0.0, 0.0, 1.0));
 	btQuaternion bbiq = bbq.inverse();
-	btConvexHullComputer* convexHC = new btConvexHullComputer();
-	btAlignedObjectArray<btVector3> vertices;
+	btConvexHullBatch batch;
+	btAlignedObjectArray<btVector3> vertices, cellPoints;
 	btVector3 rbb, nrbb;
 	btScalar nlength, maxDistance, distance;
 	btAlignedObjectArray<btVector3> sortedVoronoiPoints;
@@ -354,64 +416,16 @@ void VoronoiFractureDemo::voronoiBBShatter(const btAlignedObjectArray<btVector3>
 		if (vertices.size() == 0)
 			continue;
 
-		// Clean-up voronoi convex shard vertices and generate edges & faces
-		convexHC->compute(&vertices[0].getX(), sizeof(btVector3), vertices.size(),CONVEX_MARGIN,0.0);
-
-		// At this point we have a complete 3D voronoi shard mesh contained in convexHC
-
-		// Calculate volume and center of mass (Stan Melax volume integration)
-		int numFaces = convexHC->faces.size();
-		int v0, v1, v2; // Triangle vertices
-		btScalar volume = btScalar(0.);
-		btVector3 com(0., 0., 0.);
-		for (j=0; j < numFaces; j++) {
-			const btConvexHullComputer::Edge* edge = &convexHC->edges[convexHC->faces[j]];
-			v0 = edge->getSourceVertex();
-			v1 = edge->getTargetVertex();
-			edge = edge->getNextEdgeOfFace();
-			v2 = edge->getTargetVertex();
-			while (v2 != v0) {
-				// Counter-clockwise triangulated voronoi shard mesh faces (v0-v1-v2) and edges here...
-				btScalar vol = convexHC->vertices[v0].triple(convexHC->vertices[v1], convexHC->vertices[v2]);
-				volume += vol;
-				com += vol * (convexHC->vertices[v0] + convexHC->vertices[v1] + convexHC->vertices[v2]);
-				edge = edge->getNextEdgeOfFace();
-				v1 = v2;
-				v2 = edge->getTargetVertex();
-			}
-		}
-		com /= volume * btScalar(4.);
-		volume /= btScalar(6.);
-
-		// Shift all vertices relative to center of mass
-		int numVerts = convexHC->vertices.size();
-		for (j=0; j < numVerts; j++)
-		{
-			convexHC->vertices[j] -= com;
-		}
-
-		// Note:
-		// At this point convex hulls contained in convexHC should be accurate (line up flush with other pieces, no cracks),
-		// ...however Bullet Physics rigid bodies demo visualizations appear to produce some visible cracks.
-		// Use the mesh in convexHC for visual display or to perform boolean operations with.
-
-		// Create Bullet Physics rigid body shards
-		btCollisionShape* shardShape = new btConvexHullShape(&(convexHC->vertices[0].getX()), convexHC->vertices.size());
-		shardShape->setMargin(CONVEX_MARGIN); // for this demo; note convexHC has optional margin parameter for this
-		m_collisionShapes.push_back(shardShape);
-		btTransform shardTransform;
-		shardTransform.setIdentity();
-		shardTransform.setOrigin(curVoronoiPoint + com); // Shard's adjusted location
-		btDefaultMotionState* shardMotionState = new btDefaultMotionState(shardTransform);
-		btScalar shardMass(volume * matDensity);
-		btVector3 shardInertia(0.,0.,0.);
-		shardShape->calculateLocalInertia(shardMass, shardInertia);
-		btRigidBody::btRigidBodyConstructionInfo shardRBInfo(shardMass, shardMotionState, shardShape, shardInertia);
-		btRigidBody* shardBody = new btRigidBody(shardRBInfo);
-		m_dynamicsWorld->addRigidBody(shardBody);
-
+		// Clean-up voronoi convex shard vertices and generate edges & faces, for all shards at once in computeHulls
+		batch.addHull(&vertices[0], vertices.size(), CONVEX_MARGIN, 0.0);
+		cellPoints.push_back(curVoronoiPoint);
+	}
+	batch.computeHulls();
+	for (i=0; i < batch.getNumHulls(); i++) {
+		if (batch.getHull(i)->vertices.size() == 0)
+			continue;
+		createVoronoiShard(batch.getHull(i), cellPoints[i], matDensity);
 		cellnum ++;
-
 	}
 	printf("Generated %d voronoi btRigidBody shards\n", cellnum);
 }
@@ -422,7 +436,8 @@ void VoronoiFractureDemo::voronoiConvexHullShatter(const btAlignedObjectArray<bt
 	// bbq & bbt = source (convex hull) mesh quaternion rotation and translation
 	// matDensity = Material density for voronoi shard mass calculation
 	btConvexHullComputer* convexHC = new btConvexHullComputer();
-	btAlignedObjectArray<btVector3> vertices, chverts;
+	btConvexHullBatch batch;
+	btAlignedObjectArray<btVector3> vertices, chverts, cellPoints;
 	btVector3 rbb, nrbb;
 	btScalar nlength, maxDistance, distance;
 	btAlignedObjectArray<btVector3> sortedVoronoiPoints;
@@ -499,63 +514,16 @@ void VoronoiFractureDemo::voronoiConvexHullShatter(const btAlignedObjectArray<bt
 		if (vertices.size() == 0)
 			continue;
 
-		// Clean-up voronoi convex shard vertices and generate edges & faces
-		convexHC->compute(&vertices[0].getX(), sizeof(btVector3), vertices.size(),0.0,0.0);
-
-		// At this point we have a complete 3D voronoi shard mesh contained in convexHC
-
-		// Calculate volume and center of mass (Stan Melax volume integration)
-		numFaces = convexHC->faces.size();
-		btScalar volume = btScalar(0.);
-		btVector3 com(0., 0., 0.);
-		for (j=0; j < numFaces; j++) {
-			const btConvexHullComputer::Edge* edge = &convexHC->edges[convexHC->faces[j]];
-			v0 = edge->getSourceVertex();
-			v1 = edge->getTargetVertex();
-			edge = edge->getNextEdgeOfFace();
-			v2 = edge->getTargetVertex();
-			while (v2 != v0) {
-				// Counter-clockwise triangulated voronoi shard mesh faces (v0-v1-v2) and edges here...
-				btScalar vol = convexHC->vertices[v0].triple(convexHC->vertices[v1], convexHC->vertices[v2]);
-				volume += vol;
-				com += vol * (convexHC->vertices[v0] + convexHC->vertices[v1] + convexHC->vertices[v2]);
-				edge = edge->getNextEdgeOfFace();
-				v1 = v2;
-				v2 = edge->getTargetVertex();
-			}
-		}
-		com /= volume * btScalar(4.);
-		volume /= btScalar(6.);
-
-		// Shift all vertices relative to center of mass
-		int numVerts = convexHC->vertices.size();
-		for (j=0; j < numVerts; j++)
-		{
-			convexHC->vertices[j] -= com;
-		}
-
-		// Note:
-		// At this point convex hulls contained in convexHC should be accurate (line up flush with other pieces, no cracks),
-		// ...however Bullet Physics rigid bodies demo visualizations appear to produce some visible cracks.
-		// Use the mesh in convexHC for visual display or to perform boolean operations with.
-
-		// Create Bullet Physics rigid body shards
-		btCollisionShape* shardShape = new btConvexHullShape(&(convexHC->vertices[0].getX()), convexHC->vertices.size());
-		shardShape->setMargin(CONVEX_MARGIN); // for this demo; note convexHC has optional margin parameter for this
-		m_collisionShapes.push_back(shardShape);
-		btTransform shardTransform;
-		shardTransform.setIdentity();
-		shardTransform.setOrigin(curVoronoiPoint + com); // Shard's adjusted location
-		btDefaultMotionState* shardMotionState = new btDefaultMotionState(shardTransform);
-		btScalar shardMass(volume * matDensity);
-		btVector3 shardInertia(0.,0.,0.);
-		shardShape->calculateLocalInertia(shardMass, shardInertia);
-		btRigidBody::btRigidBodyConstructionInfo shardRBInfo(shardMass, shardMotionState, shardShape, shardInertia);
-		btRigidBody* shardBody = new btRigidBody(shardRBInfo);
-		m_dynamicsWorld->addRigidBody(shardBody);
-
+		// Clean-up voronoi convex shard vertices and generate edges & faces, for all shards at once in computeHulls
+		batch.addHull(&vertices[0], vertices.size(), 0.0, 0.0);
+		cellPoints.push_back(curVoronoiPoint);
+	}
+	batch.computeHulls();
+	for (i=0; i < batch.getNumHulls(); i++) {
+		if (batch.getHull(i)->vertices.size() == 0)
+			continue;
+		createVoronoiShard(batch.getHull(i), cellPoints[i], matDensity);
 		cellnum ++;
-
 	}
 	printf("Generated %d voronoi btRigidBody shards\n", cellnum);
 }
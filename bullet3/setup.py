@@ -129,7 +129,11 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["src/LinearMath/btPolarDecomposition.cpp"]\
 +["src/LinearMath/btSerializer64.cpp"]\
 +["src/LinearMath/btConvexHullComputer.cpp"]\
++["src/LinearMath/btConvexHullBatch.cpp"]\
++["src/LinearMath/btFrameArena.cpp"]\
++["src/LinearMath/btPerThreadPoolAllocator.cpp"]\
 +["src/LinearMath/btQuickprof.cpp"]\
++["src/LinearMath/btTimelineProfiler.cpp"]\
 +["src/LinearMath/btThreads.cpp"]\
 +["src/LinearMath/TaskScheduler/btTaskScheduler.cpp"]\
 +["src/LinearMath/TaskScheduler/btThreadSupportPosix.cpp"]\
@@ -235,6 +239,9 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["src/BulletDynamics/Dynamics/btSimulationIslandManagerMt.cpp"]\
 +["src/BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.cpp"]\
 +["src/BulletDynamics/Dynamics/btSimpleDynamicsWorld.cpp"]\
++["src/BulletDynamics/Dynamics/btWorldSnapshot.cpp"]\
++["src/BulletDynamics/Dynamics2d/btCollision2d.cpp"]\
++["src/BulletDynamics/Dynamics2d/btDynamicsWorld2d.cpp"]\
 +["src/BulletDynamics/ConstraintSolver/btBatchedConstraints.cpp"]\
 +["src/BulletDynamics/ConstraintSolver/btConeTwistConstraint.cpp"]\
 +["src/BulletDynamics/ConstraintSolver/btGeneric6DofSpringConstraint.cpp"]\
@@ -258,6 +265,7 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["src/BulletDynamics/MLCPSolvers/btMLCPSolver.cpp"]\
 +["src/BulletDynamics/Featherstone/btMultiBody.cpp"]\
 +["src/BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.cpp"]\
++["src/BulletDynamics/Featherstone/btMultiBodyDynamicsWorldMt.cpp"]\
 +["src/BulletDynamics/Featherstone/btMultiBodyJointMotor.cpp"]\
 +["src/BulletDynamics/Featherstone/btMultiBodyGearConstraint.cpp"]\
 +["src/BulletDynamics/Featherstone/btMultiBodyConstraint.cpp"]\
@@ -267,8 +275,10 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["src/BulletDynamics/Featherstone/btMultiBodyJointLimitConstraint.cpp"]\
 +["src/BulletDynamics/Featherstone/btMultiBodySliderConstraint.cpp"]\
 +["src/BulletDynamics/Vehicle/btRaycastVehicle.cpp"]\
++["src/BulletDynamics/Vehicle/btRaycastVehicleBatch.cpp"]\
 +["src/BulletDynamics/Vehicle/btWheelInfo.cpp"]\
 +["src/BulletDynamics/Character/btKinematicCharacterController.cpp"]\
++["src/BulletDynamics/Character/btKinematicCharacterBatch.cpp"]\
 +["src/Bullet3Common/b3AlignedAllocator.cpp"]\
 +["src/Bullet3Common/b3Logging.cpp"]\
 +["src/Bullet3Common/b3Vector3.cpp"]\
@@ -295,6 +305,7 @@ sources = ["examples/pybullet/pybullet.c"]\
 +["Extras/InverseDynamics/SimpleTreeCreator.cpp"]\
 +["Extras/InverseDynamics/invdyn_bullet_comparison.cpp"]\
 +["src/BulletSoftBody/btDefaultSoftBodySolver.cpp"]\
++["src/BulletSoftBody/btDefaultSoftBodySolverMt.cpp"]\
 +["src/BulletSoftBody/btSoftBodyHelpers.cpp"]\
 +["src/BulletSoftBody/btSoftRigidCollisionAlgorithm.cpp"]\
 +["src/BulletSoftBody/btSoftBody.cpp"]\
@@ -48,6 +48,7 @@ protected:
 };
 
 #include "LinearMath/btVector3.h"
+#include "LinearMath/btAlignedObjectArray.h"
 
 ///The btBroadphaseInterface class provides an interface to detect aabb-overlapping object pairs.
 ///Some implementations for this broadphase interface include btAxisSweep3, bt32BitAxisSweep3 and btDbvtBroadphase.
@@ -66,6 +67,10 @@ public:
 
 	virtual void	aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) = 0;
 
+	///rayTestBatch collects the proxies each of numRays rays may hit, without a callback per proxy.
+	///The proxies of ray i are candidates[candidateOffsets[i]] up to (excluding) candidates[candidateOffsets[i+1]]
+	virtual void	rayTestBatch(const btVector3* rayFrom, const btVector3* rayTo, int numRays, btAlignedObjectArray<int>& candidateOffsets, btAlignedObjectArray<btBroadphaseProxy*>& candidates);
+
 	///calculateOverlappingPairs is optional: incremental algorithms (sweep and prune) might do it during the set aabb
 	virtual void	calculateOverlappingPairs(btDispatcher* dispatcher)=0;
 
@@ -79,8 +84,55 @@ public:
 	///reset broadphase internal structures, to ensure determinism/reproducability
 	virtual void resetPool(btDispatcher* dispatcher) { (void) dispatcher; };
 
+	///saveState appends the internal structures that decide in which order the broadphase finds new pairs, and restoreState reads them back,
+	///so that a restored world finds the same pairs in the same order as the one it was saved from (see btWorldSnapshot).
+	///Proxies are referred to by their unique id: a state only restores into the broadphase it was saved from, with the same proxies.
+	///restoreState returns false, and changes nothing, when the state does not match the proxies. The default implementation saves nothing.
+	virtual void	saveState(btAlignedObjectArray<unsigned char>& state) const { (void) state; }
+	virtual bool	restoreState(const unsigned char* state, int size) { (void) state; return size==0; }
+
 	virtual void	printStats() = 0;
 
 };
 
+///btBroadphaseRayCollector appends the proxies reported by btBroadphaseInterface::rayTest to an array
+struct	btBroadphaseRayCollector : public btBroadphaseRayCallback
+{
+	btAlignedObjectArray<btBroadphaseProxy*>*	m_proxies;
+
+	btBroadphaseRayCollector(const btVector3& rayFrom,const btVector3& rayTo,btAlignedObjectArray<btBroadphaseProxy*>* proxies)
+		:m_proxies(proxies)
+	{
+		btVector3 rayDir = (rayTo-rayFrom);
+		rayDir.normalize ();
+		m_rayDirectionInverse[0] = rayDir[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[0];
+		m_rayDirectionInverse[1] = rayDir[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[1];
+		m_rayDirectionInverse[2] = rayDir[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[2];
+		m_signs[0] = m_rayDirectionInverse[0] < 0.0;
+		m_signs[1] = m_rayDirectionInverse[1] < 0.0;
+		m_signs[2] = m_rayDirectionInverse[2] < 0.0;
+		m_lambda_max = rayDir.dot(rayTo-rayFrom);
+	}
+
+	virtual bool	process(const btBroadphaseProxy* proxy)
+	{
+		m_proxies->push_back(const_cast<btBroadphaseProxy*>(proxy));
+		return true;
+	}
+};
+
+///the default implementation casts the rays one at a time through rayTest
+inline void	btBroadphaseInterface::rayTestBatch(const btVector3* rayFrom, const btVector3* rayTo, int numRays, btAlignedObjectArray<int>& candidateOffsets, btAlignedObjectArray<btBroadphaseProxy*>& candidates)
+{
+	candidateOffsets.resize(numRays+1);
+	candidates.resize(0);
+	for (int i=0;i<numRays;i++)
+	{
+		candidateOffsets[i] = candidates.size();
+		btBroadphaseRayCollector collector(rayFrom[i],rayTo[i],&candidates);
+		rayTest(rayFrom[i],rayTo[i],collector);
+	}
+	candidateOffsets[numRays] = candidates.size();
+}
+
 #endif //BT_BROADPHASE_INTERFACE_H
@@ -17,6 +17,15 @@ subject to the following restrictions:
 
 #include "btDbvtBroadphase.h"
 #include "LinearMath/btThreads.h"
+#include "LinearMath/btHashMap.h"
+#include <string.h>
+
+#if (defined(BT_USE_SSE)||defined(__SSE__))&&!defined(BT_USE_DOUBLE_PRECISION)
+#define DBVT_BP_RAYPACKET_SSE	1
+#include <xmmintrin.h>
+#else
+#define DBVT_BP_RAYPACKET_SSE	0
+#endif
 
 //
 // Profiling
@@ -115,6 +124,66 @@ struct	btDbvtTreeCollider : btDbvt::ICollide
 	}
 };
 
+/* Parallel tree collider	*/ 
+struct	btDbvtParallelTreeCollider : btDbvt::ICollide
+{
+	btDbvtBroadphase*					pbp;
+	btDbvtBroadphase::sThreadPairs*		found;
+	int									task;
+	int									overlaps;
+	int									lookups;
+	void	Process(const btDbvtNode* na,const btDbvtNode* nb)
+	{
+		if(na!=nb)
+		{
+			btDbvtProxy*	pa=(btDbvtProxy*)na->data;
+			btDbvtProxy*	pb=(btDbvtProxy*)nb->data;
+#if DBVT_BP_SORTPAIRS
+			if(pa->m_uniqueId>pb->m_uniqueId) 
+				btSwap(pa,pb);
+#endif
+			/* The cache is only read here, pairs it does not have yet are added by the merge	*/ 
+			++lookups;
+			if(!pbp->m_paircache->findPair(pa,pb))
+			{
+				btDbvtBroadphase::sFoundPair	pair;
+				pair.task	=	task;
+				pair.proxy0	=	pa;
+				pair.proxy1	=	pb;
+				found->pairs.push_back(pair);
+			}
+			++overlaps;
+		}
+	}
+};
+
+/* Runs a range of collide tasks	*/ 
+struct	btDbvtCollideTasks : btIParallelForBody
+{
+	btDbvtBroadphase*	pbp;
+	void	forLoop(int iBegin,int iEnd) const BT_OVERRIDE
+	{
+		int	threadIndex=0;
+#if BT_THREADSAFE
+		threadIndex=btGetCurrentThreadIndex();
+		btAssert(threadIndex<pbp->m_threadFoundPairs.size());
+#endif
+		btDbvtParallelTreeCollider	collider;
+		collider.pbp	=	pbp;
+		collider.found	=	&pbp->m_threadFoundPairs[threadIndex];
+		collider.overlaps=	0;
+		collider.lookups=	0;
+		for(int i=iBegin;i<iEnd;++i)
+		{
+			const btDbvt::sStkNN&	t=pbp->m_collideTasks[i];
+			collider.task=i;
+			pbp->m_sets[0].collideTT(t.a,t.b,collider);
+		}
+		collider.found->overlaps+=collider.overlaps;
+		collider.found->lookups+=collider.lookups;
+	}
+};
+
 //
 // btDbvtBroadphase
 //
@@ -145,8 +214,12 @@ btDbvtBroadphase::btDbvtBroadphase(btOverlappingPairCache* paircache)
 	}
 #if BT_THREADSAFE
     m_rayTestStacks.resize(BT_MAX_THREAD_COUNT);
+	m_threadFoundPairs.resize(BT_MAX_THREAD_COUNT);
+	m_parallelcollide	=	true;
 #else
     m_rayTestStacks.resize(1);
+	m_threadFoundPairs.resize(1);
+	m_parallelcollide	=	false;
 #endif
 #if DBVT_BP_PROFILE
 	clear(m_profiling);
@@ -275,6 +348,142 @@ void	btDbvtBroadphase::rayTest(const btVector3& rayFrom,const btVector3& rayTo,
 }
 
 
+//
+// Ray packets
+//
+
+/* Four rays, one per lane	*/ 
+ATTRIBUTE_ALIGNED16(struct)	btDbvtRayPacket
+{
+	btScalar	from[3][4];
+	btScalar	invdir[3][4];
+	btScalar	lambda[4];
+};
+
+struct	btDbvtRayPacketNode
+{
+	const btDbvtNode*	node;
+	unsigned int		mask;
+};
+
+/* Returns the lanes of mask whose ray hits the volume, slab test as btRayAabb2	*/ 
+static SIMD_FORCE_INLINE unsigned int	rayPacketTest(const btDbvtRayPacket& packet,const btDbvtVolume& volume,unsigned int mask)
+{
+#if DBVT_BP_RAYPACKET_SSE
+	__m128	tmin=_mm_setzero_ps();
+	__m128	tmax=_mm_load_ps(packet.lambda);
+	for(int a=0;a<3;++a)
+	{
+		const __m128	from=_mm_load_ps(packet.from[a]);
+		const __m128	invdir=_mm_load_ps(packet.invdir[a]);
+		const __m128	t0=_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(volume.Mins()[a]),from),invdir);
+		const __m128	t1=_mm_mul_ps(_mm_sub_ps(_mm_set1_ps(volume.Maxs()[a]),from),invdir);
+		tmin=_mm_max_ps(tmin,_mm_min_ps(t0,t1));
+		tmax=_mm_min_ps(tmax,_mm_max_ps(t0,t1));
+	}
+	return(mask&(unsigned int)_mm_movemask_ps(_mm_cmple_ps(tmin,tmax)));
+#else
+	unsigned int	lanes=0;
+	for(int i=0;i<4;++i)
+	{
+		if(mask&(1u<<i))
+		{
+			btScalar	tmin=0,tmax=packet.lambda[i];
+			for(int a=0;a<3;++a)
+			{
+				const btScalar	t0=(volume.Mins()[a]-packet.from[a][i])*packet.invdir[a][i];
+				const btScalar	t1=(volume.Maxs()[a]-packet.from[a][i])*packet.invdir[a][i];
+				tmin=btMax(tmin,btMin(t0,t1));
+				tmax=btMin(tmax,btMax(t0,t1));
+			}
+			if(tmin<=tmax) lanes|=1u<<i;
+		}
+	}
+	return(lanes);
+#endif
+}
+
+/* Descends while any lane of the packet still hits, appending leaves to the hits of each lane	*/ 
+static void							rayPacketTraverse(	const btDbvtNode* root,
+														const btDbvtRayPacket& packet,
+														unsigned int mask,
+														btAlignedObjectArray<btDbvtRayPacketNode>& stack,
+														btAlignedObjectArray<btBroadphaseProxy*>* hits)
+{
+	if(!root) return;
+	btDbvtRayPacketNode	top;
+	top.node=root;
+	top.mask=mask;
+	stack.resize(0);
+	stack.push_back(top);
+	while(stack.size()>0)
+	{
+		const btDbvtRayPacketNode	current=stack[stack.size()-1];
+		stack.pop_back();
+		const unsigned int			lanes=rayPacketTest(packet,current.node->volume,current.mask);
+		if(lanes)
+		{
+			if(current.node->isinternal())
+			{
+				/* Same order as rayTestInternal, so hits are reported in the same order as rayTest	*/ 
+				btDbvtRayPacketNode	child;
+				child.mask=lanes;
+				child.node=current.node->childs[0];
+				stack.push_back(child);
+				child.node=current.node->childs[1];
+				stack.push_back(child);
+			}
+			else
+			{
+				for(int i=0;i<4;++i)
+				{
+					if(lanes&(1u<<i)) hits[i].push_back((btBroadphaseProxy*)current.node->data);
+				}
+			}
+		}
+	}
+}
+
+//
+void	btDbvtBroadphase::rayTestBatch(const btVector3* rayFrom,const btVector3* rayTo,int numRays,btAlignedObjectArray<int>& candidateOffsets,btAlignedObjectArray<btBroadphaseProxy*>& candidates)
+{
+	btAlignedObjectArray<btDbvtRayPacketNode>	stack;
+	btAlignedObjectArray<btBroadphaseProxy*>	hits[4];
+	candidateOffsets.resize(numRays+1);
+	candidates.resize(0);
+	for(int first=0;first<numRays;first+=4)
+	{
+		const int		count=btMin(4,numRays-first);
+		btDbvtRayPacket	packet;
+		for(int i=0;i<4;++i)
+		{
+			/* Lanes past the last ray repeat it, and are masked out	*/ 
+			const int	ray=first+btMin(i,count-1);
+			btVector3	rayDir=rayTo[ray]-rayFrom[ray];
+			rayDir.normalize();
+			for(int a=0;a<3;++a)
+			{
+				packet.from[a][i]	=	rayFrom[ray][a];
+				packet.invdir[a][i]	=	rayDir[a]==btScalar(0.0)?btScalar(BT_LARGE_FLOAT):btScalar(1.0)/rayDir[a];
+			}
+			packet.lambda[i]=rayDir.dot(rayTo[ray]-rayFrom[ray]);
+			hits[i].resize(0);
+		}
+		const unsigned int	mask=(1u<<count)-1;
+		rayPacketTraverse(m_sets[0].m_root,packet,mask,stack,hits);
+		rayPacketTraverse(m_sets[1].m_root,packet,mask,stack,hits);
+		for(int i=0;i<count;++i)
+		{
+			candidateOffsets[first+i]=candidates.size();
+			for(int j=0;j<hits[i].size();++j)
+			{
+				candidates.push_back(hits[i][j]);
+			}
+		}
+	}
+	candidateOffsets[numRays]=candidates.size();
+}
+
 struct	BroadphaseAabbTester : btDbvt::ICollide
 {
 	btBroadphaseAabbCallback& m_aabbCallback;
@@ -567,6 +776,12 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 		m_needcleanup=true;
 	}
 	/* collide dynamics		*/ 
+	if(m_deferedcollide&&m_parallelcollide)
+	{
+		SPC(m_profiling.m_fdcollide);
+		collideParallel();
+	}
+	else
 	{
 		btDbvtTreeCollider	collider(this);
 		if(m_deferedcollide)
@@ -618,6 +833,117 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 	m_updates_call/=2;
 }
 
+//
+void							btDbvtBroadphase::collideParallel()
+{
+	/* Split dynamic/fixed and dynamic/dynamic into subtree pairs, descending the way collideTT does	*/ 
+	m_collideTasks.resize(0);
+	if(m_sets[0].m_root)
+	{
+		if(m_sets[1].m_root)
+			m_collideTasks.push_back(btDbvt::sStkNN(m_sets[0].m_root,m_sets[1].m_root));
+		m_collideTasks.push_back(btDbvt::sStkNN(m_sets[0].m_root,m_sets[0].m_root));
+	}
+	bool	split=true;
+	while(split&&(m_collideTasks.size()>0)&&(m_collideTasks.size()<DBVT_BP_COLLIDE_TASKS))
+	{
+		split=false;
+		const int	count=m_collideTasks.size();
+		int			kept=0;
+		for(int i=0;i<count;++i)
+		{
+			const btDbvt::sStkNN	t=m_collideTasks[i];
+			if(t.a==t.b)
+			{
+				if(t.a->isinternal())
+				{
+					m_collideTasks[kept++]=btDbvt::sStkNN(t.a->childs[0],t.a->childs[0]);
+					m_collideTasks.push_back(btDbvt::sStkNN(t.a->childs[1],t.a->childs[1]));
+					m_collideTasks.push_back(btDbvt::sStkNN(t.a->childs[0],t.a->childs[1]));
+					split=true;
+				}
+			}
+			else if(Intersect(t.a->volume,t.b->volume))
+			{
+				if(t.a->isinternal()&&t.b->isinternal())
+				{
+					m_collideTasks[kept++]=btDbvt::sStkNN(t.a->childs[0],t.b->childs[0]);
+					m_collideTasks.push_back(btDbvt::sStkNN(t.a->childs[1],t.b->childs[0]));
+					m_collideTasks.push_back(btDbvt::sStkNN(t.a->childs[0],t.b->childs[1]));
+					m_collideTasks.push_back(btDbvt::sStkNN(t.a->childs[1],t.b->childs[1]));
+					split=true;
+				}
+				else if(t.a->isinternal())
+				{
+					m_collideTasks[kept++]=btDbvt::sStkNN(t.a->childs[0],t.b);
+					m_collideTasks.push_back(btDbvt::sStkNN(t.a->childs[1],t.b));
+					split=true;
+				}
+				else if(t.b->isinternal())
+				{
+					m_collideTasks[kept++]=btDbvt::sStkNN(t.a,t.b->childs[0]);
+					m_collideTasks.push_back(btDbvt::sStkNN(t.a,t.b->childs[1]));
+					split=true;
+				}
+				else
+				{
+					m_collideTasks[kept++]=t;
+				}
+			}
+		}
+		for(int i=count;i<m_collideTasks.size();++i)
+		{
+			m_collideTasks[kept++]=m_collideTasks[i];
+		}
+		m_collideTasks.resize(kept);
+	}
+	/* Traverse the subtree pairs in parallel, each thread collecting new pairs into its own buffer	*/ 
+	for(int i=0;i<m_threadFoundPairs.size();++i)
+	{
+		m_threadFoundPairs[i].pairs.resize(0);
+		m_threadFoundPairs[i].overlaps=0;
+		m_threadFoundPairs[i].lookups=0;
+	}
+	btDbvtCollideTasks	tasks;
+	tasks.pbp=this;
+	const int	findPairs=gFindPairs;
+	btParallelForOrSerial(0,m_collideTasks.size(),4,tasks);
+	/* The pair caches don't count lookups made while threads are running, count them here either way	*/ 
+	gFindPairs=findPairs;
+	/* Merge in task order, so the pair cache ends up the same whatever the number of threads	*/ 
+	m_taskPairOffsets.resize(0);
+	m_taskPairOffsets.resize(m_collideTasks.size()+1,0);
+	int	total=0;
+	for(int i=0;i<m_threadFoundPairs.size();++i)
+	{
+		const btAlignedObjectArray<sFoundPair>&	pairs=m_threadFoundPairs[i].pairs;
+		for(int j=0;j<pairs.size();++j)
+		{
+			++m_taskPairOffsets[pairs[j].task+1];
+		}
+		total+=pairs.size();
+		m_newpairs+=m_threadFoundPairs[i].overlaps;
+		gFindPairs+=m_threadFoundPairs[i].lookups;
+	}
+	for(int i=1;i<m_taskPairOffsets.size();++i)
+	{
+		m_taskPairOffsets[i]+=m_taskPairOffsets[i-1];
+	}
+	m_foundPairs.resize(total);
+	for(int i=0;i<m_threadFoundPairs.size();++i)
+	{
+		const btAlignedObjectArray<sFoundPair>&	pairs=m_threadFoundPairs[i].pairs;
+		for(int j=0;j<pairs.size();++j)
+		{
+			m_foundPairs[m_taskPairOffsets[pairs[j].task]++]=pairs[j];
+		}
+	}
+	for(int i=0;i<total;++i)
+	{
+		m_paircache->addOverlappingPair(m_foundPairs[i].proxy0,m_foundPairs[i].proxy1);
+	}
+}
+
 //
 void							btDbvtBroadphase::optimize()
 {
@@ -687,6 +1013,249 @@ void btDbvtBroadphase::resetPool(btDispatcher* dispatcher)
 	}
 }
 
+//
+struct	btDbvtBroadphaseState
+{
+	int			numnodes[2];
+	int			lkhd[2];
+	unsigned	opath[2];
+	int			numstageproxies[btDbvtBroadphase::STAGECOUNT+1];
+	int			stageCurrent;
+	int			fupdates;
+	int			dupdates;
+	int			cupdates;
+	int			newpairs;
+	int			fixedleft;
+	unsigned	updates_call;
+	unsigned	updates_done;
+	btScalar	updates_ratio;
+	int			pid;
+	int			cid;
+	int			gid;
+	int			needcleanup;
+};
+
+// Where the next node read by restoreState goes
+struct	btDbvtStateSlot
+{
+	btDbvtNode*	parent;
+	int			child;
+};
+
+// Saved per node, depth first with child 0 first: the volume, then the unique id of the proxy of a leaf, -1 for an internal node
+static const int	DBVT_BP_STATE_NODESIZE=sizeof(btDbvtVolume)+sizeof(int);
+// Saved per proxy, in stage list order: the unique id, then the aabb
+static const int	DBVT_BP_STATE_PROXYSIZE=sizeof(int)+2*sizeof(btVector3);
+
+//
+template <typename T>
+static inline void	appendstate(btAlignedObjectArray<unsigned char>& state,const T& value)
+{
+	const int	offset=state.size();
+	if(offset+(int)sizeof(T)>state.capacity()) state.reserve(btMax(2*state.capacity(),offset+(int)sizeof(T)));
+	state.resizeNoInitialize(offset+sizeof(T));
+	memcpy(&state[offset],&value,sizeof(T));
+}
+
+//
+template <typename T>
+static inline const unsigned char*	readstate(const unsigned char* state,T& value)
+{
+	memcpy(&value,state,sizeof(T));
+	return(state+sizeof(T));
+}
+
+//
+void							btDbvtBroadphase::saveState(btAlignedObjectArray<unsigned char>& state) const
+{
+	btDbvtBroadphaseState	header;
+	memset(&header,0,sizeof(header));
+	for(int i=0;i<2;++i)
+	{
+		header.numnodes[i]	=	m_sets[i].m_root?m_sets[i].m_leaves*2-1:0;
+		header.lkhd[i]		=	m_sets[i].m_lkhd;
+		header.opath[i]		=	m_sets[i].m_opath;
+	}
+	for(int i=0;i<=STAGECOUNT;++i)
+	{
+		header.numstageproxies[i]=listcount(m_stageRoots[i]);
+	}
+	header.stageCurrent		=	m_stageCurrent;
+	header.fupdates			=	m_fupdates;
+	header.dupdates			=	m_dupdates;
+	header.cupdates			=	m_cupdates;
+	header.newpairs			=	m_newpairs;
+	header.fixedleft		=	m_fixedleft;
+	header.updates_call		=	m_updates_call;
+	header.updates_done		=	m_updates_done;
+	header.updates_ratio	=	m_updates_ratio;
+	header.pid				=	m_pid;
+	header.cid				=	m_cid;
+	header.gid				=	m_gid;
+	header.needcleanup		=	m_needcleanup?1:0;
+	appendstate(state,header);
+	btAlignedObjectArray<const btDbvtNode*>	stack;
+	for(int i=0;i<2;++i)
+	{
+		if(m_sets[i].m_root) stack.push_back(m_sets[i].m_root);
+		while(stack.size())
+		{
+			const btDbvtNode*	node=stack[stack.size()-1];
+			stack.pop_back();
+			appendstate(state,node->volume);
+			if(node->isinternal())
+			{
+				appendstate(state,-1);
+				stack.push_back(node->childs[1]);
+				stack.push_back(node->childs[0]);
+			}
+			else
+			{
+				appendstate(state,((const btDbvtProxy*)node->data)->m_uniqueId);
+			}
+		}
+	}
+	for(int i=0;i<=STAGECOUNT;++i)
+	{
+		for(const btDbvtProxy* proxy=m_stageRoots[i];proxy;proxy=proxy->links[1])
+		{
+			appendstate(state,proxy->m_uniqueId);
+			appendstate(state,proxy->m_aabbMin);
+			appendstate(state,proxy->m_aabbMax);
+		}
+	}
+}
+
+//
+bool							btDbvtBroadphase::restoreState(const unsigned char* state,int size)
+{
+	btDbvtBroadphaseState	header;
+	if(size<(int)sizeof(header)) return(false);
+	const unsigned char*	nodes=readstate(state,header);
+	int	numproxies=0;
+	for(int i=0;i<=STAGECOUNT;++i) numproxies+=header.numstageproxies[i];
+	const unsigned char*	proxies=nodes+(header.numnodes[0]+header.numnodes[1])*DBVT_BP_STATE_NODESIZE;
+	if(proxies+numproxies*DBVT_BP_STATE_PROXYSIZE!=state+size) return(false);
+	/* check that the state refers to the current proxies	*/ 
+	btHashMap<btHashInt,btDbvtProxy*>	proxymap;
+	int	numcurrent=0;
+	for(int i=0;i<=STAGECOUNT;++i)
+	{
+		for(btDbvtProxy* proxy=m_stageRoots[i];proxy;proxy=proxy->links[1])
+		{
+			proxymap.insert(btHashInt(proxy->m_uniqueId),proxy);
+			++numcurrent;
+		}
+	}
+	if(numcurrent!=numproxies) return(false);
+	for(int i=0;i<numproxies;++i)
+	{
+		int	uid;
+		readstate(proxies+i*DBVT_BP_STATE_PROXYSIZE,uid);
+		if(!proxymap.find(btHashInt(uid))) return(false);
+	}
+	for(int i=0;i<header.numnodes[0]+header.numnodes[1];++i)
+	{
+		int	uid;
+		readstate(nodes+i*DBVT_BP_STATE_NODESIZE+sizeof(btDbvtVolume),uid);
+		if((uid>=0)&&!proxymap.find(btHashInt(uid))) return(false);
+	}
+	/* rebuild the trees, reusing their nodes	*/ 
+	btAlignedObjectArray<btDbvtNode*>	freenodes;
+	for(int i=0;i<2;++i)
+	{
+		if(m_sets[i].m_root) freenodes.push_back(m_sets[i].m_root);
+	}
+	for(int i=0;i<freenodes.size();++i)
+	{
+		if(freenodes[i]->isinternal())
+		{
+			freenodes.push_back(freenodes[i]->childs[0]);
+			freenodes.push_back(freenodes[i]->childs[1]);
+		}
+	}
+	btAlignedObjectArray<btDbvtStateSlot>	slots;
+	const unsigned char*	record=nodes;
+	for(int i=0;i<2;++i)
+	{
+		btDbvt&	set=m_sets[i];
+		set.m_root		=	0;
+		set.m_leaves	=	0;
+		set.m_lkhd		=	header.lkhd[i];
+		set.m_opath		=	header.opath[i];
+		btDbvtStateSlot	root={0,0};
+		if(header.numnodes[i]) slots.push_back(root);
+		for(int j=0;j<header.numnodes[i];++j)
+		{
+			const btDbvtStateSlot	slot=slots[slots.size()-1];
+			slots.pop_back();
+			btDbvtNode*	node;
+			if(freenodes.size())
+			{
+				node=freenodes[freenodes.size()-1];
+				freenodes.pop_back();
+			}
+			else
+			{
+				node=new(btAlignedAlloc(sizeof(btDbvtNode),16)) btDbvtNode();
+			}
+			int	uid;
+			record=readstate(readstate(record,node->volume),uid);
+			node->parent=slot.parent;
+			if(slot.parent) slot.parent->childs[slot.child]=node; else set.m_root=node;
+			if(uid<0)
+			{
+				btDbvtStateSlot	child1={node,1};
+				btDbvtStateSlot	child0={node,0};
+				slots.push_back(child1);
+				slots.push_back(child0);
+			}
+			else
+			{
+				btDbvtProxy*	proxy=*proxymap.find(btHashInt(uid));
+				node->data		=	proxy;
+				node->childs[1]	=	0;
+				proxy->leaf		=	node;
+				++set.m_leaves;
+			}
+		}
+	}
+	for(int i=0;i<freenodes.size();++i)
+	{
+		btAlignedFree(freenodes[i]);
+	}
+	/* stage lists, kept in their saved order	*/ 
+	const unsigned char*	stagerecords=proxies;
+	for(int i=0;i<=STAGECOUNT;++i)
+	{
+		m_stageRoots[i]=0;
+		for(int j=header.numstageproxies[i]-1;j>=0;--j)
+		{
+			int	uid;
+			const unsigned char*	proxyrecord=readstate(stagerecords+j*DBVT_BP_STATE_PROXYSIZE,uid);
+			btDbvtProxy*	proxy=*proxymap.find(btHashInt(uid));
+			readstate(readstate(proxyrecord,proxy->m_aabbMin),proxy->m_aabbMax);
+			proxy->stage=i;
+			listappend(proxy,m_stageRoots[i]);
+		}
+		stagerecords+=header.numstageproxies[i]*DBVT_BP_STATE_PROXYSIZE;
+	}
+	m_stageCurrent	=	header.stageCurrent;
+	m_fupdates		=	header.fupdates;
+	m_dupdates		=	header.dupdates;
+	m_cupdates		=	header.cupdates;
+	m_newpairs		=	header.newpairs;
+	m_fixedleft		=	header.fixedleft;
+	m_updates_call	=	header.updates_call;
+	m_updates_done	=	header.updates_done;
+	m_updates_ratio	=	header.updates_ratio;
+	m_pid			=	header.pid;
+	m_cid			=	header.cid;
+	m_gid			=	header.gid;
+	m_needcleanup	=	header.needcleanup!=0;
+	return(true);
+}
+
 //
 void							btDbvtBroadphase::printStats()
 {}
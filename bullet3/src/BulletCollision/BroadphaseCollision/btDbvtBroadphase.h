@@ -30,6 +30,7 @@ subject to the following restrictions:
 #define DBVT_BP_ACCURATESLEEPING		0
 #define DBVT_BP_ENABLE_BENCHMARK		0
 #define DBVT_BP_MARGIN					(btScalar)0.05
+#define DBVT_BP_COLLIDE_TASKS			256		// Minimum number of subtree pairs the parallel collide is split into
 
 #if DBVT_BP_PROFILE
 #define	DBVT_BP_PROFILING_RATE	256
@@ -87,7 +88,25 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	bool					m_releasepaircache;			// Release pair cache on delete
 	bool					m_deferedcollide;			// Defere dynamic/static collision to collide call
 	bool					m_needcleanup;				// Need to run cleanup?
+	bool					m_parallelcollide;			// Split the deferred collide over btParallelFor
     btAlignedObjectArray< btAlignedObjectArray<const btDbvtNode*> > m_rayTestStacks;
+	/* Parallel collide	*/ 
+	struct	sFoundPair
+	{
+		int					task;
+		btDbvtProxy*		proxy0;
+		btDbvtProxy*		proxy1;
+	};
+	btAlignedObjectArray<btDbvt::sStkNN>					m_collideTasks;			// Subtree pairs, one per parallel task
+	struct	sThreadPairs
+	{
+		btAlignedObjectArray<sFoundPair>	pairs;			// Overlaps not in the pair cache yet
+		int									overlaps;		// All overlaps found, as counted into m_newpairs
+		int									lookups;		// Pair cache lookups, added to gFindPairs after the merge
+	};
+	btAlignedObjectArray<sThreadPairs>						m_threadFoundPairs;		// Found by each thread
+	btAlignedObjectArray<sFoundPair>						m_foundPairs;			// New pairs in task order
+	btAlignedObjectArray<int>								m_taskPairOffsets;
 #if DBVT_BP_PROFILE
 	btClock					m_clock;
 	struct	{
@@ -102,6 +121,7 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	btDbvtBroadphase(btOverlappingPairCache* paircache=0);
 	~btDbvtBroadphase();
 	void							collide(btDispatcher* dispatcher);
+	void							collideParallel();
 	void							optimize();
 	
 	/* btBroadphaseInterface Implementation	*/
@@ -110,6 +130,8 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	virtual void					setAabb(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax,btDispatcher* dispatcher);
 	virtual void					rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
 	virtual void					aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
+	///rayTestBatch traverses the trees with packets of 4 rays
+	virtual void					rayTestBatch(const btVector3* rayFrom,const btVector3* rayTo,int numRays,btAlignedObjectArray<int>& candidateOffsets,btAlignedObjectArray<btBroadphaseProxy*>& candidates);
 
 	virtual void					getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin, btVector3& aabbMax ) const;
 	virtual	void					calculateOverlappingPairs(btDispatcher* dispatcher);
@@ -122,6 +144,10 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	///reset broadphase internal structures, to ensure determinism/reproducability
 	virtual void resetPool(btDispatcher* dispatcher);
 
+	///saveState stores both trees node by node, the stage lists and the update counters, restoreState rebuilds them reusing the tree nodes
+	virtual void	saveState(btAlignedObjectArray<unsigned char>& state) const;
+	virtual bool	restoreState(const unsigned char* state, int size);
+
 	void	performDeferredRemoval(btDispatcher* dispatcher);
 	
 	void	setVelocityPrediction(btScalar prediction)
@@ -26,6 +26,7 @@ struct btCollisionObjectWrapper;
 
 class btPersistentManifold;
 class btPoolAllocator;
+class btFrameArena;
 
 struct btDispatcherInfo
 {
@@ -109,6 +110,12 @@ public:
 
 	virtual	void freeCollisionAlgorithm(void* ptr) = 0;
 
+	///scratch memory for the collision algorithms on the calling thread, released within the step. 0 means they use the heap
+	virtual	btFrameArena*	getThreadFrameArena()
+	{
+		return 0;
+	}
+
 };
 
 
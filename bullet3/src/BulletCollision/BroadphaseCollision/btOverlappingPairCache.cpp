@@ -20,6 +20,7 @@ subject to the following restrictions:
 #include "btDispatcher.h"
 #include "btCollisionAlgorithm.h"
 #include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btThreads.h"
 
 #include <stdio.h>
 
@@ -134,7 +135,9 @@ void	btHashedOverlappingPairCache::removeOverlappingPairsContainingProxy(btBroad
 
 btBroadphasePair* btHashedOverlappingPairCache::findPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
 {
-	gFindPairs++;
+	//lookups from worker threads are counted by their callers
+	if (!btThreadsAreRunning())
+		gFindPairs++;
 	if(proxy0->m_uniqueId>proxy1->m_uniqueId) 
 		btSwap(proxy0,proxy1);
 	int proxyId1 = proxy0->getUid();
@@ -426,6 +429,296 @@ void	btHashedOverlappingPairCache::sortOverlappingPairs(btDispatcher* dispatcher
 }
 
 
+
+btOpenAddressingOverlappingPairCache::btOpenAddressingOverlappingPairCache():
+	m_overlapFilterCallback(0),
+	m_ghostPairCallback(0),
+	m_batchUpdating(false)
+{
+	Slot empty;
+	empty.m_uid0 = 0;
+	empty.m_uid1 = 0;
+	empty.m_pairIndex = -1;
+	m_slots.resize(64,empty);
+}
+
+btOpenAddressingOverlappingPairCache::~btOpenAddressingOverlappingPairCache()
+{
+}
+
+void	btOpenAddressingOverlappingPairCache::cleanOverlappingPair(btBroadphasePair& pair,btDispatcher* dispatcher)
+{
+	if (pair.m_algorithm && dispatcher)
+	{
+		pair.m_algorithm->~btCollisionAlgorithm();
+		dispatcher->freeCollisionAlgorithm(pair.m_algorithm);
+		pair.m_algorithm=0;
+	}
+}
+
+void	btOpenAddressingOverlappingPairCache::rebuildSlots(int numSlots)
+{
+	//only the table is read, the keys are in the slots
+	btAlignedObjectArray<Slot> oldSlots;
+	oldSlots.copyFromArray(m_slots);
+	Slot empty;
+	empty.m_uid0 = 0;
+	empty.m_uid1 = 0;
+	empty.m_pairIndex = -1;
+	m_slots.resize(0);
+	m_slots.resize(numSlots,empty);
+	for (int i=0;i<oldSlots.size();i++)
+	{
+		if (oldSlots[i].m_pairIndex>=0)
+			m_slots[findSlot(oldSlots[i].m_uid0,oldSlots[i].m_uid1)] = oldSlots[i];
+	}
+}
+
+btBroadphasePair*	btOpenAddressingOverlappingPairCache::internalAddPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1)
+{
+	btAssert(proxy0->m_uniqueId<proxy1->m_uniqueId);
+	int uid0 = proxy0->getUid();
+	int uid1 = proxy1->getUid();
+	int slotIndex = findSlot(uid0,uid1);
+	if (m_slots[slotIndex].m_pairIndex>=0)
+		return &m_overlappingPairArray[m_slots[slotIndex].m_pairIndex];
+
+	int count = m_overlappingPairArray.size();
+	//keep the table at most half full, so the probe sequences stay short
+	if ((count+1)*2 > m_slots.size())
+	{
+		rebuildSlots(m_slots.size()*2);
+		slotIndex = findSlot(uid0,uid1);
+	}
+
+	void* mem = &m_overlappingPairArray.expandNonInitializing();
+
+	//this is where we add an actual pair, so also call the 'ghost'
+	if (m_ghostPairCallback)
+		m_ghostPairCallback->addOverlappingPair(proxy0,proxy1);
+
+	btBroadphasePair* pair = new (mem) btBroadphasePair(*proxy0,*proxy1);
+	pair->m_algorithm = 0;
+	pair->m_internalTmpValue = 0;
+
+	Slot& slot = m_slots[slotIndex];
+	slot.m_uid0 = uid0;
+	slot.m_uid1 = uid1;
+	slot.m_pairIndex = count;
+	return pair;
+}
+
+void*	btOpenAddressingOverlappingPairCache::internalRemovePair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,btDispatcher* dispatcher)
+{
+	btAssert(proxy0->m_uniqueId<proxy1->m_uniqueId);
+	int slotIndex = findSlot(proxy0->getUid(),proxy1->getUid());
+	int pairIndex = m_slots[slotIndex].m_pairIndex;
+	if (pairIndex<0)
+		return 0;
+
+	btBroadphasePair& pair = m_overlappingPairArray[pairIndex];
+	cleanOverlappingPair(pair,dispatcher);
+	void* userData = pair.m_internalInfo1;
+
+	//close the gap by shifting back the following slots of the cluster that can move, no tombstones needed
+	int mask = m_slots.size()-1;
+	int hole = slotIndex;
+	for (int index = (hole+1)&mask; m_slots[index].m_pairIndex>=0; index = (index+1)&mask)
+	{
+		int home = getHomeSlot(m_slots[index].m_uid0,m_slots[index].m_uid1);
+		//the slot can move when its home is not in the cyclic range (hole,index]
+		if (((index-home)&mask) >= ((index-hole)&mask))
+		{
+			m_slots[hole] = m_slots[index];
+			hole = index;
+		}
+	}
+	m_slots[hole].m_pairIndex = -1;
+
+	if (m_ghostPairCallback)
+		m_ghostPairCallback->removeOverlappingPair(proxy0,proxy1,dispatcher);
+
+	//move the last pair into the spot of the removed pair, like btHashedOverlappingPairCache
+	int lastPairIndex = m_overlappingPairArray.size()-1;
+	if (pairIndex != lastPairIndex)
+	{
+		m_overlappingPairArray[pairIndex] = m_overlappingPairArray[lastPairIndex];
+		const btBroadphasePair& moved = m_overlappingPairArray[pairIndex];
+		m_slots[findSlot(moved.m_pProxy0->getUid(),moved.m_pProxy1->getUid())].m_pairIndex = pairIndex;
+	}
+	m_overlappingPairArray.pop_back();
+	return userData;
+}
+
+void	btOpenAddressingOverlappingPairCache::stageChange(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,btDispatcher* dispatcher,bool add)
+{
+	btAlignedObjectArray<StagedChange>& changes = m_stages[btGetCurrentThreadIndex()].m_changes;
+	StagedChange change;
+	change.m_proxy0 = proxy0;
+	change.m_proxy1 = proxy1;
+	change.m_dispatcher = dispatcher;
+	change.m_add = add;
+	changes.push_back(change);
+}
+
+btBroadphasePair*	btOpenAddressingOverlappingPairCache::addOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1)
+{
+	if (!m_batchUpdating)
+		gAddedPairs++;
+
+	if (!needsBroadphaseCollision(proxy0,proxy1))
+		return 0;
+
+	if (proxy0->m_uniqueId>proxy1->m_uniqueId)
+		btSwap(proxy0,proxy1);
+
+	if (m_batchUpdating)
+	{
+		//the table is read-only until endBatchUpdate
+		int pairIndex = m_slots[findSlot(proxy0->getUid(),proxy1->getUid())].m_pairIndex;
+		if (pairIndex>=0)
+			return &m_overlappingPairArray[pairIndex];
+		stageChange(proxy0,proxy1,0,true);
+		return 0;
+	}
+	return internalAddPair(proxy0,proxy1);
+}
+
+void*	btOpenAddressingOverlappingPairCache::removeOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,btDispatcher* dispatcher)
+{
+	if (proxy0->m_uniqueId>proxy1->m_uniqueId)
+		btSwap(proxy0,proxy1);
+
+	if (m_batchUpdating)
+	{
+		stageChange(proxy0,proxy1,dispatcher,false);
+		return 0;
+	}
+	gRemovePairs++;
+	return internalRemovePair(proxy0,proxy1,dispatcher);
+}
+
+void	btOpenAddressingOverlappingPairCache::removeOverlappingPairsContainingProxy(btBroadphaseProxy* proxy,btDispatcher* dispatcher)
+{
+	btAssert(!m_batchUpdating);
+	for (int i=0;i<m_overlappingPairArray.size();)
+	{
+		btBroadphasePair& pair = m_overlappingPairArray[i];
+		if (pair.m_pProxy0==proxy || pair.m_pProxy1==proxy)
+		{
+			//the last pair is moved into this spot
+			removeOverlappingPair(pair.m_pProxy0,pair.m_pProxy1,dispatcher);
+		} else
+		{
+			i++;
+		}
+	}
+}
+
+void	btOpenAddressingOverlappingPairCache::cleanProxyFromPairs(btBroadphaseProxy* proxy,btDispatcher* dispatcher)
+{
+	for (int i=0;i<m_overlappingPairArray.size();i++)
+	{
+		btBroadphasePair& pair = m_overlappingPairArray[i];
+		if (pair.m_pProxy0==proxy || pair.m_pProxy1==proxy)
+			cleanOverlappingPair(pair,dispatcher);
+	}
+}
+
+btBroadphasePair*	btOpenAddressingOverlappingPairCache::findPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1)
+{
+	if (!m_batchUpdating && !btThreadsAreRunning())
+		gFindPairs++;
+	if (proxy0->m_uniqueId>proxy1->m_uniqueId)
+		btSwap(proxy0,proxy1);
+	int pairIndex = m_slots[findSlot(proxy0->getUid(),proxy1->getUid())].m_pairIndex;
+	return pairIndex>=0 ? &m_overlappingPairArray[pairIndex] : 0;
+}
+
+void	btOpenAddressingOverlappingPairCache::processAllOverlappingPairs(btOverlapCallback* callback,btDispatcher* dispatcher)
+{
+	BT_PROFILE("btOpenAddressingOverlappingPairCache::processAllOverlappingPairs");
+	btAssert(!m_batchUpdating);
+	for (int i=0;i<m_overlappingPairArray.size();)
+	{
+		btBroadphasePair* pair = &m_overlappingPairArray[i];
+		if (callback->processOverlap(*pair))
+		{
+			removeOverlappingPair(pair->m_pProxy0,pair->m_pProxy1,dispatcher);
+
+			gOverlappingPairs--;
+		} else
+		{
+			i++;
+		}
+	}
+}
+
+void	btOpenAddressingOverlappingPairCache::sortOverlappingPairs(btDispatcher* dispatcher)
+{
+	(void)dispatcher;
+	btAssert(!m_batchUpdating);
+	m_overlappingPairArray.quickSort(btBroadphasePairSortPredicate());
+	for (int i=0;i<m_slots.size();i++)
+		m_slots[i].m_pairIndex = -1;
+	for (int i=0;i<m_overlappingPairArray.size();i++)
+	{
+		const btBroadphasePair& pair = m_overlappingPairArray[i];
+		Slot& slot = m_slots[findSlot(pair.m_pProxy0->getUid(),pair.m_pProxy1->getUid())];
+		slot.m_uid0 = pair.m_pProxy0->getUid();
+		slot.m_uid1 = pair.m_pProxy1->getUid();
+		slot.m_pairIndex = i;
+	}
+}
+
+void	btOpenAddressingOverlappingPairCache::beginBatchUpdate()
+{
+	btAssert(!m_batchUpdating);
+	if (m_stages.size() < int(BT_MAX_THREAD_COUNT))
+		m_stages.resize(BT_MAX_THREAD_COUNT);
+	m_batchUpdating = true;
+}
+
+bool	btOpenAddressingOverlappingPairCache::StagedChangeSortPredicate::operator()(const StagedChange& a,const StagedChange& b) const
+{
+	if (a.m_proxy0->m_uniqueId != b.m_proxy0->m_uniqueId)
+		return a.m_proxy0->m_uniqueId < b.m_proxy0->m_uniqueId;
+	if (a.m_proxy1->m_uniqueId != b.m_proxy1->m_uniqueId)
+		return a.m_proxy1->m_uniqueId < b.m_proxy1->m_uniqueId;
+	//the removals of a pair before its additions, so the order the threads staged them in doesn't matter
+	return !a.m_add && b.m_add;
+}
+
+void	btOpenAddressingOverlappingPairCache::endBatchUpdate()
+{
+	BT_PROFILE("btOpenAddressingOverlappingPairCache::endBatchUpdate");
+	btAssert(m_batchUpdating);
+	m_batchUpdating = false;
+	m_mergedChanges.resize(0);
+	for (int i=0;i<m_stages.size();i++)
+	{
+		btAlignedObjectArray<StagedChange>& changes = m_stages[i].m_changes;
+		for (int j=0;j<changes.size();j++)
+			m_mergedChanges.push_back(changes[j]);
+		changes.resize(0);
+	}
+	//sorted by pair, the new pairs are appended in the same order whichever thread staged them
+	m_mergedChanges.quickSort(StagedChangeSortPredicate());
+	for (int i=0;i<m_mergedChanges.size();i++)
+	{
+		const StagedChange& change = m_mergedChanges[i];
+		if (change.m_add)
+		{
+			gAddedPairs++;
+			internalAddPair(change.m_proxy0,change.m_proxy1);
+		} else
+		{
+			gRemovePairs++;
+			internalRemovePair(change.m_proxy0,change.m_proxy1,change.m_dispatcher);
+		}
+	}
+}
+
 void*	btSortedOverlappingPairCache::removeOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1, btDispatcher* dispatcher )
 {
 	if (!hasDeferredRemoval())
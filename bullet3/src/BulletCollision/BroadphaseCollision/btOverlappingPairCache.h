@@ -56,7 +56,7 @@ extern int gFindPairs;
 const int BT_NULL_PAIR=0xffffffff;
 
 ///The btOverlappingPairCache provides an interface for overlapping pair management (add, remove, storage), used by the btBroadphaseInterface broadphases.
-///The btHashedOverlappingPairCache and btSortedOverlappingPairCache classes are two implementations.
+///The btHashedOverlappingPairCache, btOpenAddressingOverlappingPairCache and btSortedOverlappingPairCache classes are implementations.
 class btOverlappingPairCache : public btOverlappingPairCallback
 {
 public:
@@ -276,6 +276,180 @@ private:
 
 
 
+///btOpenAddressingOverlappingPairCache keeps the pairs like btHashedOverlappingPairCache, in one array in the order they were added,
+///with a removed pair replaced by the last one, so the dispatcher sees the same pairs in the same order.
+///Pairs are found with a linear probing hash table that stores the proxy uids inline, so a lookup doesn't touch the pair array
+///and growing the table only reads the table.
+///Between beginBatchUpdate and endBatchUpdate, pairs can be added and removed from any thread: each thread stages its changes,
+///and endBatchUpdate applies them sorted by proxy uids, independent of which thread staged them and when.
+///Only pairs that are not in the cache at beginBatchUpdate are staged for adding, and the removals of a pair are applied before its additions:
+///a pair ends up in the cache if it was added in the batch, or if it was there and wasn't removed, in whatever order the changes were staged.
+ATTRIBUTE_ALIGNED16(class) btOpenAddressingOverlappingPairCache : public btOverlappingPairCache
+{
+protected:
+
+	struct Slot
+	{
+		int	m_uid0;
+		int	m_uid1;
+		int	m_pairIndex;//-1 for an empty slot
+	};
+
+	struct StagedChange
+	{
+		btBroadphaseProxy*	m_proxy0;
+		btBroadphaseProxy*	m_proxy1;
+		btDispatcher*	m_dispatcher;
+		bool	m_add;
+	};
+
+	struct StagedChangeSortPredicate
+	{
+		bool operator()(const StagedChange& a,const StagedChange& b) const;
+	};
+
+	struct ThreadStage
+	{
+		btAlignedObjectArray<StagedChange>	m_changes;
+		char	m_padding[64];//keep the stages of different threads on different cache lines
+	};
+
+	btBroadphasePairArray	m_overlappingPairArray;
+	btAlignedObjectArray<Slot>	m_slots;
+	btAlignedObjectArray<ThreadStage>	m_stages;
+	btAlignedObjectArray<StagedChange>	m_mergedChanges;
+	btOverlapFilterCallback* m_overlapFilterCallback;
+	btOverlappingPairCallback*	m_ghostPairCallback;
+	bool	m_batchUpdating;
+
+	SIMD_FORCE_INLINE int	getHomeSlot(int uid0,int uid1) const
+	{
+		unsigned int key = static_cast<unsigned int>(uid0)*0x9e3779b1u ^ static_cast<unsigned int>(uid1)*0x85ebca6bu;
+		key ^= key >> 15;
+		key *= 0xc2b2ae35u;
+		key ^= key >> 13;
+		return static_cast<int>(key & static_cast<unsigned int>(m_slots.size()-1));
+	}
+
+	///returns the slot of the pair, or the empty slot that ends its probe sequence
+	SIMD_FORCE_INLINE int	findSlot(int uid0,int uid1) const
+	{
+		int mask = m_slots.size()-1;
+		int index = getHomeSlot(uid0,uid1);
+		for (;;)
+		{
+			const Slot& slot = m_slots[index];
+			if (slot.m_pairIndex<0 || (slot.m_uid0==uid0 && slot.m_uid1==uid1))
+				return index;
+			index = (index+1)&mask;
+		}
+	}
+
+	btBroadphasePair*	internalAddPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1);
+
+	void*	internalRemovePair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,btDispatcher* dispatcher);
+
+	void	rebuildSlots(int numSlots);
+
+	void	stageChange(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,btDispatcher* dispatcher,bool add);
+
+public:
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btOpenAddressingOverlappingPairCache();
+	virtual ~btOpenAddressingOverlappingPairCache();
+
+	SIMD_FORCE_INLINE bool needsBroadphaseCollision(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1) const
+	{
+		if (m_overlapFilterCallback)
+			return m_overlapFilterCallback->needBroadphaseCollision(proxy0,proxy1);
+
+		bool collides = (proxy0->m_collisionFilterGroup & proxy1->m_collisionFilterMask) != 0;
+		collides = collides && (proxy1->m_collisionFilterGroup & proxy0->m_collisionFilterMask);
+
+		return collides;
+	}
+
+	///during a batch update, a new pair is staged and 0 is returned
+	virtual btBroadphasePair*	addOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1);
+
+	///during a batch update, the removal is staged and 0 is returned
+	virtual void*	removeOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,btDispatcher* dispatcher);
+
+	virtual void	removeOverlappingPairsContainingProxy(btBroadphaseProxy* proxy,btDispatcher* dispatcher);
+
+	virtual void	cleanProxyFromPairs(btBroadphaseProxy* proxy,btDispatcher* dispatcher);
+
+	virtual	void	cleanOverlappingPair(btBroadphasePair& pair,btDispatcher* dispatcher);
+
+	virtual void	processAllOverlappingPairs(btOverlapCallback*,btDispatcher* dispatcher);
+
+	///during a batch update, finds the pairs as they were before the batch
+	virtual btBroadphasePair*	findPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1);
+
+	///sorts the pairs, and keeps their collision algorithms
+	virtual void	sortOverlappingPairs(btDispatcher* dispatcher);
+
+	///from here until endBatchUpdate, addOverlappingPair and removeOverlappingPair may be called from any thread,
+	///and findPair from any thread that doesn't add or remove. Call from the main thread
+	void	beginBatchUpdate();
+
+	///applies the staged changes, call from the main thread when all threads are done
+	void	endBatchUpdate();
+
+	bool	isBatchUpdating() const
+	{
+		return m_batchUpdating;
+	}
+
+	virtual btBroadphasePair*	getOverlappingPairArrayPtr()
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	const btBroadphasePair*	getOverlappingPairArrayPtr() const
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	btBroadphasePairArray&	getOverlappingPairArray()
+	{
+		return m_overlappingPairArray;
+	}
+
+	const btBroadphasePairArray&	getOverlappingPairArray() const
+	{
+		return m_overlappingPairArray;
+	}
+
+	int	getNumOverlappingPairs() const
+	{
+		return m_overlappingPairArray.size();
+	}
+
+	btOverlapFilterCallback* getOverlapFilterCallback()
+	{
+		return m_overlapFilterCallback;
+	}
+
+	void setOverlapFilterCallback(btOverlapFilterCallback* callback)
+	{
+		m_overlapFilterCallback = callback;
+	}
+
+	virtual bool	hasDeferredRemoval()
+	{
+		return false;
+	}
+
+	virtual	void	setInternalGhostPairCallback(btOverlappingPairCallback* ghostPairCallback)
+	{
+		m_ghostPairCallback = ghostPairCallback;
+	}
+};
+
+
+
 ///btSortedOverlappingPairCache maintains the objects with overlapping AABB
 ///Typically managed by the Broadphase, Axis3Sweep or btSimpleBroadphase
 class	btSortedOverlappingPairCache : public btOverlappingPairCache
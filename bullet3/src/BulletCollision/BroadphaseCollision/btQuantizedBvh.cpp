@@ -18,6 +18,7 @@ subject to the following restrictions:
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btIDebugDraw.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 
 #define RAYAABB2
 
@@ -54,7 +55,10 @@ void btQuantizedBvh::buildInternal()
 
 	m_curNodeIndex = 0;
 
-	buildTree(0,numLeafNodes);
+	if (s_buildMode == BUILD_SAH_BINNED)
+		buildTreeSah(numLeafNodes);
+	else
+		buildTree(0,numLeafNodes);
 
 	///if the entire tree is small then subtree size, we need to create a header info for the tree
 	if(m_useQuantization && !m_SubtreeHeaders.size())
@@ -329,6 +333,424 @@ int	btQuantizedBvh::calcSplittingAxis(int startIndex,int endIndex)
 }
 
 
+btQuantizedBvh::btBuildMode btQuantizedBvh::s_buildMode = btQuantizedBvh::BUILD_MEAN_SPLIT;
+
+#define BT_BVH_SAH_BINS 16
+//nodes with more leaves are binned in chunks of this size, on all threads
+#define BT_BVH_SAH_BIN_CHUNK 16384
+//below this depth the builder halves the leaves instead, so that the depth of the tree stays bounded
+#define BT_BVH_SAH_MAX_DEPTH 64
+
+ATTRIBUTE_ALIGNED16(struct) btBvhBuildRef
+{
+	btVector3	m_aabbMin;
+	btVector3	m_aabbMax;
+	int			m_leafIndex;
+};
+
+///the bounds of a range of refs, and of their centers. The centers are not halved, they are only compared with each other
+struct btBvhRangeBounds
+{
+	btVector3	m_aabbMin;
+	btVector3	m_aabbMax;
+	btVector3	m_centerMin;
+	btVector3	m_centerMax;
+
+	void	clear()
+	{
+		m_aabbMin.setValue(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+		m_aabbMax.setValue(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT));
+		m_centerMin = m_aabbMin;
+		m_centerMax = m_aabbMax;
+	}
+
+	void	merge(const btBvhRangeBounds& other)
+	{
+		m_aabbMin.setMin(other.m_aabbMin);
+		m_aabbMax.setMax(other.m_aabbMax);
+		m_centerMin.setMin(other.m_centerMin);
+		m_centerMax.setMax(other.m_centerMax);
+	}
+};
+
+///the bins also keep the bounds of their centers, so that the children of a split know their bounds without another pass over their refs
+struct btBvhSahBin
+{
+	btBvhRangeBounds	m_bounds;
+	int			m_count;
+
+	void	clear()
+	{
+		m_bounds.clear();
+		m_count = 0;
+	}
+
+	void	merge(const btBvhSahBin& other)
+	{
+		m_bounds.merge(other.m_bounds);
+		m_count += other.m_count;
+	}
+};
+
+static void	btBvhBoundsOfRefs(const btBvhBuildRef* refs,int startIndex,int endIndex,btBvhRangeBounds& bounds)
+{
+	bounds.clear();
+	for (int i=startIndex;i<endIndex;i++)
+	{
+		btVector3 center = refs[i].m_aabbMin+refs[i].m_aabbMax;
+		bounds.m_aabbMin.setMin(refs[i].m_aabbMin);
+		bounds.m_aabbMax.setMax(refs[i].m_aabbMax);
+		bounds.m_centerMin.setMin(center);
+		bounds.m_centerMax.setMax(center);
+	}
+}
+
+static SIMD_FORCE_INLINE int	btBvhSahBinIndex(const btBvhBuildRef& ref,int axis,btScalar centerMin,btScalar binScale)
+{
+	int b = int((ref.m_aabbMin[axis]+ref.m_aabbMax[axis]-centerMin)*binScale);
+	return btMax(0,btMin(BT_BVH_SAH_BINS-1,b));
+}
+
+static void	btBvhBinRefs(const btBvhBuildRef* refs,int startIndex,int endIndex,int axis,btScalar centerMin,btScalar binScale,btBvhSahBin* bins)
+{
+	for (int b=0;b<BT_BVH_SAH_BINS;b++)
+	{
+		bins[b].clear();
+	}
+	for (int i=startIndex;i<endIndex;i++)
+	{
+		btVector3 center = refs[i].m_aabbMin+refs[i].m_aabbMax;
+		btBvhSahBin& bin = bins[btBvhSahBinIndex(refs[i],axis,centerMin,binScale)];
+		bin.m_bounds.m_aabbMin.setMin(refs[i].m_aabbMin);
+		bin.m_bounds.m_aabbMax.setMax(refs[i].m_aabbMax);
+		bin.m_bounds.m_centerMin.setMin(center);
+		bin.m_bounds.m_centerMax.setMax(center);
+		bin.m_count++;
+	}
+}
+
+static SIMD_FORCE_INLINE btScalar	btBvhHalfArea(const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	btVector3 d = aabbMax-aabbMin;
+	return d.x()*d.y()+d.y()*d.z()+d.z()*d.x();
+}
+
+///btQuantizedBvhSahBuilder builds the nodes of a btQuantizedBvh in the same depth first layout as btQuantizedBvh::buildTree.
+///A subtree with n leaves takes 2n-1 nodes, so the right child of a node is known before the left subtree is built,
+///and the subtrees below the top levels are built as independent tasks.
+struct btQuantizedBvhSahBuilder
+{
+	struct Task
+	{
+		btBvhRangeBounds	m_bounds;
+		int	m_startIndex;
+		int	m_endIndex;
+		int	m_nodeIndex;
+		int	m_depth;
+	};
+
+	btQuantizedBvh*	m_bvh;
+	btAlignedObjectArray<btBvhBuildRef>	m_refs;
+	btAlignedObjectArray<Task>	m_tasks;
+	btAlignedObjectArray<btBvhRangeBounds>	m_chunkBounds;
+	btAlignedObjectArray<btBvhSahBin>	m_chunkBins;
+	int	m_taskSize;
+
+	struct InitRefsLoop : public btIParallelForBody
+	{
+		btQuantizedBvhSahBuilder*	m_builder;
+
+		void forLoop(int iBegin,int iEnd) const BT_OVERRIDE
+		{
+			const btQuantizedBvh* bvh = m_builder->m_bvh;
+			for (int i=iBegin;i<iEnd;i++)
+			{
+				btBvhBuildRef& ref = m_builder->m_refs[i];
+				ref.m_aabbMin = bvh->getAabbMin(i);
+				ref.m_aabbMax = bvh->getAabbMax(i);
+				ref.m_leafIndex = i;
+			}
+		}
+	};
+
+	struct ChunkBoundsLoop : public btIParallelForBody
+	{
+		btQuantizedBvhSahBuilder*	m_builder;
+		int	m_startIndex;
+		int	m_endIndex;
+
+		void forLoop(int iBegin,int iEnd) const BT_OVERRIDE
+		{
+			for (int c=iBegin;c<iEnd;c++)
+			{
+				int start = m_startIndex+c*BT_BVH_SAH_BIN_CHUNK;
+				btBvhBoundsOfRefs(&m_builder->m_refs[0],start,btMin(m_endIndex,start+BT_BVH_SAH_BIN_CHUNK),m_builder->m_chunkBounds[c]);
+			}
+		}
+	};
+
+	struct ChunkBinsLoop : public btIParallelForBody
+	{
+		btQuantizedBvhSahBuilder*	m_builder;
+		int	m_startIndex;
+		int	m_endIndex;
+		int	m_axis;
+		btScalar	m_centerMin;
+		btScalar	m_binScale;
+
+		void forLoop(int iBegin,int iEnd) const BT_OVERRIDE
+		{
+			for (int c=iBegin;c<iEnd;c++)
+			{
+				int start = m_startIndex+c*BT_BVH_SAH_BIN_CHUNK;
+				btBvhBinRefs(&m_builder->m_refs[0],start,btMin(m_endIndex,start+BT_BVH_SAH_BIN_CHUNK),m_axis,m_centerMin,m_binScale,&m_builder->m_chunkBins[c*BT_BVH_SAH_BINS]);
+			}
+		}
+	};
+
+	struct BuildTasksLoop : public btIParallelForBody
+	{
+		btQuantizedBvhSahBuilder*	m_builder;
+
+		void forLoop(int iBegin,int iEnd) const BT_OVERRIDE
+		{
+			for (int i=iBegin;i<iEnd;i++)
+			{
+				const Task& task = m_builder->m_tasks[i];
+				m_builder->buildSubtree(task.m_startIndex,task.m_endIndex,task.m_nodeIndex,task.m_depth,false,task.m_bounds);
+			}
+		}
+	};
+
+	///bounds and bins of large ranges are computed in chunks on all threads, only from the calling thread.
+	///The min/max and counts merged from the chunks do not depend on the chunking, so neither does the tree
+	void	computeBounds(int startIndex,int endIndex,bool parallel,btBvhRangeBounds& bounds)
+	{
+		int numChunks = (endIndex-startIndex+BT_BVH_SAH_BIN_CHUNK-1)/BT_BVH_SAH_BIN_CHUNK;
+		if (!parallel || numChunks < 2)
+		{
+			btBvhBoundsOfRefs(&m_refs[0],startIndex,endIndex,bounds);
+			return;
+		}
+		m_chunkBounds.resize(numChunks);
+		ChunkBoundsLoop loop;
+		loop.m_builder = this;
+		loop.m_startIndex = startIndex;
+		loop.m_endIndex = endIndex;
+		btParallelForOrSerial(0,numChunks,1,loop);
+		bounds = m_chunkBounds[0];
+		for (int c=1;c<numChunks;c++)
+		{
+			bounds.merge(m_chunkBounds[c]);
+		}
+	}
+
+	void	computeBins(int startIndex,int endIndex,bool parallel,int axis,btScalar centerMin,btScalar binScale,btBvhSahBin* bins)
+	{
+		int numChunks = (endIndex-startIndex+BT_BVH_SAH_BIN_CHUNK-1)/BT_BVH_SAH_BIN_CHUNK;
+		if (!parallel || numChunks < 2)
+		{
+			btBvhBinRefs(&m_refs[0],startIndex,endIndex,axis,centerMin,binScale,bins);
+			return;
+		}
+		m_chunkBins.resize(numChunks*BT_BVH_SAH_BINS);
+		ChunkBinsLoop loop;
+		loop.m_builder = this;
+		loop.m_startIndex = startIndex;
+		loop.m_endIndex = endIndex;
+		loop.m_axis = axis;
+		loop.m_centerMin = centerMin;
+		loop.m_binScale = binScale;
+		btParallelForOrSerial(0,numChunks,1,loop);
+		for (int b=0;b<BT_BVH_SAH_BINS;b++)
+		{
+			bins[b] = m_chunkBins[b];
+		}
+		for (int c=1;c<numChunks;c++)
+		{
+			const btBvhSahBin* chunkBins = &m_chunkBins[c*BT_BVH_SAH_BINS];
+			for (int b=0;b<BT_BVH_SAH_BINS;b++)
+			{
+				bins[b].merge(chunkBins[b]);
+			}
+		}
+	}
+
+	///reorders the refs of the range and returns the split index, with the bounds of both sides
+	int	splitRange(int startIndex,int endIndex,int depth,bool parallel,const btBvhRangeBounds& bounds,btBvhRangeBounds& leftBounds,btBvhRangeBounds& rightBounds)
+	{
+		int numIndices = endIndex-startIndex;
+		int midIndex = startIndex+(numIndices>>1);
+		if (depth >= BT_BVH_SAH_MAX_DEPTH)
+		{
+			computeBounds(startIndex,midIndex,parallel,leftBounds);
+			computeBounds(midIndex,endIndex,parallel,rightBounds);
+			return midIndex;
+		}
+
+		//bin along the axis the centers spread most on
+		btVector3 extent = bounds.m_centerMax-bounds.m_centerMin;
+		int axis = extent.maxAxis();
+		if (extent[axis] <= SIMD_EPSILON)
+		{
+			//all centers coincide
+			computeBounds(startIndex,midIndex,parallel,leftBounds);
+			computeBounds(midIndex,endIndex,parallel,rightBounds);
+			return midIndex;
+		}
+		btScalar centerMin = bounds.m_centerMin[axis];
+		btScalar binScale = btScalar(BT_BVH_SAH_BINS)*(btScalar(1.)-SIMD_EPSILON)/extent[axis];
+		btBvhSahBin bins[BT_BVH_SAH_BINS];
+		computeBins(startIndex,endIndex,parallel,axis,centerMin,binScale,bins);
+
+		//sweep the bins from both sides, the cost of a split is the half area of each side times its number of leaves
+		int bestBin = -1;
+		btScalar bestCost = SIMD_INFINITY;
+		btScalar rightCost[BT_BVH_SAH_BINS];
+		btBvhSahBin side;
+		side.clear();
+		for (int b=BT_BVH_SAH_BINS-1;b>0;b--)
+		{
+			side.merge(bins[b]);
+			rightCost[b] = side.m_count ? btScalar(side.m_count)*btBvhHalfArea(side.m_bounds.m_aabbMin,side.m_bounds.m_aabbMax) : btScalar(-1.);
+		}
+		side.clear();
+		for (int b=0;b<BT_BVH_SAH_BINS-1;b++)
+		{
+			side.merge(bins[b]);
+			if (side.m_count && rightCost[b+1] >= btScalar(0.))
+			{
+				btScalar cost = btScalar(side.m_count)*btBvhHalfArea(side.m_bounds.m_aabbMin,side.m_bounds.m_aabbMax)+rightCost[b+1];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestBin = b;
+				}
+			}
+		}
+		btAssert(bestBin >= 0);
+		leftBounds.clear();
+		rightBounds.clear();
+		for (int b=0;b<BT_BVH_SAH_BINS;b++)
+		{
+			if (bins[b].m_count)
+			{
+				if (b <= bestBin)
+					leftBounds.merge(bins[b].m_bounds);
+				else
+					rightBounds.merge(bins[b].m_bounds);
+			}
+		}
+
+		//refs in the bins up to bestBin go left
+		int i = startIndex;
+		int j = endIndex-1;
+		while (i <= j)
+		{
+			if (btBvhSahBinIndex(m_refs[i],axis,centerMin,binScale) <= bestBin)
+			{
+				i++;
+			} else
+			{
+				m_refs.swap(i,j);
+				j--;
+			}
+		}
+		btAssert(i > startIndex && i < endIndex);
+		return i;
+	}
+
+	///with buildTasks set, subtrees with at most m_taskSize leaves are queued as tasks instead of built
+	void	buildSubtree(int startIndex,int endIndex,int nodeIndex,int depth,bool buildTasks,const btBvhRangeBounds& bounds)
+	{
+		int numIndices = endIndex-startIndex;
+		btAssert(numIndices>0);
+		if (numIndices==1)
+		{
+			m_bvh->assignInternalNodeFromLeafNode(nodeIndex,m_refs[startIndex].m_leafIndex);
+			return;
+		}
+		if (buildTasks && numIndices <= m_taskSize)
+		{
+			Task& task = m_tasks.expandNonInitializing();
+			task.m_bounds = bounds;
+			task.m_startIndex = startIndex;
+			task.m_endIndex = endIndex;
+			task.m_nodeIndex = nodeIndex;
+			task.m_depth = depth;
+			return;
+		}
+		m_bvh->setInternalNodeAabbMin(nodeIndex,bounds.m_aabbMin);
+		m_bvh->setInternalNodeAabbMax(nodeIndex,bounds.m_aabbMax);
+		m_bvh->setInternalNodeEscapeIndex(nodeIndex,2*numIndices-1);
+		btBvhRangeBounds leftBounds;
+		btBvhRangeBounds rightBounds;
+		int splitIndex = splitRange(startIndex,endIndex,depth,buildTasks,bounds,leftBounds,rightBounds);
+		int leftChildNodeIndex = nodeIndex+1;
+		int rightChildNodeIndex = leftChildNodeIndex+2*(splitIndex-startIndex)-1;
+		buildSubtree(startIndex,splitIndex,leftChildNodeIndex,depth+1,buildTasks,leftBounds);
+		buildSubtree(splitIndex,endIndex,rightChildNodeIndex,depth+1,buildTasks,rightBounds);
+	}
+
+	void	build(btQuantizedBvh* bvh,int numLeafNodes)
+	{
+		m_bvh = bvh;
+		m_refs.resizeNoInitialize(numLeafNodes);
+		{
+			InitRefsLoop loop;
+			loop.m_builder = this;
+			btParallelForOrSerial(0,numLeafNodes,BT_BVH_SAH_BIN_CHUNK,loop);
+		}
+		//the task size depends on the number of leaves only, not on the number of threads
+		m_taskSize = btMax(numLeafNodes/64,1024);
+		//the top levels are split on the calling thread, binning on all threads
+		btBvhRangeBounds bounds;
+		computeBounds(0,numLeafNodes,true,bounds);
+		buildSubtree(0,numLeafNodes,0,0,true,bounds);
+		if (m_tasks.size())
+		{
+			BuildTasksLoop loop;
+			loop.m_builder = this;
+			btParallelForOrSerial(0,m_tasks.size(),1,loop);
+		}
+	}
+};
+
+void	btQuantizedBvh::buildTreeSah(int numLeafNodes)
+{
+	if (numLeafNodes > 0)
+	{
+		btQuantizedBvhSahBuilder builder;
+		builder.build(this,numLeafNodes);
+		m_curNodeIndex = 2*numLeafNodes-1;
+		if (m_useQuantization)
+		{
+			buildSubtreeHeaders(0);
+		}
+	}
+}
+
+///adds the subtree headers in the order buildTree adds them
+void	btQuantizedBvh::buildSubtreeHeaders(int nodeIndex)
+{
+	const btQuantizedBvhNode& node = m_quantizedContiguousNodes[nodeIndex];
+	if (node.isLeafNode())
+	{
+		return;
+	}
+	int leftChildNodexIndex = nodeIndex+1;
+	const btQuantizedBvhNode& leftChildNode = m_quantizedContiguousNodes[leftChildNodexIndex];
+	int rightChildNodexIndex = leftChildNodexIndex+(leftChildNode.isLeafNode() ? 1 : leftChildNode.getEscapeIndex());
+	buildSubtreeHeaders(leftChildNodexIndex);
+	buildSubtreeHeaders(rightChildNodexIndex);
+	const int treeSizeInBytes = node.getEscapeIndex() * static_cast<int>(sizeof(btQuantizedBvhNode));
+	if (treeSizeInBytes > MAX_SUBTREE_SIZE_IN_BYTES)
+	{
+		updateSubtreeHeaders(leftChildNodexIndex,rightChildNodexIndex);
+	}
+}
+
+
 
 void	btQuantizedBvh::reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const
 {
@@ -1154,6 +1576,21 @@ btQuantizedBvh *btQuantizedBvh::deSerializeInPlace(void *i_alignedDataBuffer, un
 	return bvh;
 }
 
+void	btQuantizedBvh::initializeFromBuffer(const btVector3& bvhAabbMin,const btVector3& bvhAabbMax,const btVector3& bvhQuantization,btQuantizedBvhNode* nodes,int numNodes,btBvhSubtreeInfo* subtreeHeaders,int numSubtreeHeaders)
+{
+	m_useQuantization = true;
+	m_bvhAabbMin = bvhAabbMin;
+	m_bvhAabbMax = bvhAabbMax;
+	m_bvhQuantization = bvhQuantization;
+	m_curNodeIndex = numNodes;
+	m_leafNodes.clear();
+	m_contiguousNodes.clear();
+	m_quantizedLeafNodes.clear();
+	m_quantizedContiguousNodes.initializeFromBuffer(nodes,numNodes,numNodes);
+	m_SubtreeHeaders.initializeFromBuffer(subtreeHeaders,numSubtreeHeaders,numSubtreeHeaders);
+	m_subtreeHeaderCount = numSubtreeHeaders;
+}
+
 // Constructor that prevents btVector3's default constructor from being called
 btQuantizedBvh::btQuantizedBvh(btQuantizedBvh &self, bool /* ownsMemory */) :
 m_bvhAabbMin(self.m_bvhAabbMin),
@@ -181,6 +181,16 @@ public:
 		TRAVERSAL_RECURSIVE
 	};
 
+	///BUILD_MEAN_SPLIT splits each node at the mean of the leaf centers, along the axis of largest variance.
+	///BUILD_SAH_BINNED picks the split with the lowest surface area heuristic cost over 16 bins along the axis of largest center extent,
+	///and builds the subtrees on the threads of the task scheduler (see btSetTaskScheduler), or on the calling thread when none is set.
+	///The tree does not depend on the number of threads.
+	enum btBuildMode
+	{
+		BUILD_MEAN_SPLIT = 0,
+		BUILD_SAH_BINNED
+	};
+
 protected:
 
 
@@ -329,6 +339,14 @@ protected:
 
 	void	updateSubtreeHeaders(int leftChildNodexIndex,int rightChildNodexIndex);
 
+	void	buildTreeSah(int numLeafNodes);
+
+	void	buildSubtreeHeaders(int nodeIndex);
+
+	friend struct btQuantizedBvhSahBuilder;
+
+	static btBuildMode	s_buildMode;
+
 public:
 	
 	BT_DECLARE_ALIGNED_ALLOCATOR();
@@ -338,6 +356,17 @@ public:
 	virtual ~btQuantizedBvh();
 
 	
+	///setBuildMode selects the builder of the trees built afterwards, for all btQuantizedBvh and btOptimizedBvh (the layout of a btQuantizedBvh is serialized in place, so it has no per tree setting).
+	static void	setBuildMode(btBuildMode buildMode)
+	{
+		s_buildMode = buildMode;
+	}
+
+	static btBuildMode	getBuildMode()
+	{
+		return s_buildMode;
+	}
+
 	///***************************************** expert/internal use only *************************
 	void	setQuantizationValues(const btVector3& bvhAabbMin,const btVector3& bvhAabbMax,btScalar quantizationMargin=btScalar(1.0));
 	QuantizedNodeArray&	getLeafNodeArray() {			return	m_quantizedLeafNodes;	}
@@ -440,6 +469,21 @@ public:
 			return vecOut;
 	}
 
+	const btVector3&	getBvhAabbMin() const
+	{
+		return m_bvhAabbMin;
+	}
+
+	const btVector3&	getBvhAabbMax() const
+	{
+		return m_bvhAabbMax;
+	}
+
+	const btVector3&	getBvhQuantization() const
+	{
+		return m_bvhQuantization;
+	}
+
 	///setTraversalMode let's you choose between stackless, recursive or stackless cache friendly tree traversal. Note this is only implemented for quantized trees.
 	void	setTraversalMode(btTraversalMode	traversalMode)
 	{
@@ -470,6 +514,10 @@ public:
 	static btQuantizedBvh *deSerializeInPlace(void *i_alignedDataBuffer, unsigned int i_dataBufferSize, bool i_swapEndian);
 
 	static unsigned int getAlignmentSerializationPadding();
+
+	///initializeFromBuffer makes a quantized BVH use nodes and subtree headers stored elsewhere, for instance in a memory mapped file, without copying them.
+	///The buffers must stay valid and unchanged while the BVH uses them.
+	void	initializeFromBuffer(const btVector3& bvhAabbMin,const btVector3& bvhAabbMax,const btVector3& bvhQuantization,btQuantizedBvhNode* nodes,int numNodes,btBvhSubtreeInfo* subtreeHeaders,int numSubtreeHeaders);
 //////////////////////////////////////////////////////////////////////
 
 	
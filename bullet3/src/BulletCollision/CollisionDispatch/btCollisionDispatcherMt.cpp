@@ -29,7 +29,10 @@ subject to the following restrictions:
 
 
 btCollisionDispatcherMt::btCollisionDispatcherMt( btCollisionConfiguration* config, int grainSize )
-    : btCollisionDispatcher( config )
+    : btCollisionDispatcher( config ),
+    m_manifoldPool( sizeof( btPersistentManifold ) ),
+    // the algorithm pool of the configuration is sized for the largest algorithm it creates
+    m_collisionAlgorithmPool( config->getCollisionAlgorithmPool()->getElementSize() )
 {
     m_batchUpdating = false;
     m_grainSize = grainSize;  // iterations per task
@@ -46,21 +49,7 @@ btPersistentManifold* btCollisionDispatcherMt::getNewManifold( const btCollision
 
     btScalar contactProcessingThreshold = btMin( body0->getContactProcessingThreshold(), body1->getContactProcessingThreshold() );
 
-    void* mem = m_persistentManifoldPoolAllocator->allocate( sizeof( btPersistentManifold ) );
-    if ( NULL == mem )
-    {
-        //we got a pool memory overflow, by default we fallback to dynamically allocate memory. If we require a contiguous contact pool then assert.
-        if ( ( m_dispatcherFlags&CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION ) == 0 )
-        {
-            mem = btAlignedAlloc( sizeof( btPersistentManifold ), 16 );
-        }
-        else
-        {
-            btAssert( 0 );
-            //make sure to increase the m_defaultMaxPersistentManifoldPoolSize in the btDefaultCollisionConstructionInfo/btDefaultCollisionConfiguration
-            return 0;
-        }
-    }
+    void* mem = m_manifoldPool.allocate( sizeof( btPersistentManifold ) );
     btPersistentManifold* manifold = new( mem ) btPersistentManifold( body0, body1, 0, contactBreakingThreshold, contactProcessingThreshold );
     if ( !m_batchUpdating )
     {
@@ -90,14 +79,17 @@ void btCollisionDispatcherMt::releaseManifold( btPersistentManifold* manifold )
     }
 
     manifold->~btPersistentManifold();
-    if ( m_persistentManifoldPoolAllocator->validPtr( manifold ) )
-    {
-        m_persistentManifoldPoolAllocator->freeMemory( manifold );
-    }
-    else
-    {
-        btAlignedFree( manifold );
-    }
+    m_manifoldPool.freeMemory( manifold );
+}
+
+void* btCollisionDispatcherMt::allocateCollisionAlgorithm( int size )
+{
+    return m_collisionAlgorithmPool.allocate( size );
+}
+
+void btCollisionDispatcherMt::freeCollisionAlgorithm( void* ptr )
+{
+    m_collisionAlgorithmPool.freeMemory( ptr );
 }
 
 struct CollisionDispatcherUpdater : public btIParallelForBody
@@ -132,6 +124,9 @@ void btCollisionDispatcherMt::dispatchAllCollisionPairs( btOverlappingPairCache*
     {
         return;
     }
+    // the scratch memory of the previous dispatch is released, the arenas that overflowed are consolidated
+    m_frameArenas.reset();
+
     CollisionDispatcherUpdater updater;
     updater.mCallback = getNearCallback();
     updater.mPairArray = pairCache->getOverlappingPairArrayPtr();
@@ -18,8 +18,16 @@ subject to the following restrictions:
 
 #include "BulletCollision/CollisionDispatch/btCollisionDispatcher.h"
 #include "LinearMath/btThreads.h"
+#include "LinearMath/btPerThreadPoolAllocator.h"
+#include "LinearMath/btFrameArena.h"
 
 
+///btCollisionDispatcherMt dispatches the collision pairs in parallel.
+///Manifolds and collision algorithms come from pools with a free list per thread that grow on demand,
+///instead of the shared pools of the collision configuration, so the threads don't contend for them.
+///Because the pools grow, CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION has no effect, and getInternalManifoldPool
+///returns the unused pool of the configuration.
+///The collision algorithms get their scratch memory from frame arenas of this dispatcher, reset in each dispatchAllCollisionPairs
 class btCollisionDispatcherMt : public btCollisionDispatcher
 {
 public:
@@ -28,11 +36,42 @@ public:
     virtual btPersistentManifold* getNewManifold( const btCollisionObject* body0, const btCollisionObject* body1 ) BT_OVERRIDE;
     virtual void releaseManifold( btPersistentManifold* manifold ) BT_OVERRIDE;
 
+    virtual void* allocateCollisionAlgorithm( int size ) BT_OVERRIDE;
+    virtual void freeCollisionAlgorithm( void* ptr ) BT_OVERRIDE;
+
     virtual void dispatchAllCollisionPairs( btOverlappingPairCache* pairCache, const btDispatcherInfo& info, btDispatcher* dispatcher ) BT_OVERRIDE;
 
+    virtual btFrameArena* getThreadFrameArena() BT_OVERRIDE
+    {
+        return m_frameArenas.getArena();
+    }
+
+    ///how much the manifold and algorithm pools grew and moved elements between threads
+    void getManifoldPoolStatistics( btPoolAllocatorStatistics& statistics ) const
+    {
+        m_manifoldPool.getStatistics( statistics );
+    }
+    void getCollisionAlgorithmPoolStatistics( btPoolAllocatorStatistics& statistics ) const
+    {
+        m_collisionAlgorithmPool.getStatistics( statistics );
+    }
+    void getFrameArenaStatistics( btFrameArenaStatistics& statistics ) const
+    {
+        m_frameArenas.getStatistics( statistics );
+    }
+    void resetPoolStatistics()
+    {
+        m_manifoldPool.resetStatistics();
+        m_collisionAlgorithmPool.resetStatistics();
+        m_frameArenas.resetStatistics();
+    }
+
 protected:
     bool m_batchUpdating;
     int m_grainSize;
+    btPerThreadPoolAllocator m_manifoldPool;
+    btPerThreadPoolAllocator m_collisionAlgorithmPool;
+    btThreadFrameArenas m_frameArenas;
 };
 
 #endif //BT_COLLISION_DISPATCHER_MT_H
@@ -22,6 +22,7 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionShapes/btSphereShape.h" //for raycasting
 #include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h" //for raycasting
 #include "BulletCollision/CollisionShapes/btScaledBvhTriangleMeshShape.h" //for raycasting
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h" //for raycasting
 #include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 #include "BulletCollision/CollisionShapes/btCompoundShape.h"
 #include "BulletCollision/NarrowPhaseCollision/btSubSimplexConvexCast.h"
@@ -32,6 +33,7 @@ subject to the following restrictions:
 #include "BulletCollision/BroadphaseCollision/btDbvt.h"
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
 #include "LinearMath/btSerializer.h"
 #include "BulletCollision/CollisionShapes/btConvexPolyhedron.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
@@ -149,6 +151,12 @@ void	btCollisionWorld::addCollisionObject(btCollisionObject* collisionObject, in
 void	btCollisionWorld::updateSingleAabb(btCollisionObject* colObj)
 {
 	btVector3 minAabb,maxAabb;
+	computeSingleAabb(colObj,minAabb,maxAabb);
+	applySingleAabb(colObj,minAabb,maxAabb);
+}
+
+void	btCollisionWorld::computeSingleAabb(const btCollisionObject* colObj, btVector3& minAabb, btVector3& maxAabb) const
+{
 	colObj->getCollisionShape()->getAabb(colObj->getWorldTransform(), minAabb,maxAabb);
 	//need to increase the aabb for contact thresholds
 	btVector3 contactThreshold(gContactBreakingThreshold,gContactBreakingThreshold,gContactBreakingThreshold);
@@ -164,7 +172,10 @@ void	btCollisionWorld::updateSingleAabb(btCollisionObject* colObj)
 		minAabb.setMin(minAabb2);
 		maxAabb.setMax(maxAabb2);
 	}
+}
 
+void	btCollisionWorld::applySingleAabb(btCollisionObject* colObj, const btVector3& minAabb, const btVector3& maxAabb)
+{
 	btBroadphaseInterface* bp = (btBroadphaseInterface*)m_broadphasePairCache;
 
 	//moving objects should be moderately sized, probably something wrong if not
@@ -480,12 +491,20 @@ void	btCollisionWorld::rayTestSingleInternal(const btTransform& rayFromTrans,con
 				BridgeTriangleRaycastCallback	rcb(rayFromLocal,rayToLocal,&resultCallback,collisionObjectWrap->getCollisionObject(),concaveShape, colObjWorldTransform);
 				rcb.m_hitFraction = resultCallback.m_closestHitFraction;
 
-				btVector3 rayAabbMinLocal = rayFromLocal;
-				rayAabbMinLocal.setMin(rayToLocal);
-				btVector3 rayAabbMaxLocal = rayFromLocal;
-				rayAabbMaxLocal.setMax(rayToLocal);
+				if (collisionShape->getShapeType()==TERRAIN_SHAPE_PROXYTYPE)
+				{
+					///walks the cells under the ray instead of all cells in its aabb
+					btHeightfieldTerrainShape* heightfield = (btHeightfieldTerrainShape*)collisionShape;
+					heightfield->performRaycast(&rcb,rayFromLocal,rayToLocal,&rcb.m_hitFraction);
+				} else
+				{
+					btVector3 rayAabbMinLocal = rayFromLocal;
+					rayAabbMinLocal.setMin(rayToLocal);
+					btVector3 rayAabbMaxLocal = rayFromLocal;
+					rayAabbMaxLocal.setMax(rayToLocal);
 
-				concaveShape->processAllTriangles(&rcb,rayAabbMinLocal,rayAabbMaxLocal);
+					concaveShape->processAllTriangles(&rcb,rayAabbMinLocal,rayAabbMaxLocal);
+				}
 			}
 		} else {
 			//			BT_PROFILE("rayTestCompound");
@@ -1041,6 +1060,81 @@ void	btCollisionWorld::rayTest(const btVector3& rayFromWorld, const btVector3& r
 }
 
 
+struct btRayBatchNarrowphase : public btIParallelForBody
+{
+	const btVector3*	m_rayFromWorld;
+	const btVector3*	m_rayToWorld;
+	const int*			m_candidateOffsets;
+	btBroadphaseProxy* const*	m_candidates;
+	btCollisionWorld::RayBatchResults*	m_results;
+
+	void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			btCollisionWorld::ClosestRayResultCallback resultCallback(m_rayFromWorld[i],m_rayToWorld[i]);
+			resultCallback.m_collisionFilterGroup = m_results->m_collisionFilterGroup;
+			resultCallback.m_collisionFilterMask = m_results->m_collisionFilterMask;
+			resultCallback.m_flags = m_results->m_flags;
+
+			btTransform rayFromTrans,rayToTrans;
+			rayFromTrans.setIdentity();
+			rayFromTrans.setOrigin(m_rayFromWorld[i]);
+			rayToTrans.setIdentity();
+			rayToTrans.setOrigin(m_rayToWorld[i]);
+
+			for (int j=m_candidateOffsets[i];j<m_candidateOffsets[i+1];j++)
+			{
+				///same as btSingleRayCallback::process
+				if (resultCallback.m_closestHitFraction == btScalar(0.f))
+					break;
+				btBroadphaseProxy* proxy = m_candidates[j];
+				if (resultCallback.needsCollision(proxy))
+				{
+					btCollisionObject* collisionObject = (btCollisionObject*)proxy->m_clientObject;
+					btCollisionWorld::rayTestSingle(rayFromTrans,rayToTrans,
+						collisionObject,
+						collisionObject->getCollisionShape(),
+						collisionObject->getWorldTransform(),
+						resultCallback);
+				}
+			}
+
+			m_results->m_collisionObjects[i] = resultCallback.m_collisionObject;
+			m_results->m_hitFractions[i] = resultCallback.m_closestHitFraction;
+			if (m_results->m_hitPointWorld)
+				m_results->m_hitPointWorld[i] = resultCallback.hasHit() ? resultCallback.m_hitPointWorld : m_rayToWorld[i];
+			if (m_results->m_hitNormalWorld)
+				m_results->m_hitNormalWorld[i] = resultCallback.hasHit() ? resultCallback.m_hitNormalWorld : btVector3(0,0,0);
+		}
+	}
+};
+
+void	btCollisionWorld::rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, RayBatchResults& results) const
+{
+	BT_PROFILE("rayTestBatch");
+	if (numRays <= 0)
+		return;
+	btAssert(results.m_collisionObjects && results.m_hitFractions);
+
+	btAlignedObjectArray<int> candidateOffsets;
+	btAlignedObjectArray<btBroadphaseProxy*> candidates;
+	{
+		BT_PROFILE("broadphase");
+		m_broadphasePairCache->rayTestBatch(rayFromWorld,rayToWorld,numRays,candidateOffsets,candidates);
+	}
+
+	btRayBatchNarrowphase narrowphase;
+	narrowphase.m_rayFromWorld = rayFromWorld;
+	narrowphase.m_rayToWorld = rayToWorld;
+	narrowphase.m_candidateOffsets = &candidateOffsets[0];
+	narrowphase.m_candidates = candidates.size() ? &candidates[0] : 0;
+	narrowphase.m_results = &results;
+	int grainSize = 16;  // number of rays per task
+	btParallelForOrSerial(0, numRays, grainSize, narrowphase);
+}
+
+
 struct btSingleSweepCallback : public btBroadphaseRayCallback
 {
 
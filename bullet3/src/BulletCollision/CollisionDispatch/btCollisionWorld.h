@@ -150,6 +150,11 @@ public:
 
 	void	updateSingleAabb(btCollisionObject* colObj);
 
+	///computeSingleAabb only reads the object, so it can be called for many objects in parallel; applySingleAabb then updates the broadphase
+	void	computeSingleAabb(const btCollisionObject* colObj, btVector3& minAabb, btVector3& maxAabb) const;
+
+	void	applySingleAabb(btCollisionObject* colObj, const btVector3& minAabb, const btVector3& maxAabb);
+
 	virtual void	updateAabbs();
 
 	///the computeOverlappingPairs is usually already called by performDiscreteCollisionDetection (or stepSimulation)
@@ -315,6 +320,30 @@ public:
 		}
 	};
 
+	///RayBatchResults receives the closest hit of each ray of rayTestBatch, one array per field.
+	///Every array holds one entry per ray. m_hitPointWorld and m_hitNormalWorld can be 0 when they are not needed
+	struct	RayBatchResults
+	{
+		const btCollisionObject**	m_collisionObjects;//0 where the ray hit nothing
+		btScalar*	m_hitFractions;//1 where the ray hit nothing
+		btVector3*	m_hitPointWorld;
+		btVector3*	m_hitNormalWorld;
+		int	m_collisionFilterGroup;
+		int	m_collisionFilterMask;
+		unsigned int m_flags;
+
+		RayBatchResults()
+			:m_collisionObjects(0),
+			m_hitFractions(0),
+			m_hitPointWorld(0),
+			m_hitNormalWorld(0),
+			m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter),
+			m_flags(0)
+		{
+		}
+	};
+
 
 	struct LocalConvexResult
 	{
@@ -449,6 +478,11 @@ public:
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value returned by the callback.
 	virtual void rayTest(const btVector3& rayFromWorld, const btVector3& rayToWorld, RayResultCallback& resultCallback) const; 
 
+	/// rayTestBatch finds the closest hit of each of numRays rays, as rayTest with a ClosestRayResultCallback would, and writes them to results.
+	/// The broadphase gathers the candidate objects of all rays at once (btDbvtBroadphase traverses with ray packets), then the rays are
+	/// tested against their candidates in parallel using btParallelFor. There is no callback per ray or per hit.
+	void	rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, RayBatchResults& results) const;
+
 	/// convexTest performs a swept convex cast on all objects in the btCollisionWorld, and calls the resultCallback
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value return by the callback.
 	void    convexSweepTest (const btConvexShape* castShape, const btTransform& from, const btTransform& to, ConvexResultCallback& resultCallback,  btScalar allowedCcdPenetration = btScalar(0.)) const;
@@ -16,6 +16,7 @@ subject to the following restrictions:
 
 #include "btCompoundCompoundCollisionAlgorithm.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btFrameArena.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletCollision/CollisionShapes/btCompoundShape.h"
 #include "BulletCollision/BroadphaseCollision/btDbvt.h"
@@ -252,11 +253,15 @@ static inline void		MycollideTT(	const btDbvtNode* root0,
 		{
 			int								depth=1;
 			int								treshold=btDbvt::DOUBLE_STACKSIZE-4;
+#ifndef USE_LOCAL_STACK
+			btFrameArenaScope scratch(callback->m_dispatcher->getThreadFrameArena());
+#endif
 			btAlignedObjectArray<btDbvt::sStkNN>	stkStack;
 #ifdef USE_LOCAL_STACK
 			ATTRIBUTE_ALIGNED16(btDbvt::sStkNN localStack[btDbvt::DOUBLE_STACKSIZE]);
 			stkStack.initializeFromBuffer(&localStack,btDbvt::DOUBLE_STACKSIZE,btDbvt::DOUBLE_STACKSIZE);
 #else
+			scratch.initializeArray(stkStack, btDbvt::DOUBLE_STACKSIZE);
 			stkStack.resize(btDbvt::DOUBLE_STACKSIZE);
 #endif
 			stkStack[0]=btDbvt::sStkNN(root0,root1);
@@ -53,6 +53,7 @@ subject to the following restrictions:
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
 #include "BulletCollision/NarrowPhaseCollision/btPolyhedralContactClipping.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
+#include "LinearMath/btFrameArena.h"
 
 ///////////
 
@@ -564,7 +565,10 @@ void btConvexConvexAlgorithm ::processCollision (const btCollisionObjectWrapper*
 			if (polyhedronA->getConvexPolyhedron() && polyhedronB->getShapeType()==TRIANGLE_SHAPE_PROXYTYPE)
 			{
 
+				//the clipping alternates between these vertices and worldVertsB2, so they need room for a clipped face
+				btFrameArenaScope scratch(m_dispatcher->getThreadFrameArena());
 				btVertexArray vertices;
+				scratch.initializeArray(vertices, 64);
 				btTriangleShape* tri = (btTriangleShape*)polyhedronB;
 				vertices.push_back(	body1Wrap->getWorldTransform()*tri->m_vertices1[0]);
 				vertices.push_back(	body1Wrap->getWorldTransform()*tri->m_vertices1[1]);
@@ -26,7 +26,10 @@ subject to the following restrictions:
 #include "LinearMath/btQuickprof.h"
 
 btSimulationIslandManager::btSimulationIslandManager():
-m_splitIslands(true)
+m_splitIslands(true),
+m_incrementalIslands(false),
+m_numSleepingIslandIds(0),
+m_numIslandIds(0)
 {
 }
 
@@ -39,6 +42,197 @@ void btSimulationIslandManager::initUnionFind(int n)
 {
 		m_unionFind.reset(n);
 }
+
+void btSimulationIslandManager::setIncrementalIslands(bool incrementalIslands)
+{
+	m_incrementalIslands = incrementalIslands;
+
+	//all bodies start out awake, the islands that are sleeping are found again in the next step
+	m_sleepingIslandSizes.resize(0);
+	m_freeSleepingIslandIds.resize(0);
+	m_releasedSleepingIslandIds.resize(0);
+	m_awakeObjects.resize(0);
+	m_awakeElements.resize(0);
+	m_numSleepingIslandIds = 0;
+	m_numIslandIds = 0;
+}
+
+void btSimulationIslandManager::updateIncrementalActivationState(btCollisionWorld* colWorld)
+{
+	btCollisionObjectArray& collisionObjects = colWorld->getCollisionObjectArray();
+
+	//ids released in the previous step can be reused, no island tag refers to them anymore
+	int i;
+	for (i=0;i<m_releasedSleepingIslandIds.size();i++)
+	{
+		m_freeSleepingIslandIds.push_back(m_releasedSleepingIslandIds[i]);
+	}
+	m_releasedSleepingIslandIds.resize(0);
+
+	//ids handed out beyond the union find elements of the previous step extend the range of sleeping island ids
+	for (i=m_numSleepingIslandIds;i<m_sleepingIslandSizes.size();i++)
+	{
+		if (m_sleepingIslandSizes[i]<0)
+			m_freeSleepingIslandIds.push_back(i);
+	}
+	m_numSleepingIslandIds = m_sleepingIslandSizes.size();
+
+	for (i=0;i<m_numSleepingIslandIds;i++)
+	{
+		if (m_sleepingIslandSizes[i]>0)
+			m_sleepingIslandSizes[i] = 0;
+	}
+
+	//the bodies of sleeping islands keep the sleeping island id as island tag, all other bodies get an element after those ids
+	m_awakeObjects.resize(0);
+	m_awakeElements.resize(0);
+	for (i=0;i<collisionObjects.size();i++)
+	{
+		btCollisionObject* collisionObject = collisionObjects[i];
+		if (collisionObject->isStaticOrKinematicObject())
+		{
+			collisionObject->setIslandTag(-1);
+			collisionObject->setCompanionId(-2);
+			collisionObject->setHitFraction(btScalar(1.));
+			continue;
+		}
+		int tag = collisionObject->getIslandTag();
+		bool inSleepingIsland = (tag>=0) && (tag<m_numSleepingIslandIds) && (m_sleepingIslandSizes[tag]>=0);
+		if (inSleepingIsland && collisionObject->getActivationState()==ISLAND_SLEEPING)
+		{
+			m_sleepingIslandSizes[tag]++;
+			continue;
+		}
+		//a body that was activated while its island sleeps wakes up the island, remember the island to unite with
+		m_awakeObjects.push_back(i);
+		m_awakeElements.push_back(inSleepingIsland ? tag : -1);
+		collisionObject->setIslandTag(m_numSleepingIslandIds+m_awakeObjects.size()-1);
+		collisionObject->setCompanionId(-1);
+		collisionObject->setHitFraction(btScalar(1.));
+	}
+
+	//islands of which all bodies were removed from the world
+	for (i=0;i<m_numSleepingIslandIds;i++)
+	{
+		if (m_sleepingIslandSizes[i]==0)
+		{
+			m_sleepingIslandSizes[i] = -1;
+			m_freeSleepingIslandIds.push_back(i);
+		}
+	}
+
+	m_numIslandIds = m_numSleepingIslandIds+m_awakeObjects.size();
+	initUnionFind(m_numIslandIds);
+
+	for (i=0;i<m_awakeObjects.size();i++)
+	{
+		int element = m_numSleepingIslandIds+i;
+		int sleepingIslandId = m_awakeElements[i];
+		if ((sleepingIslandId>=0) && (m_sleepingIslandSizes[sleepingIslandId]>=0))
+		{
+			m_unionFind.unite(element,sleepingIslandId);
+		}
+		m_awakeElements[i] = element;
+	}
+}
+
+void btSimulationIslandManager::storeIncrementalActivationState(btCollisionWorld* colWorld)
+{
+	btCollisionObjectArray& collisionObjects = colWorld->getCollisionObjectArray();
+
+	//a sleeping island that got united with anything wakes up, or merges with another sleeping island.
+	//Its bodies become part of the island elements again, and are only put back to sleep together if the whole island sleeps
+	bool releasedIslands = false;
+	int i;
+	for (i=0;i<m_numSleepingIslandIds;i++)
+	{
+		if ((m_sleepingIslandSizes[i]>=0) && ((m_unionFind.find(i)!=i) || (m_unionFind.getElement(i).m_sz>1)))
+		{
+			m_sleepingIslandSizes[i] = -1;
+			m_releasedSleepingIslandIds.push_back(i);
+			releasedIslands = true;
+		}
+	}
+
+	if (releasedIslands)
+	{
+		for (i=0;i<collisionObjects.size();i++)
+		{
+			btCollisionObject* collisionObject = collisionObjects[i];
+			int tag = collisionObject->getIslandTag();
+			if ((tag>=0) && (tag<m_numSleepingIslandIds) && (m_sleepingIslandSizes[tag]<0))
+			{
+				m_awakeObjects.push_back(i);
+				m_awakeElements.push_back(tag);
+				collisionObject->setCompanionId(-1);
+				collisionObject->setHitFraction(btScalar(1.));
+			}
+		}
+	}
+
+	for (i=0;i<m_awakeObjects.size();i++)
+	{
+		btCollisionObject* collisionObject = collisionObjects[m_awakeObjects[i]];
+		collisionObject->setIslandTag(m_unionFind.find(m_awakeElements[i]));
+	}
+}
+
+void btSimulationIslandManager::sortIslandElements(btCollisionWorld* colWorld)
+{
+	if (!m_incrementalIslands)
+	{
+		m_unionFind.sortIslands();
+		return;
+	}
+
+	btCollisionObjectArray& collisionObjects = colWorld->getCollisionObjectArray();
+	int numElem = m_awakeObjects.size();
+	m_unionFind.allocate(numElem);
+	for (int i=0;i<numElem;i++)
+	{
+		btElement& element = m_unionFind.getElement(i);
+		element.m_id = collisionObjects[m_awakeObjects[i]]->getIslandTag();
+		element.m_sz = m_awakeObjects[i];
+	}
+	m_unionFind.sortElements();
+}
+
+void btSimulationIslandManager::storeSleepingIsland(btCollisionWorld* colWorld,int startElement,int endElement)
+{
+	if (!m_incrementalIslands)
+		return;
+
+	btCollisionObjectArray& collisionObjects = colWorld->getCollisionObjectArray();
+	int islandId = -1;
+	int numBodies = 0;
+	for (int idx=startElement;idx<endElement;idx++)
+	{
+		btCollisionObject* colObj0 = collisionObjects[m_unionFind.getElement(idx).m_sz];
+		//bodies with simulation disabled don't go to sleep, and stay outside of sleeping islands
+		if (colObj0->getActivationState()!=ISLAND_SLEEPING)
+			continue;
+
+		if (islandId<0)
+		{
+			if (m_freeSleepingIslandIds.size())
+			{
+				islandId = m_freeSleepingIslandIds[m_freeSleepingIslandIds.size()-1];
+				m_freeSleepingIslandIds.pop_back();
+			} else
+			{
+				//the ids up to m_numIslandIds are in use by island elements in this step
+				islandId = m_numIslandIds++;
+				m_sleepingIslandSizes.resize(m_numIslandIds,-1);
+			}
+		}
+		colObj0->setIslandTag(islandId);
+		numBodies++;
+	}
+	if (islandId>=0)
+	{
+		m_sleepingIslandSizes[islandId] = numBodies;
+	}
+}
 		
 
 void btSimulationIslandManager::findUnions(btDispatcher* /* dispatcher */,btCollisionWorld* colWorld)
@@ -72,6 +266,12 @@ void btSimulationIslandManager::findUnions(btDispatcher* /* dispatcher */,btColl
 #ifdef STATIC_SIMULATION_ISLAND_OPTIMIZATION
 void   btSimulationIslandManager::updateActivationState(btCollisionWorld* colWorld,btDispatcher* dispatcher)
 {
+	if (m_incrementalIslands)
+	{
+		updateIncrementalActivationState(colWorld);
+		findUnions(dispatcher,colWorld);
+		return;
+	}
 
 	// put the index into m_controllers into m_tag   
 	int index = 0;
@@ -99,6 +299,12 @@ void   btSimulationIslandManager::updateActivationState(btCollisionWorld* colWor
 
 void   btSimulationIslandManager::storeIslandActivationState(btCollisionWorld* colWorld)
 {
+	if (m_incrementalIslands)
+	{
+		storeIncrementalActivationState(colWorld);
+		return;
+	}
+
 	// put the islandId ('find' value) into m_tag   
 	{
 		int index = 0;
@@ -126,6 +332,12 @@ void   btSimulationIslandManager::storeIslandActivationState(btCollisionWorld* c
 #else //STATIC_SIMULATION_ISLAND_OPTIMIZATION
 void	btSimulationIslandManager::updateActivationState(btCollisionWorld* colWorld,btDispatcher* dispatcher)
 {
+	if (m_incrementalIslands)
+	{
+		updateIncrementalActivationState(colWorld);
+		findUnions(dispatcher,colWorld);
+		return;
+	}
 
 	initUnionFind( int (colWorld->getCollisionObjectArray().size()));
 
@@ -151,6 +363,12 @@ void	btSimulationIslandManager::updateActivationState(btCollisionWorld* colWorld
 
 void	btSimulationIslandManager::storeIslandActivationState(btCollisionWorld* colWorld)
 {
+	if (m_incrementalIslands)
+	{
+		storeIncrementalActivationState(colWorld);
+		return;
+	}
+
 	// put the islandId ('find' value) into m_tag	
 	{
 
@@ -228,7 +446,7 @@ void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher,btCollisio
 	//we are going to sort the unionfind array, and store the element id in the size
 	//afterwards, we clean unionfind, to make sure no-one uses it anymore
 	
-	getUnionFind().sortIslands();
+	sortIslandElements(collisionWorld);
 	int numElem = getUnionFind().getNumElements();
 
 	int endIslandIndex=1;
@@ -290,6 +508,7 @@ void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher,btCollisio
 					colObj0->setActivationState( ISLAND_SLEEPING );
 				}
 			}
+			storeSleepingIsland(collisionWorld,startIslandIndex,endIslandIndex);
 		} else
 		{
 
@@ -359,8 +578,8 @@ void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher,btCollisio
 			}
 			if(m_splitIslands)
 			{ 
-				//filtering for response
-				if (dispatcher->needsResponse(colObj0,colObj1))
+				//filtering for response, sleeping islands kept in incremental mode have no island elements
+				if (dispatcher->needsResponse(colObj0,colObj1) && !isSleepingIsland(getIslandId(manifold)))
 					m_islandmanifold.push_back(manifold);
 			}
 		}
@@ -28,6 +28,8 @@ class btPersistentManifold;
 
 
 ///SimulationIslandManager creates and handles simulation islands, using btUnionFind
+///In incremental mode (see setIncrementalIslands) the islands that are fully sleeping are kept across steps,
+///each as a single union find element, so their bodies are not united, sorted or visited until something touches them.
 class btSimulationIslandManager
 {
 	btUnionFind m_unionFind;
@@ -36,7 +38,31 @@ class btSimulationIslandManager
 	btAlignedObjectArray<btCollisionObject* >  m_islandBodies;
 	
 	bool m_splitIslands;
-	
+
+	bool m_incrementalIslands;
+
+	//incremental mode: union find element i < m_numSleepingIslandIds stands for the sleeping island with id i,
+	//the bodies that are not part of a sleeping island follow, with the world array index in m_awakeObjects
+	btAlignedObjectArray<int>	m_sleepingIslandSizes;	//number of bodies of each sleeping island id, -1 for unused ids
+	btAlignedObjectArray<int>	m_freeSleepingIslandIds;
+	btAlignedObjectArray<int>	m_releasedSleepingIslandIds;	//woken up this step, reused from the next step on
+	btAlignedObjectArray<int>	m_awakeObjects;
+	btAlignedObjectArray<int>	m_awakeElements;
+	int							m_numSleepingIslandIds;
+	int							m_numIslandIds;
+
+	void	updateIncrementalActivationState(btCollisionWorld* colWorld);
+	void	storeIncrementalActivationState(btCollisionWorld* colWorld);
+
+protected:
+
+	///sorts the union find elements on island id, with the world array index of the body in m_sz.
+	///In incremental mode these are only the bodies that are not part of a sleeping island
+	void	sortIslandElements(btCollisionWorld* colWorld);
+
+	///called after the bodies of the elements [startElement,endElement) are put to sleep, keeps them as one sleeping island in incremental mode
+	void	storeSleepingIsland(btCollisionWorld* colWorld,int startElement,int endElement);
+
 public:
 	btSimulationIslandManager();
 	virtual ~btSimulationIslandManager();
@@ -75,6 +101,26 @@ public:
 		m_splitIslands = doSplitIslands;
 	}
 
+	bool getIncrementalIslands() const
+	{
+		return m_incrementalIslands;
+	}
+	///keeps fully sleeping islands across steps, instead of rebuilding all islands from scratch every step.
+	///Sleeping islands merge with the islands of bodies that start to overlap them or get constrained to them, and are only split up again after they wake up
+	void setIncrementalIslands(bool incrementalIslands);
+
+	///the island ids stored in the island tags of the bodies are smaller than this, to size lookup tables on island id
+	int	getNumIslandIds() const
+	{
+		return m_incrementalIslands ? m_numIslandIds : m_unionFind.getNumElements();
+	}
+
+	///true when the island with this id is kept as a sleeping island in incremental mode
+	bool	isSleepingIsland(int islandId) const
+	{
+		return m_incrementalIslands && islandId>=0 && islandId<m_sleepingIslandSizes.size() && m_sleepingIslandSizes[islandId]>=0;
+	}
+
 };
 
 #endif //BT_SIMULATION_ISLAND_MANAGER_H
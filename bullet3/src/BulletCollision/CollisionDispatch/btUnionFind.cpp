@@ -77,6 +77,11 @@ void	btUnionFind::sortIslands()
 	
 	 // Sort the vector using predicate and std::sort
 	  //std::sort(m_elements.begin(), m_elements.end(), btUnionFindElementSortPredicate);
-	  m_elements.quickSort(btUnionFindElementSortPredicate());
+	  sortElements();
 
 }
+
+void	btUnionFind::sortElements()
+{
+	m_elements.quickSort(btUnionFindElementSortPredicate());
+}
@@ -47,6 +47,9 @@ class btUnionFind
 		//it sorts the elements, based on island id, in order to make it easy to iterate over islands
 		void	sortIslands();
 
+		//sorts the elements on m_id, for elements that already store their island id in m_id and something else in m_sz
+		void	sortElements();
+
 	  void	reset(int N);
 
 	  SIMD_FORCE_INLINE int	getNumElements() const
@@ -81,6 +81,13 @@ void	btBvhTriangleMeshShape::refitTree(const btVector3& aabbMin,const btVector3&
 	recalcLocalAabb();
 }
 
+void	btBvhTriangleMeshShape::refitTreeParallel(const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	m_bvh->refitParallel( m_meshInterface, aabbMin,aabbMax );
+	
+	recalcLocalAabb();
+}
+
 btBvhTriangleMeshShape::~btBvhTriangleMeshShape()
 {
 	if (m_ownsBvh)
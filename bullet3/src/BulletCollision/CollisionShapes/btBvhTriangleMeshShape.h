@@ -71,6 +71,9 @@ public:
 
 	void	refitTree(const btVector3& aabbMin,const btVector3& aabbMax);
 
+	///refitTree on the threads of the task scheduler, see btOptimizedBvh::refitParallel
+	void	refitTreeParallel(const btVector3& aabbMin,const btVector3& aabbMax);
+
 	///for a fast incremental refit of parts of the tree. Note: the entire AABB of the tree will become more conservative, it never shrinks
 	void	partialRefitTree(const btVector3& aabbMin,const btVector3& aabbMax);
 
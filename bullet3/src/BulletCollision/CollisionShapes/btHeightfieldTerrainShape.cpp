@@ -354,42 +354,320 @@ void	btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback
 	
   
 
+	if (hasAccelerator())
+	{
+		//skip the blocks of cells that are entirely above or below the aabb
+		int cellMin[2] = {startX,startJ};
+		int cellMax[2] = {endX-1,endJ-1};
+		if (cellMin[0]>cellMax[0] || cellMin[1]>cellMax[1])
+			return;
+		Range heightRange;
+		heightRange.m_min = btMin(localAabbMin[m_upAxis],localAabbMax[m_upAxis]);
+		heightRange.m_max = btMax(localAabbMin[m_upAxis],localAabbMax[m_upAxis]);
+		processBlock(callback,m_acceleratorLevelOffsets.size()-1,0,0,cellMin,cellMax,heightRange);
+		return;
+	}
+
 	for(int j=startJ; j<endJ; j++)
 	{
 		for(int x=startX; x<endX; x++)
 		{
-			btVector3 vertices[3];
-			if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1))|| (m_useZigzagSubdivision  && !(j & 1)))
-			{
-        //first triangle
-        getVertex(x,j,vertices[0]);
+			processCell(callback,x,j);
+		}
+	}
+
+	
+
+}
+
+void	btHeightfieldTerrainShape::processCell(btTriangleCallback* callback,int x,int j) const
+{
+	btVector3 vertices[3];
+	if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1))|| (m_useZigzagSubdivision  && !(j & 1)))
+	{
+		//first triangle
+		getVertex(x,j,vertices[0]);
 		getVertex(x, j + 1, vertices[1]);
 		getVertex(x + 1, j + 1, vertices[2]);
-        callback->processTriangle(vertices,x,j);
-        //second triangle
-      //  getVertex(x,j,vertices[0]);//already got this vertex before, thanks to Danny Chapman
-        getVertex(x+1,j+1,vertices[1]);
+		callback->processTriangle(vertices,x,j);
+		//second triangle
+		//  getVertex(x,j,vertices[0]);//already got this vertex before, thanks to Danny Chapman
+		getVertex(x+1,j+1,vertices[1]);
 		getVertex(x + 1, j, vertices[2]);
 		callback->processTriangle(vertices, x, j);
 
+	} else
+	{
+		//first triangle
+		getVertex(x,j,vertices[0]);
+		getVertex(x,j+1,vertices[1]);
+		getVertex(x+1,j,vertices[2]);
+		callback->processTriangle(vertices,x,j);
+		//second triangle
+		getVertex(x+1,j,vertices[0]);
+		//getVertex(x,j+1,vertices[1]);
+		getVertex(x+1,j+1,vertices[2]);
+		callback->processTriangle(vertices,x,j);
+	}
+}
+
+void	btHeightfieldTerrainShape::getCellRange(int x,int j,Range& range) const
+{
+	btScalar h0 = getRawHeightFieldValue(x,j);
+	btScalar h1 = getRawHeightFieldValue(x+1,j);
+	btScalar h2 = getRawHeightFieldValue(x,j+1);
+	btScalar h3 = getRawHeightFieldValue(x+1,j+1);
+	range.m_min = btMin(btMin(h0,h1),btMin(h2,h3));
+	range.m_max = btMax(btMax(h0,h1),btMax(h2,h3));
+}
+
+void	btHeightfieldTerrainShape::getBlockRange(int level,int blockX,int blockJ,Range& range) const
+{
+	if (!hasAccelerator())
+	{
+		btAssert(level==0);
+		getCellRange(blockX,blockJ,range);
+		return;
+	}
+	int index = m_acceleratorLevelOffsets[level]+blockJ*getNumBlocks(level,m_heightStickWidth-1)+blockX;
+	range = m_acceleratorRanges[index];
+}
+
+///reports the cells of the block within [cellMin,cellMax], skipping the sub-blocks that are outside heightRange
+void	btHeightfieldTerrainShape::processBlock(btTriangleCallback* callback,int level,int blockX,int blockJ,const int* cellMin,const int* cellMax,const Range& heightRange) const
+{
+	if (((blockX+1)<<level)<=cellMin[0] || (blockX<<level)>cellMax[0] ||
+		((blockJ+1)<<level)<=cellMin[1] || (blockJ<<level)>cellMax[1])
+		return;
+	Range range;
+	getBlockRange(level,blockX,blockJ,range);
+	if (range.m_max<heightRange.m_min || range.m_min>heightRange.m_max)
+		return;
+	if (level==0)
+	{
+		processCell(callback,blockX,blockJ);
+		return;
+	}
+	int numBlocksX = getNumBlocks(level-1,m_heightStickWidth-1);
+	int numBlocksJ = getNumBlocks(level-1,m_heightStickLength-1);
+	for (int j=blockJ*2;j<blockJ*2+2 && j<numBlocksJ;j++)
+	{
+		for (int x=blockX*2;x<blockX*2+2 && x<numBlocksX;x++)
+		{
+			processBlock(callback,level-1,x,j,cellMin,cellMax,heightRange);
+		}
+	}
+}
+
+static inline int clampedFloor(btScalar value,int minValue,int maxValue)
+{
+	if (!(value>btScalar(minValue)))
+		return minValue;
+	if (value>=btScalar(maxValue))
+		return maxValue;
+	//positive here, truncation is the floor
+	return int(value);
+}
+
+/// walk the ray over the grid, nearest cell first
+/**
+  The ray is walked over the blocks of the top level of the min/max pyramid
+  (or over the cells without accelerator), with a DDA: it steps to the next
+  block along the horizontal axis whose boundary it crosses first. A block
+  whose height range overlaps the height range of the ray over the block is
+  walked at the next finer level, and the triangles of overlapping cells are
+  reported. After leaving a block, the walk goes back to the coarser level.
+ */
+void	btHeightfieldTerrainShape::performRaycast(btTriangleCallback* callback,const btVector3& raySource,const btVector3& rayTarget,const btScalar* maxHitFraction) const
+{
+	//to grid coordinates: the horizontal axes in cells and the up axis in raw heights
+	btVector3 invScaling(btScalar(1.)/m_localScaling[0],btScalar(1.)/m_localScaling[1],btScalar(1.)/m_localScaling[2]);
+	btVector3 from = raySource*invScaling+m_localOrigin;
+	btVector3 to = rayTarget*invScaling+m_localOrigin;
+
+	int axisX = (m_upAxis==0) ? 1 : 0;
+	int axisJ = (m_upAxis==2) ? 1 : 2;
+	const int numCells[2] = {m_heightStickWidth-1,m_heightStickLength-1};
+	const btScalar origin[2] = {from[axisX],from[axisJ]};
+	const btScalar dir[2] = {to[axisX]-from[axisX],to[axisJ]-from[axisJ]};
+	btScalar heightFrom = from[m_upAxis];
+	btScalar heightDir = to[m_upAxis]-from[m_upAxis];
+
+	//clip the ray to the grid
+	btScalar tEnter = btScalar(0.);
+	btScalar tExit = btScalar(1.);
+	btScalar invDir[2];
+	int step[2];
+	for (int i=0;i<2;i++)
+	{
+		if (dir[i]==btScalar(0.))
+		{
+			if (origin[i]<btScalar(0.) || origin[i]>btScalar(numCells[i]))
+				return;
+			invDir[i] = btScalar(0.);
+			step[i] = 0;
+			continue;
+		}
+		invDir[i] = btScalar(1.)/dir[i];
+		step[i] = dir[i]>btScalar(0.) ? 1 : -1;
+		btScalar t0 = (btScalar(0.)-origin[i])*invDir[i];
+		btScalar t1 = (btScalar(numCells[i])-origin[i])*invDir[i];
+		tEnter = btMax(tEnter,btMin(t0,t1));
+		tExit = btMin(tExit,btMax(t0,t1));
+	}
+	if (tEnter>tExit)
+		return;
+
+	//heights along the ray are interpolated, don't let rounding skip a cell the ray grazes
+	btScalar tolerance = (btFabs(m_minHeight)+btFabs(m_maxHeight)+btScalar(1.))*btScalar(1e-5);
+
+	//start at the finest level with blocks as large as the horizontal extent of the ray, a short ray
+	//would only descend through blocks that all contain it
+	int topLevel = 0;
+	if (hasAccelerator())
+	{
+		btScalar extent = btMax(btFabs(dir[0]),btFabs(dir[1]))*(tExit-tEnter);
+		for (;topLevel<m_acceleratorLevelOffsets.size()-1 && btScalar(1<<topLevel)<extent;topLevel++)
+		{
+		}
+	}
+	int level = topLevel;
+	btScalar t = tEnter;
+	int block[2];
+	for (int i=0;i<2;i++)
+	{
+		block[i] = clampedFloor((origin[i]+dir[i]*t)/btScalar(1<<level),0,getNumBlocks(level,numCells[i])-1);
+	}
+
+	for (;;)
+	{
+		btScalar size = btScalar(1<<level);
+		//ray parameter where it leaves the block along each axis
+		btScalar tNext[2];
+		for (int i=0;i<2;i++)
+		{
+			if (step[i]==0)
+			{
+				tNext[i] = BT_LARGE_FLOAT;
 			} else
 			{
-        //first triangle
-        getVertex(x,j,vertices[0]);
-        getVertex(x,j+1,vertices[1]);
-        getVertex(x+1,j,vertices[2]);
-        callback->processTriangle(vertices,x,j);
-        //second triangle
-        getVertex(x+1,j,vertices[0]);
-        //getVertex(x,j+1,vertices[1]);
-        getVertex(x+1,j+1,vertices[2]);
-        callback->processTriangle(vertices,x,j);
+				btScalar boundary = (step[i]>0) ? btScalar(block[i]+1)*size : btScalar(block[i])*size;
+				tNext[i] = (boundary-origin[i])*invDir[i];
 			}
 		}
+		btScalar tLeave = btMax(t,btMin(btMin(tNext[0],tNext[1]),tExit));
+
+		Range range;
+		getBlockRange(level,block[0],block[1],range);
+		btScalar h0 = heightFrom+heightDir*t;
+		btScalar h1 = heightFrom+heightDir*tLeave;
+		if (btMax(h0,h1)>=range.m_min-tolerance && btMin(h0,h1)<=range.m_max+tolerance)
+		{
+			if (level==0)
+			{
+				processCell(callback,block[0],block[1]);
+			} else
+			{
+				//walk the children of the block, from the one the ray enters
+				level--;
+				btScalar childSize = btScalar(1<<level);
+				for (int i=0;i<2;i++)
+				{
+					int maxChild = btMin(block[i]*2+1,getNumBlocks(level,numCells[i])-1);
+					block[i] = clampedFloor((origin[i]+dir[i]*t)/childSize,block[i]*2,maxChild);
+				}
+				continue;
+			}
+		}
+
+		if (tLeave>=tExit || (maxHitFraction && tLeave>*maxHitFraction))
+			break;
+		//step to the neighbouring block, and back up to the coarsest level at which the walk left a block
+		int axis = (tNext[0]<=tNext[1]) ? 0 : 1;
+		int previous = block[axis];
+		block[axis] += step[axis];
+		if (block[axis]<0 || block[axis]>=getNumBlocks(level,numCells[axis]))
+			break;
+		t = tLeave;
+		while (level<topLevel && (block[axis]>>1)!=(previous>>1))
+		{
+			level++;
+			previous >>= 1;
+			block[0] >>= 1;
+			block[1] >>= 1;
+		}
 	}
+}
 
-	
+void	btHeightfieldTerrainShape::buildAccelerator()
+{
+	m_acceleratorLevelOffsets.resize(0);
+	int numRanges = 0;
+	for (int level=0;;level++)
+	{
+		m_acceleratorLevelOffsets.push_back(numRanges);
+		int numBlocksX = getNumBlocks(level,m_heightStickWidth-1);
+		int numBlocksJ = getNumBlocks(level,m_heightStickLength-1);
+		numRanges += numBlocksX*numBlocksJ;
+		if (numBlocksX==1 && numBlocksJ==1)
+			break;
+	}
+	m_acceleratorRanges.resize(numRanges);
+	updateAccelerator(0,0,m_heightStickWidth-1,m_heightStickLength-1);
+}
+
+void	btHeightfieldTerrainShape::updateAccelerator(int startX,int startJ,int endX,int endJ)
+{
+	if (!hasAccelerator())
+		return;
+	//the cells that have one of the grid points as corner
+	int minX = btMax(startX-1,0);
+	int minJ = btMax(startJ-1,0);
+	int maxX = btMin(endX,m_heightStickWidth-2);
+	int maxJ = btMin(endJ,m_heightStickLength-2);
+	int numBlocksX = m_heightStickWidth-1;
+	for (int j=minJ;j<=maxJ;j++)
+	{
+		for (int x=minX;x<=maxX;x++)
+		{
+			getCellRange(x,j,m_acceleratorRanges[j*numBlocksX+x]);
+		}
+	}
+	for (int level=1;level<m_acceleratorLevelOffsets.size();level++)
+	{
+		minX >>= 1;
+		minJ >>= 1;
+		maxX >>= 1;
+		maxJ >>= 1;
+		const Range* children = &m_acceleratorRanges[m_acceleratorLevelOffsets[level-1]];
+		int numChildrenX = numBlocksX;
+		int numChildrenJ = getNumBlocks(level-1,m_heightStickLength-1);
+		numBlocksX = getNumBlocks(level,m_heightStickWidth-1);
+		Range* ranges = &m_acceleratorRanges[m_acceleratorLevelOffsets[level]];
+		for (int j=minJ;j<=maxJ;j++)
+		{
+			for (int x=minX;x<=maxX;x++)
+			{
+				Range range = children[j*2*numChildrenX+x*2];
+				for (int cj=j*2;cj<j*2+2 && cj<numChildrenJ;cj++)
+				{
+					for (int cx=x*2;cx<x*2+2 && cx<numChildrenX;cx++)
+					{
+						const Range& child = children[cj*numChildrenX+cx];
+						range.m_min = btMin(range.m_min,child.m_min);
+						range.m_max = btMax(range.m_max,child.m_max);
+					}
+				}
+				ranges[j*numBlocksX+x] = range;
+			}
+		}
+	}
+}
 
+void	btHeightfieldTerrainShape::clearAccelerator()
+{
+	m_acceleratorRanges.clear();
+	m_acceleratorLevelOffsets.clear();
 }
 
 void	btHeightfieldTerrainShape::calculateLocalInertia(btScalar ,btVector3& inertia) const
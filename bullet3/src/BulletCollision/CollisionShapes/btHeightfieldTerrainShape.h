@@ -17,6 +17,7 @@ subject to the following restrictions:
 #define BT_HEIGHTFIELD_TERRAIN_SHAPE_H
 
 #include "btConcaveShape.h"
+#include "LinearMath/btAlignedObjectArray.h"
 
 ///btHeightfieldTerrainShape simulates a 2D heightfield terrain
 /**
@@ -66,6 +67,11 @@ subject to the following restrictions:
   or maximum heights.  These values are used to determine the heightfield's
   axis-aligned bounding box, multiplied by localScaling.
 
+  buildAccelerator precomputes a pyramid of the min/max heights of blocks of
+  cells. With it, processAllTriangles and performRaycast skip the blocks that
+  are above or below the query, which matters for long rays over large
+  terrains. It has to be updated when the heights change.
+
   For usage and testing see the TerrainDemo.
  */
 ATTRIBUTE_ALIGNED16(class) btHeightfieldTerrainShape : public btConcaveShape
@@ -100,10 +106,32 @@ protected:
 	
 	btVector3	m_localScaling;
 
+	struct Range
+	{
+		btScalar	m_min;
+		btScalar	m_max;
+	};
+
+	///min/max raw heights of the cells, then of blocks of 2x2 cells, 4x4 cells and so on, until one block covers the
+	///whole grid. m_acceleratorLevelOffsets has the start of each level in m_acceleratorRanges, empty without accelerator
+	btAlignedObjectArray<Range>	m_acceleratorRanges;
+	btAlignedObjectArray<int>	m_acceleratorLevelOffsets;
+
 	virtual btScalar	getRawHeightFieldValue(int x,int y) const;
 	void		quantizeWithClamp(int* out, const btVector3& point,int isMax) const;
 	void		getVertex(int x,int y,btVector3& vertex) const;
 
+	///reports the two triangles of the cell between grid points (x,j) and (x+1,j+1)
+	void		processCell(btTriangleCallback* callback,int x,int j) const;
+
+	int		getNumBlocks(int level,int numCells) const
+	{
+		return ((numCells-1)>>level)+1;
+	}
+	void		getCellRange(int x,int j,Range& range) const;
+	void		getBlockRange(int level,int blockX,int blockJ,Range& range) const;
+	void		processBlock(btTriangleCallback* callback,int level,int blockX,int blockJ,const int* cellMin,const int* cellMax,const Range& heightRange) const;
+
 
 
 	/// protected initialization
@@ -149,10 +177,48 @@ public:
 	///could help compatibility with Ogre heightfields. See https://code.google.com/p/bullet/issues/detail?id=625	
 	void setUseZigzagSubdivision(bool useZigzagSubdivision=true) { m_useZigzagSubdivision = useZigzagSubdivision;}
 
+	bool getUseDiamondSubdivision() const { return m_useDiamondSubdivision; }
+
+	bool getUseZigzagSubdivision() const { return m_useZigzagSubdivision; }
+
+	int getHeightStickWidth() const { return m_heightStickWidth; }
+
+	int getHeightStickLength() const { return m_heightStickLength; }
+
+	///the heights the shape refers to (not a copy), of type getHeightDataType
+	const void* getHeightfieldRawData() const { return m_heightfieldDataUnknown; }
+
+	PHY_ScalarType getHeightDataType() const { return m_heightDataType; }
+
+	btScalar getHeightScale() const { return m_heightScale; }
+
+	btScalar getMinHeight() const { return m_minHeight; }
+
+	btScalar getMaxHeight() const { return m_maxHeight; }
+
+	int getUpAxis() const { return m_upAxis; }
+
+	bool getFlipQuadEdges() const { return m_flipQuadEdges; }
+
 	virtual void getAabb(const btTransform& t,btVector3& aabbMin,btVector3& aabbMax) const;
 
 	virtual void	processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 
+	///reports the triangles of the cells the ray passes over, nearest first, that can intersect it.
+	///raySource and rayTarget are in the local space of the shape, like the aabb of processAllTriangles.
+	///When maxHitFraction is given, like the m_hitFraction of a btTriangleRaycastCallback, the walk stops past it
+	void	performRaycast(btTriangleCallback* callback,const btVector3& raySource,const btVector3& rayTarget,const btScalar* maxHitFraction=0) const;
+
+	///computes the min/max height pyramid from the current heights
+	void	buildAccelerator();
+
+	///recomputes the pyramid over the cells around the grid points [startX,endX] x [startJ,endJ], after their heights changed
+	void	updateAccelerator(int startX,int startJ,int endX,int endJ);
+
+	void	clearAccelerator();
+
+	bool	hasAccelerator() const { return m_acceleratorLevelOffsets.size()>0; }
+
 	virtual void	calculateLocalInertia(btScalar mass,btVector3& inertia) const;
 
 	virtual void	setLocalScaling(const btVector3& scaling);
@@ -18,6 +18,7 @@ subject to the following restrictions:
 #include "btStridingMeshInterface.h"
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btIDebugDraw.h"
+#include "LinearMath/btThreads.h"
 
 
 btOptimizedBvh::btOptimizedBvh()
@@ -181,7 +182,10 @@ void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantized
 
 	m_curNodeIndex = 0;
 
-	buildTree(0,numLeafNodes);
+	if (s_buildMode == BUILD_SAH_BINNED)
+		buildTreeSah(numLeafNodes);
+	else
+		buildTree(0,numLeafNodes);
 
 	///if the entire tree is small then subtree size, we need to create a header info for the tree
 	if(m_useQuantization && !m_SubtreeHeaders.size())
@@ -230,6 +234,54 @@ void	btOptimizedBvh::refit(btStridingMeshInterface* meshInterface,const btVector
 
 
 
+struct btOptimizedBvhRefitLoop : public btIParallelForBody
+{
+	btOptimizedBvh*	m_bvh;
+	btStridingMeshInterface*	m_meshInterface;
+
+	void forLoop(int iBegin,int iEnd) const BT_OVERRIDE
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			btBvhSubtreeInfo& subtree = m_bvh->getSubtreeInfoArray()[i];
+			m_bvh->updateBvhNodes(m_meshInterface,subtree.m_rootNodeIndex,subtree.m_rootNodeIndex+subtree.m_subtreeSize,i);
+			subtree.setAabbFromQuantizeNode(m_bvh->getQuantizedNodeArray()[subtree.m_rootNodeIndex]);
+		}
+	}
+};
+
+void	btOptimizedBvh::refitParallel(btStridingMeshInterface* meshInterface,const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	if (m_useQuantization)
+	{
+		setQuantizationValues(aabbMin,aabbMax);
+
+		///the subtree headers cover all leaves, update the subtrees in parallel
+		btOptimizedBvhRefitLoop loop;
+		loop.m_bvh = this;
+		loop.m_meshInterface = meshInterface;
+		btParallelForOrSerial(0,m_SubtreeHeaders.size(),1,loop);
+
+		///then the nodes above the subtrees, children before parents
+		for (int i=m_curNodeIndex-1;i>=0;i--)
+		{
+			btQuantizedBvhNode& curNode = m_quantizedContiguousNodes[i];
+			if (curNode.isLeafNode() || curNode.getEscapeIndex()*static_cast<int>(sizeof(btQuantizedBvhNode)) <= MAX_SUBTREE_SIZE_IN_BYTES)
+			{
+				continue;
+			}
+			const btQuantizedBvhNode* leftChildNode = &m_quantizedContiguousNodes[i+1];
+			const btQuantizedBvhNode* rightChildNode = leftChildNode->isLeafNode() ? &m_quantizedContiguousNodes[i+2] :
+				&m_quantizedContiguousNodes[i+1+leftChildNode->getEscapeIndex()];
+			for (int j=0;j<3;j++)
+			{
+				curNode.m_quantizedAabbMin[j] = btMin(leftChildNode->m_quantizedAabbMin[j],rightChildNode->m_quantizedAabbMin[j]);
+				curNode.m_quantizedAabbMax[j] = btMax(leftChildNode->m_quantizedAabbMax[j],rightChildNode->m_quantizedAabbMax[j]);
+			}
+		}
+	}
+}
+
 void	btOptimizedBvh::refitPartial(btStridingMeshInterface* meshInterface,const btVector3& aabbMin,const btVector3& aabbMax)
 {
 	//incrementally initialize quantization values
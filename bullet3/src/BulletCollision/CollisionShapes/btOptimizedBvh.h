@@ -42,6 +42,11 @@ public:
 
 	void	refit(btStridingMeshInterface* triangles,const btVector3& aabbMin,const btVector3& aabbMax);
 
+	///refitParallel is refit with the subtrees updated on the threads of the task scheduler (see btSetTaskScheduler), for deforming meshes.
+	///Without a task scheduler the subtrees are updated on the calling thread.
+	///The triangles must allow getLockedReadOnlyVertexIndexBase from several threads at once, as btTriangleIndexVertexArray and btTriangleMesh do.
+	void	refitParallel(btStridingMeshInterface* triangles,const btVector3& aabbMin,const btVector3& aabbMax);
+
 	void	refitPartial(btStridingMeshInterface* triangles,const btVector3& aabbMin, const btVector3& aabbMax);
 
 	void	updateBvhNodes(btStridingMeshInterface* meshInterface,int firstNode,int endNode,int index);
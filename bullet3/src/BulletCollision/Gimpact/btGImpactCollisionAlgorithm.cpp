@@ -30,6 +30,7 @@ Concave-Concave Collision
 #include "btGImpactCollisionAlgorithm.h"
 #include "btContactProcessing.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
 
 
 //! Class for accessing the plane equation
@@ -385,6 +386,73 @@ void btGImpactCollisionAlgorithm::collide_gjk_triangles(const btCollisionObjectW
 	shape1->unlockChildShapes();
 }
 
+//! with a task scheduler, pair sets this large are collided by btParallelFor
+#define GIMPACT_PARALLEL_MIN_TRIANGLE_PAIRS 512
+
+static SIMD_FORCE_INLINE bool gimpact_sat_triangle_collision(
+	const btGImpactMeshShapePart * shape0, const btGImpactMeshShapePart * shape1,
+	const btTransform & orgtrans0, const btTransform & orgtrans1,
+	int triface0, int triface1, GIM_TRIANGLE_CONTACT & contact_data)
+{
+	btPrimitiveTriangle ptri0;
+	btPrimitiveTriangle ptri1;
+	shape0->getPrimitiveTriangle(triface0,ptri0);
+	shape1->getPrimitiveTriangle(triface1,ptri1);
+
+	ptri0.applyTransform(orgtrans0);
+	ptri1.applyTransform(orgtrans1);
+
+	//build planes
+	ptri0.buildTriPlane();
+	ptri1.buildTriPlane();
+	// test conservative
+	if(ptri0.overlap_test_conservative(ptri1))
+	{
+		return ptri0.find_triangle_collision_clip_method(ptri1,contact_data);
+	}
+	return false;
+}
+
+#if BT_THREADSAFE
+struct btGImpactTriangleContactResult
+{
+	int m_pair;
+	GIM_TRIANGLE_CONTACT m_contact;
+};
+
+struct btGImpactTriangleContactResultSortPredicate
+{
+	bool operator()(const btGImpactTriangleContactResult & a, const btGImpactTriangleContactResult & b) const
+	{
+		return a.m_pair < b.m_pair;
+	}
+};
+
+struct btGImpactSatTrianglesLoop : public btIParallelForBody
+{
+	const btGImpactMeshShapePart * m_shape0;
+	const btGImpactMeshShapePart * m_shape1;
+	btTransform m_orgtrans0;
+	btTransform m_orgtrans1;
+	const int * m_pairs;
+	btAlignedObjectArray<btGImpactTriangleContactResult> * m_thread_results;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		btAlignedObjectArray<btGImpactTriangleContactResult> & results = m_thread_results[btGetCurrentThreadIndex()];
+		btGImpactTriangleContactResult result;
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			if (gimpact_sat_triangle_collision(m_shape0,m_shape1,m_orgtrans0,m_orgtrans1,m_pairs[2*i],m_pairs[2*i+1],result.m_contact))
+			{
+				result.m_pair = i;
+				results.push_back(result);
+			}
+		}
+	}
+};
+#endif //BT_THREADSAFE
+
 void btGImpactCollisionAlgorithm::collide_sat_triangles(const btCollisionObjectWrapper* body0Wrap,
 					  const btCollisionObjectWrapper* body1Wrap,
 					  const btGImpactMeshShapePart * shape0,
@@ -394,13 +462,58 @@ void btGImpactCollisionAlgorithm::collide_sat_triangles(const btCollisionObjectW
 	btTransform orgtrans0 = body0Wrap->getWorldTransform();
 	btTransform orgtrans1 = body1Wrap->getWorldTransform();
 
-	btPrimitiveTriangle ptri0;
-	btPrimitiveTriangle ptri1;
 	GIM_TRIANGLE_CONTACT contact_data;
 
 	shape0->lockChildShapes();
 	shape1->lockChildShapes();
 
+#if BT_THREADSAFE
+	if (pair_count >= GIMPACT_PARALLEL_MIN_TRIANGLE_PAIRS && btGetTaskScheduler())
+	{
+		//the triangle tests run on all threads into per-thread buffers,
+		//the contacts are added here in the order of the pairs, like the serial loop does
+		btAlignedObjectArray< btAlignedObjectArray<btGImpactTriangleContactResult> > thread_results;
+		thread_results.resize(BT_MAX_THREAD_COUNT);
+		btGImpactSatTrianglesLoop loop;
+		loop.m_shape0 = shape0;
+		loop.m_shape1 = shape1;
+		loop.m_orgtrans0 = orgtrans0;
+		loop.m_orgtrans1 = orgtrans1;
+		loop.m_pairs = pairs;
+		loop.m_thread_results = &thread_results[0];
+		btParallelFor(0,pair_count,64,loop);
+
+		btAlignedObjectArray<btGImpactTriangleContactResult> results;
+		for (int t=0;t<thread_results.size();t++)
+		{
+			for (int r=0;r<thread_results[t].size();r++)
+			{
+				results.push_back(thread_results[t][r]);
+			}
+		}
+		results.quickSort(btGImpactTriangleContactResultSortPredicate());
+
+		for (int r=0;r<results.size();r++)
+		{
+			const btGImpactTriangleContactResult & result = results[r];
+			m_triface0 = pairs[2*result.m_pair];
+			m_triface1 = pairs[2*result.m_pair+1];
+			int j = result.m_contact.m_point_count;
+			while(j--)
+			{
+				addContactPoint(body0Wrap, body1Wrap,
+							result.m_contact.m_points[j],
+							result.m_contact.m_separating_normal,
+							-result.m_contact.m_penetration_depth);
+			}
+		}
+
+		shape0->unlockChildShapes();
+		shape1->unlockChildShapes();
+		return;
+	}
+#endif //BT_THREADSAFE
+
 	const int * pair_pointer = pairs;
 
 	while(pair_count--)
@@ -410,39 +523,21 @@ void btGImpactCollisionAlgorithm::collide_sat_triangles(const btCollisionObjectW
 		m_triface1 = *(pair_pointer+1);
 		pair_pointer+=2;
 
-
-		shape0->getPrimitiveTriangle(m_triface0,ptri0);
-		shape1->getPrimitiveTriangle(m_triface1,ptri1);
-
 		#ifdef TRI_COLLISION_PROFILING
 		bt_begin_gim02_tri_time();
 		#endif
 
-		ptri0.applyTransform(orgtrans0);
-		ptri1.applyTransform(orgtrans1);
-
-
-		//build planes
-		ptri0.buildTriPlane();
-		ptri1.buildTriPlane();
-		// test conservative
-
-
-
-		if(ptri0.overlap_test_conservative(ptri1))
+		if(gimpact_sat_triangle_collision(shape0,shape1,orgtrans0,orgtrans1,m_triface0,m_triface1,contact_data))
 		{
-			if(ptri0.find_triangle_collision_clip_method(ptri1,contact_data))
-			{
 
-				int j = contact_data.m_point_count;
-				while(j--)
-				{
+			int j = contact_data.m_point_count;
+			while(j--)
+			{
 
-					addContactPoint(body0Wrap, body1Wrap,
-								contact_data.m_points[j],
-								contact_data.m_separating_normal,
-								-contact_data.m_penetration_depth);
-				}
+				addContactPoint(body0Wrap, body1Wrap,
+							contact_data.m_points[j],
+							contact_data.m_separating_normal,
+							-contact_data.m_penetration_depth);
 			}
 		}
 
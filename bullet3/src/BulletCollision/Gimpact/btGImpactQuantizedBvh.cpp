@@ -23,6 +23,7 @@ subject to the following restrictions:
 
 #include "btGImpactQuantizedBvh.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btThreads.h"
 
 #ifdef TRI_COLLISION_PROFILING
 btClock g_q_tree_clock;
@@ -64,6 +65,24 @@ float btGImpactQuantizedBvh::getAverageTreeCollisionTime()
 
 #endif //TRI_COLLISION_PROFILING
 
+//! subtrees with this many primitives or fewer are built, refit and collided by one task
+#define GIM_PARALLEL_SUBTREE_PRIMITIVES 256
+
+//! sets of fewer primitives are built, refit and collided on the calling thread
+#define GIM_PARALLEL_MIN_PRIMITIVES 2048
+
+//! with a task scheduler, large sets are processed by btParallelFor.
+//! Nested in another parallel loop, like in btCollisionDispatcherMt, btParallelFor runs on the calling thread
+static SIMD_FORCE_INLINE bool gim_use_parallel_loop(int primitive_count)
+{
+#if BT_THREADSAFE
+	return primitive_count >= GIM_PARALLEL_MIN_PRIMITIVES && btGetTaskScheduler() != NULL;
+#else
+	(void)primitive_count;
+	return false;
+#endif
+}
+
 /////////////////////// btQuantizedBvhTree /////////////////////////////////
 
 void btQuantizedBvhTree::calc_quantization(
@@ -178,11 +197,9 @@ int btQuantizedBvhTree::_sort_and_calc_splitting_index(
 }
 
 
-void btQuantizedBvhTree::_build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex)
+void btQuantizedBvhTree::_build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex,
+	int curIndex, btAlignedObjectArray<GIM_BVH_BUILD_TASK> * tasks)
 {
-	int curIndex = m_num_nodes;
-	m_num_nodes++;
-
 	btAssert((endIndex-startIndex)>0);
 
 	if ((endIndex-startIndex)==1)
@@ -193,6 +210,17 @@ void btQuantizedBvhTree::_build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, i
 
 		return;
 	}
+
+	if (tasks && (endIndex-startIndex)<=GIM_PARALLEL_SUBTREE_PRIMITIVES)
+	{
+		GIM_BVH_BUILD_TASK task;
+		task.m_startIndex = startIndex;
+		task.m_endIndex = endIndex;
+		task.m_nodeIndex = curIndex;
+		tasks->push_back(task);
+		return;
+	}
+
 	//calculate Best Splitting Axis and where to split it. Sort the incoming 'leafNodes' array within range 'startIndex/endIndex'.
 
 	//split axis
@@ -218,82 +246,206 @@ void btQuantizedBvhTree::_build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, i
 
 
 	//build left branch
-	_build_sub_tree(primitive_boxes, startIndex, splitIndex );
+	_build_sub_tree(primitive_boxes, startIndex, splitIndex, curIndex+1, tasks);
 
 
 	//build right branch
-	 _build_sub_tree(primitive_boxes, splitIndex ,endIndex);
+	_build_sub_tree(primitive_boxes, splitIndex, endIndex, curIndex+2*(splitIndex-startIndex), tasks);
 
-	m_node_array[curIndex].setEscapeIndex(m_num_nodes - curIndex);
+	m_node_array[curIndex].setEscapeIndex(2*(endIndex-startIndex)-1);
 
 
 }
 
+struct GIM_BVH_BUILD_TASK_LOOP : public btIParallelForBody
+{
+	btQuantizedBvhTree * m_tree;
+	GIM_BVH_DATA_ARRAY * m_primitive_boxes;
+	const GIM_BVH_BUILD_TASK * m_tasks;
+	void (btQuantizedBvhTree::*m_build)(GIM_BVH_DATA_ARRAY &, int, int, int, btAlignedObjectArray<GIM_BVH_BUILD_TASK> *);
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			const GIM_BVH_BUILD_TASK & task = m_tasks[i];
+			(m_tree->*m_build)(*m_primitive_boxes,task.m_startIndex,task.m_endIndex,task.m_nodeIndex,NULL);
+		}
+	}
+};
+
 //! stackless build tree
 void btQuantizedBvhTree::build_tree(
 	GIM_BVH_DATA_ARRAY & primitive_boxes)
 {
 	calc_quantization(primitive_boxes);
-	// initialize node count to 0
-	m_num_nodes = 0;
+	// a tree of n primitives has 2n-1 nodes
+	m_num_nodes = primitive_boxes.size() ? primitive_boxes.size()*2-1 : 0;
 	// allocate nodes
 	m_node_array.resize(primitive_boxes.size()*2);
+	if (m_num_nodes==0)
+		return;
+
+	if (!gim_use_parallel_loop(primitive_boxes.size()))
+	{
+		_build_sub_tree(primitive_boxes, 0, primitive_boxes.size(), 0, NULL);
+		return;
+	}
+
+	//the top of the tree is built here, the subtrees below by tasks, into the same nodes as the serial build
+	btAlignedObjectArray<GIM_BVH_BUILD_TASK> tasks;
+	_build_sub_tree(primitive_boxes, 0, primitive_boxes.size(), 0, &tasks);
 
-	_build_sub_tree(primitive_boxes, 0, primitive_boxes.size());
+	GIM_BVH_BUILD_TASK_LOOP loop;
+	loop.m_tree = this;
+	loop.m_primitive_boxes = &primitive_boxes;
+	loop.m_tasks = &tasks[0];
+	loop.m_build = &btQuantizedBvhTree::_build_sub_tree;
+	btParallelFor(0,tasks.size(),1,loop);
 }
 
 ////////////////////////////////////class btGImpactQuantizedBvh
 
-void btGImpactQuantizedBvh::refit()
+void btGImpactQuantizedBvh::refitNode(int nodeindex)
 {
-	int nodecount = getNodeCount();
-	while(nodecount--)
+	if(isLeafNode(nodeindex))
 	{
-		if(isLeafNode(nodecount))
+		btAABB leafbox;
+		m_primitive_manager->get_primitive_box(getNodeData(nodeindex),leafbox);
+		setNodeBound(nodeindex,leafbox);
+	}
+	else
+	{
+		//const GIM_BVH_TREE_NODE * nodepointer = get_node_pointer(nodeindex);
+		//get left bound
+		btAABB bound;
+		bound.invalidate();
+
+		btAABB temp_box;
+
+		int child_node = getLeftNode(nodeindex);
+		if(child_node)
 		{
-			btAABB leafbox;
-			m_primitive_manager->get_primitive_box(getNodeData(nodecount),leafbox);
-			setNodeBound(nodecount,leafbox);
+			getNodeBound(child_node,temp_box);
+			bound.merge(temp_box);
 		}
-		else
+
+		child_node = getRightNode(nodeindex);
+		if(child_node)
 		{
-			//const GIM_BVH_TREE_NODE * nodepointer = get_node_pointer(nodecount);
-			//get left bound
-			btAABB bound;
-			bound.invalidate();
+			getNodeBound(child_node,temp_box);
+			bound.merge(temp_box);
+		}
 
-			btAABB temp_box;
+		setNodeBound(nodeindex,bound);
+	}
+}
 
-			int child_node = getLeftNode(nodecount);
-			if(child_node)
-			{
-				getNodeBound(child_node,temp_box);
-				bound.merge(temp_box);
-			}
+struct GIM_BVH_REFIT_LOOP : public btIParallelForBody
+{
+	btGImpactQuantizedBvh * m_bvh;
+	const int * m_subtrees;
+	void (btGImpactQuantizedBvh::*m_refitNode)(int);
 
-			child_node = getRightNode(nodecount);
-			if(child_node)
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			//the children of a node come after it
+			int root = m_subtrees[i];
+			int nodecount = m_bvh->isLeafNode(root) ? 1 : m_bvh->getEscapeNodeIndex(root);
+			while(nodecount--)
 			{
-				getNodeBound(child_node,temp_box);
-				bound.merge(temp_box);
+				(m_bvh->*m_refitNode)(root+nodecount);
 			}
+		}
+	}
+};
 
-			setNodeBound(nodecount,bound);
+void btGImpactQuantizedBvh::refit()
+{
+	int nodecount = getNodeCount();
+	if (!gim_use_parallel_loop(nodecount/2))
+	{
+		while(nodecount--)
+		{
+			refitNode(nodecount);
 		}
+		return;
+	}
+
+	//the small subtrees are refit by tasks, then the nodes above them here
+	btAlignedObjectArray<int> subtrees;
+	btAlignedObjectArray<int> topnodes;
+	btAlignedObjectArray<int> stack;
+	stack.push_back(0);
+	while (stack.size())
+	{
+		int node = stack[stack.size()-1];
+		stack.pop_back();
+		if (isLeafNode(node) || getEscapeNodeIndex(node) <= 2*GIM_PARALLEL_SUBTREE_PRIMITIVES)
+		{
+			subtrees.push_back(node);
+		}
+		else
+		{
+			topnodes.push_back(node);
+			stack.push_back(getRightNode(node));
+			stack.push_back(getLeftNode(node));
+		}
+	}
+
+	GIM_BVH_REFIT_LOOP loop;
+	loop.m_bvh = this;
+	loop.m_subtrees = &subtrees[0];
+	loop.m_refitNode = &btGImpactQuantizedBvh::refitNode;
+	btParallelFor(0,subtrees.size(),1,loop);
+
+	//a parent is listed before its children
+	int i = topnodes.size();
+	while(i--)
+	{
+		refitNode(topnodes[i]);
 	}
 }
 
+struct GIM_BVH_PRIMITIVE_BOX_LOOP : public btIParallelForBody
+{
+	btPrimitiveManagerBase * m_primitive_manager;
+	GIM_BVH_DATA * m_primitive_boxes;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			m_primitive_manager->get_primitive_box(i,m_primitive_boxes[i].m_bound);
+			m_primitive_boxes[i].m_data = i;
+		}
+	}
+};
+
 //! this rebuild the entire set
 void btGImpactQuantizedBvh::buildSet()
 {
 	//obtain primitive boxes
 	GIM_BVH_DATA_ARRAY primitive_boxes;
 	primitive_boxes.resize(m_primitive_manager->get_primitive_count());
+	if (primitive_boxes.size()==0)
+	{
+		m_box_tree.build_tree(primitive_boxes);
+		return;
+	}
 
-	for (int i = 0;i<primitive_boxes.size() ;i++ )
+	GIM_BVH_PRIMITIVE_BOX_LOOP loop;
+	loop.m_primitive_manager = m_primitive_manager;
+	loop.m_primitive_boxes = &primitive_boxes[0];
+	if (gim_use_parallel_loop(primitive_boxes.size()))
+	{
+		btParallelFor(0,primitive_boxes.size(),GIM_PARALLEL_SUBTREE_PRIMITIVES,loop);
+	}
+	else
 	{
-		 m_primitive_manager->get_primitive_box(i,primitive_boxes[i].m_bound);
-		 primitive_boxes[i].m_data = i;
+		loop.forLoop(0,primitive_boxes.size());
 	}
 
 	m_box_tree.build_tree(primitive_boxes);
@@ -501,6 +653,75 @@ static void _find_quantized_collision_pairs_recursive(
 }
 
 
+//! a pair of subtrees collided by one task of the parallel find_collision
+struct GIM_TREE_COLLISION_TASK
+{
+	int m_node0;
+	int m_node1;
+	bool m_complete_primitive_tests;
+	int m_thread;
+	int m_pair_start;
+	int m_pair_end;
+};
+
+//! descends both trees like _find_quantized_collision_pairs_recursive, but stops after a few levels
+//! and lists the node pairs below, in the order the recursion would visit them
+static void _collect_quantized_collision_tasks(
+	const btGImpactQuantizedBvh * boxset0, const btGImpactQuantizedBvh * boxset1,
+	btAlignedObjectArray<GIM_TREE_COLLISION_TASK> & tasks,
+	const BT_BOX_BOX_TRANSFORM_CACHE & trans_cache_1to0,
+	int node0, int node1, bool complete_primitive_tests, int depth)
+{
+	if(depth==0 || boxset0->isLeafNode(node0) || boxset1->isLeafNode(node1))
+	{
+		GIM_TREE_COLLISION_TASK task;
+		task.m_node0 = node0;
+		task.m_node1 = node1;
+		task.m_complete_primitive_tests = complete_primitive_tests;
+		tasks.push_back(task);
+		return;
+	}
+
+	if( _quantized_node_collision(
+		boxset0,boxset1,trans_cache_1to0,
+		node0,node1,complete_primitive_tests) ==false) return;//avoid colliding internal nodes
+
+	int left0 = boxset0->getLeftNode(node0);
+	int right0 = boxset0->getRightNode(node0);
+	int left1 = boxset1->getLeftNode(node1);
+	int right1 = boxset1->getRightNode(node1);
+	_collect_quantized_collision_tasks(boxset0,boxset1,tasks,trans_cache_1to0,left0,left1,false,depth-1);
+	_collect_quantized_collision_tasks(boxset0,boxset1,tasks,trans_cache_1to0,left0,right1,false,depth-1);
+	_collect_quantized_collision_tasks(boxset0,boxset1,tasks,trans_cache_1to0,right0,left1,false,depth-1);
+	_collect_quantized_collision_tasks(boxset0,boxset1,tasks,trans_cache_1to0,right0,right1,false,depth-1);
+}
+
+struct GIM_TREE_COLLISION_LOOP : public btIParallelForBody
+{
+	const btGImpactQuantizedBvh * m_boxset0;
+	const btGImpactQuantizedBvh * m_boxset1;
+	const BT_BOX_BOX_TRANSFORM_CACHE * m_trans_cache_1to0;
+	GIM_TREE_COLLISION_TASK * m_tasks;
+	btPairSet * m_thread_pairs;
+
+	void forLoop(int iBegin, int iEnd) const
+	{
+		int thread = btGetCurrentThreadIndex();
+		btPairSet & pairs = m_thread_pairs[thread];
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			GIM_TREE_COLLISION_TASK & task = m_tasks[i];
+			task.m_thread = thread;
+			task.m_pair_start = pairs.size();
+			_find_quantized_collision_pairs_recursive(
+				m_boxset0,m_boxset1,
+				&pairs,*m_trans_cache_1to0,
+				task.m_node0,task.m_node1,task.m_complete_primitive_tests);
+			task.m_pair_end = pairs.size();
+		}
+	}
+};
+
 void btGImpactQuantizedBvh::find_collision(const btGImpactQuantizedBvh * boxset0, const btTransform & trans0,
 		const btGImpactQuantizedBvh * boxset1, const btTransform & trans1,
 		btPairSet & collision_pairs)
@@ -516,13 +737,43 @@ void btGImpactQuantizedBvh::find_collision(const btGImpactQuantizedBvh * boxset0
 	bt_begin_gim02_q_tree_time();
 #endif //TRI_COLLISION_PROFILING
 
-	_find_quantized_collision_pairs_recursive(
-		boxset0,boxset1,
-		&collision_pairs,trans_cache_1to0,0,0,true);
+	if (gim_use_parallel_loop(btMin(boxset0->getNodeCount(),boxset1->getNodeCount())/2))
+	{
+		//the tasks collide subtrees into per-thread pair sets, the pairs are gathered in task order,
+		//which is the order of the serial recursion
+		btAlignedObjectArray<GIM_TREE_COLLISION_TASK> tasks;
+		_collect_quantized_collision_tasks(boxset0,boxset1,tasks,trans_cache_1to0,0,0,true,4);
+		if (tasks.size())
+		{
+			btAlignedObjectArray<btPairSet> thread_pairs;
+			thread_pairs.resize(BT_MAX_THREAD_COUNT);
+			GIM_TREE_COLLISION_LOOP loop;
+			loop.m_boxset0 = boxset0;
+			loop.m_boxset1 = boxset1;
+			loop.m_trans_cache_1to0 = &trans_cache_1to0;
+			loop.m_tasks = &tasks[0];
+			loop.m_thread_pairs = &thread_pairs[0];
+			btParallelFor(0,tasks.size(),1,loop);
+
+			for (int i=0;i<tasks.size();i++)
+			{
+				const GIM_TREE_COLLISION_TASK & task = tasks[i];
+				const btPairSet & pairs = thread_pairs[task.m_thread];
+				for (int j=task.m_pair_start;j<task.m_pair_end;j++)
+				{
+					collision_pairs.push_back(pairs[j]);
+				}
+			}
+		}
+	}
+	else
+	{
+		_find_quantized_collision_pairs_recursive(
+			boxset0,boxset1,
+			&collision_pairs,trans_cache_1to0,0,0,true);
+	}
 #ifdef TRI_COLLISION_PROFILING
 	bt_end_gim02_q_tree_time();
 #endif //TRI_COLLISION_PROFILING
 
 }
-
-
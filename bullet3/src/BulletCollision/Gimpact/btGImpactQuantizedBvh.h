@@ -32,6 +32,14 @@ class GIM_QUANTIZED_BVH_NODE_ARRAY:public btAlignedObjectArray<BT_QUANTIZED_BVH_
 {
 };
 
+//! A subtree of the parallel build, a range of primitive boxes and the index of its root node
+struct GIM_BVH_BUILD_TASK
+{
+	int m_startIndex;
+	int m_endIndex;
+	int m_nodeIndex;
+};
+
 
 
 
@@ -52,7 +60,11 @@ protected:
 
 	int _calc_splitting_axis(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex);
 
-	void _build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex);
+	//! builds the subtree with root curIndex. A subtree of n primitives has 2n-1 nodes, so the
+	//! right subtree starts 2*(splitIndex-startIndex) nodes after curIndex.
+	//! With tasks, small subtrees are not built but appended to the tasks
+	void _build_sub_tree(GIM_BVH_DATA_ARRAY & primitive_boxes, int startIndex,  int endIndex,
+		int curIndex, btAlignedObjectArray<GIM_BVH_BUILD_TASK> * tasks);
 public:
 	btQuantizedBvhTree()
 	{
@@ -166,6 +178,9 @@ protected:
 protected:
 	//stackless refit
 	void refit();
+
+	//! refits a node from its primitive or its children
+	void refitNode(int nodeindex);
 public:
 
 	//! this constructor doesn't build the tree. you must call	buildSet
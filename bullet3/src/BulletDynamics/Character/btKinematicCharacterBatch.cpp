@@ -0,0 +1,723 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btQuickprof.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btTransformUtil.h"
+#include "BulletCollision/CollisionDispatch/btGhostObject.h"
+#include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
+#include "BulletCollision/CollisionShapes/btConvexShape.h"
+#include "btKinematicCharacterBatch.h"
+
+
+///the sweep callback of btKinematicCharacterController
+class btCharacterBatchConvexResultCallback : public btCollisionWorld::ClosestConvexResultCallback
+{
+public:
+	btCharacterBatchConvexResultCallback (const btCollisionObject* me, const btVector3& up, btScalar minSlopeDot)
+	: btCollisionWorld::ClosestConvexResultCallback(btVector3(0.0, 0.0, 0.0), btVector3(0.0, 0.0, 0.0))
+	, m_me(me)
+	, m_up(up)
+	, m_minSlopeDot(minSlopeDot)
+	{
+	}
+
+	virtual btScalar addSingleResult(btCollisionWorld::LocalConvexResult& convexResult,bool normalInWorldSpace)
+	{
+		if (convexResult.m_hitCollisionObject == m_me)
+			return btScalar(1.0);
+
+		if (!convexResult.m_hitCollisionObject->hasContactResponse())
+			return btScalar(1.0);
+
+		btVector3 hitNormalWorld;
+		if (normalInWorldSpace)
+		{
+			hitNormalWorld = convexResult.m_hitNormalLocal;
+		} else
+		{
+			///need to transform normal into worldspace
+			hitNormalWorld = convexResult.m_hitCollisionObject->getWorldTransform().getBasis()*convexResult.m_hitNormalLocal;
+		}
+
+		btScalar dotUp = m_up.dot(hitNormalWorld);
+		if (dotUp < m_minSlopeDot) {
+			return btScalar(1.0);
+		}
+
+		return ClosestConvexResultCallback::addSingleResult (convexResult, normalInWorldSpace);
+	}
+protected:
+	const btCollisionObject* m_me;
+	const btVector3 m_up;
+	btScalar m_minSlopeDot;
+};
+
+struct btCharacterCellEntry
+{
+	int m_cell[3];
+	int m_character;
+};
+
+struct btCharacterCellSortPredicate
+{
+	bool operator() ( const btCharacterCellEntry& a, const btCharacterCellEntry& b ) const
+	{
+		if (a.m_cell[0] != b.m_cell[0])
+			return a.m_cell[0] < b.m_cell[0];
+		if (a.m_cell[1] != b.m_cell[1])
+			return a.m_cell[1] < b.m_cell[1];
+		if (a.m_cell[2] != b.m_cell[2])
+			return a.m_cell[2] < b.m_cell[2];
+		return a.m_character < b.m_character;
+	}
+};
+
+struct btCharacterCandidateCallback : public btBroadphaseAabbCallback
+{
+	btAlignedObjectArray<btCollisionObject*>* m_candidates;
+
+	virtual bool	process(const btBroadphaseProxy* proxy)
+	{
+		m_candidates->push_back(static_cast<btCollisionObject*>(proxy->m_clientObject));
+		return true;
+	}
+};
+
+///one broadphase query per cell group
+struct btCharacterGatherLoop : public btIParallelForBody
+{
+	btBroadphaseInterface* m_broadphase;
+	const btVector3* m_groupAabbs;
+	btAlignedObjectArray<btCollisionObject*>* m_groupCandidates;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			btCharacterCandidateCallback callback;
+			callback.m_candidates = &m_groupCandidates[i];
+			callback.m_candidates->resize(0);
+			m_broadphase->aabbTest(m_groupAabbs[i*2], m_groupAabbs[i*2+1], callback);
+		}
+	}
+};
+
+struct btCharacterStepLoop : public btIParallelForBody
+{
+	btKinematicCharacterBatch* m_batch;
+	btCollisionWorld* m_collisionWorld;
+	btKinematicCharacterBatch::CharacterState* m_states;
+	char* m_stepResults;
+	btScalar m_timeStep;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			m_stepResults[i] = char(m_batch->stepCharacter(i, m_collisionWorld, m_timeStep, m_states[i], false));
+		}
+	}
+};
+
+btKinematicCharacterBatch::btKinematicCharacterBatch(btScalar stepHeight, const btVector3& up)
+	:m_up(0,1,0),
+	m_gravity(btScalar(9.8 * 3.0)), // 3G acceleration.
+	m_stepHeight(stepHeight),
+	m_fallSpeed(btScalar(55.0)), // Terminal velocity of a sky diver in m/s.
+	m_jumpSpeed(btScalar(10.0)),
+	m_maxPenetrationDepth(btScalar(0.2)),
+	m_cellSize(btScalar(8.0))
+{
+	setUp(up);
+	setMaxSlope(btRadians(45.0));
+}
+
+btKinematicCharacterBatch::~btKinematicCharacterBatch()
+{
+}
+
+int btKinematicCharacterBatch::addCharacter(btPairCachingGhostObject* ghostObject, btConvexShape* convexShape)
+{
+	CharacterState state;
+	state.m_walkDirection.setValue(0,0,0);
+	state.m_normalizedDirection.setValue(0,0,0);
+	state.m_jumpAxis = m_up;
+	state.m_position = ghostObject->getWorldTransform().getOrigin();
+	state.m_verticalVelocity = 0;
+	state.m_verticalOffset = 0;
+	state.m_jumpSpeed = m_jumpSpeed;
+	state.m_currentStepOffset = 0;
+	state.m_velocityTimeInterval = 0;
+	state.m_useWalkDirection = true;
+	state.m_wasOnGround = false;
+	state.m_wasJumping = false;
+	state.m_touchingContact = false;
+
+	m_ghostObjects.push_back(ghostObject);
+	m_convexShapes.push_back(convexShape);
+	m_states.push_back(state);
+	return m_states.size()-1;
+}
+
+void btKinematicCharacterBatch::removeCharacter(int index)
+{
+	int last = m_states.size()-1;
+	m_ghostObjects.swap(index, last);
+	m_convexShapes.swap(index, last);
+	m_states.swap(index, last);
+	m_ghostObjects.pop_back();
+	m_convexShapes.pop_back();
+	m_states.pop_back();
+}
+
+void btKinematicCharacterBatch::setUp(const btVector3& up)
+{
+	if (up.length2() > 0)
+		m_up = up.normalized();
+}
+
+void btKinematicCharacterBatch::setMaxSlope(btScalar slopeRadians)
+{
+	m_maxSlopeRadians = slopeRadians;
+	m_maxSlopeCosine = btCos(slopeRadians);
+}
+
+void btKinematicCharacterBatch::setWalkDirection(int index, const btVector3& walkDirection)
+{
+	CharacterState& state = m_states[index];
+	state.m_useWalkDirection = true;
+	state.m_walkDirection = walkDirection;
+	state.m_normalizedDirection = walkDirection.length() > SIMD_EPSILON ? walkDirection.normalized() : btVector3(0,0,0);
+}
+
+void btKinematicCharacterBatch::setVelocityForTimeInterval(int index, const btVector3& velocity, btScalar timeInterval)
+{
+	CharacterState& state = m_states[index];
+	state.m_useWalkDirection = false;
+	state.m_walkDirection = velocity;
+	state.m_normalizedDirection = velocity.length() > SIMD_EPSILON ? velocity.normalized() : btVector3(0,0,0);
+	state.m_velocityTimeInterval += timeInterval;
+}
+
+void btKinematicCharacterBatch::jump(int index, const btVector3& v)
+{
+	CharacterState& state = m_states[index];
+	state.m_jumpSpeed = v.length2() == 0 ? m_jumpSpeed : v.length();
+	state.m_verticalVelocity = state.m_jumpSpeed;
+	state.m_wasJumping = true;
+	state.m_jumpAxis = v.length2() == 0 ? m_up : v.normalized();
+}
+
+bool btKinematicCharacterBatch::onGround(int index) const
+{
+	const CharacterState& state = m_states[index];
+	return (btFabs(state.m_verticalVelocity) < SIMD_EPSILON) && (btFabs(state.m_verticalOffset) < SIMD_EPSILON);
+}
+
+void btKinematicCharacterBatch::warp(int index, const btVector3& origin)
+{
+	btTransform xform;
+	xform.setIdentity();
+	xform.setOrigin(origin);
+	m_ghostObjects[index]->setWorldTransform(xform);
+	m_states[index].m_position = origin;
+}
+
+bool btKinematicCharacterBatch::needsCollision(const btCollisionObject* body0, const btCollisionObject* body1) const
+{
+	bool collides = (body0->getBroadphaseHandle()->m_collisionFilterGroup & body1->getBroadphaseHandle()->m_collisionFilterMask) != 0;
+	collides = collides && (body1->getBroadphaseHandle()->m_collisionFilterGroup & body0->getBroadphaseHandle()->m_collisionFilterMask);
+	return collides;
+}
+
+void btKinematicCharacterBatch::groupCharacters(btScalar dt)
+{
+	//the box around everything a character can sweep this step: the walk move in any direction,
+	//the step up and the double step down of stepDown, or a fall
+	btAlignedObjectArray<btCharacterCellEntry> entries;
+	entries.resize(m_states.size());
+	btAlignedObjectArray<btVector3> sweepAabbs;
+	sweepAabbs.resize(m_states.size()*2);
+	btScalar invCellSize = btScalar(1.)/m_cellSize;
+	for (int i=0;i<m_states.size();i++)
+	{
+		const CharacterState& state = m_states[i];
+		btScalar walk = state.m_useWalkDirection ? state.m_walkDirection.length() : state.m_walkDirection.length() * btMin(dt, btMax(state.m_velocityTimeInterval, btScalar(0.)));
+		btScalar vertical = (btFabs(state.m_verticalVelocity) + m_gravity * dt) * dt;
+		btScalar reach = walk + btScalar(5.) * m_stepHeight + btScalar(2.) * vertical + m_maxPenetrationDepth;
+		btVector3 aabbMin, aabbMax;
+		m_convexShapes[i]->getAabb(m_ghostObjects[i]->getWorldTransform(), aabbMin, aabbMax);
+		sweepAabbs[i*2] = aabbMin - btVector3(reach, reach, reach);
+		sweepAabbs[i*2+1] = aabbMax + btVector3(reach, reach, reach);
+
+		btVector3 center = (aabbMin + aabbMax) * btScalar(0.5) * invCellSize;
+		btCharacterCellEntry& entry = entries[i];
+		for (int k=0;k<3;k++)
+		{
+			entry.m_cell[k] = int(floor(center[k]));
+		}
+		entry.m_character = i;
+	}
+	entries.quickSort(btCharacterCellSortPredicate());
+
+	m_characterGroups.resize(m_states.size());
+	m_groupAabbs.resize(0);
+	int numGroups = 0;
+	for (int i=0;i<entries.size();i++)
+	{
+		const btCharacterCellEntry& entry = entries[i];
+		int character = entry.m_character;
+		bool newCell = i==0 || entries[i-1].m_cell[0] != entry.m_cell[0] || entries[i-1].m_cell[1] != entry.m_cell[1] || entries[i-1].m_cell[2] != entry.m_cell[2];
+		if (newCell)
+		{
+			m_groupAabbs.push_back(sweepAabbs[character*2]);
+			m_groupAabbs.push_back(sweepAabbs[character*2+1]);
+			numGroups++;
+		}
+		else
+		{
+			m_groupAabbs[numGroups*2-2].setMin(sweepAabbs[character*2]);
+			m_groupAabbs[numGroups*2-1].setMax(sweepAabbs[character*2+1]);
+		}
+		m_characterGroups[character] = numGroups-1;
+	}
+	if (m_groupCandidates.size() < numGroups)
+	{
+		m_groupCandidates.resize(numGroups);
+	}
+}
+
+void btKinematicCharacterBatch::sweep(int index, const btVector3& from, const btVector3& to, btCollisionWorld::ConvexResultCallback& callback, btScalar allowedPenetration) const
+{
+	//like btGhostObject::convexSweepTest, but over the objects found for the character's cell
+	const btConvexShape* castShape = m_convexShapes[index];
+	btTransform convexFromTrans = m_ghostObjects[index]->getWorldTransform();
+	btTransform convexToTrans = convexFromTrans;
+	convexFromTrans.setOrigin(from);
+	convexToTrans.setOrigin(to);
+	btVector3 castShapeAabbMin, castShapeAabbMax;
+	{
+		btVector3 linVel, angVel;
+		btTransformUtil::calculateVelocity (convexFromTrans, convexToTrans, 1.0, linVel, angVel);
+		btTransform R;
+		R.setIdentity ();
+		R.setRotation (convexFromTrans.getRotation());
+		castShape->calculateTemporalAabb (R, linVel, angVel, 1.0, castShapeAabbMin, castShapeAabbMax);
+	}
+
+	const btAlignedObjectArray<btCollisionObject*>& candidates = m_groupCandidates[m_characterGroups[index]];
+	for (int i=0;i<candidates.size();i++)
+	{
+		btCollisionObject* collisionObject = candidates[i];
+		if (callback.needsCollision(collisionObject->getBroadphaseHandle()))
+		{
+			btVector3 collisionObjectAabbMin,collisionObjectAabbMax;
+			collisionObject->getCollisionShape()->getAabb(collisionObject->getWorldTransform(),collisionObjectAabbMin,collisionObjectAabbMax);
+			AabbExpand (collisionObjectAabbMin, collisionObjectAabbMax, castShapeAabbMin, castShapeAabbMax);
+			btScalar hitLambda = btScalar(1.);
+			btVector3 hitNormal;
+			if (btRayAabb(from,to,collisionObjectAabbMin,collisionObjectAabbMax,hitLambda,hitNormal))
+			{
+				btCollisionWorld::objectQuerySingle(castShape, convexFromTrans,convexToTrans,
+					collisionObject,
+					collisionObject->getCollisionShape(),
+					collisionObject->getWorldTransform(),
+					callback,
+					allowedPenetration);
+			}
+		}
+	}
+}
+
+bool btKinematicCharacterBatch::recoverFromPenetration(int index, btCollisionWorld* collisionWorld)
+{
+	//see btKinematicCharacterController::recoverFromPenetration
+	btPairCachingGhostObject* ghostObject = m_ghostObjects[index];
+	btVector3 minAabb, maxAabb;
+	m_convexShapes[index]->getAabb(ghostObject->getWorldTransform(), minAabb,maxAabb);
+	collisionWorld->getBroadphase()->setAabb(ghostObject->getBroadphaseHandle(),
+						 minAabb,
+						 maxAabb,
+						 collisionWorld->getDispatcher());
+
+	bool penetration = false;
+
+	collisionWorld->getDispatcher()->dispatchAllCollisionPairs(ghostObject->getOverlappingPairCache(), collisionWorld->getDispatchInfo(), collisionWorld->getDispatcher());
+
+	btVector3 currentPosition = ghostObject->getWorldTransform().getOrigin();
+
+	for (int i = 0; i < ghostObject->getOverlappingPairCache()->getNumOverlappingPairs(); i++)
+	{
+		m_manifoldArray.resize(0);
+
+		btBroadphasePair* collisionPair = &ghostObject->getOverlappingPairCache()->getOverlappingPairArray()[i];
+
+		btCollisionObject* obj0 = static_cast<btCollisionObject*>(collisionPair->m_pProxy0->m_clientObject);
+		btCollisionObject* obj1 = static_cast<btCollisionObject*>(collisionPair->m_pProxy1->m_clientObject);
+
+		if ((obj0 && !obj0->hasContactResponse()) || (obj1 && !obj1->hasContactResponse()))
+			continue;
+
+		if (!needsCollision(obj0, obj1))
+			continue;
+
+		if (collisionPair->m_algorithm)
+			collisionPair->m_algorithm->getAllContactManifolds(m_manifoldArray);
+
+		for (int j=0;j<m_manifoldArray.size();j++)
+		{
+			btPersistentManifold* manifold = m_manifoldArray[j];
+			btScalar directionSign = manifold->getBody0() == ghostObject ? btScalar(-1.0) : btScalar(1.0);
+			for (int p=0;p<manifold->getNumContacts();p++)
+			{
+				const btManifoldPoint&pt = manifold->getContactPoint(p);
+
+				btScalar dist = pt.getDistance();
+
+				if (dist < -m_maxPenetrationDepth)
+				{
+					currentPosition += pt.m_normalWorldOnB * directionSign * dist * btScalar(0.2);
+					penetration = true;
+				}
+			}
+		}
+	}
+	btTransform newTrans = ghostObject->getWorldTransform();
+	newTrans.setOrigin(currentPosition);
+	ghostObject->setWorldTransform(newTrans);
+	return penetration;
+}
+
+void btKinematicCharacterBatch::stepForwardAndStrafe(int index, btVector3& currentPosition, btVector3& targetPosition, const btVector3& walkMove, const CharacterState& state, btScalar allowedPenetration) const
+{
+	//see btKinematicCharacterController::stepForwardAndStrafe. The shape is shared with the other threads,
+	//so its margin isn't raised for this sweep; capsules and boxes ignore that anyway
+	const btCollisionObject* ghostObject = m_ghostObjects[index];
+	targetPosition = currentPosition + walkMove;
+
+	btScalar fraction = 1.0;
+	int maxIter = 10;
+
+	while (fraction > btScalar(0.01) && maxIter-- > 0)
+	{
+		btVector3 sweepDirNegative(currentPosition - targetPosition);
+
+		btCharacterBatchConvexResultCallback callback (ghostObject, sweepDirNegative, btScalar(0.0));
+		callback.m_collisionFilterGroup = ghostObject->getBroadphaseHandle()->m_collisionFilterGroup;
+		callback.m_collisionFilterMask = ghostObject->getBroadphaseHandle()->m_collisionFilterMask;
+
+		if (!(currentPosition == targetPosition))
+		{
+			sweep(index, currentPosition, targetPosition, callback, allowedPenetration);
+		}
+
+		fraction -= callback.m_closestHitFraction;
+
+		if (callback.hasHit() && ghostObject->hasContactResponse() && needsCollision(ghostObject, callback.m_hitCollisionObject))
+		{
+			//slide along the hit surface, see btKinematicCharacterController::updateTargetPositionBasedOnCollision
+			btVector3 movementDirection = targetPosition - currentPosition;
+			btScalar movementLength = movementDirection.length();
+			if (movementLength>SIMD_EPSILON)
+			{
+				movementDirection.normalize();
+				const btVector3& hitNormal = callback.m_hitNormalWorld;
+				btVector3 reflectDir = movementDirection - (btScalar(2.0) * movementDirection.dot(hitNormal)) * hitNormal;
+				reflectDir.normalize();
+				btVector3 perpindicularDir = reflectDir - hitNormal * reflectDir.dot(hitNormal);
+				targetPosition = currentPosition + perpindicularDir * movementLength;
+			}
+
+			btVector3 currentDir = targetPosition - currentPosition;
+			if (currentDir.length2() > SIMD_EPSILON)
+			{
+				currentDir.normalize();
+				/* See Quake2: "If velocity is against original velocity, stop ead to avoid tiny oscilations in sloping corners." */
+				if (currentDir.dot(state.m_normalizedDirection) <= btScalar(0.0))
+				{
+					break;
+				}
+			} else
+			{
+				break;
+			}
+		}
+		else
+		{
+			currentPosition = targetPosition;
+		}
+	}
+}
+
+void btKinematicCharacterBatch::stepDown(int index, btVector3& currentPosition, btVector3& targetPosition, CharacterState& state, btScalar dt, btScalar allowedPenetration) const
+{
+	//see btKinematicCharacterController::stepDown
+	const btCollisionObject* ghostObject = m_ghostObjects[index];
+	bool runonce = false;
+
+	btVector3 orig_position = targetPosition;
+
+	btScalar downVelocity = (state.m_verticalVelocity<0.f?-state.m_verticalVelocity:0.f) * dt;
+
+	if (state.m_verticalVelocity > 0.0)
+		return;
+
+	if(downVelocity > 0.0 && downVelocity > m_fallSpeed
+		&& (state.m_wasOnGround || !state.m_wasJumping))
+		downVelocity = m_fallSpeed;
+
+	btVector3 step_drop = m_up * (state.m_currentStepOffset + downVelocity);
+	targetPosition -= step_drop;
+
+	btCharacterBatchConvexResultCallback callback(ghostObject, m_up, m_maxSlopeCosine);
+	callback.m_collisionFilterGroup = ghostObject->getBroadphaseHandle()->m_collisionFilterGroup;
+	callback.m_collisionFilterMask = ghostObject->getBroadphaseHandle()->m_collisionFilterMask;
+
+	btCharacterBatchConvexResultCallback callback2(ghostObject, m_up, m_maxSlopeCosine);
+	callback2.m_collisionFilterGroup = ghostObject->getBroadphaseHandle()->m_collisionFilterGroup;
+	callback2.m_collisionFilterMask = ghostObject->getBroadphaseHandle()->m_collisionFilterMask;
+
+	while (1)
+	{
+		sweep(index, currentPosition, targetPosition, callback, allowedPenetration);
+
+		if (!callback.hasHit() && ghostObject->hasContactResponse())
+		{
+			//test a double fall height, to see if the character should interpolate it's fall (large) or not (small)
+			sweep(index, currentPosition, targetPosition - step_drop, callback2, allowedPenetration);
+		}
+
+		btScalar downVelocity2 = (state.m_verticalVelocity<0.f?-state.m_verticalVelocity:0.f) * dt;
+		bool has_hit = callback2.hasHit() && ghostObject->hasContactResponse() && needsCollision(ghostObject, callback2.m_hitCollisionObject);
+
+		btScalar stepHeight = 0.0f;
+		if (state.m_verticalVelocity < 0.0)
+			stepHeight = m_stepHeight;
+
+		if (downVelocity2 > 0.0 && downVelocity2 < stepHeight && has_hit == true && runonce == false
+					&& (state.m_wasOnGround || !state.m_wasJumping))
+		{
+			//redo the velocity calculation when falling a small amount, for fast stairs motion
+			targetPosition = orig_position;
+			downVelocity = stepHeight;
+
+			step_drop = m_up * (state.m_currentStepOffset + downVelocity);
+			targetPosition -= step_drop;
+			runonce = true;
+			continue; //re-run previous tests
+		}
+		break;
+	}
+
+	if ((ghostObject->hasContactResponse() && (callback.hasHit() && needsCollision(ghostObject, callback.m_hitCollisionObject))) || runonce == true)
+	{
+		// we dropped a fraction of the height -> hit floor
+		currentPosition.setInterpolate3 (currentPosition, targetPosition, callback.m_closestHitFraction);
+
+		state.m_verticalVelocity = 0.0;
+		state.m_verticalOffset = 0.0;
+		state.m_wasJumping = false;
+	} else {
+		// we dropped the full height
+		currentPosition = targetPosition;
+	}
+}
+
+btKinematicCharacterBatch::StepResult btKinematicCharacterBatch::stepCharacter(int index, btCollisionWorld* collisionWorld, btScalar dt, CharacterState& stateOut, bool allowRecovery)
+{
+	btPairCachingGhostObject* ghostObject = m_ghostObjects[index];
+	btScalar allowedPenetration = collisionWorld->getDispatchInfo().m_allowedCcdPenetration;
+	CharacterState state = stateOut;
+	btVector3 currentPosition = ghostObject->getWorldTransform().getOrigin();
+	btVector3 targetPosition = currentPosition;
+	state.m_position = currentPosition;
+
+	// quick check...
+	if (!state.m_useWalkDirection && (state.m_velocityTimeInterval <= 0.0))
+	{
+		stateOut = state;
+		return STEP_NO_MOTION;
+	}
+
+	state.m_wasOnGround = (btFabs(state.m_verticalVelocity) < SIMD_EPSILON) && (btFabs(state.m_verticalOffset) < SIMD_EPSILON);
+
+	// Update fall velocity.
+	state.m_verticalVelocity -= m_gravity * dt;
+	if (state.m_verticalVelocity > 0.0 && state.m_verticalVelocity > state.m_jumpSpeed)
+	{
+		state.m_verticalVelocity = state.m_jumpSpeed;
+	}
+	if (state.m_verticalVelocity < 0.0 && btFabs(state.m_verticalVelocity) > btFabs(m_fallSpeed))
+	{
+		state.m_verticalVelocity = -btFabs(m_fallSpeed);
+	}
+	state.m_verticalOffset = state.m_verticalVelocity * dt;
+
+	// phase 1: up, see btKinematicCharacterController::stepUp
+	{
+		btScalar stepHeight = 0.0f;
+		if (state.m_verticalVelocity < 0.0)
+			stepHeight = m_stepHeight;
+
+		btVector3 startPosition = currentPosition;
+		targetPosition = currentPosition + m_up * (stepHeight) + state.m_jumpAxis * ((state.m_verticalOffset > 0.f ? state.m_verticalOffset : 0.f));
+		currentPosition = targetPosition;
+
+		btCharacterBatchConvexResultCallback callback(ghostObject, -m_up, m_maxSlopeCosine);
+		callback.m_collisionFilterGroup = ghostObject->getBroadphaseHandle()->m_collisionFilterGroup;
+		callback.m_collisionFilterMask = ghostObject->getBroadphaseHandle()->m_collisionFilterMask;
+		sweep(index, startPosition, targetPosition, callback, allowedPenetration);
+
+		if (callback.hasHit() && ghostObject->hasContactResponse() && needsCollision(ghostObject, callback.m_hitCollisionObject))
+		{
+			//a ceiling: the character is moved into it and pushed out before it goes on
+			if (!allowRecovery)
+				return STEP_NEEDS_RECOVERY;
+
+			// Only modify the position if the hit was a slope and not a wall or ceiling.
+			if (callback.m_hitNormalWorld.dot(m_up) > 0.0)
+			{
+				// we moved up only a fraction of the step height
+				state.m_currentStepOffset = stepHeight * callback.m_closestHitFraction;
+			}
+
+			btTransform& xform = ghostObject->getWorldTransform();
+			xform.setOrigin(currentPosition);
+			ghostObject->setWorldTransform(xform);
+
+			// fix penetration if we hit a ceiling for example
+			int numPenetrationLoops = 0;
+			state.m_touchingContact = false;
+			while (recoverFromPenetration(index, collisionWorld))
+			{
+				numPenetrationLoops++;
+				state.m_touchingContact = true;
+				if (numPenetrationLoops > 4)
+				{
+					break;
+				}
+			}
+			targetPosition = ghostObject->getWorldTransform().getOrigin();
+			currentPosition = targetPosition;
+
+			if (state.m_verticalOffset > 0)
+			{
+				state.m_verticalOffset = 0.0;
+				state.m_verticalVelocity = 0.0;
+				state.m_currentStepOffset = m_stepHeight;
+			}
+		} else {
+			state.m_currentStepOffset = stepHeight;
+		}
+	}
+
+	// phase 2: forward and strafe
+	if (state.m_useWalkDirection) {
+		stepForwardAndStrafe(index, currentPosition, targetPosition, state.m_walkDirection, state, allowedPenetration);
+	} else {
+		// still have some time left for moving!
+		btScalar dtMoving =
+			(dt < state.m_velocityTimeInterval) ? dt : state.m_velocityTimeInterval;
+		state.m_velocityTimeInterval -= dt;
+
+		// how far will we move while we are moving?
+		btVector3 move = state.m_walkDirection * dtMoving;
+
+		stepForwardAndStrafe(index, currentPosition, targetPosition, move, state, allowedPenetration);
+	}
+
+	// phase 3: down
+	stepDown(index, currentPosition, targetPosition, state, dt, allowedPenetration);
+
+	state.m_position = currentPosition;
+	stateOut = state;
+	return STEP_MOVED;
+}
+
+void btKinematicCharacterBatch::applyStep(int index, btCollisionWorld* collisionWorld)
+{
+	CharacterState& state = m_states[index];
+	btPairCachingGhostObject* ghostObject = m_ghostObjects[index];
+	btTransform xform = ghostObject->getWorldTransform();
+	xform.setOrigin (state.m_position);
+	ghostObject->setWorldTransform (xform);
+
+	int numPenetrationLoops = 0;
+	state.m_touchingContact = false;
+	while (recoverFromPenetration(index, collisionWorld))
+	{
+		numPenetrationLoops++;
+		state.m_touchingContact = true;
+		if (numPenetrationLoops > 4)
+		{
+			break;
+		}
+	}
+	state.m_position = ghostObject->getWorldTransform().getOrigin();
+}
+
+void btKinematicCharacterBatch::updateAction(btCollisionWorld* collisionWorld, btScalar deltaTime)
+{
+	BT_PROFILE("btKinematicCharacterBatch::updateAction");
+	int numCharacters = m_states.size();
+	if (numCharacters == 0)
+		return;
+
+	groupCharacters(deltaTime);
+	{
+		BT_PROFILE("gatherCandidates");
+		btCharacterGatherLoop loop;
+		loop.m_broadphase = collisionWorld->getBroadphase();
+		loop.m_groupAabbs = &m_groupAabbs[0];
+		loop.m_groupCandidates = &m_groupCandidates[0];
+		btParallelForOrSerial(0, m_groupAabbs.size()/2, 1, loop);
+	}
+
+	m_stepResults.resize(numCharacters);
+	{
+		BT_PROFILE("stepCharacters");
+		btCharacterStepLoop loop;
+		loop.m_batch = this;
+		loop.m_collisionWorld = collisionWorld;
+		loop.m_states = &m_states[0];
+		loop.m_stepResults = &m_stepResults[0];
+		loop.m_timeStep = deltaTime;
+		btParallelForOrSerial(0, numCharacters, 16, loop);
+	}
+
+	//moving the ghost objects updates the broadphase, so this is done here, in character order
+	for (int i=0;i<numCharacters;i++)
+	{
+		switch (m_stepResults[i])
+		{
+		case STEP_NEEDS_RECOVERY:
+			stepCharacter(i, collisionWorld, deltaTime, m_states[i], true);
+			applyStep(i, collisionWorld);
+			break;
+		case STEP_MOVED:
+			applyStep(i, collisionWorld);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+void btKinematicCharacterBatch::debugDraw(btIDebugDraw* debugDrawer)
+{
+}
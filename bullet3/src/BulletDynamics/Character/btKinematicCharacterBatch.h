@@ -0,0 +1,231 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2008 Erwin Coumans  http://bulletphysics.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef BT_KINEMATIC_CHARACTER_BATCH_H
+#define BT_KINEMATIC_CHARACTER_BATCH_H
+
+#include "LinearMath/btVector3.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "BulletDynamics/Dynamics/btActionInterface.h"
+#include "BulletCollision/BroadphaseCollision/btCollisionAlgorithm.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+
+class btConvexShape;
+class btPairCachingGhostObject;
+
+///btKinematicCharacterBatch moves many characters like btKinematicCharacterController does, as one action.
+///The state of all characters is kept in contiguous arrays, instead of in one controller object per character.
+///Each step, the characters are grouped by grid cell, and one broadphase query per cell collects the objects that the
+///characters in it can sweep against. The sweeps of all characters then run in parallel with btParallelFor, and the
+///ghost objects are moved and recovered from penetration on the calling thread, in character order.
+///While sweeping, a character sees the other characters where they were at the start of the step.
+///All characters share the up axis, gravity, step height and the slope and speed limits.
+ATTRIBUTE_ALIGNED16(class) btKinematicCharacterBatch : public btActionInterface
+{
+public:
+
+	///the stepping state of one character, see btKinematicCharacterController for the meaning of the fields
+	ATTRIBUTE_ALIGNED16(struct) CharacterState
+	{
+		btVector3	m_walkDirection;
+		btVector3	m_normalizedDirection;
+		btVector3	m_jumpAxis;
+		btVector3	m_position;
+		btScalar	m_verticalVelocity;
+		btScalar	m_verticalOffset;
+		btScalar	m_jumpSpeed;
+		btScalar	m_currentStepOffset;
+		btScalar	m_velocityTimeInterval;
+		bool		m_useWalkDirection;
+		bool		m_wasOnGround;
+		bool		m_wasJumping;
+		bool		m_touchingContact;
+	};
+
+protected:
+
+	btAlignedObjectArray<btPairCachingGhostObject*>	m_ghostObjects;
+	btAlignedObjectArray<btConvexShape*>	m_convexShapes;
+	btAlignedObjectArray<CharacterState>	m_states;
+
+	///per step: the cell group of each character, the objects each group may hit, and how each character's sweeps ended
+	btAlignedObjectArray<int>	m_characterGroups;
+	btAlignedObjectArray<btAlignedObjectArray<btCollisionObject*> >	m_groupCandidates;
+	btAlignedObjectArray<btVector3>	m_groupAabbs;
+	btAlignedObjectArray<char>	m_stepResults;
+
+	btManifoldArray	m_manifoldArray;
+
+	btVector3	m_up;
+	btScalar	m_gravity;
+	btScalar	m_stepHeight;
+	btScalar	m_fallSpeed;
+	btScalar	m_jumpSpeed;
+	btScalar	m_maxSlopeRadians;
+	btScalar	m_maxSlopeCosine;
+	btScalar	m_maxPenetrationDepth;
+	btScalar	m_cellSize;
+
+	void	groupCharacters(btScalar dt);
+
+	bool	needsCollision(const btCollisionObject* body0, const btCollisionObject* body1) const;
+
+	bool	recoverFromPenetration(int index, btCollisionWorld* collisionWorld);
+
+	void	sweep(int index, const btVector3& from, const btVector3& to, btCollisionWorld::ConvexResultCallback& callback, btScalar allowedPenetration) const;
+
+	void	stepForwardAndStrafe(int index, btVector3& currentPosition, btVector3& targetPosition, const btVector3& walkMove, const CharacterState& state, btScalar allowedPenetration) const;
+
+	void	stepDown(int index, btVector3& currentPosition, btVector3& targetPosition, CharacterState& state, btScalar dt, btScalar allowedPenetration) const;
+
+public:
+
+	///the results of stepCharacter
+	enum StepResult
+	{
+		STEP_NO_MOTION,
+		STEP_MOVED,
+		STEP_NEEDS_RECOVERY
+	};
+
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btKinematicCharacterBatch(btScalar stepHeight, const btVector3& up = btVector3(0,1,0));
+
+	virtual ~btKinematicCharacterBatch();
+
+	///the ghost object is added to the world by the caller, like for btKinematicCharacterController. Returns the character index
+	int	addCharacter(btPairCachingGhostObject* ghostObject, btConvexShape* convexShape);
+
+	///the last character takes the index of the removed one
+	void	removeCharacter(int index);
+
+	int	getNumCharacters() const
+	{
+		return m_states.size();
+	}
+
+	btPairCachingGhostObject*	getGhostObject(int index)
+	{
+		return m_ghostObjects[index];
+	}
+
+	const CharacterState&	getCharacterState(int index) const
+	{
+		return m_states[index];
+	}
+
+	///btActionInterface interface
+	virtual void	updateAction(btCollisionWorld* collisionWorld, btScalar deltaTime);
+
+	///btActionInterface interface
+	virtual void	debugDraw(btIDebugDraw* debugDrawer);
+
+	///sweeps one character from its ghost object's transform into state, see btKinematicCharacterController::playerStep.
+	///It only reads the world, unless allowRecovery is set; without it, a step that hits a ceiling returns STEP_NEEDS_RECOVERY
+	///and leaves state as it was
+	StepResult	stepCharacter(int index, btCollisionWorld* collisionWorld, btScalar dt, CharacterState& state, bool allowRecovery);
+
+	///moves the ghost object to the stepped position and recovers it from penetration
+	void	applyStep(int index, btCollisionWorld* collisionWorld);
+
+	///the amount to move each step, see btKinematicCharacterController::setWalkDirection
+	void	setWalkDirection(int index, const btVector3& walkDirection);
+
+	///see btKinematicCharacterController::setVelocityForTimeInterval
+	void	setVelocityForTimeInterval(int index, const btVector3& velocity, btScalar timeInterval);
+
+	void	jump(int index, const btVector3& v = btVector3(0, 0, 0));
+
+	bool	onGround(int index) const;
+
+	bool	canJump(int index) const
+	{
+		return onGround(index);
+	}
+
+	void	warp(int index, const btVector3& origin);
+
+	void	setUp(const btVector3& up);
+	const btVector3&	getUp() const
+	{
+		return m_up;
+	}
+
+	void	setGravity(btScalar gravity)
+	{
+		m_gravity = gravity;
+	}
+	btScalar	getGravity() const
+	{
+		return m_gravity;
+	}
+
+	void	setStepHeight(btScalar h)
+	{
+		m_stepHeight = h;
+	}
+	btScalar	getStepHeight() const
+	{
+		return m_stepHeight;
+	}
+
+	void	setFallSpeed(btScalar fallSpeed)
+	{
+		m_fallSpeed = fallSpeed;
+	}
+	btScalar	getFallSpeed() const
+	{
+		return m_fallSpeed;
+	}
+
+	///the speed of jumps without a jump vector
+	void	setJumpSpeed(btScalar jumpSpeed)
+	{
+		m_jumpSpeed = jumpSpeed;
+	}
+	btScalar	getJumpSpeed() const
+	{
+		return m_jumpSpeed;
+	}
+
+	void	setMaxSlope(btScalar slopeRadians);
+	btScalar	getMaxSlope() const
+	{
+		return m_maxSlopeRadians;
+	}
+
+	void	setMaxPenetrationDepth(btScalar d)
+	{
+		m_maxPenetrationDepth = d;
+	}
+	btScalar	getMaxPenetrationDepth() const
+	{
+		return m_maxPenetrationDepth;
+	}
+
+	///characters in the same cell share one broadphase query per step
+	void	setCellSize(btScalar cellSize)
+	{
+		m_cellSize = cellSize;
+	}
+	btScalar	getCellSize() const
+	{
+		return m_cellSize;
+	}
+};
+
+#endif //BT_KINEMATIC_CHARACTER_BATCH_H
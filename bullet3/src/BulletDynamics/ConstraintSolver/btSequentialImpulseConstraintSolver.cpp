@@ -752,6 +752,17 @@ int	btSequentialImpulseConstraintSolver::getOrInitSolverBody(btCollisionObject&
                 initSolverBody( &solverBody, &body, timeStep );
                 body.setCompanionId( solverBodyId );
             }
+            else
+            {
+                // other collision objects, like the ghost objects of characters, are fixed for the solver
+                if ( m_fixedBodyId < 0 )
+                {
+                    m_fixedBodyId = m_tmpSolverBodyPool.size();
+                    btSolverBody& fixedBody = m_tmpSolverBodyPool.expand();
+                    initSolverBody( &fixedBody, 0, timeStep );
+                }
+                solverBodyId = m_fixedBodyId;
+            }
         }
     }
     else if (body.isKinematicObject())
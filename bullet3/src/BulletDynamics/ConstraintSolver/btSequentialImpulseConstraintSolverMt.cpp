@@ -17,6 +17,7 @@ subject to the following restrictions:
 #include "btSequentialImpulseConstraintSolverMt.h"
 
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btFrameArena.h"
 
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
 
@@ -38,6 +39,8 @@ btSequentialImpulseConstraintSolverMt::btSequentialImpulseConstraintSolverMt()
     m_numFrictionDirections = 1;
     m_useBatching = false;
     m_useObsoleteJointConstraints = false;
+    m_useRowGroups = false;
+    m_rowGroupsUpdatePool = false;
 }
 
 
@@ -261,12 +264,14 @@ struct SetupContactConstraintsLoop : public btIParallelForBody
     btSequentialImpulseConstraintSolverMt* m_solver;
     const btBatchedConstraints* m_bc;
     const btContactSolverInfo* m_infoGlobal;
+    bool m_fillRowGroups;
 
-    SetupContactConstraintsLoop( btSequentialImpulseConstraintSolverMt* solver, const btBatchedConstraints* bc, const btContactSolverInfo& infoGlobal )
+    SetupContactConstraintsLoop( btSequentialImpulseConstraintSolverMt* solver, const btBatchedConstraints* bc, const btContactSolverInfo& infoGlobal, bool fillRowGroups )
     {
         m_solver = solver;
         m_bc = bc;
         m_infoGlobal = &infoGlobal;
+        m_fillRowGroups = fillRowGroups;
     }
     void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
     {
@@ -274,10 +279,23 @@ struct SetupContactConstraintsLoop : public btIParallelForBody
         for ( int iBatch = iBegin; iBatch < iEnd; ++iBatch )
         {
             const btBatchedConstraints::Range& batch = m_bc->m_batches[ iBatch ];
+            if ( m_fillRowGroups )
+            {
+                m_solver->internalClearRowGroups( iBatch );
+            }
             for (int i = batch.begin; i < batch.end; ++i)
             {
                 int iContact = m_bc->m_constraintIndices[i];
                 m_solver->internalSetupContactConstraints( iContact, *m_infoGlobal );
+                if ( m_fillRowGroups )
+                {
+                    // while the rows are still in cache
+                    m_solver->internalFillRowGroupLanes( iBatch, i );
+                }
+            }
+            if ( m_fillRowGroups )
+            {
+                m_solver->internalClearUnusedRowGroupLanes( iBatch );
             }
         }
     }
@@ -290,7 +308,7 @@ void btSequentialImpulseConstraintSolverMt::setupAllContactConstraints(const btC
     if ( m_useBatching )
     {
         const btBatchedConstraints& batchedCons = m_batchedContactConstraints;
-        SetupContactConstraintsLoop loop( this, &batchedCons, infoGlobal );
+        SetupContactConstraintsLoop loop( this, &batchedCons, infoGlobal, m_useRowGroups );
         for ( int iiPhase = 0; iiPhase < batchedCons.m_phases.size(); ++iiPhase )
         {
             int iPhase = batchedCons.m_phaseOrder[ iiPhase ];
@@ -535,7 +553,9 @@ struct AllocContactConstraintsLoop : public btIParallelForBody
 void btSequentialImpulseConstraintSolverMt::allocAllContactConstraints(btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal)
 {
     BT_PROFILE( "allocAllContactConstraints" );
+    btFrameArenaScope scratch( m_frameArenas.getArena() );
     btAlignedObjectArray<btContactManifoldCachedInfo> cachedInfoArray; // = m_manifoldCachedInfoArray;
+    scratch.initializeArray( cachedInfoArray, numManifolds );
     cachedInfoArray.resizeNoInitialize( numManifolds );
     if (/* DISABLES CODE */ (false))
     {
@@ -613,6 +633,10 @@ void btSequentialImpulseConstraintSolverMt::convertContacts(btPersistentManifold
         if ( m_useBatching )
         {
             setupBatchedContactConstraints();
+            if ( m_useRowGroups )
+            {
+                setupContactRowGroups();
+            }
         }
         setupAllContactConstraints( infoGlobal );
     }
@@ -735,7 +759,9 @@ void btSequentialImpulseConstraintSolverMt::convertJoints(btTypedConstraint** co
     }
 
 	int totalNumRows = 0;
+    btFrameArenaScope scratch( m_frameArenas.getArena() );
     btAlignedObjectArray<JointParams> jointParamsArray;
+    scratch.initializeArray( jointParamsArray, numConstraints );
     jointParamsArray.resizeNoInitialize(numConstraints);
 
 	//calculate the total number of contraint rows
@@ -872,6 +898,8 @@ btScalar btSequentialImpulseConstraintSolverMt::solveGroupCacheFriendlySetup(
      btIDebugDraw* debugDrawer
      )
 {
+    // the scratch memory of the previous setup is released, the arenas that overflowed are consolidated
+    m_frameArenas.reset();
     m_numFrictionDirections = (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS) ? 2 : 1;
     m_useBatching = false;
     if ( numManifolds >= s_minimumContactManifoldsForBatching &&
@@ -882,6 +910,11 @@ btScalar btSequentialImpulseConstraintSolverMt::solveGroupCacheFriendlySetup(
         m_batchedContactConstraints.m_debugDrawer = debugDrawer;
         m_batchedJointConstraints.m_debugDrawer = debugDrawer;
     }
+    // row groups depend on the order of the constraints within each batch, so they can't be used with randomized ordering
+    m_useRowGroups = m_useBatching &&
+        s_useSimdRowGroups &&
+        ( infoGlobal.m_solverMode & SOLVER_SIMD ) &&
+        !( infoGlobal.m_solverMode & ( SOLVER_RANDMIZE_ORDER | SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS ) );
     btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup( bodies,
                                                                        numBodies,
                                                                        manifoldPtr,
@@ -891,10 +924,297 @@ btScalar btSequentialImpulseConstraintSolverMt::solveGroupCacheFriendlySetup(
                                                                        infoGlobal,
                                                                        debugDrawer
                                                                        );
+    m_rowGroupsUpdatePool = m_tmpSolverContactRollingFrictionConstraintPool.size() > 0;
     return 0.0f;
 }
 
 
+// returns -1 for the fixed body and for static or kinematic bodies, which rows don't move and so can share within a row group
+static int getMovedSolverBodyId( const btAlignedObjectArray<btSolverBody>& solverBodyPool, int solverBodyId )
+{
+    const btRigidBody* body = solverBodyPool[ solverBodyId ].m_originalBody;
+    return ( body && body->getInvMass() != btScalar( 0 ) ) ? solverBodyId : -1;
+}
+
+
+void btSequentialImpulseConstraintSolverMt::internalAssignRowGroupSlots( int batchBegin, int batchEnd )
+{
+    typedef btSolverRowGroup Group;
+    // Each row goes in the first group of its batch that has a free lane and neither of its bodies, like a greedy edge
+    // coloring. Batches of the same phase share no dynamic bodies, so each can use the bit masks of its own bodies.
+    const int maxGroupsPerBatch = 64;
+    int groupNumLanes[ maxGroupsPerBatch ];
+    const btBatchedConstraints& batchedCons = m_batchedContactConstraints;
+    for ( int iBatch = batchBegin; iBatch < batchEnd; ++iBatch )
+    {
+        const btBatchedConstraints::Range& batch = batchedCons.m_batches[ iBatch ];
+        int numGroups = 0;
+        unsigned long long fullGroups = 0;
+        for ( int iiCons = batch.begin; iiCons < batch.end; ++iiCons )
+        {
+            const btSolverConstraint& c = m_tmpSolverContactConstraintPool[ batchedCons.m_constraintIndices[ iiCons ] ];
+            int bodyA = getMovedSolverBodyId( m_tmpSolverBodyPool, c.m_solverBodyIdA );
+            int bodyB = getMovedSolverBodyId( m_tmpSolverBodyPool, c.m_solverBodyIdB );
+            unsigned long long usedGroups = fullGroups;
+            usedGroups |= ( bodyA >= 0 ) ? m_rowGroupBodyMasks[ bodyA ] : 0;
+            usedGroups |= ( bodyB >= 0 ) ? m_rowGroupBodyMasks[ bodyB ] : 0;
+            int group = 0;
+            while ( group < maxGroupsPerBatch && ( usedGroups & ( 1ULL << group ) ) )
+            {
+                ++group;
+            }
+            int lane = 0;
+            if ( group < maxGroupsPerBatch )
+            {
+                unsigned long long groupBit = 1ULL << group;
+                if ( group == numGroups )
+                {
+                    groupNumLanes[ numGroups++ ] = 0;
+                }
+                lane = groupNumLanes[ group ]++;
+                if ( lane == Group::SIZE - 1 )
+                {
+                    fullGroups |= groupBit;
+                }
+                if ( bodyA >= 0 )
+                {
+                    m_rowGroupBodyMasks[ bodyA ] |= groupBit;
+                }
+                if ( bodyB >= 0 )
+                {
+                    m_rowGroupBodyMasks[ bodyB ] |= groupBit;
+                }
+            }
+            else
+            {
+                // very large batch, the row gets a group of its own
+                group = numGroups++;
+            }
+            m_rowGroupSlots[ iiCons ] = group * Group::SIZE + lane;
+        }
+        for ( int iiCons = batch.begin; iiCons < batch.end; ++iiCons )
+        {
+            const btSolverConstraint& c = m_tmpSolverContactConstraintPool[ batchedCons.m_constraintIndices[ iiCons ] ];
+            m_rowGroupBodyMasks[ c.m_solverBodyIdA ] = 0;
+            m_rowGroupBodyMasks[ c.m_solverBodyIdB ] = 0;
+        }
+        // number of groups for now, the ranges are made by setupContactRowGroups
+        m_batchRowGroups[ iBatch ] = btBatchedConstraints::Range( 0, numGroups );
+    }
+}
+
+
+// unused lanes solve to a zero impulse on no body
+static void clearRowGroupLane( btSequentialImpulseConstraintSolverMt::btSolverRowGroup* group, int lane )
+{
+    for ( int i = 0; i < 3; ++i )
+    {
+        group->m_contactNormal1[ i ][ lane ] = 0;
+        group->m_relpos1CrossNormal[ i ][ lane ] = 0;
+        group->m_contactNormal2[ i ][ lane ] = 0;
+        group->m_relpos2CrossNormal[ i ][ lane ] = 0;
+        group->m_linearComponentA[ i ][ lane ] = 0;
+        group->m_linearComponentB[ i ][ lane ] = 0;
+        group->m_angularComponentA[ i ][ lane ] = 0;
+        group->m_angularComponentB[ i ][ lane ] = 0;
+    }
+    group->m_rhs[ lane ] = 0;
+    group->m_cfm[ lane ] = 0;
+    group->m_jacDiagABInv[ lane ] = 0;
+    group->m_lowerLimit[ lane ] = 0;
+    group->m_friction[ lane ] = 0;
+    group->m_constraintIndex[ lane ] = -1;
+    group->m_appliedImpulse[ lane ] = 0;
+    group->m_solverBodyIdA[ lane ] = -1;
+    group->m_solverBodyIdB[ lane ] = -1;
+}
+
+
+static void setRowGroupLane( btSequentialImpulseConstraintSolverMt::btSolverRowGroup* group,
+    int lane,
+    int constraintIndex,
+    const btSolverConstraint& c,
+    const btAlignedObjectArray<btSolverBody>& solverBodyPool,
+    int movedBodyIdA,
+    int movedBodyIdB
+    )
+{
+    const btSolverBody& bodyA = solverBodyPool[ c.m_solverBodyIdA ];
+    const btSolverBody& bodyB = solverBodyPool[ c.m_solverBodyIdB ];
+    // same impulse as btSolverBody::internalApplyImpulse
+    btVector3 linearComponentA = c.m_contactNormal1 * bodyA.m_invMass * bodyA.m_linearFactor;
+    btVector3 linearComponentB = c.m_contactNormal2 * bodyB.m_invMass * bodyB.m_linearFactor;
+    btVector3 angularComponentA = c.m_angularComponentA * bodyA.m_angularFactor;
+    btVector3 angularComponentB = c.m_angularComponentB * bodyB.m_angularFactor;
+    for ( int i = 0; i < 3; ++i )
+    {
+        group->m_contactNormal1[ i ][ lane ] = c.m_contactNormal1[ i ];
+        group->m_relpos1CrossNormal[ i ][ lane ] = c.m_relpos1CrossNormal[ i ];
+        group->m_contactNormal2[ i ][ lane ] = c.m_contactNormal2[ i ];
+        group->m_relpos2CrossNormal[ i ][ lane ] = c.m_relpos2CrossNormal[ i ];
+        group->m_linearComponentA[ i ][ lane ] = linearComponentA[ i ];
+        group->m_linearComponentB[ i ][ lane ] = linearComponentB[ i ];
+        group->m_angularComponentA[ i ][ lane ] = angularComponentA[ i ];
+        group->m_angularComponentB[ i ][ lane ] = angularComponentB[ i ];
+    }
+    group->m_rhs[ lane ] = c.m_rhs;
+    group->m_cfm[ lane ] = c.m_cfm;
+    group->m_jacDiagABInv[ lane ] = c.m_jacDiagABInv;
+    group->m_lowerLimit[ lane ] = c.m_lowerLimit;
+    group->m_friction[ lane ] = c.m_friction;
+    group->m_constraintIndex[ lane ] = constraintIndex;
+    group->m_appliedImpulse[ lane ] = c.m_appliedImpulse;
+    group->m_solverBodyIdA[ lane ] = movedBodyIdA;
+    group->m_solverBodyIdB[ lane ] = movedBodyIdB;
+}
+
+
+void btSequentialImpulseConstraintSolverMt::internalFillRowGroupLanes( int iBatch, int iiCons )
+{
+    typedef btSolverRowGroup Group;
+    int iContact = m_batchedContactConstraints.m_constraintIndices[ iiCons ];
+    int iGroup = m_batchRowGroups[ iBatch ].begin + m_rowGroupSlots[ iiCons ] / Group::SIZE;
+    int lane = m_rowGroupSlots[ iiCons ] % Group::SIZE;
+    const btSolverConstraint& contact = m_tmpSolverContactConstraintPool[ iContact ];
+    int bodyA = getMovedSolverBodyId( m_tmpSolverBodyPool, contact.m_solverBodyIdA );
+    int bodyB = getMovedSolverBodyId( m_tmpSolverBodyPool, contact.m_solverBodyIdB );
+    setRowGroupLane( &m_contactRowGroups[ iGroup ], lane, iContact, contact, m_tmpSolverBodyPool, bodyA, bodyB );
+    for ( int iDir = 0; iDir < m_numFrictionDirections; ++iDir )
+    {
+        int iFriction = iContact * m_numFrictionDirections + iDir;
+        const btSolverConstraint& friction = m_tmpSolverContactFrictionConstraintPool[ iFriction ];
+        btAssert( friction.m_frictionIndex == iContact );
+        btAssert( friction.m_solverBodyIdA == contact.m_solverBodyIdA );
+        btAssert( friction.m_solverBodyIdB == contact.m_solverBodyIdB );
+        setRowGroupLane( &m_frictionRowGroups[ iGroup * m_numFrictionDirections + iDir ], lane, iFriction, friction, m_tmpSolverBodyPool, bodyA, bodyB );
+    }
+}
+
+
+void btSequentialImpulseConstraintSolverMt::internalClearRowGroups( int iBatch )
+{
+    const btBatchedConstraints::Range& groups = m_batchRowGroups[ iBatch ];
+    for ( int iGroup = groups.begin; iGroup < groups.end; ++iGroup )
+    {
+        for ( int lane = 0; lane < btSolverRowGroup::SIZE; ++lane )
+        {
+            m_contactRowGroups[ iGroup ].m_constraintIndex[ lane ] = -1;
+        }
+    }
+}
+
+
+void btSequentialImpulseConstraintSolverMt::internalClearUnusedRowGroupLanes( int iBatch )
+{
+    const btBatchedConstraints::Range& groups = m_batchRowGroups[ iBatch ];
+    for ( int iGroup = groups.begin; iGroup < groups.end; ++iGroup )
+    {
+        for ( int lane = 0; lane < btSolverRowGroup::SIZE; ++lane )
+        {
+            if ( m_contactRowGroups[ iGroup ].m_constraintIndex[ lane ] < 0 )
+            {
+                clearRowGroupLane( &m_contactRowGroups[ iGroup ], lane );
+                for ( int iDir = 0; iDir < m_numFrictionDirections; ++iDir )
+                {
+                    clearRowGroupLane( &m_frictionRowGroups[ iGroup * m_numFrictionDirections + iDir ], lane );
+                }
+            }
+        }
+    }
+}
+
+
+struct AssignRowGroupSlotsLoop : public btIParallelForBody
+{
+    btSequentialImpulseConstraintSolverMt* m_solver;
+
+    AssignRowGroupSlotsLoop( btSequentialImpulseConstraintSolverMt* solver )
+    {
+        m_solver = solver;
+    }
+    void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        m_solver->internalAssignRowGroupSlots( iBegin, iEnd );
+    }
+};
+
+
+void btSequentialImpulseConstraintSolverMt::internalWriteBackRowGroupImpulses( int iBegin, int iEnd )
+{
+    for ( int iGroup = iBegin; iGroup < iEnd; ++iGroup )
+    {
+        const btSolverRowGroup& contactGroup = m_contactRowGroups[ iGroup ];
+        for ( int lane = 0; lane < btSolverRowGroup::SIZE && contactGroup.m_constraintIndex[ lane ] >= 0; ++lane )
+        {
+            m_tmpSolverContactConstraintPool[ contactGroup.m_constraintIndex[ lane ] ].m_appliedImpulse = contactGroup.m_appliedImpulse[ lane ];
+            for ( int iDir = 0; iDir < m_numFrictionDirections; ++iDir )
+            {
+                const btSolverRowGroup& frictionGroup = m_frictionRowGroups[ iGroup * m_numFrictionDirections + iDir ];
+                m_tmpSolverContactFrictionConstraintPool[ frictionGroup.m_constraintIndex[ lane ] ].m_appliedImpulse = frictionGroup.m_appliedImpulse[ lane ];
+            }
+        }
+    }
+}
+
+
+struct WriteBackRowGroupImpulsesLoop : public btIParallelForBody
+{
+    btSequentialImpulseConstraintSolverMt* m_solver;
+
+    WriteBackRowGroupImpulsesLoop( btSequentialImpulseConstraintSolverMt* solver )
+    {
+        m_solver = solver;
+    }
+    void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        m_solver->internalWriteBackRowGroupImpulses( iBegin, iEnd );
+    }
+};
+
+
+void btSequentialImpulseConstraintSolverMt::writeBackRowGroupImpulses()
+{
+    BT_PROFILE( "writeBackRowGroupImpulses" );
+    WriteBackRowGroupImpulsesLoop loop( this );
+    int grainSize = 100;
+    btParallelFor( 0, m_contactRowGroups.size(), grainSize, loop );
+}
+
+
+void btSequentialImpulseConstraintSolverMt::setupContactRowGroups()
+{
+    BT_PROFILE( "setupContactRowGroups" );
+    const btBatchedConstraints& batchedCons = m_batchedContactConstraints;
+    int numBatches = batchedCons.m_batches.size();
+    m_batchRowGroups.resizeNoInitialize( numBatches );
+    m_rowGroupSlots.resizeNoInitialize( batchedCons.m_constraintIndices.size() );
+    if ( m_rowGroupBodyMasks.size() != m_tmpSolverBodyPool.size() )
+    {
+        m_rowGroupBodyMasks.resize( 0 );
+        m_rowGroupBodyMasks.resize( m_tmpSolverBodyPool.size(), 0 );
+    }
+    {
+        // one phase at a time, since batches of different phases can share bodies
+        AssignRowGroupSlotsLoop loop( this );
+        for ( int iPhase = 0; iPhase < batchedCons.m_phases.size(); ++iPhase )
+        {
+            const btBatchedConstraints::Range& phase = batchedCons.m_phases[ iPhase ];
+            btParallelFor( phase.begin, phase.end, 1, loop );
+        }
+    }
+    int numGroups = 0;
+    for ( int iBatch = 0; iBatch < numBatches; ++iBatch )
+    {
+        btBatchedConstraints::Range& groups = m_batchRowGroups[ iBatch ];
+        groups.begin = numGroups;
+        numGroups += groups.end;
+        groups.end = numGroups;
+    }
+    m_contactRowGroups.resizeNoInitialize( numGroups );
+    m_frictionRowGroups.resizeNoInitialize( numGroups * m_numFrictionDirections );
+}
+
+
 btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactSplitPenetrationImpulseConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd )
 {
     btScalar leastSquaresResidual = 0.f;
@@ -1086,7 +1406,7 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactFrictionCo
             int iEnd = iBegin + m_numFrictionDirections;
             for ( int iFriction = iBegin; iFriction < iEnd; ++iFriction )
             {
-                btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[ iFriction++ ];
+                btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[ iFriction ];
                 btAssert( solveManifold.m_frictionIndex == iContact );
 
                 solveManifold.m_lowerLimit = -( solveManifold.m_friction*totalImpulse );
@@ -1103,6 +1423,287 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactFrictionCo
 }
 
 
+// Lanes of a btSolverRowGroup solved at once: 8 with AVX, 4 with SSE2, otherwise one at a time.
+// The body velocities are gathered with one unaligned load per body and transposed, see btSolveRowGroup.
+#if defined( __AVX__ ) && !defined( BT_USE_DOUBLE_PRECISION )
+#include <immintrin.h>
+
+struct btRowLanes
+{
+    enum { WIDTH = 8 };
+    typedef __m256 Lanes;
+
+    static Lanes load( const btScalar* p ) { return _mm256_loadu_ps( p ); }
+    static void store( btScalar* p, Lanes a ) { _mm256_storeu_ps( p, a ); }
+    static Lanes zero() { return _mm256_setzero_ps(); }
+    static Lanes add( Lanes a, Lanes b ) { return _mm256_add_ps( a, b ); }
+    static Lanes sub( Lanes a, Lanes b ) { return _mm256_sub_ps( a, b ); }
+    static Lanes mul( Lanes a, Lanes b ) { return _mm256_mul_ps( a, b ); }
+    static Lanes min( Lanes a, Lanes b ) { return _mm256_min_ps( a, b ); }
+    static Lanes max( Lanes a, Lanes b ) { return _mm256_max_ps( a, b ); }
+    static Lanes greaterThan( Lanes a, Lanes b ) { return _mm256_cmp_ps( a, b, _CMP_GT_OQ ); }
+    static Lanes select( Lanes mask, Lanes a, Lanes b ) { return _mm256_blendv_ps( b, a, mask ); }
+
+    static void gather( const btScalar* const* src, Lanes& x, Lanes& y, Lanes& z )
+    {
+        __m128 r0 = _mm_loadu_ps( src[ 0 ] ), r1 = _mm_loadu_ps( src[ 1 ] ), r2 = _mm_loadu_ps( src[ 2 ] ), r3 = _mm_loadu_ps( src[ 3 ] );
+        __m128 r4 = _mm_loadu_ps( src[ 4 ] ), r5 = _mm_loadu_ps( src[ 5 ] ), r6 = _mm_loadu_ps( src[ 6 ] ), r7 = _mm_loadu_ps( src[ 7 ] );
+        _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+        _MM_TRANSPOSE4_PS( r4, r5, r6, r7 );
+        x = _mm256_insertf128_ps( _mm256_castps128_ps256( r0 ), r4, 1 );
+        y = _mm256_insertf128_ps( _mm256_castps128_ps256( r1 ), r5, 1 );
+        z = _mm256_insertf128_ps( _mm256_castps128_ps256( r2 ), r6, 1 );
+    }
+    // w is written back as it was read
+    static void scatter( btScalar* const* dst, Lanes x, Lanes y, Lanes z )
+    {
+        __m128 r0 = _mm256_castps256_ps128( x ), r1 = _mm256_castps256_ps128( y ), r2 = _mm256_castps256_ps128( z );
+        __m128 r4 = _mm256_extractf128_ps( x, 1 ), r5 = _mm256_extractf128_ps( y, 1 ), r6 = _mm256_extractf128_ps( z, 1 );
+        __m128 r3 = _mm_setr_ps( dst[ 0 ][ 3 ], dst[ 1 ][ 3 ], dst[ 2 ][ 3 ], dst[ 3 ][ 3 ] );
+        __m128 r7 = _mm_setr_ps( dst[ 4 ][ 3 ], dst[ 5 ][ 3 ], dst[ 6 ][ 3 ], dst[ 7 ][ 3 ] );
+        _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+        _MM_TRANSPOSE4_PS( r4, r5, r6, r7 );
+        _mm_storeu_ps( dst[ 0 ], r0 ); _mm_storeu_ps( dst[ 1 ], r1 ); _mm_storeu_ps( dst[ 2 ], r2 ); _mm_storeu_ps( dst[ 3 ], r3 );
+        _mm_storeu_ps( dst[ 4 ], r4 ); _mm_storeu_ps( dst[ 5 ], r5 ); _mm_storeu_ps( dst[ 6 ], r6 ); _mm_storeu_ps( dst[ 7 ], r7 );
+    }
+};
+
+#elif ( defined( __SSE2__ ) || defined( _M_X64 ) ) && !defined( BT_USE_DOUBLE_PRECISION )
+#include <emmintrin.h>
+
+struct btRowLanes
+{
+    enum { WIDTH = 4 };
+    typedef __m128 Lanes;
+
+    static Lanes load( const btScalar* p ) { return _mm_loadu_ps( p ); }
+    static void store( btScalar* p, Lanes a ) { _mm_storeu_ps( p, a ); }
+    static Lanes zero() { return _mm_setzero_ps(); }
+    static Lanes add( Lanes a, Lanes b ) { return _mm_add_ps( a, b ); }
+    static Lanes sub( Lanes a, Lanes b ) { return _mm_sub_ps( a, b ); }
+    static Lanes mul( Lanes a, Lanes b ) { return _mm_mul_ps( a, b ); }
+    static Lanes min( Lanes a, Lanes b ) { return _mm_min_ps( a, b ); }
+    static Lanes max( Lanes a, Lanes b ) { return _mm_max_ps( a, b ); }
+    static Lanes greaterThan( Lanes a, Lanes b ) { return _mm_cmpgt_ps( a, b ); }
+    static Lanes select( Lanes mask, Lanes a, Lanes b ) { return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) ); }
+
+    static void gather( const btScalar* const* src, Lanes& x, Lanes& y, Lanes& z )
+    {
+        __m128 r0 = _mm_loadu_ps( src[ 0 ] ), r1 = _mm_loadu_ps( src[ 1 ] ), r2 = _mm_loadu_ps( src[ 2 ] ), r3 = _mm_loadu_ps( src[ 3 ] );
+        _MM_TRANSPOSE4_PS( r0, r1, r2, r3 );
+        x = r0;
+        y = r1;
+        z = r2;
+    }
+    // w is written back as it was read
+    static void scatter( btScalar* const* dst, Lanes x, Lanes y, Lanes z )
+    {
+        __m128 r3 = _mm_setr_ps( dst[ 0 ][ 3 ], dst[ 1 ][ 3 ], dst[ 2 ][ 3 ], dst[ 3 ][ 3 ] );
+        _MM_TRANSPOSE4_PS( x, y, z, r3 );
+        _mm_storeu_ps( dst[ 0 ], x ); _mm_storeu_ps( dst[ 1 ], y ); _mm_storeu_ps( dst[ 2 ], z ); _mm_storeu_ps( dst[ 3 ], r3 );
+    }
+};
+
+#else
+
+struct btRowLanes
+{
+    enum { WIDTH = 1 };
+    typedef btScalar Lanes;
+
+    static Lanes load( const btScalar* p ) { return *p; }
+    static void store( btScalar* p, Lanes a ) { *p = a; }
+    static Lanes zero() { return btScalar( 0 ); }
+    static Lanes add( Lanes a, Lanes b ) { return a + b; }
+    static Lanes sub( Lanes a, Lanes b ) { return a - b; }
+    static Lanes mul( Lanes a, Lanes b ) { return a * b; }
+    static Lanes min( Lanes a, Lanes b ) { return btMin( a, b ); }
+    static Lanes max( Lanes a, Lanes b ) { return btMax( a, b ); }
+    static Lanes greaterThan( Lanes a, Lanes b ) { return ( a > b ) ? btScalar( 1 ) : btScalar( 0 ); }
+    static Lanes select( Lanes mask, Lanes a, Lanes b ) { return ( mask != btScalar( 0 ) ) ? a : b; }
+
+    static void gather( const btScalar* const* src, Lanes& x, Lanes& y, Lanes& z )
+    {
+        x = src[ 0 ][ 0 ];
+        y = src[ 0 ][ 1 ];
+        z = src[ 0 ][ 2 ];
+    }
+    static void scatter( btScalar* const* dst, Lanes x, Lanes y, Lanes z )
+    {
+        dst[ 0 ][ 0 ] = x;
+        dst[ 0 ][ 1 ] = y;
+        dst[ 0 ][ 2 ] = z;
+    }
+};
+
+#endif
+
+// the scalar loop is no faster than solving the batches row by row, so it is only used when asked for
+bool btSequentialImpulseConstraintSolverMt::s_useSimdRowGroups = ( btRowLanes::WIDTH > 1 );
+
+
+static inline btRowLanes::Lanes btRowDot( const btScalar ( *v )[ btSequentialImpulseConstraintSolverMt::btSolverRowGroup::SIZE ], int lane,
+    btRowLanes::Lanes x, btRowLanes::Lanes y, btRowLanes::Lanes z )
+{
+    typedef btRowLanes L;
+    return L::add( L::add( L::mul( L::load( &v[ 0 ][ lane ] ), x ), L::mul( L::load( &v[ 1 ][ lane ] ), y ) ), L::mul( L::load( &v[ 2 ][ lane ] ), z ) );
+}
+
+
+static inline void btRowAddScaled( const btScalar ( *v )[ btSequentialImpulseConstraintSolverMt::btSolverRowGroup::SIZE ], int lane,
+    btRowLanes::Lanes s, btRowLanes::Lanes& x, btRowLanes::Lanes& y, btRowLanes::Lanes& z )
+{
+    typedef btRowLanes L;
+    x = L::add( x, L::mul( L::load( &v[ 0 ][ lane ] ), s ) );
+    y = L::add( y, L::mul( L::load( &v[ 1 ][ lane ] ), s ) );
+    z = L::add( z, L::mul( L::load( &v[ 2 ][ lane ] ), s ) );
+}
+
+
+// Solves the rows of a group like resolveSingleConstraintRowLowerLimit (contacts), or, when contactGroup is given, like
+// resolveSingleConstraintRowGeneric with limits of plus or minus friction times the impulse of the contact in the same lane (friction).
+// The applied impulses are kept in the group, and also written to constraintPool when it is given.
+static btScalar btSolveRowGroup( btSolverBody* solverBodyPool,
+    btSequentialImpulseConstraintSolverMt::btSolverRowGroup& group,
+    const btSequentialImpulseConstraintSolverMt::btSolverRowGroup* contactGroup,
+    btSolverConstraint* constraintPool
+    )
+{
+    typedef btRowLanes L;
+    typedef L::Lanes Lanes;
+    const int width = L::WIDTH;
+    // rows that do not move a body read zero velocity and write to scratch
+    const btScalar zeroVelocity[ 4 ] = { 0, 0, 0, 0 };
+    btScalar scratch[ 4 ] = { 0, 0, 0, 0 };
+    btScalar leastSquaresResidual = 0;
+    for ( int lane = 0; lane < btSequentialImpulseConstraintSolverMt::btSolverRowGroup::SIZE && group.m_constraintIndex[ lane ] >= 0; lane += width )
+    {
+        const btScalar* srcLinA[ width ];
+        const btScalar* srcAngA[ width ];
+        const btScalar* srcLinB[ width ];
+        const btScalar* srcAngB[ width ];
+        btScalar* dstLinA[ width ];
+        btScalar* dstAngA[ width ];
+        btScalar* dstLinB[ width ];
+        btScalar* dstAngB[ width ];
+        for ( int i = 0; i < width; ++i )
+        {
+            int bodyA = group.m_solverBodyIdA[ lane + i ];
+            int bodyB = group.m_solverBodyIdB[ lane + i ];
+            if ( bodyA >= 0 )
+            {
+                srcLinA[ i ] = dstLinA[ i ] = solverBodyPool[ bodyA ].m_deltaLinearVelocity.m_floats;
+                srcAngA[ i ] = dstAngA[ i ] = solverBodyPool[ bodyA ].m_deltaAngularVelocity.m_floats;
+            }
+            else
+            {
+                srcLinA[ i ] = srcAngA[ i ] = zeroVelocity;
+                dstLinA[ i ] = dstAngA[ i ] = scratch;
+            }
+            if ( bodyB >= 0 )
+            {
+                srcLinB[ i ] = dstLinB[ i ] = solverBodyPool[ bodyB ].m_deltaLinearVelocity.m_floats;
+                srcAngB[ i ] = dstAngB[ i ] = solverBodyPool[ bodyB ].m_deltaAngularVelocity.m_floats;
+            }
+            else
+            {
+                srcLinB[ i ] = srcAngB[ i ] = zeroVelocity;
+                dstLinB[ i ] = dstAngB[ i ] = scratch;
+            }
+        }
+        Lanes linAx, linAy, linAz, angAx, angAy, angAz, linBx, linBy, linBz, angBx, angBy, angBz;
+        L::gather( srcLinA, linAx, linAy, linAz );
+        L::gather( srcAngA, angAx, angAy, angAz );
+        L::gather( srcLinB, linBx, linBy, linBz );
+        L::gather( srcAngB, angBx, angBy, angBz );
+
+        Lanes applied = L::load( &group.m_appliedImpulse[ lane ] );
+        Lanes jacDiagABInv = L::load( &group.m_jacDiagABInv[ lane ] );
+        Lanes deltaVel1Dotn = L::add( btRowDot( group.m_contactNormal1, lane, linAx, linAy, linAz ), btRowDot( group.m_relpos1CrossNormal, lane, angAx, angAy, angAz ) );
+        Lanes deltaVel2Dotn = L::add( btRowDot( group.m_contactNormal2, lane, linBx, linBy, linBz ), btRowDot( group.m_relpos2CrossNormal, lane, angBx, angBy, angBz ) );
+        Lanes deltaImpulse = L::sub( L::load( &group.m_rhs[ lane ] ), L::mul( applied, L::load( &group.m_cfm[ lane ] ) ) );
+        deltaImpulse = L::sub( deltaImpulse, L::mul( deltaVel1Dotn, jacDiagABInv ) );
+        deltaImpulse = L::sub( deltaImpulse, L::mul( deltaVel2Dotn, jacDiagABInv ) );
+        Lanes sum = L::add( applied, deltaImpulse );
+        Lanes newApplied;
+        if ( contactGroup )
+        {
+            // friction is only applied where the contact pushes
+            Lanes total = L::load( &contactGroup->m_appliedImpulse[ lane ] );
+            Lanes upperLimit = L::mul( L::load( &group.m_friction[ lane ] ), total );
+            Lanes lowerLimit = L::sub( L::zero(), upperLimit );
+            Lanes active = L::greaterThan( total, L::zero() );
+            newApplied = L::select( active, L::min( L::max( sum, lowerLimit ), upperLimit ), applied );
+        }
+        else
+        {
+            newApplied = L::max( sum, L::load( &group.m_lowerLimit[ lane ] ) );
+        }
+        deltaImpulse = L::sub( newApplied, applied );
+        L::store( &group.m_appliedImpulse[ lane ], newApplied );
+
+        btRowAddScaled( group.m_linearComponentA, lane, deltaImpulse, linAx, linAy, linAz );
+        btRowAddScaled( group.m_angularComponentA, lane, deltaImpulse, angAx, angAy, angAz );
+        btRowAddScaled( group.m_linearComponentB, lane, deltaImpulse, linBx, linBy, linBz );
+        btRowAddScaled( group.m_angularComponentB, lane, deltaImpulse, angBx, angBy, angBz );
+        L::scatter( dstLinA, linAx, linAy, linAz );
+        L::scatter( dstAngA, angAx, angAy, angAz );
+        L::scatter( dstLinB, linBx, linBy, linBz );
+        L::scatter( dstAngB, angBx, angBy, angBz );
+
+        btScalar deltaImpulses[ width ];
+        L::store( deltaImpulses, deltaImpulse );
+        for ( int i = 0; i < width; ++i )
+        {
+            leastSquaresResidual += deltaImpulses[ i ] * deltaImpulses[ i ];
+        }
+        if ( constraintPool )
+        {
+            for ( int i = 0; i < width; ++i )
+            {
+                int iCons = group.m_constraintIndex[ lane + i ];
+                if ( iCons >= 0 )
+                {
+                    constraintPool[ iCons ].m_appliedImpulse = group.m_appliedImpulse[ lane + i ];
+                }
+            }
+        }
+    }
+    return leastSquaresResidual;
+}
+
+
+btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactRowGroups( int groupBegin, int groupEnd )
+{
+    btScalar leastSquaresResidual = 0.f;
+    // rolling friction reads the contact impulses from the constraint pool
+    btSolverConstraint* constraintPool = m_rowGroupsUpdatePool ? &m_tmpSolverContactConstraintPool[ 0 ] : NULL;
+    for ( int iGroup = groupBegin; iGroup < groupEnd; ++iGroup )
+    {
+        leastSquaresResidual += btSolveRowGroup( &m_tmpSolverBodyPool[ 0 ], m_contactRowGroups[ iGroup ], NULL, constraintPool );
+    }
+    return leastSquaresResidual;
+}
+
+
+btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactFrictionRowGroups( int groupBegin, int groupEnd )
+{
+    btScalar leastSquaresResidual = 0.f;
+    for ( int iGroup = groupBegin; iGroup < groupEnd; ++iGroup )
+    {
+        for ( int iDir = 0; iDir < m_numFrictionDirections; ++iDir )
+        {
+            leastSquaresResidual += btSolveRowGroup( &m_tmpSolverBodyPool[ 0 ],
+                m_frictionRowGroups[ iGroup * m_numFrictionDirections + iDir ],
+                &m_contactRowGroups[ iGroup ],
+                NULL
+                );
+        }
+    }
+    return leastSquaresResidual;
+}
+
+
 btScalar btSequentialImpulseConstraintSolverMt::resolveMultipleContactRollingFrictionConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd )
 {
     btScalar leastSquaresResidual = 0.f;
@@ -1320,18 +1921,59 @@ struct ContactSolverLoop : public btIParallelSumBody
 };
 
 
+struct ContactRowGroupSolverLoop : public btIParallelSumBody
+{
+    btSequentialImpulseConstraintSolverMt* m_solver;
+    const btAlignedObjectArray<btBatchedConstraints::Range>* m_batchRowGroups;
+    bool m_friction;
+
+    ContactRowGroupSolverLoop( btSequentialImpulseConstraintSolverMt* solver, const btAlignedObjectArray<btBatchedConstraints::Range>* batchRowGroups, bool friction )
+    {
+        m_solver = solver;
+        m_batchRowGroups = batchRowGroups;
+        m_friction = friction;
+    }
+    btScalar sumLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        BT_PROFILE( "ContactRowGroupSolverLoop" );
+        btScalar sum = 0;
+        for ( int iBatch = iBegin; iBatch < iEnd; ++iBatch )
+        {
+            const btBatchedConstraints::Range& groups = ( *m_batchRowGroups )[ iBatch ];
+            if ( m_friction )
+            {
+                sum += m_solver->resolveMultipleContactFrictionRowGroups( groups.begin, groups.end );
+            }
+            else
+            {
+                sum += m_solver->resolveMultipleContactRowGroups( groups.begin, groups.end );
+            }
+        }
+        return sum;
+    }
+};
+
+
 btScalar btSequentialImpulseConstraintSolverMt::resolveAllContactConstraints()
 {
     BT_PROFILE( "resolveAllContactConstraints" );
     const btBatchedConstraints& batchedCons = m_batchedContactConstraints;
     ContactSolverLoop loop( this, &batchedCons );
+    ContactRowGroupSolverLoop rowGroupLoop( this, &m_batchRowGroups, false );
     btScalar leastSquaresResidual = 0.f;
     for ( int iiPhase = 0; iiPhase < batchedCons.m_phases.size(); ++iiPhase )
     {
         int iPhase = batchedCons.m_phaseOrder[ iiPhase ];
         const btBatchedConstraints::Range& phase = batchedCons.m_phases[ iPhase ];
         int grainSize = batchedCons.m_phaseGrainSize[iPhase];
-        leastSquaresResidual += btParallelSum( phase.begin, phase.end, grainSize, loop );
+        if ( m_useRowGroups )
+        {
+            leastSquaresResidual += btParallelSum( phase.begin, phase.end, grainSize, rowGroupLoop );
+        }
+        else
+        {
+            leastSquaresResidual += btParallelSum( phase.begin, phase.end, grainSize, loop );
+        }
     }
     return leastSquaresResidual;
 }
@@ -1366,13 +2008,21 @@ btScalar btSequentialImpulseConstraintSolverMt::resolveAllContactFrictionConstra
     BT_PROFILE( "resolveAllContactFrictionConstraints" );
     const btBatchedConstraints& batchedCons = m_batchedContactConstraints;
     ContactFrictionSolverLoop loop( this, &batchedCons );
+    ContactRowGroupSolverLoop rowGroupLoop( this, &m_batchRowGroups, true );
     btScalar leastSquaresResidual = 0.f;
     for ( int iiPhase = 0; iiPhase < batchedCons.m_phases.size(); ++iiPhase )
     {
         int iPhase = batchedCons.m_phaseOrder[ iiPhase ];
         const btBatchedConstraints::Range& phase = batchedCons.m_phases[ iPhase ];
         int grainSize = batchedCons.m_phaseGrainSize[iPhase];
-        leastSquaresResidual += btParallelSum( phase.begin, phase.end, grainSize, loop );
+        if ( m_useRowGroups )
+        {
+            leastSquaresResidual += btParallelSum( phase.begin, phase.end, grainSize, rowGroupLoop );
+        }
+        else
+        {
+            leastSquaresResidual += btParallelSum( phase.begin, phase.end, grainSize, loop );
+        }
     }
     return leastSquaresResidual;
 }
@@ -1594,6 +2244,11 @@ btScalar btSequentialImpulseConstraintSolverMt::solveGroupCacheFriendlyFinish(bt
 {
 	BT_PROFILE("solveGroupCacheFriendlyFinish");
 
+    if ( m_useRowGroups )
+    {
+        writeBackRowGroupImpulses();
+    }
+
 	if (infoGlobal.m_solverMode & SOLVER_USE_WARMSTARTING)
     {
         WriteContactPointsLoop loop( this, infoGlobal );
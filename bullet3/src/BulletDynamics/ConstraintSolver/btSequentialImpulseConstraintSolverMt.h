@@ -19,6 +19,7 @@ subject to the following restrictions:
 #include "btSequentialImpulseConstraintSolver.h"
 #include "btBatchedConstraints.h"
 #include "LinearMath/btThreads.h"
+#include "LinearMath/btFrameArena.h"
 
 ///
 /// btSequentialImpulseConstraintSolverMt
@@ -44,6 +45,10 @@ subject to the following restrictions:
 ///  which reduces threading overhead so it can be a performance win, however, it does seem to produce a less stable simulation,
 ///  at least on stacks of blocks.
 ///
+///  When s_useSimdRowGroups is set and the SOLVER_SIMD flag is enabled, the contact and friction rows of each batch are
+///  regrouped into btSolverRowGroup, sets of rows that share no dynamic body, and each group is solved with one row per SIMD
+///  lane (AVX when compiled with it, otherwise SSE2, or a scalar loop). This is not done with randomized ordering or interleaving.
+///
 ///  When the SOLVER_RANDMIZE_ORDER flag is enabled, the ordering of phases, and the ordering of constraints within each batch
 ///  is randomized, however it does not swap constraints between batches.
 ///  This is to avoid regenerating the batches for each solver iteration which would be quite costly in performance.
@@ -90,6 +95,31 @@ public:
     static btBatchedConstraints::BatchingMethod s_jointBatchingMethod;
     static int s_minBatchSize;  // desired number of constraints per batch
     static int s_maxBatchSize;
+    static bool s_useSimdRowGroups;  // solve contact and friction rows in groups of independent rows, one per SIMD lane
+
+    // rows that share no dynamic body, stored as structure of arrays so they can be solved together
+    struct btSolverRowGroup
+    {
+        enum { SIZE = 8 };
+
+        btScalar m_contactNormal1[ 3 ][ SIZE ];
+        btScalar m_relpos1CrossNormal[ 3 ][ SIZE ];
+        btScalar m_contactNormal2[ 3 ][ SIZE ];
+        btScalar m_relpos2CrossNormal[ 3 ][ SIZE ];
+        btScalar m_linearComponentA[ 3 ][ SIZE ];  // m_contactNormal1 times the inverse mass of body A
+        btScalar m_linearComponentB[ 3 ][ SIZE ];
+        btScalar m_angularComponentA[ 3 ][ SIZE ];
+        btScalar m_angularComponentB[ 3 ][ SIZE ];
+        btScalar m_rhs[ SIZE ];
+        btScalar m_cfm[ SIZE ];
+        btScalar m_jacDiagABInv[ SIZE ];
+        btScalar m_lowerLimit[ SIZE ];
+        btScalar m_friction[ SIZE ];
+        btScalar m_appliedImpulse[ SIZE ];  // copied back to the constraint pool by writeBackRowGroupImpulses
+        int m_constraintIndex[ SIZE ];  // row in the constraint pool, -1 for unused lanes
+        int m_solverBodyIdA[ SIZE ];  // -1 for bodies the row does not move (static, kinematic or the fixed body)
+        int m_solverBodyIdB[ SIZE ];
+    };
 
 protected:
     static const int CACHE_LINE_SIZE = 64;
@@ -105,6 +135,14 @@ protected:
     char m_antiFalseSharingPadding[CACHE_LINE_SIZE]; // padding to keep mutexes in separate cachelines
     btSpinMutex m_kinematicBodyUniqueIdToSolverBodyTableMutex;
     btAlignedObjectArray<char> m_scratchMemory;
+    btThreadFrameArenas m_frameArenas;  // scratch arrays of the setup, reset in solveGroupCacheFriendlySetup
+    bool m_useRowGroups;
+    bool m_rowGroupsUpdatePool;  // whether solving row groups also updates the applied impulses of the constraint pool
+    btAlignedObjectArray<btSolverRowGroup> m_contactRowGroups;
+    btAlignedObjectArray<btSolverRowGroup> m_frictionRowGroups;  // m_numFrictionDirections groups for each contact row group
+    btAlignedObjectArray<btBatchedConstraints::Range> m_batchRowGroups;  // range of m_contactRowGroups for each contact batch
+    btAlignedObjectArray<int> m_rowGroupSlots;  // group and lane of each entry of m_batchedContactConstraints.m_constraintIndices
+    btAlignedObjectArray<unsigned long long> m_rowGroupBodyMasks;  // groups of the current batch that use each solver body, zero between batches
 
     virtual void randomizeConstraintOrdering( int iteration, int numIterations );
     virtual btScalar resolveAllJointConstraints( int iteration );
@@ -115,6 +153,8 @@ protected:
 
     virtual void setupBatchedContactConstraints();
     virtual void setupBatchedJointConstraints();
+    virtual void setupContactRowGroups();
+    void writeBackRowGroupImpulses();
     virtual void convertJoints(btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal) BT_OVERRIDE;
 	virtual void convertContacts(btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal) BT_OVERRIDE;
     virtual void convertBodies(btCollisionObject** bodies, int numBodies, const btContactSolverInfo& infoGlobal) BT_OVERRIDE;
@@ -131,12 +171,19 @@ public:
 	btSequentialImpulseConstraintSolverMt();
 	virtual ~btSequentialImpulseConstraintSolverMt();
 
+    void getFrameArenaStatistics( btFrameArenaStatistics& statistics ) const
+    {
+        m_frameArenas.getStatistics( statistics );
+    }
+
     btScalar resolveMultipleJointConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd, int iteration );
     btScalar resolveMultipleContactConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd );
     btScalar resolveMultipleContactSplitPenetrationImpulseConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd );
     btScalar resolveMultipleContactFrictionConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd );
     btScalar resolveMultipleContactRollingFrictionConstraints( const btAlignedObjectArray<int>& consIndices, int batchBegin, int batchEnd );
     btScalar resolveMultipleContactConstraintsInterleaved( const btAlignedObjectArray<int>& contactIndices, int batchBegin, int batchEnd );
+    btScalar resolveMultipleContactRowGroups( int groupBegin, int groupEnd );
+    btScalar resolveMultipleContactFrictionRowGroups( int groupBegin, int groupEnd );
 
     void internalCollectContactManifoldCachedInfo(btContactManifoldCachedInfo* cachedInfoArray, btPersistentManifold** manifoldPtr, int numManifolds, const btContactSolverInfo& infoGlobal);
     void internalAllocContactConstraints(const btContactManifoldCachedInfo* cachedInfoArray, int numManifolds);
@@ -145,6 +192,11 @@ public:
     void internalWriteBackContacts(int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
     void internalWriteBackJoints(int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
     void internalWriteBackBodies(int iBegin, int iEnd, const btContactSolverInfo& infoGlobal);
+    void internalAssignRowGroupSlots(int batchBegin, int batchEnd);
+    void internalClearRowGroups(int iBatch);
+    void internalFillRowGroupLanes(int iBatch, int iiCons);
+    void internalClearUnusedRowGroupLanes(int iBatch);
+    void internalWriteBackRowGroupImpulses(int iBegin, int iEnd);
 };
 
 
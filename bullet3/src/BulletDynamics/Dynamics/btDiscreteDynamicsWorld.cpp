@@ -211,7 +211,8 @@ m_fixedTimeStep(0),
 m_synchronizeAllMotionStates(false),
 m_applySpeculativeContactRestitution(false),
 m_profileTimings(0),
-m_latencyMotionStateInterpolation(true)
+m_latencyMotionStateInterpolation(true),
+m_transformOutput(0)
 
 {
 	if (!m_constraintSolver)
@@ -372,9 +373,97 @@ void	btDiscreteDynamicsWorld::synchronizeSingleMotionState(btRigidBody* body)
 }
 
 
+struct btTransformOutputWriter : public btIParallelForBody
+{
+	btRigidBody* const*	m_bodies;
+	char*	m_written;//by world array index
+	int	m_numWritable;
+	btDiscreteDynamicsWorld::TransformOutput*	m_output;
+	bool	m_allBodies;
+	bool	m_latencyInterpolation;
+	btScalar	m_localTime;
+	btScalar	m_fixedTimeStep;
+
+	void forLoop(int iBegin,int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			btRigidBody* body = m_bodies[i];
+			if (body->isStaticOrKinematicObject() || !(m_allBodies || body->isActive()))
+				continue;
+			int index = body->getWorldArrayIndex();
+			//bodies added by actions during the step are written by the next one
+			if (index >= m_numWritable)
+				continue;
+			//the same transform synchronizeSingleMotionState passes to the motion state
+			btTransform interpolatedTransform;
+			btTransformUtil::integrateTransform(body->getInterpolationWorldTransform(),
+				body->getInterpolationLinearVelocity(),body->getInterpolationAngularVelocity(),
+				(m_latencyInterpolation && m_fixedTimeStep) ? m_localTime - m_fixedTimeStep : m_localTime*body->getHitFraction(),
+				interpolatedTransform);
+			if (m_output->m_transforms)
+				m_output->m_transforms[index] = interpolatedTransform;
+			if (m_output->m_positions)
+				m_output->m_positions[index] = interpolatedTransform.getOrigin();
+			if (m_output->m_orientations)
+				interpolatedTransform.getBasis().getRotation(m_output->m_orientations[index]);
+			m_written[index] = 1;
+		}
+	}
+};
+
+void	btDiscreteDynamicsWorld::beginTransformOutput()
+{
+	m_transformOutputWritten.resize(m_collisionObjects.size());
+	if (m_transformOutputWritten.size())
+		memset(&m_transformOutputWritten[0],0,m_transformOutputWritten.size());
+	m_transformOutput->m_numDirty = 0;
+}
+
+void	btDiscreteDynamicsWorld::writeTransformOutput()
+{
+	BT_PROFILE("writeTransformOutput");
+	int numBodies = m_nonStaticRigidBodies.size();
+	if (numBodies==0 || m_transformOutputWritten.size()==0)
+		return;
+	btTransformOutputWriter writer;
+	writer.m_bodies = &m_nonStaticRigidBodies[0];
+	writer.m_written = &m_transformOutputWritten[0];
+	writer.m_numWritable = m_transformOutputWritten.size();
+	writer.m_output = m_transformOutput;
+	writer.m_allBodies = m_synchronizeAllMotionStates;
+	writer.m_latencyInterpolation = m_latencyMotionStateInterpolation;
+	writer.m_localTime = m_localTime;
+	writer.m_fixedTimeStep = m_fixedTimeStep;
+	int grainSize = 256;
+	btParallelForOrSerial(0,numBodies,grainSize,writer);
+}
+
+void	btDiscreteDynamicsWorld::endTransformOutput()
+{
+	//the flags are by world array index, so the list is in ascending order and a body written in several substeps is listed once
+	int numObjects = btMin(m_collisionObjects.size(),m_transformOutputWritten.size());
+	int numDirty = 0;
+	for (int i=0;i<numObjects;i++)
+	{
+		if (m_transformOutputWritten[i])
+		{
+			if (m_transformOutput->m_dirtyIndices)
+				m_transformOutput->m_dirtyIndices[numDirty] = i;
+			numDirty++;
+		}
+	}
+	m_transformOutput->m_numDirty = numDirty;
+}
+
 void	btDiscreteDynamicsWorld::synchronizeMotionStates()
 {
 //	BT_PROFILE("synchronizeMotionStates");
+	if (m_transformOutput)
+	{
+		writeTransformOutput();
+		return;
+	}
 	if (m_synchronizeAllMotionStates)
 	{
 		//iterate  over all collision objects
@@ -402,6 +491,8 @@ int	btDiscreteDynamicsWorld::stepSimulation( btScalar timeStep,int maxSubSteps,
 {
 	startProfiling(timeStep);
 
+	if (m_transformOutput)
+		beginTransformOutput();
 
 	int numSimulationSubSteps = 0;
 
@@ -463,6 +554,9 @@ int	btDiscreteDynamicsWorld::stepSimulation( btScalar timeStep,int maxSubSteps,
 
 	clearForces();
 
+	if (m_transformOutput)
+		endTransformOutput();
+
 #ifndef BT_NO_PROFILE
 	CProfileManager::Increment_Frame_Counter();
 #endif //BT_NO_PROFILE
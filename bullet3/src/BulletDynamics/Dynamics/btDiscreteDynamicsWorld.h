@@ -98,6 +98,10 @@ protected:
 
 	void	serializeDynamicsWorldInfo(btSerializer* serializer);
 
+	void	beginTransformOutput();
+	void	writeTransformOutput();
+	void	endTransformOutput();
+
 public:
 
 
@@ -117,6 +121,45 @@ public:
 	///this can be useful to synchronize a single rigid body -> graphics object
 	void	synchronizeSingleMotionState(btRigidBody* body);
 
+	///TransformOutput receives the interpolated world transforms of the rigid bodies that synchronizeMotionStates updates,
+	///in place of their btMotionState. The arrays are owned by the caller and indexed by btCollisionObject::getWorldArrayIndex,
+	///any of them can be 0. Each needs room for getNumCollisionObjects() entries, entries of bodies that didn't move are left as they are.
+	struct TransformOutput
+	{
+		btTransform*	m_transforms;
+		btVector3*	m_positions;
+		btQuaternion*	m_orientations;
+		int*	m_dirtyIndices;//the entries written during the last stepSimulation, each once and in ascending order, in m_numDirty
+		int	m_numDirty;
+
+		TransformOutput()
+			:m_transforms(0),
+			m_positions(0),
+			m_orientations(0),
+			m_dirtyIndices(0),
+			m_numDirty(0)
+		{
+		}
+	};
+
+protected:
+
+	TransformOutput*	m_transformOutput;
+	btAlignedObjectArray<char>	m_transformOutputWritten;//per world array index, during stepSimulation
+
+public:
+
+	///once set, stepSimulation writes the transforms of all bodies to output in one parallel pass (btParallelFor),
+	///and no btMotionState::setWorldTransform is called. Set to 0 to use the motion states again
+	void	setTransformOutput(TransformOutput* output)
+	{
+		m_transformOutput = output;
+	}
+	TransformOutput*	getTransformOutput() const
+	{
+		return m_transformOutput;
+	}
+
 	virtual void	addConstraint(btTypedConstraint* constraint, bool disableCollisionsBetweenLinkedBodies=false);
 
 	virtual void	removeConstraint(btTypedConstraint* constraint);
@@ -234,6 +277,17 @@ public:
 	{
 		return m_latencyMotionStateInterpolation;
 	}
+
+	///The time stepSimulation has accumulated towards the next fixed time step, when it is called with maxSubSteps > 0.
+	///It is part of the state saved by btWorldSnapshot.
+	void setLocalTime(btScalar localTime)
+	{
+		m_localTime = localTime;
+	}
+	btScalar getLocalTime() const
+	{
+		return m_localTime;
+	}
 };
 
 #endif //BT_DISCRETE_DYNAMICS_WORLD_H
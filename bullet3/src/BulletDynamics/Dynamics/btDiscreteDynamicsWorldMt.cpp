@@ -266,6 +266,45 @@ void btDiscreteDynamicsWorldMt::integrateTransforms( btScalar timeStep )
 }
 
 
+void btDiscreteDynamicsWorldMt::computeAabbsInternal( int iBegin, int iEnd )
+{
+    for ( int i = iBegin; i < iEnd; ++i )
+    {
+        const btCollisionObject* colObj = m_collisionObjects[ i ];
+        if ( m_forceUpdateAllAabbs || colObj->isActive() )
+        {
+            computeSingleAabb( colObj, m_aabbMins[ i ], m_aabbMaxs[ i ] );
+        }
+    }
+}
+
+
+void btDiscreteDynamicsWorldMt::updateAabbs()
+{
+    BT_PROFILE( "updateAabbs" );
+    const int numObjects = m_collisionObjects.size();
+    m_aabbMins.resizeNoInitialize( numObjects );
+    m_aabbMaxs.resizeNoInitialize( numObjects );
+    if ( numObjects > 0 )
+    {
+        UpdaterComputeAabbs update;
+        update.world = this;
+        int grainSize = 100;  // num of iterations per task for task scheduler
+        btParallelFor( 0, numObjects, grainSize, update );
+    }
+    // the broadphase is not threadsafe, and the same order as btCollisionWorld::updateAabbs keeps pairs deterministic
+    for ( int i = 0; i < numObjects; ++i )
+    {
+        btCollisionObject* colObj = m_collisionObjects[ i ];
+        btAssert( colObj->getWorldArrayIndex() == i );
+        if ( m_forceUpdateAllAabbs || colObj->isActive() )
+        {
+            applySingleAabb( colObj, m_aabbMins[ i ], m_aabbMaxs[ i ] );
+        }
+    }
+}
+
+
 int	btDiscreteDynamicsWorldMt::stepSimulation( btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep )
 {
     int numSubSteps = btDiscreteDynamicsWorld::stepSimulation(timeStep, maxSubSteps, fixedTimeStep);
@@ -79,10 +79,11 @@ private:
 ///                              solving simulation islands on multiple threads.
 ///
 ///  Should function exactly like btDiscreteDynamicsWorld.
-///  Also 3 methods that iterate over all of the rigidbodies can run in parallel:
+///  Also 4 methods that iterate over all of the rigidbodies can run in parallel:
 ///     - predictUnconstraintMotion
 ///     - integrateTransforms
 ///     - createPredictiveContacts
+///     - updateAabbs (computing the AABBs; the broadphase is still updated serially)
 ///
 ATTRIBUTE_ALIGNED16(class) btDiscreteDynamicsWorldMt : public btDiscreteDynamicsWorld
 {
@@ -119,6 +120,19 @@ protected:
     };
     virtual void integrateTransforms( btScalar timeStep ) BT_OVERRIDE;
 
+    struct UpdaterComputeAabbs : public btIParallelForBody
+    {
+        btDiscreteDynamicsWorldMt* world;
+
+        void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+        {
+            world->computeAabbsInternal( iBegin, iEnd );
+        }
+    };
+    btAlignedObjectArray<btVector3> m_aabbMins;
+    btAlignedObjectArray<btVector3> m_aabbMaxs;
+    void computeAabbsInternal( int iBegin, int iEnd );
+
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
@@ -131,6 +145,9 @@ public:
 	virtual ~btDiscreteDynamicsWorldMt();
 
     virtual int	stepSimulation( btScalar timeStep, int maxSubSteps, btScalar fixedTimeStep ) BT_OVERRIDE;
+
+    // AABBs are computed in parallel, then handed to the broadphase on the calling thread
+    virtual void updateAabbs() BT_OVERRIDE;
 };
 
 #endif //BT_DISCRETE_DYNAMICS_WORLD_H
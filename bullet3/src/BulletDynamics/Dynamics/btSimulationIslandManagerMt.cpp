@@ -139,7 +139,7 @@ bool btIsBodyInIsland( const btSimulationIslandManagerMt::Island& island, const
 void btSimulationIslandManagerMt::initIslandPools()
 {
     // reset island pools
-    int numElem = getUnionFind().getNumElements();
+    int numElem = getNumIslandIds();
     m_lookupIslandFromId.resize( numElem );
     for ( int i = 0; i < m_lookupIslandFromId.size(); ++i )
     {
@@ -283,7 +283,7 @@ void btSimulationIslandManagerMt::buildIslands( btDispatcher* dispatcher, btColl
 	//we are going to sort the unionfind array, and store the element id in the size
 	//afterwards, we clean unionfind, to make sure no-one uses it anymore
 	
-	getUnionFind().sortIslands();
+	sortIslandElements(collisionWorld);
 	int numElem = getUnionFind().getNumElements();
 
 	int endIslandIndex=1;
@@ -343,6 +343,7 @@ void btSimulationIslandManagerMt::buildIslands( btDispatcher* dispatcher, btColl
 					colObj0->setActivationState( ISLAND_SLEEPING );
 				}
 			}
+			storeSleepingIsland(collisionWorld,startIslandIndex,endIslandIndex);
 		} else
 		{
 
@@ -453,6 +454,10 @@ void btSimulationIslandManagerMt::addManifoldsToIslands( btDispatcher* dispatche
                 // scatter manifolds into various islands
                 int islandId = getIslandId( manifold );
                 // if island not sleeping,
+                if ( isSleepingIsland( islandId ) )
+                {
+                    continue;
+                }
                 if ( Island* island = getIsland( islandId ) )
                 {
                     island->manifoldArray.push_back( manifold );
@@ -474,6 +479,10 @@ void btSimulationIslandManagerMt::addConstraintsToIslands( btAlignedObjectArray<
         {
             int islandId = btGetConstraintIslandId( constraint );
             // if island is not sleeping,
+            if ( isSleepingIsland( islandId ) )
+            {
+                continue;
+            }
             if ( Island* island = getIsland( islandId ) )
             {
                 island->constraintArray.push_back( constraint );
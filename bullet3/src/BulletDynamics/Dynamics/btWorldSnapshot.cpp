@@ -0,0 +1,540 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btWorldSnapshot.h"
+#include "btDiscreteDynamicsWorld.h"
+#include "btRigidBody.h"
+#include "BulletCollision/BroadphaseCollision/btBroadphaseInterface.h"
+#include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
+#include "BulletCollision/CollisionDispatch/btManifoldResult.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
+#include "BulletDynamics/ConstraintSolver/btTypedConstraint.h"
+#include <string.h>
+
+struct btWorldSnapshotHeader
+{
+	int			m_numObjects;
+	int			m_numPairs;
+	int			m_numManifolds;
+	int			m_numConstraints;
+	int			m_broadphaseStateSize;
+	int			m_hasSolverSeed;
+	unsigned long	m_solverSeed;
+	btScalar	m_localTime;
+};
+
+struct btWorldSnapshotObject
+{
+	btTransform	m_worldTransform;
+	btTransform	m_interpolationWorldTransform;
+	btVector3	m_interpolationLinearVelocity;
+	btVector3	m_interpolationAngularVelocity;
+	btVector3	m_linearVelocity;
+	btVector3	m_angularVelocity;
+	btScalar	m_deactivationTime;
+	btScalar	m_hitFraction;
+	int			m_activationState;
+	int			m_islandTag;
+	int			m_companionId;
+	int			m_proxyUid;
+};
+
+//the pair record is followed by the indices of its m_numManifolds manifolds. m_numManifolds is -1 when the pair has no algorithm
+struct btWorldSnapshotPair
+{
+	int			m_object0;
+	int			m_object1;
+	int			m_numManifolds;
+};
+
+//the manifold record is followed by its m_numContacts btManifoldPoint
+struct btWorldSnapshotManifold
+{
+	int			m_object0;
+	int			m_object1;
+	int			m_numContacts;
+	int			m_companionIdA;
+	int			m_companionIdB;
+	btScalar	m_contactBreakingThreshold;
+	btScalar	m_contactProcessingThreshold;
+};
+
+struct btWorldSnapshotConstraint
+{
+	int			m_enabled;
+	btScalar	m_appliedImpulse;
+};
+
+//records are value-initialized (zeroed) before they are filled, so that equal states give equal buffers, padding included
+template <typename T>
+static inline void appendData(btAlignedObjectArray<unsigned char>& buffer, const T& value)
+{
+	int offset = buffer.size();
+	if (offset + int(sizeof(T)) > buffer.capacity())
+		buffer.reserve(btMax(2 * buffer.capacity(), offset + int(sizeof(T))));
+	buffer.resizeNoInitialize(offset + sizeof(T));
+	memcpy(&buffer[offset], &value, sizeof(T));
+}
+
+//records in the buffer are not aligned, so they are copied out byte by byte
+template <typename T>
+static inline const unsigned char* readData(const unsigned char* data, T& value)
+{
+	memcpy((unsigned char*)&value, data, sizeof(T));
+	return data + sizeof(T);
+}
+
+static int getObjectIndex(const btBroadphaseProxy* proxy)
+{
+	return ((const btCollisionObject*)proxy->m_clientObject)->getWorldArrayIndex();
+}
+
+static btSequentialImpulseConstraintSolver* getSequentialImpulseSolver(btDiscreteDynamicsWorld* world)
+{
+	btConstraintSolver* solver = world->getConstraintSolver();
+	if (solver && solver->getSolverType() == BT_SEQUENTIAL_IMPULSE_SOLVER)
+		return static_cast<btSequentialImpulseConstraintSolver*>(solver);
+	return 0;
+}
+
+void btWorldSnapshot::capture(btDiscreteDynamicsWorld* world)
+{
+	btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	btBroadphaseInterface* broadphase = world->getBroadphase();
+	btBroadphasePairArray& pairs = broadphase->getOverlappingPairCache()->getOverlappingPairArray();
+	btDispatcher* dispatcher = world->getDispatcher();
+	btSequentialImpulseConstraintSolver* solver = getSequentialImpulseSolver(world);
+
+	btWorldSnapshotHeader header = btWorldSnapshotHeader();
+	header.m_numObjects = objects.size();
+	header.m_numPairs = pairs.size();
+	header.m_numManifolds = dispatcher->getNumManifolds();
+	header.m_numConstraints = world->getNumConstraints();
+	header.m_broadphaseStateSize = 0;
+	header.m_hasSolverSeed = solver ? 1 : 0;
+	header.m_solverSeed = solver ? solver->getRandSeed() : 0;
+	header.m_localTime = world->getLocalTime();
+	m_buffer.resizeNoInitialize(0);
+	appendData(m_buffer, header);
+
+	for (int i = 0; i < objects.size(); i++)
+	{
+		const btCollisionObject* obj = objects[i];
+		const btRigidBody* body = btRigidBody::upcast(obj);
+		btWorldSnapshotObject record = btWorldSnapshotObject();
+		record.m_worldTransform = obj->getWorldTransform();
+		record.m_interpolationWorldTransform = obj->getInterpolationWorldTransform();
+		record.m_interpolationLinearVelocity = obj->getInterpolationLinearVelocity();
+		record.m_interpolationAngularVelocity = obj->getInterpolationAngularVelocity();
+		record.m_linearVelocity = body ? body->getLinearVelocity() : btVector3(0, 0, 0);
+		record.m_angularVelocity = body ? body->getAngularVelocity() : btVector3(0, 0, 0);
+		record.m_deactivationTime = obj->getDeactivationTime();
+		record.m_hitFraction = obj->getHitFraction();
+		record.m_activationState = obj->getActivationState();
+		record.m_islandTag = obj->getIslandTag();
+		record.m_companionId = obj->getCompanionId();
+		record.m_proxyUid = obj->getBroadphaseHandle() ? obj->getBroadphaseHandle()->m_uniqueId : -1;
+		appendData(m_buffer, record);
+	}
+
+	int broadphaseOffset = m_buffer.size();
+	broadphase->saveState(m_buffer);
+	header.m_broadphaseStateSize = m_buffer.size() - broadphaseOffset;
+
+	for (int i = 0; i < pairs.size(); i++)
+	{
+		const btBroadphasePair& pair = pairs[i];
+		m_manifoldArray.resize(0);
+		if (pair.m_algorithm)
+			pair.m_algorithm->getAllContactManifolds(m_manifoldArray);
+		btWorldSnapshotPair record = btWorldSnapshotPair();
+		record.m_object0 = getObjectIndex(pair.m_pProxy0);
+		record.m_object1 = getObjectIndex(pair.m_pProxy1);
+		record.m_numManifolds = pair.m_algorithm ? m_manifoldArray.size() : -1;
+		appendData(m_buffer, record);
+		for (int j = 0; j < m_manifoldArray.size(); j++)
+			appendData(m_buffer, m_manifoldArray[j]->m_index1a);
+	}
+
+	for (int i = 0; i < header.m_numManifolds; i++)
+	{
+		const btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(i);
+		btWorldSnapshotManifold record = btWorldSnapshotManifold();
+		record.m_object0 = manifold->getBody0()->getWorldArrayIndex();
+		record.m_object1 = manifold->getBody1()->getWorldArrayIndex();
+		record.m_numContacts = manifold->getNumContacts();
+		record.m_companionIdA = manifold->m_companionIdA;
+		record.m_companionIdB = manifold->m_companionIdB;
+		record.m_contactBreakingThreshold = manifold->getContactBreakingThreshold();
+		record.m_contactProcessingThreshold = manifold->getContactProcessingThreshold();
+		appendData(m_buffer, record);
+		for (int j = 0; j < record.m_numContacts; j++)
+		{
+			btManifoldPoint point = manifold->getContactPoint(j);
+			point.m_userPersistentData = 0;
+			appendData(m_buffer, point);
+		}
+	}
+
+	for (int i = 0; i < header.m_numConstraints; i++)
+	{
+		const btTypedConstraint* constraint = world->getConstraint(i);
+		btWorldSnapshotConstraint record = btWorldSnapshotConstraint();
+		record.m_enabled = constraint->isEnabled() ? 1 : 0;
+		record.m_appliedImpulse = constraint->needsFeedback() ? constraint->getAppliedImpulse() : btScalar(0);
+		appendData(m_buffer, record);
+	}
+
+	memcpy(&m_buffer[0], &header, sizeof(header));
+}
+
+bool btWorldSnapshot::restore(btDiscreteDynamicsWorld* world)
+{
+	btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	btBroadphaseInterface* broadphase = world->getBroadphase();
+	btOverlappingPairCache* pairCache = broadphase->getOverlappingPairCache();
+	btBroadphasePairArray& pairs = pairCache->getOverlappingPairArray();
+	btDispatcher* dispatcher = world->getDispatcher();
+
+	btWorldSnapshotHeader header;
+	if (m_buffer.size() < int(sizeof(header)))
+		return false;
+	const unsigned char* data = readData(&m_buffer[0], header);
+	if (header.m_numObjects != objects.size() || header.m_numConstraints != world->getNumConstraints())
+		return false;
+
+	//the objects must be the captured ones, with the same broadphase proxies
+	const unsigned char* objectData = data;
+	for (int i = 0; i < header.m_numObjects; i++)
+	{
+		btWorldSnapshotObject record;
+		data = readData(data, record);
+		const btBroadphaseProxy* proxy = objects[i]->getBroadphaseHandle();
+		if (record.m_proxyUid != (proxy ? proxy->m_uniqueId : -1))
+			return false;
+	}
+	if (!broadphase->restoreState(data, header.m_broadphaseStateSize))
+		return false;
+	data += header.m_broadphaseStateSize;
+
+	for (int i = 0; i < header.m_numObjects; i++)
+	{
+		btCollisionObject* obj = objects[i];
+		btWorldSnapshotObject record;
+		objectData = readData(objectData, record);
+		obj->setWorldTransform(record.m_worldTransform);
+		obj->setInterpolationWorldTransform(record.m_interpolationWorldTransform);
+		obj->setInterpolationLinearVelocity(record.m_interpolationLinearVelocity);
+		obj->setInterpolationAngularVelocity(record.m_interpolationAngularVelocity);
+		obj->forceActivationState(record.m_activationState);
+		obj->setDeactivationTime(record.m_deactivationTime);
+		obj->setHitFraction(record.m_hitFraction);
+		obj->setIslandTag(record.m_islandTag);
+		obj->setCompanionId(record.m_companionId);
+		if (btRigidBody* body = btRigidBody::upcast(obj))
+		{
+			body->setLinearVelocity(record.m_linearVelocity);
+			body->setAngularVelocity(record.m_angularVelocity);
+			body->updateInertiaTensor();
+		}
+	}
+
+	//When the pair array still holds the captured pairs in order, which is usual a few frames later, the pairs stay in place.
+	//Otherwise they are all removed and added again in their captured order, which decides the order they are processed in.
+	const unsigned char* pairData = data;
+	bool samePairs = pairs.size() == header.m_numPairs;
+	for (int i = 0; i < header.m_numPairs && samePairs; i++)
+	{
+		btWorldSnapshotPair record;
+		data = readData(data, record);
+		if (record.m_numManifolds > 0)
+			data += record.m_numManifolds * sizeof(int);
+		samePairs = pairs[i].m_pProxy0 == objects[record.m_object0]->getBroadphaseHandle() &&
+					pairs[i].m_pProxy1 == objects[record.m_object1]->getBroadphaseHandle();
+	}
+
+	//Pairs keep their algorithm when it has the captured number of manifolds, and those manifolds get the captured contacts.
+	//The other algorithms are destroyed.
+	m_keptAlgorithms.resize(header.m_numPairs);
+	m_restoredManifolds.resize(header.m_numManifolds);
+	for (int i = 0; i < header.m_numManifolds; i++)
+		m_restoredManifolds[i] = 0;
+	data = pairData;
+	for (int i = 0; i < header.m_numPairs; i++)
+	{
+		btWorldSnapshotPair record;
+		data = readData(data, record);
+		m_keptAlgorithms[i] = 0;
+		if (record.m_numManifolds >= 0)
+		{
+			btBroadphasePair* pair = samePairs ? &pairs[i] : pairCache->findPair(objects[record.m_object0]->getBroadphaseHandle(), objects[record.m_object1]->getBroadphaseHandle());
+			if (pair && pair->m_algorithm)
+			{
+				m_manifoldArray.resize(0);
+				pair->m_algorithm->getAllContactManifolds(m_manifoldArray);
+				if (m_manifoldArray.size() == record.m_numManifolds)
+				{
+					m_keptAlgorithms[i] = pair->m_algorithm;
+					pair->m_algorithm = 0;
+					for (int j = 0; j < record.m_numManifolds; j++)
+					{
+						int manifoldIndex;
+						readData(data + j * sizeof(int), manifoldIndex);
+						m_restoredManifolds[manifoldIndex] = m_manifoldArray[j];
+					}
+				}
+			}
+			data += record.m_numManifolds * sizeof(int);
+		}
+	}
+
+	for (int i = 0; i < pairs.size(); i++)
+		pairCache->cleanOverlappingPair(pairs[i], dispatcher);
+	if (!samePairs)
+	{
+		if (pairCache->hasDeferredRemoval())
+		{
+			pairs.resize(0);
+		}
+		else
+		{
+			while (pairs.size())
+			{
+				const btBroadphasePair& last = pairs[pairs.size() - 1];
+				pairCache->removeOverlappingPair(last.m_pProxy0, last.m_pProxy1, dispatcher);
+			}
+		}
+	}
+	data = pairData;
+	for (int i = 0; i < header.m_numPairs; i++)
+	{
+		btWorldSnapshotPair record;
+		data = readData(data, record);
+		const unsigned char* manifoldIndices = data;
+		if (record.m_numManifolds > 0)
+			data += record.m_numManifolds * sizeof(int);
+		btBroadphasePair* pair = samePairs ? &pairs[i] : pairCache->addOverlappingPair(objects[record.m_object0]->getBroadphaseHandle(), objects[record.m_object1]->getBroadphaseHandle());
+		if (!pair)
+		{
+			//the pair is filtered out now, and its algorithm releases its manifolds
+			if (m_keptAlgorithms[i])
+			{
+				for (int j = 0; j < record.m_numManifolds; j++)
+				{
+					int manifoldIndex;
+					readData(manifoldIndices + j * sizeof(int), manifoldIndex);
+					m_restoredManifolds[manifoldIndex] = 0;
+				}
+				m_keptAlgorithms[i]->~btCollisionAlgorithm();
+				dispatcher->freeCollisionAlgorithm(m_keptAlgorithms[i]);
+			}
+			continue;
+		}
+		pair->m_algorithm = m_keptAlgorithms[i];
+		if (record.m_numManifolds >= 0 && !pair->m_algorithm)
+		{
+			btCollisionObject* colObj0 = (btCollisionObject*)pair->m_pProxy0->m_clientObject;
+			btCollisionObject* colObj1 = (btCollisionObject*)pair->m_pProxy1->m_clientObject;
+			btCollisionObjectWrapper obj0Wrap(0, colObj0->getCollisionShape(), colObj0, colObj0->getWorldTransform(), -1, -1);
+			btCollisionObjectWrapper obj1Wrap(0, colObj1->getCollisionShape(), colObj1, colObj1->getWorldTransform(), -1, -1);
+			pair->m_algorithm = dispatcher->findAlgorithm(&obj0Wrap, &obj1Wrap, 0, BT_CONTACT_POINT_ALGORITHMS);
+			if (pair->m_algorithm && record.m_numManifolds > 0)
+			{
+				m_manifoldArray.resize(0);
+				pair->m_algorithm->getAllContactManifolds(m_manifoldArray);
+				if (m_manifoldArray.size() < record.m_numManifolds)
+				{
+					//algorithms such as btConvexConvexAlgorithm create their manifold in the first processCollision
+					btManifoldResult contactPointResult(&obj0Wrap, &obj1Wrap);
+					pair->m_algorithm->processCollision(&obj0Wrap, &obj1Wrap, world->getDispatchInfo(), &contactPointResult);
+					m_manifoldArray.resize(0);
+					pair->m_algorithm->getAllContactManifolds(m_manifoldArray);
+				}
+				if (m_manifoldArray.size() == record.m_numManifolds)
+				{
+					for (int j = 0; j < record.m_numManifolds; j++)
+					{
+						int manifoldIndex;
+						readData(manifoldIndices + j * sizeof(int), manifoldIndex);
+						m_restoredManifolds[manifoldIndex] = m_manifoldArray[j];
+					}
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < header.m_numManifolds; i++)
+	{
+		btWorldSnapshotManifold record;
+		data = readData(data, record);
+		btPersistentManifold* manifold = m_restoredManifolds[i];
+		if (manifold)
+		{
+			for (int j = 0; j < manifold->getNumContacts(); j++)
+			{
+				if (manifold->getContactPoint(j).m_userPersistentData)
+					manifold->clearUserCache(manifold->getContactPoint(j));
+			}
+			manifold->setBodies(objects[record.m_object0], objects[record.m_object1]);
+			manifold->setNumContacts(record.m_numContacts);
+			for (int j = 0; j < record.m_numContacts; j++)
+				memcpy(&manifold->getContactPoint(j), data + j * sizeof(btManifoldPoint), sizeof(btManifoldPoint));
+			manifold->m_companionIdA = record.m_companionIdA;
+			manifold->m_companionIdB = record.m_companionIdB;
+			manifold->setContactBreakingThreshold(record.m_contactBreakingThreshold);
+			manifold->setContactProcessingThreshold(record.m_contactProcessingThreshold);
+		}
+		data += record.m_numContacts * sizeof(btManifoldPoint);
+	}
+
+	//the dispatcher keeps the restored manifolds in their captured order, followed by any others
+	int numManifolds = dispatcher->getNumManifolds();
+	if (numManifolds)
+	{
+		btPersistentManifold** dispatcherManifolds = dispatcher->getInternalManifoldPointer();
+		m_orderedManifolds.resize(0);
+		for (int i = 0; i < m_restoredManifolds.size(); i++)
+		{
+			if (m_restoredManifolds[i])
+			{
+				m_orderedManifolds.push_back(m_restoredManifolds[i]);
+				m_restoredManifolds[i]->m_index1a = -1;
+			}
+		}
+		for (int i = 0; i < numManifolds; i++)
+		{
+			if (dispatcherManifolds[i]->m_index1a != -1)
+				m_orderedManifolds.push_back(dispatcherManifolds[i]);
+		}
+		btAssert(m_orderedManifolds.size() == numManifolds);
+		for (int i = 0; i < numManifolds; i++)
+		{
+			dispatcherManifolds[i] = m_orderedManifolds[i];
+			dispatcherManifolds[i]->m_index1a = i;
+		}
+	}
+
+	for (int i = 0; i < header.m_numConstraints; i++)
+	{
+		btTypedConstraint* constraint = world->getConstraint(i);
+		btWorldSnapshotConstraint record;
+		data = readData(data, record);
+		constraint->setEnabled(record.m_enabled != 0);
+		if (constraint->needsFeedback())
+			constraint->internalSetAppliedImpulse(record.m_appliedImpulse);
+	}
+
+	btSequentialImpulseConstraintSolver* solver = getSequentialImpulseSolver(world);
+	if (solver && header.m_hasSolverSeed)
+		solver->setRandSeed(header.m_solverSeed);
+	world->setLocalTime(header.m_localTime);
+	return true;
+}
+
+//FNV-1a
+static inline void hashBytes(unsigned int& hash, const void* data, int size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (int i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+}
+
+static inline void hashVector(unsigned int& hash, const btVector3& v)
+{
+	//the unused fourth component is left out
+	hashBytes(hash, v.m_floats, 3 * sizeof(btScalar));
+}
+
+unsigned int btWorldSnapshot::hashState(btCollisionWorld* world)
+{
+	unsigned int hash = 2166136261u;
+	const btCollisionObjectArray& objects = world->getCollisionObjectArray();
+	for (int i = 0; i < objects.size(); i++)
+	{
+		const btCollisionObject* obj = objects[i];
+		const btTransform& tr = obj->getWorldTransform();
+		hashVector(hash, tr.getBasis()[0]);
+		hashVector(hash, tr.getBasis()[1]);
+		hashVector(hash, tr.getBasis()[2]);
+		hashVector(hash, tr.getOrigin());
+		int activationState = obj->getActivationState();
+		hashBytes(hash, &activationState, sizeof(activationState));
+		if (const btRigidBody* body = btRigidBody::upcast(obj))
+		{
+			hashVector(hash, body->getLinearVelocity());
+			hashVector(hash, body->getAngularVelocity());
+		}
+	}
+
+	const btBroadphasePairArray& pairs = world->getBroadphase()->getOverlappingPairCache()->getOverlappingPairArray();
+	for (int i = 0; i < pairs.size(); i++)
+	{
+		hashBytes(hash, &pairs[i].m_pProxy0->m_uniqueId, sizeof(int));
+		hashBytes(hash, &pairs[i].m_pProxy1->m_uniqueId, sizeof(int));
+	}
+
+	btDispatcher* dispatcher = world->getDispatcher();
+	for (int i = 0; i < dispatcher->getNumManifolds(); i++)
+	{
+		const btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(i);
+		int numContacts = manifold->getNumContacts();
+		hashBytes(hash, &numContacts, sizeof(numContacts));
+		for (int j = 0; j < numContacts; j++)
+		{
+			const btManifoldPoint& pt = manifold->getContactPoint(j);
+			hashVector(hash, pt.m_positionWorldOnB);
+			hashVector(hash, pt.m_normalWorldOnB);
+			hashBytes(hash, &pt.m_distance1, sizeof(btScalar));
+			hashBytes(hash, &pt.m_appliedImpulse, sizeof(btScalar));
+			hashBytes(hash, &pt.m_appliedImpulseLateral1, sizeof(btScalar));
+			hashBytes(hash, &pt.m_appliedImpulseLateral2, sizeof(btScalar));
+		}
+	}
+	return hash;
+}
+
+bool btDeterminismCheck::checkFrame(int frame, btCollisionWorld* world)
+{
+	unsigned int hash = btWorldSnapshot::hashState(world);
+	if (frame >= m_frameHashes.size())
+	{
+		m_frameHashes.resize(frame + 1, 0);
+		m_frameRecorded.resize(frame + 1, false);
+	}
+	if (!m_frameRecorded[frame])
+	{
+		m_frameHashes[frame] = hash;
+		m_frameRecorded[frame] = true;
+		return true;
+	}
+	if (m_frameHashes[frame] == hash)
+		return true;
+	if (m_firstMismatch < 0 || frame < m_firstMismatch)
+		m_firstMismatch = frame;
+	return false;
+}
+
+void btDeterminismCheck::forgetFrames(int frame)
+{
+	if (frame < m_frameHashes.size())
+	{
+		m_frameHashes.resize(frame);
+		m_frameRecorded.resize(frame);
+	}
+}
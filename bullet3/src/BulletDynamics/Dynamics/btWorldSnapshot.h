@@ -0,0 +1,104 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_WORLD_SNAPSHOT_H
+#define BT_WORLD_SNAPSHOT_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "BulletCollision/BroadphaseCollision/btCollisionAlgorithm.h"
+
+class btCollisionWorld;
+class btDiscreteDynamicsWorld;
+
+///btWorldSnapshot captures the simulation state of a btDiscreteDynamicsWorld in one contiguous buffer, and restores it.
+///It is meant for rollback networking: restore the state of an earlier frame, then simulate the frames after it again.
+///The snapshot holds the motion and activation state of the collision objects, the broadphase structures (see btBroadphaseInterface::saveState),
+///the overlapping pairs in their order, the contact manifolds with the applied impulses used for warm starting,
+///the enabled state and applied impulse of the constraints, the random seed of a btSequentialImpulseConstraintSolver
+///and the time stepSimulation has accumulated towards the next fixed step.
+///
+///A snapshot restores only into the world it was captured from, with the same collision objects and constraints, otherwise restore returns false.
+///Pairs keep their collision algorithm when it still has the captured number of manifolds, and the manifold contents are restored.
+///With btDbvtBroadphase, stepping a restored world with the same inputs gives the same results, bit for bit, as the steps after the capture.
+///Not captured: forces applied since the last step, actions (vehicles, character controllers), soft body nodes, multibodies,
+///the user persistent data of contact points, and the predictive contacts of bodies using continuous collision detection.
+class btWorldSnapshot
+{
+	btAlignedObjectArray<unsigned char>	m_buffer;
+	btManifoldArray	m_manifoldArray;
+	btAlignedObjectArray<btCollisionAlgorithm*>	m_keptAlgorithms;
+	btManifoldArray	m_restoredManifolds;
+	btManifoldArray	m_orderedManifolds;
+
+public:
+
+	///capture overwrites the snapshot with the state of world, reusing the buffer
+	void	capture(btDiscreteDynamicsWorld* world);
+
+	///restore puts world back into the captured state. Returns false, without changing world, when its objects or constraints differ from the captured ones
+	bool	restore(btDiscreteDynamicsWorld* world);
+
+	const unsigned char*	getBuffer() const
+	{
+		return m_buffer.size() ? &m_buffer[0] : 0;
+	}
+
+	int		getBufferSize() const
+	{
+		return m_buffer.size();
+	}
+
+	///hashState hashes the transforms, velocities and activation states of the objects, the overlapping pairs and the contact points of world.
+	///Two worlds that hash differently after the same step have diverged, see btDeterminismCheck.
+	static unsigned int	hashState(btCollisionWorld* world);
+};
+
+///btDeterminismCheck keeps the state hash of each simulated frame (see btWorldSnapshot::hashState),
+///and reports the first frame that hashes differently when it is simulated again, for instance after a rollback with the same inputs.
+class btDeterminismCheck
+{
+	btAlignedObjectArray<unsigned int>	m_frameHashes;
+	btAlignedObjectArray<bool>			m_frameRecorded;
+	int									m_firstMismatch;
+
+public:
+
+	btDeterminismCheck()
+		:m_firstMismatch(-1)
+	{
+	}
+
+	///checkFrame hashes world after the step of frame. The first check of a frame records the hash, later checks compare with it.
+	///Returns false when the hash differs from the recorded one.
+	bool	checkFrame(int frame, btCollisionWorld* world);
+
+	///the first frame checkFrame found a different hash for, or -1
+	int		getFirstMismatch() const
+	{
+		return m_firstMismatch;
+	}
+
+	///forgetFrames drops the hashes of frame and the frames after it, so that they are recorded again, for instance when the inputs of frame changed
+	void	forgetFrames(int frame);
+
+	void	reset()
+	{
+		m_frameHashes.resize(0);
+		m_frameRecorded.resize(0);
+		m_firstMismatch = -1;
+	}
+};
+
+#endif //BT_WORLD_SNAPSHOT_H
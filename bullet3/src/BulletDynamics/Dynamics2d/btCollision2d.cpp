@@ -0,0 +1,526 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///The polygon clipping follows the same approach as btBox2dBox2dCollisionAlgorithm, which is based on Box2D by Erin Catto
+
+#include "btCollision2d.h"
+#include "BulletCollision/CollisionShapes/btBox2dShape.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+#include "BulletCollision/CollisionShapes/btSphereShape.h"
+#include "BulletCollision/CollisionShapes/btCylinderShape.h"
+#include "BulletCollision/CollisionShapes/btConvexHullShape.h"
+#include "BulletCollision/CollisionShapes/btConvex2dShape.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+void	btShape2d::setCircle(btScalar radius)
+{
+	m_type = BT_SHAPE2D_CIRCLE;
+	m_numVertices = 0;
+	m_radius = radius;
+	m_area = SIMD_PI*radius*radius;
+	m_inertiaPerMass = btScalar(0.5)*radius*radius;
+}
+
+static bool	btLexicographicLess2d(const btVector2& a,const btVector2& b)
+{
+	return a.m_x < b.m_x || (a.m_x == b.m_x && a.m_y < b.m_y);
+}
+
+class btVector2LexicographicSortPredicate
+{
+public:
+	bool operator() ( const btVector2& a, const btVector2& b ) const
+	{
+		return btLexicographicLess2d(a,b);
+	}
+};
+
+///monotone chain convex hull, counter-clockwise and without collinear points
+static int	btConvexHull2d(const btVector2* points,int numPoints,btAlignedObjectArray<btVector2>& hull)
+{
+	btAlignedObjectArray<btVector2> sorted;
+	sorted.resize(numPoints);
+	for (int i=0;i<numPoints;i++)
+		sorted[i] = points[i];
+	sorted.quickSort(btVector2LexicographicSortPredicate());
+
+	hull.resize(2*numPoints+1);
+	int k=0;
+	for (int i=0;i<numPoints;i++)
+	{
+		while (k>=2 && (hull[k-1]-hull[k-2]).cross(sorted[i]-hull[k-2]) <= SIMD_EPSILON)
+			k--;
+		hull[k++] = sorted[i];
+	}
+	for (int i=numPoints-2,lower=k+1;i>=0;i--)
+	{
+		while (k>=lower && (hull[k-1]-hull[k-2]).cross(sorted[i]-hull[k-2]) <= SIMD_EPSILON)
+			k--;
+		hull[k++] = sorted[i];
+	}
+	//the last point repeats the first one
+	k = btMax(k-1,0);
+	hull.resize(k);
+	return k;
+}
+
+void	btShape2d::setPolygon(const btVector2* points,int numPoints,btScalar radius)
+{
+	btAlignedObjectArray<btVector2> hull;
+	int count = btConvexHull2d(points,numPoints,hull);
+	if (count < 3)
+	{
+		//degenerate, keep it as a circle around the points
+		btScalar maxRadius2 = 0;
+		for (int i=0;i<numPoints;i++)
+			maxRadius2 = btMax(maxRadius2,points[i].length2());
+		setCircle(btSqrt(maxRadius2)+radius);
+		return;
+	}
+
+	if (count > BT_SHAPE2D_MAX_VERTICES)
+	{
+		//keep the supporting vertices in evenly spaced directions, which are still in counter-clockwise order
+		btAlignedObjectArray<btVector2> reduced;
+		int last = -1;
+		for (int d=0;d<BT_SHAPE2D_MAX_VERTICES;d++)
+		{
+			btScalar angle = SIMD_2_PI*btScalar(d)/btScalar(BT_SHAPE2D_MAX_VERTICES);
+			btVector2 dir(btCos(angle),btSin(angle));
+			int best = 0;
+			btScalar bestDot = hull[0].dot(dir);
+			for (int i=1;i<count;i++)
+			{
+				btScalar dot = hull[i].dot(dir);
+				if (dot > bestDot)
+				{
+					bestDot = dot;
+					best = i;
+				}
+			}
+			if (best != last)
+			{
+				reduced.push_back(hull[best]);
+				last = best;
+			}
+		}
+		count = btConvexHull2d(&reduced[0],reduced.size(),hull);
+	}
+
+	m_type = BT_SHAPE2D_POLYGON;
+	m_numVertices = count;
+	m_radius = radius;
+	for (int i=0;i<count;i++)
+	{
+		m_vertices[i] = hull[i];
+	}
+
+	btScalar area = 0;
+	btScalar inertia = 0;
+	const btScalar inv3 = btScalar(1.)/btScalar(3.);
+	for (int i=0;i<count;i++)
+	{
+		const btVector2& e1 = m_vertices[i];
+		const btVector2& e2 = m_vertices[(i+1)%count];
+		btVector2 edge = e2-e1;
+		btScalar len = btSqrt(edge.length2());
+		m_normals[i] = btVector2(edge.m_y,-edge.m_x)*(btScalar(1.)/len);
+
+		//triangle between the origin and the edge
+		btScalar D = e1.cross(e2);
+		area += btScalar(0.5)*D;
+		btScalar intx2 = e1.m_x*e1.m_x + e2.m_x*e1.m_x + e2.m_x*e2.m_x;
+		btScalar inty2 = e1.m_y*e1.m_y + e2.m_y*e1.m_y + e2.m_y*e2.m_y;
+		inertia += (btScalar(0.25)*inv3*D)*(intx2+inty2);
+	}
+	m_area = area;
+	m_inertiaPerMass = area > SIMD_EPSILON ? inertia/area : btScalar(0.);
+}
+
+bool	btShape2d::setCollisionShape(const btCollisionShape* shape)
+{
+	switch (shape->getShapeType())
+	{
+	case BOX_2D_SHAPE_PROXYTYPE:
+	case BOX_SHAPE_PROXYTYPE:
+		{
+			btVector3 halfExtents = shape->getShapeType()==BOX_2D_SHAPE_PROXYTYPE ?
+				((const btBox2dShape*)shape)->getHalfExtentsWithMargin() :
+				((const btBoxShape*)shape)->getHalfExtentsWithMargin();
+			btVector2 points[4] = {
+				btVector2(-halfExtents.getX(),-halfExtents.getY()),
+				btVector2(halfExtents.getX(),-halfExtents.getY()),
+				btVector2(halfExtents.getX(),halfExtents.getY()),
+				btVector2(-halfExtents.getX(),halfExtents.getY())};
+			setPolygon(points,4,btScalar(0.));
+			return true;
+		}
+	case SPHERE_SHAPE_PROXYTYPE:
+		{
+			setCircle(((const btSphereShape*)shape)->getRadius());
+			return true;
+		}
+	case CYLINDER_SHAPE_PROXYTYPE:
+		{
+			const btCylinderShape* cylinder = (const btCylinderShape*)shape;
+			if (cylinder->getUpAxis()==2)
+			{
+				setCircle(cylinder->getRadius());
+				return true;
+			}
+			break;
+		}
+	case CONVEX_HULL_SHAPE_PROXYTYPE:
+		{
+			const btConvexHullShape* hull = (const btConvexHullShape*)shape;
+			btAlignedObjectArray<btVector2> points;
+			points.resize(hull->getNumPoints());
+			for (int i=0;i<hull->getNumPoints();i++)
+			{
+				btVector3 point = hull->getScaledPoint(i);
+				points[i] = btVector2(point.getX(),point.getY());
+			}
+			if (points.size())
+			{
+				setPolygon(&points[0],points.size(),hull->getMargin());
+				return true;
+			}
+			return false;
+		}
+	case CONVEX_2D_SHAPE_PROXYTYPE:
+		{
+			return setCollisionShape(((const btConvex2dShape*)shape)->getChildShape());
+		}
+	default:
+		break;
+	}
+
+	if (shape->isConvex())
+	{
+		//sample the support mapping in the X-Y plane
+		const btConvexShape* convex = (const btConvexShape*)shape;
+		btVector2 points[BT_SHAPE2D_MAX_VERTICES];
+		for (int d=0;d<BT_SHAPE2D_MAX_VERTICES;d++)
+		{
+			btScalar angle = SIMD_2_PI*btScalar(d)/btScalar(BT_SHAPE2D_MAX_VERTICES);
+			btVector3 support = convex->localGetSupportingVertex(btVector3(btCos(angle),btSin(angle),0));
+			points[d] = btVector2(support.getX(),support.getY());
+		}
+		setPolygon(points,BT_SHAPE2D_MAX_VERTICES,btScalar(0.));
+		return true;
+	}
+	return false;
+}
+
+void	btShape2d::getAabb(const btTransform2& xf,btVector2& aabbMin,btVector2& aabbMax) const
+{
+	if (m_type==BT_SHAPE2D_CIRCLE)
+	{
+		aabbMin = btVector2(xf.m_origin.m_x-m_radius,xf.m_origin.m_y-m_radius);
+		aabbMax = btVector2(xf.m_origin.m_x+m_radius,xf.m_origin.m_y+m_radius);
+		return;
+	}
+	btVector2 v = xf(m_vertices[0]);
+	aabbMin = v;
+	aabbMax = v;
+	for (int i=1;i<m_numVertices;i++)
+	{
+		v = xf(m_vertices[i]);
+		btSetMin(aabbMin.m_x,v.m_x);
+		btSetMin(aabbMin.m_y,v.m_y);
+		btSetMax(aabbMax.m_x,v.m_x);
+		btSetMax(aabbMax.m_y,v.m_y);
+	}
+	aabbMin = aabbMin - btVector2(m_radius,m_radius);
+	aabbMax = aabbMax + btVector2(m_radius,m_radius);
+}
+
+///the shape vertices and edge normals in world space
+struct btWorldPolygon2d
+{
+	int			m_count;
+	btVector2	m_vertices[BT_SHAPE2D_MAX_VERTICES];
+	btVector2	m_normals[BT_SHAPE2D_MAX_VERTICES];
+
+	btWorldPolygon2d(const btShape2d& shape,const btTransform2& xf)
+		:m_count(shape.m_numVertices)
+	{
+		for (int i=0;i<m_count;i++)
+		{
+			m_vertices[i] = xf(shape.m_vertices[i]);
+			m_normals[i] = xf.rotate(shape.m_normals[i]);
+		}
+	}
+};
+
+///largest separation along the edge normals of poly1
+static btScalar	btFindMaxSeparation2d(int& edgeIndex,const btWorldPolygon2d& poly1,const btWorldPolygon2d& poly2)
+{
+	btScalar maxSeparation = -BT_LARGE_FLOAT;
+	int bestIndex = 0;
+	for (int i=0;i<poly1.m_count;i++)
+	{
+		const btVector2& n = poly1.m_normals[i];
+		const btVector2& v1 = poly1.m_vertices[i];
+		btScalar si = BT_LARGE_FLOAT;
+		for (int j=0;j<poly2.m_count;j++)
+		{
+			btScalar sij = n.dot(poly2.m_vertices[j]-v1);
+			if (sij < si)
+				si = sij;
+		}
+		if (si > maxSeparation)
+		{
+			maxSeparation = si;
+			bestIndex = i;
+		}
+	}
+	edgeIndex = bestIndex;
+	return maxSeparation;
+}
+
+struct btClipVertex2d
+{
+	btVector2		m_v;
+	unsigned int	m_id;
+};
+
+static int	btClipSegmentToLine2d(btClipVertex2d vOut[2],const btClipVertex2d vIn[2],const btVector2& normal,btScalar offset,unsigned int clipId)
+{
+	int numOut = 0;
+	btScalar distance0 = normal.dot(vIn[0].m_v) - offset;
+	btScalar distance1 = normal.dot(vIn[1].m_v) - offset;
+
+	if (distance0 <= btScalar(0.)) vOut[numOut++] = vIn[0];
+	if (distance1 <= btScalar(0.)) vOut[numOut++] = vIn[1];
+
+	if (distance0 * distance1 < btScalar(0.))
+	{
+		btScalar interp = distance0 / (distance0 - distance1);
+		vOut[numOut].m_v = vIn[0].m_v + (vIn[1].m_v - vIn[0].m_v)*interp;
+		vOut[numOut].m_id = clipId;
+		++numOut;
+	}
+	return numOut;
+}
+
+static void	btAddPoint2d(btManifold2d& manifold,const btVector2& position,btScalar separation,unsigned int id)
+{
+	btManifoldPoint2d& pt = manifold.m_points[manifold.m_numPoints++];
+	pt.m_position = position;
+	pt.m_separation = separation;
+	pt.m_id = id;
+	pt.m_normalImpulse = btScalar(0.);
+	pt.m_tangentImpulse = btScalar(0.);
+}
+
+static void	btCollidePolygons2d(const btShape2d& shapeA,const btTransform2& xfA,const btShape2d& shapeB,const btTransform2& xfB,btScalar contactThreshold,btManifold2d& manifold)
+{
+	btWorldPolygon2d polyA(shapeA,xfA);
+	btWorldPolygon2d polyB(shapeB,xfB);
+	btScalar totalRadius = shapeA.m_radius + shapeB.m_radius;
+
+	int edgeA = 0;
+	btScalar separationA = btFindMaxSeparation2d(edgeA,polyA,polyB);
+	if (separationA > totalRadius + contactThreshold)
+		return;
+
+	int edgeB = 0;
+	btScalar separationB = btFindMaxSeparation2d(edgeB,polyB,polyA);
+	if (separationB > totalRadius + contactThreshold)
+		return;
+
+	//prefer A as the reference, so the choice doesn't flip from frame to frame
+	const btScalar relativeTol = btScalar(0.98);
+	const btScalar absoluteTol = btScalar(0.001);
+	const btWorldPolygon2d* poly1;
+	const btWorldPolygon2d* poly2;
+	btScalar radius1,radius2;
+	int edge1;
+	bool flip;
+	if (separationB > relativeTol * separationA + absoluteTol)
+	{
+		poly1 = &polyB;
+		poly2 = &polyA;
+		radius1 = shapeB.m_radius;
+		radius2 = shapeA.m_radius;
+		edge1 = edgeB;
+		flip = true;
+	}
+	else
+	{
+		poly1 = &polyA;
+		poly2 = &polyB;
+		radius1 = shapeA.m_radius;
+		radius2 = shapeB.m_radius;
+		edge1 = edgeA;
+		flip = false;
+	}
+
+	//the incident edge is the edge of poly2 most anti-parallel to the reference normal
+	const btVector2& normal = poly1->m_normals[edge1];
+	int incidentEdge = 0;
+	btScalar minDot = BT_LARGE_FLOAT;
+	for (int i=0;i<poly2->m_count;i++)
+	{
+		btScalar dot = normal.dot(poly2->m_normals[i]);
+		if (dot < minDot)
+		{
+			minDot = dot;
+			incidentEdge = i;
+		}
+	}
+	int i1 = incidentEdge;
+	int i2 = (i1+1) % poly2->m_count;
+
+	unsigned int flipBit = flip ? 0x1000000 : 0;
+	btClipVertex2d incident[2];
+	incident[0].m_v = poly2->m_vertices[i1];
+	incident[0].m_id = flipBit | (unsigned(edge1)<<16) | unsigned(i1);
+	incident[1].m_v = poly2->m_vertices[i2];
+	incident[1].m_id = flipBit | (unsigned(edge1)<<16) | unsigned(i2);
+
+	const btVector2& v11 = poly1->m_vertices[edge1];
+	const btVector2& v12 = poly1->m_vertices[(edge1+1) % poly1->m_count];
+	btVector2 tangent(-normal.m_y,normal.m_x);
+
+	btScalar frontOffset = normal.dot(v11);
+	btScalar sideOffset1 = -tangent.dot(v11) + totalRadius;
+	btScalar sideOffset2 = tangent.dot(v12) + totalRadius;
+
+	//clipped points are identified by the side plane of the reference edge that cut them
+	btClipVertex2d clipPoints1[2];
+	btClipVertex2d clipPoints2[2];
+	int np = btClipSegmentToLine2d(clipPoints1,incident,-tangent,sideOffset1,flipBit | (unsigned(edge1)<<16) | 0x100);
+	if (np < 2)
+		return;
+	np = btClipSegmentToLine2d(clipPoints2,clipPoints1,tangent,sideOffset2,flipBit | (unsigned(edge1)<<16) | 0x200);
+	if (np < 2)
+		return;
+
+	manifold.m_normal = flip ? -normal : normal;
+	for (int i=0;i<2;i++)
+	{
+		btScalar separation = normal.dot(clipPoints2[i].m_v) - frontOffset;
+		if (separation <= totalRadius + contactThreshold)
+		{
+			//midway between the reference and incident surfaces
+			btVector2 onIncident = clipPoints2[i].m_v - normal*radius2;
+			btVector2 onReference = clipPoints2[i].m_v + normal*(radius1 - separation);
+			btAddPoint2d(manifold,(onIncident+onReference)*btScalar(0.5),separation - totalRadius,clipPoints2[i].m_id);
+		}
+	}
+}
+
+///the normal points from the polygon to the circle
+static void	btCollidePolygonCircle2d(const btShape2d& polygon,const btTransform2& xfA,const btShape2d& circle,const btTransform2& xfB,btScalar contactThreshold,btManifold2d& manifold,bool flip)
+{
+	//circle center in the polygon frame
+	btVector2 c = xfA.invXform(xfB.m_origin);
+	btScalar totalRadius = polygon.m_radius + circle.m_radius;
+
+	int normalIndex = 0;
+	btScalar separation = -BT_LARGE_FLOAT;
+	for (int i=0;i<polygon.m_numVertices;i++)
+	{
+		btScalar s = polygon.m_normals[i].dot(c - polygon.m_vertices[i]);
+		if (s > totalRadius + contactThreshold)
+			return;
+		if (s > separation)
+		{
+			separation = s;
+			normalIndex = i;
+		}
+	}
+
+	int vertIndex1 = normalIndex;
+	int vertIndex2 = (vertIndex1+1) % polygon.m_numVertices;
+	const btVector2& v1 = polygon.m_vertices[vertIndex1];
+	const btVector2& v2 = polygon.m_vertices[vertIndex2];
+
+	btVector2 localNormal;
+	btVector2 localPoint;//on the polygon core
+	btScalar distance;
+	unsigned int id;
+	btScalar u1 = (c - v1).dot(v2 - v1);
+	btScalar u2 = (c - v2).dot(v1 - v2);
+	if (separation > SIMD_EPSILON && u1 <= btScalar(0.))
+	{
+		distance = btSqrt((c - v1).length2());
+		if (distance > totalRadius + contactThreshold)
+			return;
+		localNormal = distance < SIMD_EPSILON ? polygon.m_normals[normalIndex] : (c - v1)*(btScalar(1.)/distance);
+		localPoint = v1;
+		id = 0x10000 | unsigned(vertIndex1);
+	}
+	else if (separation > SIMD_EPSILON && u2 <= btScalar(0.))
+	{
+		distance = btSqrt((c - v2).length2());
+		if (distance > totalRadius + contactThreshold)
+			return;
+		localNormal = distance < SIMD_EPSILON ? polygon.m_normals[normalIndex] : (c - v2)*(btScalar(1.)/distance);
+		localPoint = v2;
+		id = 0x10000 | unsigned(vertIndex2);
+	}
+	else
+	{
+		//face region, or the center is inside the polygon
+		distance = separation;
+		localNormal = polygon.m_normals[normalIndex];
+		localPoint = c - localNormal*separation;
+		id = unsigned(normalIndex);
+	}
+
+	btVector2 normal = xfA.rotate(localNormal);
+	btVector2 onPolygon = xfA(localPoint) + normal*polygon.m_radius;
+	btVector2 onCircle = xfB.m_origin - normal*circle.m_radius;
+	manifold.m_normal = flip ? -normal : normal;
+	btAddPoint2d(manifold,(onPolygon+onCircle)*btScalar(0.5),distance - totalRadius,id);
+}
+
+static void	btCollideCircles2d(const btShape2d& circleA,const btTransform2& xfA,const btShape2d& circleB,const btTransform2& xfB,btScalar contactThreshold,btManifold2d& manifold)
+{
+	btVector2 d = xfB.m_origin - xfA.m_origin;
+	btScalar totalRadius = circleA.m_radius + circleB.m_radius;
+	btScalar dist2 = d.length2();
+	btScalar maxDist = totalRadius + contactThreshold;
+	if (dist2 > maxDist*maxDist)
+		return;
+	btScalar dist = btSqrt(dist2);
+	btVector2 normal = dist > SIMD_EPSILON ? d*(btScalar(1.)/dist) : btVector2(btScalar(0.),btScalar(1.));
+	btVector2 onA = xfA.m_origin + normal*circleA.m_radius;
+	btVector2 onB = xfB.m_origin - normal*circleB.m_radius;
+	manifold.m_normal = normal;
+	btAddPoint2d(manifold,(onA+onB)*btScalar(0.5),dist - totalRadius,0);
+}
+
+void	btCollideShapes2d(const btShape2d& shapeA,const btTransform2& xfA,const btShape2d& shapeB,const btTransform2& xfB,btScalar contactThreshold,btManifold2d& manifold)
+{
+	manifold.m_numPoints = 0;
+	if (shapeA.m_type==BT_SHAPE2D_POLYGON)
+	{
+		if (shapeB.m_type==BT_SHAPE2D_POLYGON)
+			btCollidePolygons2d(shapeA,xfA,shapeB,xfB,contactThreshold,manifold);
+		else
+			btCollidePolygonCircle2d(shapeA,xfA,shapeB,xfB,contactThreshold,manifold,false);
+	}
+	else
+	{
+		if (shapeB.m_type==BT_SHAPE2D_POLYGON)
+			btCollidePolygonCircle2d(shapeB,xfB,shapeA,xfA,contactThreshold,manifold,true);
+		else
+			btCollideCircles2d(shapeA,xfA,shapeB,xfB,contactThreshold,manifold);
+	}
+}
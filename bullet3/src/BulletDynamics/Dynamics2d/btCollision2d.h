@@ -0,0 +1,121 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_COLLISION_2D_H
+#define BT_COLLISION_2D_H
+
+#include "LinearMath/btScalar.h"
+#include "LinearMath/btMinMax.h"
+
+class btCollisionShape;
+
+///maximum number of vertices of a btShape2d polygon. Hulls with more vertices are approximated
+#define BT_SHAPE2D_MAX_VERTICES 16
+#define BT_MANIFOLD2D_MAX_POINTS 2
+
+///btVector2 is the minimal 2D vector used by the planar pipeline
+struct btVector2
+{
+	btScalar	m_x;
+	btScalar	m_y;
+
+	SIMD_FORCE_INLINE btVector2() {}
+	SIMD_FORCE_INLINE btVector2(btScalar x,btScalar y) : m_x(x),m_y(y) {}
+
+	SIMD_FORCE_INLINE btVector2 operator+(const btVector2& v) const { return btVector2(m_x+v.m_x,m_y+v.m_y); }
+	SIMD_FORCE_INLINE btVector2 operator-(const btVector2& v) const { return btVector2(m_x-v.m_x,m_y-v.m_y); }
+	SIMD_FORCE_INLINE btVector2 operator-() const { return btVector2(-m_x,-m_y); }
+	SIMD_FORCE_INLINE btVector2 operator*(btScalar s) const { return btVector2(m_x*s,m_y*s); }
+	SIMD_FORCE_INLINE btScalar dot(const btVector2& v) const { return m_x*v.m_x+m_y*v.m_y; }
+	///z component of the 3D cross product
+	SIMD_FORCE_INLINE btScalar cross(const btVector2& v) const { return m_x*v.m_y-m_y*v.m_x; }
+	SIMD_FORCE_INLINE btScalar length2() const { return dot(*this); }
+};
+
+///btTransform2 is a position and a rotation, stored as cosine and sine of the angle
+struct btTransform2
+{
+	btVector2	m_origin;
+	btScalar	m_cos;
+	btScalar	m_sin;
+
+	SIMD_FORCE_INLINE btTransform2() {}
+	SIMD_FORCE_INLINE btTransform2(btScalar x,btScalar y,btScalar angle) : m_origin(x,y),m_cos(btCos(angle)),m_sin(btSin(angle)) {}
+
+	SIMD_FORCE_INLINE btVector2 rotate(const btVector2& v) const { return btVector2(m_cos*v.m_x-m_sin*v.m_y,m_sin*v.m_x+m_cos*v.m_y); }
+	SIMD_FORCE_INLINE btVector2 inverseRotate(const btVector2& v) const { return btVector2(m_cos*v.m_x+m_sin*v.m_y,-m_sin*v.m_x+m_cos*v.m_y); }
+	SIMD_FORCE_INLINE btVector2 operator()(const btVector2& v) const { return rotate(v)+m_origin; }
+	SIMD_FORCE_INLINE btVector2 invXform(const btVector2& v) const { return inverseRotate(v-m_origin); }
+};
+
+enum btShape2dType
+{
+	BT_SHAPE2D_CIRCLE,
+	BT_SHAPE2D_POLYGON
+};
+
+///btShape2d is the planar form of a 2D btCollisionShape: a circle, or a convex polygon with an optional rounding radius.
+///It is built once per btCollisionShape by btDynamicsWorld2d
+struct btShape2d
+{
+	int			m_type;
+	int			m_numVertices;
+	btScalar	m_radius;//circle radius, or rounding of the polygon
+	btVector2	m_vertices[BT_SHAPE2D_MAX_VERTICES];//counter-clockwise
+	btVector2	m_normals[BT_SHAPE2D_MAX_VERTICES];//outward normal of the edge from vertex i to vertex i+1
+	btScalar	m_area;
+	btScalar	m_inertiaPerMass;//about the shape origin, which is the center of rotation of the body
+
+	btShape2d()
+		:m_type(BT_SHAPE2D_CIRCLE),
+		m_numVertices(0),
+		m_radius(0),
+		m_area(0),
+		m_inertiaPerMass(0)
+	{
+	}
+
+	void	setCircle(btScalar radius);
+
+	///setPolygon takes the convex hull of the points in the X-Y plane
+	void	setPolygon(const btVector2* points,int numPoints,btScalar radius);
+
+	///supports btBox2dShape, btSphereShape, and btConvex2dShape around a btBoxShape, btConvexHullShape, btCylinderShapeZ or another convex shape.
+	///Returns false for shapes that have no planar form, such as concave shapes
+	bool	setCollisionShape(const btCollisionShape* shape);
+
+	void	getAabb(const btTransform2& xf,btVector2& aabbMin,btVector2& aabbMax) const;
+};
+
+struct btManifoldPoint2d
+{
+	btVector2		m_position;//world space, midway between the two surfaces
+	btScalar		m_separation;//negative when penetrating
+	unsigned int	m_id;//the pair of features in contact, to carry impulses over from the previous step
+	btScalar		m_normalImpulse;
+	btScalar		m_tangentImpulse;
+};
+
+struct btManifold2d
+{
+	btVector2			m_normal;//world space, pointing from shape A to shape B
+	int					m_numPoints;
+	btManifoldPoint2d	m_points[BT_MANIFOLD2D_MAX_POINTS];
+};
+
+///btCollideShapes2d computes the contact points between two planar shapes that are closer than contactThreshold
+void	btCollideShapes2d(const btShape2d& shapeA,const btTransform2& xfA,const btShape2d& shapeB,const btTransform2& xfB,btScalar contactThreshold,btManifold2d& manifold);
+
+#endif //BT_COLLISION_2D_H
@@ -0,0 +1,660 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btDynamicsWorld2d.h"
+#include "BulletCollision/CollisionShapes/btCollisionShape.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include "LinearMath/btQuickprof.h"
+
+//same limit as btManifoldResult::calculateCombinedFriction
+#define BT_MAX_FRICTION_2D btScalar(10.)
+
+template <typename T>
+static void	btMoveLastTo(btAlignedObjectArray<T>& array,int index)
+{
+	int last = array.size()-1;
+	if (index != last)
+		array[index] = array[last];
+	array.pop_back();
+}
+
+btDynamicsWorld2d::btDynamicsWorld2d()
+	:m_gravity(btScalar(0.),btScalar(-10.)),
+	m_contactBreakingThreshold(gContactBreakingThreshold),
+	m_localTime(btScalar(0.)),
+	m_stepCount(0)
+{
+}
+
+btDynamicsWorld2d::~btDynamicsWorld2d()
+{
+}
+
+int	btDynamicsWorld2d::getShapeIndex(const btCollisionShape* shape)
+{
+	int* found = m_shapeMap.find(btHashPtr(shape));
+	if (found)
+		return *found;
+
+	btShape2d shape2d;
+	if (!shape2d.setCollisionShape(shape))
+		return -1;
+	int index = m_shapes.size();
+	m_shapes.push_back(shape2d);
+	m_shapeMap.insert(btHashPtr(shape),index);
+	return index;
+}
+
+int	btDynamicsWorld2d::addBody(const btCollisionShape* shape,btScalar mass,const btVector2& position,btScalar angle,int collisionFilterGroup,int collisionFilterMask)
+{
+	int shapeIndex = getShapeIndex(shape);
+	if (shapeIndex < 0)
+		return -1;
+
+	int bodyId;
+	if (m_freeBodyIds.size())
+	{
+		bodyId = m_freeBodyIds[m_freeBodyIds.size()-1];
+		m_freeBodyIds.pop_back();
+	} else
+	{
+		bodyId = m_bodyIndex.size();
+		m_bodyIndex.push_back(-1);
+	}
+	int index = m_bodyId.size();
+	m_bodyIndex[bodyId] = index;
+	m_bodyId.push_back(bodyId);
+
+	const btShape2d& shape2d = m_shapes[shapeIndex];
+	btScalar inertia = mass*shape2d.m_inertiaPerMass;
+	m_positionX.push_back(position.m_x);
+	m_positionY.push_back(position.m_y);
+	m_angle.push_back(angle);
+	m_cos.push_back(btCos(angle));
+	m_sin.push_back(btSin(angle));
+	m_linearVelocityX.push_back(btScalar(0.));
+	m_linearVelocityY.push_back(btScalar(0.));
+	m_angularVelocity.push_back(btScalar(0.));
+	m_pushVelocityX.push_back(btScalar(0.));
+	m_pushVelocityY.push_back(btScalar(0.));
+	m_turnVelocity.push_back(btScalar(0.));
+	m_inverseMass.push_back(mass > btScalar(0.) ? btScalar(1.)/mass : btScalar(0.));
+	m_inverseInertia.push_back(inertia > btScalar(0.) ? btScalar(1.)/inertia : btScalar(0.));
+	m_friction.push_back(btScalar(0.5));
+	m_restitution.push_back(btScalar(0.));
+	m_linearDamping.push_back(btScalar(0.));
+	m_angularDamping.push_back(btScalar(0.));
+	m_aabbMinX.push_back(btScalar(0.));
+	m_aabbMinY.push_back(btScalar(0.));
+	m_aabbMaxX.push_back(btScalar(0.));
+	m_aabbMaxY.push_back(btScalar(0.));
+	m_shapeIndex.push_back(shapeIndex);
+	m_collisionFilterGroup.push_back(collisionFilterGroup);
+	m_collisionFilterMask.push_back(collisionFilterMask);
+	m_sortedBodies.push_back(index);
+
+	setTransform(bodyId,position,angle);
+	return bodyId;
+}
+
+void	btDynamicsWorld2d::removeBody(int bodyId)
+{
+	int index = m_bodyIndex[bodyId];
+	btAssert(index >= 0);
+
+	for (int i=0;i<m_contacts.size();)
+	{
+		btContact2d& contact = m_contacts[i];
+		if (contact.m_pair.m_bodyIdA == bodyId || contact.m_pair.m_bodyIdB == bodyId)
+		{
+			m_contactMap.remove(contact.m_pair);
+			btMoveLastTo(m_contacts,i);
+			if (i < m_contacts.size())
+				m_contactMap.insert(m_contacts[i].m_pair,i);
+		} else
+		{
+			i++;
+		}
+	}
+
+	//keep the sort order, and rename the last body which is moved into the free slot
+	int last = m_bodyId.size()-1;
+	int sortedIndex = m_sortedBodies.findLinearSearch(index);
+	for (int i=sortedIndex;i<m_sortedBodies.size()-1;i++)
+		m_sortedBodies[i] = m_sortedBodies[i+1];
+	m_sortedBodies.pop_back();
+	if (index != last)
+	{
+		m_sortedBodies[m_sortedBodies.findLinearSearch(last)] = index;
+		for (int i=0;i<m_contacts.size();i++)
+		{
+			if (m_contacts[i].m_indexA == last)
+				m_contacts[i].m_indexA = index;
+			if (m_contacts[i].m_indexB == last)
+				m_contacts[i].m_indexB = index;
+		}
+		m_bodyIndex[m_bodyId[last]] = index;
+	}
+
+	btMoveLastTo(m_positionX,index);
+	btMoveLastTo(m_positionY,index);
+	btMoveLastTo(m_angle,index);
+	btMoveLastTo(m_cos,index);
+	btMoveLastTo(m_sin,index);
+	btMoveLastTo(m_linearVelocityX,index);
+	btMoveLastTo(m_linearVelocityY,index);
+	btMoveLastTo(m_angularVelocity,index);
+	btMoveLastTo(m_pushVelocityX,index);
+	btMoveLastTo(m_pushVelocityY,index);
+	btMoveLastTo(m_turnVelocity,index);
+	btMoveLastTo(m_inverseMass,index);
+	btMoveLastTo(m_inverseInertia,index);
+	btMoveLastTo(m_friction,index);
+	btMoveLastTo(m_restitution,index);
+	btMoveLastTo(m_linearDamping,index);
+	btMoveLastTo(m_angularDamping,index);
+	btMoveLastTo(m_aabbMinX,index);
+	btMoveLastTo(m_aabbMinY,index);
+	btMoveLastTo(m_aabbMaxX,index);
+	btMoveLastTo(m_aabbMaxY,index);
+	btMoveLastTo(m_shapeIndex,index);
+	btMoveLastTo(m_collisionFilterGroup,index);
+	btMoveLastTo(m_collisionFilterMask,index);
+	btMoveLastTo(m_bodyId,index);
+
+	m_bodyIndex[bodyId] = -1;
+	m_freeBodyIds.push_back(bodyId);
+}
+
+void	btDynamicsWorld2d::setTransform(int bodyId,const btVector2& position,btScalar angle)
+{
+	int index = m_bodyIndex[bodyId];
+	m_positionX[index] = position.m_x;
+	m_positionY[index] = position.m_y;
+	m_angle[index] = angle;
+	m_cos[index] = btCos(angle);
+	m_sin[index] = btSin(angle);
+
+	btTransform2 xf;
+	xf.m_origin = position;
+	xf.m_cos = m_cos[index];
+	xf.m_sin = m_sin[index];
+	btVector2 aabbMin,aabbMax;
+	m_shapes[m_shapeIndex[index]].getAabb(xf,aabbMin,aabbMax);
+	m_aabbMinX[index] = aabbMin.m_x - m_contactBreakingThreshold;
+	m_aabbMinY[index] = aabbMin.m_y - m_contactBreakingThreshold;
+	m_aabbMaxX[index] = aabbMax.m_x + m_contactBreakingThreshold;
+	m_aabbMaxY[index] = aabbMax.m_y + m_contactBreakingThreshold;
+}
+
+int	btDynamicsWorld2d::stepSimulation(btScalar timeStep,int maxSubSteps,btScalar fixedTimeStep)
+{
+	int numSimulationSubSteps = 0;
+
+	if (maxSubSteps)
+	{
+		//fixed timestep
+		m_localTime += timeStep;
+		if (m_localTime >= fixedTimeStep)
+		{
+			numSimulationSubSteps = int( m_localTime / fixedTimeStep);
+			m_localTime -= numSimulationSubSteps * fixedTimeStep;
+		}
+	} else
+	{
+		//variable timestep
+		fixedTimeStep = timeStep;
+		m_localTime = timeStep;
+		if (btFuzzyZero(timeStep))
+		{
+			numSimulationSubSteps = 0;
+			maxSubSteps = 0;
+		} else
+		{
+			numSimulationSubSteps = 1;
+			maxSubSteps = 1;
+		}
+	}
+
+	if (numSimulationSubSteps)
+	{
+		//clamp the number of substeps, to prevent simulation grinding spiralling down to a halt
+		int clampedSimulationSteps = (numSimulationSubSteps > maxSubSteps)? maxSubSteps : numSimulationSubSteps;
+		for (int i=0;i<clampedSimulationSteps;i++)
+		{
+			internalSingleStepSimulation(fixedTimeStep);
+		}
+	}
+	return numSimulationSubSteps;
+}
+
+void	btDynamicsWorld2d::internalSingleStepSimulation(btScalar timeStep)
+{
+	BT_PROFILE("internalSingleStepSimulation2d");
+
+	m_stepCount++;
+	m_solverInfo.m_timeStep = timeStep;
+
+	integrateVelocities(timeStep);
+	updateAabbs();
+	findPairs();
+	computeContacts();
+	{
+		BT_PROFILE("solveContacts2d");
+		setupContacts(timeStep);
+		for (int iteration=0;iteration<m_solverInfo.m_numIterations;iteration++)
+		{
+			solveContacts();
+		}
+		if (m_solverInfo.m_splitImpulse)
+		{
+			solveSplitImpulse();
+		}
+	}
+	integratePositions(timeStep);
+}
+
+void	btDynamicsWorld2d::integrateVelocities(btScalar timeStep)
+{
+	BT_PROFILE("integrateVelocities2d");
+	btScalar gravityX = m_gravity.m_x*timeStep;
+	btScalar gravityY = m_gravity.m_y*timeStep;
+	for (int i=0;i<m_bodyId.size();i++)
+	{
+		if (m_inverseMass[i] == btScalar(0.))
+			continue;
+		m_linearVelocityX[i] += gravityX;
+		m_linearVelocityY[i] += gravityY;
+		//same damping as btRigidBody::applyDamping
+		if (m_linearDamping[i] > btScalar(0.))
+		{
+			btScalar damping = btPow(btScalar(1.)-m_linearDamping[i],timeStep);
+			m_linearVelocityX[i] *= damping;
+			m_linearVelocityY[i] *= damping;
+		}
+		if (m_angularDamping[i] > btScalar(0.))
+		{
+			m_angularVelocity[i] *= btPow(btScalar(1.)-m_angularDamping[i],timeStep);
+		}
+	}
+}
+
+void	btDynamicsWorld2d::updateAabbs()
+{
+	BT_PROFILE("updateAabbs2d");
+	btTransform2 xf;
+	btVector2 aabbMin,aabbMax;
+	for (int i=0;i<m_bodyId.size();i++)
+	{
+		//static bodies only move through setTransform, which updates their bounds
+		if (m_inverseMass[i] == btScalar(0.))
+			continue;
+		xf.m_origin = btVector2(m_positionX[i],m_positionY[i]);
+		xf.m_cos = m_cos[i];
+		xf.m_sin = m_sin[i];
+		m_shapes[m_shapeIndex[i]].getAabb(xf,aabbMin,aabbMax);
+		m_aabbMinX[i] = aabbMin.m_x - m_contactBreakingThreshold;
+		m_aabbMinY[i] = aabbMin.m_y - m_contactBreakingThreshold;
+		m_aabbMaxX[i] = aabbMax.m_x + m_contactBreakingThreshold;
+		m_aabbMaxY[i] = aabbMax.m_y + m_contactBreakingThreshold;
+	}
+}
+
+void	btDynamicsWorld2d::addPair(int indexA,int indexB)
+{
+	if (m_inverseMass[indexA] == btScalar(0.) && m_inverseMass[indexB] == btScalar(0.))
+		return;
+	if (!(m_collisionFilterGroup[indexA] & m_collisionFilterMask[indexB]) || !(m_collisionFilterGroup[indexB] & m_collisionFilterMask[indexA]))
+		return;
+
+	if (m_bodyId[indexA] > m_bodyId[indexB])
+		btSwap(indexA,indexB);
+	btBodyPair2d pair(m_bodyId[indexA],m_bodyId[indexB]);
+	int* found = m_contactMap.find(pair);
+	int contactIndex;
+	if (found)
+	{
+		contactIndex = *found;
+	} else
+	{
+		contactIndex = m_contacts.size();
+		m_contacts.push_back(btContact2d(pair));
+		m_contactMap.insert(pair,contactIndex);
+	}
+	btContact2d& contact = m_contacts[contactIndex];
+	contact.m_indexA = indexA;
+	contact.m_indexB = indexB;
+	contact.m_lastStep = m_stepCount;
+}
+
+void	btDynamicsWorld2d::findPairs()
+{
+	BT_PROFILE("findPairs2d");
+	//the order only changes a little from one step to the next, so an insertion sort is close to linear
+	const int numBodies = m_sortedBodies.size();
+	for (int i=1;i<numBodies;i++)
+	{
+		int body = m_sortedBodies[i];
+		btScalar key = m_aabbMinX[body];
+		int j = i-1;
+		while (j >= 0 && m_aabbMinX[m_sortedBodies[j]] > key)
+		{
+			m_sortedBodies[j+1] = m_sortedBodies[j];
+			j--;
+		}
+		m_sortedBodies[j+1] = body;
+	}
+
+	for (int i=0;i<numBodies;i++)
+	{
+		int indexA = m_sortedBodies[i];
+		btScalar maxX = m_aabbMaxX[indexA];
+		btScalar minY = m_aabbMinY[indexA];
+		btScalar maxY = m_aabbMaxY[indexA];
+		for (int j=i+1;j<numBodies;j++)
+		{
+			int indexB = m_sortedBodies[j];
+			if (m_aabbMinX[indexB] > maxX)
+				break;
+			if (m_aabbMinY[indexB] > maxY || m_aabbMaxY[indexB] < minY)
+				continue;
+			addPair(indexA,indexB);
+		}
+	}
+
+	//remove the contacts of pairs that no longer overlap
+	for (int i=0;i<m_contacts.size();)
+	{
+		if (m_contacts[i].m_lastStep != m_stepCount)
+		{
+			m_contactMap.remove(m_contacts[i].m_pair);
+			btMoveLastTo(m_contacts,i);
+			if (i < m_contacts.size())
+				m_contactMap.insert(m_contacts[i].m_pair,i);
+		} else
+		{
+			i++;
+		}
+	}
+}
+
+void	btDynamicsWorld2d::computeContacts()
+{
+	BT_PROFILE("computeContacts2d");
+	btTransform2 xfA,xfB;
+	btManifold2d oldManifold;
+	for (int c=0;c<m_contacts.size();c++)
+	{
+		btContact2d& contact = m_contacts[c];
+		int indexA = contact.m_indexA;
+		int indexB = contact.m_indexB;
+		xfA.m_origin = btVector2(m_positionX[indexA],m_positionY[indexA]);
+		xfA.m_cos = m_cos[indexA];
+		xfA.m_sin = m_sin[indexA];
+		xfB.m_origin = btVector2(m_positionX[indexB],m_positionY[indexB]);
+		xfB.m_cos = m_cos[indexB];
+		xfB.m_sin = m_sin[indexB];
+
+		oldManifold = contact.m_manifold;
+		btCollideShapes2d(m_shapes[m_shapeIndex[indexA]],xfA,m_shapes[m_shapeIndex[indexB]],xfB,m_contactBreakingThreshold,contact.m_manifold);
+
+		//carry the impulses of the same features over from the previous step
+		btManifold2d& manifold = contact.m_manifold;
+		for (int i=0;i<manifold.m_numPoints;i++)
+		{
+			btManifoldPoint2d& pt = manifold.m_points[i];
+			for (int j=0;j<oldManifold.m_numPoints;j++)
+			{
+				if (oldManifold.m_points[j].m_id == pt.m_id)
+				{
+					pt.m_normalImpulse = oldManifold.m_points[j].m_normalImpulse;
+					pt.m_tangentImpulse = oldManifold.m_points[j].m_tangentImpulse;
+					break;
+				}
+			}
+		}
+
+		//same combination as btManifoldResult
+		contact.m_friction = btClamped(m_friction[indexA]*m_friction[indexB],-BT_MAX_FRICTION_2D,BT_MAX_FRICTION_2D);
+		contact.m_restitution = m_restitution[indexA]*m_restitution[indexB];
+	}
+}
+
+void	btDynamicsWorld2d::setupContacts(btScalar timeStep)
+{
+	const btScalar invTimeStep = btScalar(1.)/timeStep;
+	const bool warmstarting = (m_solverInfo.m_solverMode & SOLVER_USE_WARMSTARTING) != 0;
+	for (int c=0;c<m_contacts.size();c++)
+	{
+		btContact2d& contact = m_contacts[c];
+		btManifold2d& manifold = contact.m_manifold;
+		int indexA = contact.m_indexA;
+		int indexB = contact.m_indexB;
+		btScalar mA = m_inverseMass[indexA];
+		btScalar iA = m_inverseInertia[indexA];
+		btScalar mB = m_inverseMass[indexB];
+		btScalar iB = m_inverseInertia[indexB];
+		btVector2 vA(m_linearVelocityX[indexA],m_linearVelocityY[indexA]);
+		btScalar wA = m_angularVelocity[indexA];
+		btVector2 vB(m_linearVelocityX[indexB],m_linearVelocityY[indexB]);
+		btScalar wB = m_angularVelocity[indexB];
+		btVector2 cA(m_positionX[indexA],m_positionY[indexA]);
+		btVector2 cB(m_positionX[indexB],m_positionY[indexB]);
+		const btVector2 normal = manifold.m_normal;
+		const btVector2 tangent(normal.m_y,-normal.m_x);
+
+		for (int i=0;i<manifold.m_numPoints;i++)
+		{
+			btManifoldPoint2d& pt = manifold.m_points[i];
+			btContactPointSolver2d& sp = contact.m_solverPoints[i];
+			sp.m_rA = pt.m_position - cA;
+			sp.m_rB = pt.m_position - cB;
+
+			btScalar rnA = sp.m_rA.cross(normal);
+			btScalar rnB = sp.m_rB.cross(normal);
+			btScalar kNormal = mA + mB + iA*rnA*rnA + iB*rnB*rnB;
+			sp.m_normalMass = kNormal > btScalar(0.) ? btScalar(1.)/kNormal : btScalar(0.);
+
+			btScalar rtA = sp.m_rA.cross(tangent);
+			btScalar rtB = sp.m_rB.cross(tangent);
+			btScalar kTangent = mA + mB + iA*rtA*rtA + iB*rtB*rtB;
+			sp.m_tangentMass = kTangent > btScalar(0.) ? btScalar(1.)/kTangent : btScalar(0.);
+
+			//relative normal velocity, negative when the bodies approach
+			btVector2 dv = vB + btVector2(-wB*sp.m_rB.m_y,wB*sp.m_rB.m_x) - vA - btVector2(-wA*sp.m_rA.m_y,wA*sp.m_rA.m_x);
+			btScalar vn = dv.dot(normal);
+
+			//the same targets as btSequentialImpulseConstraintSolver::setupContactConstraint
+			btScalar restitution = btScalar(0.);
+			if (-vn > m_solverInfo.m_restitutionVelocityThreshold)
+				restitution = -vn*contact.m_restitution;
+
+			btScalar penetration = pt.m_separation + m_solverInfo.m_linearSlop;
+			bool split = m_solverInfo.m_splitImpulse && penetration <= m_solverInfo.m_splitImpulsePenetrationThreshold;
+			btScalar erp = split ? m_solverInfo.m_erp2 : m_solverInfo.m_erp;
+			btScalar positionalError = btScalar(0.);
+			btScalar velocityBias = restitution;
+			if (penetration > btScalar(0.))
+			{
+				//allow the bodies to approach until they touch
+				velocityBias -= penetration*invTimeStep;
+			} else
+			{
+				positionalError = -penetration*erp*invTimeStep;
+			}
+			if (split)
+			{
+				sp.m_velocityBias = velocityBias;
+				sp.m_penetrationBias = positionalError;
+			} else
+			{
+				sp.m_velocityBias = velocityBias + positionalError;
+				sp.m_penetrationBias = btScalar(0.);
+			}
+			sp.m_pushImpulse = btScalar(0.);
+
+			if (warmstarting)
+			{
+				pt.m_normalImpulse *= m_solverInfo.m_warmstartingFactor;
+				pt.m_tangentImpulse *= m_solverInfo.m_warmstartingFactor;
+				btVector2 P = normal*pt.m_normalImpulse + tangent*pt.m_tangentImpulse;
+				vA = vA - P*mA;
+				wA -= iA*sp.m_rA.cross(P);
+				vB = vB + P*mB;
+				wB += iB*sp.m_rB.cross(P);
+			} else
+			{
+				pt.m_normalImpulse = btScalar(0.);
+				pt.m_tangentImpulse = btScalar(0.);
+			}
+		}
+
+		m_linearVelocityX[indexA] = vA.m_x;
+		m_linearVelocityY[indexA] = vA.m_y;
+		m_angularVelocity[indexA] = wA;
+		m_linearVelocityX[indexB] = vB.m_x;
+		m_linearVelocityY[indexB] = vB.m_y;
+		m_angularVelocity[indexB] = wB;
+	}
+}
+
+void	btDynamicsWorld2d::solveContacts()
+{
+	//all normal constraints first, then friction, like the default btSequentialImpulseConstraintSolver order
+	for (int pass=0;pass<2;pass++)
+	{
+		for (int c=0;c<m_contacts.size();c++)
+		{
+			btContact2d& contact = m_contacts[c];
+			btManifold2d& manifold = contact.m_manifold;
+			if (!manifold.m_numPoints)
+				continue;
+			int indexA = contact.m_indexA;
+			int indexB = contact.m_indexB;
+			btScalar mA = m_inverseMass[indexA];
+			btScalar iA = m_inverseInertia[indexA];
+			btScalar mB = m_inverseMass[indexB];
+			btScalar iB = m_inverseInertia[indexB];
+			btVector2 vA(m_linearVelocityX[indexA],m_linearVelocityY[indexA]);
+			btScalar wA = m_angularVelocity[indexA];
+			btVector2 vB(m_linearVelocityX[indexB],m_linearVelocityY[indexB]);
+			btScalar wB = m_angularVelocity[indexB];
+			const btVector2 normal = manifold.m_normal;
+			const btVector2 tangent(normal.m_y,-normal.m_x);
+
+			for (int i=0;i<manifold.m_numPoints;i++)
+			{
+				btManifoldPoint2d& pt = manifold.m_points[i];
+				const btContactPointSolver2d& sp = contact.m_solverPoints[i];
+				btVector2 dv = vB + btVector2(-wB*sp.m_rB.m_y,wB*sp.m_rB.m_x) - vA - btVector2(-wA*sp.m_rA.m_y,wA*sp.m_rA.m_x);
+				btVector2 P;
+				if (pass == 0)
+				{
+					btScalar lambda = -sp.m_normalMass*(dv.dot(normal) - sp.m_velocityBias);
+					btScalar newImpulse = btMax(pt.m_normalImpulse + lambda,btScalar(0.));
+					lambda = newImpulse - pt.m_normalImpulse;
+					pt.m_normalImpulse = newImpulse;
+					P = normal*lambda;
+				} else
+				{
+					btScalar lambda = -sp.m_tangentMass*dv.dot(tangent);
+					btScalar maxFriction = contact.m_friction*pt.m_normalImpulse;
+					btScalar newImpulse = btClamped(pt.m_tangentImpulse + lambda,-maxFriction,maxFriction);
+					lambda = newImpulse - pt.m_tangentImpulse;
+					pt.m_tangentImpulse = newImpulse;
+					P = tangent*lambda;
+				}
+				vA = vA - P*mA;
+				wA -= iA*sp.m_rA.cross(P);
+				vB = vB + P*mB;
+				wB += iB*sp.m_rB.cross(P);
+			}
+
+			m_linearVelocityX[indexA] = vA.m_x;
+			m_linearVelocityY[indexA] = vA.m_y;
+			m_angularVelocity[indexA] = wA;
+			m_linearVelocityX[indexB] = vB.m_x;
+			m_linearVelocityY[indexB] = vB.m_y;
+			m_angularVelocity[indexB] = wB;
+		}
+	}
+}
+
+void	btDynamicsWorld2d::solveSplitImpulse()
+{
+	//deep penetrations are resolved with separate push velocities, that move the bodies without adding energy
+	for (int iteration=0;iteration<m_solverInfo.m_numIterations;iteration++)
+	{
+		bool anyPenetration = false;
+		for (int c=0;c<m_contacts.size();c++)
+		{
+			btContact2d& contact = m_contacts[c];
+			const btManifold2d& manifold = contact.m_manifold;
+			int indexA = contact.m_indexA;
+			int indexB = contact.m_indexB;
+			const btVector2 normal = manifold.m_normal;
+			for (int i=0;i<manifold.m_numPoints;i++)
+			{
+				btContactPointSolver2d& sp = contact.m_solverPoints[i];
+				if (sp.m_penetrationBias == btScalar(0.))
+					continue;
+				anyPenetration = true;
+				btScalar wA = m_turnVelocity[indexA];
+				btScalar wB = m_turnVelocity[indexB];
+				btVector2 dv = btVector2(m_pushVelocityX[indexB]-wB*sp.m_rB.m_y,m_pushVelocityY[indexB]+wB*sp.m_rB.m_x)
+					- btVector2(m_pushVelocityX[indexA]-wA*sp.m_rA.m_y,m_pushVelocityY[indexA]+wA*sp.m_rA.m_x);
+				btScalar lambda = sp.m_normalMass*(sp.m_penetrationBias - dv.dot(normal));
+				btScalar newImpulse = btMax(sp.m_pushImpulse + lambda,btScalar(0.));
+				lambda = newImpulse - sp.m_pushImpulse;
+				sp.m_pushImpulse = newImpulse;
+
+				btVector2 P = normal*lambda;
+				btScalar mA = m_inverseMass[indexA];
+				btScalar mB = m_inverseMass[indexB];
+				m_pushVelocityX[indexA] -= P.m_x*mA;
+				m_pushVelocityY[indexA] -= P.m_y*mA;
+				m_turnVelocity[indexA] -= m_inverseInertia[indexA]*sp.m_rA.cross(P);
+				m_pushVelocityX[indexB] += P.m_x*mB;
+				m_pushVelocityY[indexB] += P.m_y*mB;
+				m_turnVelocity[indexB] += m_inverseInertia[indexB]*sp.m_rB.cross(P);
+			}
+		}
+		if (!anyPenetration)
+			break;
+	}
+}
+
+void	btDynamicsWorld2d::integratePositions(btScalar timeStep)
+{
+	BT_PROFILE("integratePositions2d");
+	const btScalar turnErp = m_solverInfo.m_splitImpulseTurnErp;
+	for (int i=0;i<m_bodyId.size();i++)
+	{
+		if (m_inverseMass[i] == btScalar(0.))
+			continue;
+		m_positionX[i] += (m_linearVelocityX[i] + m_pushVelocityX[i])*timeStep;
+		m_positionY[i] += (m_linearVelocityY[i] + m_pushVelocityY[i])*timeStep;
+		btScalar deltaAngle = (m_angularVelocity[i] + m_turnVelocity[i]*turnErp)*timeStep;
+		if (deltaAngle != btScalar(0.))
+		{
+			m_angle[i] += deltaAngle;
+			m_cos[i] = btCos(m_angle[i]);
+			m_sin[i] = btSin(m_angle[i]);
+		}
+		m_pushVelocityX[i] = btScalar(0.);
+		m_pushVelocityY[i] = btScalar(0.);
+		m_turnVelocity[i] = btScalar(0.);
+	}
+}
@@ -0,0 +1,318 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_DYNAMICS_WORLD_2D_H
+#define BT_DYNAMICS_WORLD_2D_H
+
+#include "btCollision2d.h"
+#include "BulletDynamics/ConstraintSolver/btContactSolverInfo.h"
+#include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+
+class btCollisionShape;
+
+///btBodyPair2d is the key of a contact in btDynamicsWorld2d, made of the two body ids with the lower one first
+struct btBodyPair2d
+{
+	int	m_bodyIdA;
+	int	m_bodyIdB;
+
+	btBodyPair2d(int bodyIdA,int bodyIdB)
+		:m_bodyIdA(bodyIdA),
+		m_bodyIdB(bodyIdB)
+	{
+	}
+
+	SIMD_FORCE_INLINE unsigned int getHash() const
+	{
+		int key = m_bodyIdA | (m_bodyIdB << 16);
+		// Thomas Wang's hash
+		key += ~(key << 15);
+		key ^=  (key >> 10);
+		key +=  (key << 3);
+		key ^=  (key >> 6);
+		key += ~(key << 11);
+		key ^=  (key >> 16);
+		return unsigned(key);
+	}
+
+	SIMD_FORCE_INLINE bool equals(const btBodyPair2d& other) const
+	{
+		return m_bodyIdA == other.m_bodyIdA && m_bodyIdB == other.m_bodyIdB;
+	}
+};
+
+///btDynamicsWorld2d simulates rigid bodies that move in the X-Y plane and rotate about Z.
+///It is a lighter alternative to a btDiscreteDynamicsWorld with linear factor (1,1,0) and angular factor (0,0,1):
+///bodies are stored as arrays of 2D state, pairs are found by sort and sweep along X,
+///contacts are computed in 2D and solved by a 3 degree of freedom sequential impulse solver.
+///It uses the same btContactSolverInfo settings as the 3D solver (iterations, erp, split impulse, warmstarting and restitution threshold).
+///Bodies are created from btBox2dShape, btConvex2dShape or any other shape supported by btShape2d::setCollisionShape.
+///Constraints other than contacts, sleeping and continuous collision detection are not supported.
+class btDynamicsWorld2d
+{
+protected:
+
+	struct btContactPointSolver2d
+	{
+		btVector2	m_rA;
+		btVector2	m_rB;
+		btScalar	m_normalMass;
+		btScalar	m_tangentMass;
+		btScalar	m_velocityBias;//target normal velocity
+		btScalar	m_penetrationBias;//target normal push velocity, when split impulse is used
+		btScalar	m_pushImpulse;
+	};
+
+	struct btContact2d
+	{
+		btBodyPair2d			m_pair;
+		int						m_indexA;
+		int						m_indexB;
+		int						m_lastStep;//the last step in which the bodies overlapped
+		btScalar				m_friction;
+		btScalar				m_restitution;
+		btManifold2d			m_manifold;
+		btContactPointSolver2d	m_solverPoints[BT_MANIFOLD2D_MAX_POINTS];
+
+		btContact2d(const btBodyPair2d& pair)
+			:m_pair(pair)
+		{
+			m_manifold.m_numPoints = 0;
+		}
+	};
+
+	//body state, indexed by the dense body index
+	btAlignedObjectArray<btScalar>	m_positionX;
+	btAlignedObjectArray<btScalar>	m_positionY;
+	btAlignedObjectArray<btScalar>	m_angle;
+	btAlignedObjectArray<btScalar>	m_cos;
+	btAlignedObjectArray<btScalar>	m_sin;
+	btAlignedObjectArray<btScalar>	m_linearVelocityX;
+	btAlignedObjectArray<btScalar>	m_linearVelocityY;
+	btAlignedObjectArray<btScalar>	m_angularVelocity;
+	btAlignedObjectArray<btScalar>	m_pushVelocityX;
+	btAlignedObjectArray<btScalar>	m_pushVelocityY;
+	btAlignedObjectArray<btScalar>	m_turnVelocity;
+	btAlignedObjectArray<btScalar>	m_inverseMass;
+	btAlignedObjectArray<btScalar>	m_inverseInertia;
+	btAlignedObjectArray<btScalar>	m_friction;
+	btAlignedObjectArray<btScalar>	m_restitution;
+	btAlignedObjectArray<btScalar>	m_linearDamping;
+	btAlignedObjectArray<btScalar>	m_angularDamping;
+	btAlignedObjectArray<btScalar>	m_aabbMinX;
+	btAlignedObjectArray<btScalar>	m_aabbMinY;
+	btAlignedObjectArray<btScalar>	m_aabbMaxX;
+	btAlignedObjectArray<btScalar>	m_aabbMaxY;
+	btAlignedObjectArray<int>		m_shapeIndex;
+	btAlignedObjectArray<int>		m_collisionFilterGroup;
+	btAlignedObjectArray<int>		m_collisionFilterMask;
+	btAlignedObjectArray<int>		m_bodyId;
+
+	//body id to dense body index, -1 for free ids
+	btAlignedObjectArray<int>		m_bodyIndex;
+	btAlignedObjectArray<int>		m_freeBodyIds;
+
+	btAlignedObjectArray<btShape2d>	m_shapes;
+	btHashMap<btHashPtr,int>		m_shapeMap;
+
+	//body indices sorted by m_aabbMinX, kept between steps so the insertion sort has little to do
+	btAlignedObjectArray<int>		m_sortedBodies;
+
+	btAlignedObjectArray<btContact2d>	m_contacts;
+	btHashMap<btBodyPair2d,int>			m_contactMap;
+
+	btVector2			m_gravity;
+	btContactSolverInfo	m_solverInfo;
+	btScalar			m_contactBreakingThreshold;
+	btScalar			m_localTime;
+	int					m_stepCount;
+
+	int		getShapeIndex(const btCollisionShape* shape);
+
+	void	integrateVelocities(btScalar timeStep);
+	void	updateAabbs();
+	void	findPairs();
+	void	addPair(int indexA,int indexB);
+	void	computeContacts();
+	void	setupContacts(btScalar timeStep);
+	void	solveContacts();
+	void	solveSplitImpulse();
+	void	integratePositions(btScalar timeStep);
+
+	virtual void	internalSingleStepSimulation(btScalar timeStep);
+
+public:
+
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btDynamicsWorld2d();
+
+	virtual ~btDynamicsWorld2d();
+
+	///addBody returns a body id that stays valid until the body is removed. A mass of zero makes a static body.
+	///Returns -1 if the shape has no planar form.
+	///The shape is converted once and cached, so it must not be changed or deleted while bodies use it
+	int		addBody(const btCollisionShape* shape,btScalar mass,const btVector2& position,btScalar angle=btScalar(0.),
+				int collisionFilterGroup=btBroadphaseProxy::DefaultFilter,int collisionFilterMask=btBroadphaseProxy::AllFilter);
+
+	void	removeBody(int bodyId);
+
+	///stepSimulation takes fixed steps like btDiscreteDynamicsWorld::stepSimulation, without interpolation. Returns the number of steps taken
+	int		stepSimulation(btScalar timeStep,int maxSubSteps=1,btScalar fixedTimeStep=btScalar(1.)/btScalar(60.));
+
+	int		getNumBodies() const
+	{
+		return m_bodyId.size();
+	}
+
+	///getBodyIndex returns the index of a body in the state arrays. Indices change when bodies are removed
+	int		getBodyIndex(int bodyId) const
+	{
+		return m_bodyIndex[bodyId];
+	}
+
+	int		getBodyId(int bodyIndex) const
+	{
+		return m_bodyId[bodyIndex];
+	}
+
+	//state arrays, indexed by body index, for rendering and copying out many bodies at once
+	const btScalar*	getPositionsX() const { return m_positionX.size() ? &m_positionX[0] : 0; }
+	const btScalar*	getPositionsY() const { return m_positionY.size() ? &m_positionY[0] : 0; }
+	const btScalar*	getAngles() const { return m_angle.size() ? &m_angle[0] : 0; }
+
+	btVector2	getPosition(int bodyId) const
+	{
+		int index = m_bodyIndex[bodyId];
+		return btVector2(m_positionX[index],m_positionY[index]);
+	}
+
+	btScalar	getAngle(int bodyId) const
+	{
+		return m_angle[m_bodyIndex[bodyId]];
+	}
+
+	void	setTransform(int bodyId,const btVector2& position,btScalar angle);
+
+	btVector2	getLinearVelocity(int bodyId) const
+	{
+		int index = m_bodyIndex[bodyId];
+		return btVector2(m_linearVelocityX[index],m_linearVelocityY[index]);
+	}
+
+	void	setLinearVelocity(int bodyId,const btVector2& velocity)
+	{
+		int index = m_bodyIndex[bodyId];
+		m_linearVelocityX[index] = velocity.m_x;
+		m_linearVelocityY[index] = velocity.m_y;
+	}
+
+	btScalar	getAngularVelocity(int bodyId) const
+	{
+		return m_angularVelocity[m_bodyIndex[bodyId]];
+	}
+
+	void	setAngularVelocity(int bodyId,btScalar angularVelocity)
+	{
+		m_angularVelocity[m_bodyIndex[bodyId]] = angularVelocity;
+	}
+
+	btScalar	getInverseMass(int bodyId) const
+	{
+		return m_inverseMass[m_bodyIndex[bodyId]];
+	}
+
+	btScalar	getInverseInertia(int bodyId) const
+	{
+		return m_inverseInertia[m_bodyIndex[bodyId]];
+	}
+
+	void	applyCentralImpulse(int bodyId,const btVector2& impulse)
+	{
+		int index = m_bodyIndex[bodyId];
+		m_linearVelocityX[index] += impulse.m_x*m_inverseMass[index];
+		m_linearVelocityY[index] += impulse.m_y*m_inverseMass[index];
+	}
+
+	///same defaults as btRigidBody: friction 0.5, restitution 0, no damping
+	void	setFriction(int bodyId,btScalar friction)
+	{
+		m_friction[m_bodyIndex[bodyId]] = friction;
+	}
+
+	void	setRestitution(int bodyId,btScalar restitution)
+	{
+		m_restitution[m_bodyIndex[bodyId]] = restitution;
+	}
+
+	void	setDamping(int bodyId,btScalar linearDamping,btScalar angularDamping)
+	{
+		int index = m_bodyIndex[bodyId];
+		m_linearDamping[index] = btClamped(linearDamping,btScalar(0.),btScalar(1.));
+		m_angularDamping[index] = btClamped(angularDamping,btScalar(0.),btScalar(1.));
+	}
+
+	const btShape2d&	getShape(int bodyId) const
+	{
+		return m_shapes[m_shapeIndex[m_bodyIndex[bodyId]]];
+	}
+
+	void	setGravity(const btVector2& gravity)
+	{
+		m_gravity = gravity;
+	}
+
+	btVector2	getGravity() const
+	{
+		return m_gravity;
+	}
+
+	btContactSolverInfo&	getSolverInfo()
+	{
+		return m_solverInfo;
+	}
+
+	///contacts are kept for pairs with overlapping bounding boxes, and may have no points
+	void	setContactBreakingThreshold(btScalar threshold)
+	{
+		m_contactBreakingThreshold = threshold;
+	}
+
+	btScalar	getContactBreakingThreshold() const
+	{
+		return m_contactBreakingThreshold;
+	}
+
+	int		getNumManifolds() const
+	{
+		return m_contacts.size();
+	}
+
+	const btManifold2d&	getManifold(int index) const
+	{
+		return m_contacts[index].m_manifold;
+	}
+
+	///the normal of the manifold points from body A to body B
+	void	getManifoldBodies(int index,int& bodyIdA,int& bodyIdB) const
+	{
+		bodyIdA = m_contacts[index].m_pair.m_bodyIdA;
+		bodyIdB = m_contacts[index].m_pair.m_bodyIdB;
+	}
+};
+
+#endif //BT_DYNAMICS_WORLD_2D_H
@@ -52,6 +52,19 @@ protected:
 	
 	virtual void	serializeMultiBodies(btSerializer* serializer);
 
+	///sort the constraints on island, and set up the island callback with them
+	void	setupIslandCallback(btContactSolverInfo& solverInfo);
+	///build the islands and solve those with enough constraints, smaller islands are batched until processDeferredIslands
+	void	processIslands();
+	void	processDeferredIslands();
+
+	static bool	isMultiBodySleeping(const btMultiBody* bod);
+
+	///forward dynamics of one multibody that is awake, the scratch arrays are used as temporary storage
+	void	stepMultiBodyVelocities(btMultiBody* bod, const btContactSolverInfo& solverInfo, btAlignedObjectArray<btScalar>& scratch_r, btAlignedObjectArray<btVector3>& scratch_v, btAlignedObjectArray<btMatrix3x3>& scratch_m);
+	///integrate the positions of one multibody and update the transforms of its link colliders
+	void	integrateMultiBodyTransforms(btMultiBody* bod, btScalar timeStep, btAlignedObjectArray<btQuaternion>& scratch_world_to_local, btAlignedObjectArray<btVector3>& scratch_local_origin);
+
 public:
 
 	btMultiBodyDynamicsWorld(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btMultiBodyConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration);
@@ -0,0 +1,480 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btMultiBodyDynamicsWorldMt.h"
+#include "btMultiBody.h"
+#include "btMultiBodyLinkCollider.h"
+#include "btMultiBodyConstraint.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include "LinearMath/btQuickprof.h"
+
+
+///
+/// btMultiBodyConstraintSolverPoolMt
+///
+
+btMultiBodyConstraintSolverPoolMt::ThreadSolver* btMultiBodyConstraintSolverPoolMt::getAndLockThreadSolver()
+{
+    int i = 0;
+#if BT_THREADSAFE
+    i = btGetCurrentThreadIndex() % m_solvers.size();
+#endif // #if BT_THREADSAFE
+    while ( true )
+    {
+        ThreadSolver& solver = m_solvers[ i ];
+        if ( solver.mutex.tryLock() )
+        {
+            return &solver;
+        }
+        // failed, try the next one
+        i = ( i + 1 ) % m_solvers.size();
+    }
+    return NULL;
+}
+
+void btMultiBodyConstraintSolverPoolMt::init( btMultiBodyConstraintSolver** solvers, int numSolvers )
+{
+    m_deferGroups = false;
+    m_deferredInfo = NULL;
+    m_deferredDebugDrawer = NULL;
+    m_deferredDispatcher = NULL;
+    m_deferredSeed = 0;
+    m_solvers.resize( numSolvers );
+    for ( int i = 0; i < numSolvers; ++i )
+    {
+        m_solvers[ i ].solver = solvers[ i ];
+    }
+}
+
+// create the solvers for me
+btMultiBodyConstraintSolverPoolMt::btMultiBodyConstraintSolverPoolMt( int numSolvers )
+{
+    btAlignedObjectArray<btMultiBodyConstraintSolver*> solvers;
+    solvers.reserve( numSolvers );
+    for ( int i = 0; i < numSolvers; ++i )
+    {
+        btMultiBodyConstraintSolver* solver = new btMultiBodyConstraintSolver();
+        solvers.push_back( solver );
+    }
+    init( &solvers[ 0 ], numSolvers );
+}
+
+// pass in fully constructed solvers (destructor will delete them)
+btMultiBodyConstraintSolverPoolMt::btMultiBodyConstraintSolverPoolMt( btMultiBodyConstraintSolver** solvers, int numSolvers )
+{
+    init( solvers, numSolvers );
+}
+
+btMultiBodyConstraintSolverPoolMt::~btMultiBodyConstraintSolverPoolMt()
+{
+    // delete all solvers
+    for ( int i = 0; i < m_solvers.size(); ++i )
+    {
+        ThreadSolver& solver = m_solvers[ i ];
+        delete solver.solver;
+        solver.solver = NULL;
+    }
+}
+
+///solve a group of constraints
+btScalar btMultiBodyConstraintSolverPoolMt::solveGroup( btCollisionObject** bodies,
+    int numBodies,
+    btPersistentManifold** manifolds,
+    int numManifolds,
+    btTypedConstraint** constraints,
+    int numConstraints,
+    const btContactSolverInfo& info,
+    btIDebugDraw* debugDrawer,
+    btDispatcher* dispatcher
+)
+{
+    ThreadSolver* ts = getAndLockThreadSolver();
+    ts->solver->solveGroup( bodies, numBodies, manifolds, numManifolds, constraints, numConstraints, info, debugDrawer, dispatcher );
+    ts->mutex.unlock();
+    return 0.0f;
+}
+
+void btMultiBodyConstraintSolverPoolMt::solveMultiBodyGroup( btCollisionObject** bodies,
+    int numBodies,
+    btPersistentManifold** manifolds,
+    int numManifolds,
+    btTypedConstraint** constraints,
+    int numConstraints,
+    btMultiBodyConstraint** multiBodyConstraints,
+    int numMultiBodyConstraints,
+    const btContactSolverInfo& info,
+    btIDebugDraw* debugDrawer,
+    btDispatcher* dispatcher
+)
+{
+    if ( m_deferGroups )
+    {
+        // the island callback reuses its arrays, keep a copy of the pointers
+        DeferredGroup group;
+        group.m_bodyStart = m_deferredBodies.size();
+        group.m_manifoldStart = m_deferredManifolds.size();
+        group.m_constraintStart = m_deferredConstraints.size();
+        group.m_multiBodyConstraintStart = m_deferredMultiBodyConstraints.size();
+        group.m_numBodies = numBodies;
+        group.m_numManifolds = numManifolds;
+        group.m_numConstraints = numConstraints;
+        group.m_numMultiBodyConstraints = numMultiBodyConstraints;
+        for ( int i = 0; i < numBodies; ++i )
+        {
+            m_deferredBodies.push_back( bodies[ i ] );
+        }
+        for ( int i = 0; i < numManifolds; ++i )
+        {
+            m_deferredManifolds.push_back( manifolds[ i ] );
+        }
+        for ( int i = 0; i < numConstraints; ++i )
+        {
+            m_deferredConstraints.push_back( constraints[ i ] );
+        }
+        for ( int i = 0; i < numMultiBodyConstraints; ++i )
+        {
+            m_deferredMultiBodyConstraints.push_back( multiBodyConstraints[ i ] );
+        }
+        m_deferredGroups.push_back( group );
+        m_deferredInfo = &info;
+        m_deferredDebugDrawer = debugDrawer;
+        m_deferredDispatcher = dispatcher;
+        return;
+    }
+    ThreadSolver* ts = getAndLockThreadSolver();
+    ts->solver->solveMultiBodyGroup( bodies, numBodies, manifolds, numManifolds, constraints, numConstraints, multiBodyConstraints, numMultiBodyConstraints, info, debugDrawer, dispatcher );
+    ts->mutex.unlock();
+}
+
+void btMultiBodyConstraintSolverPoolMt::reset()
+{
+    btMultiBodyConstraintSolver::reset();
+    for ( int i = 0; i < m_solvers.size(); ++i )
+    {
+        ThreadSolver& solver = m_solvers[ i ];
+        solver.mutex.lock();
+        solver.solver->reset();
+        solver.mutex.unlock();
+    }
+}
+
+void btMultiBodyConstraintSolverPoolMt::uniteWithMultiBody( int groupIndex, const btMultiBody* multiBody )
+{
+    if ( multiBody )
+    {
+        const int* owner = m_multiBodyGroups.find( multiBody );
+        if ( owner )
+        {
+            m_unionFind.unite( groupIndex, *owner );
+        }
+        else
+        {
+            m_multiBodyGroups.insert( multiBody, groupIndex );
+        }
+    }
+}
+
+static const btMultiBody* btGetMultiBodyOfCollider( const btCollisionObject* colObj )
+{
+    const btMultiBodyLinkCollider* linkCol = btMultiBodyLinkCollider::upcast( colObj );
+    return linkCol ? linkCol->m_multiBody : NULL;
+}
+
+void btMultiBodyConstraintSolverPoolMt::buildBatches()
+{
+    // the solver writes to the scratch data of the multibodies, so groups sharing a multibody are solved in one batch
+    // (a fixed base is a static collider, the islands do not merge through it)
+    const int numGroups = m_deferredGroups.size();
+    m_unionFind.reset( numGroups );
+    m_multiBodyGroups.clear();
+    for ( int g = 0; g < numGroups; ++g )
+    {
+        const DeferredGroup& group = m_deferredGroups[ g ];
+        for ( int i = 0; i < group.m_numManifolds; ++i )
+        {
+            const btPersistentManifold* manifold = m_deferredManifolds[ group.m_manifoldStart + i ];
+            uniteWithMultiBody( g, btGetMultiBodyOfCollider( manifold->getBody0() ) );
+            uniteWithMultiBody( g, btGetMultiBodyOfCollider( manifold->getBody1() ) );
+        }
+        for ( int i = 0; i < group.m_numMultiBodyConstraints; ++i )
+        {
+            btMultiBodyConstraint* constraint = m_deferredMultiBodyConstraints[ group.m_multiBodyConstraintStart + i ];
+            uniteWithMultiBody( g, constraint->getMultiBodyA() );
+            uniteWithMultiBody( g, constraint->getMultiBodyB() );
+        }
+    }
+
+    // number the batches in the order of their first group, keeping the group order within each batch
+    m_batchOfRoot.resize( numGroups );
+    for ( int g = 0; g < numGroups; ++g )
+    {
+        m_batchOfRoot[ g ] = -1;
+    }
+    m_batchStarts.resize( 0 );
+    for ( int g = 0; g < numGroups; ++g )
+    {
+        int root = m_unionFind.find( g );
+        if ( m_batchOfRoot[ root ] < 0 )
+        {
+            m_batchOfRoot[ root ] = m_batchStarts.size();
+            m_batchStarts.push_back( 0 );
+        }
+        m_batchStarts[ m_batchOfRoot[ root ] ]++;
+    }
+    const int numBatches = m_batchStarts.size();
+    int numBatched = 0;
+    for ( int b = 0; b < numBatches; ++b )
+    {
+        int count = m_batchStarts[ b ];
+        m_batchStarts[ b ] = numBatched;
+        numBatched += count;
+    }
+    m_batchStarts.push_back( numBatched );
+    m_batchGroups.resize( numBatched );
+    m_batchFill.copyFromArray( m_batchStarts );
+    for ( int g = 0; g < numGroups; ++g )
+    {
+        int b = m_batchOfRoot[ m_unionFind.find( g ) ];
+        m_batchGroups[ m_batchFill[ b ]++ ] = g;
+    }
+}
+
+void btMultiBodyConstraintSolverPoolMt::solveDeferredGroup( btMultiBodyConstraintSolver* solver, int groupIndex )
+{
+    const DeferredGroup& group = m_deferredGroups[ groupIndex ];
+    // the seed depends on the group only, not on the thread or the solver
+    solver->setRandSeed( m_deferredSeed + groupIndex );
+    solver->solveMultiBodyGroup( group.m_numBodies ? &m_deferredBodies[ group.m_bodyStart ] : NULL,
+        group.m_numBodies,
+        group.m_numManifolds ? &m_deferredManifolds[ group.m_manifoldStart ] : NULL,
+        group.m_numManifolds,
+        group.m_numConstraints ? &m_deferredConstraints[ group.m_constraintStart ] : NULL,
+        group.m_numConstraints,
+        group.m_numMultiBodyConstraints ? &m_deferredMultiBodyConstraints[ group.m_multiBodyConstraintStart ] : NULL,
+        group.m_numMultiBodyConstraints,
+        *m_deferredInfo,
+        m_deferredDebugDrawer,
+        m_deferredDispatcher
+    );
+}
+
+struct btMultiBodySolveBatchesLoop : public btIParallelForBody
+{
+    btMultiBodyConstraintSolverPoolMt* m_pool;
+
+    btMultiBodySolveBatchesLoop( btMultiBodyConstraintSolverPoolMt* pool )
+    {
+        m_pool = pool;
+    }
+    void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        btMultiBodyConstraintSolverPoolMt::ThreadSolver* ts = m_pool->getAndLockThreadSolver();
+        for ( int b = iBegin; b < iEnd; ++b )
+        {
+            for ( int i = m_pool->m_batchStarts[ b ]; i < m_pool->m_batchStarts[ b + 1 ]; ++i )
+            {
+                m_pool->solveDeferredGroup( ts->solver, m_pool->m_batchGroups[ i ] );
+            }
+        }
+        ts->mutex.unlock();
+    }
+};
+
+void btMultiBodyConstraintSolverPoolMt::solveDeferredGroups()
+{
+    BT_PROFILE( "solveDeferredGroups" );
+    if ( m_deferredGroups.size() > 0 )
+    {
+        m_deferredSeed = getRandSeed();
+        buildBatches();
+        btMultiBodySolveBatchesLoop loop( this );
+        btParallelFor( 0, m_batchStarts.size() - 1, 1, loop );
+        setRandSeed( m_deferredSeed * 1664525UL + 1013904223UL );
+    }
+    m_deferredGroups.resize( 0 );
+    m_deferredBodies.resize( 0 );
+    m_deferredManifolds.resize( 0 );
+    m_deferredConstraints.resize( 0 );
+    m_deferredMultiBodyConstraints.resize( 0 );
+}
+
+
+///
+/// btMultiBodyDynamicsWorldMt
+///
+
+btMultiBodyDynamicsWorldMt::btMultiBodyDynamicsWorldMt( btDispatcher* dispatcher,
+    btBroadphaseInterface* pairCache,
+    btMultiBodyConstraintSolverPoolMt* solverPool,
+    btCollisionConfiguration* collisionConfiguration
+) : btMultiBodyDynamicsWorld( dispatcher, pairCache, solverPool, collisionConfiguration )
+{
+    m_solverPool = solverPool;
+    m_threadScratch.resize( BT_MAX_THREAD_COUNT );
+}
+
+btMultiBodyDynamicsWorldMt::~btMultiBodyDynamicsWorldMt()
+{
+}
+
+btMultiBodyDynamicsWorldMt::ThreadScratch& btMultiBodyDynamicsWorldMt::getThreadScratch()
+{
+    int i = 0;
+#if BT_THREADSAFE
+    i = btGetCurrentThreadIndex();
+#endif // #if BT_THREADSAFE
+    return m_threadScratch[ i ];
+}
+
+struct btMultiBodyForwardKinematicsLoop : public btIParallelForBody
+{
+    btMultiBodyDynamicsWorldMt* m_world;
+    btMultiBody** m_multiBodies;
+
+    void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        btMultiBodyDynamicsWorldMt::ThreadScratch& scratch = m_world->getThreadScratch();
+        for ( int i = iBegin; i < iEnd; ++i )
+        {
+            m_multiBodies[ i ]->forwardKinematics( scratch.m_scratch_world_to_local, scratch.m_scratch_local_origin );
+        }
+    }
+};
+
+void btMultiBodyDynamicsWorldMt::forwardKinematicsMt()
+{
+    if ( m_multiBodies.size() > 0 )
+    {
+        btMultiBodyForwardKinematicsLoop loop;
+        loop.m_world = this;
+        loop.m_multiBodies = &m_multiBodies[ 0 ];
+        btParallelFor( 0, m_multiBodies.size(), 1, loop );
+    }
+}
+
+struct btMultiBodyStepVelocitiesLoop : public btIParallelForBody
+{
+    btMultiBodyDynamicsWorldMt* m_world;
+    btMultiBody** m_multiBodies;
+    const btContactSolverInfo* m_solverInfo;
+
+    void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        btMultiBodyDynamicsWorldMt::ThreadScratch& scratch = m_world->getThreadScratch();
+        for ( int i = iBegin; i < iEnd; ++i )
+        {
+            btMultiBody* bod = m_multiBodies[ i ];
+            if ( !btMultiBodyDynamicsWorldMt::isMultiBodySleeping( bod ) )
+            {
+                m_world->stepMultiBodyVelocities( bod, *m_solverInfo, scratch.m_scratch_r, scratch.m_scratch_v, scratch.m_scratch_m );
+            }
+        }
+    }
+};
+
+struct btMultiBodyConstraintPassLoop : public btIParallelForBody
+{
+    btMultiBodyDynamicsWorldMt* m_world;
+    btMultiBody** m_multiBodies;
+    btScalar m_timeStep;
+
+    void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        btMultiBodyDynamicsWorldMt::ThreadScratch& scratch = m_world->getThreadScratch();
+        for ( int i = iBegin; i < iEnd; ++i )
+        {
+            btMultiBody* bod = m_multiBodies[ i ];
+            if ( !btMultiBodyDynamicsWorldMt::isMultiBodySleeping( bod ) && !bod->isUsingRK4Integration() )
+            {
+                scratch.m_scratch_r.resize( bod->getNumLinks() + 1 );
+                scratch.m_scratch_v.resize( bod->getNumLinks() + 1 );
+                scratch.m_scratch_m.resize( bod->getNumLinks() + 1 );
+                bool isConstraintPass = true;
+                bod->computeAccelerationsArticulatedBodyAlgorithmMultiDof( m_timeStep, scratch.m_scratch_r, scratch.m_scratch_v, scratch.m_scratch_m, isConstraintPass );
+            }
+            bod->processDeltaVeeMultiDof2();
+        }
+    }
+};
+
+struct btMultiBodyIntegrateTransformsLoop : public btIParallelForBody
+{
+    btMultiBodyDynamicsWorldMt* m_world;
+    btMultiBody** m_multiBodies;
+    btScalar m_timeStep;
+
+    void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+    {
+        btMultiBodyDynamicsWorldMt::ThreadScratch& scratch = m_world->getThreadScratch();
+        for ( int i = iBegin; i < iEnd; ++i )
+        {
+            m_world->integrateMultiBodyTransforms( m_multiBodies[ i ], m_timeStep, scratch.m_scratch_world_to_local, scratch.m_scratch_local_origin );
+        }
+    }
+};
+
+void btMultiBodyDynamicsWorldMt::solveConstraints( btContactSolverInfo& solverInfo )
+{
+    forwardKinematicsMt();
+
+    BT_PROFILE( "solveConstraints" );
+
+    clearMultiBodyConstraintForces();
+
+    if ( m_multiBodies.size() > 0 )
+    {
+        BT_PROFILE( "btMultiBody stepVelocities" );
+        btMultiBodyStepVelocitiesLoop loop;
+        loop.m_world = this;
+        loop.m_multiBodies = &m_multiBodies[ 0 ];
+        loop.m_solverInfo = &solverInfo;
+        btParallelFor( 0, m_multiBodies.size(), 1, loop );
+    }
+
+    // all islands are solved after the forward dynamics, in parallel
+    setupIslandCallback( solverInfo );
+    m_solverPool->setDeferGroups( true );
+    processIslands();
+    processDeferredIslands();
+    m_solverPool->setDeferGroups( false );
+    m_solverPool->solveDeferredGroups();
+
+    m_constraintSolver->allSolved( solverInfo, m_debugDrawer );
+
+    if ( m_multiBodies.size() > 0 )
+    {
+        BT_PROFILE( "btMultiBody constraint pass" );
+        btMultiBodyConstraintPassLoop loop;
+        loop.m_world = this;
+        loop.m_multiBodies = &m_multiBodies[ 0 ];
+        loop.m_timeStep = solverInfo.m_timeStep;
+        btParallelFor( 0, m_multiBodies.size(), 1, loop );
+    }
+}
+
+void btMultiBodyDynamicsWorldMt::integrateTransforms( btScalar timeStep )
+{
+    btDiscreteDynamicsWorld::integrateTransforms( timeStep );
+
+    if ( m_multiBodies.size() > 0 )
+    {
+        BT_PROFILE( "btMultiBody stepPositions" );
+        btMultiBodyIntegrateTransformsLoop loop;
+        loop.m_world = this;
+        loop.m_multiBodies = &m_multiBodies[ 0 ];
+        loop.m_timeStep = timeStep;
+        btParallelFor( 0, m_multiBodies.size(), 1, loop );
+    }
+}
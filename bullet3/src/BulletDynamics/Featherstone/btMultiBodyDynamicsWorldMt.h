@@ -0,0 +1,185 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2013 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_MULTIBODY_DYNAMICS_WORLD_MT_H
+#define BT_MULTIBODY_DYNAMICS_WORLD_MT_H
+
+#include "btMultiBodyDynamicsWorld.h"
+#include "btMultiBodyConstraintSolver.h"
+#include "BulletCollision/CollisionDispatch/btUnionFind.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btThreads.h"
+
+
+///
+/// btMultiBodyConstraintSolverPoolMt - masquerades as a multibody constraint solver, but really it is a threadsafe pool of them.
+///
+///  Like btConstraintSolverPoolMt, each solver in the pool is protected by a mutex, and a call locks a solver
+///  that isn't being used by another thread.
+///  While deferring, solveMultiBodyGroup only records the group. solveDeferredGroups then solves the recorded groups
+///  in parallel. Groups that involve the same multibody (for instance through the static base of a fixed base multibody)
+///  are solved one after the other by the same thread. Each group gets a random seed from the seed of the pool,
+///  so that the results do not depend on the number of threads or on the solver that handles a group.
+///
+ATTRIBUTE_ALIGNED16(class) btMultiBodyConstraintSolverPoolMt : public btMultiBodyConstraintSolver
+{
+public:
+    BT_DECLARE_ALIGNED_ALLOCATOR();
+
+    // create the solvers for me
+    explicit btMultiBodyConstraintSolverPoolMt( int numSolvers );
+
+    // pass in fully constructed solvers (destructor will delete them)
+    btMultiBodyConstraintSolverPoolMt( btMultiBodyConstraintSolver** solvers, int numSolvers );
+
+    virtual ~btMultiBodyConstraintSolverPoolMt();
+
+    virtual btScalar solveGroup( btCollisionObject** bodies,
+        int numBodies,
+        btPersistentManifold** manifolds,
+        int numManifolds,
+        btTypedConstraint** constraints,
+        int numConstraints,
+        const btContactSolverInfo& info,
+        btIDebugDraw* debugDrawer,
+        btDispatcher* dispatcher
+    ) BT_OVERRIDE;
+
+    virtual void solveMultiBodyGroup( btCollisionObject** bodies,
+        int numBodies,
+        btPersistentManifold** manifolds,
+        int numManifolds,
+        btTypedConstraint** constraints,
+        int numConstraints,
+        btMultiBodyConstraint** multiBodyConstraints,
+        int numMultiBodyConstraints,
+        const btContactSolverInfo& info,
+        btIDebugDraw* debugDrawer,
+        btDispatcher* dispatcher
+    ) BT_OVERRIDE;
+
+    virtual void reset() BT_OVERRIDE;
+
+    void setDeferGroups( bool deferGroups ) { m_deferGroups = deferGroups; }
+    bool getDeferGroups() const { return m_deferGroups; }
+
+    /// solve the groups recorded while deferring, in parallel, and forget them
+    void solveDeferredGroups();
+
+    struct DeferredGroup
+    {
+        int m_bodyStart;
+        int m_manifoldStart;
+        int m_constraintStart;
+        int m_multiBodyConstraintStart;
+        int m_numBodies;
+        int m_numManifolds;
+        int m_numConstraints;
+        int m_numMultiBodyConstraints;
+    };
+
+    struct ThreadSolver
+    {
+        btMultiBodyConstraintSolver* solver;
+        btSpinMutex mutex;
+        char _cachelinePadding[ 128 - sizeof( btSpinMutex ) - sizeof( void* ) ];  // keep mutexes from sharing a cache line
+    };
+
+    ThreadSolver* getAndLockThreadSolver();
+
+    void solveDeferredGroup( btMultiBodyConstraintSolver* solver, int groupIndex );
+
+private:
+    btAlignedObjectArray<ThreadSolver> m_solvers;
+    bool m_deferGroups;
+
+    // the groups recorded while deferring
+    btAlignedObjectArray<DeferredGroup> m_deferredGroups;
+    btAlignedObjectArray<btCollisionObject*> m_deferredBodies;
+    btAlignedObjectArray<btPersistentManifold*> m_deferredManifolds;
+    btAlignedObjectArray<btTypedConstraint*> m_deferredConstraints;
+    btAlignedObjectArray<btMultiBodyConstraint*> m_deferredMultiBodyConstraints;
+    const btContactSolverInfo* m_deferredInfo;
+    btIDebugDraw* m_deferredDebugDrawer;
+    btDispatcher* m_deferredDispatcher;
+    unsigned long m_deferredSeed;
+
+    // deferred groups that share a multibody are merged into one batch
+    btUnionFind m_unionFind;
+    btHashMap<btHashPtr, int> m_multiBodyGroups;
+    btAlignedObjectArray<int> m_batchOfRoot;
+    btAlignedObjectArray<int> m_batchStarts;
+    btAlignedObjectArray<int> m_batchGroups;
+    btAlignedObjectArray<int> m_batchFill;
+
+    void init( btMultiBodyConstraintSolver** solvers, int numSolvers );
+    void uniteWithMultiBody( int groupIndex, const btMultiBody* multiBody );
+    void buildBatches();
+
+    friend struct btMultiBodySolveBatchesLoop;
+};
+
+
+///
+/// btMultiBodyDynamicsWorldMt -- a version of btMultiBodyDynamicsWorld that steps the multibodies and solves the islands on multiple threads.
+///
+///  The forward dynamics of the multibodies (forwardKinematics, the articulated body algorithm of stepVelocities and the
+///  constraint pass, and integrateTransforms) run in parallel, one multibody per task, with scratch arrays for each thread.
+///  All islands are then solved with the velocities from the forward dynamics, in parallel, through btMultiBodyConstraintSolverPoolMt.
+///  (btMultiBodyDynamicsWorld solves the islands with enough constraints for a batch of their own before the forward dynamics.)
+///  The rigid bodies are still predicted and integrated on the calling thread.
+///
+ATTRIBUTE_ALIGNED16(class) btMultiBodyDynamicsWorldMt : public btMultiBodyDynamicsWorld
+{
+protected:
+    btMultiBodyConstraintSolverPoolMt* m_solverPool;
+
+public:
+    struct ThreadScratch
+    {
+        btAlignedObjectArray<btScalar> m_scratch_r;
+        btAlignedObjectArray<btVector3> m_scratch_v;
+        btAlignedObjectArray<btMatrix3x3> m_scratch_m;
+        btAlignedObjectArray<btQuaternion> m_scratch_world_to_local;
+        btAlignedObjectArray<btVector3> m_scratch_local_origin;
+    };
+
+protected:
+    btAlignedObjectArray<ThreadScratch> m_threadScratch;
+
+    virtual void solveConstraints( btContactSolverInfo& solverInfo ) BT_OVERRIDE;
+
+    virtual void integrateTransforms( btScalar timeStep ) BT_OVERRIDE;
+
+    friend struct btMultiBodyStepVelocitiesLoop;
+    friend struct btMultiBodyConstraintPassLoop;
+    friend struct btMultiBodyIntegrateTransformsLoop;
+
+public:
+    BT_DECLARE_ALIGNED_ALLOCATOR();
+
+    btMultiBodyDynamicsWorldMt( btDispatcher* dispatcher,
+        btBroadphaseInterface* pairCache,
+        btMultiBodyConstraintSolverPoolMt* solverPool,
+        btCollisionConfiguration* collisionConfiguration
+    );
+    virtual ~btMultiBodyDynamicsWorldMt();
+
+    ThreadScratch& getThreadScratch();
+
+    void forwardKinematicsMt();
+};
+
+#endif //BT_MULTIBODY_DYNAMICS_WORLD_MT_H
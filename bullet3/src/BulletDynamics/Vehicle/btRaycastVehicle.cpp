@@ -27,8 +27,8 @@
 
 btRigidBody& btActionInterface::getFixedBody()
 {
+	//constructed with zero mass, and not written to afterwards, so vehicles updated on several threads can share it
 	static btRigidBody s_fixed(0, 0,0);
-	s_fixed.setMassProps(btScalar(0.),btVector3(btScalar(0.),btScalar(0.),btScalar(0.)));
 	return s_fixed;
 }
 
@@ -172,26 +172,38 @@ void	btRaycastVehicle::updateWheelTransformsWS(btWheelInfo& wheel , bool interpo
 }
 
 btScalar btRaycastVehicle::rayCast(btWheelInfo& wheel)
+{
+	btVector3 source, target;
+	computeWheelRay(wheel, source, target);
+
+	btVehicleRaycaster::btVehicleRaycasterResult	rayResults;
+
+	btAssert(m_vehicleRaycaster);
+
+	void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
+
+	return applyWheelRayResult(wheel, object, rayResults);
+}
+
+void btRaycastVehicle::computeWheelRay(btWheelInfo& wheel, btVector3& source, btVector3& target)
 {
 	updateWheelTransformsWS( wheel,false);
 
-	
-	btScalar depth = -1;
-	
 	btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius;
 
 	btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
-	const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
+	source = wheel.m_raycastInfo.m_hardPointWS;
 	wheel.m_raycastInfo.m_contactPointWS = source + rayvector;
-	const btVector3& target = wheel.m_raycastInfo.m_contactPointWS;
+	target = wheel.m_raycastInfo.m_contactPointWS;
+}
 
-	btScalar param = btScalar(0.);
-	
-	btVehicleRaycaster::btVehicleRaycasterResult	rayResults;
+btScalar btRaycastVehicle::applyWheelRayResult(btWheelInfo& wheel, void* object, const btVehicleRaycaster::btVehicleRaycasterResult& rayResults)
+{
+	btScalar depth = -1;
 
-	btAssert(m_vehicleRaycaster);
+	btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius;
 
-	void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
+	btScalar param = btScalar(0.);
 
 	wheel.m_raycastInfo.m_groundObject = 0;
 
@@ -273,6 +285,25 @@ const btTransform& btRaycastVehicle::getChassisWorldTransform() const
 
 
 void btRaycastVehicle::updateVehicle( btScalar step )
+{
+	updateWheelsAndSpeed();
+
+	//
+	// simulate suspension
+	//
+
+	int i=0;
+	for (i=0;i<m_wheelInfo.size();i++)
+	{
+		//btScalar depth;
+		//depth =
+		rayCast( m_wheelInfo[i]);
+	}
+
+	updateForcesAndRotation(step);
+}
+
+void btRaycastVehicle::updateWheelsAndSpeed()
 {
 	{
 		for (int i=0;i<getNumWheels();i++)
@@ -295,22 +326,13 @@ void btRaycastVehicle::updateVehicle( btScalar step )
 	{
 		m_currentVehicleSpeedKmHour *= btScalar(-1.);
 	}
+}
 
-	//
-	// simulate suspension
-	//
-	
-	int i=0;
-	for (i=0;i<m_wheelInfo.size();i++)
-	{
-		//btScalar depth; 
-		//depth = 
-		rayCast( m_wheelInfo[i]);
-	}
-
+void btRaycastVehicle::updateForcesAndRotation( btScalar step )
+{
 	updateSuspension(step);
 
-	
+	int i=0;
 	for (i=0;i<m_wheelInfo.size();i++)
 	{
 		//apply suspension force
@@ -94,8 +94,20 @@ public:
 	
 	btScalar rayCast(btWheelInfo& wheel);
 
+	///the ray that rayCast casts for a wheel. It updates the world space wheel info first
+	void	computeWheelRay(btWheelInfo& wheel, btVector3& source, btVector3& target);
+
+	///the part of rayCast after the ray query, object is what btVehicleRaycaster::castRay returned
+	btScalar	applyWheelRayResult(btWheelInfo& wheel, void* object, const btVehicleRaycaster::btVehicleRaycasterResult& rayResults);
+
 	virtual void updateVehicle(btScalar step);
-	
+
+	///the part of updateVehicle before the wheel ray casts: wheel transforms and current speed
+	void	updateWheelsAndSpeed();
+
+	///the part of updateVehicle after the wheel ray casts: suspension and friction impulses, and wheel rotation
+	void	updateForcesAndRotation(btScalar step);
+
 	
 	void resetSuspension();
 
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2005 Erwin Coumans http://continuousphysics.com/Bullet/
+ *
+ * Permission to use, copy, modify, distribute and sell this software
+ * and its documentation for any purpose is hereby granted without fee,
+ * provided that the above copyright notice appear in all copies.
+ * Erwin Coumans makes no representations about the suitability
+ * of this software for any purpose.
+ * It is provided "as is" without express or implied warranty.
+*/
+
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btQuickprof.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "btRaycastVehicle.h"
+#include "btRaycastVehicleBatch.h"
+
+
+///updates the wheel transforms of each vehicle and collects its wheel rays
+struct btVehicleRayCollectLoop : public btIParallelForBody
+{
+	btRaycastVehicle* const*	m_vehicles;
+	const int*	m_firstWheelRays;
+	btVector3*	m_rayFrom;
+	btVector3*	m_rayTo;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			btRaycastVehicle* vehicle = m_vehicles[i];
+			vehicle->updateWheelsAndSpeed();
+			int firstRay = m_firstWheelRays[i];
+			for (int w = 0; w < vehicle->getNumWheels(); w++)
+			{
+				vehicle->computeWheelRay(vehicle->getWheelInfo(w), m_rayFrom[firstRay+w], m_rayTo[firstRay+w]);
+			}
+		}
+	}
+};
+
+///takes the ray hits of each vehicle like btDefaultVehicleRaycaster, then updates its suspension and friction
+struct btVehicleUpdateLoop : public btIParallelForBody
+{
+	btRaycastVehicle* const*	m_vehicles;
+	const int*	m_firstWheelRays;
+	const btCollisionObject* const*	m_hitObjects;
+	const btScalar*	m_hitFractions;
+	const btVector3*	m_hitPoints;
+	const btVector3*	m_hitNormals;
+	btScalar	m_timeStep;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			btRaycastVehicle* vehicle = m_vehicles[i];
+			int firstRay = m_firstWheelRays[i];
+			for (int w = 0; w < vehicle->getNumWheels(); w++)
+			{
+				int ray = firstRay + w;
+				btVehicleRaycaster::btVehicleRaycasterResult rayResults;
+				void* object = 0;
+				const btRigidBody* body = m_hitObjects[ray] ? btRigidBody::upcast(m_hitObjects[ray]) : 0;
+				if (body && body->hasContactResponse())
+				{
+					rayResults.m_hitPointInWorld = m_hitPoints[ray];
+					rayResults.m_hitNormalInWorld = m_hitNormals[ray];
+					rayResults.m_hitNormalInWorld.normalize();
+					rayResults.m_distFraction = m_hitFractions[ray];
+					object = (void*)body;
+				}
+				vehicle->applyWheelRayResult(vehicle->getWheelInfo(w), object, rayResults);
+			}
+			vehicle->updateForcesAndRotation(m_timeStep);
+		}
+	}
+};
+
+btRaycastVehicleBatch::btRaycastVehicleBatch()
+{
+}
+
+btRaycastVehicleBatch::~btRaycastVehicleBatch()
+{
+}
+
+void btRaycastVehicleBatch::addVehicle(btRaycastVehicle* vehicle)
+{
+	m_vehicles.push_back(vehicle);
+}
+
+void btRaycastVehicleBatch::removeVehicle(btRaycastVehicle* vehicle)
+{
+	m_vehicles.remove(vehicle);
+}
+
+void btRaycastVehicleBatch::updateAction(btCollisionWorld* collisionWorld, btScalar deltaTime)
+{
+	BT_PROFILE("btRaycastVehicleBatch::updateAction");
+	int numVehicles = m_vehicles.size();
+	if (numVehicles == 0)
+		return;
+
+	//the wheel rays of a vehicle follow the ones of the vehicles before it
+	m_firstWheelRays.resize(numVehicles+1);
+	int numRays = 0;
+	for (int i=0;i<numVehicles;i++)
+	{
+		m_firstWheelRays[i] = numRays;
+		numRays += m_vehicles[i]->getNumWheels();
+	}
+	m_firstWheelRays[numVehicles] = numRays;
+	//keep the arrays non-empty, their first elements are passed on
+	int numEntries = btMax(numRays, 1);
+	m_rayFrom.resize(numEntries);
+	m_rayTo.resize(numEntries);
+	m_hitObjects.resize(numEntries);
+	m_hitFractions.resize(numEntries);
+	m_hitPoints.resize(numEntries);
+	m_hitNormals.resize(numEntries);
+
+	{
+		BT_PROFILE("collectWheelRays");
+		btVehicleRayCollectLoop loop;
+		loop.m_vehicles = &m_vehicles[0];
+		loop.m_firstWheelRays = &m_firstWheelRays[0];
+		loop.m_rayFrom = &m_rayFrom[0];
+		loop.m_rayTo = &m_rayTo[0];
+		btParallelForOrSerial(0, numVehicles, 64, loop);
+	}
+
+	btCollisionWorld::RayBatchResults results;
+	results.m_collisionObjects = &m_hitObjects[0];
+	results.m_hitFractions = &m_hitFractions[0];
+	results.m_hitPointWorld = &m_hitPoints[0];
+	results.m_hitNormalWorld = &m_hitNormals[0];
+	collisionWorld->rayTestBatch(&m_rayFrom[0], &m_rayTo[0], numRays, results);
+
+	//the wheels share the fixed body as their ground, construct it before the threads read it
+	getFixedBody();
+	{
+		BT_PROFILE("updateVehicles");
+		btVehicleUpdateLoop loop;
+		loop.m_vehicles = &m_vehicles[0];
+		loop.m_firstWheelRays = &m_firstWheelRays[0];
+		loop.m_hitObjects = &m_hitObjects[0];
+		loop.m_hitFractions = &m_hitFractions[0];
+		loop.m_hitPoints = &m_hitPoints[0];
+		loop.m_hitNormals = &m_hitNormals[0];
+		loop.m_timeStep = deltaTime;
+		btParallelForOrSerial(0, numVehicles, 16, loop);
+	}
+}
+
+void btRaycastVehicleBatch::debugDraw(btIDebugDraw* debugDrawer)
+{
+	for (int i=0;i<m_vehicles.size();i++)
+	{
+		m_vehicles[i]->debugDraw(debugDrawer);
+	}
+}
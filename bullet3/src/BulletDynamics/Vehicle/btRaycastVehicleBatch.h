@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2005 Erwin Coumans http://continuousphysics.com/Bullet/
+ *
+ * Permission to use, copy, modify, distribute and sell this software
+ * and its documentation for any purpose is hereby granted without fee,
+ * provided that the above copyright notice appear in all copies.
+ * Erwin Coumans makes no representations about the suitability
+ * of this software for any purpose.
+ * It is provided "as is" without express or implied warranty.
+*/
+#ifndef BT_RAYCAST_VEHICLE_BATCH_H
+#define BT_RAYCAST_VEHICLE_BATCH_H
+
+#include "LinearMath/btVector3.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "BulletDynamics/Dynamics/btActionInterface.h"
+
+class btRaycastVehicle;
+class btCollisionObject;
+
+///btRaycastVehicleBatch updates many btRaycastVehicles as one action, instead of one action per vehicle.
+///Each step, the wheel rays of all vehicles are collected and cast in one btCollisionWorld::rayTestBatch query,
+///then the suspension and friction of the vehicles are updated in parallel with btParallelFor.
+///The rays hit what btDefaultVehicleRaycaster would hit; the raycasters of the vehicles and overrides of
+///btRaycastVehicle::updateVehicle are not used. A vehicle only pushes its own chassis, so the vehicles are independent.
+class btRaycastVehicleBatch : public btActionInterface
+{
+protected:
+
+	btAlignedObjectArray<btRaycastVehicle*>	m_vehicles;
+
+	///per step: the first wheel ray of each vehicle, the rays, and their closest hits
+	btAlignedObjectArray<int>	m_firstWheelRays;
+	btAlignedObjectArray<btVector3>	m_rayFrom;
+	btAlignedObjectArray<btVector3>	m_rayTo;
+	btAlignedObjectArray<const btCollisionObject*>	m_hitObjects;
+	btAlignedObjectArray<btScalar>	m_hitFractions;
+	btAlignedObjectArray<btVector3>	m_hitPoints;
+	btAlignedObjectArray<btVector3>	m_hitNormals;
+
+public:
+
+	btRaycastVehicleBatch();
+
+	virtual ~btRaycastVehicleBatch();
+
+	///the vehicle is added to the batch instead of to the world
+	void	addVehicle(btRaycastVehicle* vehicle);
+
+	void	removeVehicle(btRaycastVehicle* vehicle);
+
+	int	getNumVehicles() const
+	{
+		return m_vehicles.size();
+	}
+
+	btRaycastVehicle*	getVehicle(int index)
+	{
+		return m_vehicles[index];
+	}
+
+	///btActionInterface interface
+	virtual void	updateAction(btCollisionWorld* collisionWorld, btScalar deltaTime);
+
+	///btActionInterface interface
+	virtual void	debugDraw(btIDebugDraw* debugDrawer);
+};
+
+#endif //BT_RAYCAST_VEHICLE_BATCH_H
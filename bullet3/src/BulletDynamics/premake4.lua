@@ -9,6 +9,8 @@
 	files {
 		"Dynamics/*.cpp",
                 "Dynamics/*.h",
+                "Dynamics2d/*.cpp",
+                "Dynamics2d/*.h",
                 "ConstraintSolver/*.cpp",
                 "ConstraintSolver/*.h",
                 "Featherstone/*.cpp",
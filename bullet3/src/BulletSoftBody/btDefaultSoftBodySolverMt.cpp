@@ -0,0 +1,323 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btDefaultSoftBodySolverMt.h"
+#include "BulletDynamics/Featherstone/btMultiBodyLinkCollider.h"
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btQuickprof.h"
+
+
+int btDefaultSoftBodySolverMt::s_minimumLinksForBatching = 1024;
+
+btDefaultSoftBodySolverMt::btDefaultSoftBodySolverMt()
+{
+}
+
+btDefaultSoftBodySolverMt::~btDefaultSoftBodySolverMt()
+{
+}
+
+void btDefaultSoftBodySolverMt::optimize( btAlignedObjectArray< btSoftBody * > &softBodies , bool forceUpdate)
+{
+	btDefaultSoftBodySolver::optimize( softBodies, forceUpdate );
+	// (re)batch the links of large soft bodies, when links were added, cut or randomized
+	for ( int i=0; i < m_softBodySet.size(); ++i)
+	{
+		btSoftBody*	psb = m_softBodySet[i];
+		if ( psb->m_links.size() >= s_minimumLinksForBatching && !psb->hasLinkBatches() )
+		{
+			psb->batchLinks();
+		}
+	}
+}
+
+struct btSoftBodyPredictMotionLoop : public btIParallelForBody
+{
+	btSoftBody**	softBodies;
+	btScalar		timeStep;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		for ( int i = iBegin; i < iEnd; ++i )
+		{
+			btSoftBody*	psb = softBodies[ i ];
+			if ( psb->isActive() )
+			{
+				// the broadphase is not threadsafe, its aabbs are updated afterwards
+				psb->predictMotion( timeStep, false );
+			}
+		}
+	}
+};
+
+void btDefaultSoftBodySolverMt::predictMotion( float timeStep )
+{
+	BT_PROFILE( "predictSoftBodyMotion" );
+	if ( m_softBodySet.size() > 0 )
+	{
+		btSoftBodyPredictMotionLoop loop;
+		loop.softBodies = &m_softBodySet[ 0 ];
+		loop.timeStep = timeStep;
+		btParallelFor( 0, m_softBodySet.size(), 1, loop );
+		for ( int i = 0; i < m_softBodySet.size(); ++i )
+		{
+			btSoftBody*	psb = m_softBodySet[ i ];
+			if ( psb->isActive() )
+			{
+				psb->updateBroadphaseAabb();
+			}
+		}
+	}
+}
+
+struct btSoftBodyIntegrateMotionLoop : public btIParallelForBody
+{
+	btSoftBody**	softBodies;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		for ( int i = iBegin; i < iEnd; ++i )
+		{
+			btSoftBody*	psb = softBodies[ i ];
+			if ( psb->isActive() )
+			{
+				psb->integrateMotion();
+			}
+		}
+	}
+};
+
+void btDefaultSoftBodySolverMt::updateSoftBodies( )
+{
+	BT_PROFILE( "updateSoftBodies" );
+	if ( m_softBodySet.size() > 0 )
+	{
+		btSoftBodyIntegrateMotionLoop loop;
+		loop.softBodies = &m_softBodySet[ 0 ];
+		btParallelFor( 0, m_softBodySet.size(), 1, loop );
+	}
+}
+
+void btDefaultSoftBodySolverMt::uniteWithObject( int body, const void* object )
+{
+	const int* owner = m_objectOwners.find( object );
+	if ( owner )
+	{
+		m_unionFind.unite( body, *owner );
+	}
+	else
+	{
+		m_objectOwners.insert( object, body );
+	}
+}
+
+int btDefaultSoftBodySolverMt::findFaceOwner( const btSoftBody::Face* face ) const
+{
+	// m_faceRanges is sorted by address, find the last range starting at or before face
+	int lo = 0;
+	int hi = m_faceRanges.size();
+	while ( hi - lo > 1 )
+	{
+		int mid = ( lo + hi ) / 2;
+		if ( m_faceRanges[ mid ].m_begin <= face )
+			lo = mid;
+		else
+			hi = mid;
+	}
+	if ( hi > lo && m_faceRanges[ lo ].m_begin <= face && face < m_faceRanges[ lo ].m_end )
+	{
+		return m_faceRanges[ lo ].m_body;
+	}
+	return -1;
+}
+
+struct btFaceRangeSortPredicate
+{
+	bool operator() ( const btDefaultSoftBodySolverMt::FaceRange& a, const btDefaultSoftBodySolverMt::FaceRange& b ) const
+	{
+		return a.m_begin < b.m_begin;
+	}
+};
+
+void btDefaultSoftBodySolverMt::buildGroups()
+{
+	BT_PROFILE( "buildSoftBodyGroups" );
+	const int numBodies = m_softBodySet.size();
+	m_unionFind.reset( numBodies );
+	m_objectOwners.clear();
+	m_faceRanges.resize( 0 );
+	for ( int i = 0; i < numBodies; ++i )
+	{
+		btSoftBody*	psb = m_softBodySet[ i ];
+		if ( psb->m_faces.size() > 0 )
+		{
+			FaceRange range;
+			range.m_begin = &psb->m_faces[ 0 ];
+			range.m_end = range.m_begin + psb->m_faces.size();
+			range.m_body = i;
+			m_faceRanges.push_back( range );
+		}
+	}
+	m_faceRanges.quickSort( btFaceRangeSortPredicate() );
+
+	// soft bodies that write to the same rigid body, multibody or soft body nodes are solved together
+	for ( int i = 0; i < numBodies; ++i )
+	{
+		btSoftBody*	psb = m_softBodySet[ i ];
+		if ( !psb->isActive() )
+		{
+			continue;
+		}
+		for ( int j = 0; j < psb->m_anchors.size(); ++j )
+		{
+			// btRigidBody::applyImpulse leaves static and kinematic bodies alone
+			const btRigidBody* body = psb->m_anchors[ j ].m_body;
+			if ( body->getInvMass() != 0 )
+			{
+				uniteWithObject( i, body );
+			}
+		}
+		for ( int j = 0; j < psb->m_rcontacts.size(); ++j )
+		{
+			const btCollisionObject* colObj = psb->m_rcontacts[ j ].m_cti.m_colObj;
+			if ( colObj->getInternalType() == btCollisionObject::CO_FEATHERSTONE_LINK )
+			{
+				const btMultiBodyLinkCollider* linkCol = btMultiBodyLinkCollider::upcast( colObj );
+				if ( linkCol )
+				{
+					uniteWithObject( i, linkCol->m_multiBody );
+				}
+			}
+			else
+			{
+				const btRigidBody* body = btRigidBody::upcast( colObj );
+				if ( body && body->getInvMass() != 0 )
+				{
+					uniteWithObject( i, body );
+				}
+			}
+		}
+		for ( int j = 0; j < psb->m_scontacts.size(); ++j )
+		{
+			int owner = findFaceOwner( psb->m_scontacts[ j ].m_face );
+			if ( owner >= 0 && owner != i )
+			{
+				m_unionFind.unite( i, owner );
+			}
+		}
+	}
+
+	// number the groups in the order of their first active soft body, keeping the soft body order within each group
+	m_groupOfRoot.resize( numBodies );
+	for ( int i = 0; i < numBodies; ++i )
+	{
+		m_groupOfRoot[ i ] = -1;
+	}
+	m_groupStarts.resize( 0 );
+	for ( int i = 0; i < numBodies; ++i )
+	{
+		if ( m_softBodySet[ i ]->isActive() )
+		{
+			int root = m_unionFind.find( i );
+			if ( m_groupOfRoot[ root ] < 0 )
+			{
+				m_groupOfRoot[ root ] = m_groupStarts.size();
+				m_groupStarts.push_back( 0 );
+			}
+			m_groupStarts[ m_groupOfRoot[ root ] ]++;
+		}
+	}
+	const int numGroups = m_groupStarts.size();
+	int numGrouped = 0;
+	for ( int g = 0; g < numGroups; ++g )
+	{
+		int count = m_groupStarts[ g ];
+		m_groupStarts[ g ] = numGrouped;
+		numGrouped += count;
+	}
+	m_groupStarts.push_back( numGrouped );
+	m_groupBodies.resize( numGrouped );
+	m_groupFill.copyFromArray( m_groupStarts );
+	for ( int i = 0; i < numBodies; ++i )
+	{
+		if ( m_softBodySet[ i ]->isActive() )
+		{
+			int g = m_groupOfRoot[ m_unionFind.find( i ) ];
+			m_groupBodies[ m_groupFill[ g ]++ ] = i;
+		}
+	}
+
+	// groups with batched links are solved one at a time, so that their batches can use all threads
+	m_parallelGroups.resize( 0 );
+	m_batchedGroups.resize( 0 );
+	for ( int g = 0; g < numGroups; ++g )
+	{
+		bool batched = false;
+		for ( int j = m_groupStarts[ g ]; j < m_groupStarts[ g + 1 ]; ++j )
+		{
+			batched = batched || m_softBodySet[ m_groupBodies[ j ] ]->hasLinkBatches();
+		}
+		if ( batched )
+			m_batchedGroups.push_back( g );
+		else
+			m_parallelGroups.push_back( g );
+	}
+}
+
+struct btSoftBodyGroupSolveLoop : public btIParallelForBody
+{
+	btSoftBody**	softBodies;
+	const int*		groups;
+	const int*		groupStarts;
+	const int*		groupBodies;
+
+	void forLoop( int iBegin, int iEnd ) const BT_OVERRIDE
+	{
+		for ( int i = iBegin; i < iEnd; ++i )
+		{
+			const int g = groups[ i ];
+			for ( int j = groupStarts[ g ]; j < groupStarts[ g + 1 ]; ++j )
+			{
+				softBodies[ groupBodies[ j ] ]->solveConstraints();
+			}
+		}
+	}
+};
+
+void btDefaultSoftBodySolverMt::solveConstraints( float solverdt )
+{
+	BT_PROFILE( "solveSoftBodyConstraints" );
+	if ( m_softBodySet.size() == 0 )
+	{
+		return;
+	}
+	buildGroups();
+	btSoftBodyGroupSolveLoop loop;
+	loop.softBodies = &m_softBodySet[ 0 ];
+	loop.groupStarts = &m_groupStarts[ 0 ];
+	loop.groupBodies = m_groupBodies.size() ? &m_groupBodies[ 0 ] : 0;
+	// groups share nothing, so the order they are solved in does not change the results
+	if ( m_parallelGroups.size() > 0 )
+	{
+		loop.groups = &m_parallelGroups[ 0 ];
+		btParallelFor( 0, m_parallelGroups.size(), 1, loop );
+	}
+	// groups with batched links solve the batches in parallel, one group after the other
+	if ( m_batchedGroups.size() > 0 )
+	{
+		loop.groups = &m_batchedGroups[ 0 ];
+		loop.forLoop( 0, m_batchedGroups.size() );
+	}
+}
@@ -0,0 +1,80 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2006 Erwin Coumans  http://continuousphysics.com/Bullet/
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SOFT_BODY_DEFAULT_SOLVER_MT_H
+#define BT_SOFT_BODY_DEFAULT_SOLVER_MT_H
+
+#include "btDefaultSoftBodySolver.h"
+#include "btSoftBody.h"
+#include "BulletCollision/CollisionDispatch/btUnionFind.h"
+#include "LinearMath/btHashMap.h"
+
+///btDefaultSoftBodySolverMt steps the soft bodies of a btSoftRigidDynamicsWorld on the threads of the task scheduler (see btSetTaskScheduler).
+///predictMotion and updateSoftBodies handle the soft bodies in parallel.
+///solveConstraints splits the soft bodies into groups that share nothing the solver writes to, and solves the groups in parallel:
+///soft bodies anchored to or touching the same dynamic rigid body or multibody, or touching each other, are in one group and solved in order.
+///The links of soft bodies with at least s_minimumLinksForBatching links are reordered into batches (see btSoftBody::batchLinks),
+///and the links of each batch are solved in parallel.
+///The results do not depend on the number of threads, they are the same as those of btDefaultSoftBodySolver stepping the same, batched, soft bodies.
+///Cluster joints and self collisions are still handled by btSoftRigidDynamicsWorld on the calling thread.
+class btDefaultSoftBodySolverMt : public btDefaultSoftBodySolver
+{
+public:
+	struct FaceRange
+	{
+		const btSoftBody::Face*	m_begin;
+		const btSoftBody::Face*	m_end;
+		int						m_body;
+	};
+
+protected:
+
+	btUnionFind						m_unionFind;
+	btHashMap<btHashPtr,int>		m_objectOwners;
+	btAlignedObjectArray<FaceRange>	m_faceRanges;
+	btAlignedObjectArray<int>		m_groupOfRoot;
+	btAlignedObjectArray<int>		m_groupStarts;
+	btAlignedObjectArray<int>		m_groupBodies;
+	btAlignedObjectArray<int>		m_groupFill;
+	btAlignedObjectArray<int>		m_parallelGroups;
+	btAlignedObjectArray<int>		m_batchedGroups;
+
+	void	uniteWithObject(int body,const void* object);
+	int		findFaceOwner(const btSoftBody::Face* face) const;
+	void	buildGroups();
+
+public:
+	///soft bodies with fewer links are solved by one thread
+	static int s_minimumLinksForBatching;
+
+	btDefaultSoftBodySolverMt();
+
+	virtual ~btDefaultSoftBodySolverMt();
+
+	virtual void optimize( btAlignedObjectArray< btSoftBody * > &softBodies,bool forceUpdate=false );
+
+	virtual void updateSoftBodies( );
+
+	virtual void solveConstraints( float solverdt );
+
+	virtual void predictMotion( float solverdt );
+
+	int		getNumGroups() const
+	{
+		return m_groupStarts.size() ? m_groupStarts.size()-1 : 0;
+	}
+};
+
+#endif // BT_SOFT_BODY_DEFAULT_SOLVER_MT_H
@@ -18,6 +18,7 @@ subject to the following restrictions:
 #include "BulletSoftBody/btSoftBodySolvers.h"
 #include "btSoftBodyData.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 #include "BulletDynamics/Featherstone/btMultiBodyLinkCollider.h"
 #include "BulletDynamics/Featherstone/btMultiBodyConstraint.h"
 
@@ -267,6 +268,7 @@ void			btSoftBody::appendLink(int model,Material* mat)
 	else
 	{ ZeroInitialize(l);l.m_material=mat?mat:m_materials[0]; }
 	m_links.push_back(l);
+	m_linkBatches.resize(0);
 }
 
 //
@@ -1172,6 +1174,49 @@ void			btSoftBody::randomizeConstraints()
 		btSwap(m_faces[i],m_faces[NEXTRAND%ni]);
 	}
 #undef NEXTRAND
+	m_linkBatches.resize(0);
+}
+
+//
+void			btSoftBody::batchLinks()
+{
+	const int					nl=m_links.size();
+	tLinkArray					links;
+	btAlignedObjectArray<int>	nodeBatch;
+	btAlignedObjectArray<int>	pending;
+	btAlignedObjectArray<int>	deferred;
+	links.reserve(nl);
+	nodeBatch.resize(m_nodes.size(),-1);
+	pending.resize(nl);
+	for(int i=0;i<nl;++i)
+	{
+		pending[i]=i;
+	}
+	m_linkBatches.resize(0);
+	/* Each pass takes the pending links that touch no node of the batch	*/ 
+	for(int batch=0;pending.size()>0;++batch)
+	{
+		m_linkBatches.push_back(links.size());
+		deferred.resize(0);
+		for(int i=0,ni=pending.size();i<ni;++i)
+		{
+			const Link&	l=m_links[pending[i]];
+			const int	ia=int(l.m_n[0]-&m_nodes[0]);
+			const int	ib=int(l.m_n[1]-&m_nodes[0]);
+			if((nodeBatch[ia]!=batch)&&(nodeBatch[ib]!=batch))
+			{
+				nodeBatch[ia]=nodeBatch[ib]=batch;
+				links.push_back(l);
+			}
+			else
+			{
+				deferred.push_back(pending[i]);
+			}
+		}
+		pending.copyFromArray(deferred);
+	}
+	m_linkBatches.push_back(nl);
+	m_links.copyFromArray(links);
 }
 
 //
@@ -1386,6 +1431,8 @@ int				btSoftBody::generateClusters(int k,int maxiterations)
 //
 void			btSoftBody::refine(ImplicitFn* ifn,btScalar accurary,bool cut)
 {
+	/* Links are removed and appended	*/ 
+	m_linkBatches.resize(0);
 	const Node*			nbase = &m_nodes[0];
 	int					ncount = m_nodes.size();
 	btSymMatrix<int>	edges(ncount,-2);
@@ -1738,7 +1785,7 @@ void			btSoftBody::setSolver(eSolverPresets::_ preset)
 }
 
 //
-void			btSoftBody::predictMotion(btScalar dt)
+void			btSoftBody::predictMotion(btScalar dt,bool updateBroadphase)
 {
 
 	int i,ni;
@@ -1792,7 +1839,7 @@ void			btSoftBody::predictMotion(btScalar dt)
 	/* Clusters				*/ 
 	updateClusters();
 	/* Bounds				*/ 
-	updateBounds();	
+	updateBounds(updateBroadphase);	
 	/* Nodes				*/ 
 	ATTRIBUTE_ALIGNED16(btDbvtVolume)	vol;
 	for(i=0,ni=m_nodes.size();i<ni;++i)
@@ -2303,7 +2350,7 @@ void					btSoftBody::updateNormals()
 }
 
 //
-void					btSoftBody::updateBounds()
+void					btSoftBody::updateBounds(bool updateBroadphase)
 {
 	/*if( m_acceleratedSoftBody )
 	{
@@ -2327,12 +2374,9 @@ void					btSoftBody::updateBounds()
 				csm)*1; // ??? to investigate...
 			m_bounds[0]=mins-mrg;
 			m_bounds[1]=maxs+mrg;
-			if(0!=getBroadphaseHandle())
-			{					
-				m_worldInfo->m_broadphase->setAabb(	getBroadphaseHandle(),
-					m_bounds[0],
-					m_bounds[1],
-					m_worldInfo->m_dispatcher);
+			if(updateBroadphase)
+			{
+				updateBroadphaseAabb();
 			}
 		}
 		else
@@ -2344,6 +2388,18 @@ void					btSoftBody::updateBounds()
 }
 
 
+//
+void					btSoftBody::updateBroadphaseAabb()
+{
+	if(m_ndbvt.m_root&&(0!=getBroadphaseHandle()))
+	{
+		m_worldInfo->m_broadphase->setAabb(	getBroadphaseHandle(),
+			m_bounds[0],
+			m_bounds[1],
+			m_worldInfo->m_dispatcher);
+	}
+}
+
 //
 void					btSoftBody::updatePose()
 {
@@ -3131,26 +3187,80 @@ void				btSoftBody::PSolve_SContacts(btSoftBody* psb,btScalar,btScalar ti)
 	}
 }
 
+//
+static inline void	PSolve_Link(btSoftBody::Link& l,btScalar kst)
+{
+	if(l.m_c0>0)
+	{
+		btSoftBody::Node&	a=*l.m_n[0];
+		btSoftBody::Node&	b=*l.m_n[1];
+		const btVector3		del=b.m_x-a.m_x;
+		const btScalar		len=del.length2();
+		if (l.m_c1+len > SIMD_EPSILON)
+		{
+			const btScalar	k=((l.m_c1-len)/(l.m_c0*(l.m_c1+len)))*kst;
+			a.m_x-=del*(k*a.m_im);
+			b.m_x+=del*(k*b.m_im);
+		}
+	}
+}
+
+//
+static inline void	VSolve_Link(btSoftBody::Link& l,btScalar kst)
+{
+	btSoftBody::Node**	n=l.m_n;
+	const btScalar		j=-btDot(l.m_c3,n[0]->m_v-n[1]->m_v)*l.m_c2*kst;
+	n[0]->m_v+=	l.m_c3*(j*n[0]->m_im);
+	n[1]->m_v-=	l.m_c3*(j*n[1]->m_im);
+}
+
+#if BT_THREADSAFE
+/* Solves a range of links of one batch, see btSoftBody::batchLinks	*/ 
+struct	btSoftBodyLinkBatchSolver : btIParallelForBody
+{
+	btSoftBody::Link*	links;
+	btScalar			kst;
+	bool				velocities;
+	void	forLoop(int iBegin,int iEnd) const BT_OVERRIDE
+	{
+		for(int i=iBegin;i<iEnd;++i)
+		{
+			if(velocities)
+				VSolve_Link(links[i],kst);
+			else
+				PSolve_Link(links[i],kst);
+		}
+	}
+};
+
+static void			solveLinkBatches(btSoftBody* psb,btScalar kst,bool velocities)
+{
+	const int					grainSize=128;
+	btSoftBodyLinkBatchSolver	solver;
+	solver.links		=	&psb->m_links[0];
+	solver.kst			=	kst;
+	solver.velocities	=	velocities;
+	for(int i=0,ni=psb->m_linkBatches.size()-1;i<ni;++i)
+	{
+		btParallelForOrSerial(psb->m_linkBatches[i],psb->m_linkBatches[i+1],grainSize,solver);
+	}
+}
+#endif //BT_THREADSAFE
+
 //
 void				btSoftBody::PSolve_Links(btSoftBody* psb,btScalar kst,btScalar ti)
 {
 BT_PROFILE("PSolve_Links");
+#if BT_THREADSAFE
+	if(psb->hasLinkBatches())
+	{
+		solveLinkBatches(psb,kst,false);
+		return;
+	}
+#endif //BT_THREADSAFE
 	for(int i=0,ni=psb->m_links.size();i<ni;++i)
 	{			
-		Link&	l=psb->m_links[i];
-		if(l.m_c0>0)
-		{
-			Node&			a=*l.m_n[0];
-			Node&			b=*l.m_n[1];
-			const btVector3	del=b.m_x-a.m_x;
-			const btScalar	len=del.length2();
-			if (l.m_c1+len > SIMD_EPSILON)
-			{
-				const btScalar	k=((l.m_c1-len)/(l.m_c0*(l.m_c1+len)))*kst;
-				a.m_x-=del*(k*a.m_im);
-				b.m_x+=del*(k*b.m_im);
-			}
-		}
+		PSolve_Link(psb->m_links[i],kst);
 	}
 }
 
@@ -3158,13 +3268,16 @@ BT_PROFILE("PSolve_Links");
 void				btSoftBody::VSolve_Links(btSoftBody* psb,btScalar kst)
 {
 	BT_PROFILE("VSolve_Links");
+#if BT_THREADSAFE
+	if(psb->hasLinkBatches())
+	{
+		solveLinkBatches(psb,kst,true);
+		return;
+	}
+#endif //BT_THREADSAFE
 	for(int i=0,ni=psb->m_links.size();i<ni;++i)
 	{			
-		Link&			l=psb->m_links[i];
-		Node**			n=l.m_n;
-		const btScalar	j=-btDot(l.m_c3,n[0]->m_v-n[1]->m_v)*l.m_c2*kst;
-		n[0]->m_v+=	l.m_c3*(j*n[0]->m_im);
-		n[1]->m_v-=	l.m_c3*(j*n[1]->m_im);
+		VSolve_Link(psb->m_links[i],kst);
 	}
 }
 
@@ -672,6 +672,7 @@ public:
 	btDbvt					m_fdbvt;		// Faces tree
 	btDbvt					m_cdbvt;		// Clusters tree
 	tClusterArray			m_clusters;		// Clusters
+	btAlignedObjectArray<int>	m_linkBatches;	// Link batches, see batchLinks
 
 	btAlignedObjectArray<bool>m_clusterConnectivity;//cluster connectivity, for self-collision
 
@@ -851,6 +852,15 @@ public:
 		Material* mat=0);
 	/* Randomize constraints to reduce solver bias							*/ 
 	void				randomizeConstraints();
+	/* Reorder links into batches that share no node, see m_linkBatches	*/ 
+	///batchLinks groups the links so that no two links of a batch move the same node, and m_linkBatches holds the first link of each batch, then m_links.size().
+	///In threadsafe builds, the links of each batch are then solved in parallel, using btParallelFor. The results do not depend on the number of threads.
+	///The functions that add, remove or reorder links drop the batches, code that changes m_links directly has to clear m_linkBatches.
+	void				batchLinks();
+	bool				hasLinkBatches() const
+	{
+		return (m_linkBatches.size()>1)&&(m_linkBatches[m_linkBatches.size()-1]==m_links.size());
+	}
 	/* Release clusters														*/ 
 	void				releaseCluster(int index);
 	void				releaseClusters();
@@ -871,7 +881,8 @@ public:
 	/* Solver presets														*/ 
 	void				setSolver(eSolverPresets::_ preset);
 	/* predictMotion														*/ 
-	void				predictMotion(btScalar dt);
+	///with updateBroadphase false, the broadphase aabb is left for updateBroadphaseAabb, so that soft bodies can predict their motion in parallel
+	void				predictMotion(btScalar dt,bool updateBroadphase=true);
 	/* solveConstraints														*/ 
 	void				solveConstraints();
 	/* staticSolve															*/ 
@@ -967,7 +978,8 @@ public:
 	btVector3			evaluateCom() const;
 	bool				checkContact(const btCollisionObjectWrapper* colObjWrap,const btVector3& x,btScalar margin,btSoftBody::sCti& cti) const;
 	void				updateNormals();
-	void				updateBounds();
+	void				updateBounds(bool updateBroadphase=true);
+	void				updateBroadphaseAabb();
 	void				updatePose();
 	void				updateConstants();
 	void				updateLinkConstants();
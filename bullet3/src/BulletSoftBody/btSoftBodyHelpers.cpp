@@ -633,6 +633,9 @@ void btSoftBodyHelpers::ReoptimizeLinkOrder(btSoftBody *psb /* This can be repla
 		}
 	}
 
+	// The links are reordered, their batches don't apply anymore
+	psb->m_linkBatches.resize(0);
+
 	// Delete the temporary buffers
 	delete [] nodeWrittenAt;
 	delete [] linkDepA;
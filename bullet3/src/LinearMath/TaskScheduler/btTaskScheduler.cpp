@@ -3,6 +3,7 @@
 #include "LinearMath/btAlignedObjectArray.h"
 #include "LinearMath/btThreads.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btTimelineProfiler.h"
 #include <stdio.h>
 #include <algorithm>
 
@@ -374,6 +375,7 @@ static void WorkerThreadFunc( void* userPtr )
         localStorage->m_status = WorkerThreadStatus::kWaitingForWork;
         localStorage->m_mutex.unlock();
         btU64 clockStart = localStorage->m_clock->getTimeMicroseconds();
+        btTimelineBeginZone( "waitForJobs" );
         // while queue is empty,
         while (jobQueue->isQueueEmpty())
         {
@@ -411,7 +413,9 @@ static void WorkerThreadFunc( void* userPtr )
                 }
             }
         }
+        btTimelineEndZone();
     }
+    btTimelineInstantEvent( "workerSleep", threadId );
 
     // go sleep
     localStorage->m_mutex.lock();
@@ -564,6 +568,7 @@ public:
         setWorkerDirectives( WorkerThreadDirectives::kStayAwakeButIdle );
 
         btU64 clockStart = m_clock.getTimeMicroseconds();
+        btTimelineBeginZone( "waitForWorkers" );
         // wait for workers to finish any jobs in progress
         while ( true )
         {
@@ -587,6 +592,7 @@ public:
             }
             btSpinPause();
         }
+        btTimelineEndZone();
     }
 
     void wakeWorkers(int numWorkersToWake)
@@ -610,6 +616,7 @@ public:
             ThreadLocalStorage& storage = m_threadLocalStorage[ kFirstWorkerThreadId + iWorker ];
             if (storage.m_status == WorkerThreadStatus::kSleeping)
             {
+                btTimelineInstantEvent( "wakeWorker", kFirstWorkerThreadId + iWorker );
                 m_threadSupport->runTask( iWorker, &storage );
                 numActiveWorkers++;
             }
@@ -687,6 +694,7 @@ public:
                     iThread = kFirstWorkerThreadId;  // first worker thread
                 }
             }
+            btTimelineInstantEvent( "dispatchJobs", jobCount );
             wakeWorkers( jobCount - 1 );
 
             // put the main thread to work on emptying the job queue and then wait for all workers to finish
@@ -746,6 +754,7 @@ public:
                     iThread = kFirstWorkerThreadId;  // first worker thread
                 }
             }
+            btTimelineInstantEvent( "dispatchJobs", jobCount );
             wakeWorkers( jobCount - 1 );
 
             // put the main thread to work on emptying the job queue and then wait for all workers to finish
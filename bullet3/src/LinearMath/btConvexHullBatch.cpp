@@ -0,0 +1,122 @@
+/*
+Copyright (c) 2003-2018 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btConvexHullBatch.h"
+#include "btThreads.h"
+#include "btQuickprof.h"
+
+struct btConvexHullBatchLoop : public btIParallelForBody
+{
+	btConvexHullBatch*	m_batch;
+
+	void	forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+	{
+		for (int i = iBegin; i < iEnd; i++)
+		{
+			m_batch->computeHull(i);
+		}
+	}
+};
+
+btConvexHullBatch::btConvexHullBatch()
+	:m_useQuickHull(true),
+	m_maxVertices(0),
+	m_simplifyDistance(0)
+{
+}
+
+btConvexHullBatch::~btConvexHullBatch()
+{
+	for (int i = 0; i < m_computers.size(); i++)
+	{
+		m_computers[i]->~btConvexHullComputer();
+		btAlignedFree(m_computers[i]);
+	}
+}
+
+int btConvexHullBatch::addHull(const btVector3* points, int numPoints, btScalar shrink, btScalar shrinkClamp)
+{
+	btHullInfo info;
+	info.m_firstPoint = m_points.size();
+	info.m_numPoints = numPoints;
+	info.m_shrink = shrink;
+	info.m_shrinkClamp = shrinkClamp;
+	info.m_shift = 0;
+	info.m_usedExact = false;
+	m_hullInfos.push_back(info);
+	for (int i = 0; i < numPoints; i++)
+	{
+		m_points.push_back(points[i]);
+	}
+	return m_hullInfos.size() - 1;
+}
+
+void btConvexHullBatch::clear()
+{
+	m_points.resize(0);
+	m_hullInfos.resize(0);
+}
+
+void btConvexHullBatch::computeHull(int index)
+{
+	btHullInfo& info = m_hullInfos[index];
+	btConvexHullComputer* computer = m_computers[index];
+	if (info.m_numPoints == 0)
+	{
+		computer->vertices.resize(0);
+		computer->edges.resize(0);
+		computer->faces.resize(0);
+		info.m_shift = 0;
+		info.m_usedExact = false;
+		return;
+	}
+	const btScalar* coords = &m_points[info.m_firstPoint].getX();
+	if (m_useQuickHull)
+	{
+		info.m_shift = computer->computeQuick(coords, sizeof(btVector3), info.m_numPoints, info.m_shrink, info.m_shrinkClamp, m_maxVertices, m_simplifyDistance, &info.m_usedExact);
+	}
+	else
+	{
+		info.m_shift = computer->compute(coords, sizeof(btVector3), info.m_numPoints, info.m_shrink, info.m_shrinkClamp);
+		info.m_usedExact = true;
+	}
+}
+
+void btConvexHullBatch::computeHulls()
+{
+	BT_PROFILE("btConvexHullBatch::computeHulls");
+	int numHulls = m_hullInfos.size();
+	while (m_computers.size() < numHulls)
+	{
+		void* mem = btAlignedAlloc(sizeof(btConvexHullComputer), 16);
+		m_computers.push_back(new (mem) btConvexHullComputer());
+	}
+	btConvexHullBatchLoop loop;
+	loop.m_batch = this;
+	//the hulls differ a lot in cost, let the scheduler balance them one at a time
+	btParallelForOrSerial(0, numHulls, 1, loop);
+}
+
+int btConvexHullBatch::getNumExactFallbacks() const
+{
+	int numExact = 0;
+	for (int i = 0; i < m_hullInfos.size(); i++)
+	{
+		if (m_hullInfos[i].m_usedExact)
+		{
+			numExact++;
+		}
+	}
+	return numExact;
+}
@@ -0,0 +1,127 @@
+/*
+Copyright (c) 2003-2018 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_CONVEX_HULL_BATCH_H
+#define BT_CONVEX_HULL_BATCH_H
+
+#include "btVector3.h"
+#include "btAlignedObjectArray.h"
+#include "btConvexHullComputer.h"
+
+///btConvexHullBatch computes the convex hulls of many point sets at once, for example the cells of a runtime fracture.
+///The point sets are added with addHull, then computeHulls computes the hulls in parallel with btParallelFor,
+///one btConvexHullComputer per point set. By default the hulls are computed with btConvexHullComputer::computeQuick,
+///which can simplify them; see there. The btConvexHullComputers are kept over clear, so a batch that is used
+///again doesn't allocate once it has grown.
+class btConvexHullBatch
+{
+	struct btHullInfo
+	{
+		int		m_firstPoint;
+		int		m_numPoints;
+		btScalar	m_shrink;
+		btScalar	m_shrinkClamp;
+		btScalar	m_shift;
+		bool	m_usedExact;
+	};
+
+	btAlignedObjectArray<btVector3>	m_points;
+	btAlignedObjectArray<btHullInfo>	m_hullInfos;
+	btAlignedObjectArray<btConvexHullComputer*>	m_computers;
+
+	bool	m_useQuickHull;
+	int		m_maxVertices;
+	btScalar	m_simplifyDistance;
+
+	btConvexHullBatch(const btConvexHullBatch&);
+	btConvexHullBatch& operator=(const btConvexHullBatch&);
+
+	void	computeHull(int index);
+
+	friend struct btConvexHullBatchLoop;
+
+public:
+
+	btConvexHullBatch();
+
+	~btConvexHullBatch();
+
+	///the points are copied, shrink and shrinkClamp are passed to btConvexHullComputer::compute. Returns the index of the hull
+	int		addHull(const btVector3* points, int numPoints, btScalar shrink = 0, btScalar shrinkClamp = 0);
+
+	///removes the hulls, the memory is kept
+	void	clear();
+
+	void	computeHulls();
+
+	int		getNumHulls() const
+	{
+		return m_hullInfos.size();
+	}
+
+	///valid after computeHulls, until clear
+	const btConvexHullComputer*	getHull(int index) const
+	{
+		return m_computers[index];
+	}
+
+	///the shift returned by btConvexHullComputer::compute
+	btScalar	getShift(int index) const
+	{
+		return m_hullInfos[index].m_shift;
+	}
+
+	///the quickhull fell back to the exact algorithm, or isn't used
+	bool	usedExactAlgorithm(int index) const
+	{
+		return m_hullInfos[index].m_usedExact;
+	}
+
+	int		getNumExactFallbacks() const;
+
+	///when false, the exact algorithm of btConvexHullComputer::compute is used, and the hulls are not simplified
+	void	setUseQuickHull(bool useQuickHull)
+	{
+		m_useQuickHull = useQuickHull;
+	}
+
+	bool	getUseQuickHull() const
+	{
+		return m_useQuickHull;
+	}
+
+	///0 doesn't limit the number of vertices of a hull
+	void	setMaxVertices(int maxVertices)
+	{
+		m_maxVertices = maxVertices;
+	}
+
+	int		getMaxVertices() const
+	{
+		return m_maxVertices;
+	}
+
+	///points closer than this to a hull are left out, 0 keeps all points of the hull
+	void	setSimplifyDistance(btScalar simplifyDistance)
+	{
+		m_simplifyDistance = simplifyDistance;
+	}
+
+	btScalar	getSimplifyDistance() const
+	{
+		return m_simplifyDistance;
+	}
+};
+
+#endif //BT_CONVEX_HULL_BATCH_H
@@ -13,6 +13,8 @@ subject to the following restrictions:
 */
 
 #include <string.h>
+#include <float.h>
+#include <math.h>
 
 #include "btConvexHullComputer.h"
 #include "btAlignedObjectArray.h"
@@ -2763,6 +2765,1065 @@ btScalar btConvexHullComputer::compute(const void* coords, bool doubleCoords, in
 }
 
 
+// Floating point quickhull for computeQuick, see Barber, Dobkin and Huhdanpaa, "The Quickhull Algorithm for Convex Hulls".
+// It computes in double precision. Instead of repairing a hull that got inconsistent by roundoff it reports the failure,
+// and computeQuick uses the exact algorithm.
+class btQuickHullInternal
+{
+	public:
+		class PointD
+		{
+			public:
+				double x;
+				double y;
+				double z;
+
+				PointD()
+				{
+				}
+
+				PointD(double x, double y, double z): x(x), y(y), z(z)
+				{
+				}
+
+				PointD operator+(const PointD& b) const
+				{
+					return PointD(x + b.x, y + b.y, z + b.z);
+				}
+
+				PointD operator-(const PointD& b) const
+				{
+					return PointD(x - b.x, y - b.y, z - b.z);
+				}
+
+				PointD operator*(double s) const
+				{
+					return PointD(x * s, y * s, z * s);
+				}
+
+				double dot(const PointD& b) const
+				{
+					return x * b.x + y * b.y + z * b.z;
+				}
+
+				PointD cross(const PointD& b) const
+				{
+					return PointD(y * b.z - z * b.y, z * b.x - x * b.z, x * b.y - y * b.x);
+				}
+
+				double length() const
+				{
+					return sqrt(dot(*this));
+				}
+		};
+
+		class Face
+		{
+			public:
+				int v[3]; // counter-clockwise seen from outside
+				int adj[3]; // the face on the other side of the edge from v[i] to v[(i + 1) % 3]
+				PointD normal;
+				double offset; // the signed distance of p to the face is normal.dot(p) - offset
+				double area;
+				int firstOutside; // the points outside of this face, linked by nextOutside
+				int furthest;
+				double furthestDistance;
+				int visited;
+				bool visible;
+				bool removed;
+		};
+
+		class Merge
+		{
+			public:
+				double dot;
+				int face0;
+				int face1;
+		};
+
+		class MergeCmp
+		{
+			public:
+				bool operator()(const Merge& a, const Merge& b) const
+				{
+					return a.dot > b.dot;
+				}
+		};
+
+		const char* coords;
+		bool doubleCoords;
+		int stride;
+
+		// the points relative to the center of their bounding box, which keeps the roundoff small
+		btAlignedObjectArray<PointD> points;
+		double tolerance;
+		btAlignedObjectArray<int> nextOutside;
+		btAlignedObjectArray<int> isVertex;
+		int numVertices;
+		btAlignedObjectArray<Face> faces;
+		btAlignedObjectArray<int> freeFaces;
+		btAlignedObjectArray<int> pendingFaces;
+		int visitStamp;
+
+		// scratch of addPoint
+		btAlignedObjectArray<int> stack;
+		btAlignedObjectArray<int> visibleFaces;
+		btAlignedObjectArray<int> horizonFaces;
+		btAlignedObjectArray<int> horizonEdges;
+		btAlignedObjectArray<int> horizonOrder;
+		btAlignedObjectArray<int> newFaces;
+		btAlignedObjectArray<int> vertexScratch; // -1 between uses
+
+		// the result of extractPolygons: the input indices of the hull vertices, and the faces as loops of indices into them
+		btAlignedObjectArray<int> hullVertices;
+		btAlignedObjectArray<int> polygonStart;
+		btAlignedObjectArray<int> polygonVertices;
+
+		PointD getInputPoint(int index) const
+		{
+			const char* ptr = coords + index * stride;
+			if (doubleCoords)
+			{
+				const double* v = (const double*) ptr;
+				return PointD(v[0], v[1], v[2]);
+			}
+			const float* v = (const float*) ptr;
+			return PointD(v[0], v[1], v[2]);
+		}
+
+		double distance(const Face& face, const PointD& p) const
+		{
+			return face.normal.dot(p) - face.offset;
+		}
+
+		void load(const void* coords, bool doubleCoords, int stride, int count);
+
+		bool build(int maxVertices, double simplifyDistance);
+
+		bool extractPolygons();
+
+	private:
+		int newFace(int a, int b, int c);
+
+		bool buildSimplex();
+
+		void assignPoint(int point, const int* candidates, int numCandidates);
+
+		bool addPoint(int eyeFace);
+
+		int findGroup(btAlignedObjectArray<int>& parent, int face);
+};
+
+void btQuickHullInternal::load(const void* coords, bool doubleCoords, int stride, int count)
+{
+	this->coords = (const char*) coords;
+	this->doubleCoords = doubleCoords;
+	this->stride = stride;
+
+	points.resize(count);
+	PointD min = getInputPoint(0);
+	PointD max = min;
+	for (int i = 0; i < count; i++)
+	{
+		PointD p = getInputPoint(i);
+		points[i] = p;
+		min = PointD(btMin(min.x, p.x), btMin(min.y, p.y), btMin(min.z, p.z));
+		max = PointD(btMax(max.x, p.x), btMax(max.y, p.y), btMax(max.z, p.z));
+	}
+	PointD center = (min + max) * 0.5;
+	for (int i = 0; i < count; i++)
+	{
+		points[i] = points[i] - center;
+	}
+	// the roundoff of the distance of a point to a face
+	PointD halfExtent = (max - min) * 0.5;
+	tolerance = 3 * (halfExtent.x + halfExtent.y + halfExtent.z) * DBL_EPSILON;
+
+	nextOutside.resize(count);
+	isVertex.resize(count);
+	vertexScratch.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		nextOutside[i] = -1;
+		isVertex[i] = 0;
+		vertexScratch[i] = -1;
+	}
+	numVertices = 0;
+	faces.reserve(4 * count);
+	visitStamp = 0;
+}
+
+int btQuickHullInternal::newFace(int a, int b, int c)
+{
+	int index;
+	if (freeFaces.size())
+	{
+		index = freeFaces[freeFaces.size() - 1];
+		freeFaces.pop_back();
+	}
+	else
+	{
+		index = faces.size();
+		faces.expand();
+	}
+	Face& face = faces[index];
+	face.v[0] = a;
+	face.v[1] = b;
+	face.v[2] = c;
+	face.adj[0] = face.adj[1] = face.adj[2] = -1;
+	const PointD& pa = points[a];
+	const PointD& pb = points[b];
+	const PointD& pc = points[c];
+	// the cross product of the two shorter edges has the smallest roundoff
+	PointD ab = pb - pa;
+	PointD bc = pc - pb;
+	PointD ca = pa - pc;
+	double ab2 = ab.dot(ab);
+	double bc2 = bc.dot(bc);
+	double ca2 = ca.dot(ca);
+	PointD normal;
+	if ((ab2 >= bc2) && (ab2 >= ca2))
+	{
+		normal = bc.cross(ca);
+	}
+	else if (bc2 >= ca2)
+	{
+		normal = ca.cross(ab);
+	}
+	else
+	{
+		normal = ab.cross(bc);
+	}
+	double length = normal.length();
+	face.area = length * 0.5;
+	face.normal = (length > 0) ? normal * (1 / length) : PointD(0, 0, 0);
+	face.offset = face.normal.dot(pa + pb + pc) / 3;
+	face.firstOutside = -1;
+	face.furthest = -1;
+	face.furthestDistance = 0;
+	face.visited = 0;
+	face.visible = false;
+	face.removed = false;
+	return index;
+}
+
+bool btQuickHullInternal::buildSimplex()
+{
+	int count = points.size();
+	if (count < 4)
+	{
+		return false;
+	}
+
+	// the two extreme points along the axes that are farthest apart
+	int extremes[6] = {0, 0, 0, 0, 0, 0};
+	for (int i = 1; i < count; i++)
+	{
+		const PointD& p = points[i];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			if ((&p.x)[axis] < (&points[extremes[axis]].x)[axis])
+			{
+				extremes[axis] = i;
+			}
+			if ((&p.x)[axis] > (&points[extremes[axis + 3]].x)[axis])
+			{
+				extremes[axis + 3] = i;
+			}
+		}
+	}
+	int i0 = 0;
+	int i1 = 0;
+	double maxDistance = 0;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		double d = (points[extremes[axis + 3]] - points[extremes[axis]]).length();
+		if (d > maxDistance)
+		{
+			maxDistance = d;
+			i0 = extremes[axis];
+			i1 = extremes[axis + 3];
+		}
+	}
+	if (maxDistance <= tolerance)
+	{
+		return false;
+	}
+
+	// the point farthest from their line, and the point farthest from the plane of the three
+	PointD dir = (points[i1] - points[i0]) * (1 / maxDistance);
+	int i2 = 0;
+	maxDistance = 0;
+	for (int i = 0; i < count; i++)
+	{
+		double d = (points[i] - points[i0]).cross(dir).length();
+		if (d > maxDistance)
+		{
+			maxDistance = d;
+			i2 = i;
+		}
+	}
+	if (maxDistance <= tolerance)
+	{
+		return false;
+	}
+	PointD normal = (points[i1] - points[i0]).cross(points[i2] - points[i0]);
+	normal = normal * (1 / normal.length());
+	int i3 = 0;
+	maxDistance = 0;
+	for (int i = 0; i < count; i++)
+	{
+		double d = btFabs(normal.dot(points[i] - points[i0]));
+		if (d > maxDistance)
+		{
+			maxDistance = d;
+			i3 = i;
+		}
+	}
+	if (maxDistance <= tolerance)
+	{
+		return false;
+	}
+
+	int simplex[4] = {i0, i1, i2, i3};
+	int simplexFaces[4];
+	for (int i = 0; i < 4; i++)
+	{
+		// the face opposite to simplex[i], which has to be behind it
+		int a = simplex[(i + 1) & 3];
+		int b = simplex[(i + 2) & 3];
+		int c = simplex[(i + 3) & 3];
+		simplexFaces[i] = newFace(a, b, c);
+		if (distance(faces[simplexFaces[i]], points[simplex[i]]) > 0)
+		{
+			freeFaces.push_back(simplexFaces[i]);
+			simplexFaces[i] = newFace(a, c, b);
+		}
+		isVertex[simplex[i]] = 1;
+	}
+	numVertices = 4;
+	for (int i = 0; i < 4; i++)
+	{
+		Face& face = faces[simplexFaces[i]];
+		for (int e = 0; e < 3; e++)
+		{
+			int a = face.v[e];
+			int b = face.v[(e + 1) % 3];
+			for (int j = 0; j < 4; j++)
+			{
+				const Face& other = faces[simplexFaces[j]];
+				for (int k = 0; k < 3; k++)
+				{
+					if ((other.v[k] == b) && (other.v[(k + 1) % 3] == a))
+					{
+						face.adj[e] = simplexFaces[j];
+					}
+				}
+			}
+		}
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		if (!isVertex[i])
+		{
+			assignPoint(i, simplexFaces, 4);
+		}
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		if (faces[simplexFaces[i]].firstOutside >= 0)
+		{
+			pendingFaces.push_back(simplexFaces[i]);
+		}
+	}
+	return true;
+}
+
+void btQuickHullInternal::assignPoint(int point, const int* candidates, int numCandidates)
+{
+	const PointD& p = points[point];
+	int best = -1;
+	double bestDistance = tolerance;
+	for (int i = 0; i < numCandidates; i++)
+	{
+		double d = distance(faces[candidates[i]], p);
+		if (d > bestDistance)
+		{
+			bestDistance = d;
+			best = candidates[i];
+		}
+	}
+	// points that are not outside of any of the candidates are inside the hull
+	if (best >= 0)
+	{
+		Face& face = faces[best];
+		nextOutside[point] = face.firstOutside;
+		face.firstOutside = point;
+		if (bestDistance > face.furthestDistance)
+		{
+			face.furthestDistance = bestDistance;
+			face.furthest = point;
+		}
+	}
+}
+
+bool btQuickHullInternal::addPoint(int eyeFace)
+{
+	int eye = faces[eyeFace].furthest;
+	PointD eyePoint = points[eye];
+
+	// the faces that see the eye point, and the edges where they border on the faces that don't
+	visitStamp++;
+	visibleFaces.resize(0);
+	horizonFaces.resize(0);
+	horizonEdges.resize(0);
+	stack.resize(0);
+	faces[eyeFace].visited = visitStamp;
+	faces[eyeFace].visible = true;
+	stack.push_back(eyeFace);
+	while (stack.size())
+	{
+		int f = stack[stack.size() - 1];
+		stack.pop_back();
+		visibleFaces.push_back(f);
+		for (int e = 0; e < 3; e++)
+		{
+			Face& neighbor = faces[faces[f].adj[e]];
+			if (neighbor.visited != visitStamp)
+			{
+				neighbor.visited = visitStamp;
+				neighbor.visible = distance(neighbor, eyePoint) > 0;
+				if (neighbor.visible)
+				{
+					stack.push_back(faces[f].adj[e]);
+				}
+			}
+			if (!neighbor.visible)
+			{
+				horizonFaces.push_back(f);
+				horizonEdges.push_back(e);
+			}
+		}
+	}
+
+	// the horizon has to be a single loop, link its edges by their start vertices
+	int numHorizon = horizonFaces.size();
+	if (numHorizon < 3)
+	{
+		return false;
+	}
+	for (int i = 0; i < numHorizon; i++)
+	{
+		int start = faces[horizonFaces[i]].v[horizonEdges[i]];
+		if (vertexScratch[start] >= 0)
+		{
+			return false;
+		}
+		vertexScratch[start] = i;
+	}
+	horizonOrder.resize(numHorizon);
+	horizonOrder[0] = 0;
+	for (int i = 1; i <= numHorizon; i++)
+	{
+		int prev = horizonOrder[i - 1];
+		int end = faces[horizonFaces[prev]].v[(horizonEdges[prev] + 1) % 3];
+		int next = vertexScratch[end];
+		if ((next < 0) || ((next == 0) != (i == numHorizon)))
+		{
+			return false;
+		}
+		if (i < numHorizon)
+		{
+			horizonOrder[i] = next;
+		}
+	}
+	for (int i = 0; i < numHorizon; i++)
+	{
+		vertexScratch[faces[horizonFaces[i]].v[horizonEdges[i]]] = -1;
+	}
+
+	// a fan of new faces from the horizon to the eye point
+	newFaces.resize(numHorizon);
+	for (int i = 0; i < numHorizon; i++)
+	{
+		int f = horizonFaces[horizonOrder[i]];
+		int e = horizonEdges[horizonOrder[i]];
+		int a = faces[f].v[e];
+		int b = faces[f].v[(e + 1) % 3];
+		int outer = faces[f].adj[e];
+		int face = newFace(a, b, eye);
+		if (faces[face].area <= 0)
+		{
+			return false;
+		}
+		faces[face].adj[0] = outer;
+		Face& outerFace = faces[outer];
+		for (int k = 0; k < 3; k++)
+		{
+			if ((outerFace.v[k] == b) && (outerFace.v[(k + 1) % 3] == a))
+			{
+				outerFace.adj[k] = face;
+			}
+		}
+		newFaces[i] = face;
+	}
+	for (int i = 0; i < numHorizon; i++)
+	{
+		faces[newFaces[i]].adj[1] = newFaces[(i + 1) % numHorizon];
+		faces[newFaces[i]].adj[2] = newFaces[(i + numHorizon - 1) % numHorizon];
+	}
+
+	// the points outside of the removed faces are outside of a new face, or inside the hull
+	for (int i = 0; i < visibleFaces.size(); i++)
+	{
+		Face& face = faces[visibleFaces[i]];
+		int p = face.firstOutside;
+		while (p >= 0)
+		{
+			int next = nextOutside[p];
+			if (p != eye)
+			{
+				assignPoint(p, &newFaces[0], numHorizon);
+			}
+			p = next;
+		}
+		face.firstOutside = -1;
+		face.removed = true;
+		freeFaces.push_back(visibleFaces[i]);
+	}
+	for (int i = 0; i < numHorizon; i++)
+	{
+		if (faces[newFaces[i]].firstOutside >= 0)
+		{
+			pendingFaces.push_back(newFaces[i]);
+		}
+	}
+	isVertex[eye] = 1;
+	numVertices++;
+	return true;
+}
+
+bool btQuickHullInternal::build(int maxVertices, double simplifyDistance)
+{
+	if (!buildSimplex())
+	{
+		return false;
+	}
+	bool simplify = (maxVertices > 0) || (simplifyDistance > 0);
+	if (maxVertices > 0)
+	{
+		maxVertices = btMax(maxVertices, 4);
+	}
+	while (true)
+	{
+		int eyeFace = -1;
+		if (simplify)
+		{
+			// the point farthest from the hull comes first
+			double maxDistance = btMax(simplifyDistance, tolerance);
+			for (int i = 0; i < faces.size(); i++)
+			{
+				const Face& face = faces[i];
+				if (!face.removed && (face.firstOutside >= 0) && (face.furthestDistance > maxDistance))
+				{
+					maxDistance = face.furthestDistance;
+					eyeFace = i;
+				}
+			}
+		}
+		else
+		{
+			while (pendingFaces.size() && (eyeFace < 0))
+			{
+				int f = pendingFaces[pendingFaces.size() - 1];
+				pendingFaces.pop_back();
+				if (!faces[f].removed && (faces[f].firstOutside >= 0))
+				{
+					eyeFace = f;
+				}
+			}
+		}
+		if ((eyeFace < 0) || ((maxVertices > 0) && (numVertices >= maxVertices)))
+		{
+			return true;
+		}
+		if (!addPoint(eyeFace))
+		{
+			return false;
+		}
+	}
+}
+
+int btQuickHullInternal::findGroup(btAlignedObjectArray<int>& parent, int face)
+{
+	int root = face;
+	while (parent[root] != root)
+	{
+		root = parent[root];
+	}
+	while (parent[face] != root)
+	{
+		int next = parent[face];
+		parent[face] = root;
+		face = next;
+	}
+	return root;
+}
+
+bool btQuickHullInternal::extractPolygons()
+{
+	int numFaces = faces.size();
+
+	// merge neighboring faces, the flattest first, as long as the vertices of a group are within the tolerance of a plane
+	btAlignedObjectArray<int> parent;
+	btAlignedObjectArray<int> nextMember;
+	btAlignedObjectArray<int> lastMember;
+	btAlignedObjectArray<PointD> normalSum;
+	btAlignedObjectArray<Merge> merges;
+	parent.resize(numFaces);
+	nextMember.resize(numFaces);
+	lastMember.resize(numFaces);
+	normalSum.resize(numFaces);
+	for (int f = 0; f < numFaces; f++)
+	{
+		const Face& face = faces[f];
+		parent[f] = f;
+		nextMember[f] = -1;
+		lastMember[f] = f;
+		normalSum[f] = face.normal * face.area;
+		if (face.removed)
+		{
+			continue;
+		}
+		for (int e = 0; e < 3; e++)
+		{
+			int g = face.adj[e];
+			if (g < f)
+			{
+				continue;
+			}
+			const Face& other = faces[g];
+			int k = 0;
+			while ((other.adj[k] != f) && (k < 2))
+			{
+				k++;
+			}
+			double d0 = distance(face, points[other.v[(k + 2) % 3]]);
+			double d1 = distance(other, points[face.v[(e + 2) % 3]]);
+			if ((btFabs(d0) <= 2 * tolerance) && (btFabs(d1) <= 2 * tolerance))
+			{
+				Merge merge;
+				merge.dot = face.normal.dot(other.normal);
+				merge.face0 = f;
+				merge.face1 = g;
+				merges.push_back(merge);
+			}
+		}
+	}
+	merges.quickSort(MergeCmp());
+	for (int i = 0; i < merges.size(); i++)
+	{
+		int g0 = findGroup(parent, merges[i].face0);
+		int g1 = findGroup(parent, merges[i].face1);
+		if (g0 == g1)
+		{
+			continue;
+		}
+		PointD normal = normalSum[g0] + normalSum[g1];
+		double length = normal.length();
+		if (length <= 0)
+		{
+			continue;
+		}
+		normal = normal * (1 / length);
+		double min = DBL_MAX;
+		double max = -DBL_MAX;
+		for (int g = 0; g < 2; g++)
+		{
+			for (int f = (g ? g1 : g0); f >= 0; f = nextMember[f])
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					double d = normal.dot(points[faces[f].v[k]]);
+					min = btMin(min, d);
+					max = btMax(max, d);
+				}
+			}
+		}
+		if (max - min <= 2 * tolerance)
+		{
+			parent[g1] = g0;
+			normalSum[g0] = normalSum[g0] + normalSum[g1];
+			nextMember[lastMember[g0]] = g1;
+			lastMember[g0] = lastMember[g1];
+		}
+	}
+
+	// the faces are convex: the neighbors of a group are behind its plane, up to the roundoff of the visibility tests
+	btAlignedObjectArray<int> groupIndex;
+	btAlignedObjectArray<PointD> groupNormal;
+	btAlignedObjectArray<double> groupOffset;
+	btAlignedObjectArray<int> boundaryStart;
+	groupIndex.resize(numFaces);
+	groupNormal.reserve(numFaces);
+	groupOffset.reserve(numFaces);
+	int numGroups = 0;
+	for (int f = 0; f < numFaces; f++)
+	{
+		groupIndex[f] = -1;
+		if (!faces[f].removed && (findGroup(parent, f) == f))
+		{
+			groupIndex[f] = numGroups++;
+			PointD normal = normalSum[f] * (1 / normalSum[f].length());
+			double offset = -DBL_MAX;
+			for (int m = f; m >= 0; m = nextMember[m])
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					offset = btMax(offset, normal.dot(points[faces[m].v[k]]));
+				}
+			}
+			groupNormal.push_back(normal);
+			groupOffset.push_back(offset);
+		}
+	}
+	boundaryStart.resize(numGroups + 1);
+	for (int g = 0; g <= numGroups; g++)
+	{
+		boundaryStart[g] = 0;
+	}
+	for (int f = 0; f < numFaces; f++)
+	{
+		const Face& face = faces[f];
+		if (face.removed)
+		{
+			continue;
+		}
+		int g = groupIndex[findGroup(parent, f)];
+		for (int e = 0; e < 3; e++)
+		{
+			const Face& other = faces[face.adj[e]];
+			if (groupIndex[findGroup(parent, face.adj[e])] != g)
+			{
+				boundaryStart[g + 1]++;
+				for (int k = 0; k < 3; k++)
+				{
+					if (groupNormal[g].dot(points[other.v[k]]) > groupOffset[g] + 4 * tolerance)
+					{
+						return false;
+					}
+				}
+			}
+		}
+	}
+	for (int g = 0; g < numGroups; g++)
+	{
+		boundaryStart[g + 1] += boundaryStart[g];
+	}
+
+	// the edges between the groups, sorted by group
+	btAlignedObjectArray<int> boundaryFrom;
+	btAlignedObjectArray<int> boundaryTo;
+	btAlignedObjectArray<int> fill;
+	boundaryFrom.resize(boundaryStart[numGroups]);
+	boundaryTo.resize(boundaryStart[numGroups]);
+	fill.resize(numGroups);
+	for (int g = 0; g < numGroups; g++)
+	{
+		fill[g] = boundaryStart[g];
+	}
+	for (int f = 0; f < numFaces; f++)
+	{
+		const Face& face = faces[f];
+		if (face.removed)
+		{
+			continue;
+		}
+		int g = groupIndex[findGroup(parent, f)];
+		for (int e = 0; e < 3; e++)
+		{
+			if (groupIndex[findGroup(parent, face.adj[e])] != g)
+			{
+				int i = fill[g]++;
+				boundaryFrom[i] = face.v[e];
+				boundaryTo[i] = face.v[(e + 1) % 3];
+			}
+		}
+	}
+
+	// the boundary of each group has to be a single loop
+	btAlignedObjectArray<int> loops;
+	btAlignedObjectArray<int> faceCount;
+	loops.reserve(boundaryFrom.size());
+	faceCount.resize(points.size());
+	for (int i = 0; i < points.size(); i++)
+	{
+		faceCount[i] = 0;
+	}
+	polygonStart.resize(numGroups + 1);
+	for (int g = 0; g < numGroups; g++)
+	{
+		int begin = boundaryStart[g];
+		int end = boundaryStart[g + 1];
+		for (int i = begin; i < end; i++)
+		{
+			if (vertexScratch[boundaryFrom[i]] >= 0)
+			{
+				return false;
+			}
+			vertexScratch[boundaryFrom[i]] = i;
+		}
+		polygonStart[g] = loops.size();
+		int i = begin;
+		do
+		{
+			if (loops.size() - polygonStart[g] >= end - begin)
+			{
+				return false;
+			}
+			loops.push_back(boundaryFrom[i]);
+			faceCount[boundaryFrom[i]]++;
+			i = vertexScratch[boundaryTo[i]];
+			if (i < 0)
+			{
+				return false;
+			}
+		} while (i != begin);
+		if (loops.size() - polygonStart[g] != end - begin)
+		{
+			return false;
+		}
+		for (int i = begin; i < end; i++)
+		{
+			vertexScratch[boundaryFrom[i]] = -1;
+		}
+	}
+	polygonStart[numGroups] = loops.size();
+
+	// vertices that are on the boundary of only two faces are on the edge between them, they are left out.
+	// Vertices inside of a merged face aren't on any boundary
+	hullVertices.resize(0);
+	hullVertices.reserve(numVertices);
+	for (int i = 0; i < points.size(); i++)
+	{
+		if (faceCount[i] == 1)
+		{
+			return false;
+		}
+		if (faceCount[i] >= 3)
+		{
+			vertexScratch[i] = hullVertices.size();
+			hullVertices.push_back(i);
+		}
+	}
+	polygonVertices.resize(0);
+	polygonVertices.reserve(loops.size());
+	bool valid = true;
+	for (int g = 0; g < numGroups; g++)
+	{
+		int begin = polygonStart[g];
+		int size = polygonStart[g + 1] - begin;
+		int first = polygonVertices.size();
+		for (int i = 0; i < size; i++)
+		{
+			int v = loops[begin + i];
+			if (faceCount[v] >= 3)
+			{
+				polygonVertices.push_back(vertexScratch[v]);
+				continue;
+			}
+			// the vertex has to be on the line between the vertices around it that are kept
+			int prev = i;
+			do
+			{
+				prev = (prev + size - 1) % size;
+			} while ((faceCount[loops[begin + prev]] < 3) && (prev != i));
+			int next = i;
+			do
+			{
+				next = (next + 1) % size;
+			} while ((faceCount[loops[begin + next]] < 3) && (next != i));
+			const PointD& a = points[loops[begin + prev]];
+			PointD dir = points[loops[begin + next]] - a;
+			double length = dir.length();
+			if ((prev == i) || (length <= 0) || ((points[v] - a).cross(dir).length() > 4 * tolerance * length))
+			{
+				valid = false;
+			}
+		}
+		polygonStart[g] = first;
+		if (polygonVertices.size() - first < 3)
+		{
+			valid = false;
+		}
+	}
+	polygonStart[numGroups] = polygonVertices.size();
+	for (int i = 0; i < hullVertices.size(); i++)
+	{
+		vertexScratch[hullVertices[i]] = -1;
+	}
+	return valid;
+}
+
+bool btConvexHullComputer::computeQuickHull(const void* coords, bool doubleCoords, int stride, int count, int maxVertices, btScalar simplifyDistance)
+{
+	btQuickHullInternal hull;
+	hull.load(coords, doubleCoords, stride, count);
+	if (!hull.build(maxVertices, simplifyDistance) || !hull.extractPolygons())
+	{
+		return false;
+	}
+
+	int numVertices = hull.hullVertices.size();
+	int numPolygons = hull.polygonStart.size() - 1;
+	int numHalfEdges = hull.polygonVertices.size();
+	if ((numHalfEdges & 1) || (numVertices - numHalfEdges / 2 + numPolygons != 2))
+	{
+		return false;
+	}
+
+	// the half edges are numbered like the polygon vertices they start at, list them by start vertex
+	btAlignedObjectArray<int> faceNext;
+	btAlignedObjectArray<int> vertexStart;
+	btAlignedObjectArray<int> vertexEdges;
+	faceNext.resize(numHalfEdges);
+	vertexStart.resize(numVertices + 1);
+	vertexEdges.resize(numHalfEdges);
+	for (int i = 0; i <= numVertices; i++)
+	{
+		vertexStart[i] = 0;
+	}
+	for (int p = 0; p < numPolygons; p++)
+	{
+		int begin = hull.polygonStart[p];
+		int end = hull.polygonStart[p + 1];
+		for (int h = begin; h < end; h++)
+		{
+			faceNext[h] = (h + 1 < end) ? h + 1 : begin;
+			vertexStart[hull.polygonVertices[h]]++;
+		}
+	}
+	// the counts become the ends of the ranges, filling them moves the ends to the starts
+	for (int i = 1; i <= numVertices; i++)
+	{
+		vertexStart[i] += vertexStart[i - 1];
+	}
+	for (int h = 0; h < numHalfEdges; h++)
+	{
+		vertexEdges[--vertexStart[hull.polygonVertices[h]]] = h;
+	}
+
+	// the reverse of a half edge starts at its target and ends at its start, edges are stored as pairs of half edges
+	btAlignedObjectArray<int> slot;
+	slot.resize(numHalfEdges);
+	for (int h = 0; h < numHalfEdges; h++)
+	{
+		slot[h] = -1;
+	}
+	int numSlots = 0;
+	for (int h = 0; h < numHalfEdges; h++)
+	{
+		int from = hull.polygonVertices[h];
+		int to = hull.polygonVertices[faceNext[h]];
+		int reverse = -1;
+		for (int i = vertexStart[to]; i < vertexStart[to + 1]; i++)
+		{
+			if (hull.polygonVertices[faceNext[vertexEdges[i]]] == from)
+			{
+				if (reverse >= 0)
+				{
+					return false;
+				}
+				reverse = vertexEdges[i];
+			}
+		}
+		if (reverse < 0)
+		{
+			return false;
+		}
+		if (slot[h] < 0)
+		{
+			if (slot[reverse] >= 0)
+			{
+				return false;
+			}
+			slot[h] = numSlots++;
+			slot[reverse] = numSlots++;
+		}
+		else if (slot[reverse] != (slot[h] ^ 1))
+		{
+			return false;
+		}
+	}
+
+	vertices.resize(numVertices);
+	for (int i = 0; i < numVertices; i++)
+	{
+		btQuickHullInternal::PointD p = hull.getInputPoint(hull.hullVertices[i]);
+		vertices[i].setValue(btScalar(p.x), btScalar(p.y), btScalar(p.z));
+	}
+	edges.resize(numHalfEdges);
+	faces.resize(numPolygons);
+	for (int h = 0; h < numHalfEdges; h++)
+	{
+		int s = slot[h];
+		int r = s ^ 1;
+		edges[s].reverse = r - s;
+		edges[s].targetVertex = hull.polygonVertices[faceNext[h]];
+		// the next edge of the face follows the reverse edge around the target vertex
+		edges[r].next = slot[faceNext[h]] - r;
+	}
+	for (int p = 0; p < numPolygons; p++)
+	{
+		faces[p] = slot[hull.polygonStart[p]];
+	}
+
+	// the edges around each vertex have to form a single loop
+	for (int i = 0; i < numVertices; i++)
+	{
+		int degree = vertexStart[i + 1] - vertexStart[i];
+		const Edge* first = &edges[slot[vertexEdges[vertexStart[i]]]];
+		const Edge* edge = first;
+		int n = 0;
+		do
+		{
+			if ((edge->getSourceVertex() != i) || (++n > degree))
+			{
+				return false;
+			}
+			edge = edge->getNextEdgeOfVertex();
+		} while (edge != first);
+		if (n != degree)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+btScalar btConvexHullComputer::computeQuick(const void* coords, bool doubleCoords, int stride, int count, btScalar shrink, btScalar shrinkClamp, int maxVertices, btScalar simplifyDistance, bool* usedExact)
+{
+	bool quick = (count > 0) && computeQuickHull(coords, doubleCoords, stride, count, maxVertices, simplifyDistance);
+	if (usedExact)
+	{
+		*usedExact = !quick;
+	}
+	if (!quick)
+	{
+		return compute(coords, doubleCoords, stride, count, shrink, shrinkClamp);
+	}
+	if (shrink > 0)
+	{
+		// only the vertices of the quick hull matter to the exact algorithm
+		btAlignedObjectArray<btVector3> hullVertices;
+		hullVertices.copyFromArray(vertices);
+		return compute(&hullVertices[0].getX(), sizeof(btVector3), hullVertices.size(), shrink, shrinkClamp);
+	}
+	return 0;
+}
+
+
 
 
 
@@ -26,6 +26,10 @@ class btConvexHullComputer
 	private:
 		btScalar compute(const void* coords, bool doubleCoords, int stride, int count, btScalar shrink, btScalar shrinkClamp);
 
+		btScalar computeQuick(const void* coords, bool doubleCoords, int stride, int count, btScalar shrink, btScalar shrinkClamp, int maxVertices, btScalar simplifyDistance, bool* usedExact);
+
+		bool computeQuickHull(const void* coords, bool doubleCoords, int stride, int count, int maxVertices, btScalar simplifyDistance);
+
 	public:
 
 		class Edge
@@ -96,6 +100,31 @@ class btConvexHullComputer
 		{
 			return compute(coords, true, stride, count, shrink, shrinkClamp);
 		}
+
+		/*
+		Same as compute, but the hull is built by a floating point quickhull, which is faster than the exact integer arithmetic
+		of compute, especially when most of the points are inside the hull. Points within a small tolerance of the hull (relative
+		to the extent of the points) can be left out, and faces that are coplanar within that tolerance are merged.
+		When the points are degenerate (colinear or coplanar within the tolerance), or the quickhull doesn't result in a valid
+		convex polyhedron, the exact algorithm of compute is used instead, and "usedExact" (if given) is set to true.
+
+		The hull can be simplified: if "maxVertices" is positive, the hull has at most that many vertices (but at least 4), and
+		if "simplifyDistance" is positive, points that are closer than that to the hull are left out. The points that are
+		farthest from the hull are added first, so the simplified hull is the hull of a subset of the points that lies inside
+		the exact hull. The exact algorithm doesn't simplify.
+
+		Shrinking is done by the exact algorithm, on the vertices of the quick hull.
+		*/
+		btScalar computeQuick(const float* coords, int stride, int count, btScalar shrink, btScalar shrinkClamp, int maxVertices = 0, btScalar simplifyDistance = 0, bool* usedExact = 0)
+		{
+			return computeQuick(coords, false, stride, count, shrink, shrinkClamp, maxVertices, simplifyDistance, usedExact);
+		}
+
+		// same as above, but double precision
+		btScalar computeQuick(const double* coords, int stride, int count, btScalar shrink, btScalar shrinkClamp, int maxVertices = 0, btScalar simplifyDistance = 0, bool* usedExact = 0)
+		{
+			return computeQuick(coords, true, stride, count, shrink, shrinkClamp, maxVertices, simplifyDistance, usedExact);
+		}
 };
 
 
@@ -0,0 +1,184 @@
+/*
+Copyright (c) 2003-2018 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btFrameArena.h"
+#include "btThreads.h"
+#include "btMinMax.h"
+
+//the first chunk of an arena, it grows from there
+static const size_t	BT_FRAME_ARENA_MIN_CHUNK_SIZE = 64 * 1024;
+
+btFrameArena::btFrameArena()
+	:m_currentChunk(-1),
+	m_chunkUsed(0),
+	m_used(0),
+	m_peakUsed(0),
+	m_numChunkAllocations(0),
+	m_numConsolidations(0)
+{
+}
+
+btFrameArena::~btFrameArena()
+{
+	freeMemory();
+}
+
+void* btFrameArena::allocate(size_t size, size_t alignment)
+{
+	btAssert(alignment && (alignment & (alignment - 1)) == 0);
+	while (true)
+	{
+		if (m_currentChunk >= 0)
+		{
+			btChunk& chunk = m_chunks[m_currentChunk];
+			size_t address = size_t(chunk.m_memory) + m_chunkUsed;
+			size_t padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+			if (m_chunkUsed + padding + size <= chunk.m_size)
+			{
+				m_chunkUsed += padding + size;
+				m_used += padding + size;
+				m_peakUsed = btMax(m_peakUsed, m_used);
+				return (void*)(address + padding);
+			}
+		}
+		//the rest of this chunk stays unused until a rewind, continue in the next chunk if it fits
+		if (m_currentChunk + 1 < m_chunks.size() && m_chunks[m_currentChunk + 1].m_size >= size + alignment)
+		{
+			m_currentChunk++;
+			m_chunkUsed = 0;
+			continue;
+		}
+		break;
+	}
+
+	//add a chunk after the current one, the chunks behind it are too small for this and are freed
+	for (int i = m_chunks.size() - 1; i > m_currentChunk; i--)
+	{
+		btAlignedFree(m_chunks[i].m_memory);
+		m_chunks.pop_back();
+	}
+	size_t lastSize = m_chunks.size() ? m_chunks[m_chunks.size() - 1].m_size : 0;
+	btChunk chunk;
+	chunk.m_size = btMax(btMax(BT_FRAME_ARENA_MIN_CHUNK_SIZE, lastSize * 2), size + alignment);
+	chunk.m_memory = (unsigned char*)btAlignedAlloc(chunk.m_size, 16);
+	m_chunks.push_back(chunk);
+	m_numChunkAllocations++;
+	m_currentChunk = m_chunks.size() - 1;
+	m_chunkUsed = 0;
+	return allocate(size, alignment);
+}
+
+void btFrameArena::reset()
+{
+	if (m_used != 0)
+	{
+		//still in use, by a scope around the step
+		return;
+	}
+	m_currentChunk = m_chunks.size() ? 0 : -1;
+	m_chunkUsed = 0;
+	if (m_chunks.size() > 1)
+	{
+		//the peak is the sum of the allocations with their padding, one chunk of that size, with some slack, fits them
+		size_t size = btMax(BT_FRAME_ARENA_MIN_CHUNK_SIZE, m_peakUsed + m_peakUsed / 4);
+		freeMemory();
+		btChunk chunk;
+		chunk.m_size = size;
+		chunk.m_memory = (unsigned char*)btAlignedAlloc(chunk.m_size, 16);
+		m_chunks.push_back(chunk);
+		m_currentChunk = 0;
+		m_numConsolidations++;
+	}
+}
+
+void btFrameArena::freeMemory()
+{
+	btAssert(m_used == 0);
+	for (int i = 0; i < m_chunks.size(); i++)
+	{
+		btAlignedFree(m_chunks[i].m_memory);
+	}
+	m_chunks.clear();
+	m_currentChunk = -1;
+	m_chunkUsed = 0;
+	m_used = 0;
+}
+
+size_t btFrameArena::getCapacityBytes() const
+{
+	size_t capacity = 0;
+	for (int i = 0; i < m_chunks.size(); i++)
+	{
+		capacity += m_chunks[i].m_size;
+	}
+	return capacity;
+}
+
+btFrameArena* btThreadFrameArenas::getArena()
+{
+#if BT_THREADSAFE
+	unsigned int threadIndex = btGetCurrentThreadIndex();
+	btAssert(threadIndex < BT_MAX_THREAD_COUNT);
+	return &m_arenas[threadIndex];
+#else
+	//every thread has index 0 here, the callers fall back to the heap
+	return 0;
+#endif
+}
+
+void btThreadFrameArenas::reset()
+{
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		m_arenas[i].reset();
+	}
+}
+
+void btThreadFrameArenas::freeMemory()
+{
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		m_arenas[i].freeMemory();
+	}
+}
+
+void btThreadFrameArenas::getStatistics(btFrameArenaStatistics& statistics) const
+{
+	statistics.m_numThreadArenas = 0;
+	statistics.m_capacityBytes = 0;
+	statistics.m_peakUsedBytes = 0;
+	statistics.m_numChunkAllocations = 0;
+	statistics.m_numConsolidations = 0;
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		const btFrameArena& arena = m_arenas[i];
+		size_t capacity = arena.getCapacityBytes();
+		if (capacity)
+		{
+			statistics.m_numThreadArenas++;
+		}
+		statistics.m_capacityBytes += capacity;
+		statistics.m_peakUsedBytes = btMax(statistics.m_peakUsedBytes, arena.getPeakUsedBytes());
+		statistics.m_numChunkAllocations += arena.getNumChunkAllocations();
+		statistics.m_numConsolidations += arena.getNumConsolidations();
+	}
+}
+
+void btThreadFrameArenas::resetStatistics()
+{
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		m_arenas[i].resetStatistics();
+	}
+}
@@ -0,0 +1,204 @@
+/*
+Copyright (c) 2003-2018 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_FRAME_ARENA_H
+#define BT_FRAME_ARENA_H
+
+#include "btScalar.h"
+#include "btAlignedAllocator.h"
+#include "btAlignedObjectArray.h"
+#include "btMinMax.h"
+#include "btThreads.h"
+
+///btFrameArena is a linear allocator for scratch memory that is released within a simulation step.
+///An arena is used by one thread at a time (see btThreadFrameArenas), so allocating takes no lock and is a pointer bump.
+///Memory is released in LIFO order by rewinding to a marker, usually with a btFrameArenaScope.
+///When a chunk is full another one is added, and reset replaces the chunks of an idle arena by
+///a single chunk that fits its peak use, so after a few steps an arena doesn't allocate anymore.
+class btFrameArena
+{
+	struct btChunk
+	{
+		unsigned char*	m_memory;
+		size_t			m_size;
+	};
+
+	btAlignedObjectArray<btChunk>	m_chunks;
+	int				m_currentChunk;
+	size_t			m_chunkUsed;
+	size_t			m_used;
+	size_t			m_peakUsed;
+	int				m_numChunkAllocations;
+	int				m_numConsolidations;
+
+public:
+
+	struct Marker
+	{
+		int		m_chunk;
+		size_t	m_chunkUsed;
+		size_t	m_used;
+	};
+
+	btFrameArena();
+
+	~btFrameArena();
+
+	///returns memory aligned to alignment (a power of 2), valid until the arena is rewound past it
+	void*	allocate(size_t size, size_t alignment = 16);
+
+	Marker	getMarker() const
+	{
+		Marker marker;
+		marker.m_chunk = m_currentChunk;
+		marker.m_chunkUsed = m_chunkUsed;
+		marker.m_used = m_used;
+		return marker;
+	}
+
+	///releases everything that was allocated after the marker was taken
+	void	rewind(const Marker& marker)
+	{
+		btAssert(marker.m_used <= m_used);
+		m_currentChunk = marker.m_chunk;
+		m_chunkUsed = marker.m_chunkUsed;
+		m_used = marker.m_used;
+	}
+
+	///when nothing is allocated and the arena had to add chunks, they are replaced by one chunk that fits the peak use
+	void	reset();
+
+	///frees all chunks, nothing may be allocated
+	void	freeMemory();
+
+	size_t	getUsedBytes() const
+	{
+		return m_used;
+	}
+
+	size_t	getPeakUsedBytes() const
+	{
+		return m_peakUsed;
+	}
+
+	size_t	getCapacityBytes() const;
+
+	///the number of chunks allocated because the arena was full, including the first one
+	int		getNumChunkAllocations() const
+	{
+		return m_numChunkAllocations;
+	}
+
+	int		getNumConsolidations() const
+	{
+		return m_numConsolidations;
+	}
+
+	void	resetStatistics()
+	{
+		m_peakUsed = m_used;
+		m_numChunkAllocations = 0;
+		m_numConsolidations = 0;
+	}
+};
+
+///frame arena use of a btThreadFrameArenas, to see if the scratch memory settles
+struct btFrameArenaStatistics
+{
+	int		m_numThreadArenas;		//arenas that hold memory
+	size_t	m_capacityBytes;
+	size_t	m_peakUsedBytes;		//the largest peak use of a single arena
+	int		m_numChunkAllocations;	//when this keeps increasing, the arenas keep overflowing
+	int		m_numConsolidations;
+};
+
+///btThreadFrameArenas holds the frame arenas of one owner, such as a dispatcher or a solver, one for each thread index.
+///Owners that are stepped on different threads don't share arenas, and resetting them leaves other owners alone.
+///Thread indices are only distinct in BT_THREADSAFE builds, otherwise getArena returns 0 and the callers use the heap
+class btThreadFrameArenas
+{
+	btFrameArena	m_arenas[BT_MAX_THREAD_COUNT];
+
+	btThreadFrameArenas(const btThreadFrameArenas&);
+	btThreadFrameArenas& operator=(const btThreadFrameArenas&);
+
+public:
+
+	btThreadFrameArenas()
+	{
+	}
+
+	///the arena of the calling thread, or 0 when threads don't have their own index
+	btFrameArena*	getArena();
+
+	///resets the arenas at the start of a step, no thread may allocate from them meanwhile
+	void	reset();
+
+	///frees the memory of the arenas, none may be in use
+	void	freeMemory();
+
+	void	getStatistics(btFrameArenaStatistics& statistics) const;
+
+	void	resetStatistics();
+};
+
+///allocates from an arena, and rewinds it when going out of scope.
+///Without an arena the arrays of initializeArray stay on the heap
+class btFrameArenaScope
+{
+	btFrameArena*			m_arena;
+	btFrameArena::Marker	m_marker;
+
+	btFrameArenaScope(const btFrameArenaScope&);
+	btFrameArenaScope& operator=(const btFrameArenaScope&);
+
+public:
+
+	explicit btFrameArenaScope(btFrameArena* arena)
+		:m_arena(arena)
+	{
+		if (m_arena)
+		{
+			m_marker = m_arena->getMarker();
+		}
+	}
+
+	~btFrameArenaScope()
+	{
+		if (m_arena)
+		{
+			m_arena->rewind(m_marker);
+		}
+	}
+
+	void*	allocate(size_t size, size_t alignment = 16)
+	{
+		btAssert(m_arena);
+		return m_arena->allocate(size, alignment);
+	}
+
+	///lets an empty array use arena memory for up to capacity elements, beyond that it moves to the heap as usual.
+	///The array must be declared after the scope, so it is gone before the scope rewinds the arena
+	template <typename T>
+	void	initializeArray(btAlignedObjectArray<T>& array, int capacity)
+	{
+		btAssert(array.size() == 0);
+		if (m_arena)
+		{
+			array.initializeFromBuffer(m_arena->allocate(sizeof(T) * size_t(btMax(capacity, 1))), 0, btMax(capacity, 1));
+		}
+	}
+};
+
+#endif //BT_FRAME_ARENA_H
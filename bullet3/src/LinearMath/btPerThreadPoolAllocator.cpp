@@ -0,0 +1,190 @@
+/*
+Copyright (c) 2003-2018 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btPerThreadPoolAllocator.h"
+#include "btMinMax.h"
+#include <string.h>
+
+//every element is preceded by a header, that keeps the element 16 byte aligned.
+//The header holds the allocator for pool elements, and 0 for heap allocations
+static const int BT_POOL_HEADER_SIZE = 16;
+
+//the chunks of a thread stop doubling at this size
+static const int BT_POOL_MAX_CHUNK_SIZE = 4096;
+
+static inline void*& btPoolHeaderOwner(void* ptr)
+{
+	return *(void**)((unsigned char*)ptr - BT_POOL_HEADER_SIZE);
+}
+
+btPerThreadPoolAllocator::btPerThreadPoolAllocator(int elemSize, int initialChunkSize, int batchSize)
+	:m_elemSize(elemSize),
+	m_initialChunkSize(btMax(initialChunkSize, 1)),
+	m_batchSize(btMax(batchSize, 1)),
+	m_capacity(0)
+{
+	btAssert(elemSize >= int(sizeof(void*)));
+	m_elemStride = BT_POOL_HEADER_SIZE + ((btMax(elemSize, int(sizeof(void*))) + 15) & ~15);
+	m_threadFreeLists = (btThreadFreeList*)btAlignedAlloc(sizeof(btThreadFreeList) * BT_MAX_THREAD_COUNT, 128);
+	memset(m_threadFreeLists, 0, sizeof(btThreadFreeList) * BT_MAX_THREAD_COUNT);
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		m_threadFreeLists[i].m_nextChunkSize = m_initialChunkSize;
+	}
+}
+
+btPerThreadPoolAllocator::~btPerThreadPoolAllocator()
+{
+	for (int i = 0; i < m_chunks.size(); i++)
+	{
+		btAlignedFree(m_chunks[i]);
+	}
+	btAlignedFree(m_threadFreeLists);
+}
+
+void btPerThreadPoolAllocator::refill(btThreadFreeList& freeList)
+{
+	void* batch = 0;
+	btMutexLock(&m_mutex);
+	if (m_depotBatches.size())
+	{
+		batch = m_depotBatches[m_depotBatches.size() - 1];
+		m_depotBatches.pop_back();
+	}
+	btMutexUnlock(&m_mutex);
+
+	if (batch)
+	{
+		freeList.m_firstFree = batch;
+		freeList.m_numFree = m_batchSize;
+		freeList.m_numDepotRefills++;
+		return;
+	}
+
+	int chunkSize = freeList.m_nextChunkSize;
+	freeList.m_nextChunkSize = btMin(chunkSize * 2, BT_POOL_MAX_CHUNK_SIZE);
+	unsigned char* chunk = (unsigned char*)btAlignedAlloc(size_t(m_elemStride) * chunkSize, 16);
+	void* firstFree = 0;
+	for (int i = chunkSize - 1; i >= 0; i--)
+	{
+		void* elem = chunk + size_t(m_elemStride) * i + BT_POOL_HEADER_SIZE;
+		btPoolHeaderOwner(elem) = this;
+		*(void**)elem = firstFree;
+		firstFree = elem;
+	}
+	freeList.m_firstFree = firstFree;
+	freeList.m_numFree = chunkSize;
+	freeList.m_numChunkAllocations++;
+
+	btMutexLock(&m_mutex);
+	m_chunks.push_back(chunk);
+	m_capacity += chunkSize;
+	btMutexUnlock(&m_mutex);
+}
+
+void btPerThreadPoolAllocator::returnBatch(btThreadFreeList& freeList)
+{
+	//the first m_batchSize elements of the list become a batch, linked like a free list
+	void* batch = freeList.m_firstFree;
+	void* last = batch;
+	for (int i = 1; i < m_batchSize; i++)
+	{
+		last = *(void**)last;
+	}
+	freeList.m_firstFree = *(void**)last;
+	freeList.m_numFree -= m_batchSize;
+	*(void**)last = 0;
+	freeList.m_numDepotReturns++;
+
+	btMutexLock(&m_mutex);
+	m_depotBatches.push_back(batch);
+	btMutexUnlock(&m_mutex);
+}
+
+void* btPerThreadPoolAllocator::allocate(int size)
+{
+	btThreadFreeList& freeList = m_threadFreeLists[btGetCurrentThreadIndex()];
+	freeList.m_numAllocations++;
+	if (size > m_elemSize)
+	{
+		freeList.m_numHeapAllocations++;
+		unsigned char* mem = (unsigned char*)btAlignedAlloc(size_t(size) + BT_POOL_HEADER_SIZE, 16);
+		void* elem = mem + BT_POOL_HEADER_SIZE;
+		btPoolHeaderOwner(elem) = 0;
+		return elem;
+	}
+	if (!freeList.m_firstFree)
+	{
+		refill(freeList);
+	}
+	void* elem = freeList.m_firstFree;
+	freeList.m_firstFree = *(void**)elem;
+	freeList.m_numFree--;
+	return elem;
+}
+
+void btPerThreadPoolAllocator::freeMemory(void* ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+	btThreadFreeList& freeList = m_threadFreeLists[btGetCurrentThreadIndex()];
+	freeList.m_numFrees++;
+	if (btPoolHeaderOwner(ptr) != this)
+	{
+		btAssert(btPoolHeaderOwner(ptr) == 0);
+		btAlignedFree((unsigned char*)ptr - BT_POOL_HEADER_SIZE);
+		return;
+	}
+	*(void**)ptr = freeList.m_firstFree;
+	freeList.m_firstFree = ptr;
+	freeList.m_numFree++;
+	if (freeList.m_numFree >= 2 * m_batchSize)
+	{
+		returnBatch(freeList);
+	}
+}
+
+void btPerThreadPoolAllocator::getStatistics(btPoolAllocatorStatistics& statistics) const
+{
+	memset(&statistics, 0, sizeof(statistics));
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		const btThreadFreeList& freeList = m_threadFreeLists[i];
+		statistics.m_numAllocations += freeList.m_numAllocations;
+		statistics.m_numFrees += freeList.m_numFrees;
+		statistics.m_numChunkAllocations += freeList.m_numChunkAllocations;
+		statistics.m_numDepotRefills += freeList.m_numDepotRefills;
+		statistics.m_numDepotReturns += freeList.m_numDepotReturns;
+		statistics.m_numHeapAllocations += freeList.m_numHeapAllocations;
+		statistics.m_numInUse -= freeList.m_numFree;
+	}
+	statistics.m_numInUse += m_capacity - m_depotBatches.size() * m_batchSize;
+	statistics.m_capacity = m_capacity;
+}
+
+void btPerThreadPoolAllocator::resetStatistics()
+{
+	for (unsigned int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		btThreadFreeList& freeList = m_threadFreeLists[i];
+		freeList.m_numAllocations = 0;
+		freeList.m_numFrees = 0;
+		freeList.m_numChunkAllocations = 0;
+		freeList.m_numDepotRefills = 0;
+		freeList.m_numDepotReturns = 0;
+		freeList.m_numHeapAllocations = 0;
+	}
+}
@@ -0,0 +1,101 @@
+/*
+Copyright (c) 2003-2018 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_PER_THREAD_POOL_ALLOCATOR_H
+#define BT_PER_THREAD_POOL_ALLOCATOR_H
+
+#include "btScalar.h"
+#include "btAlignedAllocator.h"
+#include "btAlignedObjectArray.h"
+#include "btThreads.h"
+
+///pool use and pressure, summed over the threads
+struct btPoolAllocatorStatistics
+{
+	int	m_numAllocations;
+	int	m_numFrees;
+	int	m_numInUse;				//pool elements, the heap allocations are not counted
+	int	m_capacity;				//elements in all chunks
+	int	m_numChunkAllocations;	//a thread ran out of elements and the depot was empty
+	int	m_numDepotRefills;		//a thread ran out of elements and took a batch from the depot
+	int	m_numDepotReturns;		//a thread had too many free elements and gave a batch to the depot
+	int	m_numHeapAllocations;	//larger than the element size, allocated with btAlignedAlloc
+};
+
+///btPerThreadPoolAllocator is a pool of fixed size elements that grows on demand, with a free list for each thread.
+///Allocating and freeing use the free list of the calling thread without a lock.
+///Elements can be freed by another thread than the one that allocated them: a thread that gathers too many
+///free elements returns a batch of them to a shared depot, and a thread that runs out takes a batch from the
+///depot before it allocates a new chunk. Only these batch moves and new chunks take the mutex.
+///Each element is preceded by a header that tells whether it is from the pool or from the heap, so requests
+///that are larger than the element size can be served, and freed, by the same allocator.
+class btPerThreadPoolAllocator
+{
+	struct btThreadFreeList
+	{
+		void*	m_firstFree;
+		int		m_numFree;
+		int		m_nextChunkSize;
+		int		m_numAllocations;
+		int		m_numFrees;
+		int		m_numChunkAllocations;
+		int		m_numDepotRefills;
+		int		m_numDepotReturns;
+		int		m_numHeapAllocations;
+		//keep the lists of the threads on separate cache lines
+		char	m_padding[128 - sizeof(void*) - 8 * sizeof(int)];
+	};
+
+	int		m_elemSize;
+	int		m_elemStride;
+	int		m_initialChunkSize;
+	int		m_batchSize;
+	btThreadFreeList*	m_threadFreeLists;
+
+	btSpinMutex		m_mutex;
+	btAlignedObjectArray<void*>	m_chunks;
+	btAlignedObjectArray<void*>	m_depotBatches;
+	int		m_capacity;
+
+	btPerThreadPoolAllocator(const btPerThreadPoolAllocator&);
+	btPerThreadPoolAllocator& operator=(const btPerThreadPoolAllocator&);
+
+	void	refill(btThreadFreeList& freeList);
+
+	void	returnBatch(btThreadFreeList& freeList);
+
+public:
+
+	///a thread's first chunk has initialChunkSize elements, each next chunk of that thread twice as many.
+	///batchSize elements move between a thread and the depot at a time
+	btPerThreadPoolAllocator(int elemSize, int initialChunkSize = 64, int batchSize = 32);
+
+	~btPerThreadPoolAllocator();
+
+	void*	allocate(int size);
+
+	void	freeMemory(void* ptr);
+
+	int		getElementSize() const
+	{
+		return m_elemSize;
+	}
+
+	///sums the statistics of the threads, call it when no other thread uses the allocator
+	void	getStatistics(btPoolAllocatorStatistics& statistics) const;
+
+	void	resetStatistics();
+};
+
+#endif //BT_PER_THREAD_POOL_ALLOCATOR_H
@@ -176,5 +176,19 @@ void btParallelFor( int iBegin, int iEnd, int grainSize, const btIParallelForBod
 //                 (iterations may be done out of order, so no dependencies are allowed)
 btScalar btParallelSum( int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body );
 
+// btParallelForOrSerial -- same as btParallelFor when a task scheduler is set, otherwise the body runs
+//                 on the calling thread. For code that must not require a task scheduler, even in threadsafe builds
+inline void btParallelForOrSerial( int iBegin, int iEnd, int grainSize, const btIParallelForBody& body )
+{
+    if ( btGetTaskScheduler() )
+    {
+        btParallelFor( iBegin, iEnd, grainSize, body );
+    }
+    else
+    {
+        body.forLoop( iBegin, iEnd );
+    }
+}
+
 
 #endif
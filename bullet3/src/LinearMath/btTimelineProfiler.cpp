@@ -0,0 +1,735 @@
+/*
+Copyright (c) 2003-2018 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btTimelineProfiler.h"
+#include "btQuickprof.h"
+#include "btThreads.h"
+#include "btAlignedAllocator.h"
+#include "btAlignedObjectArray.h"
+#include "btHashMap.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#include <unistd.h>
+#if BT_THREADSAFE
+#include <pthread.h>
+#endif
+#endif
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+//the time stamp counter is the cheapest clock to read, by far, its rate is measured once against btClock
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define BT_TIMELINE_USE_TSC 1
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <x86intrin.h>
+#define BT_TIMELINE_USE_TSC 1
+#endif
+
+#if BT_THREADSAFE && (__cplusplus >= 201103L)
+#include <atomic>
+#define BT_TIMELINE_CPP11_ATOMICS 1
+#endif
+
+//the binary file starts with btTimelineFileHeader, followed by records that each start with btTimelineRecordHeader:
+//BT_TIMELINE_RECORD_NAME is followed by m_count characters, the name with id m_threadIndex,
+//BT_TIMELINE_RECORD_EVENTS by m_count btTimelineFileEvent of the thread,
+//BT_TIMELINE_RECORD_DROPPED has the number of dropped events of the thread in m_count
+#define BT_TIMELINE_FILE_VERSION 1
+
+enum btTimelineEventType
+{
+	BT_TIMELINE_BEGIN,
+	BT_TIMELINE_END,
+	BT_TIMELINE_INSTANT,
+};
+
+enum btTimelineRecordType
+{
+	BT_TIMELINE_RECORD_NAME = 1,
+	BT_TIMELINE_RECORD_EVENTS,
+	BT_TIMELINE_RECORD_DROPPED,
+};
+
+struct btTimelineFileHeader
+{
+	char				m_magic[8];
+	int					m_version;
+	int					m_padding;
+	double				m_ticksPerSecond;
+	unsigned long long	m_startTicks;
+};
+
+struct btTimelineRecordHeader
+{
+	int	m_type;
+	int	m_threadIndex;
+	int	m_count;
+};
+
+struct btTimelineFileEvent
+{
+	unsigned long long	m_ticks;
+	int					m_typeAndName;	//event type in the lowest 2 bits, name id above
+	int					m_value;
+};
+
+struct btTimelineEvent
+{
+	unsigned long long	m_ticks;
+	const char*			m_name;
+	int					m_type;
+	int					m_value;
+};
+
+//power of two, per thread
+#define BT_TIMELINE_RING_SIZE (1<<15)
+
+///single producer, single consumer ring: the recording thread moves m_head, the streaming thread m_tail
+ATTRIBUTE_ALIGNED64(struct) btTimelineRing
+{
+	unsigned int	m_head;
+	int				m_depth;		//zones begun and not ended yet, the ring always keeps room for their ends
+	int				m_droppedDepth;	//zones dropped and not ended yet, their nested events are dropped too
+	int				m_numDropped;
+	int				m_recording;	//set while the thread records an event, btStopTimelineCapture waits for it
+	char			m_padding0[44];
+
+	unsigned int	m_tail;
+	char			m_padding1[60];
+
+	btTimelineEvent	m_events[BT_TIMELINE_RING_SIZE];
+};
+
+template <typename T>
+static SIMD_FORCE_INLINE T btTimelineLoadAcquire(T* ptr)
+{
+#if BT_TIMELINE_CPP11_ATOMICS
+	return std::atomic_load_explicit(reinterpret_cast<std::atomic<T>*>(ptr),std::memory_order_acquire);
+#elif BT_THREADSAFE && defined(_MSC_VER)
+	T value = *(volatile T*)ptr;
+	_ReadWriteBarrier();
+	return value;
+#elif BT_THREADSAFE && defined(__GNUC__)
+	return __atomic_load_n(ptr,__ATOMIC_ACQUIRE);
+#else
+	return *ptr;
+#endif
+}
+
+template <typename T>
+static SIMD_FORCE_INLINE void btTimelineStoreRelease(T* ptr,T value)
+{
+#if BT_TIMELINE_CPP11_ATOMICS
+	std::atomic_store_explicit(reinterpret_cast<std::atomic<T>*>(ptr),value,std::memory_order_release);
+#elif BT_THREADSAFE && defined(_MSC_VER)
+	_ReadWriteBarrier();
+	*(volatile T*)ptr = value;
+#elif BT_THREADSAFE && defined(__GNUC__)
+	__atomic_store_n(ptr,value,__ATOMIC_RELEASE);
+#else
+	*ptr = value;
+#endif
+}
+
+//sequentially consistent, for the handshake between a recording thread and btStopTimelineCapture
+template <typename T>
+static SIMD_FORCE_INLINE T btTimelineLoadSeqCst(T* ptr)
+{
+#if BT_TIMELINE_CPP11_ATOMICS
+	return std::atomic_load_explicit(reinterpret_cast<std::atomic<T>*>(ptr),std::memory_order_seq_cst);
+#elif BT_THREADSAFE && defined(_MSC_VER)
+	MemoryBarrier();
+	return *(volatile T*)ptr;
+#elif BT_THREADSAFE && defined(__GNUC__)
+	return __atomic_load_n(ptr,__ATOMIC_SEQ_CST);
+#else
+	return *ptr;
+#endif
+}
+
+template <typename T>
+static SIMD_FORCE_INLINE void btTimelineStoreSeqCst(T* ptr,T value)
+{
+#if BT_TIMELINE_CPP11_ATOMICS
+	std::atomic_store_explicit(reinterpret_cast<std::atomic<T>*>(ptr),value,std::memory_order_seq_cst);
+#elif BT_THREADSAFE && defined(_MSC_VER)
+	*(volatile T*)ptr = value;
+	MemoryBarrier();
+#elif BT_THREADSAFE && defined(__GNUC__)
+	__atomic_store_n(ptr,value,__ATOMIC_SEQ_CST);
+#else
+	*ptr = value;
+#endif
+}
+
+static SIMD_FORCE_INLINE unsigned long long btTimelineTicks()
+{
+#if BT_TIMELINE_USE_TSC
+	return __rdtsc();
+#elif defined(_WIN32)
+	LARGE_INTEGER ticks;
+	QueryPerformanceCounter(&ticks);
+	return (unsigned long long)ticks.QuadPart;
+#elif defined(__APPLE__)
+	return mach_absolute_time();
+#elif defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return (unsigned long long)ts.tv_sec*1000000000ULL+(unsigned long long)ts.tv_nsec;
+#else
+	struct timeval tv;
+	gettimeofday(&tv,0);
+	return (unsigned long long)tv.tv_sec*1000000000ULL+(unsigned long long)tv.tv_usec*1000ULL;
+#endif
+}
+
+static double btTimelineTicksPerSecond()
+{
+#if BT_TIMELINE_USE_TSC
+	static double ticksPerSecond = 0;
+	if (ticksPerSecond==0)
+	{
+		btClock clock;
+		unsigned long long startTicks = btTimelineTicks();
+		unsigned long long nanoseconds;
+		do
+		{
+			nanoseconds = clock.getTimeNanoseconds();
+		} while (nanoseconds<10000000);
+		ticksPerSecond = double(btTimelineTicks()-startTicks)*1e9/double(nanoseconds);
+	}
+	return ticksPerSecond;
+#elif defined(_WIN32)
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return double(frequency.QuadPart);
+#elif defined(__APPLE__)
+	mach_timebase_info_data_t timebase;
+	mach_timebase_info(&timebase);
+	return 1e9*double(timebase.denom)/double(timebase.numer);
+#else
+	return 1e9;
+#endif
+}
+
+static SIMD_FORCE_INLINE unsigned int btTimelineThreadIndex()
+{
+#ifndef BT_NO_PROFILE
+	return btQuickprofGetCurrentThreadIndex2();
+#else
+	return btGetCurrentThreadIndex();
+#endif
+}
+
+static btTimelineRing*			gTimelineRings[BT_MAX_THREAD_COUNT];
+static int						gTimelineCapturing = 0;
+static FILE*					gTimelineFile = 0;
+static btEnterProfileZoneFunc*	gTimelinePrevEnterFunc = 0;
+static btLeaveProfileZoneFunc*	gTimelinePrevLeaveFunc = 0;
+
+//only used by the streaming thread
+static btHashMap<btHashPtr,int>					gTimelineNameIds;
+static btAlignedObjectArray<btTimelineFileEvent>	gTimelineChunk;
+
+static void btTimelineWriteRecordHeader(int type,int threadIndex,int count)
+{
+	btTimelineRecordHeader header;
+	header.m_type = type;
+	header.m_threadIndex = threadIndex;
+	header.m_count = count;
+	fwrite(&header,sizeof(header),1,gTimelineFile);
+}
+
+static int btTimelineGetNameId(const char* name)
+{
+	const int* id = gTimelineNameIds.find(name);
+	if (id)
+		return *id;
+	int newId = gTimelineNameIds.size();
+	gTimelineNameIds.insert(name,newId);
+	int length = int(strlen(name));
+	btTimelineWriteRecordHeader(BT_TIMELINE_RECORD_NAME,newId,length);
+	fwrite(name,1,length,gTimelineFile);
+	return newId;
+}
+
+//moves the events of the ring to the file, returns false when there were none
+static bool btTimelineStreamRing(int threadIndex,btTimelineRing* ring)
+{
+	unsigned int head = btTimelineLoadAcquire(&ring->m_head);
+	unsigned int tail = ring->m_tail;
+	if (head==tail)
+		return false;
+
+	gTimelineChunk.resize(0);
+	for (;tail!=head;tail++)
+	{
+		const btTimelineEvent& event = ring->m_events[tail&(BT_TIMELINE_RING_SIZE-1)];
+		int nameId = event.m_name ? btTimelineGetNameId(event.m_name) : 0;
+		btTimelineFileEvent& fileEvent = gTimelineChunk.expandNonInitializing();
+		fileEvent.m_ticks = event.m_ticks;
+		fileEvent.m_typeAndName = (nameId<<2)|event.m_type;
+		fileEvent.m_value = event.m_value;
+	}
+	btTimelineWriteRecordHeader(BT_TIMELINE_RECORD_EVENTS,threadIndex,gTimelineChunk.size());
+	fwrite(&gTimelineChunk[0],sizeof(btTimelineFileEvent),gTimelineChunk.size(),gTimelineFile);
+
+	btTimelineStoreRelease(&ring->m_tail,head);
+	return true;
+}
+
+static bool btTimelineStreamAllRings()
+{
+	bool streamed = false;
+	for (int i=0;i<int(BT_MAX_THREAD_COUNT);i++)
+	{
+		btTimelineRing* ring = btTimelineLoadSeqCst(&gTimelineRings[i]);
+		if (ring && btTimelineStreamRing(i,ring))
+			streamed = true;
+	}
+	return streamed;
+}
+
+static btTimelineRing* btTimelineAllocateRing(unsigned int threadIndex)
+{
+	void* mem = btAlignedAlloc(sizeof(btTimelineRing),64);
+	memset(mem,0,sizeof(btTimelineRing));
+	btTimelineRing* ring = (btTimelineRing*)mem;
+	btTimelineStoreSeqCst(&gTimelineRings[threadIndex],ring);
+	return ring;
+}
+
+static SIMD_FORCE_INLINE void btTimelineRecordInRing(unsigned int threadIndex,btTimelineRing* ring,int type,const char* name,int value)
+{
+	if (ring->m_droppedDepth)
+	{
+		if (type==BT_TIMELINE_BEGIN)
+			ring->m_droppedDepth++;
+		else if (type==BT_TIMELINE_END)
+			ring->m_droppedDepth--;
+		ring->m_numDropped++;
+		return;
+	}
+	if (type==BT_TIMELINE_END)
+	{
+		//the end of a zone that began before the capture started
+		if (ring->m_depth==0)
+			return;
+		ring->m_depth--;
+	}
+
+	unsigned int head = ring->m_head;
+	//keep room for the ends of the open zones, so that a full ring never leaves a zone without its end
+	int required = (type==BT_TIMELINE_END) ? 1 : ((type==BT_TIMELINE_BEGIN) ? ring->m_depth+2 : ring->m_depth+1);
+	if (int(BT_TIMELINE_RING_SIZE-(head-btTimelineLoadAcquire(&ring->m_tail)))<required)
+	{
+#if BT_THREADSAFE
+		if (type==BT_TIMELINE_BEGIN)
+			ring->m_droppedDepth = 1;
+		ring->m_numDropped++;
+		return;
+#else
+		//no streaming thread, stream the ring now
+		btTimelineStreamRing(threadIndex,ring);
+#endif
+	}
+	if (type==BT_TIMELINE_BEGIN)
+		ring->m_depth++;
+
+	btTimelineEvent& event = ring->m_events[head&(BT_TIMELINE_RING_SIZE-1)];
+	event.m_ticks = btTimelineTicks();
+	event.m_name = name;
+	event.m_type = type;
+	event.m_value = value;
+	btTimelineStoreRelease(&ring->m_head,head+1);
+}
+
+static SIMD_FORCE_INLINE void btTimelineRecord(int type,const char* name,int value)
+{
+	if (!btTimelineLoadAcquire(&gTimelineCapturing))
+		return;
+	unsigned int threadIndex = btTimelineThreadIndex();
+	if (threadIndex>=BT_MAX_THREAD_COUNT)
+		return;
+	//only this thread writes its ring pointer, head, depths and drop count
+	btTimelineRing* ring = gTimelineRings[threadIndex];
+	if (!ring)
+		ring = btTimelineAllocateRing(threadIndex);
+
+	//the capture may have stopped since the check above. Either btStopTimelineCapture sees m_recording and waits,
+	//or this thread sees that the capture stopped, the stores and loads of both sides are sequentially consistent
+	btTimelineStoreSeqCst(&ring->m_recording,1);
+	if (btTimelineLoadSeqCst(&gTimelineCapturing))
+		btTimelineRecordInRing(threadIndex,ring,type,name,value);
+	btTimelineStoreRelease(&ring->m_recording,0);
+}
+
+void	btTimelineBeginZone(const char* name)
+{
+	btTimelineRecord(BT_TIMELINE_BEGIN,name,0);
+}
+
+void	btTimelineEndZone()
+{
+	btTimelineRecord(BT_TIMELINE_END,0,0);
+}
+
+void	btTimelineInstantEvent(const char* name,int value)
+{
+	btTimelineRecord(BT_TIMELINE_INSTANT,name,value);
+}
+
+#if BT_THREADSAFE
+
+static int gTimelineStopStreaming = 0;
+
+static void btTimelineStreamUntilStopped()
+{
+	while (!btTimelineLoadAcquire(&gTimelineStopStreaming))
+	{
+		if (!btTimelineStreamAllRings())
+		{
+#if defined(_WIN32)
+			Sleep(1);
+#else
+			usleep(1000);
+#endif
+		}
+	}
+}
+
+#if defined(_WIN32)
+static HANDLE gTimelineThread = 0;
+
+static DWORD WINAPI btTimelineThreadFunc(LPVOID)
+{
+	btTimelineStreamUntilStopped();
+	return 0;
+}
+
+static bool btTimelineStartStreamingThread()
+{
+	gTimelineThread = CreateThread(0,0,btTimelineThreadFunc,0,0,0);
+	return gTimelineThread!=0;
+}
+
+static void btTimelineJoinStreamingThread()
+{
+	WaitForSingleObject(gTimelineThread,INFINITE);
+	CloseHandle(gTimelineThread);
+	gTimelineThread = 0;
+}
+#else
+static pthread_t gTimelineThread;
+
+static void* btTimelineThreadFunc(void*)
+{
+	btTimelineStreamUntilStopped();
+	return 0;
+}
+
+static bool btTimelineStartStreamingThread()
+{
+	return pthread_create(&gTimelineThread,0,btTimelineThreadFunc,0)==0;
+}
+
+static void btTimelineJoinStreamingThread()
+{
+	pthread_join(gTimelineThread,0);
+}
+#endif //_WIN32
+
+#endif //BT_THREADSAFE
+
+bool	btStartTimelineCapture(const char* fileName)
+{
+	if (gTimelineFile)
+		return false;
+	gTimelineFile = fopen(fileName,"wb");
+	if (!gTimelineFile)
+		return false;
+
+	btTimelineFileHeader header;
+	memset(&header,0,sizeof(header));
+	memcpy(header.m_magic,"BTTMLINE",8);
+	header.m_version = BT_TIMELINE_FILE_VERSION;
+	header.m_ticksPerSecond = btTimelineTicksPerSecond();
+	header.m_startTicks = btTimelineTicks();
+	fwrite(&header,sizeof(header),1,gTimelineFile);
+
+	//rings are kept from earlier captures, drop what was recorded after those stopped
+	for (int i=0;i<int(BT_MAX_THREAD_COUNT);i++)
+	{
+		btTimelineRing* ring = btTimelineLoadAcquire(&gTimelineRings[i]);
+		if (ring)
+		{
+			ring->m_tail = ring->m_head;
+			ring->m_depth = 0;
+			ring->m_droppedDepth = 0;
+			ring->m_numDropped = 0;
+		}
+	}
+	gTimelineNameIds.clear();
+	//name id 0 is used for events without a name
+	btTimelineGetNameId("");
+
+#if BT_THREADSAFE
+	gTimelineStopStreaming = 0;
+	if (!btTimelineStartStreamingThread())
+	{
+		fclose(gTimelineFile);
+		gTimelineFile = 0;
+		return false;
+	}
+#endif
+
+	gTimelinePrevEnterFunc = btGetCurrentEnterProfileZoneFunc();
+	gTimelinePrevLeaveFunc = btGetCurrentLeaveProfileZoneFunc();
+	btSetCustomEnterProfileZoneFunc(btTimelineBeginZone);
+	btSetCustomLeaveProfileZoneFunc(btTimelineEndZone);
+	btTimelineStoreRelease(&gTimelineCapturing,1);
+	return true;
+}
+
+void	btStopTimelineCapture()
+{
+	if (!gTimelineFile)
+		return;
+	btTimelineStoreSeqCst(&gTimelineCapturing,0);
+	btSetCustomEnterProfileZoneFunc(gTimelinePrevEnterFunc);
+	btSetCustomLeaveProfileZoneFunc(gTimelinePrevLeaveFunc);
+
+	//threads that saw the capture running may still write an event into their ring
+	for (int i=0;i<int(BT_MAX_THREAD_COUNT);i++)
+	{
+		btTimelineRing* ring = btTimelineLoadSeqCst(&gTimelineRings[i]);
+		while (ring && btTimelineLoadSeqCst(&ring->m_recording))
+		{
+#if defined(_WIN32)
+			Sleep(0);
+#else
+			usleep(0);
+#endif
+		}
+	}
+
+#if BT_THREADSAFE
+	btTimelineStoreRelease(&gTimelineStopStreaming,1);
+	btTimelineJoinStreamingThread();
+#endif
+	btTimelineStreamAllRings();
+
+	for (int i=0;i<int(BT_MAX_THREAD_COUNT);i++)
+	{
+		btTimelineRing* ring = btTimelineLoadAcquire(&gTimelineRings[i]);
+		if (ring && ring->m_numDropped)
+		{
+			btTimelineWriteRecordHeader(BT_TIMELINE_RECORD_DROPPED,i,ring->m_numDropped);
+		}
+	}
+	fclose(gTimelineFile);
+	gTimelineFile = 0;
+}
+
+void	btFreeTimelineMemory()
+{
+	if (gTimelineFile)
+		return;
+	for (int i=0;i<int(BT_MAX_THREAD_COUNT);i++)
+	{
+		btTimelineRing* ring = btTimelineLoadAcquire(&gTimelineRings[i]);
+		if (ring)
+		{
+			btTimelineStoreRelease(&gTimelineRings[i],(btTimelineRing*)0);
+			btAlignedFree(ring);
+		}
+	}
+	gTimelineNameIds.clear();
+	gTimelineChunk.clear();
+}
+
+bool	btIsTimelineCapturing()
+{
+	return gTimelineCapturing!=0;
+}
+
+int		btGetTimelineNumDroppedEvents()
+{
+	int numDropped = 0;
+	for (int i=0;i<int(BT_MAX_THREAD_COUNT);i++)
+	{
+		btTimelineRing* ring = btTimelineLoadAcquire(&gTimelineRings[i]);
+		if (ring)
+			numDropped += ring->m_numDropped;
+	}
+	return numDropped;
+}
+
+static void btTimelineWriteJsonString(FILE* file,const char* str,int length)
+{
+	fputc('"',file);
+	for (int i=0;i<length;i++)
+	{
+		unsigned char c = (unsigned char)str[i];
+		if (c=='"' || c=='\\')
+		{
+			fputc('\\',file);
+			fputc(c,file);
+		} else if (c<0x20)
+		{
+			fprintf(file,"\\u%04x",c);
+		} else
+		{
+			fputc(c,file);
+		}
+	}
+	fputc('"',file);
+}
+
+bool	btConvertTimelineToChromeTrace(const char* timelineFileName,const char* jsonFileName)
+{
+	FILE* in = fopen(timelineFileName,"rb");
+	if (!in)
+		return false;
+	btTimelineFileHeader header;
+	if (fread(&header,sizeof(header),1,in)!=1 || memcmp(header.m_magic,"BTTMLINE",8)!=0 || header.m_version!=BT_TIMELINE_FILE_VERSION || header.m_ticksPerSecond<=0)
+	{
+		fclose(in);
+		return false;
+	}
+	FILE* out = fopen(jsonFileName,"w");
+	if (!out)
+	{
+		fclose(in);
+		return false;
+	}
+
+	btAlignedObjectArray<char> nameChars;
+	btAlignedObjectArray<int> nameStarts;
+	btAlignedObjectArray<int> nameLengths;
+	int depths[BT_MAX_THREAD_COUNT];
+	double lastTimes[BT_MAX_THREAD_COUNT];
+	bool threadSeen[BT_MAX_THREAD_COUNT];
+	for (int i=0;i<int(BT_MAX_THREAD_COUNT);i++)
+	{
+		depths[i] = 0;
+		lastTimes[i] = 0;
+		threadSeen[i] = false;
+	}
+	const double microsecondsPerTick = 1e6/header.m_ticksPerSecond;
+
+	fprintf(out,"{\"traceEvents\":[\n");
+	bool first = true;
+	bool valid = true;
+	btTimelineRecordHeader record;
+	btAlignedObjectArray<btTimelineFileEvent> events;
+	while (valid && fread(&record,sizeof(record),1,in)==1)
+	{
+		if (record.m_type==BT_TIMELINE_RECORD_NAME)
+		{
+			if (record.m_threadIndex!=nameStarts.size() || record.m_count<0)
+			{
+				valid = false;
+				break;
+			}
+			nameStarts.push_back(nameChars.size());
+			nameLengths.push_back(record.m_count);
+			nameChars.resize(nameChars.size()+record.m_count+1);
+			if (record.m_count && fread(&nameChars[nameStarts[record.m_threadIndex]],1,record.m_count,in)!=size_t(record.m_count))
+				valid = false;
+			continue;
+		}
+		int tid = record.m_threadIndex;
+		if (tid<0 || tid>=int(BT_MAX_THREAD_COUNT) || record.m_count<0)
+		{
+			valid = false;
+			break;
+		}
+		if (!threadSeen[tid])
+		{
+			threadSeen[tid] = true;
+			fprintf(out,"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",first ? "" : ",\n",tid,tid ? "worker" : "main",tid);
+			first = false;
+		}
+		if (record.m_type==BT_TIMELINE_RECORD_DROPPED)
+		{
+			fprintf(out,",\n{\"name\":\"droppedEvents\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"value\":%d}}",tid,lastTimes[tid],record.m_count);
+			continue;
+		}
+		if (record.m_type!=BT_TIMELINE_RECORD_EVENTS)
+		{
+			valid = false;
+			break;
+		}
+		events.resize(record.m_count);
+		if (record.m_count && fread(&events[0],sizeof(btTimelineFileEvent),record.m_count,in)!=size_t(record.m_count))
+		{
+			valid = false;
+			break;
+		}
+		for (int i=0;i<events.size();i++)
+		{
+			const btTimelineFileEvent& event = events[i];
+			int type = event.m_typeAndName&3;
+			int nameId = event.m_typeAndName>>2;
+			if (nameId<0 || nameId>=nameStarts.size())
+			{
+				valid = false;
+				break;
+			}
+			double ts = double((long long)(event.m_ticks-header.m_startTicks))*microsecondsPerTick;
+			lastTimes[tid] = ts;
+			if (type==BT_TIMELINE_END)
+			{
+				if (depths[tid]==0)
+					continue;
+				depths[tid]--;
+				fprintf(out,",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",tid,ts);
+				continue;
+			}
+			fprintf(out,",\n{\"name\":");
+			btTimelineWriteJsonString(out,&nameChars[nameStarts[nameId]],nameLengths[nameId]);
+			if (type==BT_TIMELINE_BEGIN)
+			{
+				depths[tid]++;
+				fprintf(out,",\"ph\":\"B\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",tid,ts);
+			} else
+			{
+				fprintf(out,",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"args\":{\"value\":%d}}",tid,ts,event.m_value);
+			}
+		}
+	}
+	//zones still open when the capture stopped
+	for (int tid=0;tid<int(BT_MAX_THREAD_COUNT);tid++)
+	{
+		for (;depths[tid]>0;depths[tid]--)
+		{
+			fprintf(out,",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",tid,lastTimes[tid]);
+		}
+	}
+	fprintf(out,"\n],\n\"displayTimeUnit\": \"ns\"}\n");
+	fclose(out);
+	fclose(in);
+	return valid;
+}
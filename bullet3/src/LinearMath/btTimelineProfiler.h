@@ -0,0 +1,53 @@
+/*
+Copyright (c) 2003-2018 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_TIMELINE_PROFILER_H
+#define BT_TIMELINE_PROFILER_H
+
+///The timeline profiler captures the BT_PROFILE zones of all threads, and the job dispatch and wait events of the
+///default task scheduler, with a timestamp for every begin and end.
+///While capturing, each thread records into its own lock-free ring buffer, and a background thread streams the
+///rings into a compact binary file, so a capture can run for as long as there is disk space.
+///When a ring is full (the disk can't keep up), the zones that don't fit are dropped as a whole, never the thread.
+///Without BT_THREADSAFE there is no background thread, and a ring is streamed by its own thread when it fills up.
+///btConvertTimelineToChromeTrace turns the binary file into JSON for chrome://tracing, offline.
+///Names are stored by pointer and written to the file the first time the background thread sees them:
+///like for BT_PROFILE, they must be static strings.
+
+///starts capturing into the file, and installs the timeline as the btQuickprof enter/leave profile zone functions.
+///Returns false when the file can't be created or a capture is running already
+bool	btStartTimelineCapture(const char* fileName);
+
+///restores the previous profile zone functions, writes the remaining events and closes the file.
+///Threads that are recording an event are waited for, events recorded after the stop are ignored
+void	btStopTimelineCapture();
+
+///frees the ring buffers of the threads, which are kept from one capture to the next otherwise.
+///Does nothing while capturing. No other thread may record events meanwhile, so call it when the threads are done
+void	btFreeTimelineMemory();
+
+bool	btIsTimelineCapturing();
+
+///the number of events dropped because a ring buffer was full, since the start of the capture
+int		btGetTimelineNumDroppedEvents();
+
+///record events on the timeline of the calling thread, these do nothing when not capturing
+void	btTimelineBeginZone(const char* name);
+void	btTimelineEndZone();
+void	btTimelineInstantEvent(const char* name,int value);
+
+///writes a file captured by btStartTimelineCapture as Chrome trace JSON, with one row per thread
+bool	btConvertTimelineToChromeTrace(const char* timelineFileName,const char* jsonFileName);
+
+#endif //BT_TIMELINE_PROFILER_H
@@ -0,0 +1,249 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
+#include <BulletCollision/CollisionShapes/btOptimizedBvh.h>
+#include <btBakedCollisionLoader.h>
+#include <btBakedCollisionWriter.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+
+// A level of static collision shapes: a wavy grid mesh, a heightfield, and a compound of a box, a sphere and a convex hull
+struct BakedLevel
+{
+    btAlignedObjectArray<btScalar> vertices;
+    btAlignedObjectArray<int> indices;
+    btAlignedObjectArray<btScalar> heights;
+    btTriangleIndexVertexArray* meshInterface;
+    btAlignedObjectArray<btCollisionShape*> shapes;
+    btAlignedObjectArray<btCollisionObject*> objects;
+
+    BakedLevel(int gridSize)
+    {
+        for (int z = 0; z <= gridSize; z++)
+        {
+            for (int x = 0; x <= gridSize; x++)
+            {
+                vertices.push_back(btScalar(x));
+                vertices.push_back(btSin(btScalar(x) * btScalar(0.3)) + btCos(btScalar(z) * btScalar(0.2)));
+                vertices.push_back(btScalar(z));
+            }
+        }
+        for (int z = 0; z < gridSize; z++)
+        {
+            for (int x = 0; x < gridSize; x++)
+            {
+                int v = z * (gridSize + 1) + x;
+                indices.push_back(v);
+                indices.push_back(v + gridSize + 1);
+                indices.push_back(v + 1);
+                indices.push_back(v + 1);
+                indices.push_back(v + gridSize + 1);
+                indices.push_back(v + gridSize + 2);
+            }
+        }
+        meshInterface = new btTriangleIndexVertexArray(indices.size() / 3, &indices[0], 3 * sizeof(int), vertices.size() / 3, &vertices[0], 3 * sizeof(btScalar));
+        // scaled, so that the writer has to bake the scaling into the vertices
+        meshInterface->setScaling(btVector3(2, 1, 2));
+        btBvhTriangleMeshShape* mesh = new btBvhTriangleMeshShape(meshInterface, true);
+        addObject(mesh, btVector3(-gridSize, 0, -gridSize));
+
+        const int heightfieldSize = 65;
+        for (int i = 0; i < heightfieldSize * heightfieldSize; i++)
+        {
+            heights.push_back(btScalar(i % 7) * btScalar(0.25));
+        }
+        btHeightfieldTerrainShape* heightfield = new btHeightfieldTerrainShape(heightfieldSize, heightfieldSize, &heights[0], 1, 0, btScalar(1.5), 1, PHY_FLOAT, false);
+        heightfield->setUseDiamondSubdivision(true);
+        addObject(heightfield, btVector3(0, -20, 0));
+
+        btCompoundShape* compound = new btCompoundShape();
+        btConvexHullShape* hull = new btConvexHullShape();
+        hull->addPoint(btVector3(0, 2, 0));
+        hull->addPoint(btVector3(-1, 0, -1));
+        hull->addPoint(btVector3(1, 0, -1));
+        hull->addPoint(btVector3(0, 0, 1));
+        btBoxShape* box = new btBoxShape(btVector3(1, btScalar(0.5), 2));
+        btSphereShape* sphere = new btSphereShape(btScalar(0.75));
+        shapes.push_back(hull);
+        shapes.push_back(box);
+        shapes.push_back(sphere);
+        compound->addChildShape(btTransform(btQuaternion(btVector3(0, 1, 0), btScalar(0.5)), btVector3(3, 0, 0)), hull);
+        compound->addChildShape(btTransform(btQuaternion::getIdentity(), btVector3(-3, 0, 0)), box);
+        compound->addChildShape(btTransform(btQuaternion::getIdentity(), btVector3(0, 0, 4)), sphere);
+        addObject(compound, btVector3(5, 8, 5));
+    }
+
+    ~BakedLevel()
+    {
+        for (int i = 0; i < objects.size(); i++)
+            delete objects[i];
+        for (int i = shapes.size() - 1; i >= 0; i--)
+            delete shapes[i];
+        delete meshInterface;
+    }
+
+    void addObject(btCollisionShape* shape, const btVector3& origin)
+    {
+        shapes.push_back(shape);
+        btCollisionObject* colObj = new btCollisionObject();
+        colObj->setCollisionShape(shape);
+        colObj->setWorldTransform(btTransform(btQuaternion(btVector3(0, 1, 0), btScalar(0.1) * objects.size()), origin));
+        colObj->setFriction(btScalar(0.25) * (objects.size() + 1));
+        colObj->setUserIndex(100 + objects.size());
+        objects.push_back(colObj);
+    }
+
+    void bake(btAlignedObjectArray<char>& buffer)
+    {
+        btBakedCollisionWriter writer;
+        for (int i = 0; i < objects.size(); i++)
+        {
+            EXPECT_TRUE(writer.addCollisionObject(objects[i]));
+        }
+        EXPECT_TRUE(writer.bake(buffer));
+    }
+};
+
+static bool isInside(const void* ptr, const void* data, int dataSize)
+{
+    return (const char*)ptr >= (const char*)data && (const char*)ptr < (const char*)data + dataSize;
+}
+
+// The loaded shapes refer to the baked data instead of copies
+static void expectInPlace(const btBakedCollisionLoader& loader)
+{
+    for (int i = 0; i < loader.getNumCollisionShapes(); i++)
+    {
+        btCollisionShape* shape = loader.getCollisionShape(i);
+        if (shape->getShapeType() == TRIANGLE_MESH_SHAPE_PROXYTYPE)
+        {
+            btBvhTriangleMeshShape* mesh = (btBvhTriangleMeshShape*)shape;
+            btTriangleIndexVertexArray* meshInterface = (btTriangleIndexVertexArray*)mesh->getMeshInterface();
+            EXPECT_TRUE(isInside(meshInterface->getIndexedMeshArray()[0].m_vertexBase, loader.getData(), loader.getDataSize()));
+            EXPECT_TRUE(isInside(meshInterface->getIndexedMeshArray()[0].m_triangleIndexBase, loader.getData(), loader.getDataSize()));
+            EXPECT_TRUE(isInside(&mesh->getOptimizedBvh()->getQuantizedNodeArray()[0], loader.getData(), loader.getDataSize()));
+        }
+        if (shape->getShapeType() == TERRAIN_SHAPE_PROXYTYPE)
+        {
+            btHeightfieldTerrainShape* heightfield = (btHeightfieldTerrainShape*)shape;
+            EXPECT_TRUE(isInside(heightfield->getHeightfieldRawData(), loader.getData(), loader.getDataSize()));
+        }
+    }
+}
+
+struct CollisionWorldSetup
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher;
+    btDbvtBroadphase broadphase;
+    btCollisionWorld world;
+
+    CollisionWorldSetup()
+        : dispatcher(&collisionConfiguration),
+          world(&dispatcher, &broadphase, &collisionConfiguration)
+    {
+    }
+};
+
+// Rays and sphere casts against the original and the loaded level hit the same objects at the same places
+static void expectSameQueries(btAlignedObjectArray<btCollisionObject*>& original, const btBakedCollisionLoader& loader)
+{
+    ASSERT_EQ(original.size(), loader.getNumCollisionObjects());
+    CollisionWorldSetup a, b;
+    for (int i = 0; i < original.size(); i++)
+    {
+        a.world.addCollisionObject(original[i]);
+        b.world.addCollisionObject(loader.getCollisionObject(i));
+        EXPECT_EQ(original[i]->getFriction(), loader.getCollisionObject(i)->getFriction());
+        EXPECT_EQ(original[i]->getUserIndex(), loader.getCollisionObject(i)->getUserIndex());
+    }
+    a.world.updateAabbs();
+    b.world.updateAabbs();
+    btSphereShape sphere(btScalar(0.3));
+    int numHits = 0;
+    for (int i = 0; i < 200; i++)
+    {
+        btVector3 from(btScalar((i * 37) % 80) - 40, 30, btScalar((i * 53) % 80) - 40);
+        btVector3 to = from + btVector3(btScalar(i % 9) - 4, -60, btScalar(i % 5) - 2);
+        btCollisionWorld::ClosestRayResultCallback rayA(from, to), rayB(from, to);
+        a.world.rayTest(from, to, rayA);
+        b.world.rayTest(from, to, rayB);
+        ASSERT_EQ(rayA.hasHit(), rayB.hasHit());
+        if (rayA.hasHit())
+        {
+            numHits++;
+            EXPECT_EQ(rayA.m_collisionObject->getUserIndex(), rayB.m_collisionObject->getUserIndex());
+            EXPECT_NEAR(rayA.m_closestHitFraction, rayB.m_closestHitFraction, 1e-4);
+            EXPECT_NEAR(rayA.m_hitNormalWorld.dot(rayB.m_hitNormalWorld), 1, 1e-3);
+        }
+        btTransform sphereFrom(btQuaternion::getIdentity(), from), sphereTo(btQuaternion::getIdentity(), to);
+        btCollisionWorld::ClosestConvexResultCallback castA(from, to), castB(from, to);
+        a.world.convexSweepTest(&sphere, sphereFrom, sphereTo, castA);
+        b.world.convexSweepTest(&sphere, sphereFrom, sphereTo, castB);
+        ASSERT_EQ(castA.hasHit(), castB.hasHit());
+        if (castA.hasHit())
+        {
+            EXPECT_NEAR(castA.m_closestHitFraction, castB.m_closestHitFraction, 1e-3);
+        }
+    }
+    EXPECT_GT(numHits, 100);
+    for (int i = 0; i < original.size(); i++)
+    {
+        a.world.removeCollisionObject(original[i]);
+        b.world.removeCollisionObject(loader.getCollisionObject(i));
+    }
+}
+
+GTEST_TEST(BulletCollision, BakedCollisionFromMemory)
+{
+    BakedLevel level(40);
+    btAlignedObjectArray<char> buffer;
+    level.bake(buffer);
+
+    btBakedCollisionLoader loader;
+    ASSERT_TRUE(loader.loadFromMemory(&buffer[0], buffer.size()));
+    // mesh, heightfield, hull, box, sphere and compound
+    EXPECT_EQ(6, loader.getNumCollisionShapes());
+    EXPECT_EQ(3, loader.getNumCollisionObjects());
+    expectInPlace(loader);
+    expectSameQueries(level.objects, loader);
+}
+
+GTEST_TEST(BulletCollision, BakedCollisionRejectsBadData)
+{
+    BakedLevel level(4);
+    btAlignedObjectArray<char> buffer;
+    level.bake(buffer);
+
+    btBakedCollisionLoader loader;
+    EXPECT_FALSE(loader.loadFromMemory(&buffer[0], buffer.size() / 2));
+    EXPECT_EQ(0, loader.getNumCollisionShapes());
+    buffer[0] = 'X';
+    EXPECT_FALSE(loader.loadFromMemory(&buffer[0], buffer.size()));
+    EXPECT_FALSE(loader.loadFile("test_btBakedCollision_missing.baked"));
+}
+
+// The load time doesn't depend on the mesh size: even the mesh of a large level is used where it was loaded, not copied
+GTEST_TEST(BulletCollision, BakedCollisionLargeMeshIsLoadedInPlace)
+{
+    const char* largeFileName = "test_btBakedCollision_large.baked";
+    {
+        // half a million triangles
+        BakedLevel large(512);
+        btBakedCollisionWriter writer;
+        for (int i = 0; i < large.objects.size(); i++)
+            writer.addCollisionObject(large.objects[i]);
+        ASSERT_TRUE(writer.writeFile(largeFileName));
+
+        btBakedCollisionLoader loader;
+        ASSERT_TRUE(loader.loadFile(largeFileName));
+        expectInPlace(loader);
+        expectSameQueries(large.objects, loader);
+    }
+    remove(largeFileName);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
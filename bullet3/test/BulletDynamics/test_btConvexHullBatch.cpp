@@ -0,0 +1,199 @@
+
+#include <LinearMath/btConvexHullBatch.h>
+#include <LinearMath/btConvexHullComputer.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+#include <stdlib.h>
+
+static btScalar randomScalar()
+{
+    return btScalar(rand()) / btScalar(RAND_MAX) * 2 - 1;
+}
+
+static void randomPoints(btAlignedObjectArray<btVector3>& points, int num, bool onSphere)
+{
+    points.resize(num);
+    for (int i = 0; i < num; i++)
+    {
+        points[i].setValue(randomScalar(), randomScalar(), randomScalar());
+        if (onSphere)
+            points[i].normalize();
+    }
+}
+
+// the volume of the hull, and whether its edges and faces are consistent
+static btScalar hullVolume(const btConvexHullComputer& hull, bool& valid)
+{
+    valid = hull.vertices.size() >= 4 && hull.vertices.size() - hull.edges.size() / 2 + hull.faces.size() == 2;
+    btScalar volume = 0;
+    for (int i = 0; i < hull.faces.size(); i++)
+    {
+        const btConvexHullComputer::Edge* first = &hull.edges[hull.faces[i]];
+        const btConvexHullComputer::Edge* edge = first->getNextEdgeOfFace();
+        int n = 0;
+        while (edge->getNextEdgeOfFace() != first && n++ < hull.edges.size())
+        {
+            volume += hull.vertices[first->getSourceVertex()].triple(hull.vertices[edge->getSourceVertex()], hull.vertices[edge->getTargetVertex()]);
+            edge = edge->getNextEdgeOfFace();
+        }
+        valid = valid && n < hull.edges.size();
+    }
+    for (int i = 0; i < hull.edges.size(); i++)
+    {
+        const btConvexHullComputer::Edge& edge = hull.edges[i];
+        valid = valid && edge.getReverseEdge()->getReverseEdge() == &edge && edge.getReverseEdge()->getTargetVertex() == edge.getSourceVertex();
+    }
+    return volume / 6;
+}
+
+GTEST_TEST(btConvexHullComputer, QuickHullMatchesExactHull)
+{
+    srand(1);
+    for (int trial = 0; trial < 100; trial++)
+    {
+        btAlignedObjectArray<btVector3> points;
+        randomPoints(points, 10 + trial * 10, (trial & 1) != 0);
+        btConvexHullComputer exact, quick;
+        exact.compute(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0);
+        bool usedExact = true;
+        quick.computeQuick(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0, 0, 0, &usedExact);
+        bool valid;
+        btScalar exactVolume = hullVolume(exact, valid);
+        btScalar quickVolume = hullVolume(quick, valid);
+        ASSERT_TRUE(valid);
+        // the exact hull snaps its vertices to a grid of 1/10216 of the extent, the quick hull uses the points as they are
+        EXPECT_NEAR(quickVolume, exactVolume, exactVolume * btScalar(1e-3));
+        EXPECT_LE(quick.vertices.size(), points.size());
+    }
+}
+
+GTEST_TEST(btConvexHullComputer, QuickHullMergesCoplanarFaces)
+{
+    // a box with points on its faces and inside
+    srand(2);
+    btAlignedObjectArray<btVector3> points;
+    for (int i = 0; i < 8; i++)
+        points.push_back(btVector3((i & 1) ? 1 : -1, (i & 2) ? 2 : -2, (i & 4) ? 3 : -3));
+    for (int i = 0; i < 300; i++)
+    {
+        btVector3 p(randomScalar(), randomScalar() * 2, randomScalar() * 3);
+        if (i % 3 == 0)
+            p[i % 9 / 3] = (i & 1) ? points[7][i % 9 / 3] : points[0][i % 9 / 3];
+        points.push_back(p);
+    }
+    btConvexHullComputer quick;
+    bool usedExact = true;
+    quick.computeQuick(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0, 0, 0, &usedExact);
+    EXPECT_FALSE(usedExact);
+    EXPECT_EQ(quick.vertices.size(), 8);
+    EXPECT_EQ(quick.faces.size(), 6);
+    bool valid;
+    EXPECT_NEAR(hullVolume(quick, valid), btScalar(48), btScalar(1e-3));
+    EXPECT_TRUE(valid);
+}
+
+GTEST_TEST(btConvexHullComputer, QuickHullFallsBackOnDegenerateInput)
+{
+    btAlignedObjectArray<btVector3> points;
+    for (int i = 0; i < 20; i++)
+        points.push_back(btVector3(btScalar(i % 5), btScalar(i / 5), 1));
+    btConvexHullComputer exact, quick;
+    exact.compute(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0);
+    bool usedExact = false;
+    quick.computeQuick(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0, 0, 0, &usedExact);
+    EXPECT_TRUE(usedExact);
+    EXPECT_EQ(quick.vertices.size(), exact.vertices.size());
+    EXPECT_EQ(quick.faces.size(), exact.faces.size());
+}
+
+GTEST_TEST(btConvexHullComputer, QuickHullSimplifies)
+{
+    srand(3);
+    btAlignedObjectArray<btVector3> points;
+    randomPoints(points, 1000, true);
+    btConvexHullComputer full, limited, coarse;
+    full.computeQuick(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0);
+    bool usedExact = true;
+    limited.computeQuick(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0, 32, 0, &usedExact);
+    EXPECT_FALSE(usedExact);
+    EXPECT_LE(limited.vertices.size(), 32);
+    coarse.computeQuick(&points[0].getX(), sizeof(btVector3), points.size(), 0, 0, 0, btScalar(0.05), &usedExact);
+    EXPECT_FALSE(usedExact);
+    EXPECT_LT(coarse.vertices.size(), full.vertices.size());
+
+    // the simplified hulls are inside the full hull, and not much smaller
+    bool valid;
+    btScalar fullVolume = hullVolume(full, valid);
+    btScalar limitedVolume = hullVolume(limited, valid);
+    EXPECT_TRUE(valid);
+    btScalar coarseVolume = hullVolume(coarse, valid);
+    EXPECT_TRUE(valid);
+    EXPECT_LE(limitedVolume, fullVolume);
+    EXPECT_GT(limitedVolume, fullVolume * btScalar(0.8));
+    EXPECT_LE(coarseVolume, fullVolume);
+    EXPECT_GT(coarseVolume, fullVolume * btScalar(0.9));
+}
+
+GTEST_TEST(btConvexHullComputer, QuickHullShrinksLikeExactHull)
+{
+    srand(4);
+    btAlignedObjectArray<btVector3> points;
+    randomPoints(points, 500, false);
+    btConvexHullComputer exact, quick;
+    btScalar exactShift = exact.compute(&points[0].getX(), sizeof(btVector3), points.size(), btScalar(0.1), btScalar(0.2));
+    btScalar quickShift = quick.computeQuick(&points[0].getX(), sizeof(btVector3), points.size(), btScalar(0.1), btScalar(0.2));
+    EXPECT_NEAR(quickShift, exactShift, btScalar(1e-5));
+    bool valid;
+    EXPECT_NEAR(hullVolume(quick, valid), hullVolume(exact, valid), btScalar(1e-4));
+    EXPECT_EQ(quick.vertices.size(), exact.vertices.size());
+}
+
+GTEST_TEST(btConvexHullBatch, MatchesIndividualHulls)
+{
+    srand(5);
+    btConvexHullBatch batch;
+    for (int round = 0; round < 2; round++)
+    {
+        btAlignedObjectArray<btAlignedObjectArray<btVector3> > pointSets;
+        pointSets.resize(64);
+        batch.clear();
+        for (int i = 0; i < pointSets.size(); i++)
+        {
+            randomPoints(pointSets[i], 20 + (i * 37) % 300, (i % 3) == 0);
+            btScalar shrink = (i % 4 == 1) ? btScalar(0.05) : btScalar(0);
+            EXPECT_EQ(batch.addHull(&pointSets[i][0], pointSets[i].size(), shrink, btScalar(0.1)), i);
+        }
+        batch.computeHulls();
+        ASSERT_EQ(batch.getNumHulls(), pointSets.size());
+        for (int i = 0; i < pointSets.size(); i++)
+        {
+            btConvexHullComputer hull;
+            btScalar shrink = (i % 4 == 1) ? btScalar(0.05) : btScalar(0);
+            bool usedExact;
+            btScalar shift = hull.computeQuick(&pointSets[i][0].getX(), sizeof(btVector3), pointSets[i].size(), shrink, btScalar(0.1), 0, 0, &usedExact);
+            EXPECT_EQ(batch.usedExactAlgorithm(i), usedExact);
+            EXPECT_EQ(batch.getShift(i), shift);
+            ASSERT_EQ(batch.getHull(i)->vertices.size(), hull.vertices.size());
+            EXPECT_EQ(batch.getHull(i)->faces.size(), hull.faces.size());
+            for (int j = 0; j < hull.vertices.size(); j++)
+                EXPECT_EQ(batch.getHull(i)->vertices[j], hull.vertices[j]);
+        }
+    }
+    EXPECT_EQ(batch.getNumExactFallbacks(), 0);
+
+    // the exact algorithm
+    batch.setUseQuickHull(false);
+    batch.computeHulls();
+    EXPECT_EQ(batch.getNumExactFallbacks(), batch.getNumHulls());
+}
+
+int main(int argc, char** argv)
+{
+#if BT_THREADSAFE
+    btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+    if (scheduler)
+        btSetTaskScheduler(scheduler);
+#endif  //BT_THREADSAFE
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
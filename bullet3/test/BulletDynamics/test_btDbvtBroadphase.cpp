@@ -0,0 +1,213 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+typedef std::vector< std::pair<int,int> > PairList;
+
+static PairList getPairs(btBroadphaseInterface* broadphase)
+{
+    PairList pairs;
+    btBroadphasePairArray& pairArray = broadphase->getOverlappingPairCache()->getOverlappingPairArray();
+    for (int i = 0; i < pairArray.size(); i++)
+    {
+        int uid0 = pairArray[i].m_pProxy0->getUid();
+        int uid1 = pairArray[i].m_pProxy1->getUid();
+        pairs.push_back(std::make_pair(btMin(uid0, uid1), btMax(uid0, uid1)));
+    }
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+static PairList getOverlappingLeaves(const btAlignedObjectArray<btBroadphaseProxy*>& proxies)
+{
+    PairList pairs;
+    for (int i = 0; i < proxies.size(); i++)
+    {
+        for (int j = i + 1; j < proxies.size(); j++)
+        {
+            const btDbvtProxy* pa = (const btDbvtProxy*)proxies[i];
+            const btDbvtProxy* pb = (const btDbvtProxy*)proxies[j];
+            if (Intersect(pa->leaf->volume, pb->leaf->volume))
+            {
+                pairs.push_back(std::make_pair(btMin(pa->getUid(), pb->getUid()), btMax(pa->getUid(), pb->getUid())));
+            }
+        }
+    }
+    std::sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+// Moves boxes around a small volume so pairs keep appearing and disappearing, some boxes staying put long enough to reach the fixed set
+static void moveBoxes(btDbvtBroadphase* broadphase, btAlignedObjectArray<btBroadphaseProxy*>& proxies, int frame)
+{
+    for (int i = 0; i < proxies.size(); i++)
+    {
+        if ((i % 5) == 0)
+            continue;
+        btScalar phase = btScalar(i) * btScalar(0.37) + btScalar(frame) * btScalar(0.05) * btScalar(1 + (i % 3));
+        btVector3 center(btSin(phase) * 10, btScalar(i % 17) - 8, btCos(phase * btScalar(1.3)) * 10);
+        btVector3 extent(btScalar(0.5), btScalar(0.5), btScalar(0.5));
+        broadphase->setAabb(proxies[i], center - extent, center + extent, 0);
+    }
+}
+
+static void checkParallelCollide(int numFrames)
+{
+    const int numBoxes = 1000;
+    btDbvtBroadphase serial;
+    btDbvtBroadphase parallel;
+    serial.m_deferedcollide = true;
+    serial.m_parallelcollide = false;
+    parallel.m_deferedcollide = true;
+    parallel.m_parallelcollide = true;
+    // Check every pair each frame, so the cache can be compared with the leaves
+    serial.m_cupdates = 100;
+    parallel.m_cupdates = 100;
+
+    btAlignedObjectArray<btBroadphaseProxy*> serialProxies;
+    btAlignedObjectArray<btBroadphaseProxy*> parallelProxies;
+    for (int i = 0; i < numBoxes; i++)
+    {
+        btVector3 center(btScalar(i % 20) - 10, btScalar(i % 17) - 8, btScalar(i / 20) * btScalar(0.4) - 10);
+        btVector3 extent(btScalar(0.5), btScalar(0.5), btScalar(0.5));
+        serialProxies.push_back(serial.createProxy(center - extent, center + extent, 0, 0, 1, -1, 0));
+        parallelProxies.push_back(parallel.createProxy(center - extent, center + extent, 0, 0, 1, -1, 0));
+    }
+
+    for (int frame = 0; frame < numFrames; frame++)
+    {
+        moveBoxes(&serial, serialProxies, frame);
+        moveBoxes(&parallel, parallelProxies, frame);
+        serial.calculateOverlappingPairs(0);
+        parallel.calculateOverlappingPairs(0);
+
+        PairList serialPairs = getPairs(&serial);
+        PairList parallelPairs = getPairs(&parallel);
+        ASSERT_EQ(serialPairs, parallelPairs) << "frame " << frame;
+        ASSERT_EQ(getOverlappingLeaves(parallelProxies), parallelPairs) << "frame " << frame;
+    }
+    EXPECT_GT(parallel.m_sets[1].m_leaves, 0);
+    EXPECT_GT(parallel.getOverlappingPairCache()->getNumOverlappingPairs(), 0);
+
+    for (int i = 0; i < numBoxes; i++)
+    {
+        serial.destroyProxy(serialProxies[i], 0);
+        parallel.destroyProxy(parallelProxies[i], 0);
+    }
+}
+
+GTEST_TEST(BulletCollision, DbvtBroadphaseParallelCollide)
+{
+    int findPairs = gFindPairs;
+    checkParallelCollide(100);
+    EXPECT_GT(gFindPairs, findPairs);
+}
+
+GTEST_TEST(BulletCollision, DbvtBroadphaseParallelCollideWithoutScheduler)
+{
+    // the parallel collide is the default in threadsafe builds, it has to work before a task scheduler is set
+    btITaskScheduler* scheduler = btGetTaskScheduler();
+    btSetTaskScheduler(0);
+    checkParallelCollide(20);
+    btSetTaskScheduler(scheduler);
+}
+
+GTEST_TEST(BulletCollision, DbvtBroadphaseRayTestBatch)
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher(&collisionConfiguration);
+    btDbvtBroadphase broadphase;
+    btCollisionWorld world(&dispatcher, &broadphase, &collisionConfiguration);
+
+    btBoxShape box(btVector3(1, 1, 1));
+    btSphereShape sphere(btScalar(0.8));
+    btAlignedObjectArray<btCollisionObject*> objects;
+    for (int i = 0; i < 300; i++)
+    {
+        btCollisionObject* object = new btCollisionObject();
+        object->setCollisionShape((i & 1) ? (btCollisionShape*)&box : (btCollisionShape*)&sphere);
+        btTransform transform;
+        transform.setIdentity();
+        transform.setOrigin(btVector3(btScalar(i % 10) * 3 - 15, btScalar((i / 10) % 6) * 3 - 9, btScalar(i / 60) * 4 - 10));
+        transform.setRotation(btQuaternion(btVector3(0, 1, 0), btScalar(i) * btScalar(0.3)));
+        object->setWorldTransform(transform);
+        world.addCollisionObject(object, (i % 3) ? btBroadphaseProxy::DefaultFilter : btBroadphaseProxy::StaticFilter);
+        objects.push_back(object);
+    }
+    world.updateAabbs();
+
+    // Rays fanning out from a few points, including a count that does not fill the last packet and rays that hit nothing
+    const int numRays = 1001;
+    btAlignedObjectArray<btVector3> rayFrom;
+    btAlignedObjectArray<btVector3> rayTo;
+    for (int i = 0; i < numRays; i++)
+    {
+        btScalar angle = btScalar(i) * SIMD_2_PI / btScalar(numRays);
+        btVector3 from(btScalar(i % 7) - 3, btScalar(20), btScalar(i % 5) - 2);
+        btVector3 to = from + btVector3(btCos(angle) * 40, btScalar(-60 + (i % 11) * 6), btSin(angle) * 40);
+        rayFrom.push_back(from);
+        rayTo.push_back(to);
+    }
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        btAlignedObjectArray<const btCollisionObject*> hitObjects;
+        btAlignedObjectArray<btScalar> hitFractions;
+        btAlignedObjectArray<btVector3> hitPoints;
+        btAlignedObjectArray<btVector3> hitNormals;
+        hitObjects.resize(numRays);
+        hitFractions.resize(numRays);
+        hitPoints.resize(numRays);
+        hitNormals.resize(numRays);
+        btCollisionWorld::RayBatchResults results;
+        results.m_collisionObjects = &hitObjects[0];
+        results.m_hitFractions = &hitFractions[0];
+        results.m_hitPointWorld = &hitPoints[0];
+        results.m_hitNormalWorld = &hitNormals[0];
+        // The second pass leaves out the static objects
+        if (pass == 1)
+            results.m_collisionFilterMask = btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter;
+        world.rayTestBatch(&rayFrom[0], &rayTo[0], numRays, results);
+
+        int numHits = 0;
+        for (int i = 0; i < numRays; i++)
+        {
+            btCollisionWorld::ClosestRayResultCallback callback(rayFrom[i], rayTo[i]);
+            callback.m_collisionFilterMask = results.m_collisionFilterMask;
+            world.rayTest(rayFrom[i], rayTo[i], callback);
+            ASSERT_EQ(callback.m_collisionObject, hitObjects[i]) << "ray " << i;
+            EXPECT_EQ(callback.m_closestHitFraction, hitFractions[i]) << "ray " << i;
+            if (callback.hasHit())
+            {
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    EXPECT_EQ(callback.m_hitPointWorld[axis], hitPoints[i][axis]) << "ray " << i;
+                    EXPECT_EQ(callback.m_hitNormalWorld[axis], hitNormals[i][axis]) << "ray " << i;
+                }
+                numHits++;
+            }
+        }
+        EXPECT_GT(numHits, 0);
+        EXPECT_LT(numHits, numRays);
+    }
+
+    for (int i = 0; i < objects.size(); i++)
+    {
+        world.removeCollisionObject(objects[i]);
+        delete objects[i];
+    }
+}
+
+
+int main(int argc, char **argv) {
+#if BT_THREADSAFE
+    btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+    btSetTaskScheduler(scheduler ? scheduler : btGetSequentialTaskScheduler());
+#endif  //BT_THREADSAFE
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
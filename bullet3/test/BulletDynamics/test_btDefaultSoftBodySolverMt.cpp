@@ -0,0 +1,185 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletSoftBody/btSoftRigidDynamicsWorld.h>
+#include <BulletSoftBody/btSoftBodyRigidBodyCollisionConfiguration.h>
+#include <BulletSoftBody/btSoftBodyHelpers.h>
+#include <BulletSoftBody/btDefaultSoftBodySolver.h>
+#include <BulletSoftBody/btDefaultSoftBodySolverMt.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+// Cloth falling on a box, a cloth hanging from two corners and a rope, next to each other
+struct SoftBodyScene
+{
+    btSoftBodyRigidBodyCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher;
+    btDbvtBroadphase broadphase;
+    btSequentialImpulseConstraintSolver solver;
+    btSoftBodySolver* softBodySolver;
+    btSoftRigidDynamicsWorld* world;
+    btBoxShape groundShape;
+    btBoxShape boxShape;
+    btAlignedObjectArray<btRigidBody*> bodies;
+
+    SoftBodyScene(bool useMtSolver)
+        : dispatcher(&collisionConfiguration),
+          groundShape(btVector3(20, 1, 20)),
+          boxShape(btVector3(1, 1, 1))
+    {
+        if (useMtSolver)
+            softBodySolver = new btDefaultSoftBodySolverMt();
+        else
+            softBodySolver = new btDefaultSoftBodySolver();
+        world = new btSoftRigidDynamicsWorld(&dispatcher, &broadphase, &solver, &collisionConfiguration, softBodySolver);
+        world->setGravity(btVector3(0, -10, 0));
+        btSoftBodyWorldInfo& worldInfo = world->getWorldInfo();
+        worldInfo.m_gravity = btVector3(0, -10, 0);
+        worldInfo.m_dispatcher = &dispatcher;
+        worldInfo.m_broadphase = &broadphase;
+        worldInfo.m_sparsesdf.Initialize();
+
+        addRigidBody(0, &groundShape, btVector3(0, -1, 0));
+        addRigidBody(1, &boxShape, btVector3(0, 1, 0));
+
+        btSoftBody* cloth = btSoftBodyHelpers::CreatePatch(worldInfo, btVector3(-2, 3, -2), btVector3(2, 3, -2), btVector3(-2, 3, 2), btVector3(2, 3, 2), 33, 33, 0, true);
+        cloth->getCollisionShape()->setMargin(btScalar(0.05));
+        cloth->setTotalMass(1);
+        world->addSoftBody(cloth);
+
+        btSoftBody* hanging = btSoftBodyHelpers::CreatePatch(worldInfo, btVector3(4, 6, -2), btVector3(8, 6, -2), btVector3(4, 6, 2), btVector3(8, 6, 2), 24, 24, 1 + 2, true);
+        hanging->setTotalMass(1);
+        world->addSoftBody(hanging);
+
+        btSoftBody* rope = btSoftBodyHelpers::CreateRope(worldInfo, btVector3(-6, 6, 0), btVector3(-2, 6, 0), 64, 1);
+        rope->setTotalMass(btScalar(0.5));
+        world->addSoftBody(rope);
+    }
+
+    ~SoftBodyScene()
+    {
+        btSoftBodyArray& softBodies = world->getSoftBodyArray();
+        while (softBodies.size())
+        {
+            btSoftBody* softBody = softBodies[softBodies.size() - 1];
+            world->removeSoftBody(softBody);
+            delete softBody;
+        }
+        for (int i = 0; i < bodies.size(); i++)
+        {
+            world->removeRigidBody(bodies[i]);
+            delete bodies[i];
+        }
+        delete world;
+        delete softBodySolver;
+    }
+
+    void addRigidBody(btScalar mass, btCollisionShape* shape, const btVector3& origin)
+    {
+        btVector3 localInertia(0, 0, 0);
+        if (mass > 0)
+            shape->calculateLocalInertia(mass, localInertia);
+        btRigidBody* body = new btRigidBody(mass, 0, shape, localInertia);
+        body->getWorldTransform().setOrigin(origin);
+        world->addRigidBody(body);
+        bodies.push_back(body);
+    }
+
+    void step(int numSteps, btAlignedObjectArray<btVector3>& positions)
+    {
+        for (int i = 0; i < numSteps; i++)
+            world->stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+        positions.resize(0);
+        btSoftBodyArray& softBodies = world->getSoftBodyArray();
+        for (int i = 0; i < softBodies.size(); i++)
+        {
+            for (int j = 0; j < softBodies[i]->m_nodes.size(); j++)
+                positions.push_back(softBodies[i]->m_nodes[j].m_x);
+        }
+        for (int i = 0; i < bodies.size(); i++)
+            positions.push_back(bodies[i]->getWorldTransform().getOrigin());
+    }
+};
+
+static void expectIdentical(const btAlignedObjectArray<btVector3>& a, const btAlignedObjectArray<btVector3>& b)
+{
+    ASSERT_EQ(a.size(), b.size());
+    for (int i = 0; i < a.size(); i++)
+    {
+        ASSERT_EQ(a[i].x(), b[i].x()) << "position " << i;
+        ASSERT_EQ(a[i].y(), b[i].y()) << "position " << i;
+        ASSERT_EQ(a[i].z(), b[i].z()) << "position " << i;
+    }
+}
+
+GTEST_TEST(btSoftBody, LinkBatchesAreDroppedWhenLinksChange)
+{
+    btSoftBodyWorldInfo worldInfo;
+    btSoftBody* patch = btSoftBodyHelpers::CreatePatch(worldInfo, btVector3(0, 0, 0), btVector3(1, 0, 0), btVector3(0, 0, 1), btVector3(1, 0, 1), 8, 8, 0, true);
+    patch->batchLinks();
+    EXPECT_TRUE(patch->hasLinkBatches());
+
+    // the number of links stays the same
+    btSoftBodyHelpers::ReoptimizeLinkOrder(patch);
+    EXPECT_FALSE(patch->hasLinkBatches());
+
+    patch->batchLinks();
+    patch->appendLink(0, 63);
+    EXPECT_FALSE(patch->hasLinkBatches());
+
+    patch->batchLinks();
+    EXPECT_TRUE(patch->cutLink(0, 1, btScalar(0.5)));
+    EXPECT_FALSE(patch->hasLinkBatches());
+
+    patch->batchLinks();
+    patch->randomizeConstraints();
+    EXPECT_FALSE(patch->hasLinkBatches());
+    delete patch;
+}
+
+#if BT_THREADSAFE
+GTEST_TEST(btDefaultSoftBodySolverMt, ResultsDoNotDependOnThreadCount)
+{
+    btITaskScheduler* scheduler = btGetTaskScheduler();
+    ASSERT_TRUE(scheduler != 0);
+    const int numSteps = 90;
+    btAlignedObjectArray<btVector3> oneThread, allThreads, serial;
+    {
+        scheduler->setNumThreads(1);
+        SoftBodyScene scene(true);
+        scene.step(numSteps, oneThread);
+    }
+    {
+        scheduler->setNumThreads(scheduler->getMaxNumThreads());
+        SoftBodyScene scene(true);
+        scene.step(numSteps, allThreads);
+    }
+    expectIdentical(oneThread, allThreads);
+
+    {
+        // the serial solver with the same batches, and the batches solved without a task scheduler
+        btSetTaskScheduler(0);
+        SoftBodyScene scene(false);
+        btSoftBodyArray& softBodies = scene.world->getSoftBodyArray();
+        for (int i = 0; i < softBodies.size(); i++)
+        {
+            if (softBodies[i]->m_links.size() >= btDefaultSoftBodySolverMt::s_minimumLinksForBatching)
+                softBodies[i]->batchLinks();
+        }
+        scene.step(numSteps, serial);
+        btSetTaskScheduler(scheduler);
+    }
+    expectIdentical(oneThread, serial);
+
+    // the cloth fell onto the box
+    EXPECT_LT(oneThread[0].y(), btScalar(2.5));
+}
+#endif  //BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+#if BT_THREADSAFE
+    btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+    btSetTaskScheduler(scheduler ? scheduler : btGetSequentialTaskScheduler());
+#endif  //BT_THREADSAFE
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
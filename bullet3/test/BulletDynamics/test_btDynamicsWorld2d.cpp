@@ -0,0 +1,147 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionShapes/btBox2dShape.h>
+#include <BulletCollision/CollisionShapes/btConvex2dShape.h>
+#include <BulletDynamics/Dynamics2d/btDynamicsWorld2d.h>
+#include <gtest/gtest.h>
+
+GTEST_TEST(BulletDynamics, Shape2dFromCollisionShape)
+{
+    btShape2d shape;
+
+    btBox2dShape box(btVector3(1, 2, 1));
+    ASSERT_TRUE(shape.setCollisionShape(&box));
+    EXPECT_EQ(shape.m_type, BT_SHAPE2D_POLYGON);
+    EXPECT_EQ(shape.m_numVertices, 4);
+    EXPECT_NEAR(shape.m_area, 8, 1e-5);
+    // Rectangle about its center: (w^2 + h^2) / 12
+    EXPECT_NEAR(shape.m_inertiaPerMass, (4 + 16) / btScalar(12), 1e-5);
+
+    btSphereShape sphere(btScalar(0.5));
+    ASSERT_TRUE(shape.setCollisionShape(&sphere));
+    EXPECT_EQ(shape.m_type, BT_SHAPE2D_CIRCLE);
+    EXPECT_NEAR(shape.m_radius, 0.5, 1e-6);
+
+    // A triangle hull wrapped in btConvex2dShape, given clockwise and with a duplicate and an interior point
+    btConvexHullShape hull;
+    hull.addPoint(btVector3(0, 0, 0), false);
+    hull.addPoint(btVector3(0, 2, 0), false);
+    hull.addPoint(btVector3(2, 0, 0), false);
+    hull.addPoint(btVector3(2, 0, 0), false);
+    hull.addPoint(btVector3(btScalar(0.5), btScalar(0.5), 0), true);
+    btConvex2dShape convex2d(&hull);
+    ASSERT_TRUE(shape.setCollisionShape(&convex2d));
+    EXPECT_EQ(shape.m_type, BT_SHAPE2D_POLYGON);
+    EXPECT_EQ(shape.m_numVertices, 3);
+    EXPECT_NEAR(shape.m_area, 2, 1e-5);
+    for (int i = 0; i < shape.m_numVertices; i++)
+    {
+        // Counter-clockwise, with outward normals
+        const btVector2& a = shape.m_vertices[i];
+        const btVector2& b = shape.m_vertices[(i + 1) % shape.m_numVertices];
+        btVector2 inside(btScalar(0.5), btScalar(0.5));
+        EXPECT_GT((b - a).cross(inside - a), 0);
+        EXPECT_LT(shape.m_normals[i].dot(inside - a), 0);
+    }
+
+    btBvhTriangleMeshShape* mesh = 0;
+    btTriangleMesh triangles;
+    triangles.addTriangle(btVector3(0, 0, 0), btVector3(1, 0, 0), btVector3(0, 1, 0));
+    mesh = new btBvhTriangleMeshShape(&triangles, true);
+    EXPECT_FALSE(shape.setCollisionShape(mesh));
+    delete mesh;
+}
+
+GTEST_TEST(BulletDynamics, DynamicsWorld2dRestingBox)
+{
+    btDynamicsWorld2d world;
+    btBox2dShape ground(btVector3(50, 1, 1));
+    btBox2dShape box(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+    world.addBody(&ground, 0, btVector2(0, -1));
+    int boxId = world.addBody(&box, 1, btVector2(0, btScalar(0.5)));
+
+    for (int i = 0; i < 120; i++)
+        world.stepSimulation(btScalar(1. / 60.));
+
+    EXPECT_NEAR(world.getPosition(boxId).m_x, 0, 1e-3);
+    EXPECT_NEAR(world.getPosition(boxId).m_y, 0.5, 0.02);
+    EXPECT_NEAR(world.getAngle(boxId), 0, 1e-3);
+    EXPECT_NEAR(world.getLinearVelocity(boxId).m_y, 0, 1e-2);
+    ASSERT_EQ(world.getNumManifolds(), 1);
+    EXPECT_EQ(world.getManifold(0).m_numPoints, 2);
+}
+
+GTEST_TEST(BulletDynamics, DynamicsWorld2dStack)
+{
+    btDynamicsWorld2d world;
+    btBox2dShape ground(btVector3(50, 1, 1));
+    btBox2dShape box(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+    btSphereShape ball(btScalar(0.5));
+    world.addBody(&ground, 0, btVector2(0, -1));
+    btAlignedObjectArray<int> ids;
+    const int height = 10;
+    for (int i = 0; i < height; i++)
+        ids.push_back(world.addBody(&box, 1, btVector2(0, btScalar(0.5) + btScalar(i))));
+    // A ball rolling in from the side, to mix circle contacts in
+    int ballId = world.addBody(&ball, 1, btVector2(-10, btScalar(0.5)));
+    world.setLinearVelocity(ballId, btVector2(1, 0));
+
+    for (int i = 0; i < 300; i++)
+        world.stepSimulation(btScalar(1. / 60.));
+
+    for (int i = 0; i < height; i++)
+    {
+        btVector2 position = world.getPosition(ids[i]);
+        EXPECT_NEAR(position.m_x, 0, 0.05) << "box " << i;
+        EXPECT_NEAR(position.m_y, btScalar(0.5) + btScalar(i), 0.1) << "box " << i;
+        EXPECT_NEAR(world.getAngle(ids[i]), 0, 0.02) << "box " << i;
+    }
+    EXPECT_NEAR(world.getPosition(ballId).m_y, 0.5, 0.02);
+    EXPECT_GT(world.getPosition(ballId).m_x, -10);
+}
+
+GTEST_TEST(BulletDynamics, DynamicsWorld2dRemoveBody)
+{
+    btDynamicsWorld2d world;
+    btBox2dShape ground(btVector3(50, 1, 1));
+    btBox2dShape box(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+    world.addBody(&ground, 0, btVector2(0, -1));
+    btAlignedObjectArray<int> ids;
+    for (int i = 0; i < 20; i++)
+        ids.push_back(world.addBody(&box, 1, btVector2(btScalar(i) * 2 - 20, btScalar(0.5))));
+    for (int i = 0; i < 10; i++)
+        world.stepSimulation(btScalar(1. / 60.));
+
+    // Remove every third box, then check the rest are still found by id and still simulated
+    for (int i = 0; i < ids.size(); i += 3)
+    {
+        world.removeBody(ids[i]);
+        EXPECT_EQ(world.getBodyIndex(ids[i]), -1);
+    }
+    EXPECT_EQ(world.getNumBodies(), 1 + 20 - 7);
+    for (int i = 0; i < 60; i++)
+        world.stepSimulation(btScalar(1. / 60.));
+
+    for (int i = 0; i < ids.size(); i++)
+    {
+        if ((i % 3) == 0)
+            continue;
+        int index = world.getBodyIndex(ids[i]);
+        ASSERT_GE(index, 0);
+        EXPECT_EQ(world.getBodyId(index), ids[i]);
+        EXPECT_NEAR(world.getPosition(ids[i]).m_x, btScalar(i) * 2 - 20, 1e-3);
+        EXPECT_NEAR(world.getPosition(ids[i]).m_y, 0.5, 0.02);
+    }
+    // One contact with the ground per remaining box
+    EXPECT_EQ(world.getNumManifolds(), 13);
+
+    // Freed ids are reused, the last one freed first
+    int newId = world.addBody(&box, 1, btVector2(30, btScalar(0.5)));
+    EXPECT_EQ(newId, ids[18]);
+    EXPECT_EQ(world.getBodyId(world.getBodyIndex(newId)), newId);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,433 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <LinearMath/btFrameArena.h>
+#include <LinearMath/btPerThreadPoolAllocator.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+#include <thread>
+
+GTEST_TEST(btFrameArena, ScopesRewindInOrder)
+{
+    btFrameArena arena;
+    btFrameArena::Marker start = arena.getMarker();
+    void* a = arena.allocate(100);
+    EXPECT_EQ(size_t(a) & 15, size_t(0));
+    btFrameArena::Marker afterA = arena.getMarker();
+    void* b = arena.allocate(10, 64);
+    EXPECT_EQ(size_t(b) & 63, size_t(0));
+    EXPECT_GE(arena.getUsedBytes(), size_t(110));
+
+    // memory after the marker is handed out again
+    arena.rewind(afterA);
+    EXPECT_EQ(arena.allocate(10, 64), b);
+    arena.rewind(start);
+    EXPECT_EQ(arena.getUsedBytes(), size_t(0));
+    EXPECT_EQ(arena.allocate(100), a);
+    arena.rewind(start);
+    EXPECT_EQ(arena.getNumChunkAllocations(), 1);
+}
+
+GTEST_TEST(btFrameArena, OverflowIsConsolidatedOnReset)
+{
+    btFrameArena arena;
+    btFrameArena::Marker start = arena.getMarker();
+    for (int i = 0; i < 100; i++)
+        arena.allocate(4000);
+    EXPECT_GT(arena.getNumChunkAllocations(), 1);
+    size_t peak = arena.getPeakUsedBytes();
+    EXPECT_GE(peak, size_t(400000));
+
+    // a reset while memory is in use leaves the arena as it is
+    int numChunkAllocations = arena.getNumChunkAllocations();
+    arena.reset();
+    EXPECT_EQ(arena.getNumConsolidations(), 0);
+
+    arena.rewind(start);
+    arena.reset();
+    EXPECT_EQ(arena.getNumConsolidations(), 1);
+    EXPECT_GE(arena.getCapacityBytes(), peak);
+
+    // the same use fits in the consolidated chunk
+    arena.resetStatistics();
+    for (int i = 0; i < 100; i++)
+        arena.allocate(4000);
+    EXPECT_EQ(arena.getNumChunkAllocations(), 0);
+    arena.rewind(start);
+    arena.reset();
+    EXPECT_EQ(arena.getNumConsolidations(), 0);
+    EXPECT_GT(numChunkAllocations, 0);
+}
+
+GTEST_TEST(btFrameArena, ArrayMovesToTheHeapBeyondItsCapacity)
+{
+    btFrameArena arena;
+    arena.allocate(10);
+    size_t used = arena.getUsedBytes();
+    {
+        btFrameArenaScope scratch(&arena);
+        btAlignedObjectArray<int> array;
+        scratch.initializeArray(array, 8);
+        for (int i = 0; i < 8; i++)
+            array.push_back(i);
+        EXPECT_EQ(array.capacity(), 8);
+        EXPECT_GE(arena.getUsedBytes(), used + 8 * sizeof(int));
+        for (int i = 8; i < 100; i++)
+            array.push_back(i);
+        for (int i = 0; i < 100; i++)
+            EXPECT_EQ(array[i], i);
+    }
+    EXPECT_EQ(arena.getUsedBytes(), used);
+
+    // without an arena the array is on the heap from the start
+    btFrameArenaScope heap(0);
+    btAlignedObjectArray<int> array;
+    heap.initializeArray(array, 8);
+    EXPECT_EQ(array.capacity(), 0);
+    array.push_back(1);
+    EXPECT_EQ(array[0], 1);
+}
+
+GTEST_TEST(btThreadFrameArenas, ResetOnlyTouchesItsOwnArenas)
+{
+    btThreadFrameArenas arenasA;
+    btThreadFrameArenas arenasB;
+    btFrameArena* arenaA = arenasA.getArena();
+    btFrameArena* arenaB = arenasB.getArena();
+#if BT_THREADSAFE
+    ASSERT_TRUE(arenaA && arenaB);
+    EXPECT_NE(arenaA, arenaB);
+    btFrameArena::Marker start = arenaA->getMarker();
+    for (int i = 0; i < 100; i++)
+        arenaA->allocate(4000);
+    arenaA->rewind(start);
+    arenaB->allocate(100);
+
+    // B still has memory in use and A is consolidated without looking at B
+    arenasA.reset();
+    arenasB.reset();
+    btFrameArenaStatistics statistics;
+    arenasA.getStatistics(statistics);
+    EXPECT_EQ(statistics.m_numThreadArenas, 1);
+    EXPECT_EQ(statistics.m_numConsolidations, 1);
+    arenasB.getStatistics(statistics);
+    EXPECT_EQ(statistics.m_numConsolidations, 0);
+    EXPECT_GE(arenaB->getUsedBytes(), size_t(100));
+#else
+    // all threads have index 0, the callers use the heap
+    EXPECT_TRUE(arenaA == 0 && arenaB == 0);
+#endif  //BT_THREADSAFE
+}
+
+// a dynamics world whose narrowphase clips convex hulls against a triangle mesh
+struct ArenaWorld
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcherMt dispatcher;
+    btDbvtBroadphase broadphase;
+    btSequentialImpulseConstraintSolverMt solver;
+    btDiscreteDynamicsWorld world;
+    btTriangleMesh mesh;
+    btBvhTriangleMeshShape* groundShape;
+    btConvexHullShape hullShape;
+    btCompoundShape compoundShape;
+    btBoxShape childShape;
+    btAlignedObjectArray<btRigidBody*> bodies;
+
+    explicit ArenaWorld(int seed)
+        : dispatcher(&collisionConfiguration),
+          world(&dispatcher, &broadphase, &solver, &collisionConfiguration),
+          childShape(btVector3(btScalar(0.5), btScalar(0.25), btScalar(0.25)))
+    {
+        for (int i = 0; i < 20; i++)
+        {
+            for (int j = 0; j < 20; j++)
+            {
+                btVector3 v00(btScalar(i - 10), btSin(btScalar(i + j)) * btScalar(0.2), btScalar(j - 10));
+                btVector3 v10(btScalar(i - 9), btSin(btScalar(i + j + 1)) * btScalar(0.2), btScalar(j - 10));
+                btVector3 v01(btScalar(i - 10), btSin(btScalar(i + j + 1)) * btScalar(0.2), btScalar(j - 9));
+                btVector3 v11(btScalar(i - 9), btSin(btScalar(i + j + 2)) * btScalar(0.2), btScalar(j - 9));
+                mesh.addTriangle(v00, v10, v01);
+                mesh.addTriangle(v10, v11, v01);
+            }
+        }
+        groundShape = new btBvhTriangleMeshShape(&mesh, true);
+        bodies.push_back(new btRigidBody(0, 0, groundShape));
+
+        for (int i = 0; i < 8; i++)
+        {
+            btScalar angle = SIMD_2_PI * btScalar(i) / btScalar(8);
+            hullShape.addPoint(btVector3(btCos(angle) * btScalar(0.5), btScalar(-0.3), btSin(angle) * btScalar(0.5)), false);
+            hullShape.addPoint(btVector3(btCos(angle) * btScalar(0.4), btScalar(0.3), btSin(angle) * btScalar(0.4)), false);
+        }
+        hullShape.recalcLocalAabb();
+        hullShape.initializePolyhedralFeatures();
+        compoundShape.addChildShape(btTransform(btQuaternion::getIdentity(), btVector3(btScalar(-0.5), 0, 0)), &childShape);
+        compoundShape.addChildShape(btTransform(btQuaternion(btVector3(0, 1, 0), btScalar(1.2)), btVector3(btScalar(0.5), 0, 0)), &childShape);
+
+        for (int i = 0; i < 60; i++)
+        {
+            btCollisionShape* shape = (i % 3) ? (btCollisionShape*)&hullShape : (btCollisionShape*)&compoundShape;
+            btVector3 localInertia;
+            shape->calculateLocalInertia(1, localInertia);
+            btRigidBody* body = new btRigidBody(1, 0, shape, localInertia);
+            btVector3 position(btScalar((i * 7 + seed * 3) % 12) - 6, btScalar(1 + i / 12), btScalar((i * 5 + seed) % 12) - 6);
+            body->setWorldTransform(btTransform(btQuaternion(btVector3(1, 0, 1).normalized(), btScalar(i + seed) * btScalar(0.4)), position));
+            bodies.push_back(body);
+        }
+        for (int i = 0; i < bodies.size(); i++)
+            world.addRigidBody(bodies[i]);
+    }
+
+    ~ArenaWorld()
+    {
+        for (int i = 0; i < bodies.size(); i++)
+        {
+            world.removeRigidBody(bodies[i]);
+            delete bodies[i];
+        }
+        delete groundShape;
+    }
+
+    void step(int numSteps)
+    {
+        for (int i = 0; i < numSteps; i++)
+            world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+    }
+
+    void getTransforms(btAlignedObjectArray<btTransform>& transforms) const
+    {
+        transforms.resize(0);
+        for (int i = 0; i < bodies.size(); i++)
+            transforms.push_back(bodies[i]->getWorldTransform());
+    }
+};
+
+static void stepArenaWorld(ArenaWorld* world, int numSteps)
+{
+    world->step(numSteps);
+}
+
+GTEST_TEST(btThreadFrameArenas, WorldsSteppedOnTwoThreads)
+{
+    const int numSteps = 120;
+    btITaskScheduler* scheduler = btGetTaskScheduler();
+    // the worlds call btParallelFor from both threads, the default scheduler expects a single caller
+    btSetTaskScheduler(btGetSequentialTaskScheduler());
+    // batch the contacts of every island, so the solvers take their scratch arrays from the arenas
+    int minimumContactManifoldsForBatching = btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching;
+    btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching = 1;
+    btAlignedObjectArray<btTransform> expected[2];
+    for (int seed = 0; seed < 2; seed++)
+    {
+        ArenaWorld world(seed);
+        world.step(numSteps);
+        world.getTransforms(expected[seed]);
+        EXPECT_GT(world.dispatcher.getNumManifolds(), 20);
+    }
+
+    ArenaWorld worldA(0);
+    ArenaWorld worldB(1);
+    std::thread threadA(stepArenaWorld, &worldA, numSteps);
+    std::thread threadB(stepArenaWorld, &worldB, numSteps);
+    threadA.join();
+    threadB.join();
+    btSetTaskScheduler(scheduler);
+    btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching = minimumContactManifoldsForBatching;
+
+    btAlignedObjectArray<btTransform> transforms;
+    worldA.getTransforms(transforms);
+    ASSERT_EQ(transforms.size(), expected[0].size());
+    for (int i = 0; i < transforms.size(); i++)
+        ASSERT_TRUE(transforms[i] == expected[0][i]) << "world A, body " << i;
+    worldB.getTransforms(transforms);
+    ASSERT_EQ(transforms.size(), expected[1].size());
+    for (int i = 0; i < transforms.size(); i++)
+        ASSERT_TRUE(transforms[i] == expected[1][i]) << "world B, body " << i;
+
+    btFrameArenaStatistics statistics;
+    worldA.dispatcher.getFrameArenaStatistics(statistics);
+#if BT_THREADSAFE
+    // each dispatcher and solver used the arena of the thread that stepped it
+    EXPECT_EQ(statistics.m_numThreadArenas, 1);
+    EXPECT_GT(statistics.m_peakUsedBytes, size_t(0));
+    worldB.solver.getFrameArenaStatistics(statistics);
+    EXPECT_EQ(statistics.m_numThreadArenas, 1);
+#else
+    EXPECT_EQ(statistics.m_numThreadArenas, 0);
+    worldB.solver.getFrameArenaStatistics(statistics);
+    EXPECT_EQ(statistics.m_numThreadArenas, 0);
+#endif  //BT_THREADSAFE
+}
+
+GTEST_TEST(btPerThreadPoolAllocator, ReusesElementsAndServesLargerRequests)
+{
+    btPerThreadPoolAllocator pool(48, 4, 2);
+    btAlignedObjectArray<void*> elements;
+    for (int i = 0; i < 10; i++)
+    {
+        void* elem = pool.allocate(48);
+        EXPECT_EQ(size_t(elem) & 15, size_t(0));
+        memset(elem, i, 48);
+        elements.push_back(elem);
+    }
+    void* large = pool.allocate(1000);
+    memset(large, 0xff, 1000);
+
+    btPoolAllocatorStatistics statistics;
+    pool.getStatistics(statistics);
+    EXPECT_EQ(statistics.m_numAllocations, 11);
+    EXPECT_EQ(statistics.m_numHeapAllocations, 1);
+    EXPECT_EQ(statistics.m_numInUse, 10);
+    // chunks of 4 and 8 elements
+    EXPECT_EQ(statistics.m_numChunkAllocations, 2);
+    EXPECT_EQ(statistics.m_capacity, 12);
+    for (int i = 0; i < 10; i++)
+        EXPECT_EQ(((unsigned char*)elements[i])[47], (unsigned char)i);
+
+    pool.freeMemory(large);
+    for (int i = 0; i < 10; i++)
+        pool.freeMemory(elements[i]);
+    pool.getStatistics(statistics);
+    EXPECT_EQ(statistics.m_numFrees, 11);
+    EXPECT_EQ(statistics.m_numInUse, 0);
+    EXPECT_GT(statistics.m_numDepotReturns, 0);
+
+    // the freed elements are used again before the pool grows
+    pool.resetStatistics();
+    for (int i = 0; i < 10; i++)
+        elements[i] = pool.allocate(48);
+    pool.getStatistics(statistics);
+    EXPECT_EQ(statistics.m_numChunkAllocations, 0);
+    EXPECT_EQ(statistics.m_capacity, 12);
+    for (int i = 0; i < 10; i++)
+        pool.freeMemory(elements[i]);
+}
+
+struct PoolFreeLoop : public btIParallelForBody
+{
+    btPerThreadPoolAllocator* m_pool;
+    btAlignedObjectArray<void*>* m_elements;
+    bool m_allocate;
+
+    void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+    {
+        for (int i = iBegin; i < iEnd; i++)
+        {
+            if (m_allocate)
+            {
+                (*m_elements)[i] = m_pool->allocate(m_pool->getElementSize());
+                *(int*)(*m_elements)[i] = i;
+            }
+            else
+            {
+                EXPECT_EQ(*(int*)(*m_elements)[i], i);
+                m_pool->freeMemory((*m_elements)[i]);
+            }
+        }
+    }
+};
+
+static void runPoolLoop(const PoolFreeLoop& body, int num)
+{
+    if (btGetTaskScheduler())
+        btParallelFor(0, num, 16, body);
+    else
+        body.forLoop(0, num);
+}
+
+GTEST_TEST(btPerThreadPoolAllocator, ElementsCanBeFreedByOtherThreads)
+{
+    const int num = 2000;
+    btPerThreadPoolAllocator pool(32);
+    btAlignedObjectArray<void*> elements;
+    elements.resize(num);
+    PoolFreeLoop body;
+    body.m_pool = &pool;
+    body.m_elements = &elements;
+
+    btPoolAllocatorStatistics statistics;
+    for (int round = 0; round < 4; round++)
+    {
+        // allocate on this thread and free on the others, then the other way around
+        bool parallelAllocate = (round & 1) != 0;
+        body.m_allocate = true;
+        if (parallelAllocate)
+            runPoolLoop(body, num);
+        else
+            body.forLoop(0, num);
+        pool.getStatistics(statistics);
+        EXPECT_EQ(statistics.m_numInUse, num);
+
+        body.m_allocate = false;
+        if (parallelAllocate)
+            body.forLoop(0, num);
+        else
+            runPoolLoop(body, num);
+        pool.getStatistics(statistics);
+        EXPECT_EQ(statistics.m_numInUse, 0);
+    }
+    // the freed elements return through the depot, the capacity stays bounded by what was in use at once
+    EXPECT_LE(statistics.m_capacity, 4 * num);
+}
+
+GTEST_TEST(btCollisionDispatcherMt, PoolsTrackTheManifolds)
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcherMt dispatcher(&collisionConfiguration);
+    btDbvtBroadphase broadphase;
+    btSequentialImpulseConstraintSolver solver;
+    btDiscreteDynamicsWorld world(&dispatcher, &broadphase, &solver, &collisionConfiguration);
+
+    btBoxShape groundShape(btVector3(50, 1, 50));
+    btBoxShape boxShape(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+    btSphereShape sphereShape(btScalar(0.5));
+    btAlignedObjectArray<btRigidBody*> bodies;
+    bodies.push_back(new btRigidBody(0, 0, &groundShape));
+    bodies[0]->setWorldTransform(btTransform(btQuaternion::getIdentity(), btVector3(0, -1, 0)));
+    for (int i = 0; i < 200; i++)
+    {
+        btCollisionShape* shape = (i & 1) ? (btCollisionShape*)&sphereShape : (btCollisionShape*)&boxShape;
+        btVector3 localInertia;
+        shape->calculateLocalInertia(1, localInertia);
+        btRigidBody* body = new btRigidBody(1, 0, shape, localInertia);
+        body->setWorldTransform(btTransform(btQuaternion::getIdentity(), btVector3(btScalar(i % 10) * btScalar(1.1) - 5, btScalar(i / 10) * btScalar(1.1) + btScalar(0.5), btScalar((i * 7) % 5) * btScalar(0.2))));
+        bodies.push_back(body);
+    }
+    for (int i = 0; i < bodies.size(); i++)
+        world.addRigidBody(bodies[i]);
+
+    btPoolAllocatorStatistics statistics;
+    for (int frame = 0; frame < 120; frame++)
+    {
+        world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+        dispatcher.getManifoldPoolStatistics(statistics);
+        ASSERT_EQ(statistics.m_numInUse, dispatcher.getNumManifolds());
+    }
+    EXPECT_GT(dispatcher.getNumManifolds(), 100);
+    EXPECT_EQ(statistics.m_numHeapAllocations, 0);
+
+    for (int i = 0; i < bodies.size(); i++)
+    {
+        world.removeRigidBody(bodies[i]);
+        delete bodies[i];
+    }
+    dispatcher.getManifoldPoolStatistics(statistics);
+    EXPECT_EQ(statistics.m_numInUse, 0);
+    EXPECT_EQ(statistics.m_numAllocations, statistics.m_numFrees);
+    dispatcher.getCollisionAlgorithmPoolStatistics(statistics);
+    EXPECT_EQ(statistics.m_numInUse, 0);
+    EXPECT_EQ(statistics.m_numAllocations, statistics.m_numFrees);
+}
+
+int main(int argc, char** argv)
+{
+#if BT_THREADSAFE
+    btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+    if (scheduler)
+        btSetTaskScheduler(scheduler);
+#endif  //BT_THREADSAFE
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,260 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/Gimpact/btGImpactShape.h>
+#include <BulletCollision/Gimpact/btGImpactCollisionAlgorithm.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+// a bumpy grid of size x size quads
+struct GridMesh
+{
+    btAlignedObjectArray<btVector3> vertices;
+    btAlignedObjectArray<int> indices;
+    btTriangleIndexVertexArray* meshInterface;
+
+    GridMesh(int size, btScalar phase)
+    {
+        for (int j = 0; j <= size; j++)
+            for (int i = 0; i <= size; i++)
+                vertices.push_back(btVector3(btScalar(i), btSin(btScalar(i) * btScalar(0.7) + phase) * btCos(btScalar(j) * btScalar(0.3)), btScalar(j)));
+        for (int j = 0; j < size; j++)
+        {
+            for (int i = 0; i < size; i++)
+            {
+                int v = j * (size + 1) + i;
+                indices.push_back(v);
+                indices.push_back(v + 1);
+                indices.push_back(v + size + 1);
+                indices.push_back(v + 1);
+                indices.push_back(v + size + 2);
+                indices.push_back(v + size + 1);
+            }
+        }
+        meshInterface = new btTriangleIndexVertexArray(indices.size() / 3, &indices[0], 3 * sizeof(int), vertices.size(), &vertices[0].m_floats[0], sizeof(btVector3));
+    }
+
+    ~GridMesh()
+    {
+        delete meshInterface;
+    }
+};
+
+// every primitive is a leaf once, and every node bound contains the bounds below it
+static void checkTree(const btGImpactMeshShapePart* part)
+{
+    const btGImpactQuantizedBvh& bvh = *part->getBoxSet();
+    part->lockChildShapes();
+    int numPrimitives = bvh.getPrimitiveManager()->get_primitive_count();
+    ASSERT_EQ(bvh.getNodeCount(), 2 * numPrimitives - 1);
+    btAlignedObjectArray<int> leafCount;
+    leafCount.resize(numPrimitives, 0);
+    for (int node = 0; node < bvh.getNodeCount(); node++)
+    {
+        btAABB bound;
+        bvh.getNodeBound(node, bound);
+        if (bvh.isLeafNode(node))
+        {
+            leafCount[bvh.getNodeData(node)]++;
+            btAABB primitiveBox;
+            bvh.getPrimitiveManager()->get_primitive_box(bvh.getNodeData(node), primitiveBox);
+            // the quantized bounds are rounded down, the grids are less than 64 units wide
+            for (int k = 0; k < 3; k++)
+            {
+                EXPECT_LE(bound.m_min[k], primitiveBox.m_min[k] + btScalar(1e-3));
+                EXPECT_GE(bound.m_max[k], primitiveBox.m_max[k] - btScalar(1e-3));
+            }
+            continue;
+        }
+        ASSERT_EQ(bvh.getEscapeNodeIndex(node) % 2, 1);
+        int children[2] = {bvh.getLeftNode(node), bvh.getRightNode(node)};
+        for (int c = 0; c < 2; c++)
+        {
+            ASSERT_LT(children[c], node + bvh.getEscapeNodeIndex(node));
+            btAABB childBound;
+            bvh.getNodeBound(children[c], childBound);
+            for (int k = 0; k < 3; k++)
+            {
+                EXPECT_LE(bound.m_min[k], childBound.m_min[k]);
+                EXPECT_GE(bound.m_max[k], childBound.m_max[k]);
+            }
+        }
+    }
+    for (int i = 0; i < numPrimitives; i++)
+        EXPECT_EQ(leafCount[i], 1);
+    part->unlockChildShapes();
+}
+
+static void findPairs(btGImpactMeshShape& shape0, const btTransform& trans0, btGImpactMeshShape& shape1, const btTransform& trans1, btPairSet& pairs)
+{
+    btGImpactMeshShapePart* part0 = shape0.getMeshPart(0);
+    btGImpactMeshShapePart* part1 = shape1.getMeshPart(0);
+    btGImpactQuantizedBvh::find_collision(part0->getBoxSet(), trans0, part1->getBoxSet(), trans1, pairs);
+}
+
+GTEST_TEST(BulletCollision, GImpactBvhBuildRefitAndFindCollision)
+{
+    GridMesh grid0(48, 0);
+    GridMesh grid1(40, 1);
+    btGImpactMeshShape shape0(grid0.meshInterface);
+    btGImpactMeshShape shape1(grid1.meshInterface);
+    shape0.updateBound();
+    shape1.updateBound();
+    checkTree(shape0.getMeshPart(0));
+
+    // deform the mesh and refit
+    for (int i = 0; i < grid0.vertices.size(); i++)
+        grid0.vertices[i].setY(grid0.vertices[i].y() * btScalar(0.5) + btScalar(0.1) * btSin(btScalar(i)));
+    shape0.postUpdate();
+    shape0.updateBound();
+    checkTree(shape0.getMeshPart(0));
+
+    btTransform trans0(btQuaternion(btVector3(0, 1, 0), btScalar(0.4)), btVector3(btScalar(-3), 0, btScalar(2)));
+    btTransform trans1(btQuaternion(btVector3(1, 0, 0), btScalar(0.05)), btVector3(5, btScalar(0.2), 0));
+    btPairSet pairs;
+    findPairs(shape0, trans0, shape1, trans1, pairs);
+
+    // all pairs of overlapping triangle boxes are found, each once. The tree tests the boxes of part1
+    // transformed into the space of part0, and its bounds are quantized, so the reference boxes are shrunk a little
+    btGImpactMeshShapePart* part0 = shape0.getMeshPart(0);
+    btGImpactMeshShapePart* part1 = shape1.getMeshPart(0);
+    int numPrimitives1 = part1->getNumChildShapes();
+    btAlignedObjectArray<char> found;
+    found.resize(part0->getNumChildShapes() * numPrimitives1, 0);
+    for (int i = 0; i < pairs.size(); i++)
+    {
+        char& f = found[pairs[i].m_index1 * numPrimitives1 + pairs[i].m_index2];
+        EXPECT_EQ(f, 0);
+        f = 1;
+    }
+    BT_BOX_BOX_TRANSFORM_CACHE transCache1to0;
+    transCache1to0.calc_from_homogenic(trans0, trans1);
+    part0->lockChildShapes();
+    part1->lockChildShapes();
+    int numOverlapping = 0;
+    for (int i = 0; i < part0->getNumChildShapes(); i++)
+    {
+        btAABB box0;
+        part0->getPrimitiveManager()->get_primitive_box(i, box0);
+        for (int j = 0; j < numPrimitives1; j++)
+        {
+            btAABB box1;
+            part1->getPrimitiveManager()->get_primitive_box(j, box1);
+            box1.increment_margin(btScalar(-0.01));
+            if (box0.overlapping_trans_cache(box1, transCache1to0, true))
+            {
+                numOverlapping++;
+                EXPECT_EQ(found[i * numPrimitives1 + j], 1) << i << " " << j;
+            }
+        }
+    }
+    part0->unlockChildShapes();
+    part1->unlockChildShapes();
+    EXPECT_GT(numOverlapping, 1000);
+}
+
+#if BT_THREADSAFE
+// records every contact point the algorithm adds, not just the ones the manifold keeps
+struct RecordingManifoldResult : public btManifoldResult
+{
+    btAlignedObjectArray<btVector3> m_points;
+
+    RecordingManifoldResult(const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap)
+        : btManifoldResult(body0Wrap, body1Wrap)
+    {
+    }
+
+    virtual void addContactPoint(const btVector3& normalOnBInWorld, const btVector3& pointInWorld, btScalar depth)
+    {
+        m_points.push_back(pointInWorld);
+    }
+};
+
+// the parallel build, refit, pair finding and triangle tests give the same results as the serial ones
+GTEST_TEST(BulletCollision, GImpactParallelMatchesSerial)
+{
+    btITaskScheduler* scheduler = btGetTaskScheduler();
+    if (!scheduler)
+        return;
+    GridMesh gridA(64, 0);
+    GridMesh gridB(56, 2);
+    btTransform transA(btQuaternion(btVector3(0, 1, 0), btScalar(0.3)), btVector3(0, 0, 0));
+    btTransform transB(btQuaternion(btVector3(0, 0, 1), btScalar(0.02)), btVector3(4, btScalar(0.1), 3));
+
+    btGImpactMeshShape* shapes[2][2];
+    btPairSet pairs[2];
+    btAlignedObjectArray<btVector3> contacts[2];
+    for (int parallel = 0; parallel < 2; parallel++)
+    {
+        btSetTaskScheduler(parallel ? scheduler : 0);
+        shapes[parallel][0] = new btGImpactMeshShape(gridA.meshInterface);
+        shapes[parallel][1] = new btGImpactMeshShape(gridB.meshInterface);
+        shapes[parallel][0]->updateBound();
+        shapes[parallel][1]->updateBound();
+        shapes[parallel][0]->postUpdate();
+        shapes[parallel][0]->updateBound();
+        findPairs(*shapes[parallel][0], transA, *shapes[parallel][1], transB, pairs[parallel]);
+
+        btDefaultCollisionConfiguration collisionConfiguration;
+        btCollisionDispatcher dispatcher(&collisionConfiguration);
+        btGImpactCollisionAlgorithm::registerAlgorithm(&dispatcher);
+        btCollisionObject objectA;
+        objectA.setCollisionShape(shapes[parallel][0]);
+        objectA.setWorldTransform(transA);
+        btCollisionObject objectB;
+        objectB.setCollisionShape(shapes[parallel][1]);
+        objectB.setWorldTransform(transB);
+        btCollisionObjectWrapper wrapA(0, objectA.getCollisionShape(), &objectA, transA, -1, -1);
+        btCollisionObjectWrapper wrapB(0, objectB.getCollisionShape(), &objectB, transB, -1, -1);
+        btCollisionAlgorithm* algorithm = dispatcher.findAlgorithm(&wrapA, &wrapB, 0, BT_CONTACT_POINT_ALGORITHMS);
+        RecordingManifoldResult result(&wrapA, &wrapB);
+        algorithm->processCollision(&wrapA, &wrapB, btDispatcherInfo(), &result);
+        algorithm->~btCollisionAlgorithm();
+        dispatcher.freeCollisionAlgorithm(algorithm);
+        contacts[parallel].copyFromArray(result.m_points);
+    }
+    btSetTaskScheduler(scheduler);
+
+    const btGImpactQuantizedBvh* serialBvh = shapes[0][0]->getMeshPart(0)->getBoxSet();
+    const btGImpactQuantizedBvh* parallelBvh = shapes[1][0]->getMeshPart(0)->getBoxSet();
+    ASSERT_EQ(serialBvh->getNodeCount(), parallelBvh->getNodeCount());
+    for (int i = 0; i < serialBvh->getNodeCount(); i++)
+    {
+        const BT_QUANTIZED_BVH_NODE* a = serialBvh->get_node_pointer(i);
+        const BT_QUANTIZED_BVH_NODE* b = parallelBvh->get_node_pointer(i);
+        ASSERT_EQ(a->m_escapeIndexOrDataIndex, b->m_escapeIndexOrDataIndex) << i;
+        for (int k = 0; k < 3; k++)
+        {
+            ASSERT_EQ(a->m_quantizedAabbMin[k], b->m_quantizedAabbMin[k]);
+            ASSERT_EQ(a->m_quantizedAabbMax[k], b->m_quantizedAabbMax[k]);
+        }
+    }
+    ASSERT_GT(pairs[0].size(), 1000);
+    ASSERT_EQ(pairs[0].size(), pairs[1].size());
+    for (int i = 0; i < pairs[0].size(); i++)
+    {
+        ASSERT_EQ(pairs[0][i].m_index1, pairs[1][i].m_index1) << i;
+        ASSERT_EQ(pairs[0][i].m_index2, pairs[1][i].m_index2) << i;
+    }
+    ASSERT_GT(contacts[0].size(), 0);
+    ASSERT_EQ(contacts[0].size(), contacts[1].size());
+    for (int i = 0; i < contacts[0].size(); i++)
+        EXPECT_EQ(contacts[0][i], contacts[1][i]);
+
+    for (int parallel = 0; parallel < 2; parallel++)
+    {
+        delete shapes[parallel][0];
+        delete shapes[parallel][1];
+    }
+}
+#endif  //BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+#if BT_THREADSAFE
+    btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+    if (scheduler)
+        btSetTaskScheduler(scheduler);
+#endif  //BT_THREADSAFE
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
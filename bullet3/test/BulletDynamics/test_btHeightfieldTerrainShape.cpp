@@ -0,0 +1,234 @@
+
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
+#include <BulletCollision/NarrowPhaseCollision/btRaycastCallback.h>
+#include <gtest/gtest.h>
+
+struct ClosestTriangleRayCallback : public btTriangleRaycastCallback
+{
+    int m_numTriangles;
+
+    ClosestTriangleRayCallback(const btVector3& from, const btVector3& to)
+        : btTriangleRaycastCallback(from, to),
+          m_numTriangles(0)
+    {
+    }
+
+    virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+    {
+        m_numTriangles++;
+        btTriangleRaycastCallback::processTriangle(triangle, partId, triangleIndex);
+    }
+
+    virtual btScalar reportHit(const btVector3& hitNormalLocal, btScalar hitFraction, int partId, int triangleIndex)
+    {
+        return hitFraction;
+    }
+};
+
+// counts the triangles whose aabb overlaps the query aabb
+struct OverlappingTriangleCallback : public btTriangleCallback
+{
+    btVector3 m_aabbMin;
+    btVector3 m_aabbMax;
+    int m_numOverlapping;
+    int m_numTriangles;
+
+    OverlappingTriangleCallback(const btVector3& aabbMin, const btVector3& aabbMax)
+        : m_aabbMin(aabbMin),
+          m_aabbMax(aabbMax),
+          m_numOverlapping(0),
+          m_numTriangles(0)
+    {
+    }
+
+    virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+    {
+        m_numTriangles++;
+        btVector3 triMin = triangle[0];
+        btVector3 triMax = triangle[0];
+        for (int i = 1; i < 3; i++)
+        {
+            triMin.setMin(triangle[i]);
+            triMax.setMax(triangle[i]);
+        }
+        if (TestAabbAgainstAabb2(triMin, triMax, m_aabbMin, m_aabbMax))
+            m_numOverlapping++;
+    }
+};
+
+static btScalar randomScalar(unsigned int& seed, btScalar minValue, btScalar maxValue)
+{
+    seed = seed * 1664525 + 1013904223;
+    return minValue + (maxValue - minValue) * btScalar(seed >> 8) / btScalar(1 << 24);
+}
+
+// rolling hills with flat plateaus, so that blocks of the pyramid have very different ranges
+static void makeTerrain(btAlignedObjectArray<float>& heights, int width, int length)
+{
+    heights.resize(width * length);
+    for (int j = 0; j < length; j++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            float h = 8.f * sinf(x * 0.11f) * cosf(j * 0.07f) + 2.f * sinf(x * 0.9f + j * 0.4f);
+            heights[j * width + x] = h > 6.f ? 6.f : h;
+        }
+    }
+}
+
+// the closest hit of the walk, with and without the pyramid, is the closest hit of all triangles under the ray's aabb
+static void compareRaycasts(btHeightfieldTerrainShape& shape, unsigned int seed, int numRays)
+{
+    btVector3 aabbMin, aabbMax;
+    shape.getAabb(btTransform::getIdentity(), aabbMin, aabbMax);
+    btVector3 extent = aabbMax - aabbMin;
+    int numWalkTriangles = 0;
+    int numAabbTriangles = 0;
+    int numHits = 0;
+    for (int i = 0; i < numRays; i++)
+    {
+        btVector3 from, to;
+        for (int k = 0; k < 3; k++)
+        {
+            from[k] = randomScalar(seed, aabbMin[k] - extent[k] * btScalar(0.2), aabbMax[k] + extent[k] * btScalar(0.2));
+            to[k] = randomScalar(seed, aabbMin[k] - extent[k] * btScalar(0.2), aabbMax[k] + extent[k] * btScalar(0.2));
+        }
+        int up = shape.getUpAxis();
+        // some horizontal and vertical rays
+        if ((i % 5) == 1)
+            to[up] = from[up];
+        if ((i % 5) == 2)
+        {
+            to = from;
+            to[up] = aabbMin[up] - 1;
+        }
+
+        ClosestTriangleRayCallback reference(from, to);
+        btVector3 rayMin = from;
+        rayMin.setMin(to);
+        btVector3 rayMax = from;
+        rayMax.setMax(to);
+        shape.processAllTriangles(&reference, rayMin, rayMax);
+
+        ClosestTriangleRayCallback walk(from, to);
+        shape.performRaycast(&walk, from, to, &walk.m_hitFraction);
+
+        ASSERT_NEAR(reference.m_hitFraction, walk.m_hitFraction, 1e-5) << "ray " << i;
+        numWalkTriangles += walk.m_numTriangles;
+        numAabbTriangles += reference.m_numTriangles;
+        numHits += reference.m_hitFraction < btScalar(1.) ? 1 : 0;
+    }
+    EXPECT_GT(numHits, numRays / 4);
+    EXPECT_LT(numWalkTriangles, numAabbTriangles / 4);
+}
+
+GTEST_TEST(BulletCollision, HeightfieldRaycastMatchesAllTriangles)
+{
+    const int width = 97;
+    const int length = 130;
+    btAlignedObjectArray<float> heights;
+    makeTerrain(heights, width, length);
+    for (int upAxis = 0; upAxis < 3; upAxis++)
+    {
+        btHeightfieldTerrainShape shape(width, length, &heights[0], 1, -10, 10, upAxis, PHY_FLOAT, upAxis == 1);
+        shape.setUseDiamondSubdivision(upAxis == 2);
+        shape.setLocalScaling(btVector3(btScalar(1.5), btScalar(0.75), btScalar(2.)));
+        compareRaycasts(shape, 1234 + upAxis, 2000);
+        shape.buildAccelerator();
+        compareRaycasts(shape, 1234 + upAxis, 2000);
+    }
+}
+
+GTEST_TEST(BulletCollision, HeightfieldAcceleratorKeepsOverlappingTriangles)
+{
+    const int width = 65;
+    const int length = 40;
+    btAlignedObjectArray<float> heights;
+    makeTerrain(heights, width, length);
+    btHeightfieldTerrainShape shape(width, length, &heights[0], 1, -10, 10, 1, PHY_FLOAT, false);
+    btHeightfieldTerrainShape accelerated(width, length, &heights[0], 1, -10, 10, 1, PHY_FLOAT, false);
+    accelerated.buildAccelerator();
+    unsigned int seed = 42;
+    int numSkipped = 0;
+    for (int i = 0; i < 500; i++)
+    {
+        btVector3 center(randomScalar(seed, -40, 40), randomScalar(seed, -12, 12), randomScalar(seed, -25, 25));
+        btVector3 halfExtents(randomScalar(seed, 0, 6), randomScalar(seed, 0, 3), randomScalar(seed, 0, 6));
+        OverlappingTriangleCallback all(center - halfExtents, center + halfExtents);
+        shape.processAllTriangles(&all, center - halfExtents, center + halfExtents);
+        OverlappingTriangleCallback skipping(center - halfExtents, center + halfExtents);
+        accelerated.processAllTriangles(&skipping, center - halfExtents, center + halfExtents);
+        ASSERT_EQ(all.m_numOverlapping, skipping.m_numOverlapping) << "query " << i;
+        numSkipped += all.m_numTriangles - skipping.m_numTriangles;
+    }
+    EXPECT_GT(numSkipped, 0);
+}
+
+GTEST_TEST(BulletCollision, HeightfieldAcceleratorUpdate)
+{
+    const int width = 50;
+    const int length = 33;
+    btAlignedObjectArray<float> heights;
+    makeTerrain(heights, width, length);
+    btHeightfieldTerrainShape shape(width, length, &heights[0], 1, -10, 10, 1, PHY_FLOAT, false);
+    shape.buildAccelerator();
+
+    // dig a pit and raise a pillar, then update the pyramid only around them
+    for (int j = 10; j <= 12; j++)
+        for (int x = 20; x <= 23; x++)
+            heights[j * width + x] = -9.f;
+    heights[30 * width + 45] = 9.5f;
+    shape.updateAccelerator(20, 10, 23, 12);
+    shape.updateAccelerator(45, 30, 45, 30);
+
+    // a ray down into the pit and one at the height of the pillar top
+    btVector3 pit(btScalar(21.5 - 24.5), 0, btScalar(11.5 - 16));
+    ClosestTriangleRayCallback down(pit, pit - btVector3(0, 20, 0));
+    shape.performRaycast(&down, down.m_from, down.m_to);
+    EXPECT_NEAR(down.m_hitFraction, btScalar(9. / 20.), 1e-4);
+
+    btVector3 pillar(btScalar(45 - 24.5), btScalar(9.4), btScalar(30 - 16));
+    ClosestTriangleRayCallback across(pillar - btVector3(30, 0, 0), pillar + btVector3(30, 0, 0));
+    shape.performRaycast(&across, across.m_from, across.m_to);
+    EXPECT_LT(across.m_hitFraction, btScalar(0.5));
+}
+
+GTEST_TEST(BulletCollision, HeightfieldWorldRayTest)
+{
+    const int width = 129;
+    const int length = 129;
+    btAlignedObjectArray<float> heights;
+    makeTerrain(heights, width, length);
+    btHeightfieldTerrainShape shape(width, length, &heights[0], 1, -10, 10, 1, PHY_FLOAT, false);
+    shape.buildAccelerator();
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher(&collisionConfiguration);
+    btDbvtBroadphase broadphase;
+    btCollisionWorld world(&dispatcher, &broadphase, &collisionConfiguration);
+    btCollisionObject terrain;
+    terrain.setCollisionShape(&shape);
+    terrain.getWorldTransform().setOrigin(btVector3(5, 1, -3));
+    terrain.getWorldTransform().setRotation(btQuaternion(btVector3(0, 1, 0), btScalar(0.3)));
+    world.addCollisionObject(&terrain);
+
+    btVector3 from(-70, 3, 10);
+    btVector3 to(80, btScalar(-2), -20);
+    btCollisionWorld::ClosestRayResultCallback hit(from, to);
+    world.rayTest(from, to, hit);
+    ASSERT_TRUE(hit.hasHit());
+
+    btTransform inverse = terrain.getWorldTransform().inverse();
+    ClosestTriangleRayCallback reference(inverse * from, inverse * to);
+    btVector3 aabbMin, aabbMax;
+    shape.getAabb(btTransform::getIdentity(), aabbMin, aabbMax);
+    shape.processAllTriangles(&reference, aabbMin, aabbMax);
+    EXPECT_NEAR(hit.m_closestHitFraction, reference.m_hitFraction, 1e-5);
+    world.removeCollisionObject(&terrain);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
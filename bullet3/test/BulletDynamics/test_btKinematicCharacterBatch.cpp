@@ -0,0 +1,191 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionDispatch/btGhostObject.h>
+#include <BulletDynamics/Character/btKinematicCharacterController.h>
+#include <BulletDynamics/Character/btKinematicCharacterBatch.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+// flat ground with low steps, walls and a low ceiling, and characters that don't collide with each other
+struct CharacterScene
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher;
+    btDbvtBroadphase broadphase;
+    btSequentialImpulseConstraintSolver solver;
+    btDiscreteDynamicsWorld world;
+    btGhostPairCallback ghostPairCallback;
+    btCapsuleShape capsule;
+    btAlignedObjectArray<btCollisionShape*> shapes;
+    btAlignedObjectArray<btCollisionObject*> objects;
+    btAlignedObjectArray<btPairCachingGhostObject*> ghosts;
+
+    CharacterScene(int numCharacters)
+        : dispatcher(&collisionConfiguration),
+          world(&dispatcher, &broadphase, &solver, &collisionConfiguration),
+          capsule(btScalar(0.3), btScalar(1.0))
+    {
+        broadphase.getOverlappingPairCache()->setInternalGhostPairCallback(&ghostPairCallback);
+        addBox(btVector3(40, 1, 40), btVector3(0, -1, 0));
+        for (int i = 0; i < 6; i++)
+        {
+            // steps, walls and a ceiling above the characters' heads
+            addBox(btVector3(2, btScalar(0.15), 2), btVector3(btScalar(i * 5 - 12), btScalar(0.15), 4));
+            addBox(btVector3(btScalar(0.5), 2, 3), btVector3(btScalar(i * 5 - 10), 2, -6));
+            addBox(btVector3(2, btScalar(0.2), 2), btVector3(btScalar(i * 5 - 12), btScalar(1.95), -1));
+        }
+        for (int i = 0; i < numCharacters; i++)
+        {
+            btPairCachingGhostObject* ghost = new btPairCachingGhostObject();
+            ghost->setWorldTransform(btTransform(btQuaternion::getIdentity(), btVector3(btScalar((i % 8) * 3 - 12), btScalar(0.85), btScalar((i / 8) * 3 - 10))));
+            ghost->setCollisionShape(&capsule);
+            ghost->setCollisionFlags(btCollisionObject::CF_CHARACTER_OBJECT);
+            world.addCollisionObject(ghost, btBroadphaseProxy::CharacterFilter, btBroadphaseProxy::StaticFilter | btBroadphaseProxy::DefaultFilter);
+            ghosts.push_back(ghost);
+        }
+    }
+
+    void addBox(const btVector3& halfExtents, const btVector3& origin)
+    {
+        btBoxShape* shape = new btBoxShape(halfExtents);
+        btCollisionObject* object = new btCollisionObject();
+        object->setCollisionShape(shape);
+        object->getWorldTransform().setOrigin(origin);
+        world.addCollisionObject(object, btBroadphaseProxy::StaticFilter, btBroadphaseProxy::AllFilter ^ btBroadphaseProxy::StaticFilter);
+        shapes.push_back(shape);
+        objects.push_back(object);
+    }
+
+    ~CharacterScene()
+    {
+        for (int i = 0; i < ghosts.size(); i++)
+        {
+            world.removeCollisionObject(ghosts[i]);
+            delete ghosts[i];
+        }
+        for (int i = 0; i < objects.size(); i++)
+        {
+            world.removeCollisionObject(objects[i]);
+            delete objects[i];
+            delete shapes[i];
+        }
+    }
+};
+
+static btVector3 walkDirection(int character, int frame)
+{
+    btScalar angle = btScalar(character) * btScalar(2.4) + btScalar(frame / 60) * btScalar(0.9);
+    return btVector3(btCos(angle), 0, btSin(angle)) * btScalar(0.06);
+}
+
+GTEST_TEST(BulletDynamics, CharacterBatchMatchesControllers)
+{
+    const int numCharacters = 40;
+    CharacterScene reference(numCharacters);
+    CharacterScene batched(numCharacters);
+    btAlignedObjectArray<btKinematicCharacterController*> controllers;
+    btKinematicCharacterBatch batch(btScalar(0.35), btVector3(0, 1, 0));
+    batch.setCellSize(6);
+    for (int i = 0; i < numCharacters; i++)
+    {
+        btKinematicCharacterController* controller = new btKinematicCharacterController(reference.ghosts[i], &reference.capsule, btScalar(0.35), btVector3(0, 1, 0));
+        controller->setUseGhostSweepTest(false);
+        reference.world.addAction(controller);
+        controllers.push_back(controller);
+        // the controller turns its ghost object from its default up axis. Upright, the double fall test of its stepDown,
+        // which is swept without rotation, sees the same shape as the batch
+        reference.ghosts[i]->setWorldTransform(batched.ghosts[i]->getWorldTransform());
+        EXPECT_EQ(batch.addCharacter(batched.ghosts[i], &batched.capsule), i);
+    }
+    batched.world.addAction(&batch);
+
+    btScalar maxError = 0;
+    for (int frame = 0; frame < 400; frame++)
+    {
+        for (int i = 0; i < numCharacters; i++)
+        {
+            if ((i % 5) == 4)
+            {
+                // moved by velocity for a while, then standing
+                if ((frame % 90) == 0)
+                {
+                    controllers[i]->setVelocityForTimeInterval(walkDirection(i, frame) * 60, btScalar(0.5));
+                    batch.setVelocityForTimeInterval(i, walkDirection(i, frame) * 60, btScalar(0.5));
+                }
+            }
+            else
+            {
+                controllers[i]->setWalkDirection(walkDirection(i, frame));
+                batch.setWalkDirection(i, walkDirection(i, frame));
+            }
+            if ((i % 3) == 0 && (frame % 70) == 35 && controllers[i]->canJump())
+            {
+                ASSERT_TRUE(batch.canJump(i));
+                controllers[i]->jump();
+                batch.jump(i);
+            }
+        }
+        reference.world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+        batched.world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+
+        for (int i = 0; i < numCharacters; i++)
+        {
+            const btVector3& expected = reference.ghosts[i]->getWorldTransform().getOrigin();
+            const btVector3& position = batched.ghosts[i]->getWorldTransform().getOrigin();
+            maxError = btMax(maxError, (position - expected).length());
+            ASSERT_LT((position - expected).length(), btScalar(1e-3)) << "frame " << frame << " character " << i;
+            EXPECT_EQ(batch.onGround(i), controllers[i]->onGround());
+            EXPECT_EQ(batch.getCharacterState(i).m_position, position);
+        }
+    }
+    EXPECT_LT(maxError, btScalar(1e-4));
+
+    // the characters walked, stand on the ground or on a step, and none went through a wall
+    for (int i = 0; i < numCharacters; i++)
+    {
+        const btVector3& position = batched.ghosts[i]->getWorldTransform().getOrigin();
+        EXPECT_GT(position.y(), btScalar(0.7));
+        EXPECT_LT(position.y(), btScalar(3.0));
+    }
+
+    batched.world.removeAction(&batch);
+    for (int i = 0; i < numCharacters; i++)
+    {
+        reference.world.removeAction(controllers[i]);
+        delete controllers[i];
+    }
+}
+
+GTEST_TEST(BulletDynamics, CharacterBatchRemoveAndWarp)
+{
+    CharacterScene scene(3);
+    btKinematicCharacterBatch batch(btScalar(0.35));
+    for (int i = 0; i < 3; i++)
+        batch.addCharacter(scene.ghosts[i], &scene.capsule);
+    batch.removeCharacter(0);
+    ASSERT_EQ(batch.getNumCharacters(), 2);
+    EXPECT_EQ(batch.getGhostObject(0), scene.ghosts[2]);
+    EXPECT_EQ(batch.getGhostObject(1), scene.ghosts[1]);
+
+    // a character warped into the air falls back to the ground
+    batch.warp(0, btVector3(20, 5, 20));
+    scene.world.addAction(&batch);
+    for (int frame = 0; frame < 120; frame++)
+        scene.world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+    const btVector3& position = scene.ghosts[2]->getWorldTransform().getOrigin();
+    EXPECT_NEAR(position.x(), 20, 1e-4);
+    EXPECT_NEAR(position.y(), btScalar(0.8), btScalar(0.05));
+    EXPECT_TRUE(batch.onGround(0));
+    scene.world.removeAction(&batch);
+}
+
+int main(int argc, char** argv)
+{
+#if BT_THREADSAFE
+    btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+    if (scheduler)
+        btSetTaskScheduler(scheduler);
+#endif  //BT_THREADSAFE
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,300 @@
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Featherstone/btMultiBody.h>
+#include <BulletDynamics/Featherstone/btMultiBodyConstraintSolver.h>
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorld.h>
+#include <BulletDynamics/Featherstone/btMultiBodyDynamicsWorldMt.h>
+#include <BulletDynamics/Featherstone/btMultiBodyJointLimitConstraint.h>
+#include <BulletDynamics/Featherstone/btMultiBodyJointMotor.h>
+#include <BulletDynamics/Featherstone/btMultiBodyLinkCollider.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+// Ragdolls dropped on the ground, boxes dropped on the ragdolls, and chains swinging from fixed bases
+struct MultiBodyScene
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher;
+    btDbvtBroadphase broadphase;
+    btMultiBodyConstraintSolver* solver;
+    btMultiBodyDynamicsWorld* world;
+    btBoxShape groundShape;
+    btBoxShape torsoShape;
+    btSphereShape headShape;
+    btBoxShape armShape;
+    btBoxShape legShape;
+    btBoxShape chainShape;
+    btBoxShape boxShape;
+    btAlignedObjectArray<btRigidBody*> bodies;
+    btAlignedObjectArray<btMultiBody*> multiBodies;
+    btAlignedObjectArray<btMultiBodyLinkCollider*> colliders;
+    btAlignedObjectArray<btMultiBodyConstraint*> constraints;
+
+    MultiBodyScene(bool useMtWorld, int numRagdolls, int numChains)
+        : dispatcher(&collisionConfiguration),
+          groundShape(btVector3(40, 1, 40)),
+          torsoShape(btVector3(btScalar(0.2), btScalar(0.3), btScalar(0.1))),
+          headShape(btScalar(0.12)),
+          armShape(btVector3(btScalar(0.05), btScalar(0.15), btScalar(0.05))),
+          legShape(btVector3(btScalar(0.07), btScalar(0.2), btScalar(0.07))),
+          chainShape(btVector3(btScalar(0.05), btScalar(0.2), btScalar(0.05))),
+          boxShape(btVector3(btScalar(0.2), btScalar(0.2), btScalar(0.2)))
+    {
+        if (useMtWorld)
+        {
+            btMultiBodyConstraintSolverPoolMt* solverPool = new btMultiBodyConstraintSolverPoolMt(BT_MAX_THREAD_COUNT);
+            solver = solverPool;
+            world = new btMultiBodyDynamicsWorldMt(&dispatcher, &broadphase, solverPool, &collisionConfiguration);
+        }
+        else
+        {
+            solver = new btMultiBodyConstraintSolver();
+            world = new btMultiBodyDynamicsWorld(&dispatcher, &broadphase, solver, &collisionConfiguration);
+        }
+        world->setGravity(btVector3(0, -10, 0));
+
+        addRigidBody(0, &groundShape, btVector3(0, -1, 0));
+        for (int i = 0; i < numRagdolls; i++)
+        {
+            btVector3 origin(btScalar(i % 4) * 3, btScalar(1.2), btScalar(i / 4) * 3);
+            addRagdoll(origin, btQuaternion(btVector3(1, 0, 0), btScalar(1.2) + btScalar(i) * btScalar(0.1)));
+            addRigidBody(1, &boxShape, origin + btVector3(btScalar(0.1), 2, 0));
+        }
+        for (int i = 0; i < numChains; i++)
+            addChain(btVector3(btScalar(i) * 3, 6, -6), btScalar(0.5) + btScalar(i) * btScalar(0.2));
+    }
+
+    ~MultiBodyScene()
+    {
+        for (int i = 0; i < constraints.size(); i++)
+        {
+            world->removeMultiBodyConstraint(constraints[i]);
+            delete constraints[i];
+        }
+        for (int i = 0; i < colliders.size(); i++)
+        {
+            world->removeCollisionObject(colliders[i]);
+            delete colliders[i];
+        }
+        for (int i = 0; i < multiBodies.size(); i++)
+        {
+            world->removeMultiBody(multiBodies[i]);
+            delete multiBodies[i];
+        }
+        for (int i = 0; i < bodies.size(); i++)
+        {
+            world->removeRigidBody(bodies[i]);
+            delete bodies[i];
+        }
+        delete world;
+        delete solver;
+    }
+
+    void addRigidBody(btScalar mass, btCollisionShape* shape, const btVector3& origin)
+    {
+        btVector3 localInertia(0, 0, 0);
+        if (mass > 0)
+            shape->calculateLocalInertia(mass, localInertia);
+        btRigidBody* body = new btRigidBody(mass, 0, shape, localInertia);
+        body->getWorldTransform().setOrigin(origin);
+        world->addRigidBody(body);
+        bodies.push_back(body);
+    }
+
+    static btVector3 getInertia(btCollisionShape* shape, btScalar mass)
+    {
+        btVector3 inertia;
+        shape->calculateLocalInertia(mass, inertia);
+        return inertia;
+    }
+
+    void addCollider(btMultiBody* multiBody, int link, btCollisionShape* shape)
+    {
+        btMultiBodyLinkCollider* collider = new btMultiBodyLinkCollider(multiBody, link);
+        collider->setCollisionShape(shape);
+        if (link < 0)
+            multiBody->setBaseCollider(collider);
+        else
+            multiBody->getLink(link).m_collider = collider;
+        colliders.push_back(collider);
+    }
+
+    // updates the transforms of the colliders of the multibody and adds them to the world
+    void addMultiBody(btMultiBody* multiBody)
+    {
+        btAlignedObjectArray<btQuaternion> worldToLocal;
+        btAlignedObjectArray<btVector3> localOrigin;
+        multiBody->forwardKinematics(worldToLocal, localOrigin);
+        multiBody->updateCollisionObjectWorldTransforms(worldToLocal, localOrigin);
+        world->addMultiBody(multiBody);
+        if (multiBody->getBaseCollider())
+            world->addCollisionObject(multiBody->getBaseCollider(), btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter);
+        for (int i = 0; i < multiBody->getNumLinks(); i++)
+            world->addCollisionObject(multiBody->getLink(i).m_collider, btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter);
+        multiBodies.push_back(multiBody);
+    }
+
+    // a torso with a head, arms with elbows and legs with knees
+    void addRagdoll(const btVector3& origin, const btQuaternion& rotation)
+    {
+        btMultiBody* ragdoll = new btMultiBody(9, 3, getInertia(&torsoShape, 3), false, false);
+        ragdoll->setBasePos(origin);
+        ragdoll->setWorldToBaseRot(rotation);
+        addCollider(ragdoll, -1, &torsoShape);
+
+        btQuaternion identity = btQuaternion::getIdentity();
+        ragdoll->setupSpherical(0, 1, getInertia(&headShape, 1), -1, identity, btVector3(0, btScalar(0.3), 0), btVector3(0, btScalar(0.12), 0), true);
+        addCollider(ragdoll, 0, &headShape);
+        for (int side = 0; side < 2; side++)
+        {
+            btScalar x = side ? btScalar(0.25) : btScalar(-0.25);
+            int arm = 1 + side * 2;
+            ragdoll->setupSpherical(arm, btScalar(0.5), getInertia(&armShape, btScalar(0.5)), -1, identity, btVector3(x, btScalar(0.25), 0), btVector3(0, btScalar(-0.15), 0), true);
+            ragdoll->setupRevolute(arm + 1, btScalar(0.4), getInertia(&armShape, btScalar(0.4)), arm, identity, btVector3(1, 0, 0), btVector3(0, btScalar(-0.15), 0), btVector3(0, btScalar(-0.15), 0), true);
+            addCollider(ragdoll, arm, &armShape);
+            addCollider(ragdoll, arm + 1, &armShape);
+
+            int leg = 5 + side * 2;
+            ragdoll->setupSpherical(leg, 1, getInertia(&legShape, 1), -1, identity, btVector3(x * btScalar(0.4), btScalar(-0.3), 0), btVector3(0, btScalar(-0.2), 0), true);
+            ragdoll->setupRevolute(leg + 1, btScalar(0.8), getInertia(&legShape, btScalar(0.8)), leg, identity, btVector3(1, 0, 0), btVector3(0, btScalar(-0.2), 0), btVector3(0, btScalar(-0.2), 0), true);
+            addCollider(ragdoll, leg, &legShape);
+            addCollider(ragdoll, leg + 1, &legShape);
+            btMultiBodyConstraint* knee = new btMultiBodyJointLimitConstraint(ragdoll, leg + 1, 0, 2);
+            world->addMultiBodyConstraint(knee);
+            constraints.push_back(knee);
+        }
+        ragdoll->finalizeMultiDof();
+        ragdoll->setBaseVel(btVector3(0, 0, -1));
+        addMultiBody(ragdoll);
+    }
+
+    // five links on hinges, the second one driven by a motor
+    void addChain(const btVector3& origin, btScalar angle)
+    {
+        btMultiBody* chain = new btMultiBody(5, 0, btVector3(0, 0, 0), true, false);
+        chain->setBasePos(origin);
+        btQuaternion identity = btQuaternion::getIdentity();
+        for (int i = 0; i < 5; i++)
+        {
+            chain->setupRevolute(i, 1, getInertia(&chainShape, 1), i - 1, identity, btVector3(0, 0, 1), btVector3(0, btScalar(-0.2), 0), btVector3(0, btScalar(-0.2), 0), true);
+            addCollider(chain, i, &chainShape);
+        }
+        chain->finalizeMultiDof();
+        chain->setJointPos(0, angle);
+        addMultiBody(chain);
+        btMultiBodyConstraint* motor = new btMultiBodyJointMotor(chain, 1, btScalar(0.5), btScalar(0.2));
+        world->addMultiBodyConstraint(motor);
+        constraints.push_back(motor);
+    }
+
+    void step(int numSteps)
+    {
+        for (int i = 0; i < numSteps; i++)
+            world->stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+    }
+
+    // base transform and velocity and joint positions of the multibodies, then the transforms of the rigid bodies
+    void getState(btAlignedObjectArray<btScalar>& state)
+    {
+        state.resize(0);
+        for (int i = 0; i < multiBodies.size(); i++)
+        {
+            const btMultiBody* multiBody = multiBodies[i];
+            for (int k = 0; k < 3; k++)
+                state.push_back(multiBody->getBasePos()[k]);
+            for (int k = 0; k < 4; k++)
+                state.push_back(multiBody->getWorldToBaseRot()[k]);
+            for (int k = 0; k < 3; k++)
+                state.push_back(multiBody->getBaseVel()[k]);
+            for (int j = 0; j < multiBody->getNumLinks(); j++)
+            {
+                for (int k = 0; k < multiBody->getLink(j).m_posVarCount; k++)
+                    state.push_back(multiBody->getJointPosMultiDof(j)[k]);
+            }
+        }
+        for (int i = 0; i < bodies.size(); i++)
+        {
+            const btTransform& transform = bodies[i]->getWorldTransform();
+            for (int k = 0; k < 3; k++)
+                state.push_back(transform.getOrigin()[k]);
+            for (int k = 0; k < 4; k++)
+                state.push_back(transform.getRotation()[k]);
+        }
+    }
+};
+
+GTEST_TEST(btMultiBodyDynamicsWorld, SerialWorldIsUnchanged)
+{
+    MultiBodyScene scene(false, 2, 1);
+    scene.step(120);
+    // base positions and sums of the joint positions of the two ragdolls and the chain, and the positions of the boxes,
+    // as btMultiBodyDynamicsWorld computed them before it was split into processIslands, processDeferredIslands,
+    // stepMultiBodyVelocities and integrateMultiBodyTransforms for btMultiBodyDynamicsWorldMt
+    const btScalar expected[] = {
+        btScalar(0.008187), btScalar(0.100008), btScalar(-0.972196), btScalar(5.051968),
+        btScalar(3.007574), btScalar(0.100001), btScalar(-0.717535), btScalar(4.071524),
+        btScalar(0), btScalar(6), btScalar(-6), btScalar(0.256584),
+        btScalar(0.509808), btScalar(0.2), btScalar(-0.132820),
+        btScalar(3.650191), btScalar(0.199998), btScalar(-0.012981),
+    };
+    btAlignedObjectArray<btScalar> summary;
+    for (int i = 0; i < scene.multiBodies.size(); i++)
+    {
+        const btMultiBody* multiBody = scene.multiBodies[i];
+        btScalar jointSum = 0;
+        for (int j = 0; j < multiBody->getNumLinks(); j++)
+        {
+            for (int k = 0; k < multiBody->getLink(j).m_posVarCount; k++)
+                jointSum += multiBody->getJointPosMultiDof(j)[k];
+        }
+        for (int k = 0; k < 3; k++)
+            summary.push_back(multiBody->getBasePos()[k]);
+        summary.push_back(jointSum);
+    }
+    for (int i = 1; i < scene.bodies.size(); i++)
+    {
+        for (int k = 0; k < 3; k++)
+            summary.push_back(scene.bodies[i]->getWorldTransform().getOrigin()[k]);
+    }
+    ASSERT_EQ(summary.size(), int(sizeof(expected) / sizeof(expected[0])));
+    for (int i = 0; i < summary.size(); i++)
+        EXPECT_NEAR(expected[i], summary[i], 1e-3) << "value " << i;
+}
+
+#if BT_THREADSAFE
+GTEST_TEST(btMultiBodyDynamicsWorldMt, ResultsDoNotDependOnThreadCount)
+{
+    btITaskScheduler* scheduler = btGetTaskScheduler();
+    ASSERT_TRUE(scheduler != 0);
+    const int numSteps = 120;
+    btAlignedObjectArray<btScalar> oneThread, allThreads;
+    {
+        scheduler->setNumThreads(1);
+        MultiBodyScene scene(true, 16, 4);
+        scene.step(numSteps);
+        scene.getState(oneThread);
+    }
+    {
+        scheduler->setNumThreads(scheduler->getMaxNumThreads());
+        MultiBodyScene scene(true, 16, 4);
+        scene.step(numSteps);
+        scene.getState(allThreads);
+    }
+    ASSERT_EQ(oneThread.size(), allThreads.size());
+    for (int i = 0; i < oneThread.size(); i++)
+        ASSERT_EQ(oneThread[i], allThreads[i]) << "value " << i;
+
+    // the ragdolls came to rest on the ground
+    EXPECT_LT(oneThread[1], btScalar(0.6));
+    EXPECT_GT(oneThread[1], btScalar(0));
+}
+#endif  //BT_THREADSAFE
+
+int main(int argc, char** argv)
+{
+#if BT_THREADSAFE
+    btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+    btSetTaskScheduler(scheduler ? scheduler : btGetSequentialTaskScheduler());
+#endif  //BT_THREADSAFE
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
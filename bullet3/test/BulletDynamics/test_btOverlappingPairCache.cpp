@@ -0,0 +1,326 @@
+
+#include <btBulletCollisionCommon.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+static int randomInt(unsigned int& seed, int range)
+{
+    seed = seed * 1664525 + 1013904223;
+    return int((seed >> 8) % unsigned(range));
+}
+
+struct ProxySet
+{
+    btAlignedObjectArray<btBroadphaseProxy> proxies;
+
+    ProxySet(int numProxies)
+    {
+        proxies.resize(numProxies);
+        for (int i = 0; i < numProxies; i++)
+        {
+            // sparse uids, like a broadphase that has removed proxies
+            proxies[i] = btBroadphaseProxy(btVector3(0, 0, 0), btVector3(0, 0, 0), 0, 1, (i % 17) ? -1 : -2);
+            proxies[i].m_uniqueId = i * 3 + 1;
+        }
+    }
+};
+
+static void expectSamePairs(const btOverlappingPairCache& a, const btOverlappingPairCache& b)
+{
+    ASSERT_EQ(a.getNumOverlappingPairs(), b.getNumOverlappingPairs());
+    for (int i = 0; i < a.getNumOverlappingPairs(); i++)
+    {
+        ASSERT_EQ(a.getOverlappingPairArrayPtr()[i].m_pProxy0, b.getOverlappingPairArrayPtr()[i].m_pProxy0) << "pair " << i;
+        ASSERT_EQ(a.getOverlappingPairArrayPtr()[i].m_pProxy1, b.getOverlappingPairArrayPtr()[i].m_pProxy1) << "pair " << i;
+    }
+}
+
+GTEST_TEST(BulletCollision, OpenAddressingPairCacheMatchesHashed)
+{
+    ProxySet set(300);
+    btHashedOverlappingPairCache hashed;
+    btOpenAddressingOverlappingPairCache openAddressing;
+    unsigned int seed = 7;
+    for (int step = 0; step < 60000; step++)
+    {
+        btBroadphaseProxy* proxy0 = &set.proxies[randomInt(seed, set.proxies.size())];
+        btBroadphaseProxy* proxy1 = &set.proxies[randomInt(seed, set.proxies.size())];
+        if (proxy0 == proxy1)
+            continue;
+        // mostly adds early on, then as many removes as adds
+        int op = randomInt(seed, step < 20000 ? 4 : 6);
+        if (op < 3)
+        {
+            btBroadphasePair* added = openAddressing.addOverlappingPair(proxy0, proxy1);
+            EXPECT_EQ(added == 0, hashed.addOverlappingPair(proxy0, proxy1) == 0);
+            if (added)
+            {
+                EXPECT_EQ(added, openAddressing.findPair(proxy1, proxy0));
+                added->m_internalInfo1 = proxy0;
+            }
+        }
+        else if (op < 5)
+        {
+            btBroadphasePair* pair = openAddressing.findPair(proxy0, proxy1);
+            void* userData = pair ? pair->m_internalInfo1 : 0;
+            hashed.removeOverlappingPair(proxy0, proxy1, 0);
+            EXPECT_EQ(userData, openAddressing.removeOverlappingPair(proxy1, proxy0, 0));
+            EXPECT_TRUE(openAddressing.findPair(proxy0, proxy1) == 0);
+        }
+        else if (randomInt(seed, 50) == 0)
+        {
+            hashed.removeOverlappingPairsContainingProxy(proxy0, 0);
+            openAddressing.removeOverlappingPairsContainingProxy(proxy0, 0);
+        }
+        EXPECT_EQ(hashed.findPair(proxy0, proxy1) == 0, openAddressing.findPair(proxy0, proxy1) == 0);
+        if ((step % 1000) == 0)
+            expectSamePairs(hashed, openAddressing);
+    }
+    expectSamePairs(hashed, openAddressing);
+    EXPECT_GT(openAddressing.getNumOverlappingPairs(), 1000);
+
+    // every pair is still found after sorting
+    static_cast<btOverlappingPairCache&>(hashed).sortOverlappingPairs(0);
+    openAddressing.sortOverlappingPairs(0);
+    expectSamePairs(hashed, openAddressing);
+    for (int i = 0; i < openAddressing.getNumOverlappingPairs(); i++)
+    {
+        btBroadphasePair& pair = openAddressing.getOverlappingPairArray()[i];
+        EXPECT_EQ(&pair, openAddressing.findPair(pair.m_pProxy0, pair.m_pProxy1));
+    }
+}
+
+struct BatchChange
+{
+    int m_proxy0;
+    int m_proxy1;
+    bool m_add;
+};
+
+struct BatchUpdateLoop : public btIParallelForBody
+{
+    btOpenAddressingOverlappingPairCache* m_cache;
+    ProxySet* m_set;
+    const BatchChange* m_changes;
+
+    void forLoop(int iBegin, int iEnd) const BT_OVERRIDE
+    {
+        for (int i = iBegin; i < iEnd; i++)
+        {
+            const BatchChange& change = m_changes[i];
+            btBroadphaseProxy* proxy0 = &m_set->proxies[change.m_proxy0];
+            btBroadphaseProxy* proxy1 = &m_set->proxies[change.m_proxy1];
+            if (change.m_add)
+                m_cache->addOverlappingPair(proxy0, proxy1);
+            else
+                m_cache->removeOverlappingPair(proxy0, proxy1, 0);
+        }
+    }
+};
+
+// the pairs after a batch don't depend on the order of the staged changes, or on the threads that staged them
+GTEST_TEST(BulletCollision, OpenAddressingPairCacheBatchUpdate)
+{
+    ProxySet set(200);
+    btOpenAddressingOverlappingPairCache forward;
+    btOpenAddressingOverlappingPairCache backward;
+    unsigned int seed = 99;
+    for (int frame = 0; frame < 20; frame++)
+    {
+        // each pair is changed once per batch, and an add can repeat the add of an existing pair
+        btAlignedObjectArray<BatchChange> changes;
+        btAlignedObjectArray<char> changed;
+        changed.resize(set.proxies.size() * set.proxies.size(), 0);
+        for (int i = 0; i < 3000; i++)
+        {
+            BatchChange change;
+            change.m_proxy0 = randomInt(seed, set.proxies.size());
+            change.m_proxy1 = randomInt(seed, set.proxies.size());
+            change.m_add = randomInt(seed, 3) != 0;
+            int key = btMin(change.m_proxy0, change.m_proxy1) * set.proxies.size() + btMax(change.m_proxy0, change.m_proxy1);
+            if (change.m_proxy0 == change.m_proxy1 || changed[key])
+                continue;
+            changed[key] = 1;
+            changes.push_back(change);
+        }
+
+        int numPairs = forward.getNumOverlappingPairs();
+        forward.beginBatchUpdate();
+        backward.beginBatchUpdate();
+        for (int i = 0; i < changes.size(); i++)
+        {
+            const BatchChange& change = changes[i];
+            const BatchChange& reversed = changes[changes.size() - 1 - i];
+            if (change.m_add)
+                forward.addOverlappingPair(&set.proxies[change.m_proxy0], &set.proxies[change.m_proxy1]);
+            else
+                forward.removeOverlappingPair(&set.proxies[change.m_proxy0], &set.proxies[change.m_proxy1], 0);
+            if (reversed.m_add)
+                backward.addOverlappingPair(&set.proxies[reversed.m_proxy1], &set.proxies[reversed.m_proxy0]);
+            else
+                backward.removeOverlappingPair(&set.proxies[reversed.m_proxy1], &set.proxies[reversed.m_proxy0], 0);
+        }
+        // nothing changes until the end of the batch
+        EXPECT_EQ(forward.getNumOverlappingPairs(), numPairs);
+        forward.endBatchUpdate();
+        backward.endBatchUpdate();
+        expectSamePairs(forward, backward);
+
+        for (int i = 0; i < changes.size(); i++)
+        {
+            const BatchChange& change = changes[i];
+            btBroadphaseProxy* proxy0 = &set.proxies[change.m_proxy0];
+            btBroadphaseProxy* proxy1 = &set.proxies[change.m_proxy1];
+            bool collides = forward.needsBroadphaseCollision(proxy0, proxy1);
+            EXPECT_EQ(change.m_add && collides, forward.findPair(proxy0, proxy1) != 0);
+        }
+
+#if BT_THREADSAFE
+        if (btGetTaskScheduler())
+        {
+            btOpenAddressingOverlappingPairCache threaded;
+            threaded.beginBatchUpdate();
+            BatchUpdateLoop loop;
+            loop.m_cache = &threaded;
+            loop.m_set = &set;
+            loop.m_changes = &changes[0];
+            btParallelFor(0, changes.size(), 16, loop);
+            threaded.endBatchUpdate();
+            btOpenAddressingOverlappingPairCache serial;
+            serial.beginBatchUpdate();
+            loop.m_cache = &serial;
+            loop.forLoop(0, changes.size());
+            serial.endBatchUpdate();
+            expectSamePairs(threaded, serial);
+        }
+#endif  //BT_THREADSAFE
+    }
+    EXPECT_GT(forward.getNumOverlappingPairs(), 1000);
+}
+
+// a pair that is added and removed in one batch is in the cache after it, unless it was there before the batch
+GTEST_TEST(BulletCollision, OpenAddressingPairCacheConflictingBatchUpdate)
+{
+    ProxySet set(40);
+    btOpenAddressingOverlappingPairCache forward;
+    btOpenAddressingOverlappingPairCache backward;
+    unsigned int seed = 7;
+    int numConflicts = 0;
+    for (int frame = 0; frame < 20; frame++)
+    {
+        btAlignedObjectArray<BatchChange> changes;
+        btAlignedObjectArray<char> added;
+        btAlignedObjectArray<char> removed;
+        added.resize(set.proxies.size() * set.proxies.size(), 0);
+        removed.resize(set.proxies.size() * set.proxies.size(), 0);
+        for (int i = 0; i < 2000; i++)
+        {
+            BatchChange change;
+            change.m_proxy0 = randomInt(seed, set.proxies.size());
+            change.m_proxy1 = randomInt(seed, set.proxies.size());
+            change.m_add = randomInt(seed, 2) != 0;
+            if (change.m_proxy0 == change.m_proxy1)
+                continue;
+            int key = btMin(change.m_proxy0, change.m_proxy1) * set.proxies.size() + btMax(change.m_proxy0, change.m_proxy1);
+            (change.m_add ? added : removed)[key] = 1;
+            changes.push_back(change);
+        }
+
+        btAlignedObjectArray<char> before;
+        before.resize(added.size(), 0);
+        for (int i = 0; i < forward.getNumOverlappingPairs(); i++)
+        {
+            const btBroadphasePair& pair = forward.getOverlappingPairArrayPtr()[i];
+            int proxy0 = int(pair.m_pProxy0 - &set.proxies[0]);
+            int proxy1 = int(pair.m_pProxy1 - &set.proxies[0]);
+            before[btMin(proxy0, proxy1) * set.proxies.size() + btMax(proxy0, proxy1)] = 1;
+        }
+
+        BatchUpdateLoop loop;
+        loop.m_set = &set;
+        loop.m_changes = &changes[0];
+        forward.beginBatchUpdate();
+        loop.m_cache = &forward;
+        loop.forLoop(0, changes.size());
+        forward.endBatchUpdate();
+        backward.beginBatchUpdate();
+        for (int i = changes.size() - 1; i >= 0; i--)
+        {
+            loop.m_cache = &backward;
+            loop.forLoop(i, i + 1);
+        }
+        backward.endBatchUpdate();
+        expectSamePairs(forward, backward);
+
+        for (int proxy0 = 0; proxy0 < set.proxies.size(); proxy0++)
+        {
+            for (int proxy1 = proxy0 + 1; proxy1 < set.proxies.size(); proxy1++)
+            {
+                int key = proxy0 * set.proxies.size() + proxy1;
+                if (added[key] && removed[key])
+                    numConflicts++;
+                bool collides = forward.needsBroadphaseCollision(&set.proxies[proxy0], &set.proxies[proxy1]);
+                bool expected = before[key] ? !removed[key] : (added[key] && collides);
+                EXPECT_EQ(expected, forward.findPair(&set.proxies[proxy0], &set.proxies[proxy1]) != 0);
+            }
+        }
+
+#if BT_THREADSAFE
+        if (btGetTaskScheduler())
+        {
+            btOpenAddressingOverlappingPairCache threaded;
+            threaded.beginBatchUpdate();
+            loop.m_cache = &threaded;
+            btParallelFor(0, changes.size(), 1, loop);
+            threaded.endBatchUpdate();
+            btOpenAddressingOverlappingPairCache serial;
+            serial.beginBatchUpdate();
+            loop.m_cache = &serial;
+            loop.forLoop(0, changes.size());
+            serial.endBatchUpdate();
+            expectSamePairs(threaded, serial);
+        }
+#endif  //BT_THREADSAFE
+    }
+    EXPECT_GT(numConflicts, 1000);
+}
+
+GTEST_TEST(BulletCollision, OpenAddressingPairCacheInDbvtBroadphase)
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher(&collisionConfiguration);
+    btOpenAddressingOverlappingPairCache pairCache;
+    btDbvtBroadphase broadphase(&pairCache);
+    btCollisionWorld world(&dispatcher, &broadphase, &collisionConfiguration);
+    btSphereShape sphere(1);
+    btAlignedObjectArray<btCollisionObject*> objects;
+    for (int i = 0; i < 100; i++)
+    {
+        btCollisionObject* object = new btCollisionObject();
+        object->setCollisionShape(&sphere);
+        object->getWorldTransform().setOrigin(btVector3(btScalar(i % 10) * btScalar(1.5), 0, btScalar(i / 10) * btScalar(1.5)));
+        world.addCollisionObject(object);
+        objects.push_back(object);
+    }
+    world.performDiscreteCollisionDetection();
+    // each sphere overlaps its neighbours in the grid and on the diagonals
+    EXPECT_EQ(pairCache.getNumOverlappingPairs(), 2 * 9 * 10 + 2 * 9 * 9);
+    EXPECT_GT(dispatcher.getNumManifolds(), 0);
+    for (int i = 0; i < objects.size(); i++)
+    {
+        world.removeCollisionObject(objects[i]);
+        delete objects[i];
+    }
+    EXPECT_EQ(pairCache.getNumOverlappingPairs(), 0);
+}
+
+int main(int argc, char** argv)
+{
+#if BT_THREADSAFE
+    btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+    if (scheduler)
+        btSetTaskScheduler(scheduler);
+#endif  //BT_THREADSAFE
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,216 @@
+#include <btBulletDynamicsCommon.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+typedef std::vector<std::pair<int, int> > TriangleList;
+
+struct TriangleCollector : public btTriangleCallback
+{
+    TriangleList triangles;
+
+    virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+    {
+        triangles.push_back(std::make_pair(partId, triangleIndex));
+    }
+
+    TriangleList sorted()
+    {
+        std::sort(triangles.begin(), triangles.end());
+        TriangleList result;
+        result.swap(triangles);
+        return result;
+    }
+};
+
+// A bumpy grid, two triangles per cell
+struct GridMesh
+{
+    enum
+    {
+        SIZE = 96
+    };
+    btAlignedObjectArray<btVector3> vertices;
+    btAlignedObjectArray<int> indices;
+    btTriangleIndexVertexArray* meshInterface;
+    btVector3 aabbMin;
+    btVector3 aabbMax;
+
+    GridMesh()
+    {
+        for (int i = 0; i < SIZE; i++)
+        {
+            for (int j = 0; j < SIZE; j++)
+                vertices.push_back(btVector3(btScalar(i), btSin(btScalar(i) * btScalar(0.3)) * btCos(btScalar(j) * btScalar(0.2)) * 3, btScalar(j)));
+        }
+        for (int i = 0; i < SIZE - 1; i++)
+        {
+            for (int j = 0; j < SIZE - 1; j++)
+            {
+                int v = i * SIZE + j;
+                indices.push_back(v);
+                indices.push_back(v + 1);
+                indices.push_back(v + SIZE);
+                indices.push_back(v + 1);
+                indices.push_back(v + SIZE + 1);
+                indices.push_back(v + SIZE);
+            }
+        }
+        meshInterface = new btTriangleIndexVertexArray(indices.size() / 3, &indices[0], 3 * sizeof(int), vertices.size(), &vertices[0][0], sizeof(btVector3));
+        updateAabb();
+    }
+
+    ~GridMesh()
+    {
+        delete meshInterface;
+    }
+
+    void deform(btScalar time)
+    {
+        for (int i = 0; i < vertices.size(); i++)
+            vertices[i].setY(btSin(vertices[i].x() * btScalar(0.2) + time) * btCos(vertices[i].z() * btScalar(0.25) - time) * 5);
+        updateAabb();
+    }
+
+    void updateAabb()
+    {
+        aabbMin = aabbMax = vertices[0];
+        for (int i = 1; i < vertices.size(); i++)
+        {
+            aabbMin.setMin(vertices[i]);
+            aabbMax.setMax(vertices[i]);
+        }
+    }
+
+    btBvhTriangleMeshShape* createShape(btQuantizedBvh::btBuildMode buildMode)
+    {
+        btQuantizedBvh::btBuildMode previous = btQuantizedBvh::getBuildMode();
+        btQuantizedBvh::setBuildMode(buildMode);
+        btBvhTriangleMeshShape* shape = new btBvhTriangleMeshShape(meshInterface, true, aabbMin - btVector3(1, 10, 1), aabbMax + btVector3(1, 10, 1));
+        btQuantizedBvh::setBuildMode(previous);
+        return shape;
+    }
+};
+
+static btScalar randomScalar(btScalar range)
+{
+    return btScalar(rand()) / btScalar(RAND_MAX) * range;
+}
+
+static void expectSameQueries(btBvhTriangleMeshShape* a, btBvhTriangleMeshShape* b, int numQueries)
+{
+    TriangleCollector collectorA, collectorB;
+    int numHits = 0;
+    for (int i = 0; i < numQueries; i++)
+    {
+        btVector3 from(randomScalar(GridMesh::SIZE), 10, randomScalar(GridMesh::SIZE));
+        btVector3 to(randomScalar(GridMesh::SIZE), -10, randomScalar(GridMesh::SIZE));
+        a->performRaycast(&collectorA, from, to);
+        b->performRaycast(&collectorB, from, to);
+        TriangleList hits = collectorA.sorted();
+        ASSERT_EQ(hits, collectorB.sorted()) << "ray " << i;
+        numHits += int(hits.size());
+
+        btVector3 extent(randomScalar(2), randomScalar(2), randomScalar(2));
+        a->performConvexcast(&collectorA, from, to, -extent, extent);
+        b->performConvexcast(&collectorB, from, to, -extent, extent);
+        ASSERT_EQ(collectorA.sorted(), collectorB.sorted()) << "convex cast " << i;
+
+        btVector3 center(randomScalar(GridMesh::SIZE), randomScalar(10) - 5, randomScalar(GridMesh::SIZE));
+        a->processAllTriangles(&collectorA, center - extent * 2, center + extent * 2);
+        b->processAllTriangles(&collectorB, center - extent * 2, center + extent * 2);
+        ASSERT_EQ(collectorA.sorted(), collectorB.sorted()) << "aabb " << i;
+    }
+    EXPECT_GT(numHits, numQueries);
+}
+
+static void expectSameNodes(btOptimizedBvh* a, btOptimizedBvh* b)
+{
+    const QuantizedNodeArray& nodesA = a->getQuantizedNodeArray();
+    const QuantizedNodeArray& nodesB = b->getQuantizedNodeArray();
+    ASSERT_EQ(nodesA.size(), nodesB.size());
+    for (int i = 0; i < nodesA.size(); i++)
+    {
+        ASSERT_EQ(nodesA[i].m_escapeIndexOrTriangleIndex, nodesB[i].m_escapeIndexOrTriangleIndex) << "node " << i;
+        for (int k = 0; k < 3; k++)
+        {
+            ASSERT_EQ(nodesA[i].m_quantizedAabbMin[k], nodesB[i].m_quantizedAabbMin[k]) << "node " << i;
+            ASSERT_EQ(nodesA[i].m_quantizedAabbMax[k], nodesB[i].m_quantizedAabbMax[k]) << "node " << i;
+        }
+    }
+    BvhSubtreeInfoArray& subtreesA = a->getSubtreeInfoArray();
+    BvhSubtreeInfoArray& subtreesB = b->getSubtreeInfoArray();
+    ASSERT_EQ(subtreesA.size(), subtreesB.size());
+    EXPECT_GT(subtreesA.size(), 1);
+    for (int i = 0; i < subtreesA.size(); i++)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            ASSERT_EQ(subtreesA[i].m_quantizedAabbMin[k], subtreesB[i].m_quantizedAabbMin[k]) << "subtree " << i;
+            ASSERT_EQ(subtreesA[i].m_quantizedAabbMax[k], subtreesB[i].m_quantizedAabbMax[k]) << "subtree " << i;
+        }
+    }
+}
+
+static void checkSahTree()
+{
+    srand(1);
+    GridMesh mesh;
+    btBvhTriangleMeshShape* meanSplit = mesh.createShape(btQuantizedBvh::BUILD_MEAN_SPLIT);
+    btBvhTriangleMeshShape* sah = mesh.createShape(btQuantizedBvh::BUILD_SAH_BINNED);
+    expectSameQueries(meanSplit, sah, 200);
+    delete meanSplit;
+    delete sah;
+}
+
+static void checkRefitParallel()
+{
+    srand(2);
+    GridMesh mesh;
+    btBvhTriangleMeshShape* serial = mesh.createShape(btQuantizedBvh::BUILD_SAH_BINNED);
+    btBvhTriangleMeshShape* parallel = mesh.createShape(btQuantizedBvh::BUILD_SAH_BINNED);
+    btBvhTriangleMeshShape* meanSplit = mesh.createShape(btQuantizedBvh::BUILD_MEAN_SPLIT);
+    for (int frame = 1; frame <= 3; frame++)
+    {
+        mesh.deform(btScalar(frame) * btScalar(0.7));
+        serial->refitTree(mesh.aabbMin, mesh.aabbMax);
+        parallel->refitTreeParallel(mesh.aabbMin, mesh.aabbMax);
+        meanSplit->refitTree(mesh.aabbMin, mesh.aabbMax);
+        expectSameNodes(serial->getOptimizedBvh(), parallel->getOptimizedBvh());
+        expectSameQueries(meanSplit, parallel, 50);
+    }
+    delete serial;
+    delete parallel;
+    delete meanSplit;
+}
+
+GTEST_TEST(btQuantizedBvh, SahTreeFindsTheSameTriangles)
+{
+    checkSahTree();
+}
+
+GTEST_TEST(btQuantizedBvh, RefitParallelMatchesRefit)
+{
+    checkRefitParallel();
+}
+
+GTEST_TEST(btQuantizedBvh, BuildAndRefitWithoutScheduler)
+{
+    btITaskScheduler* scheduler = btGetTaskScheduler();
+    btSetTaskScheduler(0);
+    checkSahTree();
+    checkRefitParallel();
+    btSetTaskScheduler(scheduler);
+}
+
+int main(int argc, char** argv)
+{
+#if BT_THREADSAFE
+    btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+    btSetTaskScheduler(scheduler ? scheduler : btGetSequentialTaskScheduler());
+#endif  //BT_THREADSAFE
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
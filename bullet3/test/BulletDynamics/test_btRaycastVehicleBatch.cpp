@@ -0,0 +1,200 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Vehicle/btRaycastVehicleBatch.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+// flat ground with speed bumps and a ramp, and a grid of four wheeled vehicles
+struct VehicleScene
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher;
+    btDbvtBroadphase broadphase;
+    btSequentialImpulseConstraintSolver solver;
+    btDiscreteDynamicsWorld world;
+    btDefaultVehicleRaycaster raycaster;
+    btBoxShape chassisShape;
+    btAlignedObjectArray<btCollisionShape*> shapes;
+    btAlignedObjectArray<btCollisionObject*> objects;
+    btAlignedObjectArray<btRigidBody*> chassis;
+    btAlignedObjectArray<btRaycastVehicle*> vehicles;
+
+    VehicleScene(int numVehicles)
+        : dispatcher(&collisionConfiguration),
+          world(&dispatcher, &broadphase, &solver, &collisionConfiguration),
+          raycaster(&world),
+          chassisShape(btVector3(1, btScalar(0.25), 2))
+    {
+        addBox(btVector3(60, 1, 60), btTransform(btQuaternion::getIdentity(), btVector3(0, -1, 0)));
+        for (int i = 0; i < 8; i++)
+            addBox(btVector3(30, btScalar(0.08), btScalar(0.3)), btTransform(btQuaternion::getIdentity(), btVector3(0, 0, btScalar(i * 5 - 12))));
+        addBox(btVector3(4, btScalar(0.2), 6), btTransform(btQuaternion(btVector3(1, 0, 0), btScalar(0.15)), btVector3(10, 0, 5)));
+
+        btRaycastVehicle::btVehicleTuning tuning;
+        for (int i = 0; i < numVehicles; i++)
+        {
+            btVector3 localInertia;
+            chassisShape.calculateLocalInertia(800, localInertia);
+            btRigidBody* body = new btRigidBody(800, 0, &chassisShape, localInertia);
+            body->setWorldTransform(btTransform(btQuaternion::getIdentity(), btVector3(btScalar((i % 6) * 5 - 12), btScalar(1.5), btScalar((i / 6) * 7 - 14))));
+            body->setActivationState(DISABLE_DEACTIVATION);
+            world.addRigidBody(body);
+            chassis.push_back(body);
+
+            btRaycastVehicle* vehicle = new btRaycastVehicle(tuning, body, &raycaster);
+            vehicle->setCoordinateSystem(0, 1, 2);
+            for (int w = 0; w < 4; w++)
+            {
+                btVector3 connection(btScalar((w & 1) ? 0.9 : -0.9), btScalar(-0.3), btScalar((w & 2) ? 1.6 : -1.6));
+                btWheelInfo& wheel = vehicle->addWheel(connection, btVector3(0, -1, 0), btVector3(-1, 0, 0), btScalar(0.6), btScalar(0.5), tuning, (w & 2) != 0);
+                wheel.m_suspensionStiffness = 20;
+                wheel.m_wheelsDampingRelaxation = btScalar(2.3);
+                wheel.m_wheelsDampingCompression = btScalar(4.4);
+                wheel.m_frictionSlip = 1000;
+                wheel.m_rollInfluence = btScalar(0.1);
+            }
+            vehicles.push_back(vehicle);
+        }
+    }
+
+    void addBox(const btVector3& halfExtents, const btTransform& transform)
+    {
+        btBoxShape* shape = new btBoxShape(halfExtents);
+        btRigidBody* body = new btRigidBody(0, 0, shape);
+        body->setWorldTransform(transform);
+        world.addRigidBody(body);
+        shapes.push_back(shape);
+        objects.push_back(body);
+    }
+
+    void drive(int frame)
+    {
+        for (int i = 0; i < vehicles.size(); i++)
+        {
+            btScalar steering = btScalar(0.3) * btSin(btScalar(frame) * btScalar(0.02) + btScalar(i));
+            btScalar engineForce = (i % 4) == 3 ? btScalar(-800) : btScalar(1500);
+            for (int w = 0; w < 4; w++)
+            {
+                if (w & 2)
+                    vehicles[i]->setSteeringValue(steering, w);
+                else
+                    vehicles[i]->applyEngineForce(engineForce, w);
+            }
+            vehicles[i]->setBrake(frame > 240 && (i % 5) == 0 ? btScalar(60) : btScalar(0), 0);
+        }
+    }
+
+    ~VehicleScene()
+    {
+        for (int i = 0; i < vehicles.size(); i++)
+        {
+            world.removeRigidBody(chassis[i]);
+            delete vehicles[i];
+            delete chassis[i];
+        }
+        for (int i = 0; i < objects.size(); i++)
+        {
+            world.removeCollisionObject(objects[i]);
+            delete objects[i];
+            delete shapes[i];
+        }
+    }
+};
+
+GTEST_TEST(BulletDynamics, RaycastVehicleBatchMatchesVehicles)
+{
+    const int numVehicles = 24;
+    VehicleScene reference(numVehicles);
+    VehicleScene batched(numVehicles);
+    btRaycastVehicleBatch batch;
+    for (int i = 0; i < numVehicles; i++)
+    {
+        reference.world.addVehicle(reference.vehicles[i]);
+        batch.addVehicle(batched.vehicles[i]);
+    }
+    batched.world.addAction(&batch);
+    ASSERT_EQ(batch.getNumVehicles(), numVehicles);
+    btAlignedObjectArray<btVector3> start;
+    for (int i = 0; i < numVehicles; i++)
+        start.push_back(batched.chassis[i]->getWorldTransform().getOrigin());
+
+    btScalar maxError = 0;
+    for (int frame = 0; frame < 360; frame++)
+    {
+        reference.drive(frame);
+        batched.drive(frame);
+        reference.world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+        batched.world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+
+        for (int i = 0; i < numVehicles; i++)
+        {
+            const btTransform& expected = reference.chassis[i]->getWorldTransform();
+            const btTransform& transform = batched.chassis[i]->getWorldTransform();
+            btScalar error = (transform.getOrigin() - expected.getOrigin()).length();
+            error = btMax(error, btFabs(btScalar(1.) - btFabs(transform.getRotation().dot(expected.getRotation()))));
+            maxError = btMax(maxError, error);
+            ASSERT_LT(error, btScalar(1e-3)) << "frame " << frame << " vehicle " << i;
+            for (int w = 0; w < 4; w++)
+            {
+                const btWheelInfo& expectedWheel = reference.vehicles[i]->getWheelInfo(w);
+                const btWheelInfo& wheel = batched.vehicles[i]->getWheelInfo(w);
+                EXPECT_EQ(wheel.m_raycastInfo.m_isInContact, expectedWheel.m_raycastInfo.m_isInContact);
+                EXPECT_NEAR(wheel.m_raycastInfo.m_suspensionLength, expectedWheel.m_raycastInfo.m_suspensionLength, 1e-3);
+            }
+            EXPECT_NEAR(batched.vehicles[i]->getCurrentSpeedKmHour(), reference.vehicles[i]->getCurrentSpeedKmHour(), 1e-2);
+        }
+    }
+    EXPECT_LT(maxError, btScalar(1e-4));
+
+    // the vehicles drove on their wheels
+    for (int i = 0; i < numVehicles; i++)
+    {
+        btRigidBody* body = batched.chassis[i];
+        EXPECT_GT((body->getWorldTransform().getOrigin() - start[i]).length(), btScalar(3));
+        EXPECT_GT(body->getWorldTransform().getBasis().getColumn(1).y(), btScalar(0.8));
+        int wheelsInContact = 0;
+        for (int w = 0; w < 4; w++)
+            wheelsInContact += batched.vehicles[i]->getWheelInfo(w).m_raycastInfo.m_isInContact ? 1 : 0;
+        EXPECT_GE(wheelsInContact, 2);
+    }
+
+    batched.world.removeAction(&batch);
+    for (int i = 0; i < numVehicles; i++)
+        reference.world.removeVehicle(reference.vehicles[i]);
+}
+
+GTEST_TEST(BulletDynamics, RaycastVehicleBatchRemoveVehicle)
+{
+    VehicleScene scene(3);
+    btRaycastVehicleBatch batch;
+    for (int i = 0; i < 3; i++)
+        batch.addVehicle(scene.vehicles[i]);
+    batch.removeVehicle(scene.vehicles[1]);
+    ASSERT_EQ(batch.getNumVehicles(), 2);
+    EXPECT_EQ(batch.getVehicle(0), scene.vehicles[0]);
+    EXPECT_EQ(batch.getVehicle(1), scene.vehicles[2]);
+
+    // the removed vehicle falls on its chassis, the others land on their wheels
+    scene.world.addAction(&batch);
+    for (int frame = 0; frame < 120; frame++)
+        scene.world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+    EXPECT_LT(scene.chassis[1]->getWorldTransform().getOrigin().y(), btScalar(0.3));
+    for (int i = 0; i < 3; i += 2)
+    {
+        EXPECT_GT(scene.chassis[i]->getWorldTransform().getOrigin().y(), btScalar(0.6));
+        for (int w = 0; w < 4; w++)
+            EXPECT_TRUE(scene.vehicles[i]->getWheelInfo(w).m_raycastInfo.m_isInContact);
+    }
+    scene.world.removeAction(&batch);
+}
+
+int main(int argc, char** argv)
+{
+#if BT_THREADSAFE
+    btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+    if (scheduler)
+        btSetTaskScheduler(scheduler);
+#endif  //BT_THREADSAFE
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,215 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletCollision/CollisionDispatch/btGhostObject.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+// A world stepped by btSequentialImpulseConstraintSolverMt with contact batching on, for small scenes too
+struct MtSolverWorld
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher;
+    btDbvtBroadphase broadphase;
+    btSequentialImpulseConstraintSolverMt solver;
+    btDiscreteDynamicsWorld world;
+    btBoxShape groundShape;
+    btRigidBody ground;
+    btAlignedObjectArray<btRigidBody*> bodies;
+
+    MtSolverWorld(bool useRowGroups)
+        : dispatcher(&collisionConfiguration),
+          world(&dispatcher, &broadphase, &solver, &collisionConfiguration),
+          groundShape(btVector3(100, 1, 100)),
+          ground(0, 0, &groundShape)
+    {
+        // the contact batching reads the thread count from the task scheduler
+        btSetTaskScheduler(btGetSequentialTaskScheduler());
+        btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching = 1;
+        btSequentialImpulseConstraintSolverMt::s_useSimdRowGroups = useRowGroups;
+        world.setGravity(btVector3(0, -10, 0));
+        world.getSolverInfo().m_solverMode |= SOLVER_SIMD | SOLVER_USE_2_FRICTION_DIRECTIONS;
+        ground.getWorldTransform().setOrigin(btVector3(0, -1, 0));
+        world.addRigidBody(&ground);
+    }
+
+    ~MtSolverWorld()
+    {
+        for (int i = 0; i < bodies.size(); i++)
+        {
+            world.removeRigidBody(bodies[i]);
+            delete bodies[i];
+        }
+        world.removeRigidBody(&ground);
+    }
+
+    btRigidBody* addBody(btCollisionShape* shape, const btVector3& position)
+    {
+        btVector3 localInertia;
+        shape->calculateLocalInertia(1, localInertia);
+        btRigidBody* body = new btRigidBody(1, 0, shape, localInertia);
+        body->getWorldTransform().setOrigin(position);
+        body->setActivationState(DISABLE_DEACTIVATION);
+        world.addRigidBody(body);
+        bodies.push_back(body);
+        return body;
+    }
+};
+
+static void stepBoxPyramid(bool useRowGroups, btAlignedObjectArray<btVector3>& startPositions, btAlignedObjectArray<btVector3>& positions, btScalar& maxSpeed)
+{
+    MtSolverWorld scene(useRowGroups);
+    btBoxShape box(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+    const int size = 6;
+    for (int k = 0; k < size; k++)
+        for (int i = 0; i < size - k; i++)
+            for (int j = 0; j < size - k; j++)
+                scene.addBody(&box, btVector3(btScalar(i) + btScalar(k) * btScalar(0.5), btScalar(0.5) + btScalar(k), btScalar(j) + btScalar(k) * btScalar(0.5)));
+    for (int i = 0; i < scene.bodies.size(); i++)
+        startPositions.push_back(scene.bodies[i]->getWorldTransform().getOrigin());
+
+    for (int i = 0; i < 120; i++)
+        scene.world.stepSimulation(btScalar(1. / 60.), 0);
+
+    maxSpeed = 0;
+    for (int i = 0; i < scene.bodies.size(); i++)
+    {
+        positions.push_back(scene.bodies[i]->getWorldTransform().getOrigin());
+        btSetMax(maxSpeed, scene.bodies[i]->getLinearVelocity().length());
+    }
+}
+
+GTEST_TEST(BulletDynamics, SequentialImpulseMtRowGroupsBoxPyramid)
+{
+    btAlignedObjectArray<btVector3> startPositions, rowGroupPositions, batchPositions;
+    btScalar rowGroupMaxSpeed, batchMaxSpeed;
+    stepBoxPyramid(true, startPositions, rowGroupPositions, rowGroupMaxSpeed);
+    startPositions.clear();
+    stepBoxPyramid(false, startPositions, batchPositions, batchMaxSpeed);
+
+    // The pyramid comes to rest where it was built, as it does when the batches are solved row by row
+    EXPECT_LT(rowGroupMaxSpeed, 0.05);
+    EXPECT_LT(batchMaxSpeed, 0.05);
+    ASSERT_EQ(rowGroupPositions.size(), batchPositions.size());
+    for (int i = 0; i < rowGroupPositions.size(); i++)
+    {
+        EXPECT_LT(rowGroupPositions[i].distance(startPositions[i]), 0.05) << "box " << i;
+        EXPECT_LT(rowGroupPositions[i].distance(batchPositions[i]), 0.02) << "box " << i;
+    }
+}
+
+static void rollSpheres(bool useRowGroups, btAlignedObjectArray<btVector3>& positions)
+{
+    MtSolverWorld scene(useRowGroups);
+    btSphereShape sphere(btScalar(0.5));
+    for (int i = 0; i < 16; i++)
+    {
+        btRigidBody* body = scene.addBody(&sphere, btVector3(btScalar(i) * 2, btScalar(0.5), 0));
+        body->setLinearVelocity(btVector3(0, 0, 2));
+        body->setFriction(btScalar(0.8));
+        // rolling friction reads the contact impulses while the row groups are being solved
+        body->setRollingFriction(btScalar(0.1) * btScalar(i % 4));
+    }
+    scene.ground.setFriction(1);
+    scene.ground.setRollingFriction(1);
+
+    for (int i = 0; i < 60; i++)
+        scene.world.stepSimulation(btScalar(1. / 60.), 0);
+
+    for (int i = 0; i < scene.bodies.size(); i++)
+        positions.push_back(scene.bodies[i]->getWorldTransform().getOrigin());
+}
+
+GTEST_TEST(BulletDynamics, SequentialImpulseMtRowGroupsRollingFriction)
+{
+    btAlignedObjectArray<btVector3> rowGroupPositions, batchPositions;
+    rollSpheres(true, rowGroupPositions);
+    rollSpheres(false, batchPositions);
+
+    // Each sphere has one contact, so solving in row groups gives the same impulses
+    ASSERT_EQ(rowGroupPositions.size(), batchPositions.size());
+    for (int i = 0; i < rowGroupPositions.size(); i++)
+    {
+        EXPECT_NEAR(rowGroupPositions[i].x(), batchPositions[i].x(), 1e-4) << "sphere " << i;
+        EXPECT_NEAR(rowGroupPositions[i].y(), batchPositions[i].y(), 1e-4) << "sphere " << i;
+        EXPECT_NEAR(rowGroupPositions[i].z(), batchPositions[i].z(), 1e-4) << "sphere " << i;
+    }
+    // Spheres with more rolling friction stop sooner
+    EXPECT_GT(rowGroupPositions[0].z(), rowGroupPositions[3].z());
+}
+
+// counts the contact constraints that refer to a solver body outside of the pool
+template <typename Solver>
+struct SolverBodyIdChecker : public Solver
+{
+    int m_numContacts;
+    int m_numBadSolverBodyIds;
+
+    SolverBodyIdChecker()
+        : m_numContacts(0),
+          m_numBadSolverBodyIds(0)
+    {
+    }
+
+    virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject** bodies, int numBodies, btPersistentManifold** manifoldPtr, int numManifolds, btTypedConstraint** constraints, int numConstraints, const btContactSolverInfo& infoGlobal, btIDebugDraw* debugDrawer) BT_OVERRIDE
+    {
+        btScalar result = Solver::solveGroupCacheFriendlySetup(bodies, numBodies, manifoldPtr, numManifolds, constraints, numConstraints, infoGlobal, debugDrawer);
+        int numSolverBodies = this->m_tmpSolverBodyPool.size();
+        for (int i = 0; i < this->m_tmpSolverContactConstraintPool.size(); i++)
+        {
+            const btSolverConstraint& contact = this->m_tmpSolverContactConstraintPool[i];
+            m_numContacts++;
+            if (contact.m_solverBodyIdA < 0 || contact.m_solverBodyIdA >= numSolverBodies || contact.m_solverBodyIdB < 0 || contact.m_solverBodyIdB >= numSolverBodies)
+                m_numBadSolverBodyIds++;
+        }
+        return result;
+    }
+};
+
+// drops a box on a collision object that is neither static nor a rigid body, like the ghost object of a character
+template <typename Solver>
+static void dropBoxOnGhostObject()
+{
+    SolverBodyIdChecker<Solver> solver;
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher(&collisionConfiguration);
+    btDbvtBroadphase broadphase;
+    btDiscreteDynamicsWorld world(&dispatcher, &broadphase, &solver, &collisionConfiguration);
+    world.setGravity(btVector3(0, -10, 0));
+
+    btBoxShape floorShape(btVector3(5, btScalar(0.5), 5));
+    btGhostObject ghost;
+    ghost.setCollisionShape(&floorShape);
+    ghost.setCollisionFlags(btCollisionObject::CF_CHARACTER_OBJECT);
+    world.addCollisionObject(&ghost, btBroadphaseProxy::CharacterFilter, btBroadphaseProxy::StaticFilter | btBroadphaseProxy::DefaultFilter);
+
+    btBoxShape boxShape(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+    btVector3 localInertia;
+    boxShape.calculateLocalInertia(1, localInertia);
+    btRigidBody box(1, 0, &boxShape, localInertia);
+    box.getWorldTransform().setOrigin(btVector3(0, 2, 0));
+    world.addRigidBody(&box);
+
+    for (int i = 0; i < 120; i++)
+        world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+    // the solver treats the ghost object like a static floor
+    EXPECT_GT(solver.m_numContacts, 0);
+    EXPECT_EQ(solver.m_numBadSolverBodyIds, 0);
+    EXPECT_NEAR(box.getWorldTransform().getOrigin().y(), 1, 0.05);
+    world.removeRigidBody(&box);
+    world.removeCollisionObject(&ghost);
+}
+
+GTEST_TEST(BulletDynamics, SequentialImpulseGhostObjectIsFixed)
+{
+    dropBoxOnGhostObject<btSequentialImpulseConstraintSolver>();
+
+    btSetTaskScheduler(btGetSequentialTaskScheduler());
+    btSequentialImpulseConstraintSolverMt::s_minimumContactManifoldsForBatching = 1;
+    dropBoxOnGhostObject<btSequentialImpulseConstraintSolverMt>();
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,207 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <LinearMath/btThreads.h>
+#include <gtest/gtest.h>
+
+// Separate stacks of boxes and a hinged pair on a ground plane, that settle and fall asleep one by one
+struct IslandScene
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher;
+    btDbvtBroadphase broadphase;
+    btConstraintSolver* solver;
+    btConstraintSolverPoolMt* solverPool;
+    btDiscreteDynamicsWorld* world;
+    btBoxShape groundShape;
+    btBoxShape boxShape;
+    btSphereShape ballShape;
+    btAlignedObjectArray<btRigidBody*> bodies;
+    btAlignedObjectArray<btTypedConstraint*> constraints;
+    int numStacks;
+    int stackHeight;
+
+    IslandScene(bool incrementalIslands, bool multiThreaded)
+        : dispatcher(&collisionConfiguration),
+          solver(0),
+          solverPool(0),
+          groundShape(btVector3(50, 1, 50)),
+          boxShape(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5))),
+          ballShape(btScalar(0.5)),
+          numStacks(6),
+          stackHeight(4)
+    {
+        if (multiThreaded)
+        {
+            btSetTaskScheduler(btGetSequentialTaskScheduler());
+            solverPool = new btConstraintSolverPoolMt(1);
+            world = new btDiscreteDynamicsWorldMt(&dispatcher, &broadphase, solverPool, 0, &collisionConfiguration);
+        }
+        else
+        {
+            solver = new btSequentialImpulseConstraintSolver();
+            world = new btDiscreteDynamicsWorld(&dispatcher, &broadphase, solver, &collisionConfiguration);
+        }
+        world->getSimulationIslandManager()->setIncrementalIslands(incrementalIslands);
+        world->getDispatchInfo().m_deterministicOverlappingPairs = true;
+        world->setGravity(btVector3(0, -10, 0));
+        addBody(&groundShape, 0, btVector3(0, -1, 0));
+        for (int s = 0; s < numStacks; s++)
+        {
+            for (int i = 0; i < stackHeight; i++)
+            {
+                addBody(&boxShape, 1, btVector3(btScalar(s * 4 - 10), btScalar(0.5) + btScalar(i), btScalar(0.05) * btScalar(i % 2)));
+            }
+        }
+        btRigidBody* bodyA = addBody(&boxShape, 1, btVector3(-10, btScalar(0.5), 8));
+        btRigidBody* bodyB = addBody(&boxShape, 1, btVector3(-8, btScalar(0.5), 8));
+        btHingeConstraint* hinge = new btHingeConstraint(*bodyA, *bodyB, btVector3(1, 0, 0), btVector3(-1, 0, 0), btVector3(0, 0, 1), btVector3(0, 0, 1));
+        world->addConstraint(hinge, true);
+        constraints.push_back(hinge);
+    }
+
+    ~IslandScene()
+    {
+        for (int i = 0; i < constraints.size(); i++)
+        {
+            world->removeConstraint(constraints[i]);
+            delete constraints[i];
+        }
+        for (int i = 0; i < bodies.size(); i++)
+        {
+            world->removeRigidBody(bodies[i]);
+            delete bodies[i];
+        }
+        delete world;
+        delete solver;
+        delete solverPool;
+    }
+
+    btRigidBody* addBody(btCollisionShape* shape, btScalar mass, const btVector3& position)
+    {
+        btVector3 localInertia(0, 0, 0);
+        if (mass != 0)
+            shape->calculateLocalInertia(mass, localInertia);
+        btRigidBody* body = new btRigidBody(mass, 0, shape, localInertia);
+        body->getWorldTransform().setOrigin(position);
+        world->addRigidBody(body);
+        bodies.push_back(body);
+        return body;
+    }
+
+    btRigidBody* stackBody(int stack, int level)
+    {
+        return bodies[1 + stack * stackHeight + level];
+    }
+
+    int numSleeping() const
+    {
+        int n = 0;
+        for (int i = 1; i < bodies.size(); i++)
+        {
+            if (bodies[i]->getActivationState() == ISLAND_SLEEPING)
+                n++;
+        }
+        return n;
+    }
+
+    // Stacks are kicked at different times so that they fall asleep at different steps,
+    // later a ball is thrown into the sleeping stack 1 and stack 3 is woken up by hand
+    void step(int frame)
+    {
+        if (frame < numStacks * 20 && (frame % 20) == 0)
+        {
+            btRigidBody* top = stackBody(frame / 20, stackHeight - 1);
+            top->activate();
+            top->applyCentralImpulse(btVector3(0, 0, btScalar(0.5)));
+        }
+        if (frame == 500)
+        {
+            btRigidBody* ball = addBody(&ballShape, 1, btVector3(-6, btScalar(1.5), -6));
+            ball->setLinearVelocity(btVector3(0, 0, 12));
+        }
+        if (frame == 560)
+        {
+            stackBody(3, 0)->activate();
+        }
+        world->stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+    }
+};
+
+static void compareWithRebuiltIslands(bool multiThreaded)
+{
+    IslandScene rebuilt(false, multiThreaded);
+    IslandScene incremental(true, multiThreaded);
+    int maxSleeping = 0;
+    bool ballWokeStack = false;
+    for (int frame = 0; frame < 700; frame++)
+    {
+        rebuilt.step(frame);
+        incremental.step(frame);
+        ASSERT_EQ(rebuilt.bodies.size(), incremental.bodies.size());
+        for (int i = 1; i < rebuilt.bodies.size(); i++)
+        {
+            ASSERT_EQ(rebuilt.bodies[i]->getActivationState(), incremental.bodies[i]->getActivationState()) << "frame " << frame << " body " << i;
+            btVector3 delta = rebuilt.bodies[i]->getWorldTransform().getOrigin() - incremental.bodies[i]->getWorldTransform().getOrigin();
+            ASSERT_LT(delta.length(), btScalar(1e-3)) << "frame " << frame << " body " << i;
+        }
+        maxSleeping = btMax(maxSleeping, incremental.numSleeping());
+        if (frame > 500 && frame < 560 && incremental.stackBody(1, 0)->isActive())
+            ballWokeStack = true;
+    }
+    // everything fell asleep before the ball was thrown, and the ball woke up the stack it hit
+    EXPECT_EQ(maxSleeping, incremental.numStacks * incremental.stackHeight + 2);
+    EXPECT_TRUE(ballWokeStack);
+    EXPECT_TRUE(incremental.stackBody(0, 0)->getActivationState() == ISLAND_SLEEPING);
+}
+
+GTEST_TEST(BulletDynamics, IncrementalIslandsMatchRebuiltIslands)
+{
+    compareWithRebuiltIslands(false);
+}
+
+GTEST_TEST(BulletDynamics, IncrementalIslandsMatchRebuiltIslandsMt)
+{
+    compareWithRebuiltIslands(true);
+}
+
+GTEST_TEST(BulletDynamics, IncrementalIslandsRemoveSleepingBodies)
+{
+    IslandScene scene(true, false);
+    for (int frame = 0; frame < 400; frame++)
+        scene.step(frame);
+    ASSERT_EQ(scene.numSleeping(), scene.numStacks * scene.stackHeight + 2);
+
+    // remove a whole sleeping stack, and the bottom box of another one: the boxes on top stay asleep until woken up
+    for (int i = 0; i < scene.stackHeight; i++)
+    {
+        btRigidBody* body = scene.stackBody(4, i);
+        scene.world->removeRigidBody(body);
+        body->setActivationState(ACTIVE_TAG);
+    }
+    btRigidBody* bottom = scene.stackBody(2, 0);
+    scene.world->removeRigidBody(bottom);
+    for (int frame = 0; frame < 10; frame++)
+        scene.world->stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+    btVector3 topPosition = scene.stackBody(2, 1)->getWorldTransform().getOrigin();
+    EXPECT_EQ(scene.stackBody(2, 1)->getActivationState(), ISLAND_SLEEPING);
+
+    scene.stackBody(2, scene.stackHeight - 1)->activate();
+    for (int frame = 0; frame < 30; frame++)
+        scene.world->stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+    EXPECT_LT(scene.stackBody(2, 1)->getWorldTransform().getOrigin().getY(), topPosition.getY() - btScalar(0.5));
+    EXPECT_EQ(scene.stackBody(0, 0)->getActivationState(), ISLAND_SLEEPING);
+
+    // add them back, sleeping islands are found again once they settle
+    scene.world->addRigidBody(bottom);
+    for (int i = 0; i < scene.stackHeight; i++)
+        scene.world->addRigidBody(scene.stackBody(4, i));
+    for (int frame = 0; frame < 400; frame++)
+        scene.world->stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+    EXPECT_EQ(scene.numSleeping(), scene.numStacks * scene.stackHeight + 2);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
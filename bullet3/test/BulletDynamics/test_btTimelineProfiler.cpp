@@ -0,0 +1,186 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <LinearMath/btTimelineProfiler.h>
+#include <LinearMath/btQuickprof.h>
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#if BT_THREADSAFE
+#include <atomic>
+#include <thread>
+#endif  //BT_THREADSAFE
+
+static std::string readFile(const char* fileName)
+{
+    std::string contents;
+    FILE* file = fopen(fileName, "rb");
+    if (file)
+    {
+        char buffer[4096];
+        size_t n;
+        while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0)
+            contents.append(buffer, n);
+        fclose(file);
+    }
+    return contents;
+}
+
+static int countOccurrences(const std::string& str, const char* pattern)
+{
+    int count = 0;
+    for (size_t pos = str.find(pattern); pos != std::string::npos; pos = str.find(pattern, pos + 1))
+        count++;
+    return count;
+}
+
+GTEST_TEST(LinearMath, TimelineCaptureOfSteppedWorld)
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher(&collisionConfiguration);
+    btDbvtBroadphase broadphase;
+    btSequentialImpulseConstraintSolver solver;
+    btDiscreteDynamicsWorld world(&dispatcher, &broadphase, &solver, &collisionConfiguration);
+    btBoxShape boxShape(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)));
+    btBoxShape groundShape(btVector3(50, 1, 50));
+    btRigidBody ground(0, 0, &groundShape);
+    ground.getWorldTransform().setOrigin(btVector3(0, -1, 0));
+    world.addRigidBody(&ground);
+    btVector3 localInertia;
+    boxShape.calculateLocalInertia(1, localInertia);
+    btRigidBody box(1, 0, &boxShape, localInertia);
+    box.getWorldTransform().setOrigin(btVector3(0, 2, 0));
+    world.addRigidBody(&box);
+
+    btEnterProfileZoneFunc* enterFunc = btGetCurrentEnterProfileZoneFunc();
+    ASSERT_TRUE(btStartTimelineCapture("test_btTimelineProfiler.bin"));
+    EXPECT_TRUE(btIsTimelineCapturing());
+    EXPECT_FALSE(btStartTimelineCapture("test_btTimelineProfiler2.bin"));
+    // a zone that is still open when the capture stops is closed by the converter
+    btTimelineBeginZone("openZone");
+    for (int i = 0; i < 60; i++)
+    {
+        world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+        btTimelineInstantEvent("frame \"quoted\"", i);
+    }
+    btStopTimelineCapture();
+    EXPECT_FALSE(btIsTimelineCapturing());
+    EXPECT_EQ(btGetCurrentEnterProfileZoneFunc(), enterFunc);
+    EXPECT_EQ(btGetTimelineNumDroppedEvents(), 0);
+    // ends of zones begun while capturing are ignored afterwards
+    btTimelineEndZone();
+
+    ASSERT_TRUE(btConvertTimelineToChromeTrace("test_btTimelineProfiler.bin", "test_btTimelineProfiler.json"));
+    std::string json = readFile("test_btTimelineProfiler.json");
+    EXPECT_EQ(json.compare(0, 16, "{\"traceEvents\":["), 0);
+#ifndef BT_NO_PROFILE
+    EXPECT_EQ(countOccurrences(json, "\"name\":\"internalSingleStepSimulation\""), 60);
+#endif
+    EXPECT_EQ(countOccurrences(json, "\"name\":\"frame \\\"quoted\\\"\""), 60);
+    EXPECT_EQ(countOccurrences(json, "\"ph\":\"B\""), countOccurrences(json, "\"ph\":\"E\""));
+    EXPECT_FALSE(btConvertTimelineToChromeTrace("test_btTimelineProfiler.json", "test_btTimelineProfiler2.json"));
+
+    world.removeRigidBody(&box);
+    world.removeRigidBody(&ground);
+}
+
+GTEST_TEST(LinearMath, TimelineRingOverflowKeepsZonesBalanced)
+{
+    ASSERT_TRUE(btStartTimelineCapture("test_btTimelineProfiler.bin"));
+    btTimelineBeginZone("outer");
+    const int numEvents = 200000;
+    btClock clock;
+    for (int i = 0; i < numEvents; i++)
+    {
+        btTimelineBeginZone("inner");
+        btTimelineEndZone();
+    }
+    unsigned long long elapsed = clock.getTimeNanoseconds();
+    btTimelineEndZone();
+    btStopTimelineCapture();
+    // generous bound, recording costs a few tens of nanoseconds per event in optimized builds
+    EXPECT_LT(elapsed / (2 * numEvents), 1000u);
+
+    ASSERT_TRUE(btConvertTimelineToChromeTrace("test_btTimelineProfiler.bin", "test_btTimelineProfiler.json"));
+    std::string json = readFile("test_btTimelineProfiler.json");
+    int numBegins = countOccurrences(json, "\"ph\":\"B\"");
+    EXPECT_EQ(numBegins, countOccurrences(json, "\"ph\":\"E\""));
+    EXPECT_EQ(countOccurrences(json, "\"name\":\"outer\""), 1);
+    // events are either in the file or counted as dropped
+    int numDropped = btGetTimelineNumDroppedEvents();
+    EXPECT_EQ(2 * (numBegins - 1) + numDropped, 2 * numEvents);
+    EXPECT_EQ(numDropped > 0, countOccurrences(json, "droppedEvents") > 0);
+}
+
+#if BT_THREADSAFE
+static std::atomic<int> gNumWorkerZones(0);
+
+static void recordZonesUntilStopped(std::atomic<bool>* stop)
+{
+    while (!stop->load())
+    {
+        btTimelineBeginZone("worker");
+        btTimelineInstantEvent("tick", 0);
+        btTimelineEndZone();
+        gNumWorkerZones++;
+    }
+}
+
+GTEST_TEST(LinearMath, TimelineStopWaitsForRecordingThreads)
+{
+    // the threads keep recording while captures start and stop
+    std::atomic<bool> stop(false);
+    std::thread threads[3];
+    for (int i = 0; i < 3; i++)
+        threads[i] = std::thread(recordZonesUntilStopped, &stop);
+    for (int round = 0; round < 20; round++)
+    {
+        EXPECT_TRUE(btStartTimelineCapture("test_btTimelineProfiler.bin"));
+        int numZones = gNumWorkerZones.load();
+        while (gNumWorkerZones.load() < numZones + 1000)
+            std::this_thread::yield();
+        btStopTimelineCapture();
+
+        EXPECT_TRUE(btConvertTimelineToChromeTrace("test_btTimelineProfiler.bin", "test_btTimelineProfiler.json"));
+        std::string json = readFile("test_btTimelineProfiler.json");
+        EXPECT_EQ(countOccurrences(json, "\"ph\":\"B\""), countOccurrences(json, "\"ph\":\"E\"")) << "round " << round;
+        EXPECT_GT(countOccurrences(json, "\"name\":\"worker\""), 0) << "round " << round;
+    }
+    stop.store(true);
+    for (int i = 0; i < 3; i++)
+        threads[i].join();
+}
+#endif  //BT_THREADSAFE
+
+GTEST_TEST(LinearMath, TimelineMemoryIsFreed)
+{
+    ASSERT_TRUE(btStartTimelineCapture("test_btTimelineProfiler.bin"));
+    btTimelineBeginZone("first");
+    btTimelineEndZone();
+    // the rings are in use while capturing
+    btFreeTimelineMemory();
+    btTimelineBeginZone("second");
+    btTimelineEndZone();
+    btStopTimelineCapture();
+    btFreeTimelineMemory();
+    EXPECT_EQ(btGetTimelineNumDroppedEvents(), 0);
+    ASSERT_TRUE(btConvertTimelineToChromeTrace("test_btTimelineProfiler.bin", "test_btTimelineProfiler.json"));
+    std::string json = readFile("test_btTimelineProfiler.json");
+    EXPECT_EQ(countOccurrences(json, "\"ph\":\"B\""), 2);
+
+    // a new capture allocates the rings again
+    ASSERT_TRUE(btStartTimelineCapture("test_btTimelineProfiler.bin"));
+    btTimelineBeginZone("third");
+    btTimelineEndZone();
+    btStopTimelineCapture();
+    btFreeTimelineMemory();
+    ASSERT_TRUE(btConvertTimelineToChromeTrace("test_btTimelineProfiler.bin", "test_btTimelineProfiler.json"));
+    json = readFile("test_btTimelineProfiler.json");
+    EXPECT_EQ(countOccurrences(json, "\"name\":\"third\""), 1);
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,204 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <gtest/gtest.h>
+
+// records the transforms and counts the calls stepSimulation makes
+struct CountingMotionState : public btMotionState
+{
+    btTransform m_transform;
+    int m_numUpdates;
+
+    CountingMotionState(const btTransform& transform)
+        : m_transform(transform),
+          m_numUpdates(0)
+    {
+    }
+
+    virtual void getWorldTransform(btTransform& worldTrans) const
+    {
+        worldTrans = m_transform;
+    }
+
+    virtual void setWorldTransform(const btTransform& worldTrans)
+    {
+        m_transform = worldTrans;
+        m_numUpdates++;
+    }
+};
+
+// boxes dropped in two groups: the first settles and falls asleep while the second is still falling
+struct TransformScene
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher;
+    btDbvtBroadphase broadphase;
+    btSequentialImpulseConstraintSolver solver;
+    btDiscreteDynamicsWorld world;
+    btBoxShape groundShape;
+    btBoxShape boxShape;
+    btAlignedObjectArray<btRigidBody*> bodies;
+    btAlignedObjectArray<CountingMotionState*> motionStates;
+
+    TransformScene()
+        : dispatcher(&collisionConfiguration),
+          world(&dispatcher, &broadphase, &solver, &collisionConfiguration),
+          groundShape(btVector3(50, 1, 50)),
+          boxShape(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5)))
+    {
+        btRigidBody* ground = new btRigidBody(0, 0, &groundShape);
+        ground->getWorldTransform().setOrigin(btVector3(0, -1, 0));
+        world.addRigidBody(ground);
+        bodies.push_back(ground);
+        motionStates.push_back(0);
+        btVector3 localInertia;
+        boxShape.calculateLocalInertia(1, localInertia);
+        for (int i = 0; i < 40; i++)
+        {
+            btScalar height = i < 20 ? btScalar(1) : btScalar(30);
+            btTransform start(btQuaternion(btVector3(0, 1, 0), btScalar(0.1) * i), btVector3(btScalar((i % 20) * 2 - 20), height, 0));
+            CountingMotionState* motionState = new CountingMotionState(start);
+            btRigidBody* body = new btRigidBody(1, motionState, &boxShape, localInertia);
+            world.addRigidBody(body);
+            bodies.push_back(body);
+            motionStates.push_back(motionState);
+        }
+    }
+
+    ~TransformScene()
+    {
+        for (int i = 0; i < bodies.size(); i++)
+        {
+            world.removeRigidBody(bodies[i]);
+            delete bodies[i];
+            delete motionStates[i];
+        }
+    }
+};
+
+GTEST_TEST(BulletDynamics, TransformOutputMatchesMotionStates)
+{
+    TransformScene reference;
+    TransformScene batched;
+    int numObjects = batched.world.getNumCollisionObjects();
+    btAlignedObjectArray<btTransform> transforms;
+    btAlignedObjectArray<btVector3> positions;
+    btAlignedObjectArray<btQuaternion> orientations;
+    btAlignedObjectArray<int> dirty;
+    transforms.resize(numObjects, btTransform::getIdentity());
+    positions.resize(numObjects, btVector3(0, 0, 0));
+    orientations.resize(numObjects, btQuaternion::getIdentity());
+    dirty.resize(numObjects, -1);
+    btDiscreteDynamicsWorld::TransformOutput output;
+    output.m_transforms = &transforms[0];
+    output.m_positions = &positions[0];
+    output.m_orientations = &orientations[0];
+    output.m_dirtyIndices = &dirty[0];
+    batched.world.setTransformOutput(&output);
+
+    btAlignedObjectArray<int> previousUpdates;
+    previousUpdates.resize(reference.bodies.size(), 0);
+    bool someAsleep = false;
+    for (int frame = 0; frame < 300; frame++)
+    {
+        // uneven frame times, with interpolation and several substeps per frame
+        btScalar timeStep = (frame % 3) ? btScalar(1. / 60.) : btScalar(1. / 25.);
+        reference.world.stepSimulation(timeStep, 3, btScalar(1. / 60.));
+        batched.world.stepSimulation(timeStep, 3, btScalar(1. / 60.));
+
+        int numUpdated = 0;
+        for (int i = 1; i < reference.bodies.size(); i++)
+        {
+            CountingMotionState* motionState = reference.motionStates[i];
+            bool updated = motionState->m_numUpdates != previousUpdates[i];
+            previousUpdates[i] = motionState->m_numUpdates;
+            if (!updated)
+                continue;
+            numUpdated++;
+            int index = batched.bodies[i]->getWorldArrayIndex();
+            const btTransform& expected = motionState->m_transform;
+            EXPECT_LT((transforms[index].getOrigin() - expected.getOrigin()).length(), btScalar(1e-5)) << "frame " << frame << " body " << i;
+            EXPECT_LT((positions[index] - expected.getOrigin()).length(), btScalar(1e-5));
+            btQuaternion rotation = expected.getRotation();
+            EXPECT_GT(btFabs(orientations[index].dot(rotation)), btScalar(1. - 1e-5));
+            EXPECT_GT(btFabs(transforms[index].getRotation().dot(rotation)), btScalar(1. - 1e-5));
+        }
+        // the dirty list names each updated body once, in ascending order
+        ASSERT_EQ(output.m_numDirty, numUpdated) << "frame " << frame;
+        for (int d = 0; d < output.m_numDirty; d++)
+        {
+            int index = dirty[d];
+            ASSERT_TRUE(index > 0 && index < numObjects);
+            EXPECT_NE(reference.motionStates[index]->m_numUpdates, 0);
+            if (d > 0)
+                EXPECT_LT(dirty[d - 1], index);
+        }
+        // no motion state is called while the output is set
+        for (int i = 1; i < batched.bodies.size(); i++)
+            EXPECT_EQ(batched.motionStates[i]->m_numUpdates, 0);
+        if (numUpdated < reference.bodies.size() - 1)
+            someAsleep = true;
+    }
+    EXPECT_TRUE(someAsleep);
+
+    // back to motion states
+    batched.world.setTransformOutput(0);
+    batched.bodies[25]->activate();
+    batched.world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+    EXPECT_GT(batched.motionStates[25]->m_numUpdates, 0);
+}
+
+GTEST_TEST(BulletDynamics, TransformOutputDirtyListIsSortedAfterRemovals)
+{
+    TransformScene scene;
+    btRigidBody* wall = new btRigidBody(0, 0, &scene.groundShape);
+    wall->getWorldTransform().setOrigin(btVector3(0, 0, -60));
+    scene.world.addRigidBody(wall);
+    // removing bodies swaps others into their world array index, the wall lands between the boxes
+    const int removed[] = {35, 12, 3};
+    for (int r = 0; r < 3; r++)
+    {
+        int i = removed[r];
+        scene.world.removeRigidBody(scene.bodies[i]);
+        delete scene.bodies[i];
+        delete scene.motionStates[i];
+        scene.bodies.removeAtIndex(i);
+        scene.motionStates.removeAtIndex(i);
+    }
+    int numObjects = scene.world.getNumCollisionObjects();
+    ASSERT_EQ(numObjects, scene.bodies.size() + 1);
+
+    btAlignedObjectArray<btVector3> positions;
+    btAlignedObjectArray<int> dirty;
+    positions.resize(numObjects, btVector3(0, 0, 0));
+    dirty.resize(numObjects, -1);
+    btDiscreteDynamicsWorld::TransformOutput output;
+    output.m_positions = &positions[0];
+    output.m_dirtyIndices = &dirty[0];
+    scene.world.setTransformOutput(&output);
+    scene.world.setSynchronizeAllMotionStates(true);
+    for (int frame = 0; frame < 10; frame++)
+    {
+        scene.world.stepSimulation(btScalar(1. / 60.), 1, btScalar(1. / 60.));
+        // every box is written, the ground and the wall are not
+        ASSERT_EQ(output.m_numDirty, numObjects - 2) << "frame " << frame;
+        for (int d = 0; d < output.m_numDirty; d++)
+        {
+            int index = dirty[d];
+            if (d > 0)
+                ASSERT_LT(dirty[d - 1], index) << "frame " << frame;
+            btCollisionObject* object = scene.world.getCollisionObjectArray()[index];
+            ASSERT_FALSE(object->isStaticObject());
+            // interpolated, but close enough to tell the boxes apart
+            EXPECT_LT((positions[index] - object->getWorldTransform().getOrigin()).length(), btScalar(0.1));
+        }
+    }
+    scene.world.setTransformOutput(0);
+    scene.world.removeRigidBody(wall);
+    delete wall;
+}
+
+int main(int argc, char** argv)
+{
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
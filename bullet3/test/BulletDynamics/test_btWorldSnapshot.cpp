@@ -0,0 +1,167 @@
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/Dynamics/btWorldSnapshot.h>
+#include <gtest/gtest.h>
+
+// Boxes and balls dropped onto a pile, and a hinged door, so that pairs and contacts come and go between frames
+struct SnapshotScene
+{
+    btDefaultCollisionConfiguration collisionConfiguration;
+    btCollisionDispatcher dispatcher;
+    btDbvtBroadphase broadphase;
+    btSequentialImpulseConstraintSolver solver;
+    btDiscreteDynamicsWorld world;
+    btBoxShape groundShape;
+    btBoxShape boxShape;
+    btSphereShape ballShape;
+    btAlignedObjectArray<btRigidBody*> bodies;
+    btAlignedObjectArray<btTypedConstraint*> constraints;
+
+    SnapshotScene(int numBodies)
+        : dispatcher(&collisionConfiguration),
+          world(&dispatcher, &broadphase, &solver, &collisionConfiguration),
+          groundShape(btVector3(50, 1, 50)),
+          boxShape(btVector3(btScalar(0.5), btScalar(0.5), btScalar(0.5))),
+          ballShape(btScalar(0.4))
+    {
+        world.setGravity(btVector3(0, -10, 0));
+        world.getSolverInfo().m_solverMode |= SOLVER_RANDMIZE_ORDER;
+        addBody(&groundShape, 0, btVector3(0, -1, 0));
+        for (int i = 0; i < numBodies; i++)
+        {
+            btCollisionShape* shape = (i % 3) == 2 ? (btCollisionShape*)&ballShape : (btCollisionShape*)&boxShape;
+            btRigidBody* body = addBody(shape, 1, btVector3(btScalar(i % 4) * btScalar(0.9) - btScalar(1.4), btScalar(0.5) + btScalar(i / 4) * btScalar(1.2), btScalar((i * 7) % 3) * btScalar(0.3)));
+            body->setAngularVelocity(btVector3(btScalar(0.1) * btScalar(i % 5), 0, btScalar(0.2)));
+        }
+        btRigidBody* door = addBody(&boxShape, 1, btVector3(6, 2, 0));
+        btHingeConstraint* hinge = new btHingeConstraint(*door, btVector3(0, btScalar(1.5), 0), btVector3(1, 0, 0));
+        hinge->enableFeedback(true);
+        world.addConstraint(hinge);
+        constraints.push_back(hinge);
+    }
+
+    ~SnapshotScene()
+    {
+        for (int i = 0; i < constraints.size(); i++)
+        {
+            world.removeConstraint(constraints[i]);
+            delete constraints[i];
+        }
+        for (int i = 0; i < bodies.size(); i++)
+        {
+            world.removeRigidBody(bodies[i]);
+            delete bodies[i];
+        }
+    }
+
+    btRigidBody* addBody(btCollisionShape* shape, btScalar mass, const btVector3& position)
+    {
+        btVector3 localInertia(0, 0, 0);
+        if (mass != 0)
+            shape->calculateLocalInertia(mass, localInertia);
+        btRigidBody* body = new btRigidBody(mass, 0, shape, localInertia);
+        body->getWorldTransform().setOrigin(position);
+        world.addRigidBody(body);
+        bodies.push_back(body);
+        return body;
+    }
+
+    // The input of a frame: a kick that throws one of the bodies up, out of its pairs
+    void stepFrame(int frame)
+    {
+        if ((frame % 10) == 3)
+        {
+            btRigidBody* body = bodies[1 + (frame / 10) % (bodies.size() - 2)];
+            body->activate();
+            body->applyCentralImpulse(btVector3(btScalar(0.5), 8, 0));
+        }
+        world.stepSimulation(btScalar(1. / 50.), 4, btScalar(1. / 120.));
+    }
+};
+
+GTEST_TEST(BulletDynamics, WorldSnapshotRestoresState)
+{
+    SnapshotScene scene(24);
+    for (int frame = 0; frame < 40; frame++)
+        scene.stepFrame(frame);
+    ASSERT_GT(scene.dispatcher.getNumManifolds(), 0);
+
+    btWorldSnapshot snapshot;
+    snapshot.capture(&scene.world);
+    unsigned int capturedHash = btWorldSnapshot::hashState(&scene.world);
+    btScalar capturedLocalTime = scene.world.getLocalTime();
+    EXPECT_GT(snapshot.getBufferSize(), 0);
+
+    for (int frame = 40; frame < 60; frame++)
+        scene.stepFrame(frame);
+    EXPECT_NE(btWorldSnapshot::hashState(&scene.world), capturedHash);
+
+    ASSERT_TRUE(snapshot.restore(&scene.world));
+    EXPECT_EQ(btWorldSnapshot::hashState(&scene.world), capturedHash);
+    EXPECT_EQ(scene.world.getLocalTime(), capturedLocalTime);
+
+    // Capturing the restored world gives back the same buffer
+    btWorldSnapshot again;
+    again.capture(&scene.world);
+    ASSERT_EQ(again.getBufferSize(), snapshot.getBufferSize());
+    EXPECT_EQ(memcmp(again.getBuffer(), snapshot.getBuffer(), snapshot.getBufferSize()), 0);
+}
+
+GTEST_TEST(BulletDynamics, WorldSnapshotRollbackIsDeterministic)
+{
+    SnapshotScene scene(24);
+    btDeterminismCheck check;
+    btWorldSnapshot snapshot;
+    const int rollbackFrame = 25;
+    for (int frame = 0; frame < 80; frame++)
+    {
+        if (frame == rollbackFrame)
+            snapshot.capture(&scene.world);
+        scene.stepFrame(frame);
+        EXPECT_TRUE(check.checkFrame(frame, &scene.world));
+    }
+
+    // Re-simulate the same frames twice, the kicks throw bodies out of the pile and back in
+    for (int pass = 0; pass < 2; pass++)
+    {
+        ASSERT_TRUE(snapshot.restore(&scene.world));
+        for (int frame = rollbackFrame; frame < 80; frame++)
+        {
+            scene.stepFrame(frame);
+            EXPECT_TRUE(check.checkFrame(frame, &scene.world)) << "frame " << frame << " pass " << pass;
+        }
+    }
+    EXPECT_EQ(check.getFirstMismatch(), -1);
+
+    // A different input diverges, and is recorded again once forgotten
+    ASSERT_TRUE(snapshot.restore(&scene.world));
+    scene.bodies[5]->applyCentralImpulse(btVector3(0, 3, 0));
+    scene.stepFrame(rollbackFrame);
+    EXPECT_FALSE(check.checkFrame(rollbackFrame, &scene.world));
+    EXPECT_EQ(check.getFirstMismatch(), rollbackFrame);
+    check.forgetFrames(rollbackFrame);
+    EXPECT_TRUE(check.checkFrame(rollbackFrame, &scene.world));
+}
+
+GTEST_TEST(BulletDynamics, WorldSnapshotRejectsOtherWorlds)
+{
+    SnapshotScene scene(8);
+    for (int frame = 0; frame < 10; frame++)
+        scene.stepFrame(frame);
+    btWorldSnapshot snapshot;
+    snapshot.capture(&scene.world);
+
+    SnapshotScene bigger(9);
+    EXPECT_FALSE(snapshot.restore(&bigger.world));
+
+    // Same number of objects, but a removed and added body has a new broadphase proxy
+    btRigidBody* body = scene.bodies[3];
+    scene.world.removeRigidBody(body);
+    scene.world.addRigidBody(body);
+    EXPECT_FALSE(snapshot.restore(&scene.world));
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}